@@ -0,0 +1,277 @@
+#ifndef BleNotifyQueue_h
+#define BleNotifyQueue_h
+
+#include <Arduino.h>
+
+//BleNotifyQueue: send BLE characteristic values through the nRF52 module without blocking loop()
+//
+//Values are queued with setValue() or setFloat32(), where a newer value replaces one that hasn't been sent yet, or with
+//appendValue(), which adds the bytes after any that haven't been sent yet (up to max_payload_bytes) so that several
+//values go out in one notify.  service() must be called from loop().  For each characteristic with a new value, it
+//sends the BLENOTIFY command (and then the BLEWRITE command, if also_write_value is true) and then watches the serial
+//link for the module's reply.  Nothing waits: if the reply isn't in yet, service() just returns.  A reply that doesn't
+//come within reply_timeout_millis is counted as a timeout.  The queue then waits up to reply_timeout_millis more
+//before sending anything else, so that if the reply does come late, it is dropped instead of being taken as the reply
+//to the next command.
+//
+//The module also forwards the phone's data on the same serial link, with no line endings of its own.  So service()
+//reads everything from the module, whether or not a reply is expected, takes out only the replies (a line that is
+//"OK" or "ERROR", or that starts with "OK " or "ERROR "), and keeps every other byte, in order, to be read back with
+//recvBLE() (or available() and read()).  Don't read the module's serial port yourself while the queue is in use.
+
+#define BLE_QUEUE_MAX_CHARS       8     //how many different characteristics can have values waiting
+#define BLE_QUEUE_MAX_PAYLOAD     244   //biggest notify (for the biggest MTU, 247 bytes, minus 3)
+#define BLE_QUEUE_MAX_IN_FLIGHT   4     //commands sent but whose replies haven't come back yet
+#define BLE_QUEUE_MAX_REPLY_CHARS 64
+#define BLE_QUEUE_MAX_PASSTHROUGH 256   //bytes from the module that weren't replies, waiting to be read
+#define BLE_QUEUE_HOLD_MILLIS     5     //when no reply is expected, how long to hold bytes that could be the start of one
+
+class BleNotifyQueue {
+  public:
+    BleNotifyQueue(void) {}  //call setSerial() before service()
+    BleNotifyQueue(Stream *_serialToBLE, Stream *_serialFromBLE) : serialToBLE(_serialToBLE), serialFromBLE(_serialFromBLE) {}
+    void setSerial(Stream *_serialToBLE, Stream *_serialFromBLE) { serialToBLE = _serialToBLE;  serialFromBLE = _serialFromBLE; }
+
+    enum { CMD_NOTIFY = 0x01, CMD_WRITE = 0x02 };
+
+    //queue a value, replacing any value for this characteristic that hasn't been sent.  Returns 0 if OK.
+    int setValue(int service_id, int char_id, const uint8_t *bytes, int n_bytes) {
+      int Islot = findSlot(service_id, char_id);
+      if ((Islot < 0) || (n_bytes < 0) || (n_bytes > min(max_payload_bytes, BLE_QUEUE_MAX_PAYLOAD))) { n_values_dropped++; return -1; }
+      if (slots[Islot].pending_cmds != 0) n_values_coalesced++;
+      memcpy(slots[Islot].bytes, bytes, n_bytes);
+      slots[Islot].n_bytes = n_bytes;
+      slots[Islot].pending_cmds = CMD_NOTIFY | (also_write_value ? CMD_WRITE : 0);
+      n_values_queued++;
+      return 0;
+    }
+
+    //queue a value after any bytes for this characteristic that haven't been notified yet.  Returns 0 if OK, or -1 if
+    //it doesn't fit in one notify (call service() more often, or queue fewer values)
+    int appendValue(int service_id, int char_id, const uint8_t *bytes, int n_bytes) {
+      int Islot = findSlot(service_id, char_id);
+      if (Islot < 0) { n_values_dropped++; return -1; }
+      Slot &slot = slots[Islot];
+      int n_have = (slot.pending_cmds & CMD_NOTIFY) ? slot.n_bytes : 0;  //once notified, start a new payload
+      if ((n_bytes < 0) || (n_have + n_bytes > min(max_payload_bytes, BLE_QUEUE_MAX_PAYLOAD))) { n_values_dropped++; return -1; }
+      if (n_have > 0) n_values_coalesced++;
+      memcpy(slot.bytes + n_have, bytes, n_bytes);
+      slot.n_bytes = n_have + n_bytes;
+      slot.pending_cmds = CMD_NOTIFY | (also_write_value ? CMD_WRITE : 0);
+      n_values_queued++;
+      return 0;
+    }
+
+    //queue a float32 value (lower bytes first), replacing any value that hasn't been sent
+    int setFloat32(int service_id, int char_id, float32_t val_float) {
+      uint32_t val_uint32;  memcpy(&val_uint32, &val_float, sizeof(val_float));
+      uint8_t byte_array[4];
+      for (int Ibyte = 0; Ibyte < 4; ++Ibyte) byte_array[Ibyte] = (uint8_t)(0x000000FF & (val_uint32 >> (Ibyte*8)));  //lower bytes first
+      return setValue(service_id, char_id, byte_array, 4);
+    }
+
+    //call this from loop().  It reads the replies, checks for timeouts, and sends the next commands.
+    void service(unsigned long cur_millis) {
+      if ((serialToBLE == NULL) || (serialFromBLE == NULL)) return;
+
+      //read the replies (and keep everything else for recvBLE())
+      while (serialFromBLE->available() > 0) processByte((char)serialFromBLE->read(), cur_millis);
+
+      //give up on a reply that is too late (but drop it if it does come), and forget a late reply that never came
+      if ((n_in_flight > 0) && ((cur_millis - in_flight_millis[in_flight_read]) > reply_timeout_millis)) {
+        n_timeouts++;
+        if (print_errors) Serial.println("BleNotifyQueue: service: no reply to " + String(cmdName(in_flight_cmd[in_flight_read])) + " within " + String(reply_timeout_millis) + " msec");
+        popInFlight();
+        n_late_replies_to_skip++;  late_millis = cur_millis;
+      }
+      if ((n_late_replies_to_skip > 0) && (n_in_flight == 0) && !reply_matched && ((cur_millis - late_millis) > reply_timeout_millis)) n_late_replies_to_skip = 0;
+      if (!isBusy() && ((cur_millis - candidate_millis) > BLE_QUEUE_HOLD_MILLIS)) flushCandidate();  //no reply came, so the held bytes are the phone's
+
+      //send more commands (but not while a late reply might still come)
+      while ((n_late_replies_to_skip == 0) && (n_in_flight < min(max_in_flight, BLE_QUEUE_MAX_IN_FLIGHT))) {
+        if (!sendNextCommand(cur_millis)) break;  //nothing more to send
+      }
+    }
+
+    //the bytes from the module that weren't replies (such as the phone's data), in the order that they came.  Like
+    //BLE_nRF52::recvBLE(), recvBLE() appends them to the String and returns how many there were.
+    int recvBLE(String *msg) {
+      int n = 0;
+      while (n_passthrough > 0) { msg->concat((char)read());  n++; }
+      return n;
+    }
+    int available(void) { return n_passthrough; }
+    int read(void) {
+      if (n_passthrough == 0) return -1;
+      int c = (uint8_t)passthrough_buff[passthrough_read];
+      passthrough_read = (passthrough_read + 1) % BLE_QUEUE_MAX_PASSTHROUGH;  n_passthrough--;
+      return c;
+    }
+
+    bool isBusy(void) { return (n_in_flight > 0) || (n_late_replies_to_skip > 0) || reply_matched; }  //a reply is expected (or part way in)
+    bool hasPending(void) {                          //anything left to send, or waiting for a reply
+      if (isBusy()) return true;
+      for (int i = 0; i < n_slots; i++) if (slots[i].pending_cmds != 0) return true;
+      return false;
+    }
+
+    void resetStats(void) { n_values_queued = 0; n_values_coalesced = 0; n_values_dropped = 0; n_commands_sent = 0; n_replies_ok = 0; n_replies_failed = 0; n_timeouts = 0; n_late_replies = 0; n_passthrough_bytes = 0; n_passthrough_dropped = 0; }
+    void printStats(void) {
+      Serial.println("BleNotifyQueue: values: queued " + String(n_values_queued) + ", coalesced " + String(n_values_coalesced) + ", dropped " + String(n_values_dropped));
+      Serial.println("BleNotifyQueue: commands: sent " + String(n_commands_sent) + ", OK " + String(n_replies_ok) + ", failed " + String(n_replies_failed) + ", timed out " + String(n_timeouts) + " (late replies dropped " + String(n_late_replies) + ")");
+      Serial.println("BleNotifyQueue: other bytes from the module: " + String(n_passthrough_bytes) + " (lost " + String(n_passthrough_dropped) + ")");
+    }
+
+    int max_payload_bytes = 20;            //default BLE MTU (23 bytes) minus 3.  Raise it if the phone negotiates a bigger MTU.
+    bool also_write_value = true;          //also send BLEWRITE after BLENOTIFY (so that the value can be read, too)
+    int max_in_flight = 1;                 //commands to send before waiting for their replies (the replies come back in order)
+    unsigned long reply_timeout_millis = 100UL;
+    bool print_errors = true;
+    unsigned long n_values_queued = 0, n_values_coalesced = 0, n_values_dropped = 0;
+    unsigned long n_commands_sent = 0, n_replies_ok = 0, n_replies_failed = 0, n_timeouts = 0, n_late_replies = 0;
+    unsigned long n_passthrough_bytes = 0, n_passthrough_dropped = 0;
+
+  protected:
+    Stream *serialToBLE = NULL;
+    Stream *serialFromBLE = NULL;
+
+    struct Slot {
+      int service_id = -1, char_id = -1;
+      uint8_t pending_cmds = 0;           //which of CMD_NOTIFY and CMD_WRITE still need to be sent
+      uint8_t last_cmd = 0;               //so that a steady stream of new values can't keep pushing back the BLEWRITE
+      int n_bytes = 0;
+      uint8_t bytes[BLE_QUEUE_MAX_PAYLOAD];
+    };
+    Slot slots[BLE_QUEUE_MAX_CHARS];
+    int n_slots = 0;
+    int next_slot = 0;                     //round-robin, so that a busy characteristic can't starve the others
+
+    //the commands waiting for replies (a FIFO, because the module replies in order)
+    uint8_t in_flight_cmd[BLE_QUEUE_MAX_IN_FLIGHT];
+    unsigned long in_flight_millis[BLE_QUEUE_MAX_IN_FLIGHT];
+    int in_flight_read = 0, n_in_flight = 0;
+
+    int n_late_replies_to_skip = 0;        //one for each timeout, until its reply comes or reply_timeout_millis passes
+    unsigned long late_millis = 0;
+
+    //the reply being read.  Until it's known to be a reply (reply_matched), it's the bytes that could still be the
+    //start of one ("O", "ERR", "OK", ...), which go to the passthrough buffer if they turn out not to be.
+    char reply_buff[BLE_QUEUE_MAX_REPLY_CHARS];
+    int reply_len = 0;
+    bool reply_matched = false;
+    bool skip_line_end = false;            //the reply ends in '\r', and maybe more '\r' or '\n'
+    unsigned long candidate_millis = 0;    //when the first of the held bytes came
+
+    char passthrough_buff[BLE_QUEUE_MAX_PASSTHROUGH];
+    int passthrough_read = 0, n_passthrough = 0;
+
+    int findSlot(int service_id, int char_id) {
+      for (int i = 0; i < n_slots; i++) if ((slots[i].service_id == service_id) && (slots[i].char_id == char_id)) return i;
+      if (n_slots >= BLE_QUEUE_MAX_CHARS) return -1;
+      slots[n_slots].service_id = service_id;  slots[n_slots].char_id = char_id;  slots[n_slots].pending_cmds = 0;
+      return n_slots++;
+    }
+
+    static const char* cmdName(uint8_t cmd) { return (cmd == CMD_NOTIFY) ? "BLENOTIFY" : "BLEWRITE"; }
+
+    //send the next command (if any).  The format is the same as from BLE_nRF52::sendCommand(): the command, the
+    //parameters, the raw bytes, and then '\r'.  Returns false if there was nothing to send.
+    bool sendNextCommand(unsigned long cur_millis) {
+      for (int i = 0; i < n_slots; i++) {
+        int Islot = (next_slot + i) % n_slots;
+        Slot &slot = slots[Islot];
+        if (slot.pending_cmds == 0) continue;
+
+        uint8_t cmd = CMD_NOTIFY;
+        if (!(slot.pending_cmds & CMD_NOTIFY) || ((slot.pending_cmds & CMD_WRITE) && (slot.last_cmd == CMD_NOTIFY))) cmd = CMD_WRITE;
+        slot.pending_cmds &= ~cmd;
+        slot.last_cmd = cmd;
+        char header[40];
+        int n_header = snprintf(header, sizeof(header), "%s %d %d %d ", cmdName(cmd), slot.service_id, slot.char_id, slot.n_bytes);
+        serialToBLE->write((const uint8_t *)header, n_header);
+        serialToBLE->write(slot.bytes, slot.n_bytes);
+        serialToBLE->write((uint8_t)'\r');
+        n_commands_sent++;
+
+        int ind = (in_flight_read + n_in_flight) % BLE_QUEUE_MAX_IN_FLIGHT;
+        in_flight_cmd[ind] = cmd;  in_flight_millis[ind] = cur_millis;
+        n_in_flight++;
+        next_slot = (Islot + 1) % n_slots;  //the next characteristic gets the next turn
+        return true;
+      }
+      return false;
+    }
+
+    void processByte(char c, unsigned long cur_millis) {
+      bool is_eol = ((c == '\r') || (c == '\n'));
+      if (reply_matched) {  //the rest of the line is part of the reply
+        if (is_eol) { finishReply(); } else if (reply_len < BLE_QUEUE_MAX_REPLY_CHARS - 1) { reply_buff[reply_len++] = c; }
+        return;
+      }
+      if (skip_line_end && is_eol) return;
+      skip_line_end = false;
+
+      //add it to the bytes that might be a reply, and then pass on the first ones until they could be again
+      if (reply_len == 0) candidate_millis = cur_millis;
+      reply_buff[reply_len++] = c;
+      int match;
+      while ((match = matchReply(reply_buff, reply_len)) == 0) {
+        passthroughByte(reply_buff[0]);
+        reply_len--;  memmove(reply_buff, reply_buff + 1, reply_len);
+      }
+      if (match == 2) {  //"OK" or "ERROR", and then a space or the end of the line
+        reply_matched = true;
+        if (is_eol) { reply_len--;  finishReply(); }
+      }
+    }
+
+    //0 if these bytes aren't the start of a reply, 1 if they might be, and 2 if they are.  An empty one might be.
+    static int matchReply(const char *buff, int len) {
+      static const char *keywords[] = { "OK", "ERROR" };
+      for (int k = 0; k < 2; k++) {
+        int n_key = strlen(keywords[k]);
+        if (strncmp(buff, keywords[k], min(len, n_key)) != 0) continue;
+        if (len <= n_key) return 1;
+        char c = buff[n_key];
+        if ((c == ' ') || (c == '\r') || (c == '\n')) return 2;
+      }
+      return 0;
+    }
+
+    void finishReply(void) {
+      reply_buff[reply_len] = '\0';
+      handleReply();
+      reply_len = 0;  reply_matched = false;  skip_line_end = true;
+    }
+
+    void flushCandidate(void) {
+      for (int i = 0; i < reply_len; i++) passthroughByte(reply_buff[i]);
+      reply_len = 0;  skip_line_end = false;
+    }
+
+    void passthroughByte(char c) {
+      n_passthrough_bytes++;
+      if (n_passthrough >= BLE_QUEUE_MAX_PASSTHROUGH) { n_passthrough_dropped++; return; }
+      passthrough_buff[(passthrough_read + n_passthrough) % BLE_QUEUE_MAX_PASSTHROUGH] = c;  n_passthrough++;
+    }
+
+    void handleReply(void) {
+      if (n_late_replies_to_skip > 0) { n_late_replies_to_skip--;  n_late_replies++;  return; }  //for a command that already timed out
+      if (n_in_flight == 0) return;
+      if (reply_buff[0] == 'O') {
+        n_replies_ok++;
+      } else {
+        n_replies_failed++;
+        if (print_errors) Serial.println("BleNotifyQueue: failed to send BLE data via " + String(cmdName(in_flight_cmd[in_flight_read])) + ". Reply = " + String(reply_buff));
+      }
+      popInFlight();
+    }
+
+    void popInFlight(void) {
+      if (n_in_flight == 0) return;
+      in_flight_read = (in_flight_read + 1) % BLE_QUEUE_MAX_IN_FLIGHT;
+      n_in_flight--;
+    }
+};
+
+#endif
@@ -1,8 +1,15 @@
 #ifndef BottleBuoy_BLE_h
 #define BottleBuoy_BLE_h
 
+#include "BleNotifyQueue.h"
+
 //some externals that are defined in another file in this sketch
 extern BLE_nRF52&    ble_nRF52;
+extern BleNotifyQueue bleNotifyQueue;
+
+
+//The serial port that ble_nRF52 uses to talk to the module.  bleNotifyQueue uses it, too (see setup()).
+HardwareSerial *serialToFromBLE = &Serial7;  //Tympan Rev F using Serial 7.  Other Revs using different Serial.
 
 
 //For bottlebuoy, we need to setup the BLE connection differently than the standard BLE setup used
@@ -23,8 +30,7 @@ void manuallySetupAndBeginBLE(void) {
   int ret_err_code; //we'll need this later
 
   //clear the incoming Serial buffer
-  HardwareSerial *serialFromBLE = &Serial7;  //Tympan Rev F using Serial 7.  Other Revs using different Serial.
-	delay(2000); while (serialFromBLE->available()) serialFromBLE->read();
+	delay(2000); while (serialToFromBLE->available()) serialToFromBLE->read();
 
   //make sure that the communication to the BLE module is working...let's try to get the BLE firwmare rev
   String version_str;	
@@ -63,31 +69,11 @@ void manuallySetupAndBeginBLE(void) {
 }
 
 
-// Function to send the floating-point volume value out via BLE
+// Function to send the floating-point volume value out via BLE.  This only queues the value.  bleNotifyQueue.service(),
+// called from loop(), sends it (via BLENOTIFY and then BLEWRITE) and checks the replies, without blocking.
 uint32_t floatToBytes(float32_t value) {  uint32_t result;  memcpy(&result, &value, sizeof(value)); return result; }
 void sendFloat32ToBLE(int service_id, int char_id, float32_t val_float) {
-  String reply;  //we'll need this later
-
-  //prepare to send data values to our target BLE Service (defined by bottle_ble_service_id) and our target BLE Characteristic (defined by bottle_ble_volume_char_id value)
-  int n_bytes = 4;
-  String params_str = String(" ") + String(service_id) + " " + String(char_id) + " " + String(n_bytes) + " "; //just start and end with a aspace
-    
-  //get the 4 bytes of the float32 volume value
-  uint32_t vol_uint32 = floatToBytes(val_float);
-  uint8_t byte_array[n_bytes];
-  for (uint8_t Ibyte = 0; Ibyte < n_bytes; ++Ibyte) byte_array[Ibyte]=(uint8_t)(0x000000FF & (vol_uint32 >> (Ibyte*8)));  //lower bytes first
-
-  //send via BLE NOTIFY
-  String command_str = "BLENOTIFY";
-  //Serial.print("floatToBytes: Full Command: " + command_str + params_str + ": "); for (int i=0; i<n_bytes;i++) { Serial.print("0x"); Serial.print(data_uint8[i],HEX); Serial.print(" ");}; Serial.println();
-  ble_nRF52.sendCommand(command_str + params_str, byte_array, n_bytes);   
-  delay(2);ble_nRF52.recvReply(&reply); if (!ble_nRF52.doesStartWithOK(reply)) Serial.println("sendFloat32ToBLE: failed send BLE data via " + command_str + ". Reply = " + reply);
-
-  //send via BLE WRITE
-  String command2_str = "BLEWRITE";
-  ble_nRF52.sendCommand(command2_str + params_str, byte_array, n_bytes); 
-  delay(2);ble_nRF52.recvReply(&reply); if (!ble_nRF52.doesStartWithOK(reply)) Serial.println("sendFloat32ToBLE: failed send BLE data via " + command2_str + ". Reply = " + reply);
-
+  if (bleNotifyQueue.setFloat32(service_id, char_id, val_float) != 0) Serial.println("sendFloat32ToBLE: failed to queue the value for char " + String(char_id));
 }
 
 
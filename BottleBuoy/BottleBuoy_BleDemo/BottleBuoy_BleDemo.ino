@@ -32,6 +32,7 @@ AudioConnection_F32       patchCord2(i2s_in, 1, i2s_out, 1);     //connect right
 // Create classes for controlling the system
 #include      "SerialManager.h"                        
 BLE_nRF52&    ble_nRF52 = myTympan.getBLE_nRF52(); //get BLE object for the nRF52840 (RevF only!)
+BleNotifyQueue bleNotifyQueue;                           //sends the data to the phone app without blocking (uses serialToFromBLE, set in setup())
 SerialManager serialManager(&ble_nRF52);                 //create the serial manager for real-time control (via USB or App)
 
 
@@ -61,6 +62,7 @@ void setup() {
   //setup BLE
   Serial.println("Setup ble_nRF52...");
   manuallySetupAndBeginBLE();  // <--------------------- You must have this
+  bleNotifyQueue.setSerial(serialToFromBLE, serialToFromBLE);  //talk to the module on the same port as ble_nRF52 (see BottleBuoy_BLE.h)
 
   //setup complete
   serialManager.printHelp();
@@ -74,14 +76,16 @@ void loop() {
   //look for in-coming serial messages via USB
   if (Serial.available()) serialManager.respondToByte((char)Serial.read());   //USB Serial
 
-  //respond to in coming serial messages via BLE
-  if (ble_nRF52.available() > 0) {
-    String msgFromBle; ble_nRF52.recvBLE(&msgFromBle);    //get BLE messages (removing non-payload messages)
+  //respond to in coming serial messages via BLE.  bleNotifyQueue reads the module's serial port (in service(), below)
+  //and takes out the module's replies to its commands, so get the phone's messages from it, not from ble_nRF52.
+  if (bleNotifyQueue.available() > 0) {
+    String msgFromBle; bleNotifyQueue.recvBLE(&msgFromBle);    //get BLE messages (removing non-payload messages)
     for (unsigned int i=0; i < msgFromBle.length(); i++) serialManager.respondToByte(msgFromBle[i]); //interpet each character of the message
   }
   
   //send updated data to the phone app
   serviceSendDataToPhoneApp(millis(),5000);  // <--------------- This sends data to the App very 5000 msec!
+  bleNotifyQueue.service(millis());          // <--------------- This actually sends it (without blocking)
 
 } //end loop();
 
@@ -0,0 +1,150 @@
+#ifndef Simulated_nRF52_h
+#define Simulated_nRF52_h
+
+#include <Arduino.h>
+
+//Simulated_nRF52: pretends to be the nRF52 BLE module at the other end of the serial link, so that BleNotifyQueue can
+//be tested without the module (see simBleQueue.cpp).  It understands the BLENOTIFY and BLEWRITE commands
+//("<command> <service> <char> <n_bytes> <bytes>\r"), keeps the last value sent to each characteristic, and replies
+//"OK" reply_latency_millis later.  To test the timeouts, it can also skip every Nth reply (drop_every) or send every
+//Nth reply late_extra_millis later than the rest (late_every).  Like the real module, it also forwards data from the
+//phone on the same link, as-is (sendFromPhone()), and it can send a reply that no command asked for (sendStrayReply()).
+
+#define SIM_NRF52_MAX_CHARS     8
+#define SIM_NRF52_MAX_BYTES     244
+#define SIM_NRF52_MAX_REPLIES   16   //replies waiting for their latency to pass
+#define SIM_NRF52_N_OUT_BUFFER  256
+
+class Simulated_nRF52 : public Stream {
+  public:
+    Simulated_nRF52(void) {}
+
+    //bytes from the Tympan to the module
+    virtual size_t write(uint8_t c) {
+      switch (state) {
+        case GET_TEXT:
+          if (c == '\r') { scheduleReply(false); cmd_len = 0; n_spaces = 0; break; }  //ended before the bytes: not a command that we know
+          if (cmd_len < (int)sizeof(cmd_buff) - 1) cmd_buff[cmd_len++] = (char)c;
+          if ((c == ' ') && (++n_spaces == 4)) {   //"<command> <service> <char> <n_bytes> "
+            cmd_buff[cmd_len] = '\0';
+            char name[16];
+            if ((sscanf(cmd_buff, "%15s %d %d %d", name, &cmd_service_id, &cmd_char_id, &cmd_n_bytes) == 4) && (cmd_n_bytes >= 0) && (cmd_n_bytes <= SIM_NRF52_MAX_BYTES)) {
+              cmd_is_notify = (strcmp(name, "BLENOTIFY") == 0);
+              cmd_is_known = cmd_is_notify || (strcmp(name, "BLEWRITE") == 0);
+              n_bytes_received = 0;
+              state = (cmd_n_bytes > 0) ? GET_BYTES : GET_EOC;
+            } else {
+              state = GET_EOC;  cmd_is_known = false;
+            }
+          }
+          break;
+        case GET_BYTES:
+          cmd_bytes[n_bytes_received++] = c;
+          if (n_bytes_received >= cmd_n_bytes) state = GET_EOC;
+          break;
+        case GET_EOC:
+          finishCommand(c == '\r');
+          if (c != '\r') write(c);  //start over with this byte
+          break;
+      }
+      return 1;
+    }
+    using Print::write;
+
+    //bytes from the module to the Tympan (only the replies whose latency has passed)
+    virtual int available(void) { moveDueReplies(); return n_out; }
+    virtual int read(void) {
+      moveDueReplies();
+      if (n_out == 0) return -1;
+      int c = (uint8_t)out_buff[out_read];
+      out_read = (out_read + 1) % SIM_NRF52_N_OUT_BUFFER;  n_out--;
+      return c;
+    }
+    virtual int peek(void) { moveDueReplies(); return (n_out > 0) ? (uint8_t)out_buff[out_read] : -1; }
+    virtual void flush(void) {}
+
+    //the last value sent (by BLENOTIFY) to a characteristic, as a float32 (lower bytes first)
+    float32_t getLastFloat32(int char_id) {
+      if ((char_id < 0) || (char_id >= SIM_NRF52_MAX_CHARS) || (last_n_bytes[char_id] < 4)) return NAN;
+      uint32_t val_uint32 = 0;
+      for (int Ibyte = 0; Ibyte < 4; Ibyte++) val_uint32 |= ((uint32_t)last_bytes[char_id][Ibyte]) << (Ibyte*8);
+      float32_t val_float;  memcpy(&val_float, &val_uint32, sizeof(val_float));
+      return val_float;
+    }
+    int getLastNBytes(int char_id) { return ((char_id >= 0) && (char_id < SIM_NRF52_MAX_CHARS)) ? last_n_bytes[char_id] : 0; }
+
+    //data from the phone, which the module passes on to the Tympan right away (after any replies that are due)
+    void sendFromPhone(const char *str) {
+      moveDueReplies();
+      for (int i = 0; str[i] != '\0'; i++) addToOut(str[i]);
+    }
+
+    //an "OK" that isn't the reply to any command (such as one left over from before the queue was started)
+    void sendStrayReply(void) { sendFromPhone("OK\r\n"); }
+
+    unsigned long reply_latency_millis = 3UL;
+    int drop_every = 0;  //skip every Nth reply (0 to never skip)
+    int late_every = 0;  //send every Nth reply late (0 to never)
+    unsigned long late_extra_millis = 0UL;
+    unsigned long n_notifies = 0, n_writes = 0, n_bad_commands = 0, n_replies_dropped = 0, n_replies_late = 0;
+
+  protected:
+    enum { GET_TEXT = 0, GET_BYTES, GET_EOC };
+    int state = GET_TEXT;
+    char cmd_buff[48];
+    int cmd_len = 0, n_spaces = 0;
+    int cmd_service_id = 0, cmd_char_id = 0, cmd_n_bytes = 0, n_bytes_received = 0;
+    bool cmd_is_notify = false, cmd_is_known = false;
+    uint8_t cmd_bytes[SIM_NRF52_MAX_BYTES];
+
+    uint8_t last_bytes[SIM_NRF52_MAX_CHARS][SIM_NRF52_MAX_BYTES];
+    int last_n_bytes[SIM_NRF52_MAX_CHARS] = {0};
+
+    unsigned long reply_due_millis[SIM_NRF52_MAX_REPLIES];
+    bool reply_ok[SIM_NRF52_MAX_REPLIES];
+    int reply_read = 0, n_replies = 0, reply_count = 0;
+    char out_buff[SIM_NRF52_N_OUT_BUFFER];
+    int out_read = 0, n_out = 0;
+
+    void finishCommand(bool good_eoc) {
+      bool ok = good_eoc && cmd_is_known;
+      if (ok) {
+        if (cmd_is_notify) {
+          n_notifies++;
+          if ((cmd_char_id >= 0) && (cmd_char_id < SIM_NRF52_MAX_CHARS)) {
+            memcpy(last_bytes[cmd_char_id], cmd_bytes, cmd_n_bytes);  last_n_bytes[cmd_char_id] = cmd_n_bytes;
+          }
+        } else {
+          n_writes++;
+        }
+      }
+      scheduleReply(ok);
+      state = GET_TEXT;  cmd_len = 0;  n_spaces = 0;
+    }
+
+    void scheduleReply(bool ok) {
+      if (!ok) n_bad_commands++;
+      reply_count++;
+      if ((drop_every > 0) && ((reply_count % drop_every) == 0)) { n_replies_dropped++; return; }
+      if (n_replies >= SIM_NRF52_MAX_REPLIES) return;
+      int ind = (reply_read + n_replies) % SIM_NRF52_MAX_REPLIES;
+      reply_due_millis[ind] = millis() + reply_latency_millis;  reply_ok[ind] = ok;
+      if ((late_every > 0) && ((reply_count % late_every) == 0)) { reply_due_millis[ind] += late_extra_millis;  n_replies_late++; }
+      n_replies++;
+    }
+
+    void moveDueReplies(void) {
+      while ((n_replies > 0) && ((long)(millis() - reply_due_millis[reply_read]) >= 0)) {
+        const char *reply = reply_ok[reply_read] ? "OK\r\n" : "ERROR\r\n";
+        for (int i = 0; reply[i] != '\0'; i++) addToOut(reply[i]);
+        reply_read = (reply_read + 1) % SIM_NRF52_MAX_REPLIES;  n_replies--;
+      }
+    }
+
+    void addToOut(char c) {
+      if (n_out >= SIM_NRF52_N_OUT_BUFFER) return;
+      out_buff[(out_read + n_out) % SIM_NRF52_N_OUT_BUFFER] = c;  n_out++;
+    }
+};
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef _HostSim_Tympan_Library_h
+#define _HostSim_Tympan_Library_h
+
+// Host (PC) stand-in for the piece of Tympan_Library that BottleBuoy_BLE.h uses: the BLE_nRF52 service IDs and the
+// calls in manuallySetupAndBeginBLE(), which do nothing here (there is no module).  See simBleQueue.cpp.
+
+#include "Arduino.h"
+
+class BLE_nRF52 {
+  public:
+    enum { BLESVC_BATT = 1, BLESVC_LEDBUTTON_4BYTE = 3 };
+    int version(String *) { return 0; }
+    int setBleMac(String) { return 0; }
+    int setBleName(String) { return 0; }
+    int enableServiceByID(int, bool) { return 0; }
+    int enableAdvertiseServiceByID(int) { return 0; }
+    int sendCommand(const char *, const char *) { return 0; }
+    int recvReply(String *) { return 0; }
+    bool doesStartWithOK(String) { return true; }
+};
+
+#endif
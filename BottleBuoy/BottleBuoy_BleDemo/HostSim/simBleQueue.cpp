@@ -0,0 +1,128 @@
+// simBleQueue: runs the sketch's BleNotifyQueue (../BleNotifyQueue.h) on a PC, talking to a simulated nRF52
+// (Simulated_nRF52.h, in this folder) instead of the real module.  The values are queued with the sketch's own
+// sendFloat32ToBLE() (../BottleBuoy_BLE.h) and the phone's data is read back with recvBLE(), the same as loop().
+// It checks:
+//   * busy: both values are queued every msec for 2 sec.  The module is 3 msec slow to reply, skips 1 reply in 100,
+//     and sends 1 in 37 after the timeout.  The last values must reach the module, every late reply must be dropped,
+//     OK plus timeouts must equal the commands sent, and the phone's data (which comes in between the replies, with
+//     no line endings of its own, and sometimes looking like the start of a reply) must come out unchanged.
+//   * idle: nothing is queued, and the module sends the phone's data and now and then an "OK" that no command asked
+//     for.  The phone's data must come out unchanged and the stray "OK"s must not.
+// It also reports how long each call to service() took, which is what loop() is held up by.  (The old, blocking
+// sendFloat32ToBLE() took at least 4 msec for every value.)  The host's times say little about the Teensy's.
+//
+// To build and run (from this folder):
+//     g++ -std=gnu++17 -O2 -I. simBleQueue.cpp -o simBleQueue && ./simBleQueue
+
+#include <Arduino.h>
+#include <Tympan_Library.h>
+BLE_nRF52 ble_obj;
+BLE_nRF52 &ble_nRF52 = ble_obj;
+#include "../BleNotifyQueue.h"
+BleNotifyQueue bleNotifyQueue;
+#include "../BottleBuoy_BLE.h"
+#include "Simulated_nRF52.h"
+
+bool pass = true;
+void report(const char *name, bool ok, const String &details = String("")) {
+  printf("    %-58s %s  %s\n", name, ok ? "PASS" : "FAIL", details.c_str());
+  pass = pass && ok;
+}
+
+//what the phone sends (without line endings, or split, or looking like the start of a reply)
+const int n_phone_msgs = 7;
+const char *phone_msgs[n_phone_msgs] = { "h", "O", "ERR", "Ok\r", "OKAY", "gG", "v\r\n" };
+
+//run loop() for test_millis: service the queue and read the phone's data from it.  Returns the phone's data.
+String runLoop(Simulated_nRF52 &sim_nRF52, unsigned long test_millis, bool send_values, String *sent_by_phone,
+               unsigned long *max_usec, float *ave_usec, float32_t *volume_mL, float32_t *temp_C) {
+  String recv_from_phone;
+  unsigned long n_loops = 0, total_usec = 0;
+  unsigned long start_millis = millis(), last_millis = start_millis;
+  *max_usec = 0;
+  while ((millis() - start_millis < test_millis) || bleNotifyQueue.hasPending() || (millis() - last_millis <= 2*BLE_QUEUE_HOLD_MILLIS)) {
+    unsigned long cur_millis = millis();
+    if ((cur_millis != last_millis) && (cur_millis - start_millis < test_millis)) {
+      if (send_values) {
+        *volume_mL += 1.0f;  *temp_C += 0.01f;
+        sendFloat32ToBLE(bottle_ble_service_id, bottle_ble_volume_char_id, *volume_mL);
+        sendFloat32ToBLE(bottle_ble_service_id, bottle_ble_temperature_char_id, *temp_C);
+      }
+      if (((cur_millis - start_millis) % 7) == 0) {
+        const char *msg = phone_msgs[((cur_millis - start_millis) / 7) % n_phone_msgs];
+        sim_nRF52.sendFromPhone(msg);  *sent_by_phone += String(msg);
+      }
+      if (!send_values && (((cur_millis - start_millis) % 50) == 3)) sim_nRF52.sendStrayReply();
+      last_millis = cur_millis;
+    }
+    unsigned long start_usec = micros();
+    bleNotifyQueue.service(cur_millis);
+    unsigned long dt_usec = micros() - start_usec;
+    *max_usec = max(*max_usec, dt_usec);  total_usec += dt_usec;  n_loops++;
+
+    //read the phone's data like loop() does
+    if (bleNotifyQueue.available() > 0) bleNotifyQueue.recvBLE(&recv_from_phone);
+    if (millis() - start_millis > test_millis + 1000UL) break;  //don't get stuck
+  }
+  *ave_usec = ((float)total_usec) / ((float)max(1UL, n_loops));
+  return recv_from_phone;
+}
+
+void checkBusy(void) {
+  static Simulated_nRF52 sim_nRF52;
+  sim_nRF52.reply_latency_millis = 3;  //about the same as the old delay(2) plus the reply
+  sim_nRF52.drop_every = 100;          //lose a reply now and then, to check the timeouts
+  sim_nRF52.late_every = 37;           //and send some late, to check that they're dropped
+  sim_nRF52.late_extra_millis = 25;
+  bleNotifyQueue.setSerial(&sim_nRF52, &sim_nRF52);
+  bleNotifyQueue.reply_timeout_millis = 20;
+  bleNotifyQueue.print_errors = false;
+  bleNotifyQueue.resetStats();
+
+  String sent_by_phone;
+  unsigned long max_usec;  float ave_usec;
+  float32_t volume_mL = 0.0f, temp_C = 10.0f;
+  String recv_from_phone = runLoop(sim_nRF52, 2000, true, &sent_by_phone, &max_usec, &ave_usec, &volume_mL, &temp_C);
+
+  printf("busy: both values every msec for 2000 msec\n");
+  report("last values reached the module", (sim_nRF52.getLastFloat32(bottle_ble_volume_char_id) == volume_mL) && (sim_nRF52.getLastFloat32(bottle_ble_temperature_char_id) == temp_C),
+    "volume " + String(sim_nRF52.getLastFloat32(bottle_ble_volume_char_id)) + " (sent " + String(volume_mL) + "), temperature "
+    + String(sim_nRF52.getLastFloat32(bottle_ble_temperature_char_id)) + " (sent " + String(temp_C) + ")");
+  report("no bad commands, no failed replies", (sim_nRF52.n_bad_commands == 0) && (bleNotifyQueue.n_replies_failed == 0),
+    String(sim_nRF52.n_notifies) + " notifies, " + String(sim_nRF52.n_writes) + " writes");
+  report("OK + timeouts = commands sent", bleNotifyQueue.n_replies_ok + bleNotifyQueue.n_timeouts == bleNotifyQueue.n_commands_sent,
+    String(bleNotifyQueue.n_replies_ok) + " + " + String(bleNotifyQueue.n_timeouts) + " of " + String(bleNotifyQueue.n_commands_sent));
+  report("every late reply dropped", bleNotifyQueue.n_late_replies == sim_nRF52.n_replies_late,
+    String(bleNotifyQueue.n_late_replies) + " of " + String(sim_nRF52.n_replies_late) + " (" + String(sim_nRF52.n_replies_dropped) + " never sent)");
+  report("phone's data unchanged", recv_from_phone == sent_by_phone,
+    String((unsigned long)recv_from_phone.length()) + " of " + String((unsigned long)sent_by_phone.length()) + " bytes");
+  printf("    time in service(): max %lu usec, average %.2f usec per loop\n", max_usec, ave_usec);
+}
+
+void checkIdle(void) {
+  static Simulated_nRF52 sim_nRF52;
+  bleNotifyQueue.setSerial(&sim_nRF52, &sim_nRF52);
+  bleNotifyQueue.resetStats();
+
+  String sent_by_phone;
+  unsigned long max_usec;  float ave_usec;
+  float32_t volume_mL = 0.0f, temp_C = 0.0f;
+  String recv_from_phone = runLoop(sim_nRF52, 1000, false, &sent_by_phone, &max_usec, &ave_usec, &volume_mL, &temp_C);
+
+  printf("idle: nothing queued for 1000 msec, a stray \"OK\" every 50 msec\n");
+  report("no commands sent", bleNotifyQueue.n_commands_sent == 0);
+  report("phone's data unchanged, stray replies removed", recv_from_phone == sent_by_phone,
+    String((unsigned long)recv_from_phone.length()) + " of " + String((unsigned long)sent_by_phone.length()) + " bytes");
+  printf("    time in service(): max %lu usec, average %.2f usec per loop\n", max_usec, ave_usec);
+}
+
+int main(void) {
+  printf("simBleQueue: BleNotifyQueue against a simulated nRF52\n");
+  Serial.quiet = true;  //the sketch's own printing
+
+  checkBusy();
+  checkIdle();
+
+  printf("simBleQueue: %s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
@@ -3,11 +3,13 @@
 #define _SerialManager_h
 
 #include <Tympan_Library.h>
+#include "BleNotifyQueue.h"
 
 //classes from the main sketch that might be used here
 extern Tympan myTympan;                  //created in the main *.ino file
 extern AudioSettings_F32 audio_settings; //created in the main *.ino file  
 extern BLE_nRF52 &ble_nRF52;
+extern BleNotifyQueue bleNotifyQueue;
 
 
 //functions in the main sketch that I want to call from here
@@ -30,6 +32,7 @@ void SerialManager::printHelp(void) {
   Serial.println(" v:   BLE: Get 'Version' of firmware from module");
   Serial.println(" n:   BLE: Get 'Name' from module");
   Serial.println(" g/G: BLE: Get 'Connected' status via software (g) or GPIO (G)");
+  Serial.println(" q:   BLE: Print the stats of the queue that sends data to the app");
   Serial.println();
 }
 
@@ -85,6 +88,9 @@ bool SerialManager::processCharacter(char c) {  //this is called by SerialManage
         }
       }
       break; 
+    case 'q':
+      bleNotifyQueue.printStats();
+      break;
     default:
       ret_val = false;
   }
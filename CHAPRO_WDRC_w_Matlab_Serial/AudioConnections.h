@@ -3,12 +3,20 @@
 //create audio objects
 AudioInputI2SQuad_F32   audio_in(audio_settings);
 EarpieceMixer_F32_UI    earpieceMixer(audio_settings); //mixes earpiece mics, allows switching to analog inputs, mixes left+right, etc
-AudioEffectBTNRH_F32    BTNRH_alg1(audio_settings);    //see tab "AudioEffectBTNRH.h"
-AudioEffectGain_F32     gain1(audio_settings);         //added gain block to easily increase or lower the gain
+AudioEffectBTNRH_LowLatency_F32 BTNRH_alg1(audio_settings); //see tab "AudioEffectBTNRH_LowLatency.h"...also applies the output gain when USE_FUSED_GAIN
+AudioEffectGain_F32     gain1(audio_settings);         //added gain block to easily increase or lower the gain (not used when USE_FUSED_GAIN)
 AudioOutputI2SQuad_F32  audio_out(audio_settings);
-AudioSDWriter_F32_UI    audioSDWriter(audio_settings); //this is 2-channels of audio by default, but can be changed to 4 in setup()
+SdFs                    sd;                            //This is the SD card.  SdFs is part of the Teensy install
+AudioSDWriter_F32_UI    audioSDWriter(&sd, audio_settings); //this is 2-channels of audio by default, but can be changed to 4 in setup()
 
 
+#if USE_LOW_LATENCY
+//only audio_in -> BTNRH_alg1 -> audio_out, so that each (small) block goes through as few nodes as possible.  The
+//earpiece mixer still sets up the hardware, but it does not mix the mics, and there is no SD recording.
+AudioConnection_F32   patchCord6(audio_in, EarpieceShield::PDM_LEFT_FRONT, BTNRH_alg1, 0);
+#define BTNRH_OUTPUT BTNRH_alg1   //the gain is applied within BTNRH_alg1
+#else
+
 //connect the inputs to the earpiece mixer
 AudioConnection_F32   patchCord1(audio_in, 0, earpieceMixer, 0);
 AudioConnection_F32   patchCord2(audio_in, 1, earpieceMixer, 1);
@@ -17,14 +25,22 @@ AudioConnection_F32   patchCord4(audio_in, 3, earpieceMixer, 3);
 
 //connect to BTNRH algorithm
 AudioConnection_F32   patchCord6(earpieceMixer, earpieceMixer.LEFT, BTNRH_alg1, 0);
-AudioConnection_F32   patchCord7(BTNRH_alg1, 0, gain1, 0);
+#if USE_FUSED_GAIN
+  #define BTNRH_OUTPUT BTNRH_alg1   //the gain is applied within BTNRH_alg1, so skip the separate gain block
+#else
+  AudioConnection_F32   patchCord7(BTNRH_alg1, 0, gain1, 0);
+  #define BTNRH_OUTPUT gain1
+#endif
+#endif //USE_LOW_LATENCY
 
 //connect the BTNRH alg to the outputs
-AudioConnection_F32   patchCord11(gain1, 0, audio_out,  EarpieceShield::OUTPUT_LEFT_TYMPAN);    //Tympan AIC, left output
-AudioConnection_F32   patchCord12(gain1, 0, audio_out,  EarpieceShield::OUTPUT_RIGHT_TYMPAN);   //Tympan AIC, right output
-AudioConnection_F32   patchCord13(gain1, 0, audio_out,  EarpieceShield::OUTPUT_LEFT_EARPIECE);  //Shield AIC, left output
-AudioConnection_F32   patchCord14(gain1, 0, audio_out,  EarpieceShield::OUTPUT_RIGHT_EARPIECE); //Shield AIC, right output
+AudioConnection_F32   patchCord11(BTNRH_OUTPUT, 0, audio_out,  EarpieceShield::OUTPUT_LEFT_TYMPAN);    //Tympan AIC, left output
+AudioConnection_F32   patchCord12(BTNRH_OUTPUT, 0, audio_out,  EarpieceShield::OUTPUT_RIGHT_TYMPAN);   //Tympan AIC, right output
+AudioConnection_F32   patchCord13(BTNRH_OUTPUT, 0, audio_out,  EarpieceShield::OUTPUT_LEFT_EARPIECE);  //Shield AIC, left output
+AudioConnection_F32   patchCord14(BTNRH_OUTPUT, 0, audio_out,  EarpieceShield::OUTPUT_RIGHT_EARPIECE); //Shield AIC, right output
 
 //connect to the SD writer
+#if !USE_LOW_LATENCY
 AudioConnection_F32   patchCord21(earpieceMixer, earpieceMixer.LEFT, audioSDWriter,  0);  //left will be the raw input
-AudioConnection_F32   patchCord22(gain1,    0, audioSDWriter,  1);  //right will be the processed output
+AudioConnection_F32   patchCord22(BTNRH_OUTPUT,    0, audioSDWriter,  1);  //right will be the processed output
+#endif //USE_LOW_LATENCY
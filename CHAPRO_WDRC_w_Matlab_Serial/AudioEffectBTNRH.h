@@ -20,6 +20,7 @@
 // Algorithm-specific include files
 #include <chapro.h>
 #include "test_gha.h"            ////////////////////////////////////////// Update this for your CHAPRO Algorithm!!!!
+#include <CalibrationTable.h>    //mic sensitivity versus frequency (optional...see setMicCalibration()).  From Libraries/Tympan_CalibrationTable.
 
 
 class AudioEffectBTNRH_F32 : public AudioStream_F32
@@ -62,10 +63,16 @@ class AudioEffectBTNRH_F32 : public AudioStream_F32
 
     //enable different parts of the algorithm
     bool setEnabled(bool val = true) { return enabled = val; }  //overall enabled or not
+    bool getEnabled(void) { return enabled; }
     bool setAfcEnabled(bool _enable);
     bool getAfcEnabled(void) { int cur_mxl = get_cha_ivar(_mxl); if (cur_mxl > 0) { return true; } else { return false; } };
     int baselineVal_mxl = -1;
 
+    //Optionally, correct the compression kneepoints for the mic's frequency response.  The DSL's maxdB is taken to be the
+    //calibration at 1 kHz, so each channel's kneepoint is moved by how much the mic differs from its 1 kHz sensitivity
+    //at the channel's center frequency.  Call this before setup().  The table must stay around (it is not copied).
+    void setMicCalibration(CalibrationTable *table) { micCalTable = table; }
+
     //setup methods
     bool setup_complete = false;
     void setup(void)  { 
@@ -76,8 +83,13 @@ class AudioEffectBTNRH_F32 : public AudioStream_F32
       //memcpy(&agc_global, &local_agc, sizeof(CHA_WDRC)); //////////////////// Add or remove items based on *your* CHAPRO Algorithm!!!! 
       //prepared = local_prepared; //////////////////// Add or remove items based on *your* CHAPRO Algorithm!!!!  
 
+      //the globals are about to be overwritten, so save the state of whichever instance had them
+      AudioEffectBTNRH_F32* &owner = globalsOwner();
+      if ((owner != NULL) && (owner != this)) owner->saveGlobalsToLocal();
+
       //run the configure() and prepare() functions in the global space
       configure(&io);               //in test_gha.h
+      applyMicCalibration();        //adjusts dsl_global before the compressor is prepared from it
       prepare(&io, cp);             //in test_gha.h
 
       //copy global instances back to local instances for safe-keeping (not really needed for monural operation, but some day this will be important for binaural
@@ -85,6 +97,7 @@ class AudioEffectBTNRH_F32 : public AudioStream_F32
       memcpy(&local_dsl, &dsl_global, sizeof(CHA_DSL));  //////////////////// Add or remove items based on *your* CHAPRO Algorithm!!!! 
       memcpy(&local_agc, &agc_global, sizeof(CHA_WDRC)); //////////////////// Add or remove items based on *your* CHAPRO Algorithm!!!! 
       local_prepared = prepared; //////////////////// Add or remove items based on *your* CHAPRO Algorithm!!!!  
+      owner = this;  //the globals now hold this instance's state
       
       setup_complete = true;
     }    
@@ -97,21 +110,12 @@ class AudioEffectBTNRH_F32 : public AudioStream_F32
       float *x = audio_block->data;  //This is used input audio.  And, the output is written back in here, too
       int cs = audio_block->length;  //How many audio samples to process?
       
-      
-      //copy local copies to global instances before calling functions in the global scope
-      memcpy(&afc_global, &local_afc, sizeof(CHA_AFC));  //////////////////// Add or remove items based on *your* CHAPRO Algorithm!!!! 
-      memcpy(&dsl_global, &local_dsl, sizeof(CHA_DSL));  //////////////////// Add or remove items based on *your* CHAPRO Algorithm!!!! 
-      memcpy(&agc_global, &local_agc, sizeof(CHA_WDRC)); //////////////////// Add or remove items based on *your* CHAPRO Algorithm!!!! 
-      prepared = local_prepared; //////////////////// Add or remove items based on *your* CHAPRO Algorithm!!!!  
+      //load this instance's state into the global instances before calling functions in the global scope.  This
+      //only copies anything when a different instance used the globals last (see takeGlobals())
+      takeGlobals();
        
       //hopefully, this one line is all that needs to change to reflect what CHAPRO code you want to use
       process_chunk(cp, x, x, cs); //see test_gha.h  (or whatever test_xxxx.h is #included at the top)
-
-      //copy global instances back to local copies after completing the functions that are in the global scope
-      memcpy(&local_afc, &afc_global, sizeof(CHA_AFC));  //////////////////// Add or remove items based on *your* CHAPRO Algorithm!!!! 
-      memcpy(&local_dsl, &dsl_global, sizeof(CHA_DSL));  //////////////////// Add or remove items based on *your* CHAPRO Algorithm!!!! 
-      memcpy(&local_agc, &agc_global, sizeof(CHA_WDRC)); //////////////////// Add or remove items based on *your* CHAPRO Algorithm!!!! 
-      local_prepared = prepared; //////////////////// Add or remove items based on *your* CHAPRO Algorithm!!!! 
       
     } //end of applyMyAlgorithms
     // /////////// End of the signal processing code that references CHAPRO
@@ -140,15 +144,69 @@ class AudioEffectBTNRH_F32 : public AudioStream_F32
     }
 
     
+    //The local copies are only brought up to date when another instance takes the globals (see takeGlobals()), so call
+    //this before reading local_afc, local_dsl, or local_agc
+    void syncLocalCopies(void) {
+      AudioNoInterrupts();
+      if (globalsOwner() == this) saveGlobalsToLocal();
+      AudioInterrupts();
+    }
+
+  protected:
+    //CHAPRO works on global data structures, so only one instance's state can be in them at a time.  Rather than copying
+    //the local copies in and out around every audio block (about 3 kB per block), the globals are swapped only when a
+    //different instance needs them.  With one instance, that never happens after setup().
+    static AudioEffectBTNRH_F32* &globalsOwner(void) { static AudioEffectBTNRH_F32 *owner = NULL; return owner; }
+    void takeGlobals(void) {
+      AudioEffectBTNRH_F32* &owner = globalsOwner();
+      if (owner == this) return;           //already ours
+      if (owner != NULL) owner->saveGlobalsToLocal();
+      memcpy(&afc_global, &local_afc, sizeof(CHA_AFC));  //////////////////// Add or remove items based on *your* CHAPRO Algorithm!!!! 
+      memcpy(&dsl_global, &local_dsl, sizeof(CHA_DSL));  //////////////////// Add or remove items based on *your* CHAPRO Algorithm!!!! 
+      memcpy(&agc_global, &local_agc, sizeof(CHA_WDRC)); //////////////////// Add or remove items based on *your* CHAPRO Algorithm!!!! 
+      prepared = local_prepared; //////////////////// Add or remove items based on *your* CHAPRO Algorithm!!!!  
+      owner = this;
+    }
+    void saveGlobalsToLocal(void) {
+      memcpy(&local_afc, &afc_global, sizeof(CHA_AFC));  //////////////////// Add or remove items based on *your* CHAPRO Algorithm!!!! 
+      memcpy(&local_dsl, &dsl_global, sizeof(CHA_DSL));  //////////////////// Add or remove items based on *your* CHAPRO Algorithm!!!! 
+      memcpy(&local_agc, &agc_global, sizeof(CHA_WDRC)); //////////////////// Add or remove items based on *your* CHAPRO Algorithm!!!! 
+      local_prepared = prepared; //////////////////// Add or remove items based on *your* CHAPRO Algorithm!!!! 
+    }
+
   private:
     //state-related variables
     audio_block_f32_t *inputQueueArray_f32[1]; //memory pointer for the input to this module
     bool enabled = false;
+    CalibrationTable *micCalTable = NULL;
+
+    //Lower each channel's kneepoint (tk) by the dB that the mic reads low at that channel's center frequency.  The center
+    //is the geometric mean of the channel's crossover frequencies, with the outer channels extending a half-octave past
+    //the outer crossovers.  The output limit (bolt) is about the output, not the mic, so it is not changed.
+    void applyMicCalibration(void) {
+      if ((micCalTable == NULL) || micCalTable->isEmpty()) return;
+      int nc = dsl_global.nchannel;
+      if ((nc < 1) || (nc > DSL_MXCH)) return;
+      float center_Hz[DSL_MXCH], corr_dB[DSL_MXCH];
+      for (int k=0; k < nc; k++) {
+        if (nc == 1) { center_Hz[k] = 1000.0f; continue; }
+        double low_Hz = (k == 0) ? (dsl_global.cross_freq[0] / 2.0) : dsl_global.cross_freq[k-1];
+        double high_Hz = (k == nc-1) ? (dsl_global.cross_freq[nc-2] * 2.0) : dsl_global.cross_freq[k];
+        center_Hz[k] = (float)sqrt(low_Hz * high_Hz);
+      }
+      micCalTable->fillBandCorrections_dB(center_Hz, nc, 1000.0f, corr_dB);
+      Serial.println("AudioEffectBTNRH: applyMicCalibration: Freq (Hz), Correction (dB), New Kneepoint (dB SPL):");
+      for (int k=0; k < nc; k++) {
+        dsl_global.tk[k] -= corr_dB[k];
+        Serial.println("    " + String(center_Hz[k],0) + ", " + String(corr_dB[k],2) + ", " + String(dsl_global.tk[k],1));
+      }
+    }
 
 }; //end class definition for AudioEffectBTNRH
 
 //methods to print AFC parameters
 void AudioEffectBTNRH_F32::print_dsl_params(void) {
+  syncLocalCopies();
   Serial.println("local_dsl: attack = " + String(local_dsl.attack));
   Serial.println("local_dsl: release = "+ String(local_dsl.release));
   Serial.println("local_dsl: maxdB = " + String(local_dsl.maxdB));
@@ -0,0 +1,105 @@
+/*
+   AudioEffectBTNRH_LowLatency_F32
+
+   Purpose: AudioEffectBTNRH_F32 set up to run as the only processing node between the I2S input and the I2S output,
+            so that the audio blocks can be very small (1-4 samples).  The latency from the I2S buffering is 2 blocks,
+            so small blocks are what cut the latency, but every block costs a trip through the audio library's
+            update() machinery for every node in the path.  To keep that affordable at small blocks:
+
+              * The output gain (formerly its own AudioEffectGain_F32 node) is applied here.
+              * With USE_LOW_LATENCY (see the main *.ino), the input comes straight from the I2S input (the left front
+                PDM mic) and goes straight to the I2S outputs.  The earpiece mixer and the SD writer are not in the path.
+              * The CHAPRO state is not copied in and out of the CHAPRO globals around every block (see
+                AudioEffectBTNRH_F32::takeGlobals()), which was about 3 kB of copying per block.
+
+            The block size is "chunk" in test_gha.h, which can be set by defining CHAPRO_CHUNK.  The AFC's hdel follows
+            from it.  The input-to-output latency is measured by running an impulse through this class in a simulated
+            loopback (see HostSim/simLowLatencyLoopback.cpp), and printLatencyReport() gives the same sum.
+
+   MIT License.  use at your own risk.
+*/
+
+#ifndef _AudioEffectBTNRH_LowLatency_F32_h
+#define _AudioEffectBTNRH_LowLatency_F32_h
+
+#include <Arduino.h>
+#include "AudioStream_F32.h"
+#include "AudioEffectBTNRH.h"
+
+//Tympan hardware delay (samples) through the AIC's ADC and DAC filters.  Same as used for "hdel" in test_gha.h.
+#define TYMPAN_AIC_HARDWARE_DELAY_SAMPS 38
+
+class AudioEffectBTNRH_LowLatency_F32 : public AudioEffectBTNRH_F32
+{
+  public:
+    //constructor
+    AudioEffectBTNRH_LowLatency_F32(const AudioSettings_F32 &settings) : AudioEffectBTNRH_F32(settings) {
+      sample_rate_Hz = settings.sample_rate_Hz;
+      audio_block_samples = settings.audio_block_samples;
+    };
+
+    //the gain that used to be applied by a separate AudioEffectGain_F32
+    float setGain_dB(float gain_dB) { gain_linear = powf(10.0f, gain_dB / 20.0f); return cur_gain_dB = gain_dB; }
+    float getGain_dB(void) { return cur_gain_dB; }
+
+    //here's the method that is called automatically by the Teensy Audio Library for every audio block
+    void update(void)
+    {
+      if (!getEnabled()) return;
+
+      audio_block_f32_t *audio_block = AudioStream_F32::receiveWritable_f32();
+      if (!audio_block) return;
+      last_block_length = audio_block->length;  //what the AFC actually sees (see printLatencyReport())
+
+      //run CHAPRO (the globals are only swapped if there is another instance...see takeGlobals())
+      applyMyAlgorithm(audio_block);
+
+      //apply the output gain
+      if (gain_linear != 1.0f) {
+        float *x = audio_block->data;
+        for (int i = 0; i < audio_block->length; i++) x[i] *= gain_linear;
+      }
+
+      AudioStream_F32::transmit(audio_block);
+      AudioStream_F32::release(audio_block);
+    }
+
+    //components of the input-to-output latency (samples).  HostSim/simLowLatencyLoopback.cpp measures the total.
+    int getHardwareLatency_samples(void) { return TYMPAN_AIC_HARDWARE_DELAY_SAMPS; }
+    int getBufferingLatency_samples(void) { return 2 * audio_block_samples; }  //a block is captured, then waits for the block being played
+    int getFilterbankLatency_samples(void) { syncLocalCopies(); return (int)(0.001f * ((float)local_agc.td) * sample_rate_Hz + 0.5f); } //CHAPRO designs the IIR filterbank to have a delay of td (msec)
+    int getLatency_samples(void) { return getHardwareLatency_samples() + getBufferingLatency_samples() + getFilterbankLatency_samples(); }
+
+    //print the latency.  Also check the AFC's hdel, which test_gha.h computes from "chunk", against the length of
+    //the blocks that have actually reached update().  They differ if the audio settings don't use chunk as the block size.
+    void printLatencyReport(void) {
+      Serial.println("AudioEffectBTNRH_LowLatency: Input-to-Output Latency:");
+      Serial.println("    : AIC ADC+DAC hardware = " + String(getHardwareLatency_samples()) + " samples");
+      Serial.println("    : I2S buffering (2 x " + String(audio_block_samples) + ") = " + String(getBufferingLatency_samples()) + " samples");
+      Serial.println("    : IIR filterbank (td = " + String(local_agc.td, 2) + " msec) = " + String(getFilterbankLatency_samples()) + " samples");
+      int n = getLatency_samples();
+      Serial.println("    : Total = " + String(n) + " samples = " + String(1000.0f * ((float)n) / sample_rate_Hz, 2) + " msec");
+
+      int hdel = get_cha_ivar(_hdel);
+      Serial.print("    : AFC hdel = " + String(hdel) + " samples");
+      if (last_block_length <= 0) {
+        Serial.println(" (no audio blocks yet, so it can't be checked)");
+      } else {
+        int expected_hdel = getHardwareLatency_samples() + 2 * last_block_length;
+        if (hdel == expected_hdel) {
+          Serial.println(" (OK for the " + String(last_block_length) + " sample blocks)");
+        } else {
+          Serial.println(" *** WARNING ***: the blocks are " + String(last_block_length) + " samples, so expected " + String(expected_hdel));
+        }
+      }
+    }
+
+  protected:
+    float sample_rate_Hz = 24000.0f;
+    int audio_block_samples = 8;
+    volatile int last_block_length = 0;
+    float gain_linear = 1.0f, cur_gain_dB = 0.0f;
+
+}; //end class definition for AudioEffectBTNRH_LowLatency_F32
+
+#endif
@@ -12,6 +12,13 @@
 */
 
 
+//Choose the low-latency path: 2-sample audio blocks, with only audio_in -> BTNRH_alg1 -> audio_out (no mixing of the
+//earpiece mics and no SD recording).  See AudioEffectBTNRH_LowLatency.h.  Set to 0 for the full path with 8-sample blocks.
+#define USE_LOW_LATENCY 0
+#if USE_LOW_LATENCY
+  #define CHAPRO_CHUNK 2     //audio block size (samples).  1-4 are supported.  Used by test_gha.h, which also sets the AFC's hdel from it
+#endif
+
 //Include Arduino/Tympan related libraries
 #include <Arduino.h>
 #include <Tympan_Library.h>
@@ -20,6 +27,12 @@
 //Include algorithm-specific files
 #include "test_gha.h"          //see the tab "test_gha.h"..........be sure to update the name if you change the filename!
 #include "AudioEffectBTNRH.h"  //see the tab "AudioEffectBTNRH.h"
+#include "AudioEffectBTNRH_LowLatency.h"  //see the tab "AudioEffectBTNRH_LowLatency.h"
+#if USE_LOW_LATENCY
+  #define USE_FUSED_GAIN 1       //the low-latency path always applies the gain inside BTNRH_alg1
+#else
+  #define USE_FUSED_GAIN 1       //set to 1 to apply the gain inside BTNRH_alg1 (fewer audio nodes).  Set to 0 to use the separate gain block
+#endif
  
 // ///////////////////////////////////////// setup the audio processing classes and connections
 
@@ -35,6 +48,10 @@ EarpieceShield   earpieceShield(TympanRev::E, AICShieldRev::A);  //Note that Ear
 // Create the audio connections
 #include "AudioConnections.h"
 
+// The mic's sensitivity versus frequency (if it has been measured and saved to the SD card)
+CalibrationTable micCalTable;
+#define CAL_TABLE_FNAME "CALTABLE.BIN"
+
 // Create classes for controlling the system
 #include      "SerialManager.h"
 #include      "State.h"                            
@@ -55,8 +72,17 @@ void setupSerialManager(void) {
   serialManager.add_UI_element(&audioSDWriter);
 }
 
+//set the gain without remembering it in myState (such as for muting)
+float applyDigitalGain_dB(float val_dB) {
+  #if USE_FUSED_GAIN
+    return BTNRH_alg1.setGain_dB(val_dB);
+  #else
+    return gain1.setGain_dB(val_dB);
+  #endif
+}
+
 float setDigitalGain_dB(float val_dB) {
-    return myState.digital_gain_dB = gain1.setGain_dB(val_dB);
+    return myState.digital_gain_dB = applyDigitalGain_dB(val_dB);
 }
 
 float setOutputGain_dB(float gain_dB) {  
@@ -81,8 +107,17 @@ void setup() { //this runs once at startup
 
   // /////////////////////////////////////////////  do any setup of the algorithms
 
+  //if the mic's calibration table is on the SD card (see CalibraitonViaExternalMic), correct the kneepoints with it
+  if (sd.begin(SdioConfig(FIFO_SDIO)) && micCalTable.load(&sd, CAL_TABLE_FNAME)) {
+    myTympan.println("setup: loaded " + String(micCalTable.getNPoints()) + " points of mic calibration from " + String(CAL_TABLE_FNAME));
+    BTNRH_alg1.setMicCalibration(&micCalTable);
+  } else {
+    myTympan.println("setup: no mic calibration (" + String(CAL_TABLE_FNAME) + ") on the SD card.  Kneepoints are not corrected.");
+  }
+
   BTNRH_alg1.setup();           //in AudioEffectBTNRH.h
   BTNRH_alg1.setEnabled(true);  //see AudioEffectBTNRH.h.  This could be done later in setup()
+  BTNRH_alg1.printLatencyReport(); //see AudioEffectBTNRH_LowLatency.h
  
   // //////////////////////////////////////////// End setup of the algorithms
 
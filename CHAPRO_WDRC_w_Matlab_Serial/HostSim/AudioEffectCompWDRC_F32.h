@@ -0,0 +1 @@
+// Host (PC) stand-in: GHA_Constants.h includes AudioEffectCompWDRC_F32.h, but nothing in it is used.
@@ -0,0 +1,16 @@
+#ifndef _HostSim_BTNRH_WDRC_Types_h
+#define _HostSim_BTNRH_WDRC_Types_h
+
+// Host (PC) stand-in for the Tympan_Library's BTNRH_WDRC_Types.h.  Only the AFC settings that GHA_Constants.h fills in.
+
+namespace BTNRH_WDRC {
+  struct CHA_AFC {
+    int default_to_active;  //enable AFC at startup?
+    int afl;                //length (samples) of adaptive filter
+    float mu;               //how fast the adaptive filter adapts
+    float rho;              //smoothing of the audio's envelope
+    float eps;              //minimum allowed envelope
+  };
+}
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef _HostSim_SdFat_h
+#define _HostSim_SdFat_h
+
+// Host (PC) stand-in for the SD card.  Nothing is saved or loaded.
+
+#include <cstddef>
+#define O_RDONLY 0
+#define O_WRONLY 1
+#define O_CREAT  2
+#define O_TRUNC  4
+struct SdFs {};
+struct FsFile {
+  bool open(SdFs *, const char *, int) { return false; }
+  size_t write(const void *, size_t) { return 0; }
+  int read(void *, size_t) { return 0; }
+  void close(void) {}
+};
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef _HostSim_Tympan_Library_h
+#define _HostSim_Tympan_Library_h
+
+// Host (PC) stand-ins for the few Tympan_Library and Arduino pieces that AudioEffectBTNRH.h and
+// AudioEffectBTNRH_LowLatency.h use, so that the real classes can be run in a simulated loopback (see
+// simLowLatencyLoopback.cpp).  The audio objects are run by hand, not by an audio interrupt.
+
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <algorithm>
+using std::min; using std::max;
+
+#define AUDIO_BLOCK_SAMPLES 128
+
+//Arduino's String, enough for building up the messages that get printed
+struct String : std::string {
+  String(void) {}
+  String(const char *s) : std::string(s) {}
+  String(const std::string &s) : std::string(s) {}
+  String(char c) : std::string(1, c) {}
+  String(int val) : std::string(std::to_string(val)) {}
+  String(double val, int n_dec = 2) { char buff[64]; snprintf(buff, sizeof(buff), "%.*f", n_dec, val); assign(buff); }
+};
+inline String operator+(const String &a, const String &b) { return String(std::string(a) + std::string(b)); }
+inline String operator+(const char *a, const String &b) { return String(std::string(a) + std::string(b)); }
+inline String operator+(const String &a, const char *b) { return String(std::string(a) + std::string(b)); }
+
+//the serial monitor.  Set quiet to hide the classes' own printing.
+struct HostSerial {
+  bool quiet = false;
+  void print(const String &s) { if (!quiet) fputs(s.c_str(), stdout); }
+  void print(double val, int n_dec = 2) { if (!quiet) printf("%.*f", n_dec, val); }
+  void println(const String &s) { if (!quiet) puts(s.c_str()); }
+  void println(double val, int n_dec = 2) { if (!quiet) printf("%.*f\n", n_dec, val); }
+  void println(void) { if (!quiet) puts(""); }
+};
+static HostSerial Serial;
+
+inline unsigned long millis(void) { return 0; }
+inline void AudioNoInterrupts(void) {}
+inline void AudioInterrupts(void) {}
+
+struct AudioSettings_F32 {
+  AudioSettings_F32(float fs, int n) : sample_rate_Hz(fs), audio_block_samples(n) {}
+  float sample_rate_Hz;
+  int audio_block_samples;
+};
+struct audio_block_f32_t { float data[AUDIO_BLOCK_SAMPLES]; int length = AUDIO_BLOCK_SAMPLES; unsigned long id = 0; };
+
+//no audio memory or connections: the input is set by hand and the block is processed in place
+class AudioStream_F32 {
+  public:
+    AudioStream_F32(int n_inputs, audio_block_f32_t **_inputs) : inputs(_inputs) { for (int i = 0; i < n_inputs; i++) inputs[i] = NULL; }
+    virtual ~AudioStream_F32(void) {}
+    virtual void update(void) = 0;
+    void setInput(int i, audio_block_f32_t *block) { inputs[i] = block; }
+  protected:
+    audio_block_f32_t **inputs;
+    audio_block_f32_t *receiveWritable_f32(int i = 0) { audio_block_f32_t *b = inputs[i]; inputs[i] = NULL; return b; }
+    void transmit(audio_block_f32_t *) {}
+    static void release(audio_block_f32_t *) {}
+};
+
+//only what AudioEffectBTNRH.h calls (nothing is sent)
+class BLE_UI {
+  public:
+    int sendMessage(const String &s) { return (int)s.length(); }
+};
+
+#endif
@@ -0,0 +1,171 @@
+#ifndef CHAPRO_H
+#define CHAPRO_H
+
+// Host (PC) stand-in for CHAPRO (BTNRH's chapro.h and its library, which are not in this repo), for
+// simLowLatencyLoopback.cpp.  The data structures, the pointer/variable indices, and the functions called by test_gha.h
+// and AudioEffectBTNRH.h are the same as CHAPRO's.  The processing is NOT CHAPRO's:
+//
+//   * the IIR filterbank is a pure delay of td (msec), which is the delay that cha_iirfb_design() designs its filters to
+//     have, and it puts everything into channel 0;
+//   * the AGC has unity gain; and
+//   * the AFC's feedback estimate is zero (as it is before it has adapted).
+//
+// So, the loopback measures the latency of the blocks, the buffering, and the class that runs CHAPRO, with the
+// filterbank's designed delay standing in for the filterbank.  Like CHAPRO, all of the state is in cp[], so that each
+// instance has its own.
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+#define NPTR 64
+#define NVAR 32
+#define CHA_IVAR ((int *)cp[_ivar])
+#define CHA_DVAR ((double *)cp[_dvar])
+#define CHA_CB ((float *)cp[_cc])
+
+typedef void **CHA_PTR;
+
+typedef struct {
+  double fbg;     // simulated-feedback gain
+  double rho;     // forgetting factor
+  double eps;     // power threshold
+  double mu;      // step size
+  double alf;     // band-limit update
+  int32_t afl;    // adaptive-filter length
+  int32_t wfl;    // whiten-filter length
+  int32_t pfl;    // band-limit-filter length
+  int32_t fbl;    // simulated-feedback length
+  int32_t hdel;   // output/input hardware delay
+  int32_t pup;    // band-limit update period
+  float *efbp;    // estimated-feedback buffer pointer
+  float *sfbp;    // simulated-feedback buffer pointer
+  float *wfrp;    // whiten-feedback buffer pointer
+  float *ffrp;    // persistent-feedback buffer pointer
+  float *qm;      // quality-metric buffer pointer
+  int32_t *iqmp;  // quality-metric index pointer
+  int32_t nqm;    // quality-metric buffer size
+  int32_t iqm;    // quality-metric index
+  int32_t sqm;    // save quality metric ?
+  CHA_PTR pcp;    // previous CHA_PTR
+} CHA_AFC;
+
+#define DSL_MXCH 32 // maximum number of channels
+typedef struct {
+  double attack;               // attack time (ms)
+  double release;              // release time (ms)
+  double maxdB;                // maximum signal (dB SPL)
+  int32_t ear;                 // 0=left, 1=right
+  int32_t nchannel;            // number of channels
+  double cross_freq[DSL_MXCH]; // cross frequencies (Hz)
+  double tkgain[DSL_MXCH];     // compression-start gain
+  double cr[DSL_MXCH];         // compression ratio
+  double tk[DSL_MXCH];         // compression-start kneepoint
+  double bolt[DSL_MXCH];       // broadband output limiting threshold
+} CHA_DSL;
+
+typedef struct {
+  double attack;  // attack time (ms)
+  double release; // release time (ms)
+  double fs;      // sampling rate (Hz)
+  double maxdB;   // maximum signal (dB SPL)
+  double tkgain;  // compression-start gain
+  double tk;      // compression-start kneepoint
+  double cr;      // compression ratio
+  double bolt;    // broadband output limiting threshold
+  double td;      // target delay
+  int32_t nz;     // filter order
+  int32_t nw;     // window size
+  int32_t wt;     // window type: 0=Hamming, 1=Blackman
+} CHA_WDRC;
+
+// global pointer indices
+#define _ivar 1
+#define _dvar 2
+#define _cc 3
+#define _offset 4
+#define _yd _offset + 4    // (iir) the stand-in filterbank's delay line
+#define _efbp _offset + 32
+// integer variable indices
+#define _cs 0
+#define _nc 1
+#define _nn 3              // (iir) the stand-in filterbank's delay (samples)
+#define _nw 4              // (iir) the stand-in filterbank's delay-line index
+#define _afl 7
+#define _fbl 8
+#define _wfl 10
+#define _pfl 11
+#define _mxl 12
+#define _in1 13
+#define _pup 17
+#define _hdel 26
+// double variable indices
+#define _fs 0
+#define _alfa 1
+#define _beta 2
+#define _mxdb 3
+#define _tkgn 4
+#define _tk 5
+#define _cr 6
+#define _bolt 7
+#define _mu 10
+#define _rho 11
+#define _eps 12
+#define _alf 13
+#define _fbm 15
+
+static void cha_hostsim_vars(CHA_PTR cp) {
+  if (cp[_ivar] == NULL) cp[_ivar] = calloc(NVAR, sizeof(int));
+  if (cp[_dvar] == NULL) cp[_dvar] = calloc(NVAR, sizeof(double));
+}
+
+// iirfb: a pure delay of td
+static int cha_iirfb_design(float *, float *, float *, int *d, double *, int nc, int, double sr, double td) {
+  for (int k = 0; k < nc; k++) d[k] = (int)floor(td * sr / 1000.0 + 0.5);
+  return 0;
+}
+static int cha_iirfb_prepare(CHA_PTR cp, float *, float *, float *, int *d, int nc, int, double sr, int cs) {
+  cha_hostsim_vars(cp);
+  CHA_IVAR[_cs] = cs;  CHA_IVAR[_nc] = nc;  CHA_IVAR[_nn] = d[0];  CHA_IVAR[_nw] = 0;  CHA_DVAR[_fs] = sr / 1000.0;
+  cp[_cc] = calloc(2 * nc * cs, sizeof(float));
+  cp[_yd] = calloc(d[0] + 1, sizeof(float));
+  return 0;
+}
+static void cha_iirfb_analyze(CHA_PTR cp, float *x, float *z, int cs) {
+  int nc = CHA_IVAR[_nc], n = CHA_IVAR[_nn] + 1, ind = CHA_IVAR[_nw];
+  float *ring = (float *)cp[_yd];
+  for (int i = 0; i < cs; i++) {
+    ring[ind] = x[i];
+    ind = (ind + 1) % n;
+    z[i] = ring[ind];  //written n-1 samples ago
+    for (int k = 1; k < nc; k++) z[k * cs + i] = 0.0f;
+  }
+  CHA_IVAR[_nw] = ind;
+}
+static void cha_iirfb_synthesize(CHA_PTR cp, float *z, float *y, int cs) {
+  int nc = CHA_IVAR[_nc];
+  for (int i = 0; i < cs; i++) { float sum = 0.0f;  for (int k = 0; k < nc; k++) sum += z[k * cs + i];  y[i] = sum; }
+}
+
+// agc: unity gain
+static void cha_agc_prepare(CHA_PTR cp, CHA_DSL *, CHA_WDRC *agc) {
+  cha_hostsim_vars(cp);
+  CHA_DVAR[_mxdb] = agc->maxdB;  CHA_DVAR[_tkgn] = agc->tkgain;  CHA_DVAR[_tk] = agc->tk;  CHA_DVAR[_cr] = agc->cr;  CHA_DVAR[_bolt] = agc->bolt;
+}
+static void cha_agc_input(CHA_PTR, float *x, float *y, int cs) { if (x != y) memcpy(y, x, cs * sizeof(float)); }
+static void cha_agc_channel(CHA_PTR cp, float *x, float *y, int cs) { if (x != y) memcpy(y, x, CHA_IVAR[_nc] * cs * sizeof(float)); }
+static void cha_agc_output(CHA_PTR, float *x, float *y, int cs) { if (x != y) memcpy(y, x, cs * sizeof(float)); }
+
+// afc: the feedback estimate (efbp) stays zero
+static void cha_afc_prepare(CHA_PTR cp, CHA_AFC *afc) {
+  cha_hostsim_vars(cp);
+  CHA_IVAR[_afl] = afc->afl;  CHA_IVAR[_wfl] = afc->wfl;  CHA_IVAR[_pfl] = afc->pfl;  CHA_IVAR[_fbl] = afc->fbl;
+  CHA_IVAR[_hdel] = afc->hdel;  CHA_IVAR[_mxl] = afc->afl;  CHA_IVAR[_pup] = afc->pup;
+  CHA_DVAR[_mu] = afc->mu;  CHA_DVAR[_rho] = afc->rho;  CHA_DVAR[_eps] = afc->eps;  CHA_DVAR[_alf] = afc->alf;
+  cp[_efbp] = calloc(afc->afl + 1, sizeof(float));
+}
+static void cha_afc_input(CHA_PTR, float *x, float *y, int cs) { if (x != y) memcpy(y, x, cs * sizeof(float)); }
+static void cha_afc_output(CHA_PTR, float *, int) {}
+
+#endif
@@ -0,0 +1,175 @@
+// simLowLatencyLoopback: measure the input-to-output latency of the hearing-aid path by running an impulse through the
+// real AudioEffectBTNRH_LowLatency_F32 (and AudioEffectBTNRH_F32 and test_gha.h) in a simulated loopback of the Tympan's
+// audio hardware:
+//
+//    impulse -> ADC (17 samples) -> I2S input DMA (blocks of "chunk") -> BTNRH_alg1.update() -> I2S output DMA
+//            -> DAC (21 samples) -> output
+//
+// The DMA is double buffered, like the Tympan's: a block is handed to update() when it has been captured, and its
+// output is written into the half of the output buffer that is not playing, which starts playing one block later.  The
+// ADC and DAC delays are the 17 + 21 samples given in test_gha.h.  CHAPRO itself is a stand-in (see chapro.h in this
+// folder) whose filterbank is a pure delay of its designed delay, td.
+//
+// It also measures:
+//   * the delay from the algorithm's output back to its input (what the AFC's hdel must be), by closing the loop (the
+//     output is fed back into the input) and timing the echoes, and
+//   * what AudioEffectBTNRH_F32 now saves per block by not copying the CHAPRO state around every block, and that two
+//     instances still keep their own state.
+//
+// To build and run (from this folder), for each block size:
+//     for n in 1 2 4 8; do g++ -std=gnu++17 -O2 -I. -I../../Libraries/Tympan_CalibrationTable/src -DCHAPRO_CHUNK=$n simLowLatencyLoopback.cpp -o simLowLatencyLoopback && ./simLowLatencyLoopback; done
+
+#include <Tympan_Library.h>
+#include <vector>
+#include <chrono>
+#include "../AudioEffectBTNRH_LowLatency.h"
+
+const int ADC_DELAY = 17, DAC_DELAY = 21;  //see "hdel" in test_gha.h
+
+//the Tympan's audio path, run one sample at a time
+class SimLoopback {
+  public:
+    SimLoopback(AudioEffectBTNRH_LowLatency_F32 *_alg, int _block) : alg(_alg), block(_block), adc(ADC_DELAY + 1, 0.0f), dac(DAC_DELAY + 1, 0.0f) {
+      for (int h = 0; h < 2; h++) for (int i = 0; i < block; i++) tx[h][i] = 0.0f;
+    }
+
+    //one sample in, one sample out
+    float step(float x) {
+      //ADC
+      adc[n % adc.size()] = x;
+      float x_adc = adc[(n + 1) % adc.size()];
+
+      //I2S input: once a block has been captured, the output DMA moves on to the other half, and the block is processed
+      //into the half that just finished playing.  Then capture this sample.
+      if (n_rx == block) {
+        playing = 1 - playing;  play_ind = 0;
+        rx.length = block;
+        alg->setInput(0, &rx);
+        alg->update();  //in place
+        for (int i = 0; i < block; i++) tx[1 - playing][i] = rx.data[i];
+        n_rx = 0;
+      }
+      rx.data[n_rx++] = x_adc;
+
+      //I2S output: play
+      float y_dac = tx[playing][play_ind++];
+
+      //DAC
+      dac[n % dac.size()] = y_dac;
+      float y = dac[(n + 1) % dac.size()];
+      n++;
+      return y;
+    }
+
+  protected:
+    AudioEffectBTNRH_LowLatency_F32 *alg;
+    int block;
+    std::vector<float> adc, dac;
+    audio_block_f32_t rx;
+    float tx[2][AUDIO_BLOCK_SAMPLES];
+    int n_rx = 0, playing = 0, play_ind = 0;
+    long n = 0;
+};
+
+//index of the biggest sample in y after start
+int findPeak(const std::vector<float> &y, int start) {
+  int ind = start;
+  for (int i = start; i < (int)y.size(); i++) if (fabsf(y[i]) > fabsf(y[ind])) ind = i;
+  return ind;
+}
+
+int main(void) {
+  const float fs_Hz = (float)srate;  //from test_gha.h
+  const int block = chunk;           //from test_gha.h
+  AudioSettings_F32 settings(fs_Hz, block);
+  printf("simLowLatencyLoopback: fs = %.0f Hz, chunk = audio block = %d samples\n", fs_Hz, block);
+
+  //latency: an impulse at several phases within a block
+  int min_lat = 1000000, max_lat = 0, predicted = 0, hdel = 0;
+  for (int phase = 0; phase < block; phase++) {
+    AudioEffectBTNRH_LowLatency_F32 BTNRH_alg1(settings);  //like the sketch, except one per run
+    Serial.quiet = true;
+    FILE *keep = stdout; stdout = fopen("/dev/null", "w");  //test_gha.h printf()s while preparing
+    BTNRH_alg1.setup();
+    fclose(stdout); stdout = keep;
+    BTNRH_alg1.setEnabled(true);
+
+    SimLoopback loop(&BTNRH_alg1, block);
+    const int t0 = 1000 + phase, N = 2000;
+    std::vector<float> y(N);
+    for (int t = 0; t < N; t++) y[t] = loop.step((t == t0) ? 1.0f : 0.0f);
+    int lat = findPeak(y, t0) - t0;
+    min_lat = min(min_lat, lat);  max_lat = max(max_lat, lat);
+    predicted = BTNRH_alg1.getLatency_samples();
+    hdel = BTNRH_alg1.get_cha_ivar(_hdel);
+  }
+  printf("    measured latency (impulse at each of the %d phases within a block): %d to %d samples = %.3f msec\n",
+    block, min_lat, max_lat, 1000.0f * (float)max_lat / fs_Hz);
+  printf("        of which ADC + DAC = %d, filterbank (td) = %d, so the blocks add %d samples (2 x %d)\n", ADC_DELAY + DAC_DELAY,
+    predicted - (ADC_DELAY + DAC_DELAY) - 2 * block, max_lat - (predicted - 2 * block), block);
+  printf("    printLatencyReport() / getLatency_samples() says %d samples\n", predicted);
+  bool pass = (min_lat == max_lat) && (max_lat == predicted);
+
+  //hdel: close the loop (the output goes back into the input at half gain, one sample later), so each echo comes one trip
+  //around later
+  {
+    AudioEffectBTNRH_LowLatency_F32 BTNRH_alg1(settings);
+    FILE *keep = stdout; stdout = fopen("/dev/null", "w");
+    BTNRH_alg1.setup();
+    fclose(stdout); stdout = keep;
+    BTNRH_alg1.setEnabled(true);
+    SimLoopback loop(&BTNRH_alg1, block);
+    const int t0 = 1000, N = 3000;
+    std::vector<float> y(N);
+    float y_prev = 0.0f;
+    for (int t = 0; t < N; t++) y_prev = y[t] = loop.step(((t == t0) ? 1.0f : 0.0f) + 0.5f * y_prev);
+    int p1 = findPeak(y, t0), p2 = findPeak(y, p1 + 1);
+    int trip = p2 - p1 - 1, fb_delay = BTNRH_alg1.getFilterbankLatency_samples();  //minus the one sample of the feedback wire
+    printf("    closed loop: echoes every %d samples, minus 1 for the feedback wire and %d for the filterbank = %d samples from the algorithm's output to its input\n",
+      p2 - p1, fb_delay, trip - fb_delay);
+    printf("    AFC hdel (38 + 2*chunk, from test_gha.h) = %d samples: %s\n", hdel, (hdel == trip - fb_delay) ? "matches" : "*** DOES NOT MATCH ***");
+    pass = pass && (hdel == trip - fb_delay);
+  }
+
+  //what the class no longer copies per block, and two instances keeping their own state
+  {
+    FILE *keep = stdout; stdout = fopen("/dev/null", "w");
+    AudioEffectBTNRH_LowLatency_F32 algA(settings), algB(settings);
+    algA.setup();  algB.setup();
+    fclose(stdout); stdout = keep;
+    algA.setEnabled(true);  algB.setEnabled(true);
+    int bytes = 2 * (int)(sizeof(CHA_AFC) + sizeof(CHA_DSL) + sizeof(CHA_WDRC));
+    printf("    CHAPRO state copied in and out per block before: %d bytes (%.1f MB/sec at this block size)\n", bytes,
+      (float)bytes * fs_Hz / (float)block / 1.0e6f);
+
+    //time one instance (nothing copied) and two alternating instances (everything copied every block, as before)
+    const int n_blocks = 2000000 / block;
+    audio_block_f32_t blk;  blk.length = block;
+    for (int i = 0; i < block; i++) blk.data[i] = 0.001f * (float)i;
+    auto time_it = [&](bool alternate) {
+      auto t_start = std::chrono::steady_clock::now();
+      for (int Iblock = 0; Iblock < n_blocks; Iblock++) {
+        AudioEffectBTNRH_LowLatency_F32 &a = (alternate && (Iblock & 1)) ? algB : algA;
+        a.setInput(0, &blk);  a.update();
+      }
+      return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t_start).count() / (double)n_blocks;
+    };
+    double ns_one = time_it(false), ns_two = time_it(true);
+    printf("    host time per update(): %.0f ns with one instance, %.0f ns when two instances alternate (the globals are swapped)\n", ns_one, ns_two);
+
+    //each instance keeps its own settings through the swapping
+    algA.local_dsl.tk[0] = 40.0;  algA.syncLocalCopies();  //A isn't the owner, so this keeps A's change
+    blk.length = block;
+    algA.setInput(0, &blk);  algA.update();
+    bool ok = (dsl_global.tk[0] == 40.0);
+    algB.setInput(0, &blk);  algB.update();
+    ok = ok && (dsl_global.tk[0] == algB.local_dsl.tk[0]) && (algA.local_dsl.tk[0] == 40.0) && (algB.local_dsl.tk[0] != 40.0);
+    algB.local_dsl.tk[0] = 0.0;  algB.syncLocalCopies();  //B is the owner, so this brings B's copy back up to date from the globals
+    ok = ok && (algB.local_dsl.tk[0] == dsl_global.tk[0]);
+    printf("    two instances keep their own CHAPRO settings through the swapping: %s\n", ok ? "yes" : "*** NO ***");
+    pass = pass && ok;
+  }
+
+  printf("%s\n", pass ? "PASS" : "*** FAIL ***");
+  return pass ? 0 : 1;
+}
@@ -4,6 +4,7 @@
 
 #include <Tympan_Library.h>
 #include "AudioEffectBTNRH.h"
+#include "AudioEffectBTNRH_LowLatency.h"
 #include "State.h"
 
 
@@ -13,9 +14,10 @@ extern Tympan myTympan;                    //created in the main *.ino file
 extern State myState;                      //created in the main *.ino file
 extern EarpieceMixer_F32_UI earpieceMixer; //created in the main *.ino file
 extern AudioSDWriter_F32_UI audioSDWriter;
-extern AudioEffectBTNRH_F32 BTNRH_alg1; //, BTNRH_alg2;
+extern AudioEffectBTNRH_LowLatency_F32 BTNRH_alg1; //, BTNRH_alg2;
 extern AudioEffectGain_F32 gain1;
 extern float setDigitalGain_dB(float);
+extern float applyDigitalGain_dB(float);
 
 //
 // The purpose of this class is to be a central place to handle all of the interactions
@@ -144,8 +146,9 @@ void SerialManager::printHelp(void) {
   Serial.println("   d: Print DSL settings.");
   Serial.println("   g: Print AGC settings.");   
   Serial.println("   s: print AFC settings.");
+  Serial.println("   l: print input-to-output latency.");
   Serial.println(" Overall Gain: (no prefix)");
-  Serial.println("   k/K: incr/decrease gain (current: " + String(gain1.getGain_dB(),1) + " dB)");
+  Serial.println("   k/K: incr/decrease gain (current: " + String(myState.digital_gain_dB,1) + " dB)");
   Serial.println("   z/Z: mute/unmute");
   Serial.println(" AFC Parameters: (no prefix)");
   Serial.println("   x/X: enable/disable AFC");
@@ -195,7 +198,7 @@ bool SerialManager::processCharacter(char c) {  //this is called by SerialManage
     case 'z':
       new_val = -200.0f;
       myTympan.println("Command received: muting (changing gain to " + String(new_val,1) + " dB)");;
-      gain1.setGain_dB(new_val);
+      applyDigitalGain_dB(new_val);
       break;
     case 'Z':
       new_val = myState.digital_gain_dB;
@@ -226,6 +229,10 @@ bool SerialManager::processCharacter(char c) {  //this is called by SerialManage
       Serial.println("SerialManager: command received...print settings for LEFT AGC:");
       BTNRH_alg1.print_agc_params();
       break;
+    case 'l':
+      Serial.println("SerialManager: command received...print latency:");
+      BTNRH_alg1.printLatencyReport();
+      break;
                 
 //    case 'a':
 //      ind = _afl; scale_fac = 5.0;
@@ -24,7 +24,10 @@ typedef struct
 
 //static char msg[MAX_MSG] = {0};
 static double srate = 24000; // sampling rate (Hz)
-static int chunk = 8;        // chunk size   (WEA: This was 32.  I switched to 8 to lower the system's latency.)
+#ifndef CHAPRO_CHUNK
+#define CHAPRO_CHUNK 8       // chunk size   (WEA: This was 32.  I switched to 8 to lower the system's latency.)  Define as 1-4 (before including this file) for the low-latency path
+#endif
+static int chunk = CHAPRO_CHUNK;  // chunk size...this also sets the audio block size (see the main *.ino)
 static int prepared = 0;
 
 // ////////////// Old method
@@ -0,0 +1,152 @@
+
+#ifndef _AudioAnalyzeTransferFunction_F32_h
+#define _AudioAnalyzeTransferFunction_F32_h
+
+#include <Tympan_Library.h>
+#include <arm_math.h>
+
+// AudioAnalyzeTransferFunction_F32: the transfer function from input 0 (the reference mic) to input 1 (the mic being
+// calibrated), measured with broadband noise (see CalibrationTransferFunction in CalibrationClasses.h).
+//
+// Both inputs are cut into Hanning-windowed frames of TF_NFFT samples that overlap by half.  For each frame, the
+// spectra X (reference) and Y are added to the averages Sxx = |X|^2, Syy = |Y|^2, and Sxy = conj(X) Y.  Then, over any
+// band of bins, H1 = sum(Sxy) / sum(Sxx) is the transfer function and |sum(Sxy)|^2 / (sum(Sxx) sum(Syy)) is the
+// coherence (near 1.0 if Y really is just X passed through a filter, lower if there is noise or distortion).  Noise on
+// the mic being calibrated averages out of H1.
+//
+// update() (in the audio interrupt) only copies the audio into a ring buffer.  The FFTs are done by service(), which
+// must be called often from loop().  The ring holds TF_RING samples, so loop() can fall behind by about 30 msec
+// (at 96 kHz) before audio is lost.  If it does fall behind, the frames that were lost are skipped (and counted).
+
+#define TF_NFFT     2048                 //FFT length (47 Hz bins at 96 kHz).  Power of 2, up to 4096 (for arm_rfft_fast_f32)
+#define TF_HOP      (TF_NFFT / 2)        //50% overlap, which is good for the Hanning window
+#define TF_N_BINS   (TF_NFFT / 2 + 1)
+#define TF_RING     (4 * TF_NFFT)
+#define TF_N_CHAN   2
+
+class AudioAnalyzeTransferFunction_F32 : public AudioStream_F32 {
+  //GUI: inputs:2, outputs:0  //this line used for automatic generation of GUI node
+  public:
+    AudioAnalyzeTransferFunction_F32(const AudioSettings_F32 &settings) : AudioStream_F32(TF_N_CHAN, inputQueueArray_f32) {
+      sample_rate_Hz = settings.sample_rate_Hz;
+      audio_block_samples = settings.audio_block_samples;
+      arm_rfft_fast_init_f32(&rfft, TF_NFFT);
+      for (int i = 0; i < TF_NFFT; i++) window[i] = 0.5f * (1.0f - cosf(2.0f * (float)M_PI * (float)i / (float)TF_NFFT));
+      window_sum_sq = 0.0f;
+      for (int i = 0; i < TF_NFFT; i++) window_sum_sq += window[i] * window[i];
+    }
+
+    //start over: clear the averages, skip the first n_skip samples (while the system settles), and then start analyzing
+    void start(long n_skip) {
+      is_capturing = false;  //so that update() leaves everything alone while we change it
+      for (int k = 0; k < TF_N_BINS; k++) { Sxx[k] = 0.0f; Syy[k] = 0.0f; Sxy_re[k] = 0.0f; Sxy_im[k] = 0.0f; }
+      n_frames = 0;  n_frames_lost = 0;
+      n_to_skip = max(0L, n_skip);  n_written = 0;  next_frame_start = 0;
+      is_capturing = true;
+    }
+    void stop(void) { is_capturing = false; }
+
+    //do the FFTs for any frames that are ready.  Call this from loop().  Returns the number of frames done.
+    int service(void) {
+      int n_done = 0;
+      while (true) {
+        long n_avail = n_written;  //n_written is changed by update(), so read it once
+        if (n_avail - next_frame_start > TF_RING - audio_block_samples) {  //update() has started overwriting this frame
+          long new_start = n_avail - TF_NFFT;
+          n_frames_lost += (new_start - next_frame_start + TF_HOP - 1) / TF_HOP;
+          next_frame_start += ((new_start - next_frame_start + TF_HOP - 1) / TF_HOP) * TF_HOP;
+          continue;
+        }
+        if (n_avail - next_frame_start < TF_NFFT) break;  //not enough audio yet
+        processFrame(next_frame_start);
+        next_frame_start += TF_HOP;
+        n_frames++;  n_done++;
+      }
+      return n_done;
+    }
+
+    int getNFrames(void) { return n_frames; }
+    int getNFramesLost(void) { return n_frames_lost; }
+    float getBinWidth_Hz(void) { return sample_rate_Hz / (float)TF_NFFT; }
+    float getSecPerFrame(void) { return (float)TF_HOP / sample_rate_Hz; }
+
+    //combine the bins from low_Hz up to (not including) high_Hz.  Gives the level (dBFS) at each input over that band,
+    //the gain (dB) and phase (deg) of H1 from input 0 to input 1, and the coherence.  Returns the number of bins used.
+    int getBand(float low_Hz, float high_Hz, float *ref_dBFS, float *dut_dBFS, float *H1_dB, float *H1_deg, float *coherence) {
+      int k1 = max(1, (int)ceilf(low_Hz / getBinWidth_Hz()));
+      int k2 = min(TF_N_BINS, (int)ceilf(high_Hz / getBinWidth_Hz()));  //never DC, but the band can include Nyquist
+      if ((k2 <= k1) || (n_frames == 0)) return 0;
+      double xx = 0.0, yy = 0.0, xy_re = 0.0, xy_im = 0.0;
+      for (int k = k1; k < k2; k++) { xx += Sxx[k]; yy += Syy[k]; xy_re += Sxy_re[k]; xy_im += Sxy_im[k]; }
+
+      //mean-square level: by Parseval, and doubled for the negative frequencies
+      double scale = 2.0 / ((double)n_frames * (double)TF_NFFT * (double)window_sum_sq);
+      *ref_dBFS = (float)(10.0 * log10(max(1.0e-20, scale * xx)));
+      *dut_dBFS = (float)(10.0 * log10(max(1.0e-20, scale * yy)));
+      *H1_dB = (float)(10.0 * log10(max(1.0e-20, (xy_re * xy_re + xy_im * xy_im) / max(1.0e-30, xx * xx))));
+      *H1_deg = (float)(180.0 / M_PI * atan2(xy_im, xy_re));
+      *coherence = (float)((xy_re * xy_re + xy_im * xy_im) / max(1.0e-30, xx * yy));
+      return k2 - k1;
+    }
+
+    virtual void update(void) {
+      audio_block_f32_t *blocks[TF_N_CHAN];
+      for (int Ichan = 0; Ichan < TF_N_CHAN; Ichan++) blocks[Ichan] = AudioStream_F32::receiveReadOnly_f32(Ichan);
+
+      if (is_capturing) {
+        int n_start = (int)min((long)audio_block_samples, n_to_skip);  //skip samples while the system settles
+        n_to_skip -= n_start;
+        static const float zeros[AUDIO_BLOCK_SAMPLES] = {0.0f};
+        int write_ind = (int)(n_written % TF_RING);
+        for (int Ichan = 0; Ichan < TF_N_CHAN; Ichan++) {
+          const float *x = (blocks[Ichan] != NULL) ? blocks[Ichan]->data : zeros;  //a missing block is silence (to keep the channels aligned)
+          int ind = write_ind;
+          for (int i = n_start; i < audio_block_samples; i++) { ring[Ichan][ind] = x[i]; if (++ind >= TF_RING) ind = 0; }
+        }
+        n_written += audio_block_samples - n_start;
+      }
+
+      for (int Ichan = 0; Ichan < TF_N_CHAN; Ichan++) if (blocks[Ichan] != NULL) AudioStream_F32::release(blocks[Ichan]);
+    }
+
+  protected:
+    audio_block_f32_t *inputQueueArray_f32[TF_N_CHAN];
+    float sample_rate_Hz = AUDIO_SAMPLE_RATE_EXACT;
+    int audio_block_samples = AUDIO_BLOCK_SAMPLES;
+    arm_rfft_fast_instance_f32 rfft;
+    float window[TF_NFFT];
+    float window_sum_sq = 1.0f;
+
+    volatile bool is_capturing = false;
+    volatile long n_written = 0;  //samples written to the ring (per channel) since start()
+    long n_to_skip = 0;
+    long next_frame_start = 0;    //in samples since start()
+    int n_frames = 0, n_frames_lost = 0;
+    float ring[TF_N_CHAN][TF_RING];
+    float frame[TF_NFFT], spec[TF_N_CHAN][TF_NFFT];
+    float Sxx[TF_N_BINS], Syy[TF_N_BINS], Sxy_re[TF_N_BINS], Sxy_im[TF_N_BINS];
+
+    void processFrame(long start) {
+      int ind = (int)(start % TF_RING);
+      for (int Ichan = 0; Ichan < TF_N_CHAN; Ichan++) {
+        int j = ind;
+        for (int i = 0; i < TF_NFFT; i++) { frame[i] = window[i] * ring[Ichan][j]; if (++j >= TF_RING) j = 0; }
+        arm_rfft_fast_f32(&rfft, frame, spec[Ichan], 0);  //frame is used as scratch by CMSIS
+      }
+
+      //packed format: [X(0), X(N/2), re X(1), im X(1), re X(2), ...]
+      const float *X = spec[0], *Y = spec[1];
+      Sxx[0] += X[0] * X[0];  Syy[0] += Y[0] * Y[0];  Sxy_re[0] += X[0] * Y[0];
+      const int kN = TF_N_BINS - 1;
+      Sxx[kN] += X[1] * X[1];  Syy[kN] += Y[1] * Y[1];  Sxy_re[kN] += X[1] * Y[1];
+      for (int k = 1; k < kN; k++) {
+        float xr = X[2 * k], xi = X[2 * k + 1], yr = Y[2 * k], yi = Y[2 * k + 1];
+        Sxx[k] += xr * xr + xi * xi;
+        Syy[k] += yr * yr + yi * yi;
+        Sxy_re[k] += xr * yr + xi * yi;  //conj(X) * Y
+        Sxy_im[k] += xr * yi - xi * yr;
+      }
+    }
+};
+
+#endif
@@ -0,0 +1,187 @@
+
+#ifndef _AudioMultitone_F32_h
+#define _AudioMultitone_F32_h
+
+#include <Tympan_Library.h>
+
+// Audio classes for measuring many frequencies at once (see CalibrationMultitone in CalibrationClasses.h):
+//
+//   * AudioSynthMultitone_F32: plays a comb of tones, all at the same amplitude.  Each tone is an exact bin of an
+//     analysis window of N_window samples (freq = bin * fs / N_window), so the comb repeats every N_window samples and
+//     there is no leakage between the tones when they are measured over N_window samples.  The tones get Schroeder
+//     phases, which keep the peak of the comb (its crest factor) low compared to starting all of the tones in phase.
+//
+//   * AudioAnalyzeMultitone_F32: a bank of Goertzel detectors, one per tone, for each of its two inputs.  After
+//     waiting n_settle samples (so that the system under test reaches steady-state), it measures every tone over the
+//     next N_window samples.  The Goertzel state is kept in double precision, like the Goertzel mode in
+//     AudioPath_Sine_wFFT, because the windows are long.
+
+#define MULTITONE_MAX_TONES 16
+#define MULTITONE_N_CHAN    2
+
+class AudioSynthMultitone_F32 : public AudioStream_F32 {
+  //GUI: inputs:0, outputs:1  //this line used for automatic generation of GUI node
+  public:
+    AudioSynthMultitone_F32(const AudioSettings_F32 &settings) : AudioStream_F32(0, NULL) {
+      sample_rate_Hz = settings.sample_rate_Hz;
+    }
+
+    //set the tones (given as bins of an N_window-point analysis) and the amplitude of each tone.  Returns the number of tones.
+    int setTones(const int *bins, int _n_tones, int _N_window, float _amp_per_tone) {
+      if ((_n_tones < 0) || (_n_tones > MULTITONE_MAX_TONES) || (_N_window < 2)) {
+        Serial.println("AudioSynthMultitone_F32: setTones: *** ERROR ***: invalid n_tones (" + String(_n_tones) + ") or N_window (" + String(_N_window) + ")");
+        return n_tones;
+      }
+      n_tones = 0;  //so that update() doesn't use the tones while they are being changed
+      N_window = _N_window;
+      amp_per_tone = _amp_per_tone;
+      for (int I = 0; I < _n_tones; I++) {
+        bin[I] = bins[I];
+        phase_ind[I] = 0;
+        phase_rad[I] = -M_PI * (float)I * (float)(I - 1) / (float)_n_tones;  //Schroeder phase
+      }
+      n_tones = _n_tones;
+      return n_tones;
+    }
+    void stop(void) { n_tones = 0; }
+    void setAmplitudePerTone(float amp) { amp_per_tone = amp; }
+    float getAmplitudePerTone(void) { return amp_per_tone; }
+    int getNumTones(void) { return n_tones; }
+
+    //the largest absolute value of the comb (for an amplitude of 1.0 per tone), found by computing one full period
+    float getPeakPerUnitAmplitude(void) {
+      float peak = 0.0f;
+      for (int n = 0; n < N_window; n++) {
+        float val = 0.0f;
+        for (int I = 0; I < n_tones; I++) val += sinf(2.0f * (float)M_PI * (float)((bin[I] * (long)n) % N_window) / (float)N_window + phase_rad[I]);
+        peak = max(peak, fabsf(val));
+      }
+      return peak;
+    }
+
+    virtual void update(void) {
+      if (n_tones == 0) return;  //no output is the same as silence
+      audio_block_f32_t *block = AudioStream_F32::allocate_f32();
+      if (block == NULL) return;
+
+      const float scale = 2.0f * (float)M_PI / (float)N_window;
+      for (int n = 0; n < block->length; n++) block->data[n] = 0.0f;
+      for (int I = 0; I < n_tones; I++) {
+        int ind = phase_ind[I];  //the phase is kept as an integer (modulo N_window) so that it never drifts
+        const int step = bin[I];
+        for (int n = 0; n < block->length; n++) {
+          block->data[n] += amp_per_tone * sinf(scale * (float)ind + phase_rad[I]);
+          ind += step;  if (ind >= N_window) ind -= N_window;
+        }
+        phase_ind[I] = ind;
+      }
+
+      AudioStream_F32::transmit(block);
+      AudioStream_F32::release(block);
+    }
+
+  protected:
+    float sample_rate_Hz = AUDIO_SAMPLE_RATE_EXACT;
+    volatile int n_tones = 0;
+    int N_window = 1;
+    float amp_per_tone = 0.0f;
+    int bin[MULTITONE_MAX_TONES];
+    int phase_ind[MULTITONE_MAX_TONES];
+    float phase_rad[MULTITONE_MAX_TONES];
+};
+
+
+class AudioAnalyzeMultitone_F32 : public AudioStream_F32 {
+  //GUI: inputs:2, outputs:0  //this line used for automatic generation of GUI node
+  public:
+    AudioAnalyzeMultitone_F32(const AudioSettings_F32 &settings) : AudioStream_F32(MULTITONE_N_CHAN, inputQueueArray_f32) {
+      sample_rate_Hz = settings.sample_rate_Hz;
+      audio_block_samples = settings.audio_block_samples;
+    }
+
+    //start measuring the given bins of an N_window-point analysis, after first skipping n_settle samples
+    bool start(const int *bins, int _n_tones, int _N_window, int _n_settle) {
+      if ((_n_tones < 1) || (_n_tones > MULTITONE_MAX_TONES) || (_N_window < 2) || (_n_settle < 0)) return false;
+      is_measuring = false;  //so that update() leaves everything alone while we change it
+      n_tones = _n_tones;  N_window = _N_window;
+      n_skip = _n_settle;  n_counted = 0;
+      for (int I = 0; I < n_tones; I++) {
+        bin[I] = bins[I];
+        coeff[I] = 2.0 * cos(2.0 * M_PI * (double)bin[I] / (double)N_window);
+        for (int Ichan = 0; Ichan < MULTITONE_N_CHAN; Ichan++) { s1[Ichan][I] = 0.0; s2[Ichan][I] = 0.0; }
+      }
+      is_available = false;
+      is_measuring = true;
+      return true;
+    }
+    void stop(void) { is_measuring = false; }
+
+    bool available(void) { return is_available; }
+    int getNumTones(void) { return n_tones; }
+    float getFrequency_Hz(int Itone) { return (float)bin[Itone] * sample_rate_Hz / (float)N_window; }
+
+    //amplitude (zero-to-peak) of the given tone, once available()
+    float getAmplitude(int Itone, int Ichan) {
+      if ((Itone < 0) || (Itone >= n_tones) || (Ichan < 0) || (Ichan >= MULTITONE_N_CHAN)) return 0.0f;
+      return amplitude[Ichan][Itone];
+    }
+
+    virtual void update(void) {
+      audio_block_f32_t *blocks[MULTITONE_N_CHAN];
+      for (int Ichan = 0; Ichan < MULTITONE_N_CHAN; Ichan++) blocks[Ichan] = AudioStream_F32::receiveReadOnly_f32(Ichan);
+
+      if (is_measuring) {
+        int length = audio_block_samples;
+
+        //skip samples while the system settles
+        int n_start = (int)min((long)length, (long)n_skip);
+        n_skip -= n_start;
+
+        //run each Goertzel over the rest of the block (or until the window is full)
+        int n_end = n_start + min(length - n_start, N_window - n_counted);
+        static const float zeros[AUDIO_BLOCK_SAMPLES] = {0.0f};
+        for (int Ichan = 0; Ichan < MULTITONE_N_CHAN; Ichan++) {
+          const float *x = (blocks[Ichan] != NULL) ? blocks[Ichan]->data : zeros;  //a missing block is silence (the states still turn)
+          for (int I = 0; I < n_tones; I++) updateGoertzel(x + n_start, n_end - n_start, coeff[I], s1[Ichan][I], s2[Ichan][I]);
+        }
+        n_counted += n_end - n_start;
+
+        if (n_counted >= N_window) {
+          for (int Ichan = 0; Ichan < MULTITONE_N_CHAN; Ichan++) {
+            for (int I = 0; I < n_tones; I++) {
+              double power = s1[Ichan][I] * s1[Ichan][I] + s2[Ichan][I] * s2[Ichan][I] - coeff[I] * s1[Ichan][I] * s2[Ichan][I];
+              amplitude[Ichan][I] = (float)(2.0 * sqrt(max(0.0, power)) / (double)N_window);
+            }
+          }
+          is_measuring = false;
+          is_available = true;
+        }
+      }
+
+      for (int Ichan = 0; Ichan < MULTITONE_N_CHAN; Ichan++) if (blocks[Ichan] != NULL) AudioStream_F32::release(blocks[Ichan]);
+    }
+
+  protected:
+    audio_block_f32_t *inputQueueArray_f32[MULTITONE_N_CHAN];
+    float sample_rate_Hz = AUDIO_SAMPLE_RATE_EXACT;
+    int audio_block_samples = AUDIO_BLOCK_SAMPLES;
+    volatile bool is_measuring = false, is_available = false;
+    int n_tones = 0, N_window = 1;
+    long n_skip = 0;
+    int n_counted = 0;
+    int bin[MULTITONE_MAX_TONES];
+    double coeff[MULTITONE_MAX_TONES];
+    double s1[MULTITONE_N_CHAN][MULTITONE_MAX_TONES], s2[MULTITONE_N_CHAN][MULTITONE_MAX_TONES];
+    float amplitude[MULTITONE_N_CHAN][MULTITONE_MAX_TONES];
+
+    static void updateGoertzel(const float *x, int n, double coeff, double &s1, double &s2) {
+      double a = s1, b = s2;
+      for (int i = 0; i < n; i++) {
+        double s0 = (double)x[i] + coeff * a - b;
+        b = a;  a = s0;
+      }
+      s1 = a;  s2 = b;
+    }
+};
+
+#endif
@@ -7,6 +7,8 @@
 */
 
 #include <Tympan_Library.h>
+#include "AudioMultitone_F32.h"
+#include "AudioAnalyzeTransferFunction_F32.h"
 
 //set the sample rate and block size
 const float sample_rate_Hz = 96000.0f ; //24000 or 44117 (or other frequencies in the table in AudioOutputI2S_F32)
@@ -20,16 +22,29 @@ AudioFilterBiquad_F32     filter_L(audio_settings), filter_R(audio_settings); //
 AudioCalcEnvelope_F32     measureEnvelope_L(audio_settings); //from the Tympan_Library
 AudioCalcEnvelope_F32     measureEnvelope_R(audio_settings); //from the Tympan_Library
 AudioSynthWaveform_F32    sineWave(audio_settings);     //from the Tympan_Library
+AudioSynthMultitone_F32   multitone(audio_settings);    //from AudioMultitone_F32.h (for the multitone calibration)
+AudioAnalyzeMultitone_F32 measureMultitone(audio_settings); //from AudioMultitone_F32.h (for the multitone calibration)
+AudioSynthNoisePink_F32   pinkNoise(audio_settings);    //from the Tympan_Library (for the transfer-function calibration)
+AudioAnalyzeTransferFunction_F32 measureTF(audio_settings); //from AudioAnalyzeTransferFunction_F32.h (for the transfer-function calibration)
+AudioMixer4_F32           outputMixer(audio_settings);  //from the Tympan_Library
 AudioOutputI2S_F32        audioOutput(audio_settings);  //from the Tympan_Library
-AudioSDWriter_F32_UI      audioSDWriter(audio_settings); //from the Tympan_Library
+SdFs                      sd;                            //This is the SD card.  SdFs is part of the Teensy install
+AudioSDWriter_F32_UI      audioSDWriter(&sd, audio_settings); //from the Tympan_Library
 
 // Create the audio connections from the sineWave object to the audio output object
 AudioConnection_F32 patchCord1(audioInput, 0, filter_L, 0);
 AudioConnection_F32 patchCord2(audioInput, 1, filter_R, 0);
 AudioConnection_F32 patchCord5(filter_L, 0, measureEnvelope_L, 0);
 AudioConnection_F32 patchCord6(filter_R, 0, measureEnvelope_R, 0);
-AudioConnection_F32 patchCord11(sineWave, 0, audioOutput, 0);  //connect to left output
-AudioConnection_F32 patchCord12(sineWave, 0, audioOutput, 1);  //connect to right output
+AudioConnection_F32 patchCord7(audioInput, 0, measureMultitone, 0);
+AudioConnection_F32 patchCord8(audioInput, 1, measureMultitone, 1);
+AudioConnection_F32 patchCord9(sineWave, 0, outputMixer, 0);
+AudioConnection_F32 patchCord10(multitone, 0, outputMixer, 1);
+AudioConnection_F32 patchCord11(outputMixer, 0, audioOutput, 0);  //connect to left output
+AudioConnection_F32 patchCord12(outputMixer, 0, audioOutput, 1);  //connect to right output
+AudioConnection_F32 patchCord13(audioInput, 0, measureTF, 0);     //the reference mic
+AudioConnection_F32 patchCord14(audioInput, 1, measureTF, 1);     //the mic being calibrated
+AudioConnection_F32 patchCord15(pinkNoise, 0, outputMixer, 2);
 AudioConnection_F32 patchCord21(audioInput, 0, audioSDWriter, 0);
 AudioConnection_F32 patchCord22(audioInput, 1, audioSDWriter, 1);
 
@@ -37,6 +52,8 @@ AudioConnection_F32 patchCord22(audioInput, 1, audioSDWriter, 1);
 #define STATE_OFF 0
 #define STATE_MANUAL 1
 #define STATE_AUTOMATIC 2
+#define STATE_MULTITONE 3
+#define STATE_TRANSFER_FUNCTION 4
 int current_state = STATE_OFF;
 
 // Define the parameters of the test tone
@@ -49,6 +66,16 @@ float start_Hz = 1000.0, end_Hz = 48000.0;
 int n_steps = (int)(((end_Hz - start_Hz) / 1000.0)+0.5) + 1;
 float step_dur_sec = 1.0;
 CalibrationSteppedSine calSteppedSine(&sineWave, &filter_L, &filter_R, &measureEnvelope_L, &measureEnvelope_R);
+int n_parallel_tones = 8;  //for the multitone calibration: how many of the tones to play at once
+CalibrationMultitone calMultitone(&multitone, &measureMultitone, sample_rate_Hz);
+float tf_analysis_sec = 2.0;  //for the transfer-function calibration: how long to average the pink noise
+CalibrationTransferFunction calTransferFunction(&pinkNoise, &measureTF, sample_rate_Hz);
+CalibrationResults *last_results = NULL;  //the most recent calibration run that finished (for saving to the SD card)
+
+// The PCB mic's sensitivity versus frequency, which other sketches load from the SD card
+#define CAL_TABLE_FNAME "CALTABLE.BIN"
+const float ref_mic_sens_dBFS = -57.65 + (101.3 - 94);  //the reference mic (on the left input): dBFS at 94 dB SPL at 0 dB gain
+CalibrationTable calTable;
 
 // Define other parameters
 float input_gain_dB = 15.0;
@@ -94,6 +121,10 @@ void setup(void)
   myTympan.setInputGain_dB(input_gain_dB);
   Serial.println("setup(): Analog input gain set to " + String(input_gain_dB) + " dB for both left and right.");
 
+  //mix the single tone, the multitone, and the pink noise together (only one plays at a time)
+  outputMixer.gain(0,1.0);  outputMixer.gain(1,1.0);  outputMixer.gain(2,1.0);
+  pinkNoise.amplitude(0.0);
+
   //Set the baseline volume levels
   myTympan.volume_dB(0);                   // headphone amplifier.  -63.6 to +24 dB in 0.5dB steps.
 
@@ -135,6 +166,12 @@ void loop(void)
     case STATE_AUTOMATIC:
       update_automatic_operation();
       break;
+    case STATE_MULTITONE:
+      update_multitone_operation();
+      break;
+    case STATE_TRANSFER_FUNCTION:
+      update_transfer_function_operation();
+      break;
   }
 }
 
@@ -168,6 +205,27 @@ void update_automatic_operation(void) {
   if (ret_val == 1) {
     Serial.println("Stepped Sine Complete.");
     switchState(STATE_OFF);
+    last_results = &calSteppedSine;
+  }
+}
+
+void update_multitone_operation(void) {
+  int ret_val = 0;
+  ret_val = calMultitone.update();
+  if (ret_val == 1) {
+    Serial.println("Multitone Calibration Complete.");
+    switchState(STATE_OFF);
+    last_results = &calMultitone;
+  }
+}
+
+void update_transfer_function_operation(void) {
+  int ret_val = 0;
+  ret_val = calTransferFunction.update();
+  if (ret_val == 1) {
+    Serial.println("Transfer Function Calibration Complete.");
+    switchState(STATE_OFF);
+    last_results = &calTransferFunction;
   }
 }
 
@@ -197,6 +255,15 @@ float incrementAmplitude(float incr_dB) {
   return tone_amp_dB;
 }
 
+bool enableAdaptiveSettling(bool enable) {
+  return calSteppedSine.use_adaptive_settling = enable;
+}
+
+int incrementParallelTones(int incr) {
+  n_parallel_tones = max(1, min(MULTITONE_MAX_TONES, n_parallel_tones + incr));
+  return n_parallel_tones;
+}
+
 bool muteTone(bool set_mute) {
   if (set_mute) {
     sineWave.amplitude(0.0);
@@ -207,6 +274,39 @@ bool muteTone(bool set_mute) {
   return set_mute;
 }
 
+//start the SD card (only once...it is shared with the SD writer)
+bool beginSD(void) {
+  static bool is_begun = false;
+  if (!is_begun) is_begun = sd.begin(SdioConfig(FIFO_SDIO));
+  return is_begun;
+}
+
+//turn the most recent calibration run into a calibration table and save it to the SD card
+bool saveCalibrationTable(void) {
+  if (last_results == NULL) {
+    Serial.println("saveCalibrationTable: *** ERROR ***: no calibration has finished yet.  Run one first (T or p).");
+    return false;
+  }
+  int n_points = last_results->fillCalibrationTable(&calTable, ref_mic_sens_dBFS);
+  calTable.printTable();
+  if ((n_points == 0) || (!beginSD()) || (!calTable.save(&sd, CAL_TABLE_FNAME))) {
+    Serial.println("saveCalibrationTable: *** ERROR ***: could not save " + String(CAL_TABLE_FNAME) + " to the SD card.");
+    return false;
+  }
+  Serial.println("saveCalibrationTable: saved " + String(n_points) + " points to " + String(CAL_TABLE_FNAME));
+  return true;
+}
+
+//read the calibration table back from the SD card (to check what was saved)
+bool loadCalibrationTable(void) {
+  if ((!beginSD()) || (!calTable.load(&sd, CAL_TABLE_FNAME))) {
+    Serial.println("loadCalibrationTable: *** ERROR ***: could not read a valid " + String(CAL_TABLE_FNAME) + " from the SD card.");
+    return false;
+  }
+  calTable.printTable();
+  return true;
+}
+
 int switchState(int new_state) {
 
   //turn off previous state
@@ -226,6 +326,19 @@ int switchState(int new_state) {
         calSteppedSine.end();
         calSteppedSine.printAllResults();
         muteTone(true);
+        break;
+      case STATE_MULTITONE:
+        //stop test
+        Serial.println("switchState: stopping multitone test...");
+        calMultitone.end();
+        calMultitone.printAllResults();
+        break;
+      case STATE_TRANSFER_FUNCTION:
+        //stop test
+        Serial.println("switchState: stopping transfer function test...");
+        calTransferFunction.end();
+        calTransferFunction.printAllResults();
+        break;
     }
  
     //turn on current state
@@ -243,6 +356,16 @@ int switchState(int new_state) {
         Serial.println("Starting Stepped Sine Calibration...");
         calSteppedSine.start(start_Hz, end_Hz, n_steps, step_dur_sec);  
         break;
+      case STATE_MULTITONE:
+        //turn on the multitone test
+        Serial.println("Starting Multitone Calibration with " + String(n_parallel_tones) + " tones at once...");
+        calMultitone.start(start_Hz, end_Hz, n_steps, step_dur_sec, n_parallel_tones);
+        break;
+      case STATE_TRANSFER_FUNCTION:
+        //turn on the pink noise and the transfer function measurement
+        Serial.println("Starting Transfer Function Calibration with pink noise (" + String(tf_analysis_sec,1) + " sec)...");
+        calTransferFunction.start(start_Hz, end_Hz, n_steps, tf_analysis_sec);
+        break;
     }
   }
   
@@ -3,45 +3,29 @@
 #define _CalibrationClasses_h
 
 #include <vector>
+#include <algorithm>
+#include "AudioMultitone_F32.h"
+#include "AudioAnalyzeTransferFunction_F32.h"
+#include <CalibrationTable.h>     //from Libraries/Tympan_CalibrationTable in this repo
 
-class CalibrationSteppedSine {
+// Results of a calibration run: for each step, the drive frequency and level and the measured left and right levels.
+// Both CalibrationSteppedSine and CalibrationMultitone keep their results here, so they print the same way.
+class CalibrationResults {
   public:
-    CalibrationSteppedSine(AudioSynthWaveform_F32 *_sine, 
-      AudioFilterBiquad_F32 *_filtL, AudioFilterBiquad_F32 *_filtR,
-      AudioCalcEnvelope_F32 *_envL, AudioCalcEnvelope_F32 *_envR)
-    {
-      sine = _sine; 
-      filtL = _filtL; filtR = _filtR;
-      envL = _envL;  envR = _envR;
-    }
-
-    //core methods for executing the test
-    enum state {INACTIVE, ACTIVE, TEST_SILENCE};
-    int start(float _start_Hz, float _end_Hz, int _n_tones, float step_duration_sec);
-    void end(void) { if (cur_state != INACTIVE) { cur_state = INACTIVE; stopTone(); n_steps = get_n_measurements(); } } //pre-maturely stop
-    int update(void);
-
-    //utilities for running the test
-    void reset(void) { all_freq_Hz.clear(); all_left_dBFS.clear(); all_right_dBFS.clear(); }
-    void startTone(float freq_Hz, float amp_dBFS) { 
-      //change filter
-      filtL->setBandpass(0,freq_Hz);
-      filtR->setBandpass(0,freq_Hz);
-
-      //change sine wav
-      sine->frequency(freq_Hz); 
-      sine->amplitude(dBFS_to_amp(amp_dBFS)); 
-      last_start_millis = millis();
+    void reset(void) { all_freq_Hz.clear(); all_drive_dBFS.clear(); all_is_silence.clear(); all_left_dBFS.clear(); all_right_dBFS.clear(); }
+    void addResult(float freq_Hz, float drive_dBFS, bool is_silence, float left_dBFS, float right_dBFS) {
+      all_freq_Hz.push_back(freq_Hz);
+      all_drive_dBFS.push_back(drive_dBFS);
+      all_is_silence.push_back(is_silence);
+      all_left_dBFS.push_back(left_dBFS);
+      all_right_dBFS.push_back(right_dBFS);
     }
-    void stopTone(void) { sine->amplitude(0.0); }
-    float dBFS_to_amp(float amp_dBFS) { return sqrtf(2.0)*sqrtf(powf(10.f,amp_dBFS/10.0)); }
-    void takeMeasurement(void);
 
     //reporting
-    int get_n_steps(void) { return n_steps; }
     int get_n_measurements(void) { return (int)all_freq_Hz.size(); }
     float get_freq_Hz(int ind) { return all_freq_Hz[ind]; }
     float get_drive_dBFS(int ind) { return all_drive_dBFS[ind]; };
+    bool get_is_silence(int ind) { return all_is_silence[ind]; }
     float get_left_dBFS(int ind) { return all_left_dBFS[ind]; }
     float get_right_dBFS(int ind) { return all_right_dBFS[ind]; };
 
@@ -77,7 +61,93 @@ class CalibrationSteppedSine {
       }
     }
 
+    //put the results in order of frequency, with the AMBIENT result(s) last
+    void sortByFrequency(void) {
+      std::vector<int> order(all_freq_Hz.size());
+      for (int i=0; i < (int)order.size(); i++) order[i] = i;
+      std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+        if (all_is_silence[a] != all_is_silence[b]) return (bool)all_is_silence[b];  //the silent ones go last
+        return all_freq_Hz[a] < all_freq_Hz[b];
+      });
+      CalibrationResults sorted;
+      for (int i : order) sorted.addResult(all_freq_Hz[i], all_drive_dBFS[i], all_is_silence[i], all_left_dBFS[i], all_right_dBFS[i]);
+      *this = sorted;
+    }
+
+    //Turn the results into the sensitivity of the right mic (the PCB mic) versus frequency, using the left mic as the
+    //reference.  Both mics hear the same SPL and have the same input gain, so the sensitivity (dBFS at 94 dB SPL at 0 dB
+    //gain) is simply right - left + the reference mic's own sensitivity.  Returns the number of points in the table.
+    int fillCalibrationTable(CalibrationTable *table, float ref_mic_sens_dBFS) {
+      sortByFrequency();
+      table->clear();
+      for (int i=0; i < get_n_measurements(); i++) {
+        if (all_is_silence[i]) continue;
+        table->addPoint(all_freq_Hz[i], all_right_dBFS[i] - all_left_dBFS[i] + ref_mic_sens_dBFS);
+      }
+      return table->getNPoints();
+    }
+
+  protected:
+    std::vector<float> all_freq_Hz;
+    std::vector<float> all_drive_dBFS;
+    std::vector<bool>  all_is_silence;
+    std::vector<float> all_left_dBFS;
+    std::vector<float> all_right_dBFS;
+};
+
+// CalibrationSteppedSine: play one tone at a time and measure the left and right levels with a bandpass filter and
+// an envelope (AudioCalcEnvelope_F32) for each.  With adaptive settling (the default), each step is measured as soon as
+// both envelopes have settled: the envelopes are sampled every settle_sample_sec and, once the standard deviation (in dB)
+// of both over the last settle_window_sec is below settle_thresh_dB, the step is done.  If that never happens (such as
+// for the silent step at the end, which is only noise), the step is measured after step_dur_sec, like without adaptive
+// settling.  The time that each step took is kept (get_settle_sec()).  See HostSim/simAdaptiveSettling.cpp.
+#define SETTLE_MAX_SAMPLES 32
+
+class CalibrationSteppedSine : public CalibrationResults {
+  public:
+    CalibrationSteppedSine(AudioSynthWaveform_F32 *_sine, 
+      AudioFilterBiquad_F32 *_filtL, AudioFilterBiquad_F32 *_filtR,
+      AudioCalcEnvelope_F32 *_envL, AudioCalcEnvelope_F32 *_envR)
+    {
+      sine = _sine; 
+      filtL = _filtL; filtR = _filtR;
+      envL = _envL;  envR = _envR;
+    }
+
+    //core methods for executing the test
+    enum state {INACTIVE, ACTIVE, TEST_SILENCE};
+    int start(float _start_Hz, float _end_Hz, int _n_tones, float step_duration_sec);
+    void end(void) { if (cur_state != INACTIVE) { cur_state = INACTIVE; stopTone(); n_steps = get_n_measurements(); } } //pre-maturely stop
+    int update(void);
+
+    //utilities for running the test
+    void startTone(float freq_Hz, float amp_dBFS) { 
+      //change filter
+      filtL->setBandpass(0,freq_Hz);
+      filtR->setBandpass(0,freq_Hz);
+
+      //change sine wav
+      sine->frequency(freq_Hz); 
+      sine->amplitude(dBFS_to_amp(amp_dBFS)); 
+      last_start_millis = millis();
+      n_settle_samples = 0;  last_settle_sample_millis = last_start_millis;
+    }
+    void stopTone(void) { sine->amplitude(0.0); }
+    float dBFS_to_amp(float amp_dBFS) { return sqrtf(2.0)*sqrtf(powf(10.f,amp_dBFS/10.0)); }
+    void takeMeasurement(unsigned long dT_millis);
+    bool hasSettled(unsigned long cur_millis);
+
+    //reporting
+    int get_n_steps(void) { return n_steps; }
+    float get_settle_sec(int ind) { return all_settle_sec[ind]; }  //how long each step took before it was measured
+    float get_total_sec(void) { float t = 0.0f; for (float x : all_settle_sec) t += x; return t; }
+
     float default_amp_dBFS = -26.0;
+    bool use_adaptive_settling = true;  //if false, every step takes step_dur_sec
+    float settle_sample_sec = 0.010;    //how often to sample the envelopes
+    float settle_window_sec = 0.100;    //how long to look back (at most SETTLE_MAX_SAMPLES samples)
+    float settle_thresh_dB = 0.02;      //standard deviation (dB) that counts as settled.  The envelope's own ripple
+                                        //wanders by a few hundredths of a dB, so much less than this never settles.
   private:
     AudioSynthWaveform_F32 *sine;
     AudioFilterBiquad_F32 *filtL, *filtR;
@@ -87,13 +157,15 @@ class CalibrationSteppedSine {
     int n_steps=0;
     float start_Hz = 1000.f;
     float end_Hz = 45000.0;
-    float step_dur_sec = 0.5;
+    float step_dur_sec = 0.5;  //with adaptive settling, this is the longest that a step can take
     unsigned long last_start_millis = 0;
-    std::vector<float> all_freq_Hz;
-    std::vector<float> all_drive_dBFS;
-    std::vector<bool>  all_is_silence;
-    std::vector<float> all_left_dBFS;
-    std::vector<float> all_right_dBFS;
+
+    //adaptive settling
+    std::vector<float> all_settle_sec;
+    float settle_L_dB[SETTLE_MAX_SAMPLES], settle_R_dB[SETTLE_MAX_SAMPLES];  //circular buffers of the sampled envelopes
+    int n_settle_samples = 0;  //samples since the step started
+    unsigned long last_settle_sample_millis = 0;
+    static float calcStdDev_dB(const float *vals_dB, int n_total, int n_use);
 };
 
 int CalibrationSteppedSine::start(float _start_Hz, float _end_Hz, int _n_tones, float _step_duration_sec) {
@@ -106,6 +178,7 @@ int CalibrationSteppedSine::start(float _start_Hz, float _end_Hz, int _n_tones,
 
   //accept the inputs and reset the system
   reset();  //reset any of the previously saved data
+  all_settle_sec.clear();
   start_Hz = _start_Hz;  end_Hz = _end_Hz;
   n_steps = _n_tones;  step_dur_sec = _step_duration_sec;
 
@@ -126,14 +199,20 @@ int CalibrationSteppedSine::update(void) {
   unsigned long dT_millis = cur_millis - last_start_millis;
   if (cur_millis < last_start_millis)  dT_millis = cur_millis + (ULONG_MAX - last_start_millis); //correct for wrap-around
 
-  //has enough time passed to take any action
-  if ((float)dT_millis < 1000.0*step_dur_sec) return 0; //not enough time has passed
+  //has enough time passed to take any action (or, for the tones, have the envelopes settled)?
+  bool is_done = ((float)dT_millis >= 1000.0*step_dur_sec);
+  if ((!is_done) && use_adaptive_settling && (cur_state == ACTIVE)) is_done = hasSettled(cur_millis);
+  if (!is_done) return 0; //not enough time has passed
 
   //yes, enough time has passed, so take a measurement
-  takeMeasurement();
+  takeMeasurement(dT_millis);
 
   //if this was the silent period, we are now done
-  if (cur_state == TEST_SILENCE) { cur_state = INACTIVE; return 1; } //complete!
+  if (cur_state == TEST_SILENCE) {
+    cur_state = INACTIVE; 
+    Serial.println("CalibrationSteppedSine: " + String(get_n_measurements()) + " steps took " + String(get_total_sec(),2) + " sec");
+    return 1; //complete!
+  }
 
   //we are still doing tones.  Are we done with all of the test tone frequencies?
   int cur_step = get_n_measurements(); //counting from one
@@ -150,26 +229,308 @@ int CalibrationSteppedSine::update(void) {
   return 0; //zero is OK
 }
 
-void CalibrationSteppedSine::takeMeasurement(void) {
+//sample the envelopes (every settle_sample_sec) and see if they have been steady for the last settle_window_sec
+bool CalibrationSteppedSine::hasSettled(unsigned long cur_millis) {
+  if ((float)(cur_millis - last_settle_sample_millis) < 1000.0*settle_sample_sec) return false;  //not time for a new sample
+  last_settle_sample_millis = cur_millis;
+
+  int ind = n_settle_samples % SETTLE_MAX_SAMPLES;
+  settle_L_dB[ind] = 20.0*log10f(max(1.0e-10f, envL->getCurrentLevel()));
+  settle_R_dB[ind] = 20.0*log10f(max(1.0e-10f, envR->getCurrentLevel()));
+  n_settle_samples++;
+
+  int n_window = max(2, min(SETTLE_MAX_SAMPLES, (int)(settle_window_sec / settle_sample_sec + 0.5f)));
+  if (n_settle_samples < n_window) return false;  //the window must only hold samples from this step
+  return (calcStdDev_dB(settle_L_dB, n_settle_samples, n_window) < settle_thresh_dB) &&
+         (calcStdDev_dB(settle_R_dB, n_settle_samples, n_window) < settle_thresh_dB);
+}
+
+//standard deviation of the newest n_use values in the circular buffer (which has had n_total values written to it)
+float CalibrationSteppedSine::calcStdDev_dB(const float *vals_dB, int n_total, int n_use) {
+  float mean = 0.0f, sum_sq = 0.0f;
+  for (int i = 0; i < n_use; i++) mean += vals_dB[(n_total - 1 - i) % SETTLE_MAX_SAMPLES];
+  mean /= (float)n_use;
+  for (int i = 0; i < n_use; i++) { float d = vals_dB[(n_total - 1 - i) % SETTLE_MAX_SAMPLES] - mean; sum_sq += d * d; }
+  return sqrtf(sum_sq / (float)(n_use - 1));
+}
+
+void CalibrationSteppedSine::takeMeasurement(unsigned long dT_millis) {
 
   //record the drive signal parameters
-  all_freq_Hz.push_back(sine->getFrequency_Hz());
+  float freq_Hz = sine->getFrequency_Hz();
   float drive_rms = (sine->getAmplitude())/sqrtf(2.0);
-  all_drive_dBFS.push_back(10.0f*log10f(powf(drive_rms,2.0f)));
+  float drive_dBFS = 10.0f*log10f(powf(drive_rms,2.0f));
 
   //decide if this is, in effect, an ambient test case
   float thresh_dBFS = -180.f; //some really small signal amplitude
   float thresh_rms = sqrtf(powf(10.0f,0.1f*thresh_dBFS));
-  if (drive_rms < thresh_rms) {
-    all_is_silence.push_back(true);
+  bool is_silence = (drive_rms < thresh_rms);
+
+  //now add the measured values
+  addResult(freq_Hz, drive_dBFS, is_silence, 20.0*log10f(envL->getCurrentLevel()), 20.0*log10f(envR->getCurrentLevel()));
+  all_settle_sec.push_back(0.001f*(float)dT_millis);
+  printOneResult(get_n_measurements()-1); 
+  Serial.println("    : step took " + String(0.001f*(float)dT_millis,3) + " sec" + String(((float)dT_millis >= 1000.0*step_dur_sec) ? " (did not settle)" : ""));
+}
+
+
+// CalibrationMultitone: the same measurement as CalibrationSteppedSine, but with n_parallel tones playing at once
+// (AudioSynthMultitone_F32), each measured by its own Goertzel detector (AudioAnalyzeMultitone_F32).  The frequencies
+// are the same as for the stepped sine.  They are dealt out to the groups in turn (group g gets frequencies g,
+// g + n_groups, g + 2*n_groups...) so that the tones that play together are spread across the band.  Each group takes
+// step_dur_sec, like one step of the stepped sine, so the whole calibration is about n_parallel times faster.
+//
+// Differences from CalibrationSteppedSine:
+//   * Each frequency is rounded to the nearest bin of the analysis window (analysis_sec, so 10 Hz for the default
+//     0.1 sec).  The rounded frequency is what gets reported.
+//   * The measured level is the RMS of each tone, from its Goertzel.  The stepped sine reports the envelope of the
+//     bandpassed signal (AudioCalcEnvelope_F32), which is not quite the RMS, so compare the two by their gain
+//     (measured minus drive).  The envelope's peak detector also depends on which phases of the sine get sampled, so
+//     at frequencies where that pattern repeats every few samples (such as fs/4 and fs/6), the stepped sine's gain
+//     (right minus left) can be off by several dB.  On the simulated system in HostSim/simMultitoneCal.cpp, it was off
+//     by up to 4.6 dB, while the multitone was within 0.2 dB (that error is the calibrated mic's intermodulation).
+//   * Each tone is at default_amp_dBFS unless the peak of the comb would be more than max_peak_FS.  In that case,
+//     they are all turned down together, and the lower drive level is reported.
+//   * The AMBIENT result is the average level in the bins of the first group, with the tones off.
+class CalibrationMultitone : public CalibrationResults {
+  public:
+    CalibrationMultitone(AudioSynthMultitone_F32 *_synth, AudioAnalyzeMultitone_F32 *_analyzer, float _sample_rate_Hz)
+    {
+      synth = _synth;  analyzer = _analyzer;
+      sample_rate_Hz = _sample_rate_Hz;
+    }
+
+    //core methods for executing the test
+    enum state {INACTIVE, ACTIVE, TEST_SILENCE};
+    int start(float _start_Hz, float _end_Hz, int _n_tones, float _step_duration_sec, int _n_parallel);
+    void end(void) { if (cur_state != INACTIVE) { cur_state = INACTIVE; synth->stop(); analyzer->stop(); sortByFrequency(); } } //pre-maturely stop
+    int update(void);
+
+    //reporting
+    int get_n_steps(void) { return n_steps; }
+    int get_n_groups(void) { return n_groups; }
+
+    float default_amp_dBFS = -26.0;  //per tone
+    float analysis_sec = 0.1;        //length of the Goertzel window (at most half of each step)
+    float max_peak_FS = 0.9;         //turn down the tones if the comb would peak above this
+  private:
+    AudioSynthMultitone_F32 *synth;
+    AudioAnalyzeMultitone_F32 *analyzer;
+    float sample_rate_Hz;
+    int cur_state = INACTIVE;
+
+    int n_steps = 0, n_parallel = 1, n_groups = 0, cur_group = 0;
+    float start_Hz = 1000.f;
+    float end_Hz = 45000.0;
+    int N_window = 1, n_settle = 0;
+    float drive_amp = 0.0;                //amplitude of each tone in the current group
+    int group_bins[MULTITONE_MAX_TONES];  //the bins being played and measured
+    int n_in_group = 0;
+
+    float dBFS_to_amp(float amp_dBFS) { return sqrtf(2.0)*sqrtf(powf(10.f,amp_dBFS/10.0)); }
+    int getBin(int step) {
+      float freq_Hz = start_Hz;
+      if (n_steps > 1) freq_Hz = (end_Hz - start_Hz) / ((float)(n_steps-1))*step + start_Hz;  //same as CalibrationSteppedSine
+      int bin = (int)(freq_Hz * (float)N_window / sample_rate_Hz + 0.5f);
+      return max(1, min(N_window/2 - 1, bin));  //stay off of DC and Nyquist
+    }
+    void startGroup(int group, bool silent);
+    void storeGroupResults(void);
+};
+
+int CalibrationMultitone::start(float _start_Hz, float _end_Hz, int _n_tones, float _step_duration_sec, int _n_parallel) {
+  //check the validity of he inputs
+  if (_start_Hz < 0.0f) { Serial.println("CalibrationMultitone: start: start_Hz must be greater than zero."); return -1; }
+  if (_end_Hz < 0.0f) { Serial.println("CalibrationMultitone: start: end_Hz must be greater than zero.");  return -1; }
+  if (_n_tones < 1) { Serial.println("CalibrationMultitone: start: n_tones must be greater than zero."); return -1; }
+  if (_step_duration_sec <= 0.0f) { Serial.println("CalibrationMultitone: start: step_duration_sec must be greater than zero"); return -1; }
+  if ((_n_parallel < 1) || (_n_parallel > MULTITONE_MAX_TONES)) { Serial.println("CalibrationMultitone: start: n_parallel must be 1 to " + String(MULTITONE_MAX_TONES)); return -1; }
+
+  //accept the inputs and reset the system
+  reset();  //reset any of the previously saved data
+  start_Hz = _start_Hz;  end_Hz = _end_Hz;
+  n_steps = _n_tones;  n_parallel = _n_parallel;
+  n_groups = (n_steps + n_parallel - 1) / n_parallel;
+  int step_samples = (int)(_step_duration_sec * sample_rate_Hz + 0.5f);
+  N_window = max(2, min((int)(analysis_sec * sample_rate_Hz + 0.5f), step_samples / 2));
+  n_settle = max(0, step_samples - N_window);
+  Serial.println("CalibrationMultitone: start: " + String(n_steps) + " tones in " + String(n_groups) + " groups of up to " + String(n_parallel)
+    + ", " + String(sample_rate_Hz / (float)N_window, 1) + " Hz resolution, " + String(_step_duration_sec * n_groups, 1) + " sec total");
+
+  //start the first group of tones
+  cur_group = 0;
+  startGroup(cur_group, false);
+  cur_state = ACTIVE;
+
+  //return
+  return 0;  //zero is OK
+}
+
+void CalibrationMultitone::startGroup(int group, bool silent) {
+  n_in_group = 0;
+  for (int step = group; step < n_steps; step += n_groups) group_bins[n_in_group++] = getBin(step);
+
+  if (silent) {
+    drive_amp = 0.0f;
+    synth->stop();
   } else {
-    all_is_silence.push_back(false);
+    //start the comb at zero amplitude, then find its peak and set the loudness so that it doesn't clip
+    synth->setTones(group_bins, n_in_group, N_window, 0.0f);
+    drive_amp = dBFS_to_amp(default_amp_dBFS);
+    float peak = synth->getPeakPerUnitAmplitude() * drive_amp;
+    if (peak > max_peak_FS) {
+      drive_amp *= max_peak_FS / peak;
+      Serial.println("CalibrationMultitone: group " + String(group) + ": reducing each tone to " + String(20.0f*log10f(drive_amp/sqrtf(2.0)), 1) + " dBFS to avoid clipping.");
+    }
   }
 
-  //now add the measured values
-  all_left_dBFS.push_back(20.0*log10f(envL->getCurrentLevel()));
-  all_right_dBFS.push_back(20.0*log10f(envR->getCurrentLevel()));
-  printOneResult(all_freq_Hz.size()-1); 
+  AudioNoInterrupts();  //start the tones and the measurement on the same audio block
+  if (!silent) synth->setAmplitudePerTone(drive_amp);
+  analyzer->start(group_bins, n_in_group, N_window, n_settle);
+  AudioInterrupts();
+}
+
+void CalibrationMultitone::storeGroupResults(void) {
+  float drive_dBFS = 20.0f*log10f(drive_amp/sqrtf(2.0));
+  for (int I=0; I < n_in_group; I++) {
+    float left_rms = analyzer->getAmplitude(I, 0)/sqrtf(2.0), right_rms = analyzer->getAmplitude(I, 1)/sqrtf(2.0);
+    addResult(analyzer->getFrequency_Hz(I), drive_dBFS, false, 20.0f*log10f(left_rms), 20.0f*log10f(right_rms));
+    printOneResult(get_n_measurements()-1);
+  }
+}
+
+int CalibrationMultitone::update(void) {
+  if (cur_state == INACTIVE) return 0; //zero is OK
+  if (!analyzer->available()) return 0; //still measuring
+
+  //if this was the silent period, we are now done
+  if (cur_state == TEST_SILENCE) {
+    float left_pow = 0.0f, right_pow = 0.0f;
+    for (int I=0; I < n_in_group; I++) {
+      left_pow += 0.5f*powf(analyzer->getAmplitude(I, 0), 2.0f);
+      right_pow += 0.5f*powf(analyzer->getAmplitude(I, 1), 2.0f);
+    }
+    addResult(start_Hz, -200.0f, true, 10.0f*log10f(left_pow/n_in_group), 10.0f*log10f(right_pow/n_in_group));
+    printOneResult(get_n_measurements()-1);
+    cur_state = INACTIVE;
+    sortByFrequency();
+    return 1;  //complete!
+  }
+
+  //save this group's results and go to the next group (or to silence)
+  storeGroupResults();
+  cur_group++;
+  if (cur_group >= n_groups) {
+    cur_state = TEST_SILENCE;
+    startGroup(0, true);
+  } else {
+    startGroup(cur_group, false);
+  }
+  return 0; //zero is OK
+}
+
+
+// CalibrationTransferFunction: instead of tones, play pink noise and measure the transfer function from the reference
+// mic (left) to the mic being calibrated (right) at all frequencies at once (AudioAnalyzeTransferFunction_F32).  After
+// settle_sec, it averages for analysis_sec and then reports the same frequencies as the stepped sine.  Each frequency
+// is the band halfway to its neighbors (or +/- 1/6 octave if there is only one), and the result for that band is H1
+// over all of its FFT bins.  So, it takes a couple of seconds instead of a step per frequency.
+//
+// To fit with the other calibrations (and with fillCalibrationTable()), each result is stored as:
+//   * Drive: the band's center frequency and the level of the noise in that band at the reference mic
+//   * Left: the reference mic's level in the band (dBFS)
+//   * Right: Left plus the gain of H1 (dB), so that Right minus Left is H1.  This is not quite the level at the right
+//     mic, because H1 leaves out any noise at the right mic that is not from the pink noise (see the coherence).
+// The coherence of each band is kept too (get_coherence()).  A band with low coherence (below min_coherence) did not
+// get enough of the pink noise to the mics (or had too much other noise), so it is flagged when printed.
+class CalibrationTransferFunction : public CalibrationResults {
+  public:
+    CalibrationTransferFunction(AudioSynthNoisePink_F32 *_noise, AudioAnalyzeTransferFunction_F32 *_analyzer, float _sample_rate_Hz)
+    {
+      noise = _noise;  analyzer = _analyzer;
+      sample_rate_Hz = _sample_rate_Hz;
+    }
+
+    //core methods for executing the test
+    enum state {INACTIVE, ACTIVE};
+    int start(float _start_Hz, float _end_Hz, int _n_freqs, float _analysis_sec);
+    void end(void) { if (cur_state != INACTIVE) { cur_state = INACTIVE; noise->amplitude(0.0f); analyzer->stop(); } } //pre-maturely stop
+    int update(void);
+
+    //reporting
+    float get_coherence(int ind) { return all_coherence[ind]; }
+    void printCoherence(void) {
+      Serial.println("CalibrationTransferFunction: Freq (Hz), H1 (dB), H1 (deg), Coherence:");
+      for (int i=0; i < get_n_measurements(); i++) {
+        Serial.print(String(all_freq_Hz[i]) + ", " + String(all_right_dBFS[i] - all_left_dBFS[i]) + ", " + String(all_phase_deg[i],1) + ", " + String(all_coherence[i],3));
+        Serial.println((all_coherence[i] < min_coherence) ? "  <-- low coherence" : "");
+      }
+    }
+
+    float noise_amp = 0.1;        //amplitude of the pink noise (given to AudioSynthNoisePink_F32::amplitude())
+    float settle_sec = 0.25;      //time to let the noise get going before analyzing
+    float min_coherence = 0.95;   //bands below this are flagged when printed
+
+  private:
+    AudioSynthNoisePink_F32 *noise;
+    AudioAnalyzeTransferFunction_F32 *analyzer;
+    float sample_rate_Hz;
+    int cur_state = INACTIVE;
+
+    float start_Hz = 1000.f, end_Hz = 45000.0;
+    int n_freqs = 1, n_frames_needed = 1;
+    unsigned long start_millis = 0;
+    std::vector<float> all_coherence, all_phase_deg;
+};
+
+int CalibrationTransferFunction::start(float _start_Hz, float _end_Hz, int _n_freqs, float _analysis_sec) {
+  //check the validity of he inputs
+  if ((_start_Hz <= 0.0f) || (_end_Hz <= 0.0f)) { Serial.println("CalibrationTransferFunction: start: the frequencies must be greater than zero."); return -1; }
+  if (_n_freqs < 1) { Serial.println("CalibrationTransferFunction: start: n_freqs must be greater than zero."); return -1; }
+  if (_analysis_sec <= 0.0f) { Serial.println("CalibrationTransferFunction: start: analysis_sec must be greater than zero"); return -1; }
+
+  //accept the inputs and reset the system
+  reset();  //reset any of the previously saved data
+  all_coherence.clear();  all_phase_deg.clear();
+  start_Hz = _start_Hz;  end_Hz = _end_Hz;  n_freqs = _n_freqs;
+  n_frames_needed = max(1, (int)(_analysis_sec / analyzer->getSecPerFrame() + 0.5f));
+
+  //start the noise and (after it settles) the analysis
+  AudioNoInterrupts();  //start both on the same audio block
+  noise->amplitude(noise_amp);
+  analyzer->start((long)(settle_sec * sample_rate_Hz));
+  AudioInterrupts();
+  start_millis = millis();
+  cur_state = ACTIVE;
+  return 0;  //zero is OK
+}
+
+int CalibrationTransferFunction::update(void) {
+  if (cur_state == INACTIVE) return 0; //zero is OK
+  analyzer->service();  //do the FFTs
+  if (analyzer->getNFrames() < n_frames_needed) return 0; //still measuring
+
+  //done with the noise
+  noise->amplitude(0.0f);
+  analyzer->stop();
+  cur_state = INACTIVE;
+
+  //the result for each frequency is the band halfway to its neighbors
+  float step_Hz = (n_freqs > 1) ? (end_Hz - start_Hz) / ((float)(n_freqs-1)) : 0.0f;
+  for (int I=0; I < n_freqs; I++) {
+    float freq_Hz = start_Hz + step_Hz*I;
+    float low_Hz = (n_freqs > 1) ? (freq_Hz - 0.5f*step_Hz) : (freq_Hz / powf(2.0f, 1.0f/6.0f));
+    float high_Hz = (n_freqs > 1) ? (freq_Hz + 0.5f*step_Hz) : (freq_Hz * powf(2.0f, 1.0f/6.0f));
+    float ref_dBFS, dut_dBFS, H1_dB, H1_deg, coherence;
+    if (analyzer->getBand(low_Hz, high_Hz, &ref_dBFS, &dut_dBFS, &H1_dB, &H1_deg, &coherence) == 0) continue;  //no bins in this band
+    addResult(freq_Hz, ref_dBFS, false, ref_dBFS, ref_dBFS + H1_dB);
+    all_coherence.push_back(coherence);
+    all_phase_deg.push_back(H1_deg);
+  }
+  Serial.println("CalibrationTransferFunction: " + String(analyzer->getNFrames()) + " FFTs of " + String(TF_NFFT) + " points in " + String(0.001f*(float)(millis() - start_millis),2) + " sec"
+    + String((analyzer->getNFramesLost() > 0) ? (" (" + String(analyzer->getNFramesLost()) + " were skipped because loop() fell behind)") : String("")));
+  printCoherence();
+  return 1;  //complete!
 }
 
 #endif
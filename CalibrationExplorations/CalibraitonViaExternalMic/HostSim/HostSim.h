@@ -0,0 +1,178 @@
+#ifndef _HostSim_h
+#define _HostSim_h
+
+// HostSim: run the real calibration classes (CalibrationClasses.h) on a PC, against a simulated system under test, so
+// that the calibration methods can be compared on the same system.  The Tympan_Library pieces are stand-ins (see
+// Tympan_Library.h in this folder).  The audio is run one block at a time by hand, and the calibration's update() is
+// called after every block, like calling it from loop().
+//
+// The simulated system under test (SimSystem):
+//    drive -> loudspeaker (x + k2*x^2 + k3*x^3) -> acoustic delay -> left: the reference mic (flat)
+//                                                                 -> right: the mic being calibrated (+10 dB at 8 kHz,
+//                                                                    then y + mic_k3*y^3)
+// plus independent white noise on each mic.  The true right-minus-left gain is the 8 kHz resonance (see
+// getTrueGain_dB()).  The loudspeaker's distortion reaches both mics, so it mostly cancels out of that gain (though not
+// out of the level at each mic), but the calibrated mic's own distortion (mic_k3) does not.
+
+#include <Tympan_Library.h>
+#include <random>
+#include "../CalibrationClasses.h"
+
+double hostsim_fs_Hz = 96000.0;
+long hostsim_n_samples = 0;
+
+class SimSystem {
+  public:
+    SimSystem(void) {
+      //the +10 dB resonance at 8 kHz (an RBJ peaking filter with Q = 2) on the mic being calibrated
+      double A = pow(10.0, 10.0 / 40.0), w = 2.0 * M_PI * 8000.0 / hostsim_fs_Hz, alpha = sin(w) / (2.0 * 2.0), a0 = 1.0 + alpha / A;
+      b[0] = (1.0 + alpha * A) / a0;  b[1] = -2.0 * cos(w) / a0;  b[2] = (1.0 - alpha * A) / a0;
+      a[1] = -2.0 * cos(w) / a0;  a[2] = (1.0 - alpha / A) / a0;
+      for (int i = 0; i < N_DELAY; i++) delay_line[i] = 0.0f;
+    }
+
+    float k2 = 0.0f, k3 = 0.0f;   //loudspeaker nonlinearity (0.0 for a linear system)
+    float mic_k3 = 0.0f;          //nonlinearity of the mic being calibrated
+    float noise_rms = 0.0f;       //white noise on each mic
+
+    void run(const float *x, float *yL, float *yR, int n) {
+      std::normal_distribution<float> noise(0.0f, 1.0f);
+      for (int i = 0; i < n; i++) {
+        float spkr = x[i] + k2 * x[i] * x[i] + k3 * x[i] * x[i] * x[i];
+        float d = delay_line[delay_ind];  delay_line[delay_ind] = spkr;  delay_ind = (delay_ind + 1) % N_DELAY;
+        double val = b[0] * d + z[0];
+        z[0] = b[1] * d - a[1] * val + z[1];
+        z[1] = b[2] * d - a[2] * val;
+        yL[i] = d + noise_rms * noise(rng);
+        yR[i] = (float)(val + mic_k3 * val * val * val) + noise_rms * noise(rng);
+      }
+    }
+
+    //the true gain (dB) of the mic being calibrated relative to the reference mic
+    float getTrueGain_dB(float freq_Hz) {
+      double w = 2.0 * M_PI * freq_Hz / hostsim_fs_Hz;
+      double num_re = b[0] + b[1] * cos(w) + b[2] * cos(2 * w), num_im = -(b[1] * sin(w) + b[2] * sin(2 * w));
+      double den_re = 1.0 + a[1] * cos(w) + a[2] * cos(2 * w), den_im = -(a[1] * sin(w) + a[2] * sin(2 * w));
+      return (float)(10.0 * log10((num_re * num_re + num_im * num_im) / (den_re * den_re + den_im * den_im)));
+    }
+
+  protected:
+    static const int N_DELAY = 37;
+    float delay_line[N_DELAY];
+    int delay_ind = 0;
+    double b[3], a[3] = {1.0, 0.0, 0.0}, z[2] = {0.0, 0.0};
+    std::mt19937 rng{1};
+};
+
+//the audio of the stepped sine, like in CalibraitonViaExternalMic.ino: sine -> system -> bandpass -> envelope, for each
+//mic.  It can be copied, such as to see what the envelopes would read if the tone kept playing.
+class SteppedSineAudio {
+  public:
+    SteppedSineAudio(void) {
+      env_L.setAttackRelease_msec(100.0, 100.0);  env_R.setAttackRelease_msec(100.0, 100.0);  //same as the .ino
+    }
+    SimSystem sys;
+    AudioSynthWaveform_F32 sine;
+    AudioFilterBiquad_F32 filt_L, filt_R;
+    AudioCalcEnvelope_F32 env_L, env_R;
+
+    void runBlock(void) {
+      float x[AUDIO_BLOCK_SAMPLES], yL[AUDIO_BLOCK_SAMPLES], yR[AUDIO_BLOCK_SAMPLES];
+      sine.run(x, AUDIO_BLOCK_SAMPLES);
+      sys.run(x, yL, yR, AUDIO_BLOCK_SAMPLES);
+      filt_L.run(yL, yL, AUDIO_BLOCK_SAMPLES);  filt_R.run(yR, yR, AUDIO_BLOCK_SAMPLES);
+      env_L.run(yL, AUDIO_BLOCK_SAMPLES);  env_R.run(yR, AUDIO_BLOCK_SAMPLES);
+    }
+};
+
+//the stepped sine (CalibrationSteppedSine) on SteppedSineAudio
+class SimSteppedSine {
+  public:
+    SimSteppedSine(void) : cal(&audio.sine, &audio.filt_L, &audio.filt_R, &audio.env_L, &audio.env_R) {}
+    SteppedSineAudio audio;
+    CalibrationSteppedSine cal;
+
+    //if ref_sec > 0, then each time that a step is measured, a copy of the audio keeps playing that step's tone for
+    //ref_sec more, and what its envelopes then read (dBFS) is kept here, one per step
+    std::vector<float> ref_left_dB, ref_right_dB;
+
+    //run a whole calibration.  Returns the simulated time that it took (sec).
+    float run(float start_Hz, float end_Hz, int n_steps, float step_dur_sec, float ref_sec = 0.0f) {
+      long n_start = hostsim_n_samples;
+      ref_left_dB.clear();  ref_right_dB.clear();
+      cal.start(start_Hz, end_Hz, n_steps, step_dur_sec);
+      while (true) {
+        audio.runBlock();
+        hostsim_n_samples += AUDIO_BLOCK_SAMPLES;
+        SteppedSineAudio before_update = audio;  //update() might start the next tone
+        int n_before = cal.get_n_measurements();
+        int ret_val = cal.update();
+        if ((ref_sec > 0.0f) && (cal.get_n_measurements() > n_before)) {
+          int n_blocks = (int)(ref_sec * hostsim_fs_Hz / AUDIO_BLOCK_SAMPLES + 0.5);
+          for (int i = 0; i < n_blocks; i++) before_update.runBlock();
+          ref_left_dB.push_back(20.0f * log10f(before_update.env_L.getCurrentLevel()));
+          ref_right_dB.push_back(20.0f * log10f(before_update.env_R.getCurrentLevel()));
+        }
+        if (ret_val == 1) break;
+      }
+      return (float)((double)(hostsim_n_samples - n_start) / hostsim_fs_Hz);
+    }
+};
+
+//the multitone, like in CalibraitonViaExternalMic.ino: multitone -> system -> Goertzels
+class SimMultitone {
+  public:
+    SimMultitone(void) : synth(settings), analyzer(settings), cal(&synth, &analyzer, (float)hostsim_fs_Hz) {}
+    SimSystem sys;
+    AudioSettings_F32 settings{(float)hostsim_fs_Hz, AUDIO_BLOCK_SAMPLES};
+    AudioSynthMultitone_F32 synth;
+    AudioAnalyzeMultitone_F32 analyzer;
+    CalibrationMultitone cal;
+
+    //run a whole calibration.  Returns the simulated time that it took (sec).
+    float run(float start_Hz, float end_Hz, int n_steps, float step_dur_sec, int n_parallel) {
+      long n_start = hostsim_n_samples;
+      cal.start(start_Hz, end_Hz, n_steps, step_dur_sec, n_parallel);
+      while (true) {
+        audio_block_f32_t block_L, block_R;
+        for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) synth.out.data[i] = 0.0f;  //silence, unless the synth writes over it
+        synth.update();
+        sys.run(synth.out.data, block_L.data, block_R.data, AUDIO_BLOCK_SAMPLES);
+        analyzer.setInput(0, &block_L);  analyzer.setInput(1, &block_R);
+        analyzer.update();
+        hostsim_n_samples += AUDIO_BLOCK_SAMPLES;
+        if (cal.update() == 1) break;
+      }
+      return (float)((double)(hostsim_n_samples - n_start) / hostsim_fs_Hz);
+    }
+};
+
+//the pink noise, like in CalibraitonViaExternalMic.ino: pink noise -> system -> transfer-function analyzer
+class SimTransferFunction {
+  public:
+    SimTransferFunction(void) : analyzer(settings), cal(&pink, &analyzer, (float)hostsim_fs_Hz) {}
+    SimSystem sys;
+    AudioSettings_F32 settings{(float)hostsim_fs_Hz, AUDIO_BLOCK_SAMPLES};
+    AudioSynthNoisePink_F32 pink;
+    AudioAnalyzeTransferFunction_F32 analyzer;
+    CalibrationTransferFunction cal;
+
+    //run a whole calibration.  Returns the simulated time that it took (sec).
+    float run(float start_Hz, float end_Hz, int n_freqs, float analysis_sec) {
+      long n_start = hostsim_n_samples;
+      cal.start(start_Hz, end_Hz, n_freqs, analysis_sec);
+      while (true) {
+        audio_block_f32_t block_L, block_R;
+        float x[AUDIO_BLOCK_SAMPLES];
+        pink.run(x, AUDIO_BLOCK_SAMPLES);
+        sys.run(x, block_L.data, block_R.data, AUDIO_BLOCK_SAMPLES);
+        analyzer.setInput(0, &block_L);  analyzer.setInput(1, &block_R);
+        analyzer.update();
+        hostsim_n_samples += AUDIO_BLOCK_SAMPLES;
+        if (cal.update() == 1) break;
+      }
+      return (float)((double)(hostsim_n_samples - n_start) / hostsim_fs_Hz);
+    }
+};
+
+#endif
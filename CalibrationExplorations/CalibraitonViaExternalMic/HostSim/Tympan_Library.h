@@ -0,0 +1,152 @@
+#ifndef _HostSim_Tympan_Library_h
+#define _HostSim_Tympan_Library_h
+
+// Host (PC) stand-ins for the few Tympan_Library and Arduino pieces that CalibrationClasses.h uses, so that the real
+// calibration classes can be run against a simulated system under test.  See HostSim.h.  Only what the calibration
+// classes need is here, and the audio objects are run by hand (see HostSim.h), not by an audio interrupt.
+
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <climits>
+using std::min; using std::max;
+
+#define AUDIO_BLOCK_SAMPLES 128
+#define AUDIO_SAMPLE_RATE_EXACT 44100.0f
+
+//Arduino's String, enough for building up the messages that get printed
+struct String : std::string {
+  String(void) {}
+  String(const char *s) : std::string(s) {}
+  String(const std::string &s) : std::string(s) {}
+  String(int val) : std::string(std::to_string(val)) {}
+  String(unsigned long val) : std::string(std::to_string(val)) {}
+  String(double val, int n_dec = 2) { char buff[64]; snprintf(buff, sizeof(buff), "%.*f", n_dec, val); assign(buff); }
+};
+inline String operator+(const String &a, const String &b) { return String(std::string(a) + std::string(b)); }
+inline String operator+(const char *a, const String &b) { return String(std::string(a) + std::string(b)); }
+inline String operator+(const String &a, const char *b) { return String(std::string(a) + std::string(b)); }
+
+//the serial monitor.  Set quiet to hide the calibration classes' own printing.
+struct HostSerial {
+  bool quiet = false;
+  void print(const String &s) { if (!quiet) fputs(s.c_str(), stdout); }
+  void print(double val) { if (!quiet) printf("%.2f", val); }
+  void println(const String &s) { if (!quiet) puts(s.c_str()); }
+  void println(void) { if (!quiet) puts(""); }
+};
+static HostSerial Serial;
+
+//the simulated time is set by the number of samples that have been run (see HostSim.h)
+extern double hostsim_fs_Hz;
+extern long hostsim_n_samples;
+inline unsigned long millis(void) { return (unsigned long)((double)hostsim_n_samples * 1000.0 / hostsim_fs_Hz); }
+inline void AudioNoInterrupts(void) {}
+inline void AudioInterrupts(void) {}
+
+struct AudioSettings_F32 {
+  AudioSettings_F32(float fs, int n) : sample_rate_Hz(fs), audio_block_samples(n) {}
+  float sample_rate_Hz;
+  int audio_block_samples;
+};
+struct audio_block_f32_t { float data[AUDIO_BLOCK_SAMPLES]; int length = AUDIO_BLOCK_SAMPLES; unsigned long id = 0; };
+
+//no audio memory or connections: a node transmits into its own "out" block and the inputs are set by hand
+class AudioStream_F32 {
+  public:
+    AudioStream_F32(int n_inputs, audio_block_f32_t **_inputs) : inputs(_inputs) { for (int i = 0; i < n_inputs; i++) inputs[i] = NULL; }
+    virtual ~AudioStream_F32(void) {}
+    virtual void update(void) = 0;
+    void setInput(int i, audio_block_f32_t *block) { inputs[i] = block; }
+    audio_block_f32_t out;
+  protected:
+    audio_block_f32_t **inputs;
+    audio_block_f32_t *receiveReadOnly_f32(int i = 0) { audio_block_f32_t *b = inputs[i]; inputs[i] = NULL; return b; }
+    audio_block_f32_t *allocate_f32(void) { return &out; }
+    void transmit(audio_block_f32_t *) {}
+    static void release(audio_block_f32_t *) {}
+};
+
+//a sine at the given amplitude (zero-to-peak) and frequency
+class AudioSynthWaveform_F32 {
+  public:
+    void frequency(float freq_Hz) { freq = freq_Hz; }
+    void amplitude(float amp) { magnitude = amp; }
+    float getFrequency_Hz(void) { return freq; }
+    float getAmplitude(void) { return magnitude; }
+    void run(float *y, int n) {
+      for (int i = 0; i < n; i++) {
+        y[i] = (float)(magnitude * sin(phase_rad));
+        phase_rad += 2.0 * M_PI * freq / hostsim_fs_Hz;
+        if (phase_rad > 2.0 * M_PI) phase_rad -= 2.0 * M_PI;
+      }
+    }
+  protected:
+    double freq = 1000.0, magnitude = 0.0, phase_rad = 0.0;
+};
+
+//pink noise (-3 dB per octave), scaled by amplitude(), from Paul Kellet's filter on white noise.  Not the
+//Tympan_Library's generator, but the same slope, which is what matters for the transfer function.
+class AudioSynthNoisePink_F32 {
+  public:
+    void amplitude(float amp) { magnitude = amp; }
+    void run(float *y, int n) {
+      for (int i = 0; i < n; i++) {
+        double w = 2.0 * (double)rand() / (double)RAND_MAX - 1.0;
+        b[0] = 0.99886 * b[0] + w * 0.0555179;  b[1] = 0.99332 * b[1] + w * 0.0750759;
+        b[2] = 0.96900 * b[2] + w * 0.1538520;  b[3] = 0.86650 * b[3] + w * 0.3104856;
+        b[4] = 0.55000 * b[4] + w * 0.5329522;  b[5] = -0.7616 * b[5] - w * 0.0168980;
+        y[i] = (float)(magnitude * 0.11 * (b[0] + b[1] + b[2] + b[3] + b[4] + b[5] + b[6] + w * 0.5362));
+        b[6] = w * 0.115926;
+      }
+    }
+  protected:
+    double magnitude = 0.0, b[7] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+};
+
+//setBandpass() is the RBJ bandpass (0 dB at the center), with Q = 1 by default, like the Tympan_Library
+class AudioFilterBiquad_F32 {
+  public:
+    void setBandpass(int, float freq_Hz, float q = 1.0f) {
+      double w = 2.0 * M_PI * freq_Hz / hostsim_fs_Hz, alpha = sin(w) / (2.0 * q), a0 = 1.0 + alpha;
+      b0 = alpha / a0;  b1 = 0.0;  b2 = -alpha / a0;  a1 = -2.0 * cos(w) / a0;  a2 = (1.0 - alpha) / a0;  //the states carry over
+    }
+    void run(const float *x, float *y, int n) {
+      for (int i = 0; i < n; i++) {
+        double val = b0 * x[i] + z1;
+        z1 = b1 * x[i] - a1 * val + z2;
+        z2 = b2 * x[i] - a2 * val;
+        y[i] = (float)val;
+      }
+    }
+  protected:
+    double b0 = 1.0, b1 = 0.0, b2 = 0.0, a1 = 0.0, a2 = 0.0, z1 = 0.0, z2 = 0.0;
+};
+
+//The CHAPRO-style peak detector of the Tympan_Library (the same as the envelope in AudioEffectCompWDRC_Local_F32 in
+//this repo): the ANSI attack and release times are turned into a fast attack toward |x| and a slow decay without it
+class AudioCalcEnvelope_F32 {
+  public:
+    void setAttackRelease_msec(float attack_msec, float release_msec) {
+      float ansi_atk = 0.001f * attack_msec * (float)hostsim_fs_Hz / 2.425f;
+      float ansi_rel = 0.001f * release_msec * (float)hostsim_fs_Hz / 1.782f;
+      alfa = (float)(ansi_atk / (1.0f + ansi_atk));
+      beta = (float)(ansi_rel / (10.0f + ansi_rel));
+    }
+    float getCurrentLevel(void) { return env; }
+    void run(const float *x, int n) {
+      for (int i = 0; i < n; i++) {
+        float xab = fabsf(x[i]);
+        env = (xab >= env) ? (alfa * env + (1.0f - alfa) * xab) : (beta * env);
+      }
+    }
+  protected:
+    float alfa = 0.0f, beta = 0.0f, env = 1.0e-6f;
+};
+
+#endif
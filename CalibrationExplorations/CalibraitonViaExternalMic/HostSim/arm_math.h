@@ -0,0 +1,53 @@
+#ifndef _HostSim_arm_math_h
+#define _HostSim_arm_math_h
+
+// Host (PC) stand-in for CMSIS's real FFT (arm_rfft_fast_f32), for AudioAnalyzeTransferFunction_F32.h.  It is a plain
+// radix-2 FFT in double, not ARM's code, but it gives the same packed output as CMSIS:
+//     [re X(0), re X(N/2), re X(1), im X(1), re X(2), im X(2), ...]
+// with no 1/N on the forward FFT (and 1/N on the inverse).  Like CMSIS, it uses the input as scratch, so the input is
+// trashed.
+
+#include <cmath>
+#include <complex>
+#include <vector>
+
+struct arm_rfft_fast_instance_f32 { int fftLen; };
+inline void arm_rfft_fast_init_f32(arm_rfft_fast_instance_f32 *S, int N) { S->fftLen = N; }
+
+//in-place complex FFT (the inverse has no 1/N)
+inline void hostsim_fft(std::vector<std::complex<double>> &a, bool inverse) {
+  const int N = (int)a.size();
+  for (int i = 1, j = 0; i < N; i++) {  //bit reversal
+    int bit = N >> 1;
+    for (; j & bit; bit >>= 1) j ^= bit;
+    j ^= bit;
+    if (i < j) std::swap(a[i], a[j]);
+  }
+  for (int len = 2; len <= N; len <<= 1) {
+    for (int i = 0; i < N; i += len) {
+      for (int k = 0; k < len/2; k++) {
+        std::complex<double> u = a[i+k], v = a[i+k+len/2] * std::polar(1.0, (inverse ? 2.0 : -2.0) * M_PI * k / len);
+        a[i+k] = u + v;  a[i+k+len/2] = u - v;
+      }
+    }
+  }
+}
+
+inline void arm_rfft_fast_f32(arm_rfft_fast_instance_f32 *S, float *x, float *y, int ifftFlag) {
+  const int N = S->fftLen;
+  std::vector<std::complex<double>> a(N);
+  if (ifftFlag == 0) {
+    for (int i = 0; i < N; i++) a[i] = x[i];
+    hostsim_fft(a, false);
+    y[0] = (float)a[0].real();  y[1] = (float)a[N/2].real();
+    for (int k = 1; k < N/2; k++) { y[2*k] = (float)a[k].real();  y[2*k+1] = (float)a[k].imag(); }
+  } else {
+    a[0] = x[0];  a[N/2] = x[1];
+    for (int k = 1; k < N/2; k++) { a[k] = std::complex<double>(x[2*k], x[2*k+1]);  a[N-k] = std::conj(a[k]); }
+    hostsim_fft(a, true);
+    for (int i = 0; i < N; i++) y[i] = (float)(a[i].real() / N);
+  }
+  for (int i = 0; i < N; i++) x[i] = NAN;  //the input is trashed, like CMSIS
+}
+
+#endif
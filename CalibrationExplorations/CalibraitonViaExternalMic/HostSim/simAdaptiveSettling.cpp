@@ -0,0 +1,96 @@
+// simAdaptiveSettling: the adaptive settling of CalibrationSteppedSine (see hasSettled() in CalibrationClasses.h) versus
+// waiting step_dur_sec for every step, by running the real class on the simulated system in HostSim.h.
+//
+// Each step's reading is compared to what the same envelopes read if that step's tone keeps playing for another
+// ref_sec (see SimSteppedSine::run()), so to its fully-settled value.  It has to be the same tone, continued, because
+// the envelope's peak detector depends on which phases of the sine get sampled (see simMultitoneCal.cpp), so a new
+// start of the same tone can settle to a slightly different level.  This reports, for fixed steps and for adaptive
+// settling with a few settle_thresh_dB and settle_window_sec:
+//   * the time for the whole calibration, the shortest and longest tone step, and how many tone steps never settled
+//   * the largest and mean error in each mic's level, and the largest error in the gain (right minus left)
+// and then, for the default settings, the time and error of every step.
+//
+// The system is linear with -70 dBFS of white noise on each mic (the distortion in simMultitoneCal.cpp does not change
+// how the envelopes settle).  The last step (48 kHz) is at Nyquist, so it is left out.
+//
+// To build and run (from this folder):
+//     g++ -std=gnu++17 -O2 -I. -I../../../Libraries/Tympan_CalibrationTable/src simAdaptiveSettling.cpp -o simAdaptiveSettling && ./simAdaptiveSettling
+
+#include "HostSim.h"
+
+const float start_Hz = 1000.0f, end_Hz = 48000.0f, step_dur_sec = 1.0f;  //same as CalibraitonViaExternalMic.ino
+const int n_steps = 48;
+const float mic_noise_rms = 3.16e-4f;  //-70 dBFS, same as simMultitoneCal.cpp
+const float ref_sec = 3.0f;
+
+//the results of one run, without the ambient (silent) step or the step at Nyquist
+struct SettleResult {
+  std::vector<float> freq_Hz, step_sec, level_err_dB, gain_err_dB;
+  float total_sec = 0.0f;
+  int n_not_settled = 0;
+};
+
+SettleResult runSettling(bool adaptive, float thresh_dB, float window_sec) {
+  SimSteppedSine sim;
+  sim.audio.sys.noise_rms = mic_noise_rms;
+  sim.cal.use_adaptive_settling = adaptive;
+  sim.cal.settle_thresh_dB = thresh_dB;
+  sim.cal.settle_window_sec = window_sec;
+
+  SettleResult r;
+  r.total_sec = sim.run(start_Hz, end_Hz, n_steps, step_dur_sec, ref_sec);
+  for (int i = 0; i < sim.cal.get_n_measurements(); i++) {
+    if (sim.cal.get_is_silence(i) || (sim.cal.get_freq_Hz(i) >= 0.5f * (float)hostsim_fs_Hz - 1.0f)) continue;
+    float err_L = sim.cal.get_left_dBFS(i) - sim.ref_left_dB[i], err_R = sim.cal.get_right_dBFS(i) - sim.ref_right_dB[i];
+    r.freq_Hz.push_back(sim.cal.get_freq_Hz(i));
+    r.step_sec.push_back(sim.cal.get_settle_sec(i));
+    r.level_err_dB.push_back(max(fabsf(err_L), fabsf(err_R)));
+    r.gain_err_dB.push_back(fabsf(err_R - err_L));
+    if (sim.cal.get_settle_sec(i) >= step_dur_sec - 0.0005f) r.n_not_settled++;
+  }
+  return r;
+}
+
+float maxOf(const std::vector<float> &x) { return *std::max_element(x.begin(), x.end()); }
+float minOf(const std::vector<float> &x) { return *std::min_element(x.begin(), x.end()); }
+float meanOf(const std::vector<float> &x) { float s = 0.0f; for (float v : x) s += v; return s / (float)x.size(); }
+
+void printResult(const char *name, SettleResult &r, bool adaptive) {
+  char settled[32] = "";
+  if (adaptive) snprintf(settled, 32, "%2d of %d did not settle", r.n_not_settled, (int)r.step_sec.size());
+  printf("    %-28s %6.2f sec   %.2f to %.2f sec, %-24s   %.4f   %.4f   %.4f\n", name, r.total_sec, minOf(r.step_sec),
+    maxOf(r.step_sec), settled, maxOf(r.level_err_dB), meanOf(r.level_err_dB), maxOf(r.gain_err_dB));
+}
+
+int main(void) {
+  Serial.quiet = true;
+  printf("simAdaptiveSettling: %d steps from %.0f to %.0f Hz, at most %.1f sec per step, fs = %.0f Hz\n", n_steps, start_Hz, end_Hz, step_dur_sec, hostsim_fs_Hz);
+  printf("    error is versus the same tone after %.1f more sec.  Mic noise: %.1f dBFS (white).\n\n", ref_sec, 20.0f * log10f(mic_noise_rms));
+
+  printf("    %-28s %10s   %-44s  max |error| (dB)\n", "", "total", "tone steps");
+  printf("    %-28s %10s   %-44s  level   (mean)   gain\n", "", "", "");
+  SimSteppedSine defaults;  //for CalibrationSteppedSine's default settings
+  const float default_thresh_dB = defaults.cal.settle_thresh_dB, default_window_sec = defaults.cal.settle_window_sec;
+  SettleResult fixed = runSettling(false, default_thresh_dB, default_window_sec);
+  printResult("fixed steps", fixed, false);
+
+  //the defaults first, then some others
+  const int N_SET = 4;
+  const float all_thresh_dB[N_SET] = {default_thresh_dB, 0.005f, 0.050f, default_thresh_dB};
+  const float all_window_sec[N_SET] = {default_window_sec, default_window_sec, default_window_sec, 2.0f * default_window_sec};
+  SettleResult adaptive[N_SET];
+  for (int s = 0; s < N_SET; s++) {
+    char name[64];
+    snprintf(name, 64, "adaptive, %.3f dB, %.1f sec%s", all_thresh_dB[s], all_window_sec[s], (s == 0) ? "*" : "");
+    adaptive[s] = runSettling(true, all_thresh_dB[s], all_window_sec[s]);
+    printResult(name, adaptive[s], true);
+  }
+  printf("    (* is the default in CalibrationSteppedSine)\n");
+
+  printf("\nEach step with the default settings:\n");
+  printf("    freq (Hz)   adaptive (sec)   level error (dB)   fixed level error (dB)\n");
+  for (size_t i = 0; i < adaptive[0].freq_Hz.size(); i++) {
+    printf("    %9.0f   %14.2f   %16.4f   %22.4f\n", adaptive[0].freq_Hz[i], adaptive[0].step_sec[i], adaptive[0].level_err_dB[i], fixed.level_err_dB[i]);
+  }
+  return 0;
+}
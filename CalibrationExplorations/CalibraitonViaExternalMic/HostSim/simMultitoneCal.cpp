@@ -0,0 +1,203 @@
+// simMultitoneCal: compare the multitone calibration (CalibrationMultitone) to the stepped sine (CalibrationSteppedSine)
+// on the same simulated system (see HostSim.h), by running the real classes from CalibrationClasses.h.
+//
+// The result that matters is the gain of the mic being calibrated relative to the reference mic (right minus left),
+// because that is what goes into the calibration table (see fillCalibrationTable()).  This reports:
+//   * how long each calibration takes
+//   * the crest factor of each multitone comb.  The comb is turned down if it would peak above max_peak_FS, so the
+//     most drive that each tone can get is less than for the stepped sine's single tone.
+//   * the per-tone SNR: the level of each tone versus the level that each detector reads with only the mic noise,
+//     at the default drive and at the most drive per tone
+//   * the error in the gain on an ideal system, then with each impairment on its own (the loudspeaker's distortion,
+//     the calibrated mic's distortion, and the mic noise), and then with all of them.  For the multitone, the
+//     distortion includes intermodulation, whose products land exactly on other tones' bins (all of the tones are
+//     bins of the same window).  For the stepped sine, the harmonics partly get through its Q = 1 bandpass.
+//   * how much the loudspeaker's distortion changes the level at the reference mic (it mostly cancels out of the gain)
+//   * with all of the impairments, the error of each method at every frequency, and the multitone minus the stepped sine
+//
+// The last step (48 kHz) is at Nyquist, so it is left out.
+//
+// To build and run (from this folder):
+//     g++ -std=gnu++17 -O2 -I. -I../../../Libraries/Tympan_CalibrationTable/src simMultitoneCal.cpp -o simMultitoneCal && ./simMultitoneCal
+
+#include "HostSim.h"
+
+const float start_Hz = 1000.0f, end_Hz = 48000.0f, step_dur_sec = 1.0f;  //same as CalibraitonViaExternalMic.ino
+const int n_steps = 48;
+const float speaker_k2 = 0.05f, speaker_k3 = 0.1f;  //mild: 2nd harmonic at -55 dB and 3rd at -78 dB for one tone at -26 dBFS
+const float mic_k3 = 0.1f;                          //the calibrated mic compresses its own peak by 0.03 dB at 8 kHz
+const float mic_noise_rms = 3.16e-4f;               //-70 dBFS of white noise on each mic
+
+const int N_PAR = 2;
+const int all_n_parallel[N_PAR] = {8, 16};          //8 is the default in the .ino; 16 is the most (MULTITONE_MAX_TONES)
+
+//the impairments to simulate
+enum CONDITIONS { IDEAL = 0, SPEAKER_DIST, MIC_DIST, NOISE, ALL, N_COND };
+const char *cond_names[N_COND] = {"ideal", "speaker dist.", "mic dist.", "mic noise", "all"};
+
+void setupSystem(SimSystem &sys, int cond) {
+  sys.k2 = ((cond == SPEAKER_DIST) || (cond == ALL)) ? speaker_k2 : 0.0f;
+  sys.k3 = ((cond == SPEAKER_DIST) || (cond == ALL)) ? speaker_k3 : 0.0f;
+  sys.mic_k3 = ((cond == MIC_DIST) || (cond == ALL)) ? mic_k3 : 0.0f;
+  sys.noise_rms = ((cond == NOISE) || (cond == ALL)) ? mic_noise_rms : 0.0f;
+}
+
+//the results of one run, sorted by frequency, without the ambient (silent) step or the step at Nyquist
+struct RunResult {
+  std::vector<float> freq_Hz, drive_dBFS, left_dB, right_dB;
+  float total_sec = 0.0f;
+  float gain_dB(int i) { return right_dB[i] - left_dB[i]; }
+  float left_gain_dB(int i) { return left_dB[i] - drive_dBFS[i]; }
+};
+
+template <class T>
+RunResult collect(T &cal, float total_sec) {
+  RunResult r;
+  r.total_sec = total_sec;
+  for (int i = 0; i < cal.get_n_measurements(); i++) {
+    if (cal.get_is_silence(i) || (cal.get_freq_Hz(i) >= 0.5f * (float)hostsim_fs_Hz - 1.0f)) continue;
+    r.freq_Hz.push_back(cal.get_freq_Hz(i));
+    r.drive_dBFS.push_back(cal.get_drive_dBFS(i));
+    r.left_dB.push_back(cal.get_left_dBFS(i));
+    r.right_dB.push_back(cal.get_right_dBFS(i));
+  }
+  return r;
+}
+
+//amp_dBFS is each tone's drive.  For just the noise, use -170 (any lower, and the stepped sine calls it the ambient step).
+RunResult runSteppedSine(int cond, bool adaptive = false, float amp_dBFS = -26.0f) {
+  SimSteppedSine sim;
+  setupSystem(sim.audio.sys, cond);
+  sim.cal.use_adaptive_settling = adaptive;
+  sim.cal.default_amp_dBFS = amp_dBFS;
+  float sec = sim.run(start_Hz, end_Hz, n_steps, step_dur_sec);
+  return collect(sim.cal, sec);
+}
+
+//the crest factor of each group's comb, and the most drive per tone before the comb would be turned down
+struct CombInfo { std::vector<float> crest_dB, max_drive_dBFS; };
+
+//also gives the CombInfo, if asked
+RunResult runMultitone(int n_parallel, int cond, float amp_dBFS = -26.0f, CombInfo *comb = NULL) {
+  SimMultitone sim;
+  setupSystem(sim.sys, cond);
+  sim.cal.default_amp_dBFS = amp_dBFS;
+  float sec = sim.run(start_Hz, end_Hz, n_steps, step_dur_sec, n_parallel);
+  if (comb != NULL) {
+    //recreate each group's comb (same bins and phases as CalibrationMultitone) and find its peak-to-RMS ratio
+    int n_groups = sim.cal.get_n_groups();
+    int N_window = (int)(sim.cal.analysis_sec * hostsim_fs_Hz + 0.5);
+    for (int g = 0; g < n_groups; g++) {
+      int bins[MULTITONE_MAX_TONES], n = 0;
+      for (int step = g; step < n_steps; step += n_groups) {
+        float f = (end_Hz - start_Hz) / ((float)(n_steps - 1)) * step + start_Hz;
+        bins[n++] = max(1, min(N_window / 2 - 1, (int)(f * (float)N_window / (float)hostsim_fs_Hz + 0.5f)));
+      }
+      sim.synth.setTones(bins, n, N_window, 1.0f);
+      float peak = sim.synth.getPeakPerUnitAmplitude();
+      comb->crest_dB.push_back(20.0f * log10f(peak / sqrtf(0.5f * (float)n)));
+      comb->max_drive_dBFS.push_back(20.0f * log10f(sim.cal.max_peak_FS / peak / sqrtf(2.0f)));
+    }
+  }
+  return collect(sim.cal, sec);
+}
+
+float maxAbs(const std::vector<float> &x) { float m = 0.0f; for (float v : x) m = max(m, fabsf(v)); return m; }
+float median(std::vector<float> x) { std::sort(x.begin(), x.end()); return x[x.size() / 2]; }
+float minOf(const std::vector<float> &x) { return *std::min_element(x.begin(), x.end()); }
+float maxOf(const std::vector<float> &x) { return *std::max_element(x.begin(), x.end()); }
+
+//the error in the gain (right minus left) versus the true gain, at each frequency
+std::vector<float> gainError(RunResult &r, SimSystem &truth) {
+  std::vector<float> err;
+  for (size_t i = 0; i < r.freq_Hz.size(); i++) err.push_back(r.gain_dB(i) - truth.getTrueGain_dB(r.freq_Hz[i]));
+  return err;
+}
+
+int main(void) {
+  Serial.quiet = true;
+  printf("simMultitoneCal: %d steps from %.0f to %.0f Hz, %.1f sec per step, fs = %.0f Hz\n", n_steps, start_Hz, end_Hz, step_dur_sec, hostsim_fs_Hz);
+  printf("    loudspeaker: x + %.3f x^2 + %.3f x^3.  Calibrated mic: y + %.3f y^3.  Mic noise: %.1f dBFS (white).\n\n",
+    speaker_k2, speaker_k3, mic_k3, 20.0f * log10f(mic_noise_rms));
+
+  //the methods are the stepped sine and then the multitone with each number of tones at once
+  const int N_METHOD = 1 + N_PAR;
+  char method_names[N_METHOD][32];
+  snprintf(method_names[0], 32, "stepped sine");
+  for (int p = 0; p < N_PAR; p++) snprintf(method_names[1 + p], 32, "multitone, %d at once", all_n_parallel[p]);
+
+  SimSystem truth;
+  RunResult runs[N_METHOD][N_COND], noise_only[N_METHOD];
+  CombInfo comb[N_PAR];
+  for (int cond = 0; cond < N_COND; cond++) runs[0][cond] = runSteppedSine(cond);
+  noise_only[0] = runSteppedSine(NOISE, false, -170.0f);
+  RunResult ss_adaptive = runSteppedSine(ALL, true);
+  for (int p = 0; p < N_PAR; p++) {
+    for (int cond = 0; cond < N_COND; cond++) runs[1 + p][cond] = runMultitone(all_n_parallel[p], cond, -26.0f, (cond == IDEAL) ? &comb[p] : NULL);
+    noise_only[1 + p] = runMultitone(all_n_parallel[p], NOISE, -170.0f);
+  }
+  const int n = (int)runs[0][IDEAL].freq_Hz.size();
+
+  printf("Time for the whole calibration (including the ambient step):\n");
+  printf("    %-26s  %6.2f sec\n", "stepped sine, fixed steps", runs[0][ALL].total_sec);
+  printf("    %-26s  %6.2f sec\n", "stepped sine, adaptive", ss_adaptive.total_sec);
+  for (int p = 0; p < N_PAR; p++) {
+    float sec = runs[1 + p][ALL].total_sec;
+    printf("    %-26s  %6.2f sec (%.1fx faster than fixed steps, %.1fx faster than adaptive)\n", method_names[1 + p],
+      sec, runs[0][ALL].total_sec / sec, ss_adaptive.total_sec / sec);
+  }
+
+  //the most drive per tone, if it can peak at max_peak_FS.  The stepped sine's single tone has a crest factor of 3 dB.
+  float max_drive_dBFS[N_METHOD];
+  max_drive_dBFS[0] = 20.0f * log10f(0.9f / sqrtf(2.0f));
+  for (int p = 0; p < N_PAR; p++) max_drive_dBFS[1 + p] = minOf(comb[p].max_drive_dBFS);
+
+  printf("\nDrive level per tone (default %.1f dBFS; the most is for a peak of %.1f FS):\n", runs[0][IDEAL].drive_dBFS[0], 0.9f);
+  printf("    %-26s  crest factor 3.0 dB, drive %.1f dBFS, at most %.1f dBFS\n", method_names[0], runs[0][IDEAL].drive_dBFS[0], max_drive_dBFS[0]);
+  for (int p = 0; p < N_PAR; p++) {
+    printf("    %-26s  crest factor %.1f to %.1f dB, drive %.1f to %.1f dBFS, at most %.1f dBFS\n", method_names[1 + p],
+      minOf(comb[p].crest_dB), maxOf(comb[p].crest_dB), minOf(runs[1 + p][IDEAL].drive_dBFS), maxOf(runs[1 + p][IDEAL].drive_dBFS), max_drive_dBFS[1 + p]);
+  }
+
+  //the noise is the same at any drive, so the SNR at the most drive is just shifted by the extra drive
+  printf("\nPer-tone SNR at the calibrated mic (each tone's level without noise minus what the detector reads with only the noise):\n");
+  for (int m = 0; m < N_METHOD; m++) {
+    std::vector<float> snr_dB(n);
+    for (int i = 0; i < n; i++) snr_dB[i] = runs[m][IDEAL].right_dB[i] - noise_only[m].right_dB[i];
+    float extra_dB = max_drive_dBFS[m] - runs[m][IDEAL].drive_dBFS[0];
+    printf("    %-26s  min %.1f dB, median %.1f dB (at the most drive: min %.1f dB, median %.1f dB)\n", method_names[m],
+      minOf(snr_dB), median(snr_dB), minOf(snr_dB) + extra_dB, median(snr_dB) + extra_dB);
+  }
+
+  printf("\nMax |error| (dB) in the gain (right minus left) over all %d frequencies, for each impairment:\n", n);
+  printf("    %-26s", "");
+  for (int cond = 0; cond < N_COND; cond++) printf("  %13s", cond_names[cond]);
+  printf("\n");
+  for (int m = 0; m < N_METHOD; m++) {
+    printf("    %-26s", method_names[m]);
+    for (int cond = 0; cond < N_COND; cond++) printf("  %13.4f", maxAbs(gainError(runs[m][cond], truth)));
+    printf("\n");
+  }
+
+  printf("\nMax change (dB) in the level at the reference mic caused by the loudspeaker distortion:\n");
+  for (int m = 0; m < N_METHOD; m++) {
+    std::vector<float> change_dB(n);
+    for (int i = 0; i < n; i++) change_dB[i] = runs[m][SPEAKER_DIST].left_gain_dB(i) - runs[m][IDEAL].left_gain_dB(i);
+    printf("    %-26s  %.4f dB\n", method_names[m], maxAbs(change_dB));
+  }
+
+  printf("\nGain (right minus left) with all of the impairments, per frequency (dB):\n");
+  printf("    freq (Hz)    true  stepped-true");
+  for (int p = 0; p < N_PAR; p++) printf("  mt%-2d-true  mt%-2d-stepped", all_n_parallel[p], all_n_parallel[p]);
+  printf("\n");
+  std::vector<float> err_ss = gainError(runs[0][ALL], truth);
+  for (int i = 0; i < n; i++) {
+    printf("    %8.0f  %7.3f  %11.4f ", runs[0][ALL].freq_Hz[i], truth.getTrueGain_dB(runs[0][ALL].freq_Hz[i]), err_ss[i]);
+    for (int p = 0; p < N_PAR; p++) {
+      RunResult &mt = runs[1 + p][ALL];
+      printf("  %9.4f  %12.4f", gainError(mt, truth)[i], mt.gain_dB(i) - runs[0][ALL].gain_dB(i));
+    }
+    printf("\n");
+  }
+  return 0;
+}
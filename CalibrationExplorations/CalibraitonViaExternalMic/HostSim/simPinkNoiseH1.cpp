@@ -0,0 +1,91 @@
+// simPinkNoiseH1: the pink-noise transfer-function calibration (CalibrationTransferFunction and
+// AudioAnalyzeTransferFunction_F32) on the simulated system in HostSim.h, with the same settings as
+// CalibraitonViaExternalMic.ino's 'P' command (48 bands from 1 to 48 kHz, 2 sec of analysis).  For a few levels of
+// white noise on each mic (relative to the pink noise at the mics), it reports:
+//   * the time for the whole calibration, and the number of FFT frames (and lost frames)
+//   * the largest error in H1 (dB), versus the true gain over each band, weighted by the pink noise's spectrum
+//   * the lowest coherence, and how many bands are below min_coherence (so would be flagged)
+// and then, for comparison, the time that the stepped sine (CalibrationSteppedSine) takes on the same system, with
+// adaptive settling (the default) and with fixed steps, as in simAdaptiveSettling.cpp.
+//
+// The FFT is this folder's stand-in arm_rfft_fast_f32() (arm_math.h), not ARM's code, and the pink noise is this
+// folder's stand-in (Tympan_Library.h), not the Tympan_Library's generator.
+//
+// To build and run (from this folder):
+//     g++ -std=gnu++17 -O2 -I. -I../../../Libraries/Tympan_CalibrationTable/src simPinkNoiseH1.cpp -o simPinkNoiseH1 && ./simPinkNoiseH1
+
+#include "HostSim.h"
+
+const float start_Hz = 1000.0f, end_Hz = 48000.0f, analysis_sec = 2.0f;  //same as CalibraitonViaExternalMic.ino
+const int n_freqs = 48;
+const float step_dur_sec = 1.0f, stepped_noise_rms = 3.16e-4f;  //the stepped sine, same as simAdaptiveSettling.cpp
+
+//the rms of the pink noise at the mics (the system's delay and the reference mic are flat)
+float pinkRms(float noise_amp) {
+  AudioSynthNoisePink_F32 pink;
+  pink.amplitude(noise_amp);
+  const int n = 10 * (int)hostsim_fs_Hz;
+  std::vector<float> x(n);
+  pink.run(x.data(), n);
+  double sum_sq = 0.0;
+  for (float v : x) sum_sq += (double)v * (double)v;
+  return (float)sqrt(sum_sq / n);
+}
+
+//the true gain (dB) over the same bins as AudioAnalyzeTransferFunction_F32::getBand(), weighted like pink noise (1/f)
+float trueBandGain_dB(SimSystem &sys, float bin_Hz, float low_Hz, float high_Hz) {
+  int k1 = max(1, (int)ceilf(low_Hz / bin_Hz)), k2 = min(TF_N_BINS, (int)ceilf(high_Hz / bin_Hz));
+  double sum = 0.0, sum_weight = 0.0;
+  for (int k = k1; k < k2; k++) {
+    sum += pow(10.0, sys.getTrueGain_dB(k * bin_Hz) / 10.0) / (double)k;
+    sum_weight += 1.0 / (double)k;
+  }
+  return (float)(10.0 * log10(sum / sum_weight));
+}
+
+int main(void) {
+  Serial.quiet = true;
+  printf("simPinkNoiseH1: %d bands from %.0f to %.0f Hz, %.1f sec of analysis, fs = %.0f Hz, Nfft = %d\n",
+    n_freqs, start_Hz, end_Hz, analysis_sec, hostsim_fs_Hz, TF_NFFT);
+
+  bool pass = true;
+  printf("    mic noise (dB re: pink)   total (sec)   frames (lost)   max |H1 error| (dB)   min coherence   flagged\n");
+  for (float noise_rel_dB : {-60.0f, -40.0f, -20.0f}) {
+    SimTransferFunction sim;
+    sim.sys.noise_rms = pinkRms(sim.cal.noise_amp) * powf(10.0f, noise_rel_dB / 20.0f);
+    float total_sec = sim.run(start_Hz, end_Hz, n_freqs, analysis_sec);
+
+    const float step_Hz = (end_Hz - start_Hz) / (float)(n_freqs - 1);
+    float max_err_dB = 0.0f, min_coh = 1.0f;
+    int n_flagged = 0;
+    for (int i = 0; i < sim.cal.get_n_measurements(); i++) {
+      float freq_Hz = sim.cal.get_freq_Hz(i), H1_dB = sim.cal.get_right_dBFS(i) - sim.cal.get_left_dBFS(i);
+      float true_dB = trueBandGain_dB(sim.sys, sim.analyzer.getBinWidth_Hz(), freq_Hz - 0.5f * step_Hz, freq_Hz + 0.5f * step_Hz);
+      max_err_dB = max(max_err_dB, fabsf(H1_dB - true_dB));
+      min_coh = min(min_coh, sim.cal.get_coherence(i));
+      if (sim.cal.get_coherence(i) < sim.cal.min_coherence) n_flagged++;
+    }
+    printf("    %23.0f   %11.2f   %6d (%d)   %19.3f   %13.4f   %2d of %d\n", noise_rel_dB, total_sec,
+      sim.analyzer.getNFrames(), sim.analyzer.getNFramesLost(), max_err_dB, min_coh, n_flagged, sim.cal.get_n_measurements());
+
+    //with low noise, H1 must match the system; with high noise, the bands must be flagged
+    bool ok = (sim.cal.get_n_measurements() == n_freqs) && (sim.analyzer.getNFramesLost() == 0);
+    if (noise_rel_dB <= -40.0f) ok = ok && (max_err_dB < 0.5f);
+    if (noise_rel_dB >= -20.0f) ok = ok && (n_flagged > 0);
+    pass = pass && ok;
+  }
+
+  //the stepped sine on the same system, for comparison
+  float stepped_sec[2];
+  for (int adaptive = 0; adaptive < 2; adaptive++) {
+    SimSteppedSine sim;
+    sim.audio.sys.noise_rms = stepped_noise_rms;
+    sim.cal.use_adaptive_settling = (adaptive == 1);
+    stepped_sec[adaptive] = sim.run(start_Hz, end_Hz, n_freqs, step_dur_sec);
+  }
+  printf("\nThe stepped sine (%d steps, at most %.1f sec per step): %.2f sec with adaptive settling, %.2f sec with fixed steps\n",
+    n_freqs, step_dur_sec, stepped_sec[1], stepped_sec[0]);
+
+  printf("simPinkNoiseH1: %s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
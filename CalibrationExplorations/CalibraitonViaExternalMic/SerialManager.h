@@ -9,12 +9,19 @@ extern Tympan myTympan;
 extern AudioSDWriter_F32_UI audioSDWriter;
 extern float tone_freq_Hz;
 extern float tone_amp_dB;
+extern int n_parallel_tones;
+extern float step_dur_sec;
 
 //Extern Functions
 extern float incrementFrequency(float incr_Hz);
 extern float incrementAmplitude(float incr_dB);
 extern bool muteTone(bool set_mute);
 extern int switchState(int new_state);
+extern int incrementParallelTones(int incr);
+extern bool enableAdaptiveSettling(bool enable);
+extern CalibrationSteppedSine calSteppedSine;
+extern bool saveCalibrationTable(void);
+extern bool loadCalibrationTable(void);
 extern void writeTextToSD(String myString);  //for writing a text log to the SD card
 
 class SerialManager : public SerialManagerBase  {  // see Tympan_Library for SerialManagerBase for more functions!
@@ -36,6 +43,11 @@ void SerialManager::printHelp(void) {
   Serial.println("  h: print this help");
   Serial.println("  w/W/e: Switch between PCB Mics (w) and Line-in on Mic Jack (W) and one of each (e)");
   Serial.println("  u/t/T: Testing Off, Manual, or Automatic Tones.");
+  Serial.println("  p: Automatic Multitone (" + String(n_parallel_tones) + " tones at once)");
+  Serial.println("  P: Automatic Transfer Function (pink noise, all frequencies at once)");
+  Serial.println("  n/N: incr/decrease the number of tones at once (currently: " + String(n_parallel_tones) + ")");
+  Serial.println("  d/D: Automatic Tones: step when settled (d) or after a fixed time (D) (currently: " + String(calSteppedSine.use_adaptive_settling ? "settled" : "fixed") + ")");
+  Serial.println("  k/K: save the last calibration to the SD card (k) or read it back (K)");
   Serial.println(" Test Tones: (no prefix)");
   Serial.println("  f/F: incr/decrease the frequency (currently: " + String(tone_freq_Hz/1000,1) + " kHz)");
   Serial.println("  a/A: incr/decrease the amplitude (currently: " + String(tone_amp_dB,1) + " dB)");
@@ -108,6 +120,36 @@ bool SerialManager::processCharacter(char c) { //this is called by SerialManager
       Serial.println("Swithing to AUTOMATIC test mode.");
       switchState(STATE_AUTOMATIC);
       break;   
+   case 'p':
+      Serial.println("Switching to MULTITONE test mode.");
+      switchState(STATE_MULTITONE);
+      break;
+   case 'P':
+      Serial.println("Switching to TRANSFER FUNCTION test mode.");
+      switchState(STATE_TRANSFER_FUNCTION);
+      break;
+   case 'n':
+      Serial.println("Changing number of tones at once to " + String(incrementParallelTones(1)));
+      break;
+   case 'N':
+      Serial.println("Changing number of tones at once to " + String(incrementParallelTones(-1)));
+      break;
+   case 'd':
+      enableAdaptiveSettling(true);
+      Serial.println("Automatic Tones: each step ends once the levels have settled (or after " + String(step_dur_sec,1) + " sec)");
+      break;
+   case 'D':
+      enableAdaptiveSettling(false);
+      Serial.println("Automatic Tones: each step takes " + String(step_dur_sec,1) + " sec");
+      break;
+   case 'k':
+      Serial.println("Saving the calibration table to the SD card...");
+      saveCalibrationTable();
+      break;
+   case 'K':
+      Serial.println("Reading the calibration table from the SD card...");
+      loadCalibrationTable();
+      break;
   }
   return ret_val;
 }
@@ -10,11 +10,13 @@ AudioTestSignalGenerator_F32  audioTestGenerator(audio_settings); //keep this to
 AudioEffectAFC_BTNRH_F32   feedbackCancel(audio_settings), feedbackCancelR(audio_settings);  //original adaptive feedback cancelation from BTNRH
 AudioFilterBiquad_F32      bpFilt[2][N_CHAN_MAX];         //here are the filters to break up the audio into multiple bands
 AudioConfigIIRFilterBank_F32 filterBankCalculator(audio_settings);  //this computes the filter coefficients
+AudioFilterbankPolyphaseDFT_F32 polyFilt[2];                   //alternative to bpFilt (see myState.filterbank_type).  Only one of the two is running.
 //AudioFilterIIR_F32         bpFilt[2][N_CHAN_MAX];           //here are the filters to break up the audio into multiple bands
-AudioEffectDelay_F32       postFiltDelay[2][N_CHAN_MAX];  //Here are the delay modules that we'll use to time-align the output of the filters
-AudioEffectCompWDRC_F32    expCompLim[2][N_CHAN_MAX];     //here are the per-band compressors
+AudioEffectMultiBandDelay_F32 postFiltDelay[2];          //time-aligns (and polarity-corrects) the output of the filters.  One object per ear, all bands share one buffer
+AudioEffectCompWDRC_Local_F32 expCompLim[2][N_CHAN_MAX];  //here are the per-band compressors (with optional control-rate gain updates)
 AudioSummer8_F32            mixerFilterBank[2];                     //mixer to reconstruct the broadband audio
-AudioEffectCompWDRC_F32    compBroadband[2];              //broad band compressor
+AudioEffectCompWDRC_Local_F32 compBroadband[2];           //broad band compressor (with optional control-rate gain updates)
+AudioEffectCompWDRC_StereoLink_F32 wdrcLink[N_CHAN_MAX], compBroadbandLink;  //when RUN_STEREO, links the left and right compressors (see setWDRCLinkWeight())
 AudioEffectFeedbackCancel_LoopBack_Local_F32 feedbackLoopBack(audio_settings), feedbackLoopBackR(audio_settings);
 AudioSDWriter_F32             audioSDWriter(audio_settings); //this is stereo by default
 AudioOutputI2SQuad_F32      i2s_out(audio_settings);    //Digital audio output to the DAC.  Should be last.
@@ -102,15 +104,29 @@ int makeAudioConnections(void) { //call this in setup() or somewhere like that
           patchCord[count++] = new AudioConnection_F32(preFilterR, 0, bpFilt[Iear][Iband], 0); //input is coming directly from i2s_in
         #endif
       }
-      #if 0
-        //use the post-filter delays
-        patchCord[count++] = new AudioConnection_F32(bpFilt[Iear][Iband], 0, postFiltDelay[Iear][Iband], 0);  //connect to delay
-        patchCord[count++] = new AudioConnection_F32(postFiltDelay[Iear][Iband], 0, expCompLim[Iear][Iband], 0); //connect to per-band compressor
-      #else
-        //do not use the post-filter delays
-        patchCord[count++] = new AudioConnection_F32(bpFilt[Iear][Iband], 0, expCompLim[Iear][Iband], 0); //connect to per-band compressor
-      #endif
-      patchCord[count++] = new AudioConnection_F32(expCompLim[Iear][Iband], 0, mixerFilterBank[Iear], Iband); //connect to mixer
+      //the polyphase filterbank feeds the alternate inputs of the delay block (only one filterbank is running at a time)
+      if (Iband == 0) {
+        patchCord[count++] = new AudioConnection_F32((Iear == LEFT) ? feedbackCancel : feedbackCancelR, 0, polyFilt[Iear], 0);
+      }
+      patchCord[count++] = new AudioConnection_F32(polyFilt[Iear], Iband, postFiltDelay[Iear], MULTIBAND_DELAY_MAX_CHAN + Iband);
+
+      if (RUN_STEREO) {
+        //go through the stereo link, which calls the per-band compressors for both ears
+        wdrcLink[Iband].setCompressors(&(expCompLim[LEFT][Iband]), &(expCompLim[RIGHT][Iband]));
+        patchCord[count++] = new AudioConnection_F32(bpFilt[Iear][Iband], 0, postFiltDelay[Iear], Iband);  //connect to delay
+        patchCord[count++] = new AudioConnection_F32(postFiltDelay[Iear], Iband, wdrcLink[Iband], Iear); //connect to linked per-band compressor
+        patchCord[count++] = new AudioConnection_F32(wdrcLink[Iband], Iear, mixerFilterBank[Iear], Iband); //connect to mixer
+      } else {
+        #if 1
+          //use the post-filter delays
+          patchCord[count++] = new AudioConnection_F32(bpFilt[Iear][Iband], 0, postFiltDelay[Iear], Iband);  //connect to delay
+          patchCord[count++] = new AudioConnection_F32(postFiltDelay[Iear], Iband, expCompLim[Iear][Iband], 0); //connect to per-band compressor
+        #else
+          //do not use the post-filter delays
+          patchCord[count++] = new AudioConnection_F32(bpFilt[Iear][Iband], 0, expCompLim[Iear][Iband], 0); //connect to per-band compressor
+        #endif
+        patchCord[count++] = new AudioConnection_F32(expCompLim[Iear][Iband], 0, mixerFilterBank[Iear], Iband); //connect to mixer
+      }
 
       //make the connection for the audio test measurements
       if (Iear == LEFT) {
@@ -119,34 +135,44 @@ int makeAudioConnections(void) { //call this in setup() or somewhere like that
     }
 
     //connect the output of the mixers to the final broadband compressor
-    patchCord[count++] = new AudioConnection_F32(mixerFilterBank[Iear], 0, compBroadband[Iear], 0);  //connect to final limiter
+    if (RUN_STEREO) {
+      compBroadbandLink.setCompressors(&(compBroadband[LEFT]), &(compBroadband[RIGHT]));
+      patchCord[count++] = new AudioConnection_F32(mixerFilterBank[Iear], 0, compBroadbandLink, Iear);  //connect to linked final limiter
+    } else {
+      patchCord[count++] = new AudioConnection_F32(mixerFilterBank[Iear], 0, compBroadband[Iear], 0);  //connect to final limiter
+    }
   }
 
+  //where does the output of the broadband compressor come from?
+  AudioStream_F32 *bbOut[2] = {&(compBroadband[LEFT]), &(compBroadband[RIGHT])};
+  int bbOutChan[2] = {0, 0};
+  if (RUN_STEREO) { bbOut[LEFT] = bbOut[RIGHT] = &compBroadbandLink; bbOutChan[LEFT] = LEFT; bbOutChan[RIGHT] = RIGHT; }
+
   //connect the loop back to the adaptive feedback canceller
   feedbackLoopBack.setTargetAFC(&feedbackCancel);   //left ear
   if (RUN_STEREO) feedbackLoopBackR.setTargetAFC(&feedbackCancelR); //right ear
   
   #if 1  // set to zero to disable the adaptive feedback canceler
-    patchCord[count++] = new AudioConnection_F32(compBroadband[LEFT], 0, feedbackLoopBack, 0); //loopback to the adaptive feedback canceler
-    patchCord[count++] = new AudioConnection_F32(compBroadband[RIGHT], 0, feedbackLoopBackR, 0); //loopback to the adaptive feedback canceler
+    patchCord[count++] = new AudioConnection_F32(*bbOut[LEFT], bbOutChan[LEFT], feedbackLoopBack, 0); //loopback to the adaptive feedback canceler
+    patchCord[count++] = new AudioConnection_F32(*bbOut[RIGHT], bbOutChan[RIGHT], feedbackLoopBackR, 0); //loopback to the adaptive feedback canceler
   #endif
 
   //send the audio out
-  patchCord[count++] = new AudioConnection_F32(compBroadband[LEFT], 0, i2s_out, OUTPUT_LEFT_EARPIECE); //send to left earpiece
-  patchCord[count++] = new AudioConnection_F32(compBroadband[LEFT], 0, i2s_out, OUTPUT_LEFT_TYMPAN);   //send same audio to left of Tympan's headphone jack
+  patchCord[count++] = new AudioConnection_F32(*bbOut[LEFT], bbOutChan[LEFT], i2s_out, OUTPUT_LEFT_EARPIECE); //send to left earpiece
+  patchCord[count++] = new AudioConnection_F32(*bbOut[LEFT], bbOutChan[LEFT], i2s_out, OUTPUT_LEFT_TYMPAN);   //send same audio to left of Tympan's headphone jack
   
   if (RUN_STEREO) {
-    patchCord[count++] = new AudioConnection_F32(compBroadband[RIGHT], 0, i2s_out, OUTPUT_RIGHT_EARPIECE); //send to right earpiece
-    patchCord[count++] = new AudioConnection_F32(compBroadband[RIGHT], 0, i2s_out, OUTPUT_RIGHT_TYMPAN);   //send same audio to right of Tympan's headphone jack
+    patchCord[count++] = new AudioConnection_F32(*bbOut[RIGHT], bbOutChan[RIGHT], i2s_out, OUTPUT_RIGHT_EARPIECE); //send to right earpiece
+    patchCord[count++] = new AudioConnection_F32(*bbOut[RIGHT], bbOutChan[RIGHT], i2s_out, OUTPUT_RIGHT_TYMPAN);   //send same audio to right of Tympan's headphone jack
   } else {
     //copy mono audio to other channel to present in both ears   
-    patchCord[count++] = new AudioConnection_F32(compBroadband[LEFT], 0, i2s_out, OUTPUT_RIGHT_EARPIECE); 
-    patchCord[count++] = new AudioConnection_F32(compBroadband[LEFT], 0, i2s_out, OUTPUT_RIGHT_TYMPAN); 
+    patchCord[count++] = new AudioConnection_F32(*bbOut[LEFT], bbOutChan[LEFT], i2s_out, OUTPUT_RIGHT_EARPIECE); 
+    patchCord[count++] = new AudioConnection_F32(*bbOut[LEFT], bbOutChan[LEFT], i2s_out, OUTPUT_RIGHT_TYMPAN); 
   }
   
   //make the last connections for the audio test measurements and SD writer
   patchCord[count++] = new AudioConnection_F32(audioTestGenerator, 0, audioTestMeasurement, 0);
-  patchCord[count++] = new AudioConnection_F32(compBroadband[LEFT], 0, audioTestMeasurement, 1);
+  patchCord[count++] = new AudioConnection_F32(*bbOut[LEFT], bbOutChan[LEFT], audioTestMeasurement, 1);
   patchCord[count++] = new AudioConnection_F32(leftRightMixer[LEFT], 0, audioSDWriter, 0); 
   patchCord[count++] = new AudioConnection_F32(i2s_out, OUTPUT_LEFT_EARPIECE, audioSDWriter, 1);
     
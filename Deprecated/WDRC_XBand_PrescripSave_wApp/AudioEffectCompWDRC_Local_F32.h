@@ -0,0 +1,275 @@
+
+#ifndef _AudioEffectCompWDRC_Local_F32_h
+#define _AudioEffectCompWDRC_Local_F32_h
+
+#include <Tympan_Library.h>  //for AudioEffectCompWDRC_F32
+
+//Purpose: Extend the library's WDRC compressor with a "control-rate" mode.  The attack and release
+//   times of the WDRC (5 msec / 300 msec in GHA_Constants.h) are slow compared to the sample rate,
+//   yet the library version computes the envelope and the gain curve for every sample.  In control-rate
+//   mode, the envelope and the gain are only computed once every N samples.  The gain is then linearly
+//   interpolated across the N samples so that there is no zipper noise.
+//
+//   Set N (the "control decimation") to 1 to get the original per-sample behavior.
+//
+//   The envelope in control-rate mode is fed by the peak of |x| over each N-sample segment, and the
+//   smoothing uses the same ANSI attack/release conversion as AudioCalcEnvelope_F32, just evaluated at the
+//   reduced rate (fs / N).  So, the attack/release times are preserved.
+//
+//   To see how much the control-rate gain deviates from the per-sample gain, enable the deviation monitor.
+//   It runs the original per-sample calculation in parallel (so it costs *more* CPU while it is enabled)
+//   and tracks the max and the mean deviation in dB.
+
+#ifndef MAX_WDRC_CONTROL_DECIMATION
+#define MAX_WDRC_CONTROL_DECIMATION 32
+#endif
+
+class AudioEffectCompWDRC_Local_F32 : public AudioEffectCompWDRC_F32 {
+  public:
+    //constructor
+    AudioEffectCompWDRC_Local_F32(void) : AudioEffectCompWDRC_F32() { }
+    AudioEffectCompWDRC_Local_F32(const AudioSettings_F32 &settings) : AudioEffectCompWDRC_F32(settings) {
+      sample_rate_Hz = settings.sample_rate_Hz;
+    }
+
+    //here is the method called automatically by the audio library
+    virtual void update(void) {
+      //if we're not decimating and not monitoring, just use the library's per-sample processing
+      if ((control_decimation <= 1) && (!enable_deviation_monitor)) {
+        AudioEffectCompWDRC_F32::update();
+        return;
+      }
+
+      //receive the input audio data
+      audio_block_f32_t *block = AudioStream_F32::receiveReadOnly_f32();
+      if (!block) return;
+
+      //allocate memory for the output of our algorithm
+      audio_block_f32_t *out_block = AudioStream_F32::allocate_f32();
+      if (!out_block) { AudioStream_F32::release(block); return; }
+
+      //do the algorithm
+      compress_controlRate(block->data, out_block->data, block->length);
+      out_block->id = block->id;
+      out_block->length = block->length;
+
+      //transmit the block and release memory
+      AudioStream_F32::transmit(out_block);
+      AudioStream_F32::release(out_block);
+      AudioStream_F32::release(block);
+    }
+
+    //here is the method that does the work when in control-rate mode
+    void compress_controlRate(float *x, float *y, const int n) {
+      float gain[AUDIO_BLOCK_SAMPLES];
+      const int n_use = min(n, AUDIO_BLOCK_SAMPLES);
+      calcGain_controlRate(x, gain, n_use);
+      for (int k = 0; k < n_use; k++) y[k] = x[k] * gain[k];
+
+      //if asked, compare against the original per-sample gain
+      if (enable_deviation_monitor) updateDeviationMonitor(x, gain, n_use);
+    }
+
+    //process a block without going through the audio library (used by AudioEffectCompWDRC_StereoLink_F32)
+    void processBlock(float *x, float *y, const int n) {
+      if ((control_decimation <= 1) && (!enable_deviation_monitor)) {
+        compress(x, y, n);  //the library's per-sample processing
+      } else {
+        compress_controlRate(x, y, n);
+      }
+    }
+
+    //compute this compressor's gain (linear) from a given detector signal instead of from the audio itself.
+    //This is used when two compressors are linked (see AudioEffectCompWDRC_StereoLink_F32).  It takes the same
+    //path as processBlock(), so the control decimation and the deviation monitor work when linked, too.
+    void calcGainFromDetector(float *det, float *gain, const int n) {
+      const int n_use = min(n, AUDIO_BLOCK_SAMPLES);
+      if ((control_decimation <= 1) && (!enable_deviation_monitor)) {
+        float env[AUDIO_BLOCK_SAMPLES];
+        calcEnvelope.smooth_env(det, env, n_use);
+        calcGain.calcGainFromEnvelope(env, gain, n_use);
+      } else {
+        calcGain_controlRate(det, gain, n_use);
+        if (enable_deviation_monitor) updateDeviationMonitor(det, gain, n_use);
+      }
+    }
+
+    //When this compressor's gain is being computed by another compressor (fully linked), run just our envelope on the
+    //same detector signal so that it is in step when we compute our own gain again.  applied_gain is the last gain
+    //that our ear got (linear), which is where our next control-rate interpolation starts.  No gain curve is computed.
+    void trackDetector(float *det, const int n, float applied_gain) {
+      const int n_use = min(n, AUDIO_BLOCK_SAMPLES);
+      if ((control_decimation <= 1) || enable_deviation_monitor) {
+        float env[AUDIO_BLOCK_SAMPLES];
+        calcEnvelope.smooth_env(det, env, n_use);
+      }
+      if ((control_decimation > 1) || enable_deviation_monitor) {
+        float seg_env[AUDIO_BLOCK_SAMPLES];
+        calcControlEnvelope(det, seg_env, n_use);
+        prev_gain = applied_gain;
+      }
+    }
+
+    //Override the parameter setting so that we can keep our control-rate coefficients in sync
+    void setSampleRate_Hz(const float _fs_Hz) {
+      AudioEffectCompWDRC_F32::setSampleRate_Hz(_fs_Hz);
+      sample_rate_Hz = _fs_Hz;
+      updateControlRateCoeff();
+    }
+    void setParams(float attack_ms, float release_ms, float maxdB, float exp_cr, float exp_end_knee, float tkgain, float comp_ratio, float tk, float bolt) {
+      AudioEffectCompWDRC_F32::setParams(attack_ms, release_ms, maxdB, exp_cr, exp_end_knee, tkgain, comp_ratio, tk, bolt);
+      attack_msec = attack_ms;
+      release_msec = release_ms;
+      updateControlRateCoeff();
+    }
+
+    //set how many samples between updates of the envelope and gain (1 = every sample, the original behavior)
+    int setControlDecimation(int N) {
+      N = max(1, min(MAX_WDRC_CONTROL_DECIMATION, N));
+      AudioNoInterrupts();  //update() must not run with half of the state switched over
+      if (!enable_deviation_monitor) {  //(with the monitor on, the control-rate path is running even when N = 1)
+        if ((control_decimation <= 1) && (N > 1)) {
+          startFromLibraryState();  //we're leaving the library's per-sample processing
+        } else if ((control_decimation > 1) && (N <= 1)) {
+          //we're going back to it, but its envelope wasn't updated while we were decimating
+          setLibraryEnvelope(ctrl_env);
+        }
+      }
+      control_decimation = N;
+      updateControlRateCoeff();
+      AudioInterrupts();
+      return control_decimation;
+    }
+    int getControlDecimation(void) { return control_decimation; }
+
+    //the library's version reports the per-sample envelope, which is not updated in control-rate mode
+    float getCurrentLevel_dB(void) {
+      if (control_decimation <= 1) return AudioEffectCompWDRC_F32::getCurrentLevel_dB();
+      return 20.0f * log10f(max(ctrl_env, 1.0e-12f));
+    }
+
+    //methods for measuring the deviation of the control-rate gain from the per-sample gain
+    bool setEnableDeviationMonitor(bool enable) {
+      AudioNoInterrupts();
+      if (enable && !enable_deviation_monitor) {
+        resetDeviationMonitor();
+        if (control_decimation <= 1) startFromLibraryState();  //the control-rate path takes over from the library's
+      }
+      enable_deviation_monitor = enable;  //(when turned off, the library's envelope is current: the monitor ran it)
+      AudioInterrupts();
+      return enable_deviation_monitor;
+    }
+    bool getEnableDeviationMonitor(void) { return enable_deviation_monitor; }
+    void resetDeviationMonitor(void) { max_deviation_dB = 0.0f; sum_deviation_dB = 0.0; n_deviation_samples = 0; }
+    float getMaxDeviation_dB(void) { return max_deviation_dB; }
+    float getMeanDeviation_dB(void) { return (n_deviation_samples > 0) ? (float)(sum_deviation_dB / (double)n_deviation_samples) : 0.0f; }
+
+  protected:
+    int control_decimation = 1;    //1 is the original per-sample processing
+    float sample_rate_Hz = AUDIO_SAMPLE_RATE_EXACT;
+    float attack_msec = 5.0f, release_msec = 50.0f;
+    float ctrl_alfa = 0.0f, ctrl_beta = 0.0f;   //envelope smoothing coefficients at the control rate
+    float ctrl_env = 0.0f;                      //envelope state at the control rate
+    float prev_gain = 1.0f;                     //gain at the end of the previous segment (linear, not dB)
+
+    bool enable_deviation_monitor = false;
+    float max_deviation_dB = 0.0f;
+    double sum_deviation_dB = 0.0;
+    unsigned long n_deviation_samples = 0;
+
+    //same conversion as AudioCalcEnvelope_F32::setAttackRelease_msec(), but at the control rate
+    void updateControlRateCoeff(void) {
+      float ctrl_rate_Hz = sample_rate_Hz / ((float)max(1, control_decimation));
+      float ansi_atk = 0.001f * attack_msec * ctrl_rate_Hz / 2.425f;
+      float ansi_rel = 0.001f * release_msec * ctrl_rate_Hz / 1.782f;
+      ctrl_alfa = (float)(ansi_atk / (1.0f + ansi_atk));
+      ctrl_beta = (float)(ansi_rel / (10.0f + ansi_rel));
+    }
+
+    //when the control-rate path takes over from the library's per-sample path, pick up where it left off: the same
+    //envelope, and the same gain to start the interpolation from
+    void startFromLibraryState(void) {
+      ctrl_env = calcEnvelope.getCurrentLevel();
+      calcGain.calcGainFromEnvelope(&ctrl_env, &prev_gain, 1);
+    }
+
+    //AudioCalcEnvelope_F32 has no way to set its level, so drive it there: let it release on silence until it is at or
+    //below the target (at most one second's worth), and then one attack step brings it up to the target
+    void setLibraryEnvelope(float target) {
+      float buff[AUDIO_BLOCK_SAMPLES], env[AUDIO_BLOCK_SAMPLES];
+      float ansi_rel = 0.001f * release_msec * sample_rate_Hz / 1.782f, beta = ansi_rel / (10.0f + ansi_rel);
+      float ansi_atk = 0.001f * attack_msec * sample_rate_Hz / 2.425f, alfa = ansi_atk / (1.0f + ansi_atk);
+      float cur_env = calcEnvelope.getCurrentLevel();
+      if (cur_env > target) {
+        int n_release = (int)ceilf(logf(max(target, 1.0e-12f) / cur_env) / logf(beta));
+        n_release = min(n_release, (int)sample_rate_Hz);
+        for (int k = 0; k < AUDIO_BLOCK_SAMPLES; k++) buff[k] = 0.0f;
+        while (n_release > 0) {
+          int n = min(n_release, AUDIO_BLOCK_SAMPLES);
+          calcEnvelope.smooth_env(buff, env, n);
+          n_release -= n;
+        }
+        cur_env = calcEnvelope.getCurrentLevel();
+      }
+      if (cur_env < target) {
+        buff[0] = (target - alfa * cur_env) / (1.0f - alfa);
+        calcEnvelope.smooth_env(buff, env, 1);
+      }
+    }
+
+    //find the envelope, one value per segment of control_decimation samples.  Returns the number of segments.
+    int calcControlEnvelope(float *det, float *seg_env, const int n) {
+      const int N = max(1, control_decimation);
+      const int n_seg = min((n + N - 1) / N, AUDIO_BLOCK_SAMPLES);
+      int k = 0;
+      for (int Iseg = 0; Iseg < n_seg; Iseg++) {
+        int k_end = min(k + N, n);
+        float seg_peak = 0.0f;
+        for (; k < k_end; k++) seg_peak = max(seg_peak, fabsf(det[k]));
+        if (seg_peak >= ctrl_env) {
+          ctrl_env = ctrl_alfa * ctrl_env + (1.0f - ctrl_alfa) * seg_peak;
+        } else {
+          ctrl_env = ctrl_beta * ctrl_env;
+        }
+        seg_env[Iseg] = ctrl_env;
+      }
+      return n_seg;
+    }
+
+    //the gain at the control rate, linearly interpolated back up to one value per sample
+    void calcGain_controlRate(float *det, float *gain, const int n) {
+      const int N = max(1, control_decimation);
+      float seg_env[AUDIO_BLOCK_SAMPLES], seg_gain[AUDIO_BLOCK_SAMPLES];
+      const int n_seg = calcControlEnvelope(det, seg_env, n);
+
+      //compute the gain, one value per segment, via the library's gain curve
+      calcGain.calcGainFromEnvelope(seg_env, seg_gain, n_seg);
+
+      //interpolate between the control points
+      int k = 0;
+      float g = prev_gain;
+      for (int Iseg = 0; Iseg < n_seg; Iseg++) {
+        int k_end = min(k + N, n);
+        float dg = (seg_gain[Iseg] - prev_gain) / ((float)(k_end - k));
+        for (; k < k_end; k++) { g += dg; gain[k] = g; }
+        g = prev_gain = seg_gain[Iseg];  //avoid the accumulation of rounding errors
+      }
+    }
+
+    //run the library's per-sample envelope and gain in parallel and compare to the gain that we applied.  The detector
+    //is the audio itself, unless linked (see calcGainFromDetector())
+    void updateDeviationMonitor(float *det, float *applied_gain, const int n) {
+      float env[AUDIO_BLOCK_SAMPLES], ref_gain[AUDIO_BLOCK_SAMPLES];
+      int n_use = min(n, AUDIO_BLOCK_SAMPLES);
+      calcEnvelope.smooth_env(det, env, n_use);
+      calcGain.calcGainFromEnvelope(env, ref_gain, n_use);
+      for (int k = 0; k < n_use; k++) {
+        float dev_dB = fabsf(20.0f * log10f(max(applied_gain[k], 1.0e-12f) / max(ref_gain[k], 1.0e-12f)));
+        max_deviation_dB = max(max_deviation_dB, dev_dB);
+        sum_deviation_dB += (double)dev_dB;
+        n_deviation_samples++;
+      }
+    }
+};
+
+#endif
@@ -0,0 +1,125 @@
+
+#ifndef _AudioEffectCompWDRC_StereoLink_F32_h
+#define _AudioEffectCompWDRC_StereoLink_F32_h
+
+#include <Tympan_Library.h>
+#include "AudioEffectCompWDRC_Local_F32.h"
+
+//Purpose: Link the left and right WDRC compressors so that both ears get the same (or a similar) gain.
+//   When the two ears compress independently, the louder ear gets turned down more than the quieter ear,
+//   which shrinks the interaural level difference (ILD) that the listener uses for localization.
+//
+//   Input 0 / Output 0 is the left ear.  Input 1 / Output 1 is the right ear.  The actual compression is done
+//   by calling into the two AudioEffectCompWDRC_Local_F32 instances given to setCompressors(), so they hold
+//   all of the compression settings as usual (they should not be connected into the audio graph themselves).
+//
+//   The link weight (0.0 to 1.0) sets how much each ear's compressor listens to the other ear:
+//     * 0.0: independent.  Each ear is compressed by its own compressor, just as if there were no link.
+//     * 0.0 < w < 1.0: each ear's detector is max(|own ear|, w*|other ear|).  Two envelopes, two gains.
+//     * 1.0: fully linked.  One envelope from max(|left|,|right|) and one gain, computed with the LEFT
+//            compressor's settings, are applied to both ears.  This is half of the envelope/gain work.
+//            If the two ears have different prescriptions, use a weight below 1.0 instead.  The RIGHT compressor's
+//            envelope still follows the same detector (but without its gain curve), so that it is current when the
+//            weight is lowered again.
+//
+//   In every mode, the compressors use their own control decimation (and deviation monitor), same as when not linked.
+//
+//   To verify the ILD preservation, turn on the ILD monitor (setEnableILDMonitor()), which accumulates the input and output
+//   ILD (left re: right, dB).  See getILD_in_dB() and getILD_out_dB().  It is off by default because it costs CPU.  The
+//   CPU (cpu_cycles) of this class includes the work done by the two compressors (and the ILD monitor, if it is on).
+
+class AudioEffectCompWDRC_StereoLink_F32 : public AudioStream_F32 {
+  //GUI: inputs:2, outputs:2  //this line used for automatic generation of GUI node
+  public:
+    AudioEffectCompWDRC_StereoLink_F32(void) : AudioStream_F32(2, inputQueueArray_f32) { }
+    AudioEffectCompWDRC_StereoLink_F32(const AudioSettings_F32 &settings) : AudioStream_F32(2, inputQueueArray_f32) { }
+
+    void setCompressors(AudioEffectCompWDRC_Local_F32 *left, AudioEffectCompWDRC_Local_F32 *right) { comp[0] = left; comp[1] = right; }
+    float setLinkWeight(float w) { return link_weight = max(0.0f, min(1.0f, w)); }
+    float getLinkWeight(void) { return link_weight; }
+
+    //here is the method called automatically by the audio library
+    virtual void update(void) {
+      audio_block_f32_t *in_L = AudioStream_F32::receiveReadOnly_f32(0);
+      audio_block_f32_t *in_R = AudioStream_F32::receiveReadOnly_f32(1);
+      if ((!in_L) || (!in_R) || (!comp[0]) || (!comp[1])) {
+        if (in_L) AudioStream_F32::release(in_L);
+        if (in_R) AudioStream_F32::release(in_R);
+        return;
+      }
+
+      //allocate memory for the output of our algorithm
+      audio_block_f32_t *out_L = AudioStream_F32::allocate_f32();
+      audio_block_f32_t *out_R = AudioStream_F32::allocate_f32();
+      if ((!out_L) || (!out_R)) {
+        if (out_L) AudioStream_F32::release(out_L);
+        if (out_R) AudioStream_F32::release(out_R);
+        AudioStream_F32::release(in_L); AudioStream_F32::release(in_R);
+        return;
+      }
+
+      //do the algorithm
+      int n = min(in_L->length, in_R->length);
+      compressLinked(in_L->data, in_R->data, out_L->data, out_R->data, n);
+      out_L->id = in_L->id; out_L->length = n;
+      out_R->id = in_R->id; out_R->length = n;
+
+      //transmit the blocks and release memory
+      AudioStream_F32::transmit(out_L, 0);
+      AudioStream_F32::transmit(out_R, 1);
+      AudioStream_F32::release(out_L); AudioStream_F32::release(out_R);
+      AudioStream_F32::release(in_L); AudioStream_F32::release(in_R);
+    }
+
+    void compressLinked(float *xL, float *xR, float *yL, float *yR, const int n) {
+      if (link_weight <= 0.0f) {
+        //independent
+        comp[0]->processBlock(xL, yL, n);
+        comp[1]->processBlock(xR, yR, n);
+      } else if (link_weight >= 1.0f) {
+        //fully linked: one envelope, one gain
+        float det[AUDIO_BLOCK_SAMPLES], gain[AUDIO_BLOCK_SAMPLES];
+        for (int i = 0; i < n; i++) det[i] = max(fabsf(xL[i]), fabsf(xR[i]));
+        comp[0]->calcGainFromDetector(det, gain, n);
+        for (int i = 0; i < n; i++) { yL[i] = xL[i] * gain[i]; yR[i] = xR[i] * gain[i]; }
+        if (n > 0) comp[1]->trackDetector(det, n, gain[n-1]);  //keep the right envelope current for when the link is lowered
+      } else {
+        //cross-weighted: each ear hears some of the other ear
+        float det[AUDIO_BLOCK_SAMPLES], gain[AUDIO_BLOCK_SAMPLES];
+        for (int i = 0; i < n; i++) det[i] = max(fabsf(xL[i]), link_weight * fabsf(xR[i]));
+        comp[0]->calcGainFromDetector(det, gain, n);
+        for (int i = 0; i < n; i++) yL[i] = xL[i] * gain[i];
+        for (int i = 0; i < n; i++) det[i] = max(fabsf(xR[i]), link_weight * fabsf(xL[i]));
+        comp[1]->calcGainFromDetector(det, gain, n);
+        for (int i = 0; i < n; i++) yR[i] = xR[i] * gain[i];
+      }
+      if (enable_ILD_monitor) updateILD(xL, xR, yL, yR, n);
+    }
+
+    //methods for measuring how well the interaural level difference is preserved
+    bool setEnableILDMonitor(bool enable) { if (enable && !enable_ILD_monitor) resetILDMonitor(); return enable_ILD_monitor = enable; }
+    bool getEnableILDMonitor(void) { return enable_ILD_monitor; }
+    void resetILDMonitor(void) { for (int i = 0; i < 4; i++) sum_pow[i] = 0.0; }
+    float getILD_in_dB(void) { return ratio_dB(sum_pow[0], sum_pow[1]); }
+    float getILD_out_dB(void) { return ratio_dB(sum_pow[2], sum_pow[3]); }
+
+  protected:
+    audio_block_f32_t *inputQueueArray_f32[2];
+    AudioEffectCompWDRC_Local_F32 *comp[2] = {NULL, NULL};
+    float link_weight = 0.0f;
+
+    bool enable_ILD_monitor = false;
+    double sum_pow[4] = {0.0, 0.0, 0.0, 0.0};  //in left, in right, out left, out right
+
+    void updateILD(float *xL, float *xR, float *yL, float *yR, const int n) {
+      float acc[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+      for (int i = 0; i < n; i++) {
+        acc[0] += xL[i] * xL[i]; acc[1] += xR[i] * xR[i];
+        acc[2] += yL[i] * yL[i]; acc[3] += yR[i] * yR[i];
+      }
+      for (int i = 0; i < 4; i++) sum_pow[i] += (double)acc[i];
+    }
+    static float ratio_dB(double a, double b) { return 10.0f * log10f((float)(max(a, 1.0e-20) / max(b, 1.0e-20))); }
+};
+
+#endif
@@ -0,0 +1,118 @@
+
+#ifndef _AudioEffectMultiBandDelay_F32_h
+#define _AudioEffectMultiBandDelay_F32_h
+
+#include <Arduino.h>
+#include <AudioStream_F32.h>
+
+//Purpose: Delay (and, optionally, polarity-flip) each band of a filterbank so that the bands
+//   line up in time before they are summed back together.  Instead of using one AudioEffectDelay_F32
+//   per band (each with its own large buffer and its own trip through the audio update list), this
+//   class handles all of the bands in one object.  All of the bands share one delay buffer, which
+//   is carved up according to each band's delay.  So, the memory used is just the sum of the delays.
+//
+//   Input N goes to output N.  Input N + MULTIBAND_DELAY_MAX_CHAN is an alternate input for band N, which is used
+//   when that band's main input has no audio (such as when switching between two filterbanks, only one of which is running).
+
+#ifndef MULTIBAND_DELAY_MAX_CHAN
+#define MULTIBAND_DELAY_MAX_CHAN 8      //max number of bands
+#endif
+#ifndef MULTIBAND_DELAY_POOL_LEN
+#define MULTIBAND_DELAY_POOL_LEN 1024   //total number of delayed samples, summed across all bands
+#endif
+
+class AudioEffectMultiBandDelay_F32 : public AudioStream_F32 {
+  //GUI: inputs:16, outputs:8  //this line used for automatic generation of GUI node
+  public:
+    AudioEffectMultiBandDelay_F32(void) : AudioStream_F32(2*MULTIBAND_DELAY_MAX_CHAN, inputQueueArray_f32) { clearDelays(); }
+    AudioEffectMultiBandDelay_F32(const AudioSettings_F32 &settings) : AudioStream_F32(2*MULTIBAND_DELAY_MAX_CHAN, inputQueueArray_f32) { clearDelays(); }
+
+    //set the delay (samples) and polarity (+1.0 or -1.0) for every band at once.  Returns the number of pool samples used.
+    int setDelays(int n_chan, const int *delay_samps, const float *polarity = NULL) {
+      n_chan = max(0, min(MULTIBAND_DELAY_MAX_CHAN, n_chan));
+
+      //lay out each band's region of the shared pool
+      int new_offset[MULTIBAND_DELAY_MAX_CHAN], new_delay[MULTIBAND_DELAY_MAX_CHAN], requested_delay[MULTIBAND_DELAY_MAX_CHAN];
+      float new_scale[MULTIBAND_DELAY_MAX_CHAN];
+      int offset = 0;
+      for (int Iband = 0; Iband < MULTIBAND_DELAY_MAX_CHAN; Iband++) {
+        int d = requested_delay[Iband] = (Iband < n_chan) ? max(0, delay_samps[Iband]) : 0;
+        if ((offset + d) > MULTIBAND_DELAY_POOL_LEN) d = MULTIBAND_DELAY_POOL_LEN - offset;
+        new_offset[Iband] = offset;
+        new_delay[Iband] = d;
+        new_scale[Iband] = ((polarity != NULL) && (Iband < n_chan) && (polarity[Iband] < 0.0f)) ? -1.0f : 1.0f;
+        offset += d;
+      }
+
+      //switch over, and clear the pool so that no stale audio comes out, without update() running part way through
+      AudioNoInterrupts();
+      for (int Iband = 0; Iband < MULTIBAND_DELAY_MAX_CHAN; Iband++) {
+        band_offset[Iband] = new_offset[Iband];  band_delay[Iband] = new_delay[Iband];
+        band_index[Iband] = 0;  band_scale[Iband] = new_scale[Iband];
+      }
+      for (int i = 0; i < offset; i++) pool[i] = 0.0f;
+      pool_used = offset;
+      AudioInterrupts();
+
+      for (int Iband = 0; Iband < MULTIBAND_DELAY_MAX_CHAN; Iband++) {
+        if (new_delay[Iband] < requested_delay[Iband]) {
+          Serial.print(F("AudioEffectMultiBandDelay_F32: setDelays: *** WARNING ***: band ")); Serial.print(Iband);
+          Serial.print(F(" delay of ")); Serial.print(requested_delay[Iband]); Serial.println(F(" does not fit in the pool.  Limiting."));
+        }
+      }
+      return pool_used;
+    }
+    void clearDelays(void) {
+      for (int Iband = 0; Iband < MULTIBAND_DELAY_MAX_CHAN; Iband++) {
+        band_offset[Iband] = 0; band_delay[Iband] = 0; band_index[Iband] = 0; band_scale[Iband] = 1.0f;
+      }
+      pool_used = 0;
+    }
+    int getDelay_samps(int Iband) { return band_delay[max(0, min(MULTIBAND_DELAY_MAX_CHAN-1, Iband))]; }
+    float getPolarity(int Iband) { return band_scale[max(0, min(MULTIBAND_DELAY_MAX_CHAN-1, Iband))]; }
+    int getPoolUsed(void) { return pool_used; }
+
+    //here is the method called automatically by the audio library
+    virtual void update(void) {
+      for (int Iband = 0; Iband < MULTIBAND_DELAY_MAX_CHAN; Iband++) {
+        audio_block_f32_t *block = AudioStream_F32::receiveWritable_f32(Iband);
+        if (!block) block = AudioStream_F32::receiveWritable_f32(Iband + MULTIBAND_DELAY_MAX_CHAN);  //try the alternate input
+        if (!block) continue;
+
+        processBand(Iband, block->data, block->length);
+
+        AudioStream_F32::transmit(block, Iband);
+        AudioStream_F32::release(block);
+      }
+    }
+
+  protected:
+    audio_block_f32_t *inputQueueArray_f32[2*MULTIBAND_DELAY_MAX_CHAN];
+    float pool[MULTIBAND_DELAY_POOL_LEN];        //the one buffer shared by all bands
+    int band_offset[MULTIBAND_DELAY_MAX_CHAN];   //where each band's region starts in the pool
+    int band_delay[MULTIBAND_DELAY_MAX_CHAN];    //length of each band's region (ie, its delay in samples)
+    int band_index[MULTIBAND_DELAY_MAX_CHAN];    //read/write position within each band's region
+    float band_scale[MULTIBAND_DELAY_MAX_CHAN];  //+1.0 or -1.0 for the polarity
+    int pool_used = 0;
+
+    //delay the samples in-place via the band's region of the shared pool
+    void processBand(int Iband, float *x, int n) {
+      const float scale = band_scale[Iband];
+      const int d = band_delay[Iband];
+      if (d == 0) {
+        if (scale < 0.0f) for (int k = 0; k < n; k++) x[k] = -x[k];
+        return;
+      }
+      float *ring = pool + band_offset[Iband];
+      int ind = band_index[Iband];
+      for (int k = 0; k < n; k++) {
+        float foo = ring[ind];
+        ring[ind] = x[k];
+        x[k] = scale * foo;
+        if (++ind >= d) ind = 0;
+      }
+      band_index[Iband] = ind;
+    }
+};
+
+#endif
@@ -0,0 +1,203 @@
+#ifndef _AudioFilterbankPolyphaseDFT_F32_h
+#define _AudioFilterbankPolyphaseDFT_F32_h
+
+#include <Arduino.h>
+#include <AudioStream_F32.h>
+#include <arm_math.h>
+
+//Purpose: An alternative to the bank of IIR bandpass filters (bpFilt).  This is a uniform DFT filterbank, done
+//   as a weighted overlap-add (a polyphase DFT filterbank with one tap per branch) that is oversampled by 2.
+//   Every K/2 input samples, the last K samples are windowed and given to one K-point real FFT.  So, the FFT
+//   runs at 2/K of the sample rate, not at every sample.
+//
+//   The K/2+1 FFT bins are grouped into bands according to the DSL crossover frequencies.  Each band's output is
+//   made back into a full-rate audio signal (just like the output of an IIR bandpass filter) by an inverse DFT of
+//   only that band's bins, then windowed and overlap-added.  Together, the bands' inverse DFTs touch each bin
+//   once, so the cost depends on K, not on the number of bands.  It costs more than the IIR filters when there
+//   are only a few bands, but it hardly gets more expensive as bands are added.  Also, every band has the same
+//   (linear phase) delay, so the bands sum back together without needing any delay alignment.
+//
+//   Both windows are the square root of a periodic Hann window, which sum to one at a hop of K/2.  So, the sum of
+//   all of the bands is exactly the input delayed by getLatency_samples().
+//
+//   The bins are fs/K wide, so a bigger K resolves crossovers that are closer together (such as at the low
+//   frequencies), at the cost of more latency.  Crossovers closer than a bin are moved (see design()).
+//
+//   Output N is band N.
+
+#ifndef POLYPHASE_FB_MAX_BANDS
+#define POLYPHASE_FB_MAX_BANDS 32    //max number of output bands
+#endif
+#ifndef POLYPHASE_FB_MAX_K
+#define POLYPHASE_FB_MAX_K     128   //max number of FFT points (32, 64, or 128...must be supported by arm_rfft_fast_f32)
+#endif
+#define POLYPHASE_FB_MAX_HOP   (POLYPHASE_FB_MAX_K / 2)
+
+class AudioFilterbankPolyphaseDFT_F32 : public AudioStream_F32 {
+  //GUI: inputs:1, outputs:8  //this line used for automatic generation of GUI node
+  public:
+    AudioFilterbankPolyphaseDFT_F32(void) : AudioStream_F32(1, inputQueueArray_f32) { }
+    AudioFilterbankPolyphaseDFT_F32(const AudioSettings_F32 &settings) : AudioStream_F32(1, inputQueueArray_f32) { }
+
+    //design the filterbank.  cross_freq has n_bands-1 values.  Returns the number of bands (or -1 on error).
+    int design(int _K, const float *cross_freq, int _n_bands, float fs_Hz) {
+      if (((_K != 32) && (_K != 64) && (_K != 128)) || (_K > POLYPHASE_FB_MAX_K)) {
+        Serial.print("AudioFilterbankPolyphaseDFT_F32: design: *** ERROR ***: K must be 32, 64, or 128 (up to "); Serial.print(POLYPHASE_FB_MAX_K);
+        Serial.print("), not "); Serial.println(_K);
+        return -1;
+      }
+      is_designed = false;
+      K = _K; hop = K / 2;
+      n_bands = max(1, min(POLYPHASE_FB_MAX_BANDS, _n_bands));
+      arm_rfft_fast_init_f32(&rfft_inst, K);
+
+      //windows (the same window is used for the analysis and the synthesis) and the inverse DFT table
+      for (int m = 0; m < K; m++) {
+        win[m] = sinf(M_PI * ((float)m) / ((float)K));  //the square root of a periodic Hann window
+        cos_table[m] = cosf(2.0f * M_PI * ((float)m) / ((float)K));
+        sin_table[m] = sinf(2.0f * M_PI * ((float)m) / ((float)K));
+      }
+
+      //assign the bins to the bands.  The band edges fall halfway between bins.  Every band gets at least one bin.
+      const float bin_Hz = fs_Hz / ((float)K);
+      const int n_bins = K / 2 + 1;
+      first_bin[0] = 0;
+      for (int Iband = 1; Iband < n_bands; Iband++) {
+        int bin = (int)(cross_freq[Iband - 1] / bin_Hz + 1.0f);  //the bin whose lower edge is closest to the crossover
+        first_bin[Iband] = max(first_bin[Iband - 1] + 1, bin);
+        if (first_bin[Iband] != bin) {
+          Serial.print("AudioFilterbankPolyphaseDFT_F32: design: crossover "); Serial.print(cross_freq[Iband - 1], 0);
+          Serial.print(" Hz moved to "); Serial.print((((float)first_bin[Iband]) - 0.5f) * bin_Hz, 0); Serial.println(" Hz (bins are too wide...increase K)");
+        }
+      }
+      first_bin[n_bands] = n_bins;
+      if (first_bin[n_bands - 1] >= n_bins) {
+        Serial.print("AudioFilterbankPolyphaseDFT_F32: design: *** ERROR ***: "); Serial.print(n_bands);
+        Serial.print(" bands do not fit in "); Serial.print(n_bins); Serial.println(" bins.  Increase K.");
+        return -1;
+      }
+
+      //clear the states
+      for (int i = 0; i < POLYPHASE_FB_MAX_K; i++) frame[i] = 0.0f;
+      for (int Iband = 0; Iband < POLYPHASE_FB_MAX_BANDS; Iband++) {
+        for (int i = 0; i < POLYPHASE_FB_MAX_HOP; i++) { out_buff[Iband][i] = 0.0f; overlap[Iband][i] = 0.0f; }
+      }
+      n_new = 0;
+      is_designed = true;
+      return n_bands;
+    }
+    int getNBands(void) { return n_bands; }
+    int getNFFT(void) { return K; }
+    int getLatency_samples(void) { return K; }  //the window length (K-1) plus one sample of hand-off between hops
+
+    //use begin() and end() to turn the filterbank on and off (off means that no audio is transmitted)
+    void begin(void) { enabled = is_designed; }
+    void end(void) { enabled = false; }
+    bool isEnabled(void) { return enabled; }
+
+    //here is the method called automatically by the audio library
+    virtual void update(void) {
+      audio_block_f32_t *in_block = AudioStream_F32::receiveReadOnly_f32();
+      if (!in_block) return;
+      if (!enabled) { AudioStream_F32::release(in_block); return; }
+
+      //allocate memory for each band's output
+      audio_block_f32_t *out_blocks[POLYPHASE_FB_MAX_BANDS];
+      float *out_ptr[POLYPHASE_FB_MAX_BANDS];
+      for (int Iband = 0; Iband < n_bands; Iband++) {
+        out_blocks[Iband] = AudioStream_F32::allocate_f32();
+        if (!out_blocks[Iband]) {
+          for (int i = 0; i < Iband; i++) AudioStream_F32::release(out_blocks[i]);
+          AudioStream_F32::release(in_block);
+          return;
+        }
+        out_ptr[Iband] = out_blocks[Iband]->data;
+      }
+
+      //do the algorithm
+      processAudio(in_block->data, out_ptr, in_block->length);
+
+      //transmit the blocks and release memory
+      for (int Iband = 0; Iband < n_bands; Iband++) {
+        out_blocks[Iband]->length = in_block->length;
+        out_blocks[Iband]->id = in_block->id;
+        AudioStream_F32::transmit(out_blocks[Iband], Iband);
+        AudioStream_F32::release(out_blocks[Iband]);
+      }
+      AudioStream_F32::release(in_block);
+    }
+
+    //here is the method that does the work.  Also usable outside of the audio library (such as for benchmarking).
+    //The audio block length does not need to be a multiple of the hop.
+    void processAudio(const float *x, float **y, const int n) {
+      int i = 0;
+      while (i < n) {
+        //output the finished samples from the last hop, and take in the new samples, up to the end of this hop
+        int n_run = min(n - i, hop - n_new);
+        for (int Iband = 0; Iband < n_bands; Iband++) {
+          const float *out = out_buff[Iband] + n_new;
+          float *y_band = y[Iband] + i;
+          for (int j = 0; j < n_run; j++) y_band[j] = out[j];
+        }
+        float *new_samps = frame + (K - hop) + n_new;
+        for (int j = 0; j < n_run; j++) new_samps[j] = x[i + j];
+        i += n_run;  n_new += n_run;
+        if (n_new >= hop) { processHop(); n_new = 0; }
+      }
+    }
+
+  protected:
+    audio_block_f32_t *inputQueueArray_f32[1];
+    bool is_designed = false, enabled = false;
+    int K = 64, hop = 32, n_bands = 1;
+    float win[POLYPHASE_FB_MAX_K];                     //analysis and synthesis window
+    float cos_table[POLYPHASE_FB_MAX_K], sin_table[POLYPHASE_FB_MAX_K];
+    int first_bin[POLYPHASE_FB_MAX_BANDS + 1];         //each band's bins are first_bin[Iband] up to first_bin[Iband+1]-1
+    float frame[POLYPHASE_FB_MAX_K];                   //the last K input samples (the newest hop is still filling)
+    int n_new = 0;                                     //samples of the newest hop received so far
+    float out_buff[POLYPHASE_FB_MAX_BANDS][POLYPHASE_FB_MAX_HOP];  //finished output, one hop per band
+    float overlap[POLYPHASE_FB_MAX_BANDS][POLYPHASE_FB_MAX_HOP];   //second half of the last hop's output, to be overlap-added
+    arm_rfft_fast_instance_f32 rfft_inst;
+
+    //analyze the last K samples, then make the next hop of output for every band
+    void processHop(void) {
+      float v[POLYPHASE_FB_MAX_K], X[POLYPHASE_FB_MAX_K];
+      for (int m = 0; m < K; m++) v[m] = win[m] * frame[m];
+      for (int m = 0; m < K - hop; m++) frame[m] = frame[m + hop];  //slide to make room for the next hop
+
+      //FFT.  Output is [Re(X0), Re(X_K/2), Re(X1), Im(X1), Re(X2), Im(X2), ...]
+      arm_rfft_fast_f32(&rfft_inst, v, X, 0);
+
+      //inverse DFT of each band's bins.  Using the symmetry of cos and sin, only t = 0 to K/2 are computed:
+      //  s[t] = even[t] - odd[t] and s[K-t] = even[t] + odd[t]
+      const float scale = 1.0f / ((float)K);
+      const int mask = K - 1;
+      for (int Iband = 0; Iband < n_bands; Iband++) {
+        float even[POLYPHASE_FB_MAX_HOP + 1], odd[POLYPHASE_FB_MAX_HOP + 1];
+        int k_start = first_bin[Iband], k_end = min(first_bin[Iband + 1], K / 2);
+        float dc = (k_start == 0) ? (X[0] * scale) : 0.0f;                             //DC only counts once
+        float nyq = (first_bin[Iband + 1] > K / 2) ? (X[1] * scale) : 0.0f;            //as does Nyquist
+        for (int t = 0; t <= hop; t += 2) { even[t] = dc + nyq; odd[t] = 0.0f; }
+        for (int t = 1; t <= hop; t += 2) { even[t] = dc - nyq; odd[t] = 0.0f; }
+        if (k_start == 0) k_start = 1;
+        for (int k = k_start; k < k_end; k++) {
+          float a = 2.0f * scale * X[2 * k], b = 2.0f * scale * X[2 * k + 1];  //the bins count twice (for their negative-frequency twin)
+          int ind = 0;
+          for (int t = 0; t <= hop; t++) {
+            even[t] += a * cos_table[ind];
+            odd[t] += b * sin_table[ind];
+            ind = (ind + k) & mask;
+          }
+        }
+
+        //window and overlap-add.  The first half finishes the next hop of output.  The second half waits for the next hop.
+        float *out = out_buff[Iband], *ola = overlap[Iband];
+        out[0] = ola[0] + win[0] * (even[0] - odd[0]);
+        for (int t = 1; t < hop; t++) out[t] = ola[t] + win[t] * (even[t] - odd[t]);
+        ola[0] = win[hop] * (even[hop] - odd[hop]);
+        for (int t = 1; t < hop; t++) ola[t] = win[hop + t] * (even[hop - t] + odd[hop - t]);
+      }
+    }
+};
+
+#endif
@@ -0,0 +1,162 @@
+
+#ifndef _FilterbankAlignment_h
+#define _FilterbankAlignment_h
+
+#include <Arduino.h>
+
+//Purpose: Compute, on the Tympan, the integer delay and the polarity for each band of an IIR filterbank so
+//   that the bands sum back together with a flat magnitude response.  Without this, the phase of neighboring
+//   IIR bands disagrees in the crossover regions, which causes comb-filtering in the summed output.
+//
+//   Step 1: Compute each band's impulse response and find its peak.  Delay every band so that its peak lines
+//           up with the latest peak, and flip the polarity of any band whose peak is negative.
+//   Step 2: Refine by evaluating the summed frequency response (computed directly from the SOS coefficients)
+//           and nudging each band's delay and polarity to minimize the ripple (dB) of the summed response.
+//
+//   The SOS coefficients are in the Matlab order used by setFilterCoeff_Matlab_sos(): [b0 b1 b2 a0 a1 a2] per biquad.
+
+#define ALIGN_N_IMPULSE   256   //length of impulse response to examine for the peak (samples)
+#define ALIGN_N_LOG_FREQ  64    //number of log-spaced frequencies used to evaluate the summed response (for the low end)...
+#define ALIGN_N_FFT       512   //...plus every bin of an FFT this long, so that a notch can't fall between the points
+#define ALIGN_N_FREQ      (ALIGN_N_LOG_FREQ + ALIGN_N_FFT/2 + 1)  //max number of frequencies
+#define ALIGN_SEARCH      4     //how many samples (+/-) to search around the initial delay for each band
+#define ALIGN_N_PASSES    3     //how many passes of refinement
+
+class FilterbankAlignment {
+  public:
+    FilterbankAlignment(void) {};
+
+    //the main entry point.  Returns the ripple (max minus min, dB) of the summed response after alignment.
+    float computeDelaysAndPolarity(const float *sos, int n_chan, int n_biquad, float fs_Hz, const float *cross_freq,
+                                   int max_delay_samps, int *delay_samps, float *polarity, bool verbose = true)
+    {
+      n_chan = max(1, min(MAX_ALIGN_CHAN, n_chan));
+
+      //Step 1: align the impulse-response peaks
+      int peak_ind[MAX_ALIGN_CHAN], latest_peak = 0;
+      for (int Iband = 0; Iband < n_chan; Iband++) {
+        float peak_val = 0.0f;
+        peak_ind[Iband] = findImpulsePeak(sos + Iband * n_biquad * 6, n_biquad, &peak_val);
+        polarity[Iband] = (peak_val < 0.0f) ? -1.0f : 1.0f;
+        latest_peak = max(latest_peak, peak_ind[Iband]);
+      }
+      for (int Iband = 0; Iband < n_chan; Iband++) delay_samps[Iband] = min(max_delay_samps, latest_peak - peak_ind[Iband]);
+
+      //Step 2: refine against the summed frequency response
+      float f_lo_Hz = max(50.0f, 0.5f * cross_freq[0]);
+      float f_hi_Hz = 0.45f * fs_Hz;
+      computeBandResponses(sos, n_chan, n_biquad, fs_Hz, f_lo_Hz, f_hi_Hz);
+      float ripple_before_dB = computeRipple_dB(n_chan, delay_samps, polarity);
+      float best_ripple_dB = ripple_before_dB;
+      for (int Ipass = 0; Ipass < ALIGN_N_PASSES; Ipass++) {
+        for (int Iband = 0; Iband < n_chan; Iband++) {
+          int orig_delay = delay_samps[Iband], best_delay = orig_delay;
+          float orig_pol = polarity[Iband], best_pol = orig_pol;
+          for (int Idelay = max(0, orig_delay - ALIGN_SEARCH); Idelay <= min(max_delay_samps, orig_delay + ALIGN_SEARCH); Idelay++) {
+            for (int Ipol = 0; Ipol < 2; Ipol++) {
+              delay_samps[Iband] = Idelay;
+              polarity[Iband] = (Ipol == 0) ? orig_pol : -orig_pol;
+              float ripple_dB = computeRipple_dB(n_chan, delay_samps, polarity);
+              if (ripple_dB < best_ripple_dB) { best_ripple_dB = ripple_dB; best_delay = Idelay; best_pol = polarity[Iband]; }
+            }
+          }
+          delay_samps[Iband] = best_delay; polarity[Iband] = best_pol;
+        }
+      }
+
+      //no need for every band to be delayed...remove the common part of the delay
+      int min_delay = delay_samps[0];
+      for (int Iband = 1; Iband < n_chan; Iband++) min_delay = min(min_delay, delay_samps[Iband]);
+      for (int Iband = 0; Iband < n_chan; Iband++) delay_samps[Iband] -= min_delay;
+
+      if (verbose) {
+        Serial.print("FilterbankAlignment: delays (samples) = ");
+        for (int Iband = 0; Iband < n_chan; Iband++) { Serial.print(delay_samps[Iband]); Serial.print(", "); }
+        Serial.println();
+        Serial.print("    : polarity = ");
+        for (int Iband = 0; Iband < n_chan; Iband++) { Serial.print((polarity[Iband] < 0.0f) ? "-" : "+"); Serial.print(", "); }
+        Serial.println();
+        Serial.print("    : summed response ripple ("); Serial.print(f_lo_Hz, 0); Serial.print("-"); Serial.print(f_hi_Hz, 0);
+        Serial.print(" Hz): peak-only alignment = "); Serial.print(ripple_before_dB, 2);
+        Serial.print(" dB, refined = "); Serial.print(best_ripple_dB, 2); Serial.println(" dB");
+      }
+      return best_ripple_dB;
+    }
+
+  private:
+    static constexpr int MAX_ALIGN_CHAN = 8;
+    float freq_rad[ALIGN_N_FREQ];                  //frequencies at which the response is evaluated (rad/sample)
+    int n_freq = 0;
+    float H_re[MAX_ALIGN_CHAN][ALIGN_N_FREQ];      //complex response of each band
+    float H_im[MAX_ALIGN_CHAN][ALIGN_N_FREQ];
+
+    //run an impulse through the biquad cascade and find the biggest excursion
+    int findImpulsePeak(const float *sos, int n_biquad, float *peak_val) {
+      float state[8][2] = {{0.0f}};  //direct form II transposed, up to 8 biquads
+      n_biquad = min(n_biquad, 8);
+      int peak_ind = 0; *peak_val = 0.0f;
+      for (int k = 0; k < ALIGN_N_IMPULSE; k++) {
+        float x = (k == 0) ? 1.0f : 0.0f;
+        for (int Ibq = 0; Ibq < n_biquad; Ibq++) {
+          const float *c = sos + Ibq * 6;
+          float a0 = c[3];
+          float y = (c[0] / a0) * x + state[Ibq][0];
+          state[Ibq][0] = (c[1] / a0) * x - (c[4] / a0) * y + state[Ibq][1];
+          state[Ibq][1] = (c[2] / a0) * x - (c[5] / a0) * y;
+          x = y;
+        }
+        if (fabsf(x) > fabsf(*peak_val)) { *peak_val = x; peak_ind = k; }
+      }
+      return peak_ind;
+    }
+
+    //evaluate each band's frequency response directly from its SOS coefficients
+    void computeBandResponses(const float *sos, int n_chan, int n_biquad, float fs_Hz, float f_lo_Hz, float f_hi_Hz) {
+      n_freq = 0;
+      for (int Ifreq = 0; Ifreq < ALIGN_N_LOG_FREQ; Ifreq++) {
+        float f_Hz = f_lo_Hz * powf(f_hi_Hz / f_lo_Hz, ((float)Ifreq) / ((float)(ALIGN_N_LOG_FREQ - 1)));
+        freq_rad[n_freq++] = 2.0f * M_PI * f_Hz / fs_Hz;
+      }
+      for (int Ibin = 0; Ibin <= ALIGN_N_FFT/2; Ibin++) {
+        float f_Hz = ((float)Ibin) * fs_Hz / ((float)ALIGN_N_FFT);
+        if ((f_Hz > f_lo_Hz) && (f_Hz < f_hi_Hz)) freq_rad[n_freq++] = 2.0f * M_PI * f_Hz / fs_Hz;
+      }
+      for (int Iband = 0; Iband < n_chan; Iband++) {
+        for (int Ifreq = 0; Ifreq < n_freq; Ifreq++) {
+          float w = freq_rad[Ifreq], c1 = cosf(w), s1 = sinf(w), c2 = cosf(2.0f * w), s2 = sinf(2.0f * w);
+          float re = 1.0f, im = 0.0f;
+          for (int Ibq = 0; Ibq < n_biquad; Ibq++) {
+            const float *c = sos + (Iband * n_biquad + Ibq) * 6;
+            float num_re = c[0] + c[1] * c1 + c[2] * c2, num_im = -(c[1] * s1 + c[2] * s2);
+            float den_re = c[3] + c[4] * c1 + c[5] * c2, den_im = -(c[4] * s1 + c[5] * s2);
+            float den_mag2 = den_re * den_re + den_im * den_im;
+            float q_re = (num_re * den_re + num_im * den_im) / den_mag2;
+            float q_im = (num_im * den_re - num_re * den_im) / den_mag2;
+            float foo = re * q_re - im * q_im;
+            im = re * q_im + im * q_re;
+            re = foo;
+          }
+          H_re[Iband][Ifreq] = re; H_im[Iband][Ifreq] = im;
+        }
+      }
+    }
+
+    //ripple (max minus min, dB) of the sum of the delayed and polarity-flipped bands
+    float computeRipple_dB(int n_chan, const int *delay_samps, const float *polarity) {
+      float max_dB = -1000.0f, min_dB = 1000.0f;
+      for (int Ifreq = 0; Ifreq < n_freq; Ifreq++) {
+        float sum_re = 0.0f, sum_im = 0.0f;
+        for (int Iband = 0; Iband < n_chan; Iband++) {
+          float ph = -freq_rad[Ifreq] * (float)delay_samps[Iband];
+          float c = polarity[Iband] * cosf(ph), s = polarity[Iband] * sinf(ph);
+          sum_re += H_re[Iband][Ifreq] * c - H_im[Iband][Ifreq] * s;
+          sum_im += H_re[Iband][Ifreq] * s + H_im[Iband][Ifreq] * c;
+        }
+        float mag_dB = 10.0f * log10f(max(sum_re * sum_re + sum_im * sum_im, 1.0e-20f));
+        max_dB = max(max_dB, mag_dB); min_dB = min(min_dB, mag_dB);
+      }
+      return max_dB - min_dB;
+    }
+};
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef _HostSim_Tympan_Library_h
+#define _HostSim_Tympan_Library_h
+
+// Host (PC) stand-ins for the few Tympan_Library pieces that this sketch's WDRC and filterbank classes use, so that the
+// real classes (the headers one folder up) can be run on a PC.  Only what those classes need is here.  The audio
+// objects are run by hand, one block at a time, not by an audio interrupt.
+//
+// The WDRC envelope and gain curve follow the library's AudioCalcEnvelope_F32 (the CHAPRO peak detector) and
+// AudioCalcGainWDRC_F32 (CHAPRO's WDRC_circuit_gain()).
+
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+using std::min; using std::max;
+
+#define AUDIO_BLOCK_SAMPLES 128
+#define AUDIO_SAMPLE_RATE_EXACT 44117.64706f
+typedef float float32_t;
+
+#define F(x) (x)
+
+//the serial monitor.  Set quiet to hide the classes' own printing.
+struct HostSerial {
+  bool quiet = false;
+  void print(const char *s) { if (!quiet) fputs(s, stdout); }
+  void print(int val) { if (!quiet) printf("%d", val); }
+  void print(double val, int n_dec = 2) { if (!quiet) printf("%.*f", n_dec, val); }
+  void println(const char *s) { if (!quiet) puts(s); }
+  void println(int val) { print(val); println(); }
+  void println(double val, int n_dec = 2) { print(val, n_dec); println(); }
+  void println(void) { if (!quiet) puts(""); }
+};
+static HostSerial Serial;
+
+inline void AudioNoInterrupts(void) {}
+inline void AudioInterrupts(void) {}
+
+//the host's clock, for timing the classes (not the simulated time)
+inline unsigned long micros(void) {
+  using namespace std::chrono;
+  static auto t0 = steady_clock::now();
+  return (unsigned long)duration_cast<microseconds>(steady_clock::now() - t0).count();
+}
+
+struct AudioSettings_F32 {
+  AudioSettings_F32(float fs, int n) : sample_rate_Hz(fs), audio_block_samples(n) {}
+  float sample_rate_Hz;
+  int audio_block_samples;
+};
+struct audio_block_f32_t { float data[AUDIO_BLOCK_SAMPLES]; int length = AUDIO_BLOCK_SAMPLES; unsigned long id = 0; };
+
+//no audio memory or connections: a node transmits into its own "out" blocks and the inputs are set by hand
+#define HOSTSIM_MAX_OUTPUTS 16
+class AudioStream_F32 {
+  public:
+    AudioStream_F32(int n_inputs, audio_block_f32_t **_inputs) : inputs(_inputs) { for (int i = 0; i < n_inputs; i++) inputs[i] = NULL; }
+    virtual ~AudioStream_F32(void) {}
+    virtual void update(void) = 0;
+    void setInput(int i, audio_block_f32_t *block) { inputs[i] = block; }
+    audio_block_f32_t out[HOSTSIM_MAX_OUTPUTS];
+    int cpu_cycles = 0;
+  protected:
+    audio_block_f32_t **inputs;
+    int n_allocated = 0;
+    audio_block_f32_t *receiveReadOnly_f32(int i = 0) { audio_block_f32_t *b = inputs[i]; inputs[i] = NULL; return b; }
+    audio_block_f32_t *receiveWritable_f32(int i = 0) { return receiveReadOnly_f32(i); }
+    audio_block_f32_t *allocate_f32(void) { return &out[(n_allocated++) % HOSTSIM_MAX_OUTPUTS]; }
+    void transmit(audio_block_f32_t *, int = 0) {}
+    static void release(audio_block_f32_t *) {}
+};
+
+//the CHAPRO peak detector, with the ANSI attack and release times
+class AudioCalcEnvelope_F32 {
+  public:
+    void setSampleRate_Hz(float fs_Hz) { sample_rate_Hz = fs_Hz;  setAttackRelease_msec(attack_msec, release_msec); }
+    void setAttackRelease_msec(float atk_msec, float rel_msec) {
+      attack_msec = atk_msec;  release_msec = rel_msec;
+      float ansi_atk = 0.001f * attack_msec * sample_rate_Hz / 2.425f;
+      float ansi_rel = 0.001f * release_msec * sample_rate_Hz / 1.782f;
+      alfa = (float)(ansi_atk / (1.0f + ansi_atk));
+      beta = (float)(ansi_rel / (10.0f + ansi_rel));
+    }
+    void smooth_env(float x[], float y[], int n) {
+      float xpk = state_ppk;
+      for (int k = 0; k < n; k++) {
+        float xab = fabsf(x[k]);
+        xpk = (xab >= xpk) ? (alfa * xpk + (1.0f - alfa) * xab) : (beta * xpk);
+        y[k] = xpk;
+      }
+      state_ppk = xpk;
+    }
+    float getCurrentLevel(void) { return state_ppk; }
+  protected:
+    float sample_rate_Hz = AUDIO_SAMPLE_RATE_EXACT, attack_msec = 5.0f, release_msec = 50.0f;
+    float alfa = 0.0f, beta = 0.0f, state_ppk = 1.0f;
+};
+
+//CHAPRO's WDRC gain curve: expansion, then linear gain, then compression, then the limiter (the "bolt")
+class AudioCalcGainWDRC_F32 {
+  public:
+    void setParams(float _maxdB, float _exp_cr, float _exp_end_knee, float _tkgain, float _cr, float _tk, float _bolt) {
+      maxdB = _maxdB;  exp_cr = _exp_cr;  exp_end_knee = _exp_end_knee;  tkgn = _tkgain;  cr = _cr;  tk = _tk;  bolt = _bolt;
+    }
+    void calcGainFromEnvelope(float *env, float *gain_out, const int n) {
+      float tk_tmp = tk;
+      if ((tk_tmp + tkgn) > bolt) tk_tmp = bolt - tkgn;
+      const float tkgo = tkgn + tk_tmp * (1.0f - 1.0f / cr);
+      const float pblt = cr * (bolt - tkgo);
+      const float cr_const = (1.0f / cr) - 1.0f;
+      float gain_at_exp_end_knee_dB = tkgn;
+      if (tk_tmp < exp_end_knee) gain_at_exp_end_knee_dB = cr_const * exp_end_knee + tkgo;
+      const float exp_slope = (1.0f / exp_cr) - 1.0f;
+      for (int k = 0; k < n; k++) {
+        float pdB = 20.0f * log10f(max(env[k], 1.0e-30f)) + maxdB, gdB;
+        if ((pdB < exp_end_knee) && (exp_cr < 1.0f)) {
+          gdB = gain_at_exp_end_knee_dB - ((exp_end_knee - pdB) * exp_slope);
+        } else if ((pdB < tk_tmp) && (cr >= 1.0f)) {
+          gdB = tkgn;
+        } else if (pdB > pblt) {
+          gdB = bolt + ((pdB - pblt) / 10.0f) - pdB;
+        } else {
+          gdB = cr_const * pdB + tkgo;
+        }
+        gain_out[k] = powf(10.0f, gdB / 20.0f);
+      }
+    }
+  protected:
+    float maxdB = 119.0f, exp_cr = 1.0f, exp_end_knee = 0.0f, tkgn = 0.0f, cr = 1.0f, tk = 105.0f, bolt = 105.0f;
+};
+
+class AudioEffectCompWDRC_F32 : public AudioStream_F32 {
+  public:
+    AudioEffectCompWDRC_F32(void) : AudioStream_F32(1, inputQueueArray) { setSampleRate_Hz(AUDIO_SAMPLE_RATE_EXACT); }
+    AudioEffectCompWDRC_F32(const AudioSettings_F32 &settings) : AudioStream_F32(1, inputQueueArray) { setSampleRate_Hz(settings.sample_rate_Hz); }
+    virtual void update(void) {
+      audio_block_f32_t *block = receiveReadOnly_f32();
+      if (!block) return;
+      audio_block_f32_t *out_block = allocate_f32();
+      compress(block->data, out_block->data, block->length);
+      out_block->length = block->length;
+    }
+    void compress(float *x, float *y, int n) {
+      float gain[AUDIO_BLOCK_SAMPLES];
+      calcEnvelope.smooth_env(x, gain, n);  //the envelope, then the gain in the same place
+      calcGain.calcGainFromEnvelope(gain, gain, n);
+      for (int k = 0; k < n; k++) y[k] = x[k] * gain[k];
+    }
+    void setSampleRate_Hz(const float fs_Hz) { calcEnvelope.setSampleRate_Hz(fs_Hz); }
+    void setParams(float attack_ms, float release_ms, float maxdB, float exp_cr, float exp_end_knee, float tkgain, float comp_ratio, float tk, float bolt) {
+      calcEnvelope.setAttackRelease_msec(attack_ms, release_ms);
+      calcGain.setParams(maxdB, exp_cr, exp_end_knee, tkgain, comp_ratio, tk, bolt);
+    }
+    float getCurrentLevel_dB(void) { return 20.0f * log10f(max(calcEnvelope.getCurrentLevel(), 1.0e-12f)); }
+  protected:
+    audio_block_f32_t *inputQueueArray[1];
+    AudioCalcEnvelope_F32 calcEnvelope;
+    AudioCalcGainWDRC_F32 calcGain;
+};
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef _HostSim_arm_math_h
+#define _HostSim_arm_math_h
+
+// Host (PC) stand-in for the one CMSIS-DSP function that this sketch's classes call directly: the real FFT, with the
+// output in the same order as arm_rfft_fast_f32() (X[0] = DC, X[1] = Nyquist, then the real and imaginary parts of
+// bins 1 to N/2-1).  It is a plain radix-2 complex FFT, so it is only for checking the results, not for timing the FFT.
+
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <utility>
+
+typedef struct { uint16_t fftLenRFFT; } arm_rfft_fast_instance_f32;
+
+inline int arm_rfft_fast_init_f32(arm_rfft_fast_instance_f32 *S, uint16_t fftLen) { S->fftLenRFFT = fftLen; return 0; }
+
+inline void arm_rfft_fast_f32(arm_rfft_fast_instance_f32 *S, float *p, float *pOut, uint8_t ifftFlag) {
+  const int n = S->fftLenRFFT;
+  std::complex<float> a[4096];
+  for (int i = 0; i < n; i++) a[i] = p[i];
+  for (int i = 1, j = 0; i < n; i++) {  //bit reversal
+    int bit = n >> 1;
+    for (; j & bit; bit >>= 1) j ^= bit;
+    j ^= bit;
+    if (i < j) std::swap(a[i], a[j]);
+  }
+  for (int len = 2; len <= n; len <<= 1) {
+    std::complex<float> w_len(cosf(-2.0f * (float)M_PI / len), sinf(-2.0f * (float)M_PI / len));
+    for (int i = 0; i < n; i += len) {
+      std::complex<float> w(1.0f, 0.0f);
+      for (int j = 0; j < len / 2; j++) {
+        std::complex<float> u = a[i + j], v = a[i + j + len / 2] * w;
+        a[i + j] = u + v;  a[i + j + len / 2] = u - v;
+        w *= w_len;
+      }
+    }
+  }
+  pOut[0] = a[0].real();  pOut[1] = a[n / 2].real();
+  for (int k = 1; k < n / 2; k++) { pOut[2 * k] = a[k].real(); pOut[2 * k + 1] = a[k].imag(); }
+  (void)ifftFlag;  //only the forward FFT is used
+}
+
+#endif
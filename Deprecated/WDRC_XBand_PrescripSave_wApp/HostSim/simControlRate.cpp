@@ -0,0 +1,135 @@
+// simControlRate: how much CPU the control-rate mode of AudioEffectCompWDRC_Local_F32 saves, and how far its gain gets
+// from the per-sample gain, by running the real class (../AudioEffectCompWDRC_Local_F32.h) on a PC.
+//
+// Two test signals, at the sketch's sample rate and block size (24 kHz, 24 samples):
+//   * tones: a 1 kHz tone whose level steps every 0.5 sec through 45, 75, 60, 90, and 50 dB SPL
+//   * speech-like: speech-shaped noise (-6 dB/octave above 500 Hz) with syllables (4 per sec, each +/-8 dB at random)
+//     and a pause now and then, at about 65 dB SPL.  There are no speech recordings in this repo, so this stands in
+//     for speech: it has the level changes that matter to a 5/300 msec compressor.
+// with the per-band compressor for band 3 in GHA_Constants.h (and maxdB = 130).  For each control decimation N, it
+// reports the host's time in the compressor (relative to N = 1, which is the library's per-sample path) and the max and
+// mean deviation of the gain from the per-sample gain (from the class's own deviation monitor, in a separate run,
+// because the monitor itself costs CPU), and the error in the output: the rms difference from the output at N = 1, re:
+// the rms of that output.  The gain's deviation is biggest at the start of a sound after a pause, where the envelope
+// climbs tens of dB in a few samples, but the signal is small there, so the output error is the better measure of what
+// is heard.  The host's times only show the trend; the Teensy's will differ.
+//
+// Last, it switches N from 1 to 8 and back while the envelope is releasing (in the compression region), and reports the step in the gain at each
+// switch, which should be no bigger than the steps around it.
+//
+// To build and run (from this folder):
+//     g++ -std=gnu++17 -O2 -I. simControlRate.cpp -o simControlRate && ./simControlRate
+
+#include <Tympan_Library.h>
+#include <random>
+#include "../AudioEffectCompWDRC_Local_F32.h"
+
+const float fs_Hz = 24000.0f;
+const int block_samples = 24;
+const float maxdB = 130.0f;
+
+void setupCompressor(AudioEffectCompWDRC_Local_F32 &comp) {
+  comp.setSampleRate_Hz(fs_Hz);
+  //band 3 of dsl in GHA_Constants.h: attack, release, maxdB, exp_cr, exp_end_knee, tkgain, comp_ratio, tk, bolt
+  comp.setParams(5.0f, 300.0f, maxdB, 0.7f, 45.0f, 20.0f, 1.5f, 55.0f, 140.0f);
+}
+
+float dBSPL_to_rms(float dB_SPL) { return powf(10.0f, (dB_SPL - maxdB) / 20.0f); }
+
+std::vector<float> makeTones(float dur_sec) {
+  const float levels_dB[] = {45.0f, 75.0f, 60.0f, 90.0f, 50.0f};
+  std::vector<float> x((size_t)(dur_sec * fs_Hz));
+  for (size_t i = 0; i < x.size(); i++) {
+    int Ilevel = (int)(i / (size_t)(0.5f * fs_Hz)) % 5;
+    x[i] = sqrtf(2.0f) * dBSPL_to_rms(levels_dB[Ilevel]) * sinf(2.0f * (float)M_PI * 1000.0f * (float)i / fs_Hz);
+  }
+  return x;
+}
+
+std::vector<float> makeSpeechLike(float dur_sec) {
+  std::mt19937 rng(1);
+  std::normal_distribution<float> noise(0.0f, 1.0f);
+  std::uniform_real_distribution<float> unif(0.0f, 1.0f);
+  std::vector<float> x((size_t)(dur_sec * fs_Hz));
+  const int syl_samples = (int)(0.25f * fs_Hz);
+  const float a = expf(-2.0f * (float)M_PI * 500.0f / fs_Hz);  //one-pole lowpass at 500 Hz: -6 dB/octave above it
+  float lp = 0.0f, syl_gain = 1.0f, sum_sq = 0.0f;
+  for (size_t i = 0; i < x.size(); i++) {
+    int k = (int)(i % (size_t)syl_samples);
+    if (k == 0) syl_gain = (unif(rng) < 0.15f) ? 0.0f : powf(10.0f, (16.0f * unif(rng) - 8.0f) / 20.0f);  //a pause, or a syllable
+    lp = a * lp + (1.0f - a) * noise(rng);
+    x[i] = syl_gain * 0.5f * (1.0f - cosf(2.0f * (float)M_PI * (float)k / (float)syl_samples)) * lp;
+    sum_sq += x[i] * x[i];
+  }
+  float scale = dBSPL_to_rms(65.0f) / sqrtf(sum_sq / (float)x.size());
+  for (float &v : x) v *= scale;
+  return x;
+}
+
+//run the signal through the compressor, one block at a time.  Returns the host's time in the compressor (usec).
+double runCompressor(AudioEffectCompWDRC_Local_F32 &comp, std::vector<float> &x, std::vector<float> &y) {
+  y.resize(x.size());
+  unsigned long start_usec = micros();
+  for (size_t i = 0; i + block_samples <= x.size(); i += block_samples) comp.processBlock(&x[i], &y[i], block_samples);
+  return (double)(micros() - start_usec);
+}
+
+void reportCorpus(const char *name, std::vector<float> x) {
+  printf("%s (%.1f sec):\n", name, (float)x.size() / fs_Hz);
+  printf("     N   update (msec)   CPU re: N=1   gain dev (dB): max    mean   output error (dB)\n");
+  const int all_N[] = {1, 2, 4, 8, 16, 24};
+  double t_ref = 0.0;
+  std::vector<float> y_ref;
+  for (int N : all_N) {
+    std::vector<float> y;
+    double t_usec = 1.0e30;
+    for (int rep = 0; rep < 5; rep++) {  //the fastest of a few, to leave out the host's other work
+      AudioEffectCompWDRC_Local_F32 comp;  setupCompressor(comp);  comp.setControlDecimation(N);
+      t_usec = min(t_usec, runCompressor(comp, x, y));
+    }
+    if (N == 1) { t_ref = t_usec;  y_ref = y; }
+    double sum_err = 0.0, sum_ref = 0.0;
+    for (size_t i = 0; i < y.size(); i++) { sum_err += (y[i] - y_ref[i]) * (y[i] - y_ref[i]);  sum_ref += y_ref[i] * y_ref[i]; }
+    float err_dB = (sum_err > 0.0) ? 10.0f * log10f((float)(sum_err / sum_ref)) : -INFINITY;
+
+    AudioEffectCompWDRC_Local_F32 comp;  setupCompressor(comp);  comp.setControlDecimation(N);
+    comp.setEnableDeviationMonitor(true);
+    runCompressor(comp, x, y);
+    printf("    %2d   %13.3f   %10.0f%%   %18.3f  %6.3f   %17.1f\n", N, 1000.0f * (float)N / fs_Hz, 100.0 * t_usec / t_ref, comp.getMaxDeviation_dB(), comp.getMeanDeviation_dB(), err_dB);
+  }
+  printf("\n");
+}
+
+//the gain (dB) of each sample, for a signal that is never zero
+void gainOf(const float *x, const float *y, float *g_dB, int n) { for (int k = 0; k < n; k++) g_dB[k] = 20.0f * log10f(y[k] / x[k]); }
+
+void reportSwitching(void) {
+  //a DC level, so that the gain is y/x at every sample: 90 dB SPL for 1 sec, then 50 dB SPL (so that the envelope releases)
+  std::vector<float> x((size_t)(3.0f * fs_Hz)), y(x.size()), g_dB(x.size());
+  for (size_t i = 0; i < x.size(); i++) x[i] = dBSPL_to_rms((i < (size_t)fs_Hz) ? 90.0f : 50.0f);
+  AudioEffectCompWDRC_Local_F32 comp;  setupCompressor(comp);
+  const size_t switch_to_8 = (size_t)(1.03f * fs_Hz) / block_samples * block_samples, switch_to_1 = (size_t)(1.06f * fs_Hz) / block_samples * block_samples;
+  for (size_t i = 0; i + block_samples <= x.size(); i += block_samples) {
+    if (i == switch_to_8) comp.setControlDecimation(8);
+    if (i == switch_to_1) comp.setControlDecimation(1);
+    comp.processBlock(&x[i], &y[i], block_samples);
+  }
+  gainOf(x.data(), y.data(), g_dB.data(), (int)x.size());
+
+  printf("Switching N while the envelope releases (from 90 to 50 dB SPL):\n");
+  const size_t at[2] = {switch_to_8, switch_to_1};
+  const char *names[2] = {"N = 1 to 8", "N = 8 to 1"};
+  for (int s = 0; s < 2; s++) {
+    float step_dB = fabsf(g_dB[at[s]] - g_dB[at[s] - 1]), max_around_dB = 0.0f;
+    for (size_t i = at[s] - 4 * block_samples; i < at[s] + 4 * block_samples; i++) if (i != at[s]) max_around_dB = max(max_around_dB, fabsf(g_dB[i] - g_dB[i - 1]));
+    printf("    %s: step at the switch %.4f dB, biggest step in the 4 blocks on either side %.4f dB\n", names[s], step_dB, max_around_dB);
+  }
+}
+
+int main(void) {
+  printf("simControlRate: fs = %.0f Hz, %d-sample blocks, band 3 of GHA_Constants.h\n\n", fs_Hz, block_samples);
+  reportCorpus("Tones", makeTones(20.0f));
+  reportCorpus("Speech-like", makeSpeechLike(20.0f));
+  reportSwitching();
+  return 0;
+}
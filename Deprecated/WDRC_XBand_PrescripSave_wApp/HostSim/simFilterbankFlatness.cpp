@@ -0,0 +1,162 @@
+// simFilterbankFlatness: how flat the summed response of the IIR filterbank is after FilterbankAlignment has set each
+// band's delay and polarity, by running the real classes (../FilterbankAlignment.h and ../AudioEffectMultiBandDelay_F32.h)
+// on a PC.
+//
+// The filterbank is a stand-in for the library's createFilterCoeff_SOS(): Butterworth filters with 3 biquads per band
+// (6th-order lowpass for the lowest band, 6th-order highpass for the highest, and bandpass from a 3rd-order prototype in
+// between), at the given crossover frequencies.  An impulse is run through each band's biquads and then through
+// AudioEffectMultiBandDelay_F32 (one block at a time, as on the Tympan), the bands are summed, and the summed response
+// is evaluated on a dense grid (a 65536-point DFT) from the aligner's lowest frequency to 0.45 fs.  This is compared to
+// the ripple that the aligner itself reported, which is evaluated only at its own frequencies.
+//
+// To build and run (from this folder):
+//     g++ -std=gnu++17 -O2 -I. simFilterbankFlatness.cpp -o simFilterbankFlatness && ./simFilterbankFlatness
+
+#include <Tympan_Library.h>
+#include <complex>
+#include "../FilterbankAlignment.h"
+#include "../AudioEffectMultiBandDelay_F32.h"
+
+typedef std::complex<double> cplx;
+const float fs_Hz = 24000.0f;   //same as the sketch
+const int block_samples = 24;
+const int n_biquad = 3;         //MAX_IIR_FILT_ORDER / 2 in the sketch
+const int max_delay_samps = 128;  //MAX_FILTER_ALIGN_DELAY in the sketch
+const int N_DFT = 65536;
+
+//bilinear transform of an s-plane root, with the frequency already prewarped
+cplx bilinear(cplx s) { double K = 2.0 * fs_Hz; return (K + s) / (K - s); }
+double prewarp(double f_Hz) { return 2.0 * fs_Hz * tan(M_PI * f_Hz / fs_Hz); }
+
+//one biquad from a z-plane pole (and its conjugate) and a numerator.  Matlab order: [b0 b1 b2 a0 a1 a2].
+void setBiquad(float *c, cplx p, const double *b) {
+  c[0] = (float)b[0];  c[1] = (float)b[1];  c[2] = (float)b[2];
+  c[3] = 1.0f;  c[4] = (float)(-2.0 * p.real());  c[5] = (float)std::norm(p);
+}
+
+//the response of a biquad cascade at w (rad/sample)
+cplx response(const float *sos, double w) {
+  cplx z1 = std::exp(cplx(0.0, -w)), z2 = z1 * z1, H = 1.0;
+  for (int i = 0; i < n_biquad; i++) {
+    const float *c = sos + 6 * i;
+    H *= ((double)c[0] + (double)c[1] * z1 + (double)c[2] * z2) / ((double)c[3] + (double)c[4] * z1 + (double)c[5] * z2);
+  }
+  return H;
+}
+void normalize(float *sos, double w) {  //unity gain at w
+  float g = (float)(1.0 / std::abs(response(sos, w)));
+  for (int k = 0; k < 3; k++) sos[k] *= g;
+}
+
+//design the bank: 3 biquads per band, into sos[Iband * 18]
+void designBank(const float *cross_Hz, int n_chan, float *sos) {
+  for (int Iband = 0; Iband < n_chan; Iband++) {
+    float *c = sos + Iband * n_biquad * 6;
+    if ((Iband == 0) || (Iband == n_chan - 1)) {
+      //6th-order lowpass (or highpass): 3 pole pairs of the Butterworth prototype
+      double wc = prewarp((Iband == 0) ? cross_Hz[0] : cross_Hz[n_chan - 2]);
+      const double b_lp[3] = {1.0, 2.0, 1.0}, b_hp[3] = {1.0, -2.0, 1.0};
+      for (int k = 0; k < 3; k++) {
+        cplx p_proto = std::exp(cplx(0.0, M_PI * (2.0 * k + 6.0 + 1.0) / 12.0));  //upper half of the left half-plane
+        cplx p = (Iband == 0) ? (p_proto * wc) : (wc / p_proto);
+        setBiquad(c + 6 * k, bilinear(p), (Iband == 0) ? b_lp : b_hp);
+      }
+      normalize(c, (Iband == 0) ? 0.0 : M_PI);
+    } else {
+      //bandpass from the 3rd-order prototype: each prototype pole makes two bandpass poles
+      double w1 = prewarp(cross_Hz[Iband - 1]), w2 = prewarp(cross_Hz[Iband]), bw = w2 - w1, w0sq = w1 * w2;
+      const double b_bp[3] = {1.0, 0.0, -1.0};
+      int n_pairs = 0;
+      for (int k = 0; k < 3; k++) {
+        cplx p_proto = std::exp(cplx(0.0, M_PI * (2.0 * k + 3.0 + 1.0) / 6.0));
+        cplx q = p_proto * bw, disc = std::sqrt(q * q - 4.0 * w0sq);
+        cplx roots[2] = {0.5 * (q + disc), 0.5 * (q - disc)};
+        for (int r = 0; r < 2; r++) if ((roots[r].imag() > 0.0) && (n_pairs < 3)) setBiquad(c + 6 * (n_pairs++), bilinear(roots[r]), b_bp);
+      }
+      normalize(c, 2.0 * M_PI * sqrt(cross_Hz[Iband - 1] * cross_Hz[Iband]) / fs_Hz);
+    }
+  }
+}
+
+//run an impulse through each band's biquads and then through the multiband delay, and sum the bands
+std::vector<double> summedImpulse(const float *sos, int n_chan, AudioEffectMultiBandDelay_F32 &delay, int n_samps) {
+  n_samps = block_samples * ((n_samps + block_samples - 1) / block_samples);  //whole blocks
+  std::vector<double> h(n_samps, 0.0);
+  double state[MULTIBAND_DELAY_MAX_CHAN][3][2] = {};
+  for (int start = 0; start < n_samps; start += block_samples) {
+    audio_block_f32_t in[MULTIBAND_DELAY_MAX_CHAN];
+    for (int Iband = 0; Iband < n_chan; Iband++) {
+      for (int k = 0; k < block_samples; k++) {
+        double x = ((start + k) == 0) ? 1.0 : 0.0;
+        for (int i = 0; i < n_biquad; i++) {  //direct form II transposed, in double
+          const float *c = sos + (Iband * n_biquad + i) * 6;
+          double y = c[0] * x + state[Iband][i][0];
+          state[Iband][i][0] = c[1] * x - c[4] * y + state[Iband][i][1];
+          state[Iband][i][1] = c[2] * x - c[5] * y;
+          x = y;
+        }
+        in[Iband].data[k] = (float)x;
+      }
+      in[Iband].length = block_samples;
+      delay.setInput(Iband, &in[Iband]);
+    }
+    delay.update();  //in place: the delayed bands are now in in[]
+    for (int Iband = 0; Iband < n_chan; Iband++) for (int k = 0; k < block_samples; k++) h[start + k] += in[Iband].data[k];
+  }
+  return h;
+}
+
+//ripple (max minus min, dB) of the DFT of h, between f_lo and f_hi
+float denseRipple_dB(const std::vector<double> &h, float f_lo_Hz, float f_hi_Hz, float *f_min_Hz) {
+  float max_dB = -1000.0f, min_dB = 1000.0f;
+  for (int Ibin = 0; Ibin <= N_DFT / 2; Ibin++) {
+    float f_Hz = (float)Ibin * fs_Hz / (float)N_DFT;
+    if ((f_Hz < f_lo_Hz) || (f_Hz > f_hi_Hz)) continue;
+    cplx H = 0.0, step = std::exp(cplx(0.0, -2.0 * M_PI * Ibin / N_DFT)), z = 1.0;
+    for (size_t k = 0; k < h.size(); k++) { H += h[k] * z;  z *= step; }
+    float dB = 20.0f * log10f((float)std::abs(H));
+    max_dB = max(max_dB, dB);
+    if (dB < min_dB) { min_dB = dB;  *f_min_Hz = f_Hz; }
+  }
+  return max_dB - min_dB;
+}
+
+int main(void) {
+  Serial.quiet = true;
+  printf("simFilterbankFlatness: fs = %.0f Hz, %d biquads per band, grid of the aligner: %d log-spaced + the bins of a %d-point FFT\n\n",
+    fs_Hz, n_biquad, ALIGN_N_LOG_FREQ, ALIGN_N_FFT);
+  printf("    %-40s  %-34s  %s\n", "crossovers (Hz)", "ripple (dB): aligner's grid", "dense grid (deepest dip)");
+
+  const int N_SETS = 4;
+  const int n_chans[N_SETS] = {6, 4, 8, 3};
+  const float crosses[N_SETS][7] = {
+    {500.0f, 840.0f, 1420.0f, 2500.0f, 5000.0f},   //dsl in GHA_Constants.h
+    {700.0f, 1800.0f, 4000.0f},
+    {250.0f, 500.0f, 1000.0f, 1500.0f, 2000.0f, 3000.0f, 4000.0f},
+    {1000.0f, 3000.0f}
+  };
+  bool pass = true;
+  for (int Iset = 0; Iset < N_SETS; Iset++) {
+    int n_chan = n_chans[Iset];
+    float sos[MULTIBAND_DELAY_MAX_CHAN * n_biquad * 6];
+    designBank(crosses[Iset], n_chan, sos);
+
+    static FilterbankAlignment aligner;  //big, so not on the stack
+    int delay_samps[MULTIBAND_DELAY_MAX_CHAN];
+    float polarity[MULTIBAND_DELAY_MAX_CHAN];
+    float aligner_dB = aligner.computeDelaysAndPolarity(sos, n_chan, n_biquad, fs_Hz, crosses[Iset], max_delay_samps, delay_samps, polarity);
+
+    static AudioEffectMultiBandDelay_F32 delay;
+    delay.setDelays(n_chan, delay_samps, polarity);
+    std::vector<double> h = summedImpulse(sos, n_chan, delay, 8192);
+    float f_min_Hz = 0.0f;
+    float dense_dB = denseRipple_dB(h, max(50.0f, 0.5f * crosses[Iset][0]), 0.45f * fs_Hz, &f_min_Hz);
+
+    char name[64] = "";
+    for (int i = 0; i < n_chan - 1; i++) snprintf(name + strlen(name), sizeof(name) - strlen(name), "%s%.0f", (i > 0) ? ", " : "", crosses[Iset][i]);
+    printf("    %-40s  %27.2f  %13.2f (at %.0f Hz)\n", name, aligner_dB, dense_dB, f_min_Hz);
+    if (dense_dB > aligner_dB + 0.5f) pass = false;  //a notch between the aligner's points
+  }
+  printf("\n%s: the dense ripple is within 0.5 dB of what the aligner saw, for every bank\n", pass ? "PASS" : "*** FAIL ***");
+  return pass ? 0 : 1;
+}
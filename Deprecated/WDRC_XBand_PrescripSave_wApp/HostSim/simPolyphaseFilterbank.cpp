@@ -0,0 +1,138 @@
+// simPolyphaseFilterbank: checks the polyphase DFT filterbank and compares its cost with the IIR filterbank, by running
+// the real class (../AudioFilterbankPolyphaseDFT_F32.h) on a PC, at the sketch's sample rate and block size (24 kHz,
+// 24 samples) with the 6-band crossovers of dsl in GHA_Constants.h.  It reports:
+//   * for K = 32, 64, and 128: the error between the sum of the bands and the input delayed by getLatency_samples()
+//   * for K = 128 (as used by the sketch): the level of a tone in each band, and the part of each band's output that
+//     is not at the tone's frequency (the aliasing of the overlap-add)
+//   * the host's time per block for 6 to 32 bands, for K = 64 and 128, against a bank of IIR bandpass filters of
+//     3 biquads each (MAX_IIR_FILT_ORDER = 6 in the sketch), run as arm_biquad_cascade_df1_f32() runs them
+// The FFT here is a plain radix-2 complex FFT (see arm_math.h in this folder), which is slower than the Teensy's
+// arm_rfft_fast_f32(), so the host's times favor the IIR filters.  The Teensy's times come from the 'j' command.
+//
+// To build and run (from this folder):
+//     g++ -std=gnu++17 -O2 -I. simPolyphaseFilterbank.cpp -o simPolyphaseFilterbank && ./simPolyphaseFilterbank
+
+#include <Tympan_Library.h>
+#include <random>
+#include "../AudioFilterbankPolyphaseDFT_F32.h"
+
+const float fs_Hz = 24000.0f;
+const int block_samples = 24;
+const int n_dsl_bands = 6;
+const float dsl_cross_freq[n_dsl_bands - 1] = {500.0f, 840.0f, 1420.0f, 2500.0f, 5000.0f};  //dsl in GHA_Constants.h
+
+static AudioFilterbankPolyphaseDFT_F32 filterbank;
+static float band_out[POLYPHASE_FB_MAX_BANDS][block_samples];
+static float *band_out_ptr[POLYPHASE_FB_MAX_BANDS];
+
+//the sum of the bands should be the input, delayed
+void checkReconstruction(int K) {
+  if (filterbank.design(K, dsl_cross_freq, n_dsl_bands, fs_Hz) < 0) { printf("  K = %3d: design failed\n", K); return; }
+  std::mt19937 rng(1);
+  std::normal_distribution<float> noise(0.0f, 1.0f);
+  std::vector<float> x(block_samples * 400);
+  for (float &v : x) v = noise(rng);
+  const int latency = filterbank.getLatency_samples();
+  double err_pow = 0.0, sig_pow = 0.0;
+  for (int Iblock = 0; Iblock < (int)x.size() / block_samples; Iblock++) {
+    filterbank.processAudio(&x[Iblock * block_samples], band_out_ptr, block_samples);
+    for (int i = 0; i < block_samples; i++) {
+      int n = Iblock * block_samples + i;
+      if (n < 2 * K) continue;  //wait for the filterbank to fill
+      float sum = 0.0f;
+      for (int Iband = 0; Iband < n_dsl_bands; Iband++) sum += band_out[Iband][i];
+      double err = sum - x[n - latency];
+      err_pow += err * err;  sig_pow += x[n - latency] * x[n - latency];
+    }
+  }
+  printf("  K = %3d: sum of the %d bands re: the input delayed by %3d samples: error = %6.1f dB\n", K, n_dsl_bands, latency, 10.0 * log10(err_pow / sig_pow));
+}
+
+//the level of a tone in each band, and the rest of each band's output (the aliasing)
+void checkTone(float freq_Hz) {
+  filterbank.design(128, dsl_cross_freq, n_dsl_bands, fs_Hz);
+  const int n_blocks = 2000, N = n_blocks * block_samples, n_start = N / 2;
+  std::vector<float> y[n_dsl_bands];
+  for (int Iband = 0; Iband < n_dsl_bands; Iband++) y[Iband].resize(N);
+  float x[block_samples];
+  for (int Iblock = 0; Iblock < n_blocks; Iblock++) {
+    for (int i = 0; i < block_samples; i++) x[i] = sinf(2.0f * (float)M_PI * freq_Hz * (float)(Iblock * block_samples + i) / fs_Hz);
+    filterbank.processAudio(x, band_out_ptr, block_samples);
+    for (int Iband = 0; Iband < n_dsl_bands; Iband++) memcpy(&y[Iband][Iblock * block_samples], band_out[Iband], block_samples * sizeof(float));
+  }
+  printf("  %5.0f Hz:", freq_Hz);
+  for (int Iband = 0; Iband < n_dsl_bands; Iband++) {
+    //fit the tone (least squares) over the second half, and call the rest the aliasing
+    double sum_s = 0.0, sum_c = 0.0, total = 0.0;
+    for (int n = n_start; n < N; n++) {
+      double ph = 2.0 * M_PI * freq_Hz * n / fs_Hz;
+      sum_s += y[Iband][n] * sin(ph);  sum_c += y[Iband][n] * cos(ph);  total += y[Iband][n] * y[Iband][n];
+    }
+    int M = N - n_start;
+    double a = 2.0 * sum_s / M, b = 2.0 * sum_c / M;
+    double tone_pow = 0.5 * (a * a + b * b), alias_pow = std::max(total / M - tone_pow, 1.0e-30);
+    printf("  %6.1f (%6.1f)", 10.0 * log10(std::max(tone_pow / 0.5, 1.0e-30)), 10.0 * log10(alias_pow / 0.5));
+  }
+  printf("\n");
+}
+
+//the IIR filterbank's work: a cascade of direct form I biquads per band, the same arithmetic as arm_biquad_cascade_df1_f32()
+struct BiquadCascade { int n_stages; const float *coeff; float *state; };
+void runBiquads(BiquadCascade &bq, const float *x, float *y, int n) {
+  const float *src = x;
+  for (int Istage = 0; Istage < bq.n_stages; Istage++) {
+    const float *c = bq.coeff + 5 * Istage;
+    float *st = bq.state + 4 * Istage;
+    float x1 = st[0], x2 = st[1], y1 = st[2], y2 = st[3];
+    for (int i = 0; i < n; i++) {
+      float xn = src[i], yn = c[0] * xn + c[1] * x1 + c[2] * x2 + c[3] * y1 + c[4] * y2;
+      x2 = x1;  x1 = xn;  y2 = y1;  y1 = yn;
+      y[i] = yn;
+    }
+    st[0] = x1;  st[1] = x2;  st[2] = y1;  st[3] = y2;
+    src = y;
+  }
+}
+
+void timeFilterbanks(int K, int n_bands) {
+  float cross_freq[POLYPHASE_FB_MAX_BANDS];
+  for (int i = 0; i < n_bands - 1; i++) cross_freq[i] = (float)(i + 1) * 0.5f * fs_Hz / (float)n_bands;
+  Serial.quiet = true;
+  int ret = filterbank.design(K, cross_freq, n_bands, fs_Hz);
+  Serial.quiet = false;
+  if (ret < 0) { printf("  K = %3d, %2d bands: does not fit (the bands are narrower than the bins)\n", K, n_bands); return; }
+
+  static float x[block_samples], coeff[3 * 5], state[POLYPHASE_FB_MAX_BANDS][3 * 4];
+  for (int i = 0; i < block_samples; i++) x[i] = 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+  for (int Istage = 0; Istage < 3; Istage++) { float c[5] = {0.1f, 0.0f, -0.1f, 1.5f, -0.8f}; memcpy(coeff + 5 * Istage, c, sizeof(c)); }
+  BiquadCascade bq[POLYPHASE_FB_MAX_BANDS];
+  for (int Iband = 0; Iband < n_bands; Iband++) bq[Iband] = {3, coeff, state[Iband]};
+
+  const int n_trials = 20000;
+  volatile float sink = 0.0f;
+  double best_IIR_nsec = 1.0e30, best_poly_nsec = 1.0e30;
+  for (int Irep = 0; Irep < 15; Irep++) {  //the fastest of a few runs, to steady the host's times
+    unsigned long t0 = micros();
+    for (int t = 0; t < n_trials; t++) { for (int Iband = 0; Iband < n_bands; Iband++) runBiquads(bq[Iband], x, band_out[Iband], block_samples); sink = sink + band_out[0][0]; }
+    unsigned long t1 = micros();
+    for (int t = 0; t < n_trials; t++) { filterbank.processAudio(x, band_out_ptr, block_samples); sink = sink + band_out[0][0]; }
+    unsigned long t2 = micros();
+    best_IIR_nsec = std::min(best_IIR_nsec, 1000.0 * (double)(t1 - t0) / n_trials);
+    best_poly_nsec = std::min(best_poly_nsec, 1000.0 * (double)(t2 - t1) / n_trials);
+  }
+  printf("  K = %3d, %2d bands: IIR %7.1f nsec, polyphase %7.1f nsec (%.2fx the IIR)\n", K, n_bands, best_IIR_nsec, best_poly_nsec, best_poly_nsec / best_IIR_nsec);
+}
+
+int main(void) {
+  for (int Iband = 0; Iband < POLYPHASE_FB_MAX_BANDS; Iband++) band_out_ptr[Iband] = band_out[Iband];
+
+  printf("simPolyphaseFilterbank: reconstruction (white noise, %d DSL bands):\n", n_dsl_bands);
+  for (int K : {32, 64, 128}) checkReconstruction(K);
+
+  printf("Tones, K = 128: level in bands 0-5, dB (and the rest of the band's output, dB):\n");
+  for (float f : {250.0f, 500.0f, 700.0f, 1000.0f, 2000.0f, 4000.0f, 8000.0f}) checkTone(f);
+
+  printf("Host time per %d-sample block (3 biquads per IIR band):\n", block_samples);
+  for (int K : {64, 128}) for (int n_bands : {6, 8, 12, 16, 24, 32}) timeFilterbanks(K, n_bands);
+  return 0;
+}
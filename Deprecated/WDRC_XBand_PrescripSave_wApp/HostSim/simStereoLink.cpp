@@ -0,0 +1,101 @@
+// simStereoLink: how well AudioEffectCompWDRC_StereoLink_F32 preserves the interaural level difference (ILD) at each
+// link weight, what the link costs, and what the ILD monitor costs, by running the real classes
+// (../AudioEffectCompWDRC_StereoLink_F32.h and ../AudioEffectCompWDRC_Local_F32.h) on a PC.
+//
+// The test signal is noise whose level steps every 0.5 sec between 50 and 85 dB SPL (left ear), with the right ear
+// 10 dB quieter (so the input ILD is +10 dB), at the sketch's sample rate and block size (24 kHz, 24 samples).  Both
+// ears get the per-band compressor for band 3 in GHA_Constants.h (and maxdB = 130).  For each link weight (0.0, 0.5,
+// 1.0, as stepped by the 'O' command) and each control decimation (1 and 8), it reports:
+//   * the input and output ILD, from the link's own ILD monitor
+//   * the host's time in the link with the ILD monitor off, and the extra time when it is on
+//   * the max and mean deviation of the left gain from the per-sample gain (in a separate run, as the monitor costs CPU)
+// It also checks that setting the link weight leaves the ILD monitor off.  The host's times only show the trend; the
+// Teensy's will differ.
+//
+// To build and run (from this folder):
+//     g++ -std=gnu++17 -O2 -I. simStereoLink.cpp -o simStereoLink && ./simStereoLink
+
+#include <Tympan_Library.h>
+#include <random>
+#include "../AudioEffectCompWDRC_StereoLink_F32.h"
+
+const float fs_Hz = 24000.0f;
+const int block_samples = 24;
+const float maxdB = 130.0f;
+const float input_ILD_dB = 10.0f;
+
+void setupCompressor(AudioEffectCompWDRC_Local_F32 &comp, int N) {
+  comp.setSampleRate_Hz(fs_Hz);
+  //band 3 of dsl in GHA_Constants.h: attack, release, maxdB, exp_cr, exp_end_knee, tkgain, comp_ratio, tk, bolt
+  comp.setParams(5.0f, 300.0f, maxdB, 0.7f, 45.0f, 20.0f, 1.5f, 55.0f, 140.0f);
+  comp.setControlDecimation(N);
+}
+
+float dBSPL_to_rms(float dB_SPL) { return powf(10.0f, (dB_SPL - maxdB) / 20.0f); }
+
+void makeStereoNoise(float dur_sec, std::vector<float> &xL, std::vector<float> &xR) {
+  std::mt19937 rng(1);
+  std::normal_distribution<float> noise(0.0f, 1.0f);
+  xL.resize((size_t)(dur_sec * fs_Hz)); xR.resize(xL.size());
+  const float levels_dB[] = {50.0f, 85.0f, 65.0f, 75.0f};
+  const float right_re_left = powf(10.0f, -input_ILD_dB / 20.0f);
+  for (size_t i = 0; i < xL.size(); i++) {
+    float rms = dBSPL_to_rms(levels_dB[(i / (size_t)(0.5f * fs_Hz)) % 4]);
+    xL[i] = rms * noise(rng);
+    xR[i] = right_re_left * rms * noise(rng);
+  }
+}
+
+struct Result { double usec = 0.0; float ILD_in_dB = 0.0f, ILD_out_dB = 0.0f, max_dev_dB = 0.0f, mean_dev_dB = 0.0f; bool monitor_was_off = false; };
+
+Result runLink(float weight, int N, bool ILD_monitor, bool deviation_monitor, std::vector<float> &xL, std::vector<float> &xR) {
+  AudioSettings_F32 settings(fs_Hz, block_samples);
+  AudioEffectCompWDRC_Local_F32 compL(settings), compR(settings);
+  setupCompressor(compL, N); setupCompressor(compR, N);
+  compL.setEnableDeviationMonitor(deviation_monitor);
+  AudioEffectCompWDRC_StereoLink_F32 link(settings);
+  link.setCompressors(&compL, &compR);
+
+  //same steps as setWDRCLinkWeight() in the sketch
+  link.setLinkWeight(weight);
+  link.resetILDMonitor();
+  Result res;
+  res.monitor_was_off = !link.getEnableILDMonitor();
+  link.setEnableILDMonitor(ILD_monitor);
+
+  std::vector<float> yL(xL.size()), yR(xR.size());
+  unsigned long start_usec = micros();
+  for (size_t i = 0; i + block_samples <= xL.size(); i += block_samples) link.compressLinked(&xL[i], &xR[i], &yL[i], &yR[i], block_samples);
+  res.usec = (double)(micros() - start_usec);
+  res.ILD_in_dB = link.getILD_in_dB(); res.ILD_out_dB = link.getILD_out_dB();
+  res.max_dev_dB = compL.getMaxDeviation_dB(); res.mean_dev_dB = compL.getMeanDeviation_dB();
+  return res;
+}
+
+int main(void) {
+  Serial.quiet = true;
+  std::vector<float> xL, xR;
+  makeStereoNoise(8.0f, xL, xR);
+  const int n_reps = 15; //take the fastest of a few runs, to steady the host's times
+
+  printf("simStereoLink: %.1f sec of stepped-level noise, input ILD = %.1f dB\n", (float)xL.size() / fs_Hz, input_ILD_dB);
+  printf("  weight  N   ILD in/out (dB)   link (msec)   ILD monitor (msec)   gain dev (dB): max   mean\n");
+  bool all_off = true;
+  for (int N : {1, 8}) {
+    for (float weight : {0.0f, 0.5f, 1.0f}) {
+      double t_off = 1.0e30, t_on = 1.0e30;
+      Result with_ILD;
+      for (int Irep = 0; Irep < n_reps; Irep++) {
+        Result r = runLink(weight, N, false, false, xL, xR);
+        t_off = std::min(t_off, r.usec); all_off = all_off && r.monitor_was_off;
+        with_ILD = runLink(weight, N, true, false, xL, xR);
+        t_on = std::min(t_on, with_ILD.usec);
+      }
+      Result dev = runLink(weight, N, false, true, xL, xR);
+      printf("  %4.1f  %3d   %6.2f / %6.2f    %8.2f       %+8.2f           %6.3f  %6.3f\n", weight, N,
+             with_ILD.ILD_in_dB, with_ILD.ILD_out_dB, 0.001 * t_off, 0.001 * (t_on - t_off), dev.max_dev_dB, dev.mean_dev_dB);
+    }
+  }
+  printf("ILD monitor off after setting the link weight: %s\n", all_off ? "PASS" : "FAIL");
+  return all_off ? 0 : 1;
+}
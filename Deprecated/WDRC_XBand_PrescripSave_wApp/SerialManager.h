@@ -57,6 +57,14 @@ extern bool enableAFC(bool);
 extern void printCompressorSettings(void);
 extern void reloadCurrentAlgPresetFromSD(void);
 extern void revertCurrentAlgPresetToDefault(void);
+extern int setWDRCControlDecimation(int);
+extern bool enableWDRCDeviationMonitor(bool);
+extern bool enableWDRCILDMonitor(bool);
+extern void printWDRCControlRateReport(void);
+extern float setWDRCLinkWeight(float);
+extern void printWDRCLinkReport(void);
+extern int setFilterbankType(int);
+extern void benchmarkFilterbanks(void);
 
 
 //now, define the Serial Manager class
@@ -192,6 +200,10 @@ void SerialManager::printHelp(void) {
   //myTympan.print(" u,U: Increase or Decrease Cutoff Frequency of HP Prefilter (currently "); myTympan.print(myTympan.getHPCutoff_Hz()); myTympan.println(" Hz).");
   myTympan.print(  " z,Z: Increase or Decrease AFC N_Coeff_To_Zero (currently "); myTympan.print(feedbackCanceler.getNCoeffToZero()) ; myTympan.println(").");  
   myTympan.println(" ?: Print estimated feedback impulse response.");
+  myTympan.print(  " v,V: Increase or Decrease WDRC control decimation (currently "); myTympan.print(myState.wdrc_control_decimation); myTympan.println(" samples).");
+  myTympan.println(" o: Toggle the WDRC gain deviation and left-right ILD monitors and print the reports.");
+  myTympan.print(  " j: Toggle IIR vs polyphase DFT filterbank (currently "); myTympan.print((myState.filterbank_type == State::FILTERBANK_POLYPHASE) ? "Polyphase" : "IIR"); myTympan.println(") and print the CPU benchmark.");
+  myTympan.print(  " O: Step the left-right WDRC link weight (0.0, 0.5, 1.0) (currently "); myTympan.print(myState.wdrc_link_weight, 2); myTympan.println(").  Only for RUN_STEREO.");
   //myTympan.println(" J: Print the JSON config object, for the Tympan Remote app");
   myTympan.println(" ],}: Enable/Disable printing of data to plot.");
   myTympan.println(" `,~,|: SD: begin/stop/deleteAll recording");  
@@ -418,6 +430,36 @@ void SerialManager::processSingleCharacter(char c) {
       myState.flag_printCPUtoGUI = false;
       setButtonState("cpuStart",false);
       break;
+    case 'v':
+      myTympan.print("Received: increase WDRC control decimation to ");
+      myTympan.println(setWDRCControlDecimation(2*myState.wdrc_control_decimation));
+      break;
+    case 'V':
+      myTympan.print("Received: decrease WDRC control decimation to ");
+      myTympan.println(setWDRCControlDecimation(myState.wdrc_control_decimation/2));
+      break;
+    case 'o':
+      myState.flag_wdrcDeviationMonitor = enableWDRCDeviationMonitor(!myState.flag_wdrcDeviationMonitor);
+      myState.flag_wdrcILDMonitor = enableWDRCILDMonitor(myState.flag_wdrcDeviationMonitor && RUN_STEREO);
+      printWDRCControlRateReport();
+      if (RUN_STEREO) printWDRCLinkReport();
+      break;
+    case 'j':
+      if (myState.filterbank_type == State::FILTERBANK_IIR) {
+        myTympan.print("Received: switching to the polyphase filterbank...");
+        setFilterbankType(State::FILTERBANK_POLYPHASE);
+      } else {
+        myTympan.print("Received: switching to the IIR filterbank...");
+        setFilterbankType(State::FILTERBANK_IIR);
+      }
+      myTympan.println((myState.filterbank_type == State::FILTERBANK_POLYPHASE) ? "Polyphase is active." : "IIR is active.");
+      benchmarkFilterbanks();
+      break;
+    case 'O':
+      //step through independent, half linked, and fully linked
+      if (myState.wdrc_link_weight < 0.25f) { setWDRCLinkWeight(0.5f); } else if (myState.wdrc_link_weight < 0.75f) { setWDRCLinkWeight(1.0f); } else { setWDRCLinkWeight(0.0f); }
+      printWDRCLinkReport();
+      break;
     case ']':
       myTympan.println("Received: printing plot data.");
       myState.flag_printPlottableData = true;
@@ -3,12 +3,14 @@
 #define State_h
 
 #include <AudioEffectCompWDRC_F32.h>  //for CHA_DSL and CHA_WDRC data types
+#include <SdFat.h>                     //for saving the filterbank type, which is not part of CHA_DSL
 
 
 typedef struct {
   BTNRH_WDRC::CHA_DSL wdrc_perBand;
   BTNRH_WDRC::CHA_WDRC wdrc_broadband;
   BTNRH_WDRC::CHA_AFC afc;
+  int filterbank_type;  //see State::FILTERBANK_TYPE
 } Alg_Preset;
 #define N_PRESETS 3
 
@@ -55,6 +57,16 @@ class State {
     Alg_Preset presets[N_PRESETS];
 
     char GUI_tuner_persistent_mode = 'g';
+
+    //filterbank used to split the audio into bands
+    enum FILTERBANK_TYPE {FILTERBANK_IIR=0, FILTERBANK_POLYPHASE};
+    int filterbank_type = FILTERBANK_IIR;
+
+    //WDRC control-rate settings
+    int wdrc_control_decimation = 1;        //1 = update the compressor gains every sample
+    bool flag_wdrcDeviationMonitor = false; //compare the control-rate gain to the per-sample gain?
+    bool flag_wdrcILDMonitor = false;       //measure the left-right level difference in and out of the linked WDRCs? (only when RUN_STEREO)
+    float wdrc_link_weight = 0.0f;          //0.0 = left and right WDRCs are independent, 1.0 = fully linked (only when RUN_STEREO)
     int getNChan(void) { return wdrc_perBand.nchannel; };
 
     void printPerBandSettings(void) {   printPerBandSettings("myState: printing per-band settings:",wdrc_perBand);  }
@@ -110,6 +122,8 @@ class State {
 
     const char *preset_fnames[N_PRESETS] = {"GHA_Constants.txt", "GHA_FullOn.txt", "GHA_RTS.txt"};  //filenames for reading off SD
     const char *var_names[N_PRESETS*3] = {"dsl", "gha", "afc", "dsl_fullon", "gha_fullon", "afc_fullon", "dsl_rts", "gha_rts", "afc_rts"}; //use for writing to SD          
+    const char *filterbank_fnames[N_PRESETS] = {"GHA_Constants_FB.txt", "GHA_FullOn_FB.txt", "GHA_RTS_FB.txt"};  //the filterbank type of each preset (the library's CHA_DSL file has no place for it)
+    const int default_filterbank_type[N_PRESETS] = {FILTERBANK_IIR, FILTERBANK_IIR, FILTERBANK_IIR};
     void setPresetToDefault(int Ipreset) {
       //Serial.print("State: setPresetToDefault: setting preset "); Serial.println(Ipreset);
       
@@ -118,6 +132,7 @@ class State {
 
       //choose the one for the given preset
       int i = Ipreset;
+      presets[i].filterbank_type = default_filterbank_type[i];
       switch (i) {
         case ALG_PRESET_A:
           presets[i].wdrc_perBand = dsl;  
@@ -173,6 +188,9 @@ class State {
   
       //did all three get successfully read?
       if (!loadFromSD || !is_SD_success) setPresetToDefault(i);
+
+      //the filterbank type is in its own file.  If there's no file (such as an SD card saved before it existed), keep the default.
+      if (loadFromSD && is_SD_success) readFilterbankTypeFromSD(i);
     }    
 
     void saveCurrentAlgPresetToSD(bool writeToSD = false) { //saves the current preset to the presets[] array and (maybe) writes to SD
@@ -182,6 +200,7 @@ class State {
       presets[i].wdrc_perBand = wdrc_perBand;
       presets[i].wdrc_broadband = wdrc_broadband;
       presets[i].afc = afc;
+      presets[i].filterbank_type = filterbank_type;
 
       //write preset to the SD card
       if (writeToSD) {
@@ -189,6 +208,7 @@ class State {
         presets[i].wdrc_perBand.printToSD(fname,var_names[i*3+0], true);  //the "true" says to start from a fresh file
         presets[i].wdrc_broadband.printToSD(fname,var_names[i*3+1]);  //append to the file
         presets[i].afc.printToSD(fname,var_names[i*3+2]);  //append to the file
+        writeFilterbankTypeToSD(i);
       }
     }
     void revertCurrentAlgPresetToDefault(bool writeToSD = false) { //saves the current preset to the presets[] array and (maybe) writes to SD
@@ -212,10 +232,43 @@ class State {
         presets[i].wdrc_perBand.printToSD(fname,var_names[i*3+0], true);  //the "true" says to start from a fresh file
         presets[i].wdrc_broadband.printToSD(fname,var_names[i*3+1]);  //append to the file
         presets[i].afc.printToSD(fname,var_names[i*3+2]);  //append to the file
+        writeFilterbankTypeToSD(i);
       }
     }
 
+    //the filterbank type is saved as one line of text, such as "filterbank_type = 1", in filterbank_fnames[Ipreset]
+    bool writeFilterbankTypeToSD(int Ipreset) {
+      if (!beginSD()) return false;
+      FsFile file;
+      if (!file.open(&sd, filterbank_fnames[Ipreset], O_WRONLY | O_CREAT | O_TRUNC)) {
+        Serial.print("State: writeFilterbankTypeToSD: *** WARNING *** could not open "); Serial.println(filterbank_fnames[Ipreset]);
+        return false;
+      }
+      file.print("filterbank_type = "); file.println(presets[Ipreset].filterbank_type);
+      file.close();
+      return true;
+    }
+    bool readFilterbankTypeFromSD(int Ipreset) {
+      if (!beginSD()) return false;
+      FsFile file;
+      if (!file.open(&sd, filterbank_fnames[Ipreset], O_RDONLY)) return false;  //no file, so keep what is there
+      char line[40] = {0};
+      int n = file.fgets(line, sizeof(line));
+      file.close();
+      int val = -1;
+      if ((n <= 0) || (sscanf(line, "filterbank_type = %d", &val) != 1) || ((val != FILTERBANK_IIR) && (val != FILTERBANK_POLYPHASE))) {
+        Serial.print("State: readFilterbankTypeFromSD: *** WARNING *** could not understand "); Serial.println(filterbank_fnames[Ipreset]);
+        return false;
+      }
+      presets[Ipreset].filterbank_type = val;
+      return true;
+    }
+
   private:
+    SdFs sd;
+    bool is_sd_begun = false;
+    bool beginSD(void) { if (!is_sd_begun) is_sd_begun = sd.begin(SdioConfig(FIFO_SDIO)); return is_sd_begun; }
+
     Print *local_serial;
     AudioSettings_F32 *local_audio_settings;
 };
@@ -59,6 +59,11 @@ const int ANALOG_IN = 0, PDM_IN = 1;
 //local files
 #include "AudioEffectFeedbackCancel_F32.h"
 #include "AudioEffectAFC_BTNRH_F32.h"
+#include "AudioEffectCompWDRC_Local_F32.h"
+#include "AudioEffectCompWDRC_StereoLink_F32.h"
+#include "AudioEffectMultiBandDelay_F32.h"
+#include "AudioFilterbankPolyphaseDFT_F32.h"
+#include "FilterbankAlignment.h"
 #include "SerialManager.h"
 
 //define the sample rate and audio block size
@@ -232,6 +237,10 @@ void setupAudioProcessing(void) {
 #define COEFF_PER_BIQUAD  6                         //3 "b" coefficients and 3 "a" coefficients per biquad
 float  filter_sos[N_CHAN_MAX][N_BIQUAD_PER_FILT * COEFF_PER_BIQUAD];   //this holds all the biquad filter coefficients
 int    filter_delay[N_CHAN_MAX];                    //added delay (samples) for each filter (int[8])
+float  filter_polarity[N_CHAN_MAX];                 //polarity (+1 or -1) for each filter
+#define MAX_FILTER_ALIGN_DELAY 128                  //max added delay (samples) allowed when aligning the filters
+FilterbankAlignment filterbankAligner;              //computes filter_delay and filter_polarity from the filter coefficients
+#define POLYPHASE_FB_N_FFT 128                      //number of FFT points for the polyphase filterbank (32, 64, or 128).  128 gives 187.5 Hz bins at 24 kHz.
 
 // setup the per-band processing
 void setupFromDSL(BTNRH_WDRC::CHA_DSL &this_dsl, float gha_tk, const int n_chan_max, const AudioSettings_F32 &settings) {
@@ -246,10 +255,32 @@ void setupFromDSL(BTNRH_WDRC::CHA_DSL &this_dsl, float gha_tk, const int n_chan_
   float td_msec = 2.5f;          //allowed time delay (msec)
   float *crossover_freq = this_dsl.cross_freq;  //crossover frequencies (Hz)
  
-  // //compute the per-channel filter coefficients
-  Serial.println("setupFromDSL: computing SOS filter coefficients...");
-  filterBankCalculator.createFilterCoeff_SOS(n_chan, n_iir, sample_rate_Hz, td_msec, crossover_freq,  // these are the inputs
-        (float *)filter_sos, filter_delay);  //these are the outputs
+  //are we using the polyphase filterbank instead of the IIR filters?
+  bool use_polyphase = (myState.filterbank_type == State::FILTERBANK_POLYPHASE);
+  if (use_polyphase) {
+    Serial.println("setupFromDSL: designing polyphase DFT filterbank...");
+    for (int Iear = 0; Iear < N_EARPIECES; Iear++) {
+      if (polyFilt[Iear].design(POLYPHASE_FB_N_FFT, crossover_freq, n_chan, sample_rate_Hz) < 0) {
+        Serial.println("setupFromDSL: *** WARNING ***: polyphase design failed.  Reverting to the IIR filterbank.");
+        use_polyphase = false;
+        myState.filterbank_type = State::FILTERBANK_IIR;
+      }
+    }
+  }
+  if (use_polyphase) {
+    //the polyphase bands are already time-aligned
+    for (int Iband = 0; Iband < n_chan; Iband++) { filter_delay[Iband] = 0; filter_polarity[Iband] = 1.0f; }
+  } else {
+    // //compute the per-channel filter coefficients
+    Serial.println("setupFromDSL: computing SOS filter coefficients...");
+    filterBankCalculator.createFilterCoeff_SOS(n_chan, n_iir, sample_rate_Hz, td_msec, crossover_freq,  // these are the inputs
+          (float *)filter_sos, filter_delay);  //these are the outputs
+
+    //replace the filter delays with ones computed from the coefficients (also finds the polarity)
+    Serial.println("setupFromDSL: computing filter delays and polarity...");
+    filterbankAligner.computeDelaysAndPolarity((float *)filter_sos, n_chan, N_BIQUAD_PER_FILT, sample_rate_Hz, crossover_freq,
+          MAX_FILTER_ALIGN_DELAY, filter_delay, filter_polarity);
+  }
 
   #if 0
     //plot coefficients (for debugging)
@@ -266,26 +297,21 @@ void setupFromDSL(BTNRH_WDRC::CHA_DSL &this_dsl, float gha_tk, const int n_chan_
   // Loop over each ear
   Serial.println("setupFromDSL: deploying SOS filter coefficients to the filter objects...");
   for (int Iear = 0; Iear < N_EARPIECES; Iear++) {
+    //only run one of the filterbanks
+    if (use_polyphase) { polyFilt[Iear].begin(); } else { polyFilt[Iear].end(); }
+
     //give the pre-computed coefficients to the IIR filters
     for (int Iband = 0; Iband < n_chan_max; Iband++) {
       //Serial.print("    : SOS ear, band: "); Serial.print(Iear); Serial.print(", "); Serial.println(Iband);
-      if (Iband < n_chan) {
+      if ((Iband < n_chan) && (!use_polyphase)) {
         bpFilt[Iear][Iband].setFilterCoeff_Matlab_sos(&(filter_sos[Iband][0]), N_BIQUAD_PER_FILT);  //sets multiple biquads.  Also calls begin().
       } else {
         bpFilt[Iear][Iband].end();
       }
     }
     
-    //setup the per-channel delays
-    for (int Iband = 0; Iband < n_chan_max; Iband++) {
-      postFiltDelay[Iear][Iband].setSampleRate_Hz(audio_settings.sample_rate_Hz);
-      if (Iband < n_chan) {
-        //postFiltDelay[Iear][Iband].delay(0, all_matlab_sos_delay_msec[Iband]); //from filter_coeff_sos.h.  milliseconds!!!
-        postFiltDelay[Iear][Iband].delay(0, ((float)filter_delay[Iband]/sample_rate_Hz)*1000.0f); //from filter_coeff_sos.h.  milliseconds!!!
-      } else {
-        postFiltDelay[Iear][Iband].delay(0, 0); //from filter_coeff_sos.h.  milliseconds!!!
-      }
-    }
+    //setup the per-channel delays (and polarity)...unused bands get zero delay
+    postFiltDelay[Iear].setDelays(n_chan, filter_delay, filter_polarity);  //samples, not milliseconds!!!
   
     //setup all of the per-channel compressors
     configurePerBandWDRCs(n_chan, settings.sample_rate_Hz, this_dsl, gha_tk, expCompLim[Iear]);
@@ -347,12 +373,76 @@ void setAlgorithmPreset(int preset_ind) {
   //Serial.print("setAlgorithmPreset: ind = "); Serial.print(preset_ind); Serial.print(", really? "); Serial.println(is_ok_value);
   if (is_ok_value) {
     myState.current_alg_config = preset_ind;
+    myState.filterbank_type = myState.presets[preset_ind].filterbank_type;
     setupFromDSLandGHAandAFC(myState.presets[preset_ind].wdrc_perBand, myState.presets[preset_ind].wdrc_broadband, myState.presets[preset_ind].afc, N_CHAN_MAX, audio_settings);
   }
   
   //configureLeftRightMixer(State::INPUTMIX_STEREO);
 }
 
+//switch between the IIR filterbank and the polyphase DFT filterbank.  The choice is kept with the current preset, so that
+//re-selecting the preset keeps it, and it is saved to the SD card with the rest of the preset ('[').
+int setFilterbankType(int type) {
+  myState.filterbank_type = (type == State::FILTERBANK_POLYPHASE) ? State::FILTERBANK_POLYPHASE : State::FILTERBANK_IIR;
+  myState.presets[myState.current_alg_config].filterbank_type = myState.filterbank_type;
+  setupFromDSL(myState.wdrc_perBand, myState.wdrc_broadband.tk, N_CHAN_MAX, audio_settings);
+  return myState.filterbank_type;
+}
+
+//Time the IIR filterbank and the polyphase filterbank for different numbers of bands.  The IIR filters are
+//timed using the same CMSIS biquad routine that AudioFilterBiquad_F32 uses.  This uses its own filter objects,
+//so it does not disturb the audio (though it does take some CPU time away from the audio).
+void benchmarkFilterbanks(void) {
+  const int n_trials = 16, n_samp = audio_block_samples, max_bands = 32;
+  const int n_stages = N_BIQUAD_PER_FILT;
+  static float x[AUDIO_BLOCK_SAMPLES], y[max_bands][AUDIO_BLOCK_SAMPLES];
+  static float coeff[5 * n_stages], biquad_state[max_bands][4 * n_stages];
+  static arm_biquad_casd_df1_inst_f32 biquad[max_bands];
+  static AudioFilterbankPolyphaseDFT_F32 poly;  //our own copy so that we don't disturb the audio
+  float cross_freq[max_bands];
+  float *y_ptr[max_bands];
+  for (int i = 0; i < max_bands; i++) y_ptr[i] = y[i];
+  for (int i = 0; i < n_samp; i++) x[i] = ((float)random(-1000, 1000)) / 1000.0f;
+
+  //some (stable) biquad coefficients in CMSIS order [b0 b1 b2 -a1 -a2].  The cost does not depend on their values.
+  for (int Istage = 0; Istage < n_stages; Istage++) {
+    coeff[5*Istage+0] = 0.1f; coeff[5*Istage+1] = 0.0f; coeff[5*Istage+2] = -0.1f;
+    coeff[5*Istage+3] = 1.5f; coeff[5*Istage+4] = -0.8f;
+  }
+  for (int Iband = 0; Iband < max_bands; Iband++) arm_biquad_cascade_df1_init_f32(&biquad[Iband], n_stages, coeff, biquad_state[Iband]);
+
+  myTympan.println("Filterbank Benchmark: CPU cycles per block of " + String(n_samp) + " samples (" + String(n_stages) + " biquads per IIR band, " + String(POLYPHASE_FB_N_FFT) + "-point polyphase, hop of " + String(POLYPHASE_FB_N_FFT/2) + "):");
+  const int n_test = 5, test_bands[n_test] = {6, 8, 16, 24, 32};
+  int crossover_bands = -1;
+  for (int Itest = 0; Itest < n_test; Itest++) {
+    int n_bands = test_bands[Itest];
+    float fs_Hz = audio_settings.sample_rate_Hz;
+    for (int i = 0; i < n_bands - 1; i++) cross_freq[i] = ((float)(i + 1)) * (0.5f * fs_Hz / ((float)n_bands));  //evenly spaced
+    if (poly.design(POLYPHASE_FB_N_FFT, cross_freq, n_bands, fs_Hz) < 0) continue;
+
+    uint32_t start = ARM_DWT_CYCCNT;
+    for (int Itrial = 0; Itrial < n_trials; Itrial++) {
+      for (int Iband = 0; Iband < n_bands; Iband++) arm_biquad_cascade_df1_f32(&biquad[Iband], x, y[Iband], n_samp);
+    }
+    uint32_t iir_cycles = (ARM_DWT_CYCCNT - start) / n_trials;
+
+    start = ARM_DWT_CYCCNT;
+    for (int Itrial = 0; Itrial < n_trials; Itrial++) poly.processAudio(x, y_ptr, n_samp);  //16 x 24 samples is a whole number of hops, so this is the average cost
+    uint32_t poly_cycles = (ARM_DWT_CYCCNT - start) / n_trials;
+
+    if ((crossover_bands < 0) && (poly_cycles < iir_cycles)) crossover_bands = n_bands;
+    myTympan.print("  : " + String(n_bands) + " bands: IIR = " + String(iir_cycles));
+    myTympan.println(", Polyphase = " + String(poly_cycles));
+  }
+  if (crossover_bands > 0) {
+    myTympan.println("  : Polyphase is cheaper at " + String(crossover_bands) + " bands or more.");
+  } else {
+    myTympan.println("  : Polyphase was not cheaper for any of the tested number of bands.");
+  }
+  myTympan.println("  : Latency: Polyphase = " + String(poly.getLatency_samples()) + " samples = " + String(1000.0f * ((float)poly.getLatency_samples()) / audio_settings.sample_rate_Hz, 2)
+        + " msec (all bands).  IIR = per-band delays from setupFromDSL().");
+}
+
 void updateDSL(BTNRH_WDRC::CHA_DSL &this_dsl) {
   //setupFromDSLandGHAandAFC(this_dsl, myState.wdrc_broadband, myState.afc, N_CHAN_MAX, audio_settings);
   setupFromDSL(this_dsl, myState.wdrc_broadband.tk, N_CHAN_MAX, audio_settings);
@@ -396,7 +486,7 @@ void updateAFC(BTNRH_WDRC::CHA_AFC &this_afc) {
 }
 
 void configureBroadbandWDRCs(float fs_Hz, const BTNRH_WDRC::CHA_WDRC &this_gha,
-                             float vol_knob_gain_dB, AudioEffectCompWDRC_F32 &WDRC)
+                             float vol_knob_gain_dB, AudioEffectCompWDRC_Local_F32 &WDRC)
 {
   //extract the parameters
   float atk = (float)this_gha.attack;  //milliseconds!
@@ -418,7 +508,7 @@ void configureBroadbandWDRCs(float fs_Hz, const BTNRH_WDRC::CHA_WDRC &this_gha,
 }
 
 void configurePerBandWDRC(int Ichan, float fs_Hz,const BTNRH_WDRC::CHA_DSL &this_dsl, float gha_tk,
-                           AudioEffectCompWDRC_F32 &WDRC) {
+                           AudioEffectCompWDRC_Local_F32 &WDRC) {
   int i = Ichan;
   
   //logic and values are extracted from from CHAPRO repo agc_prepare.c
@@ -447,7 +537,7 @@ void configurePerBandWDRC(int Ichan, float fs_Hz,const BTNRH_WDRC::CHA_DSL &this
 
 void configurePerBandWDRCs(int nchan, float fs_Hz,
                            const BTNRH_WDRC::CHA_DSL &this_dsl, float gha_tk,
-                           AudioEffectCompWDRC_F32 *WDRCs)
+                           AudioEffectCompWDRC_Local_F32 *WDRCs)
 {
   if (nchan > this_dsl.nchannel) {
     myTympan.println(F("configureWDRC.configure: *** ERROR ***: nchan > dsl.nchannel"));
@@ -558,6 +648,105 @@ bool enableAFC(bool enable) {
   return myState.afc.default_to_active ;
 }
 
+//set how often (in samples) the WDRC compressors update their envelope and gain.  1 is every sample.
+int setWDRCControlDecimation(int N) {
+  for (int Iear = 0; Iear < N_EARPIECES; Iear++) {
+    for (int Iband = 0; Iband < N_CHAN_MAX; Iband++) N = expCompLim[Iear][Iband].setControlDecimation(N);
+    N = compBroadband[Iear].setControlDecimation(N);
+  }
+  return myState.wdrc_control_decimation = N;
+}
+
+//compare the control-rate gain against the per-sample gain (costs extra CPU while it is running)
+bool enableWDRCDeviationMonitor(bool enable) {
+  for (int Iear = 0; Iear < N_EARPIECES; Iear++) {
+    for (int Iband = 0; Iband < myState.getNChan(); Iband++) expCompLim[Iear][Iband].setEnableDeviationMonitor(enable);
+    compBroadband[Iear].setEnableDeviationMonitor(enable);
+  }
+  return enable;
+}
+
+void printWDRCControlRateReport(void) {
+  int n_chan = myState.getNChan();
+  myTympan.print("WDRC Control Rate: decimation = "); myTympan.print(myState.wdrc_control_decimation);
+  myTympan.print(" (update every "); myTympan.print(1000.0f * ((float)myState.wdrc_control_decimation) / audio_settings.sample_rate_Hz, 3); myTympan.println(" msec)");
+
+  //CPU of the compressors.  In stereo, the links call the compressors directly, so the CPU is counted in the links.
+  int n = 0;
+  if (RUN_STEREO) {
+    for (int Iband = 0; Iband < n_chan; Iband++) n += wdrcLink[Iband].cpu_cycles;
+    myTympan.print("  : CPU of per-band WDRCs (Left and Right) = "); myTympan.print(audio_settings.cpu_load_percent(n)); myTympan.println("%");
+    n = compBroadbandLink.cpu_cycles;
+    myTympan.print("  : CPU of broadband WDRC (Left and Right) = "); myTympan.print(audio_settings.cpu_load_percent(n)); myTympan.println("%");
+  } else {
+    for (int Iband = 0; Iband < n_chan; Iband++) n += expCompLim[LEFT][Iband].cpu_cycles;
+    myTympan.print("  : CPU of per-band WDRCs (Left) = "); myTympan.print(audio_settings.cpu_load_percent(n)); myTympan.println("%");
+    n = compBroadband[LEFT].cpu_cycles;
+    myTympan.print("  : CPU of broadband WDRC (Left) = "); myTympan.print(audio_settings.cpu_load_percent(n)); myTympan.println("%");
+  }
+
+  //deviation from the per-sample gain
+  if (expCompLim[LEFT][0].getEnableDeviationMonitor()) {
+    myTympan.print("  : Gain deviation (dB), Per-Band Max/Mean = ");
+    for (int Iband = 0; Iband < n_chan; Iband++) {
+      myTympan.print(expCompLim[LEFT][Iband].getMaxDeviation_dB(), 3); myTympan.print("/");
+      myTympan.print(expCompLim[LEFT][Iband].getMeanDeviation_dB(), 3); myTympan.print(", ");
+    }
+    myTympan.println();
+    myTympan.print("  : Gain deviation (dB), Broadband Max/Mean = ");
+    myTympan.print(compBroadband[LEFT].getMaxDeviation_dB(), 3); myTympan.print("/");
+    myTympan.println(compBroadband[LEFT].getMeanDeviation_dB(), 3);
+  } else {
+    myTympan.println("  : Gain deviation: monitor is off (CPU values above are valid).");
+  }
+}
+
+//link the left and right WDRCs (0.0 is independent, 1.0 is fully linked).  Only has an effect when RUN_STEREO.
+float setWDRCLinkWeight(float w) {
+  for (int Iband = 0; Iband < N_CHAN_MAX; Iband++) {
+    w = wdrcLink[Iband].setLinkWeight(w);
+    wdrcLink[Iband].resetILDMonitor();  //start the ILD measurement fresh for the new link weight (if the monitor is on)
+  }
+  w = compBroadbandLink.setLinkWeight(w);
+  compBroadbandLink.resetILDMonitor();
+  return myState.wdrc_link_weight = w;
+}
+
+//measure the left-right level difference going into and out of the linked WDRCs (costs extra CPU while it is running)
+bool enableWDRCILDMonitor(bool enable) {
+  for (int Iband = 0; Iband < N_CHAN_MAX; Iband++) wdrcLink[Iband].setEnableILDMonitor(enable);
+  compBroadbandLink.setEnableILDMonitor(enable);
+  return enable;
+}
+
+void printWDRCLinkReport(void) {
+  if (!RUN_STEREO) { myTympan.println("WDRC Link: not available...the system is not running in stereo (see RUN_STEREO)."); return; }
+  int n_chan = myState.getNChan();
+  myTympan.print("WDRC Link: weight = "); myTympan.println(myState.wdrc_link_weight, 2);
+
+  //CPU of the linked compressors (includes the compressors for both ears)
+  int n = 0;
+  for (int Iband = 0; Iband < n_chan; Iband++) n += wdrcLink[Iband].cpu_cycles;
+  myTympan.print("  : CPU of per-band WDRCs (Both Ears) = "); myTympan.print(audio_settings.cpu_load_percent(n)); myTympan.println("%");
+  n = compBroadbandLink.cpu_cycles;
+  myTympan.print("  : CPU of broadband WDRC (Both Ears) = "); myTympan.print(audio_settings.cpu_load_percent(n)); myTympan.println("%");
+
+  //how well is the interaural level difference being preserved?
+  if (!compBroadbandLink.getEnableILDMonitor()) {
+    myTympan.println("  : ILD: monitor is off (CPU values above are valid).  Send 'o' to turn it on.");
+    return;
+  }
+  myTympan.print("  : ILD (dB, Left re: Right), Per-Band In/Out = ");
+  for (int Iband = 0; Iband < n_chan; Iband++) {
+    myTympan.print(wdrcLink[Iband].getILD_in_dB(), 2); myTympan.print("/");
+    myTympan.print(wdrcLink[Iband].getILD_out_dB(), 2); myTympan.print(", ");
+  }
+  myTympan.println();
+  myTympan.print("  : ILD (dB, Left re: Right), Broadband In/Out = ");
+  myTympan.print(compBroadbandLink.getILD_in_dB(), 2); myTympan.print("/");
+  myTympan.println(compBroadbandLink.getILD_out_dB(), 2);
+}
+
 // ///////////////// Main setup() and loop() as required for all Arduino programs
 
 // define the setup() function, the function that is called once when the device is booting
@@ -780,9 +969,9 @@ void printCPUandMemory(unsigned long curTime_millis,unsigned long updatePeriod_m
 //    Serial.print("  : feedbackCancel = "); n=feedbackCancel.cpu_cycles;Serial.print(n);Serial.print(", "); Serial.print(audio_settings.cpu_load_percent(n));Serial.println("%");
 //    for (int i=0; i<4; i++) {
 //      Serial.print("  : bpFilt[0]["); Serial.print(i);Serial.print("] ="); n=bpFilt[0][i].cpu_cycles;Serial.print(n);Serial.print(", "); Serial.print(audio_settings.cpu_load_percent(n));Serial.println("%");
-//      Serial.print("  : postFiltDelay[0]["); Serial.print(i);Serial.print("] ="); n=postFiltDelay[0][i].cpu_cycles;Serial.print(n);Serial.print(", "); Serial.print(audio_settings.cpu_load_percent(n));Serial.println("%");
 //      Serial.print("  : expCompLim[0]["); Serial.print(i);Serial.print("] ="); n=expCompLim[0][i].cpu_cycles;Serial.print(n);Serial.print(", "); Serial.print(audio_settings.cpu_load_percent(n));Serial.println("%");
 //    }
+//    Serial.print("  : postFiltDelay[0] = "); n=postFiltDelay[0].cpu_cycles;Serial.print(n);Serial.print(", "); Serial.print(audio_settings.cpu_load_percent(n));Serial.println("%");
 //    Serial.print("  : mixerFilterBank[0] = "); n=mixerFilterBank[0].cpu_cycles;Serial.print(n);Serial.print(", "); Serial.print(audio_settings.cpu_load_percent(n));Serial.println("%");
 //    Serial.print("  : compBroadband[0] = "); n=compBroadband[0].cpu_cycles; Serial.print(n);Serial.print(", "); Serial.print(audio_settings.cpu_load_percent(n));Serial.println("%");
 //    Serial.print("  : feedbackLoopBack = "); n=feedbackLoopBack.cpu_cycles;Serial.print(n);Serial.print(", "); Serial.print(audio_settings.cpu_load_percent(n));Serial.println("%");
@@ -0,0 +1,158 @@
+
+#ifndef _CalibrationTable_h
+#define _CalibrationTable_h
+
+#include <Arduino.h>
+#include <SdFat.h>
+
+//Purpose: Hold a microphone's calibration: its sensitivity versus frequency, as the level (dBFS) that 94 dB SPL
+//   gives at 0 dB of input gain.  CalibraitonViaExternalMic measures it and saves it to the SD card.  Other sketches
+//   (such as SoundLevelMeterTabsint and CHAPRO_WDRC_w_Matlab_Serial) load it at startup instead of using a hardcoded
+//   number.  They all include this one copy, so the file format can only change in one place.  It is an Arduino
+//   library: copy (or link) Libraries/Tympan_CalibrationTable into your Arduino libraries folder, next to
+//   Tympan_Library.
+//
+//   Between the measured frequencies, the sensitivity is interpolated linearly versus log-frequency.  Beyond the
+//   ends, it is held at the end values.  Whenever the points change, the table is also sampled onto a fixed grid
+//   (CAL_TABLE_GRID_PER_OCTAVE points per octave, from 15.625 Hz to 64 kHz), so getSensitivityFast_dB() is O(1) for
+//   any frequency.  Above the grid, it is held at the grid's last value, like interpSensitivity_dB().  For a
+//   filterbank, fillBandCorrections_dB() gives one correction per band, to be computed once whenever the bands change
+//   and then simply added to each band's level.
+//
+//   SD file format (little-endian):
+//     char[4] "CALT", uint8 version (CAL_TABLE_VERSION), uint8 reserved, uint16 n_points,
+//     then float freq_Hz and float sensitivity_dB for each point (increasing frequency),
+//     then uint32 CRC-32 of all of the bytes before it.
+
+#define CAL_TABLE_VERSION         1
+#define CAL_TABLE_MAX_POINTS      128
+#define CAL_TABLE_HEADER_BYTES    8
+#define CAL_TABLE_GRID_MIN_HZ     15.625f  //1000 Hz / 2^6, so that 1 kHz is exactly on the grid
+#define CAL_TABLE_GRID_PER_OCTAVE 12
+#define CAL_TABLE_GRID_N_OCTAVES  12       //up to 64 kHz, past the Nyquist frequency of every Tympan sample rate (48 kHz at 96 kHz)
+#define CAL_TABLE_GRID_POINTS     (CAL_TABLE_GRID_PER_OCTAVE * CAL_TABLE_GRID_N_OCTAVES + 1)
+
+class CalibrationTable {
+  public:
+    CalibrationTable(void) { clear(); }
+
+    void clear(void) { n_points = 0; buildGrid(); }
+    int getNPoints(void) { return n_points; }
+    bool isEmpty(void) { return n_points == 0; }
+    float getFreq_Hz(int ind) { return freq_Hz[max(0, min(n_points - 1, ind))]; }
+    float getSensitivity_dB(int ind) { return sens_dB[max(0, min(n_points - 1, ind))]; }
+
+    //add a point.  The frequencies must be added in increasing order.  Returns false if it was not added.
+    bool addPoint(float _freq_Hz, float _sens_dB) {
+      if ((n_points >= CAL_TABLE_MAX_POINTS) || (_freq_Hz <= 0.0f) || ((n_points > 0) && (_freq_Hz <= freq_Hz[n_points - 1]))) return false;
+      freq_Hz[n_points] = _freq_Hz;  sens_dB[n_points] = _sens_dB;
+      n_points++;
+      buildGrid();
+      return true;
+    }
+
+    //sensitivity at any frequency, interpolated from the points (binary search).  Zero if the table is empty.
+    float interpSensitivity_dB(float f_Hz) {
+      if (n_points == 0) return 0.0f;
+      if (f_Hz <= freq_Hz[0]) return sens_dB[0];
+      if (f_Hz >= freq_Hz[n_points - 1]) return sens_dB[n_points - 1];
+      int lo = 0, hi = n_points - 1;
+      while (hi - lo > 1) { int mid = (lo + hi) / 2; if (freq_Hz[mid] <= f_Hz) lo = mid; else hi = mid; }
+      float frac = log2f(f_Hz / freq_Hz[lo]) / log2f(freq_Hz[hi] / freq_Hz[lo]);
+      return sens_dB[lo] + frac * (sens_dB[hi] - sens_dB[lo]);
+    }
+
+    //sensitivity at any frequency, from the pre-computed grid (O(1))
+    float getSensitivityFast_dB(float f_Hz) {
+      float x = (f_Hz > CAL_TABLE_GRID_MIN_HZ) ? log2f(f_Hz / CAL_TABLE_GRID_MIN_HZ) * CAL_TABLE_GRID_PER_OCTAVE : 0.0f;
+      if (x >= (float)(CAL_TABLE_GRID_POINTS - 1)) return grid_dB[CAL_TABLE_GRID_POINTS - 1];
+      int ind = (int)x;
+      float frac = x - (float)ind;
+      return grid_dB[ind] + frac * (grid_dB[ind + 1] - grid_dB[ind]);
+    }
+
+    //For each band center frequency, the dB to add to that band's level (relative to calibrating at ref_Hz).  If the
+    //mic is less sensitive at a band's frequency than at ref_Hz, that band needs a positive correction.
+    void fillBandCorrections_dB(const float *center_Hz, int n_bands, float ref_Hz, float *corr_dB) {
+      float ref_dB = getSensitivityFast_dB(ref_Hz);
+      for (int i = 0; i < n_bands; i++) corr_dB[i] = (n_points > 0) ? (ref_dB - getSensitivityFast_dB(center_Hz[i])) : 0.0f;
+    }
+
+    //write the table to the SD card (see the file format at the top).  Returns true if OK.
+    bool save(SdFs *sd, const char *fname) {
+      FsFile file;
+      if (!file.open(sd, fname, O_WRONLY | O_CREAT | O_TRUNC)) return false;
+      uint8_t header[CAL_TABLE_HEADER_BYTES] = {'C', 'A', 'L', 'T', CAL_TABLE_VERSION, 0, 0, 0};
+      uint16_t n = (uint16_t)n_points;  memcpy(header + 6, &n, 2);
+      uint32_t crc = updateCRC32(0xFFFFFFFF, header, CAL_TABLE_HEADER_BYTES);
+      bool ok = (file.write(header, CAL_TABLE_HEADER_BYTES) == CAL_TABLE_HEADER_BYTES);
+      for (int i = 0; i < n_points; i++) {
+        uint8_t point[8];
+        memcpy(point, &freq_Hz[i], 4);  memcpy(point + 4, &sens_dB[i], 4);
+        crc = updateCRC32(crc, point, 8);
+        ok = ok && (file.write(point, 8) == 8);
+      }
+      crc = ~crc;
+      ok = ok && (file.write((const uint8_t *)&crc, 4) == 4);
+      file.close();
+      return ok;
+    }
+
+    //read the table from the SD card.  If anything is wrong with the file, the table is left as it was and this returns false.
+    bool load(SdFs *sd, const char *fname) {
+      FsFile file;
+      if (!file.open(sd, fname, O_RDONLY)) return false;
+      uint8_t header[CAL_TABLE_HEADER_BYTES];
+      bool ok = (file.read(header, CAL_TABLE_HEADER_BYTES) == CAL_TABLE_HEADER_BYTES);
+      uint16_t n = 0;  memcpy(&n, header + 6, 2);
+      ok = ok && (memcmp(header, "CALT", 4) == 0) && (header[4] == CAL_TABLE_VERSION) && (n <= CAL_TABLE_MAX_POINTS);
+      if (!ok) { file.close(); return false; }
+
+      uint32_t crc = updateCRC32(0xFFFFFFFF, header, CAL_TABLE_HEADER_BYTES);
+      static float new_freq_Hz[CAL_TABLE_MAX_POINTS], new_sens_dB[CAL_TABLE_MAX_POINTS];
+      for (int i = 0; (i < n) && ok; i++) {
+        uint8_t point[8];
+        ok = (file.read(point, 8) == 8);
+        crc = updateCRC32(crc, point, 8);
+        memcpy(&new_freq_Hz[i], point, 4);  memcpy(&new_sens_dB[i], point + 4, 4);
+        if ((i > 0) && !(new_freq_Hz[i] > new_freq_Hz[i - 1])) ok = false;  //must be increasing
+      }
+      uint32_t file_crc = 0;
+      ok = ok && (file.read((uint8_t *)&file_crc, 4) == 4) && (file_crc == ~crc);
+      file.close();
+      if (!ok) return false;
+
+      n_points = n;
+      for (int i = 0; i < n_points; i++) { freq_Hz[i] = new_freq_Hz[i]; sens_dB[i] = new_sens_dB[i]; }
+      buildGrid();
+      return true;
+    }
+
+    void printTable(void) {
+      Serial.println("CalibrationTable: " + String(n_points) + " points: Freq (Hz), Sensitivity (dBFS at 94 dB SPL, 0 dB gain):");
+      for (int i = 0; i < n_points; i++) Serial.println("    " + String(freq_Hz[i], 1) + ", " + String(sens_dB[i], 2));
+    }
+
+  protected:
+    int n_points = 0;
+    float freq_Hz[CAL_TABLE_MAX_POINTS];
+    float sens_dB[CAL_TABLE_MAX_POINTS];
+    float grid_dB[CAL_TABLE_GRID_POINTS];  //the sensitivity at CAL_TABLE_GRID_MIN_HZ * 2^(i / CAL_TABLE_GRID_PER_OCTAVE)
+
+    void buildGrid(void) {
+      for (int i = 0; i < CAL_TABLE_GRID_POINTS; i++) {
+        grid_dB[i] = interpSensitivity_dB(CAL_TABLE_GRID_MIN_HZ * powf(2.0f, (float)i / (float)CAL_TABLE_GRID_PER_OCTAVE));
+      }
+    }
+
+    //CRC-32 (the same as zlib's crc32(), if started at 0xFFFFFFFF and inverted at the end)
+    static uint32_t updateCRC32(uint32_t crc, const uint8_t *data, int n) {
+      for (int i = 0; i < n; i++) {
+        crc ^= data[i];
+        for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+      }
+      return crc;
+    }
+};
+
+#endif
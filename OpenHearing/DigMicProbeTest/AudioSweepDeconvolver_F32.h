@@ -0,0 +1,251 @@
+
+#ifndef _AudioSweepDeconvolver_F32_h
+#define _AudioSweepDeconvolver_F32_h
+
+#include <Arduino.h>
+#include <AudioStream_F32.h>
+#include <arm_math.h>
+#include <SdFat.h>
+
+//Purpose: Measure the impulse response from the exponential sweep (AudioSynthToneSweepExp_F32) to each mic, on the
+//   Tympan, while the sweep is playing.  Only the impulse responses (a few kB) need to be written to the SD card,
+//   instead of many MB of raw audio.
+//
+//   Inputs 0-3 are the mics.  Input 4 is the sweep itself (connect the AudioSynthToneSweepExp_F32 directly), which is
+//   the reference.  Call start() at the same time as the sweep's play().
+//
+//   Method: for an exponential sweep x(t) from f1 to f2 over T seconds, Farina's inverse filter is the time-reversed
+//   sweep with an envelope that rises 6 dB/octave.  Convolving with it is the same as cross-correlating the recording
+//   y with g(t) = x(t) exp(t/L), where L = T / ln(f2/f1).  So, the impulse response is
+//       h[n] = sum_j g[j] y[j+n] / sum_j g[j] x[j],    for n = 0 to N_IR-1
+//   This is done with overlap-save FFTs.  The sweep is cut into partitions of N_IR samples.  For each partition p, the
+//   FFT of g (zero-padded to 2*N_IR) and the FFT of the 2*N_IR samples of each mic starting at p*N_IR give one
+//   partition's worth of the correlation: conj(G_p) Y_p.  These are summed in the frequency domain, so only one
+//   inverse FFT per mic is needed, at the end.  The linear impulse response lands at n >= 0.  The harmonic distortion
+//   products would land at n < 0, so they are left out.
+//
+//   update() only copies the audio into ring buffers.  The FFTs are done in service(), which must be called from
+//   loop() often enough to keep up.  The ring buffers hold two partitions of slack (see getMaxStall_msec()), which is
+//   21.3 msec at 96 kHz for N_IR = 1024.  If loop() is ever held up for longer than that, the measurement fails rather
+//   than giving bad impulse responses.  Writing to the SD card can hold up loop() for longer than that (a card can
+//   pause for 100 msec or more while it erases), so call service() before servicing the SD writer, and expect some
+//   measurements to fail if the raw audio is being recorded to SD at the same time.  A bigger ring would not fix it:
+//   covering a 250 msec stall at 96 kHz would take about 430 kB more DMAMEM, which is more than is left next to the
+//   SD writer's buffer.
+//
+//   The ring buffers and FFT buffers are given to setMemory(), such as a DMAMEM array of SWEEP_DECONV_MEMORY_FLOATS
+//   floats (about 136 kB for N_IR = 1024).
+//
+//   SD file format (little-endian):
+//     char[4] "SWIR", uint8 version (SWEEP_DECONV_FILE_VERSION), uint8 n_chan, uint16 n_ir,
+//     float sample_rate_Hz, float f1_Hz, float f2_Hz, float dur_sec, uint32 n_partitions,
+//     then float h[n_ir] for each channel.  See readSweepIR.m, and see sweepDeconvReference.m for checking it.
+
+#define SWEEP_DECONV_N_CHAN        4
+#define SWEEP_DECONV_N_IR          1024   //length of the impulse responses.  Power of 2, up to 2048 (for arm_rfft_fast_f32)
+#define SWEEP_DECONV_NFFT          (2 * SWEEP_DECONV_N_IR)
+#define SWEEP_DECONV_RING          (4 * SWEEP_DECONV_N_IR)  //two partitions being analyzed, plus slack for a slow loop()
+#define SWEEP_DECONV_FILE_VERSION  1
+#define SWEEP_DECONV_MEMORY_FLOATS ((SWEEP_DECONV_N_CHAN + 1) * SWEEP_DECONV_RING + (SWEEP_DECONV_N_CHAN + 3) * SWEEP_DECONV_NFFT)  //for setMemory()
+
+class AudioSweepDeconvolver_F32 : public AudioStream_F32 {
+  //GUI: inputs:5, outputs:0  //this line used for automatic generation of GUI node
+  public:
+    enum STATE { IDLE = 0, CAPTURING, PROCESSING, FINISHED, FAILED };
+    static const int REF_CHAN = SWEEP_DECONV_N_CHAN;
+
+    AudioSweepDeconvolver_F32(void) : AudioStream_F32(SWEEP_DECONV_N_CHAN + 1, inputQueueArray_f32) { }
+    AudioSweepDeconvolver_F32(const AudioSettings_F32 &settings) : AudioStream_F32(SWEEP_DECONV_N_CHAN + 1, inputQueueArray_f32) {
+      sample_rate_Hz = settings.sample_rate_Hz;
+      block_size = settings.audio_block_samples;
+    }
+
+    //number of floats that setMemory() needs
+    static int getMemoryNeeded(void) { return SWEEP_DECONV_MEMORY_FLOATS; }
+
+    //give the memory for the buffers (at least getMemoryNeeded() floats).  Returns false if it's too small.
+    bool setMemory(float *mem, int n_floats) {
+      if ((mem == NULL) || (n_floats < getMemoryNeeded())) {
+        Serial.println("AudioSweepDeconvolver_F32: setMemory: *** ERROR ***: need " + String(getMemoryNeeded()) + " floats.");
+        return false;
+      }
+      for (int Ichan = 0; Ichan <= SWEEP_DECONV_N_CHAN; Ichan++) { ring[Ichan] = mem; mem += SWEEP_DECONV_RING; }
+      for (int Ichan = 0; Ichan < SWEEP_DECONV_N_CHAN; Ichan++) { H_acc[Ichan] = mem; mem += SWEEP_DECONV_NFFT; }
+      G = mem;   mem += SWEEP_DECONV_NFFT;
+      Y = mem;   mem += SWEEP_DECONV_NFFT;
+      tmp = mem; mem += SWEEP_DECONV_NFFT;
+      arm_rfft_fast_init_f32(&rfft, SWEEP_DECONV_NFFT);
+      return true;
+    }
+
+    //start a measurement.  Call this (inside AudioNoInterrupts()) together with the sweep's play(), with the same values.
+    bool start(float _f1_Hz, float _f2_Hz, float _dur_sec) {
+      if ((G == NULL) || (_f1_Hz <= 0.0f) || (_f2_Hz <= _f1_Hz) || (_dur_sec <= 0.0f)) return false;
+      f1_Hz = _f1_Hz;  f2_Hz = _f2_Hz;  dur_sec = _dur_sec;
+      n_sweep = (uint32_t)(dur_sec * sample_rate_Hz + 0.5f);
+      n_partitions = (n_sweep + SWEEP_DECONV_N_IR - 1) / SWEEP_DECONV_N_IR;
+      weight_per_sample = logf(f2_Hz / f1_Hz) / ((float)n_sweep);  //1/L, in samples
+      for (int Ichan = 0; Ichan < SWEEP_DECONV_N_CHAN; Ichan++) for (int I = 0; I < SWEEP_DECONV_NFFT; I++) H_acc[Ichan][I] = 0.0f;
+      norm = 0.0;
+      n_partitions_done = 0;
+      overrun = false;
+      n_written = 0;
+      state = CAPTURING;  //set last, because update() looks at it
+      return true;
+    }
+    void stop(void) { state = IDLE; }
+
+    int getState(void) { return state; }
+    bool isBusy(void) { return (state == CAPTURING) || (state == PROCESSING); }
+    uint32_t getNumPartitions(void) { return n_partitions; }
+    float getMaxStall_msec(void) { return 1000.0f * (float)(SWEEP_DECONV_RING - 2 * SWEEP_DECONV_N_IR) / sample_rate_Hz; }  //the longest that loop() can be held up
+    float getSampleRate_Hz(void) { return sample_rate_Hz; }
+
+    //the impulse responses (SWEEP_DECONV_N_IR samples each), once getState() is FINISHED
+    const float* getImpulseResponse(int Ichan) { return ((state == FINISHED) && (Ichan >= 0) && (Ichan < SWEEP_DECONV_N_CHAN)) ? H_acc[Ichan] : NULL; }
+
+    //here is the method called automatically by the audio library.  It only copies the audio into the ring buffers.
+    virtual void update(void) {
+      audio_block_f32_t *blocks[SWEEP_DECONV_N_CHAN + 1];
+      for (int Ichan = 0; Ichan <= SWEEP_DECONV_N_CHAN; Ichan++) blocks[Ichan] = AudioStream_F32::receiveReadOnly_f32(Ichan);
+
+      if (state == CAPTURING) {  //missing blocks (such as from the sweep, once it has finished) are taken as zeros
+        int n = block_size;
+        uint32_t n_needed = (n_partitions + 1) * SWEEP_DECONV_N_IR;  //the last partition needs one more partition of the mics
+        n = (int)min((uint32_t)n, n_needed - n_written);
+        int Iring = (int)(n_written % SWEEP_DECONV_RING);
+        for (int Ichan = 0; Ichan <= SWEEP_DECONV_N_CHAN; Ichan++) {
+          float *buff = ring[Ichan];
+          int I_dest = Iring;
+          for (int I = 0; I < n; I++) {
+            buff[I_dest] = (blocks[Ichan] != NULL) ? blocks[Ichan]->data[I] : 0.0f;
+            if (++I_dest >= SWEEP_DECONV_RING) I_dest = 0;
+          }
+        }
+        n_written += n;
+        if (n_written >= n_needed) state = PROCESSING;  //no more audio is needed
+      }
+
+      for (int Ichan = 0; Ichan <= SWEEP_DECONV_N_CHAN; Ichan++) if (blocks[Ichan] != NULL) AudioStream_F32::release(blocks[Ichan]);
+    }
+
+    //Do the FFTs for any partitions that are ready, and finish up once they are all done.  Call from loop().
+    //Returns true when the measurement has just finished.
+    bool service(void) {
+      if ((state != CAPTURING) && (state != PROCESSING)) return false;
+
+      uint32_t n_avail = n_written;  //read once, because update() changes it
+      uint32_t n_ready = (n_avail >= 2 * SWEEP_DECONV_N_IR) ? min(n_partitions, n_avail / SWEEP_DECONV_N_IR - 1) : 0;
+      while (n_partitions_done < n_ready) {
+        processPartition(n_partitions_done);
+        //if update() has gotten more than a ring ahead of this partition, it overwrote some of it before we read it
+        if (n_written > n_partitions_done * SWEEP_DECONV_N_IR + SWEEP_DECONV_RING) overrun = true;
+        n_partitions_done++;
+      }
+
+      if ((state == PROCESSING) && (n_partitions_done >= n_partitions)) {
+        if (overrun) {
+          Serial.println("AudioSweepDeconvolver_F32: *** ERROR ***: loop() did not keep up with the audio.  The impulse responses are not valid.");
+          Serial.println("    : loop() was held up for more than " + String(getMaxStall_msec(), 1) + " msec, such as by an SD card write.  Try again, or don't record to SD at the same time.");
+          state = FAILED;
+          return true;
+        }
+        finish();
+        state = FINISHED;
+        return true;
+      }
+      return false;
+    }
+
+    //write the impulse responses to the SD card (see the file format at the top).  Returns true if OK.
+    bool writeToSD(SdFs *sd, const char *fname) {
+      if (state != FINISHED) return false;
+      FsFile file;
+      if (!file.open(sd, fname, O_WRONLY | O_CREAT | O_TRUNC)) return false;
+      uint8_t header[28];
+      memcpy(header, "SWIR", 4);
+      header[4] = SWEEP_DECONV_FILE_VERSION;
+      header[5] = SWEEP_DECONV_N_CHAN;
+      uint16_t n_ir = SWEEP_DECONV_N_IR;  memcpy(header + 6, &n_ir, 2);
+      memcpy(header + 8, &sample_rate_Hz, 4);
+      memcpy(header + 12, &f1_Hz, 4);
+      memcpy(header + 16, &f2_Hz, 4);
+      memcpy(header + 20, &dur_sec, 4);
+      memcpy(header + 24, &n_partitions, 4);
+      bool ok = (file.write(header, sizeof(header)) == sizeof(header));
+      for (int Ichan = 0; Ichan < SWEEP_DECONV_N_CHAN; Ichan++) {
+        ok = ok && (file.write((const uint8_t *)H_acc[Ichan], SWEEP_DECONV_N_IR * sizeof(float)) == SWEEP_DECONV_N_IR * sizeof(float));
+      }
+      file.close();
+      return ok;
+    }
+
+  protected:
+    audio_block_f32_t *inputQueueArray_f32[SWEEP_DECONV_N_CHAN + 1];
+    float sample_rate_Hz = AUDIO_SAMPLE_RATE_EXACT;
+    int block_size = AUDIO_BLOCK_SAMPLES;
+    volatile int state = IDLE;
+    float f1_Hz = 100.0f, f2_Hz = 20000.0f, dur_sec = 1.0f, weight_per_sample = 0.0f;
+    uint32_t n_sweep = 0, n_partitions = 0, n_partitions_done = 0;
+    volatile uint32_t n_written = 0;   //samples written into the rings since start()
+    bool overrun = false;
+    double norm = 0.0;                 //sum of g[j] x[j]
+    float *ring[SWEEP_DECONV_N_CHAN + 1] = {NULL};
+    float *H_acc[SWEEP_DECONV_N_CHAN] = {NULL};  //the summed correlation spectra (CMSIS packed format), then the impulse responses
+    float *G = NULL, *Y = NULL, *tmp = NULL;
+    arm_rfft_fast_instance_f32 rfft;
+
+    //copy n samples, starting from absolute sample index start, out of the channel's ring buffer
+    void copyFromRing(int Ichan, uint32_t start, int n, float *dest) {
+      const float *buff = ring[Ichan];
+      int Iring = (int)(start % SWEEP_DECONV_RING);
+      for (int I = 0; I < n; I++) {
+        dest[I] = buff[Iring];
+        if (++Iring >= SWEEP_DECONV_RING) Iring = 0;
+      }
+    }
+
+    //add one partition of the sweep to the correlation for each mic
+    void processPartition(uint32_t p) {
+      const int B = SWEEP_DECONV_N_IR, N = SWEEP_DECONV_NFFT;
+      const uint32_t start = p * B;
+
+      //g = reference times exp(t/L), zero-padded.  Also sum g x, for the normalization.
+      copyFromRing(REF_CHAN, start, B, tmp);
+      float weight = expf(weight_per_sample * (float)start), weight_step = expf(weight_per_sample);
+      float partial_norm = 0.0f;
+      for (int I = 0; I < B; I++) {
+        float x = tmp[I];
+        tmp[I] = x * weight;
+        partial_norm += tmp[I] * x;
+        weight *= weight_step;
+      }
+      norm += partial_norm;
+      for (int I = B; I < N; I++) tmp[I] = 0.0f;
+      arm_rfft_fast_f32(&rfft, tmp, G, 0);  //tmp is used as scratch by CMSIS
+
+      //for each mic: Y = FFT of 2B samples, then H_acc += conj(G) Y
+      for (int Ichan = 0; Ichan < SWEEP_DECONV_N_CHAN; Ichan++) {
+        copyFromRing(Ichan, start, N, tmp);
+        arm_rfft_fast_f32(&rfft, tmp, Y, 0);
+        float *H = H_acc[Ichan];
+        H[0] += G[0] * Y[0];  //DC (real)
+        H[1] += G[1] * Y[1];  //Nyquist (real), in CMSIS's packed format
+        for (int I = 2; I < N; I += 2) {
+          H[I]   += G[I] * Y[I]   + G[I+1] * Y[I+1];
+          H[I+1] += G[I] * Y[I+1] - G[I+1] * Y[I];
+        }
+      }
+    }
+
+    //inverse FFT each correlation, keep the first N_IR samples, and normalize
+    void finish(void) {
+      const float scale = (norm != 0.0) ? (float)(1.0 / norm) : 0.0f;
+      for (int Ichan = 0; Ichan < SWEEP_DECONV_N_CHAN; Ichan++) {
+        arm_rfft_fast_f32(&rfft, H_acc[Ichan], tmp, 1);  //inverse
+        for (int I = 0; I < SWEEP_DECONV_N_IR; I++) H_acc[Ichan][I] = tmp[I] * scale;
+      }
+    }
+};
+
+#endif
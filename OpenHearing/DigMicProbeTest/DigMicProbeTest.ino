@@ -9,6 +9,8 @@
           * Opiton 2: Play back an arbitrary signal from the SD card
       * Record audio from all four digital mics to SD card
       * Access SD card via "MTP Disk" mode
+      * Measure the impulse response to each mic on the Tympan while the chirp plays (AudioSweepDeconvolver_F32.h),
+        so that only the impulse responses need to be written to SD.  Check them with sweepDeconvReference.m.
 
   Switches:
       * To enable 4-channel audio, #define EN_4_SD_CHAN 1.  For 2-channel audio, comment this line out.
@@ -30,6 +32,7 @@
 #include <Tympan_Library.h>
 #include      "SerialManager.h"
 #include      "State.h"       
+#include      "AudioSweepDeconvolver_F32.h"
 
 // To enable 4-channel audio recordings, #define EN_4_SD_CHAN 1
 #define EN_4_SD_CHAN 1
@@ -63,6 +66,8 @@ AudioMixer4_F32            audioMixerL(audio_settings);    //from the Tympan_Lib
 AudioMixer4_F32            audioMixerR(audio_settings);    //from the Tympan_Library
 AudioOutputI2SQuad_F32     i2s_out(audio_settings);        //Send audio out
 AudioSDWriter_F32_UI       audioSDWriter(&sd, audio_settings);  //Write audio to the SD card (if activated)
+AudioSweepDeconvolver_F32  sweepDeconv(audio_settings);    //Measure the impulse responses from the chirp to each mic
+DMAMEM float sweepDeconvMemory[SWEEP_DECONV_MEMORY_FLOATS]; //buffers for sweepDeconv, in RAM2
 
 //Connect the signal sources to the audio mixer
 AudioConnection_F32           patchcord1(chirp,    0, audioMixerL, 0);   //chirp is mono, so simply send to left channel mixer
@@ -95,6 +100,13 @@ AudioConnection_F32           patchcord32(i2s_in, 0, audioSDWriter, 1);   //conn
   AudioConnection_F32           patchcord33(i2s_in, 3, audioSDWriter, 2);   //connect Raw audio to left channel of SD writer
   AudioConnection_F32           patchcord34(i2s_in, 2, audioSDWriter, 3);   //connect Raw audio to right channel of SD writer
 #endif
+
+//Connect the mics (in the same order as the SD writer) and the chirp itself to the deconvolver
+AudioConnection_F32           patchcord41(i2s_in, 1, sweepDeconv, 0);
+AudioConnection_F32           patchcord42(i2s_in, 0, sweepDeconv, 1);
+AudioConnection_F32           patchcord43(i2s_in, 3, sweepDeconv, 2);
+AudioConnection_F32           patchcord44(i2s_in, 2, sweepDeconv, 3);
+AudioConnection_F32           patchcord45(chirp,  0, sweepDeconv, AudioSweepDeconvolver_F32::REF_CHAN);  //the reference
 // /////////// Create classes for controlling the system, espcially via USB Serial and via the App
 
 #ifdef EN_BLE
@@ -273,6 +285,9 @@ void setup() {
   
   Serial.println("SD configured for " + String(audioSDWriter.getNumWriteChannels()) + " channels.");
 
+  //give the deconvolver its buffers
+  sweepDeconv.setMemory(sweepDeconvMemory, SWEEP_DECONV_MEMORY_FLOATS);
+
     //Set the state of the LEDs
   myTympan.setRedLED(HIGH); myTympan.setAmberLED(LOW);
 
@@ -296,6 +311,10 @@ void loop() {
     }
   #endif
 
+  //do the FFTs for the impulse response measurement (if running) and save the results when done.  This goes before the
+  //SD recording, which can hold up loop() for longer than the deconvolver can wait (see AudioSweepDeconvolver_F32.h)
+  if (!use_MTP) serviceSweepDeconvolution();
+
   //service the SD recording
   audioSDWriter.serviceSD_withWarnings(i2s_in); //For the warnings, it asks the i2s_in class for some info
 
@@ -332,14 +351,59 @@ void loop() {
 // //////////////////////////////////// Servicing routines not otherwise embedded in other classes
 
 int playChirp(void) {
+  AudioNoInterrupts();  //so that the deconvolver (if used) starts on the same audio block as the chirp
   chirp.play( sqrtf(powf(10.0f, 0.1f*myState.chirp_amp_dBFS)),
               myState.chirp_start_Hz,
               myState.chirp_end_Hz,
               myState.chirp_dur_sec
             );
+  if (myState.deconvolve_next_chirp) {
+    myState.deconvolve_next_chirp = false;
+    if (!sweepDeconv.start(myState.chirp_start_Hz, myState.chirp_end_Hz, myState.chirp_dur_sec)) {
+      Serial.println("playChirp: *** ERROR ***: could not start the deconvolution.");
+    }
+  }
+  AudioInterrupts();
   return 0;
 }
 
+//arm the deconvolution for the next chirp.  Returns false if a measurement is already running.
+bool armSweepDeconvolution(void) {
+  if (sweepDeconv.isBusy()) {
+    Serial.println("armSweepDeconvolution: *** ERROR ***: already measuring.  Ignoring.");
+    return false;
+  }
+  myState.deconvolve_next_chirp = true;
+  return true;
+}
+
+//when the deconvolver finishes, write the impulse responses to SD as SWIRxxx.BIN (the next unused number)
+void serviceSweepDeconvolution(void) {
+  if (!sweepDeconv.service()) return;  //not finished
+  if (sweepDeconv.getState() != AudioSweepDeconvolver_F32::FINISHED) return;  //failed.  It has already printed why.
+
+  //print the peak of each impulse response
+  for (int Ichan = 0; Ichan < SWEEP_DECONV_N_CHAN; Ichan++) {
+    const float *h = sweepDeconv.getImpulseResponse(Ichan);
+    int I_peak = 0;
+    for (int I = 1; I < SWEEP_DECONV_N_IR; I++) if (fabsf(h[I]) > fabsf(h[I_peak])) I_peak = I;
+    Serial.println("serviceSweepDeconvolution: Chan " + String(Ichan) + ": peak of " + String(20.0f*log10f(fabsf(h[I_peak]) + 1.0e-12f), 1)
+      + " dB at " + String(1000.0f * (float)I_peak / sweepDeconv.getSampleRate_Hz(), 3) + " msec");
+  }
+
+  //find an unused filename and write the file
+  char fname[16];
+  for (int Ifile = 1; Ifile < 1000; Ifile++) {
+    sprintf(fname, "SWIR%03d.BIN", Ifile);
+    if (!sd.exists(fname)) break;
+  }
+  if (sweepDeconv.writeToSD(&sd, fname)) {
+    Serial.println("serviceSweepDeconvolution: wrote impulse responses to " + String(fname));
+  } else {
+    Serial.println("serviceSweepDeconvolution: *** ERROR ***: could not write " + String(fname));
+  }
+}
+
 int playSD(int file_ind) {
   //check the inputs
   if (file_ind < 0) {
@@ -4,12 +4,14 @@
 
 #include <Tympan_Library.h>
 #include "State.h"
+#include "AudioSweepDeconvolver_F32.h"
 
 
 //Extern variables from the main *.ino file
 extern Tympan myTympan;
 extern AudioSDWriter_F32_UI audioSDWriter;
 extern State myState;
+extern AudioSweepDeconvolver_F32 sweepDeconv;
 
 
 //Extern Functions
@@ -20,6 +22,7 @@ extern float incrementChirpDuration(float);
 extern void startSignalWithDelay(float);
 extern float incrementOutputGain_dB(float increment_dB);
 extern void forceStopSDPlay(void);
+extern bool armSweepDeconvolution(void);
 
 
 //externals for MTP
@@ -58,6 +61,8 @@ void SerialManager::printHelp(void) {
   Serial.println("   1-3  : SDPlay : Play files 1-3 from SD Card");
   Serial.println("   q    : SDPlay : Stop any currently plying SD files");
   Serial.println("   b    : AutoWrite : Start chirp and SD recording together");
+  Serial.println("   m    : ImpResp : Start chirp and measure the impulse responses on the Tympan (saved as SWIRxxx.BIN)");
+  Serial.println("   M    : ImpResp : Same as 'm', plus the SD recording (for checking with sweepDeconvReference.m)");
   Serial.println("   4-6  : AutoWrite : Start files 1-3 from SD Card and SD recording together");
   Serial.println("   g/G  : OUTPUT : Incr/decrease DAC loudness (cur = " + String(myState.output_gain_dB,1) + " dB)");
   Serial.println("   r/s  : SDWrite: Manually Start/Stop recording");
@@ -151,6 +156,23 @@ bool SerialManager::processCharacter(char c) { //this is called by SerialManager
         myState.auto_sd_state = State::WAIT_START_SIGNAL;
       }
       break; 
+    case 'm':
+      Serial.println("Received: start chirp and impulse response measurement...");
+      if (armSweepDeconvolution()) startSignalWithDelay(0.0);  //no delay, start right away
+      break;
+    case 'M':
+      Serial.println("Received: start chirp, impulse response measurement, and SD recording...");
+      if (myState.auto_sd_state != State::DISABLED) {
+        Serial.println("   : ERROR : Already doing an auto-triggered SD recording.");
+        Serial.println("           : Ignoring the last command.");
+      } else if (armSweepDeconvolution()) {
+        Serial.println("   : Note: if the SD card stalls for more than " + String(sweepDeconv.getMaxStall_msec(), 1) + " msec, the measurement fails.  Use 'm' if it does.");
+        audioSDWriter.startRecording();
+        myState.autoPlay_signal_type = State::PLAY_CHIRP;
+        startSignalWithDelay(myState.auto_SD_start_stop_delay_sec);
+        myState.auto_sd_state = State::WAIT_START_SIGNAL;
+      }
+      break;
     case '1': case '2': case '3':
       myState.autoPlay_signal_type = c - ((int)'1') + State::PLAY_CHIRP + 1;  //This is me *computing* my way into the enum instead of a switch block.  Not recommended, but whatever.
       startSignalWithDelay(0.0); //play immediately
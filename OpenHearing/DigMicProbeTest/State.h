@@ -38,6 +38,7 @@ class State : public TympanStateBase_UI { // look in TympanStateBase or TympanSt
     float chirp_end_Hz = 20000.0;   //any value less than Nyquist
     float chirp_dur_sec = 5.0;      // any value
     float chirp_amp_dBFS = 0.0;   // limit to less than 0.0 dB
+    bool deconvolve_next_chirp = false;  //when the next chirp starts, also start the on-device deconvolution into impulse responses
     
     //controls for chirp and chirp+SD modes
     enum AUTO_SD_STATES {DISABLED=0, WAIT_START_SIGNAL, WAIT_END_SIGNAL, WAIT_STOP_SD};
@@ -0,0 +1,36 @@
+%% function ir = readSweepIR(fname)
+% Read the impulse responses that DigMicProbeTest measured on the Tympan (see AudioSweepDeconvolver_F32.h).  These
+% are the SWIRxxx.BIN files on the SD card, written after the 'm' or 'M' command.
+%
+% The returned ir has the fields: version, fs_Hz, f1_Hz, f2_Hz, dur_sec, n_partitions, t_sec ([n_ir x 1]), and
+% h ([n_ir x n_chan]).  The channels are in the same order as in the SD recordings.
+
+function ir = readSweepIR(fname)
+
+fid = fopen(fname, 'r', 'ieee-le');
+if fid < 0
+    error('readSweepIR: could not open %s', fname);
+end
+cleanup = onCleanup(@() fclose(fid));
+
+magic = char(fread(fid, 4, 'char')');
+if ~strcmp(magic, 'SWIR')
+    error('readSweepIR: %s is not an impulse response file', fname);
+end
+ir.version = fread(fid, 1, 'uint8');
+if ir.version ~= 1
+    error('readSweepIR: unknown version %d', ir.version);
+end
+n_chan = fread(fid, 1, 'uint8');
+n_ir = fread(fid, 1, 'uint16');
+ir.fs_Hz = fread(fid, 1, 'single');
+ir.f1_Hz = fread(fid, 1, 'single');
+ir.f2_Hz = fread(fid, 1, 'single');
+ir.dur_sec = fread(fid, 1, 'single');
+ir.n_partitions = fread(fid, 1, 'uint32');
+
+ir.h = fread(fid, [n_ir n_chan], 'single');
+if size(ir.h, 2) ~= n_chan
+    error('readSweepIR: %s is too short', fname);
+end
+ir.t_sec = (0:n_ir-1)' / ir.fs_Hz;
@@ -0,0 +1,58 @@
+%% function [h_ref, err_dB] = sweepDeconvReference(wav_fname, ir_fname)
+% Host reference for the impulse responses that DigMicProbeTest measures on the Tympan (AudioSweepDeconvolver_F32.h).
+%
+% On the Tympan, send 'M'.  This plays the chirp, measures the impulse responses (SWIRxxx.BIN), and also records the
+% raw audio (AUDIOxxx.WAV).  Then give both files here.  This regenerates the sweep from the values in the SWIR file
+% and deconvolves the raw recording in one big FFT (instead of the Tympan's partitioned FFTs):
+%     h[n] = sum_j g[j] y[j+n] / sum_j g[j] x[j],   g = x .* exp(t/L),   L = T / log(f2/f1)
+% which is the same as convolving with Farina's inverse filter.
+%
+% The SD recording starts before the chirp (auto_SD_start_stop_delay_sec), so the start of the sweep in the WAV is
+% found by lining up the first channel with the Tympan's impulse response.  The returned err_dB is the RMS difference
+% (relative to the RMS of h_ref) for each channel.  The sweep is regenerated here, so it might not exactly match the
+% AudioSynthToneSweepExp_F32 output.  That mismatch, not the partitioning, limits how closely the two agree.
+
+function [h_ref, err_dB] = sweepDeconvReference(wav_fname, ir_fname)
+
+ir = readSweepIR(ir_fname);
+[y, fs_Hz] = audioread(wav_fname);
+if abs(fs_Hz - ir.fs_Hz) > 1
+    error('sweepDeconvReference: WAV is %.0f Hz but the impulse responses are %.0f Hz', fs_Hz, ir.fs_Hz);
+end
+n_chan = size(ir.h, 2);
+n_ir = size(ir.h, 1);
+
+%regenerate the sweep and the weighted sweep
+n_sweep = round(ir.dur_sec * fs_Hz);
+t = (0:n_sweep-1)' / fs_Hz;
+L = ir.dur_sec / log(ir.f2_Hz / ir.f1_Hz);
+x = sin(2*pi*ir.f1_Hz*L*(exp(t/L) - 1));
+g = x .* exp(t/L);
+
+%cross-correlate every channel with g at all lags, in one big FFT
+Nfft = 2^nextpow2(size(y,1) + n_sweep);
+G = fft(g, Nfft);
+h_all = real(ifft(conj(G) .* fft(y(:,1:n_chan), Nfft))) / sum(g .* x);  %lag k is at index k+1
+
+%find where the sweep starts in the recording, using the first channel
+n_lags = size(y,1) - n_sweep;
+c = conv(h_all(1:n_lags+n_ir-1, 1), flipud(ir.h(:,1)), 'valid');
+[~, I] = max(abs(c));
+lag0 = I - 1;
+fprintf('sweepDeconvReference: the sweep starts %.4f sec into %s\n', lag0/fs_Hz, wav_fname);
+
+h_ref = h_all(lag0 + (1:n_ir), :);
+err_dB = 10*log10(sum((ir.h - h_ref).^2) ./ sum(h_ref.^2));
+for Ichan = 1:n_chan
+    fprintf('    Chan %d: error = %.1f dB\n', Ichan, err_dB(Ichan));
+end
+
+%plot
+figure;
+for Ichan = 1:n_chan
+    subplot(n_chan, 1, Ichan);
+    plot(ir.t_sec*1000, h_ref(:,Ichan), ir.t_sec*1000, ir.h(:,Ichan), '--');
+    ylabel(sprintf('Chan %d', Ichan));
+    if Ichan == 1, legend('Host', 'Tympan'); title(ir_fname, 'Interpreter', 'none'); end
+end
+xlabel('Time (msec)');
@@ -0,0 +1,147 @@
+
+#ifndef _AudioCalcLevelStatistics_F32_h
+#define _AudioCalcLevelStatistics_F32_h
+
+#include <Arduino.h>
+#include <AudioStream_F32.h>
+#include "AudioCalcOctaveLevels_F32.h"
+#include "LevelStatistics.h"
+
+//Purpose: Once per audio block, read the current level from the broadband level meter (AudioCalcLevel_F32) and from
+//   each band of the octave analyzer (AudioCalcOctaveLevels_F32), calibrate them to dB SPL, and add them to a
+//   LevelStatistics accumulator.  Statistic 0 is the broadband level.  Statistic 1+N is octave band N.  Each band can
+//   also get its own correction for the mic's frequency response (see setBandCorrections_dB()).
+//
+//   The levels from the level meters are time-weighted (FAST or SLOW), which is right for Lmax, the percentiles,
+//   and the dose, but not for the Leq.  So, the Leq is computed from the plain (not time-weighted) mean-square: of the
+//   input for the broadband level, and from the octave analyzer's takeSumOfSquares() for the bands.  So, connect the
+//   input to the same frequency-weighted audio as the broadband level meter.  Because the audio library updates the
+//   objects in the order that they were created, create this object after the level meters.
+//
+//   The statistics can be packed into a compact binary record (see fillRecord()) for writing to the SD card.
+//
+//   Separately, the Leq of every level is also accumulated over a short "log interval" (such as 125 msec to 1 sec)
+//   for the continuous data logger (see LevelLogger.h).  See getLogLeq_dB() and resetLogInterval().
+
+#define LEVEL_STATS_MAX_LEVELS      (1 + OCTAVE_LEVELS_MAX_BANDS)
+#define LEVEL_STATS_RECORD_MAGIC    0x534C    //"LS" when read as little-endian bytes
+#define LEVEL_STATS_RECORD_VERSION  1
+#define LEVEL_STATS_HEADER_BYTES    20
+#define LEVEL_STATS_BYTES_PER_LEVEL 10        //Leq, Lmax, L10, L50, L90 as int16 (0.1 dB)
+#define LEVEL_STATS_MAX_RECORD_BYTES (LEVEL_STATS_HEADER_BYTES + LEVEL_STATS_MAX_LEVELS * LEVEL_STATS_BYTES_PER_LEVEL)
+
+class AudioCalcLevelStatistics_F32 : public AudioStream_F32 {
+  //GUI: inputs:1, outputs:0  //this line used for automatic generation of GUI node
+  public:
+    AudioCalcLevelStatistics_F32(void) : AudioStream_F32(1, inputQueueArray_f32) { updateCalPower(); resetLogInterval(); }
+    AudioCalcLevelStatistics_F32(const AudioSettings_F32 &settings) : AudioStream_F32(1, inputQueueArray_f32) {
+      setSampleRate_Hz(settings.sample_rate_Hz);
+      updateCalPower();
+      resetLogInterval();
+    }
+
+    void setSampleRate_Hz(float fs_Hz) { sample_rate_Hz = fs_Hz; }
+    void setSources(AudioCalcLevel_F32 *_broadband, AudioCalcOctaveLevels_F32 *_octave) { broadband = _broadband; octave = _octave; }
+    float setCalibration_dB(float cal_dB) { cal_factor_dB = cal_dB; updateCalPower(); return cal_factor_dB; }  //added to the dBFS levels to get dB SPL
+
+    //extra dB added to each octave band (on top of the calibration), such as from CalibrationTable::fillBandCorrections_dB()
+    void setBandCorrections_dB(const float *corr_dB, int n_bands) {
+      for (int i = 0; i < OCTAVE_LEVELS_MAX_BANDS; i++) band_corr_dB[i] = (i < n_bands) ? corr_dB[i] : 0.0f;
+      updateCalPower();
+    }
+
+    int getNLevels(void) { return (octave) ? (1 + octave->getNBands()) : 1; }
+    LevelStatistics& getStats(int Ilevel) { return stats[max(0, min(LEVEL_STATS_MAX_LEVELS - 1, Ilevel))]; }
+
+    //call these with the audio interrupts paused (AudioNoInterrupts) so that the update() doesn't run mid-way through
+    void reset(void) { for (int i = 0; i < LEVEL_STATS_MAX_LEVELS; i++) stats[i].reset(); resetLogInterval(); }
+    void resetInterval(void) { for (int i = 0; i < LEVEL_STATS_MAX_LEVELS; i++) stats[i].resetInterval(); }
+    void resetLogInterval(void) { for (int i = 0; i < LEVEL_STATS_MAX_LEVELS; i++) { log_pow[i] = 0.0f; log_count[i] = 0; } }
+
+    //Leq over the log interval (dB SPL)
+    float getLogLeq_dB(int Ilevel) {
+      Ilevel = max(0, min(LEVEL_STATS_MAX_LEVELS - 1, Ilevel));
+      if (log_count[Ilevel] == 0) return -1000.0f;
+      return 10.0f * log10f(max(1.0e-20f, log_pow[Ilevel] / ((float)log_count[Ilevel])));
+    }
+
+    //here is the method called automatically by the audio library
+    virtual void update(void) {
+      audio_block_f32_t *in_block = AudioStream_F32::receiveReadOnly_f32();
+      if (!in_block) return;
+      float dt_sec = ((float)in_block->length) / sample_rate_Hz;
+
+      //the Leq: the plain mean-square of the broadband audio and of each octave band
+      float sum_sq = 0.0f;
+      for (int i = 0; i < in_block->length; i++) sum_sq += in_block->data[i] * in_block->data[i];
+      addSumOfSquares(0, sum_sq * cal_pow, (uint32_t)in_block->length);
+      AudioStream_F32::release(in_block);
+      int n_bands = (octave) ? octave->getNBands() : 0;
+      for (int Iband = 0; Iband < n_bands; Iband++) {
+        uint32_t n = 0;
+        octave->takeSumOfSquares(Iband, &sum_sq, &n);
+        if (n > 0) addSumOfSquares(1 + Iband, sum_sq * band_cal_pow[Iband], n);
+      }
+
+      //everything else: the time-weighted levels
+      if (broadband) stats[0].addLevel_dB(broadband->getCurrentLevel_dB() + cal_factor_dB, dt_sec);
+      for (int Iband = 0; Iband < n_bands; Iband++) stats[1 + Iband].addLevel_dB(octave->getCurrentLevel_dB(Iband) + cal_factor_dB + band_corr_dB[Iband], dt_sec);
+    }
+
+    //Pack the interval statistics into a binary record (little-endian).  Returns the number of bytes (or 0 if it doesn't fit).
+    //   Header: uint16 magic, uint8 version, uint8 n_levels, uint8 bands_per_octave, uint8 freq_weight, uint8 time_weight,
+    //           uint8 reserved, uint32 end time (millis), uint32 interval (msec), float dose of the broadband level (percent)
+    //   Then, for each level: int16 Leq, Lmax, L10, L50, L90 (units of 0.1 dB SPL)
+    int fillRecord(uint8_t *buf, int max_bytes, uint32_t end_millis, uint8_t freq_weight, uint8_t time_weight) {
+      int n_levels = getNLevels();
+      int n_bytes = LEVEL_STATS_HEADER_BYTES + n_levels * LEVEL_STATS_BYTES_PER_LEVEL;
+      if (n_bytes > max_bytes) return 0;
+
+      uint16_t magic = LEVEL_STATS_RECORD_MAGIC;
+      uint32_t interval_msec = (uint32_t)(1000.0f * stats[0].getInterval_sec() + 0.5f);
+      float dose_percent = stats[0].getDose_percent();
+      memcpy(buf + 0, &magic, 2);
+      buf[2] = LEVEL_STATS_RECORD_VERSION;
+      buf[3] = (uint8_t)n_levels;
+      buf[4] = (uint8_t)((octave) ? octave->getBandsPerOctave() : 0);
+      buf[5] = freq_weight; buf[6] = time_weight; buf[7] = 0;
+      memcpy(buf + 8, &end_millis, 4);
+      memcpy(buf + 12, &interval_msec, 4);
+      memcpy(buf + 16, &dose_percent, 4);
+
+      uint8_t *p = buf + LEVEL_STATS_HEADER_BYTES;
+      for (int Ilevel = 0; Ilevel < n_levels; Ilevel++) {
+        LevelStatistics &s = stats[Ilevel];
+        int16_t vals[LEVEL_STATS_BYTES_PER_LEVEL / 2] = {quantize(s.getLeq_dB()), quantize(s.getLmax_dB()),
+          quantize(s.getPercentileLevel_dB(10.0f)), quantize(s.getPercentileLevel_dB(50.0f)), quantize(s.getPercentileLevel_dB(90.0f))};
+        memcpy(p, vals, LEVEL_STATS_BYTES_PER_LEVEL);  //the record has no alignment, so don't write through an int16_t pointer
+        p += LEVEL_STATS_BYTES_PER_LEVEL;
+      }
+      return n_bytes;
+    }
+
+  protected:
+    audio_block_f32_t *inputQueueArray_f32[1];
+    float sample_rate_Hz = AUDIO_SAMPLE_RATE_EXACT;
+    float cal_factor_dB = 0.0f;
+    float band_corr_dB[OCTAVE_LEVELS_MAX_BANDS] = {0.0f};
+    float cal_pow = 1.0f, band_cal_pow[OCTAVE_LEVELS_MAX_BANDS];  //the calibration as a power ratio (see updateCalPower())
+    AudioCalcLevel_F32 *broadband = NULL;
+    AudioCalcOctaveLevels_F32 *octave = NULL;
+    LevelStatistics stats[LEVEL_STATS_MAX_LEVELS];
+    float log_pow[LEVEL_STATS_MAX_LEVELS];     //sum of the squared samples (calibrated) over the log interval
+    uint32_t log_count[LEVEL_STATS_MAX_LEVELS];  //number of samples in log_pow
+
+    void updateCalPower(void) {
+      cal_pow = powf(10.0f, 0.1f * cal_factor_dB);
+      for (int i = 0; i < OCTAVE_LEVELS_MAX_BANDS; i++) band_cal_pow[i] = powf(10.0f, 0.1f * (cal_factor_dB + band_corr_dB[i]));
+    }
+    void addSumOfSquares(int Ilevel, float sum_sq, uint32_t n) {
+      stats[Ilevel].addSumOfSquares((double)sum_sq, n);
+      log_pow[Ilevel] += sum_sq; log_count[Ilevel] += n;
+    }
+
+    static int16_t quantize(float val_dB) { return (int16_t)max(-32768.0f, min(32767.0f, roundf(10.0f * val_dB))); }
+};
+
+#endif
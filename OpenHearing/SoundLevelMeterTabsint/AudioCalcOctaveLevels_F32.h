@@ -0,0 +1,258 @@
+
+#ifndef _AudioCalcOctaveLevels_F32_h
+#define _AudioCalcOctaveLevels_F32_h
+
+#include <Arduino.h>
+#include <AudioStream_F32.h>
+#include <complex>
+
+//Purpose: Measure the sound level in octave or third-octave bands using a multirate ("octave decimation")
+//   analyzer.  Only the top octave of bands is filtered at the full sample rate.  The audio is then lowpass
+//   filtered and decimated by 2, and the next octave down is filtered using *the same* filter coefficients
+//   (because, at half the sample rate, the next octave down is at the same normalized frequency).  This repeats
+//   for every octave.  Since each octave runs at half the rate of the one above it, the total CPU is less than
+//   twice the CPU of the top octave, no matter how many octaves are measured.
+//
+//   Band filters: 6th-order Butterworth bandpass (3 biquads), with band edges at fm * 2^(+/- 1/(2*b)), where fm
+//        is the base-2 midband frequency (IEC 61260) and b is the number of bands per octave (1 or 3).
+//   Decimation filters: 47-tap half-band FIR (Blackman window).  Only half of the taps are non-zero.
+//   Levels: mean-square with exponential time weighting (such as FAST or SLOW), evaluated at each octave's own rate.
+//        Each band's plain sum of squares (no time weighting) is also kept, for the Leq (see takeSumOfSquares()).
+//
+//   Band 0 is the lowest frequency band.
+
+#define OCTAVE_LEVELS_MAX_OCTAVES   10
+#define OCTAVE_LEVELS_MAX_PER_OCT   3
+#define OCTAVE_LEVELS_MAX_BANDS     (OCTAVE_LEVELS_MAX_OCTAVES * OCTAVE_LEVELS_MAX_PER_OCT)
+#define OCTAVE_LEVELS_N_BIQUAD      3    //biquads per band filter
+#define OCTAVE_LEVELS_HB_LEN        47   //length of the half-band decimation filter (must be 4*k+3)
+
+class AudioCalcOctaveLevels_F32 : public AudioStream_F32 {
+  //GUI: inputs:1, outputs:0  //this line used for automatic generation of GUI node
+  public:
+    AudioCalcOctaveLevels_F32(void) : AudioStream_F32(1, inputQueueArray_f32) { }
+    AudioCalcOctaveLevels_F32(const AudioSettings_F32 &settings) : AudioStream_F32(1, inputQueueArray_f32) {
+      setSampleRate_Hz(settings.sample_rate_Hz);
+    }
+
+    void setSampleRate_Hz(float fs_Hz) { sample_rate_Hz = fs_Hz; }
+
+    //Configure the analyzer.  bands_per_octave is 1 or 3.  top_center_Hz is the center of the highest band (such
+    //as 8000 for octaves or 16000 for third-octaves at 44.1 kHz).  Returns the number of bands (or -1 on error).
+    int setup(int _bands_per_octave, int _n_octaves, float top_center_Hz) {
+      if ((_bands_per_octave != 1) && (_bands_per_octave != 3)) {
+        Serial.println("AudioCalcOctaveLevels_F32: setup: *** ERROR ***: bands_per_octave must be 1 or 3.");
+        return -1;
+      }
+      float top_upper_Hz = top_center_Hz * powf(2.0f, 0.5f / ((float)_bands_per_octave));
+      if (top_upper_Hz >= 0.45f * sample_rate_Hz) {
+        Serial.print("AudioCalcOctaveLevels_F32: setup: *** ERROR ***: top band (upper edge "); Serial.print(top_upper_Hz, 0);
+        Serial.println(" Hz) is too close to Nyquist.");
+        return -1;
+      }
+      is_configured = false;
+      bands_per_octave = _bands_per_octave;
+      n_octaves = max(1, min(OCTAVE_LEVELS_MAX_OCTAVES, _n_octaves));
+      n_bands = bands_per_octave * n_octaves;
+
+      //design the band filters for the top octave.  Every other octave re-uses these.
+      for (int Ipos = 0; Ipos < bands_per_octave; Ipos++) {
+        float fc_Hz = top_center_Hz * powf(2.0f, -((float)Ipos) / ((float)bands_per_octave));
+        designBandpass(fc_Hz, sample_rate_Hz, bands_per_octave, coeff[Ipos]);
+      }
+      designHalfBand();
+      setTimeConst_sec(time_const_sec);
+
+      //center frequencies (lowest band first)
+      for (int Iband = 0; Iband < n_bands; Iband++) {
+        int k = n_bands - 1 - Iband;  //counts down from the top band
+        center_Hz[Iband] = top_center_Hz * powf(2.0f, -((float)k) / ((float)bands_per_octave));
+      }
+
+      resetStates();
+      is_configured = true;
+      return n_bands;
+    }
+    int getNBands(void) { return n_bands; }
+    int getBandsPerOctave(void) { return bands_per_octave; }
+    float getCenterFreq_Hz(int Iband) { return center_Hz[max(0, min(n_bands - 1, Iband))]; }
+
+    //time weighting
+    float setTimeConst_sec(float tau_sec) {
+      time_const_sec = tau_sec;
+      for (int Ioct = 0; Ioct < OCTAVE_LEVELS_MAX_OCTAVES; Ioct++) {
+        float fs_oct_Hz = sample_rate_Hz / ((float)(1 << Ioct));
+        level_alpha[Ioct] = expf(-1.0f / (tau_sec * fs_oct_Hz));
+      }
+      return time_const_sec;
+    }
+    float getTimeConst_sec(void) { return time_const_sec; }
+
+    //get the levels (dB re: full scale)
+    float getCurrentLevel_dB(int Iband) { return 10.0f * log10f(max(1.0e-20f, band_ms[bandToInternal(Iband)])); }
+    float getMaxLevel_dB(int Iband) { return 10.0f * log10f(max(1.0e-20f, band_max_ms[bandToInternal(Iband)])); }
+    void resetMaxLevels(void) { for (int i = 0; i < OCTAVE_LEVELS_MAX_BANDS; i++) band_max_ms[i] = 0.0f; }
+
+    //get the sum of the squared band output (re: full scale), and the number of samples in it, since the last call.
+    //The lower octaves run at lower rates, so they may have fewer samples (even zero) for each audio block.
+    void takeSumOfSquares(int Iband, float *sum_sq, uint32_t *n_samples) {
+      int Iint = bandToInternal(Iband);
+      *sum_sq = band_sum_sq[Iint]; *n_samples = band_n_samples[Iint];
+      band_sum_sq[Iint] = 0.0f; band_n_samples[Iint] = 0;
+    }
+
+    //here is the method called automatically by the audio library
+    virtual void update(void) {
+      audio_block_f32_t *in_block = AudioStream_F32::receiveReadOnly_f32();
+      if (!in_block) return;
+      if (is_configured) processAudio(in_block->data, in_block->length);
+      AudioStream_F32::release(in_block);
+    }
+
+    //here is the method that does the work
+    void processAudio(const float *x, const int n) {
+      float buf[2][AUDIO_BLOCK_SAMPLES];
+      const float *cur = x;
+      int n_cur = min(n, AUDIO_BLOCK_SAMPLES);
+      for (int Ioct = 0; Ioct < n_octaves; Ioct++) {
+        //filter this octave's bands and update their levels
+        for (int Ipos = 0; Ipos < bands_per_octave; Ipos++) {
+          processBand(Ioct * OCTAVE_LEVELS_MAX_PER_OCT + Ipos, coeff[Ipos], level_alpha[Ioct], cur, n_cur);
+        }
+
+        //lowpass and decimate for the next octave down
+        if (Ioct < n_octaves - 1) {
+          float *next = buf[Ioct % 2];
+          n_cur = decimate(Ioct, cur, n_cur, next);
+          cur = next;
+          if (n_cur == 0) break;  //not enough samples yet to reach the lower octaves
+        }
+      }
+    }
+
+  protected:
+    audio_block_f32_t *inputQueueArray_f32[1];
+    bool is_configured = false;
+    float sample_rate_Hz = AUDIO_SAMPLE_RATE_EXACT;
+    int bands_per_octave = 1, n_octaves = 1, n_bands = 1;
+    float time_const_sec = 1.0f;
+
+    //band filters: coefficients are shared by all octaves.  [b0 a1 a2] per biquad, with b1 = 0 and b2 = -b0.
+    float coeff[OCTAVE_LEVELS_MAX_PER_OCT][OCTAVE_LEVELS_N_BIQUAD][3];
+    float state[OCTAVE_LEVELS_MAX_BANDS][OCTAVE_LEVELS_N_BIQUAD][2];  //internal band index = Ioct * MAX_PER_OCT + Ipos
+    float band_ms[OCTAVE_LEVELS_MAX_BANDS], band_max_ms[OCTAVE_LEVELS_MAX_BANDS];
+    float band_sum_sq[OCTAVE_LEVELS_MAX_BANDS];       //see takeSumOfSquares()
+    uint32_t band_n_samples[OCTAVE_LEVELS_MAX_BANDS];
+    float level_alpha[OCTAVE_LEVELS_MAX_OCTAVES];
+    float center_Hz[OCTAVE_LEVELS_MAX_BANDS];
+
+    //half-band decimation filters: one history per octave
+    float hb_coeff[(OCTAVE_LEVELS_HB_LEN + 1) / 4];  //the non-zero taps on one side of the center
+    float hb_center = 0.5f;                          //the center tap
+    float hb_hist[OCTAVE_LEVELS_MAX_OCTAVES][2 * OCTAVE_LEVELS_HB_LEN];
+    int hb_ind[OCTAVE_LEVELS_MAX_OCTAVES], hb_phase[OCTAVE_LEVELS_MAX_OCTAVES];
+
+    //convert from the band number (lowest first) to the internal index (octave by octave, from the top)
+    int bandToInternal(int Iband) {
+      int k = n_bands - 1 - max(0, min(n_bands - 1, Iband));
+      return (k / bands_per_octave) * OCTAVE_LEVELS_MAX_PER_OCT + (k % bands_per_octave);
+    }
+
+    void resetStates(void) {
+      for (int i = 0; i < OCTAVE_LEVELS_MAX_BANDS; i++) {
+        for (int j = 0; j < OCTAVE_LEVELS_N_BIQUAD; j++) { state[i][j][0] = 0.0f; state[i][j][1] = 0.0f; }
+        band_ms[i] = 0.0f; band_max_ms[i] = 0.0f;
+        band_sum_sq[i] = 0.0f; band_n_samples[i] = 0;
+      }
+      for (int Ioct = 0; Ioct < OCTAVE_LEVELS_MAX_OCTAVES; Ioct++) {
+        for (int i = 0; i < 2 * OCTAVE_LEVELS_HB_LEN; i++) hb_hist[Ioct][i] = 0.0f;
+        hb_ind[Ioct] = 0; hb_phase[Ioct] = 0;
+      }
+    }
+
+    //run one band's biquads (direct form II transposed) and update its level
+    void processBand(int Iint, float c[][3], float alpha, const float *x, const int n) {
+      float ms = band_ms[Iint], max_ms = band_max_ms[Iint], sum_sq = 0.0f;
+      float (*s)[2] = state[Iint];
+      for (int i = 0; i < n; i++) {
+        float y = x[i];
+        for (int Ibq = 0; Ibq < OCTAVE_LEVELS_N_BIQUAD; Ibq++) {
+          float in = y;
+          y = c[Ibq][0] * in + s[Ibq][0];
+          s[Ibq][0] = s[Ibq][1] - c[Ibq][1] * y;
+          s[Ibq][1] = -c[Ibq][0] * in - c[Ibq][2] * y;
+        }
+        sum_sq += y * y;
+        ms = alpha * ms + (1.0f - alpha) * (y * y);
+        if (ms > max_ms) max_ms = ms;
+      }
+      band_ms[Iint] = ms; band_max_ms[Iint] = max_ms;
+      band_sum_sq[Iint] += sum_sq; band_n_samples[Iint] += n;
+    }
+
+    //half-band lowpass and keep every other sample.  Returns the number of output samples.
+    int decimate(int Ioct, const float *x, const int n, float *y) {
+      const int L = OCTAVE_LEVELS_HB_LEN, c = (OCTAVE_LEVELS_HB_LEN - 1) / 2, n_taps = (OCTAVE_LEVELS_HB_LEN + 1) / 4;
+      float *hist = hb_hist[Ioct];
+      int ind = hb_ind[Ioct], phase = hb_phase[Ioct], n_out = 0;
+      for (int i = 0; i < n; i++) {
+        if (--ind < 0) ind = L - 1;
+        hist[ind] = x[i]; hist[ind + L] = x[i];  //written twice so that xr[m] = x[i-m] is contiguous
+        phase = !phase;
+        if (phase) {
+          const float *xr = hist + ind;
+          float acc = hb_center * xr[c];
+          for (int k = 0; k < n_taps; k++) acc += hb_coeff[k] * (xr[c - (2 * k + 1)] + xr[c + (2 * k + 1)]);
+          y[n_out++] = acc;
+        }
+      }
+      hb_ind[Ioct] = ind; hb_phase[Ioct] = phase;
+      return n_out;
+    }
+
+    void designHalfBand(void) {
+      const int M = OCTAVE_LEVELS_HB_LEN, c = (OCTAVE_LEVELS_HB_LEN - 1) / 2, n_taps = (OCTAVE_LEVELS_HB_LEN + 1) / 4;
+      float sum = 0.5f;
+      for (int k = 0; k < n_taps; k++) {
+        int off = 2 * k + 1, m = c + off;
+        float t = 0.5f * ((float)off);
+        float win = 0.42f - 0.5f * cosf(2.0f * M_PI * ((float)m) / ((float)(M - 1))) + 0.08f * cosf(4.0f * M_PI * ((float)m) / ((float)(M - 1)));
+        hb_coeff[k] = 0.5f * (sinf(M_PI * t) / (M_PI * t)) * win;
+        sum += 2.0f * hb_coeff[k];
+      }
+      //normalize to unity gain at DC
+      for (int k = 0; k < n_taps; k++) hb_coeff[k] /= sum;
+      hb_center = 0.5f / sum;
+    }
+
+    //6th-order Butterworth bandpass via the bilinear transform (with pre-warping).  Each biquad is scaled to unity gain at the center.
+    static void designBandpass(float fc_Hz, float fs_Hz, int b, float c[][3]) {
+      typedef std::complex<double> cplx;
+      const int N = OCTAVE_LEVELS_N_BIQUAD;  //order of the lowpass prototype
+      const double fs = fs_Hz, two_fs = 2.0 * fs, half_bw_oct = 0.5 / ((double)b);
+      double f1 = fc_Hz * pow(2.0, -half_bw_oct), f2 = fc_Hz * pow(2.0, half_bw_oct);
+      double W1 = two_fs * tan(M_PI * f1 / fs), W2 = two_fs * tan(M_PI * f2 / fs);
+      double W0 = sqrt(W1 * W2), B = W2 - W1;
+      double w0_digital = 2.0 * atan(W0 / two_fs);
+      cplx ejw = std::polar(1.0, -w0_digital), ejw2 = ejw * ejw;
+
+      int Ibq = 0;
+      for (int k = 0; k < N; k++) {
+        cplx p = std::polar(1.0, M_PI * ((double)(2 * k + N + 1)) / ((double)(2 * N)));  //lowpass prototype pole
+        cplx root = std::sqrt(p * p * B * B - 4.0 * W0 * W0);
+        cplx s_poles[2] = {0.5 * (p * B + root), 0.5 * (p * B - root)};
+        for (int j = 0; j < 2; j++) {
+          if ((s_poles[j].imag() <= 0.0) || (Ibq >= N)) continue;  //keep one of each conjugate pair
+          cplx z = (two_fs + s_poles[j]) / (two_fs - s_poles[j]);     //bilinear transform
+          double a1 = -2.0 * z.real(), a2 = std::norm(z);
+          cplx H = (1.0 - ejw2) / (1.0 + a1 * ejw + a2 * ejw2);       //response at the center, with b0 = 1
+          c[Ibq][0] = (float)(1.0 / std::abs(H));
+          c[Ibq][1] = (float)a1;
+          c[Ibq][2] = (float)a2;
+          Ibq++;
+        }
+      }
+    }
+};
+
+#endif
@@ -0,0 +1,127 @@
+
+#ifndef _AudioCalcPeakImpulse_F32_h
+#define _AudioCalcPeakImpulse_F32_h
+
+#include <Arduino.h>
+#include <AudioStream_F32.h>
+#include <arm_math.h>
+
+//Purpose: Measure impulsive sounds (such as nail guns), which the SLOW and FAST level meters under-report:
+//     * True peak: the peak of the waveform after 4x oversampling, so that peaks that fall between the
+//       samples are not missed (up to 3 dB at high frequencies).  Connect C-weighted audio to get LCpeak.
+//     * Impulse level: IEC 61672 Impulse ("I") time weighting.  That is a 35 msec exponential average of the
+//       squared signal, followed by a peak hold that decays with a 1.5 sec time constant (2.9 dB/sec).
+//       Connect A-weighted audio to get LAI and LAImax.
+//
+//   Input 0 is used for the true peak and input 1 is used for the Impulse level.  If input 1 is not
+//   connected, input 0 is used for both.  Both are computed in the same pass through each audio block.
+//   The oversampling (CMSIS polyphase interpolator), squaring, and peak search use the vectorized CMSIS
+//   functions.  Only the Impulse recursion itself is done sample-by-sample.
+//
+//   The levels are in dB re: full scale, like AudioCalcLevel_F32.  Add the same calibration to get dB SPL.
+//   The true peak is 20*log10(peak), so a sine wave's true peak is 3 dB above its level.
+
+#define PEAK_IMPULSE_OVERSAMPLE   4
+#define PEAK_IMPULSE_N_TAPS       48     //must be a multiple of PEAK_IMPULSE_OVERSAMPLE
+#define PEAK_IMPULSE_RISE_SEC     0.035f //IEC 61672 Impulse time constant
+#define PEAK_IMPULSE_DECAY_SEC    1.5f   //IEC 61672 Impulse peak-hold decay
+
+class AudioCalcPeakImpulse_F32 : public AudioStream_F32 {
+  //GUI: inputs:2, outputs:0  //this line used for automatic generation of GUI node
+  public:
+    AudioCalcPeakImpulse_F32(void) : AudioStream_F32(2, inputQueueArray_f32) { setup(AUDIO_SAMPLE_RATE_EXACT); }
+    AudioCalcPeakImpulse_F32(const AudioSettings_F32 &settings) : AudioStream_F32(2, inputQueueArray_f32) {
+      setup(settings.sample_rate_Hz);
+    }
+
+    //design the interpolator, set the Impulse coefficients for this sample rate, and clear everything
+    void setup(float fs_Hz) {
+      sample_rate_Hz = fs_Hz;
+
+      //interpolation filter: Blackman-windowed sinc with its cutoff at the original Nyquist frequency,
+      //scaled so that each polyphase branch has a gain of 1.0 at DC
+      const float center = 0.5f * ((float)(PEAK_IMPULSE_N_TAPS - 1));
+      float sum = 0.0f;
+      for (int i = 0; i < PEAK_IMPULSE_N_TAPS; i++) {
+        float t = (((float)i) - center) / ((float)PEAK_IMPULSE_OVERSAMPLE);
+        float sinc = (fabsf(t) < 1.0e-6f) ? 1.0f : sinf(PI * t) / (PI * t);
+        float phase = 2.0f * PI * ((float)i) / ((float)(PEAK_IMPULSE_N_TAPS - 1));
+        coeff[i] = sinc * (0.42f - 0.5f * cosf(phase) + 0.08f * cosf(2.0f * phase));
+        sum += coeff[i];
+      }
+      for (int i = 0; i < PEAK_IMPULSE_N_TAPS; i++) coeff[i] *= ((float)PEAK_IMPULSE_OVERSAMPLE) / sum;
+      arm_fir_interpolate_init_f32(&interpolator, PEAK_IMPULSE_OVERSAMPLE, PEAK_IMPULSE_N_TAPS, coeff, interp_state, AUDIO_BLOCK_SAMPLES);
+
+      rise_coeff = 1.0f - expf(-1.0f / (PEAK_IMPULSE_RISE_SEC * sample_rate_Hz));
+      decay_fac = expf(-1.0f / (PEAK_IMPULSE_DECAY_SEC * sample_rate_Hz));
+      reset();
+    }
+
+    //clear the filter states and the measured levels
+    void reset(void) {
+      for (int i = 0; i < PEAK_IMPULSE_N_TAPS / PEAK_IMPULSE_OVERSAMPLE + AUDIO_BLOCK_SAMPLES - 1; i++) interp_state[i] = 0.0f;
+      impulse_ms = 0.0f; impulse_hold = 0.0f;
+      resetMaxLevels();
+    }
+    void resetMaxLevels(void) { max_peak = 0.0f; max_impulse = 0.0f; }
+
+    float getTruePeak_dB(void) { return toDB(block_peak * block_peak); }      //most recent block
+    float getMaxTruePeak_dB(void) { return toDB(max_peak * max_peak); }       //since resetMaxLevels()
+    float getImpulseLevel_dB(void) { return toDB(impulse_hold); }
+    float getMaxImpulseLevel_dB(void) { return toDB(max_impulse); }           //since resetMaxLevels()
+
+    //here is the method called automatically by the audio library
+    virtual void update(void) {
+      audio_block_f32_t *peak_block = AudioStream_F32::receiveReadOnly_f32(0);
+      if (!peak_block) return;
+      audio_block_f32_t *impulse_block = AudioStream_F32::receiveReadOnly_f32(1);
+      const float *impulse_x = (impulse_block) ? impulse_block->data : peak_block->data;
+
+      //do the algorithm
+      processAudio(peak_block->data, impulse_x, peak_block->length);
+
+      //release memory
+      if (impulse_block) AudioStream_F32::release(impulse_block);
+      AudioStream_F32::release(peak_block);
+    }
+
+    //here is the method that does the work.  Also usable outside of the audio library (such as for testing).
+    void processAudio(const float *x_peak, const float *x_impulse, const int n) {
+      if ((n <= 0) || (n > AUDIO_BLOCK_SAMPLES)) return;
+
+      //true peak: oversample, then find the largest magnitude
+      float val_max, val_min;
+      uint32_t ind;
+      arm_fir_interpolate_f32(&interpolator, (float *)x_peak, work, n);
+      arm_max_f32(work, PEAK_IMPULSE_OVERSAMPLE * n, &val_max, &ind);
+      arm_min_f32(work, PEAK_IMPULSE_OVERSAMPLE * n, &val_min, &ind);
+      block_peak = max(val_max, -val_min);
+      if (block_peak > max_peak) max_peak = block_peak;
+
+      //Impulse: exponential average of the squared signal, then a decaying peak hold
+      arm_mult_f32((float *)x_impulse, (float *)x_impulse, work, n);
+      float ms = impulse_ms, hold = impulse_hold, hold_max = max_impulse;
+      for (int i = 0; i < n; i++) {
+        ms += rise_coeff * (work[i] - ms);
+        hold *= decay_fac;
+        if (ms > hold) hold = ms;
+        if (hold > hold_max) hold_max = hold;
+      }
+      impulse_ms = ms; impulse_hold = hold; max_impulse = hold_max;
+    }
+
+  protected:
+    audio_block_f32_t *inputQueueArray_f32[2];
+    float sample_rate_Hz = AUDIO_SAMPLE_RATE_EXACT;
+    float coeff[PEAK_IMPULSE_N_TAPS];
+    float interp_state[PEAK_IMPULSE_N_TAPS / PEAK_IMPULSE_OVERSAMPLE + AUDIO_BLOCK_SAMPLES - 1];
+    arm_fir_interp_instance_f32 interpolator;
+    float work[PEAK_IMPULSE_OVERSAMPLE * AUDIO_BLOCK_SAMPLES];
+    float block_peak = 0.0f, max_peak = 0.0f;
+    float rise_coeff = 0.0f, decay_fac = 1.0f;
+    float impulse_ms = 0.0f, impulse_hold = 0.0f, max_impulse = 0.0f;
+
+    static float toDB(float pow_val) { return 10.0f * log10f(max(pow_val, 1.0e-20f)); }
+};
+
+#endif
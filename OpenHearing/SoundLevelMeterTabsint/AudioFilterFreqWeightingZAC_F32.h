@@ -0,0 +1,137 @@
+
+#ifndef _AudioFilterFreqWeightingZAC_F32_h
+#define _AudioFilterFreqWeightingZAC_F32_h
+
+#include <Arduino.h>
+#include <AudioStream_F32.h>
+#include <arm_math.h>
+
+//Purpose: Produce the Z-weighted (unweighted), A-weighted, and C-weighted versions of the audio at the same time,
+//   such as for measuring LAeq and LCpeak together.
+//
+//   Per IEC 61672, the A-weighting is the C-weighting plus two more first-order highpass filters (at 107.7 Hz
+//   and 737.9 Hz).  So, this class computes C first and then computes A from the C output:
+//       Z = input (passed through without copying)
+//       C = input -> 2 biquads (double pole at 20.6 Hz, double pole at 12194 Hz)
+//       A = C     -> 1 biquad  (poles at 107.7 Hz and 737.9 Hz)
+//   That is 3 biquads in total, instead of the 5 biquads that separate A and C filters would need.
+//
+//   The filters are designed here (bilinear transform, with the 12194 Hz pole pre-warped) for any sample rate.
+//   A and C are both normalized to 0 dB at 1 kHz.  At 44.1 kHz, they are within 0.7 dB of IEC 61672 up to 10 kHz.
+//   Above that, the bilinear transform makes them roll off faster than the standard (but within class 1 limits).
+//
+//   Output 0 is Z, output 1 is A, output 2 is C.  Output 3 is whichever of those is chosen by setSelectedOutput(),
+//   so that one weighting can be routed onward (such as to the audio output) without re-wiring.  It is the same
+//   block as the chosen output, so it costs no copy.
+
+#define FREQ_WEIGHT_ZAC_N_BIQUAD_C 2
+#define FREQ_WEIGHT_ZAC_N_BIQUAD_A 1
+
+class AudioFilterFreqWeightingZAC_F32 : public AudioStream_F32 {
+  //GUI: inputs:1, outputs:4  //this line used for automatic generation of GUI node
+  public:
+    enum OUTPUTS {OUT_Z = 0, OUT_A, OUT_C, OUT_SELECTED};
+
+    AudioFilterFreqWeightingZAC_F32(void) : AudioStream_F32(1, inputQueueArray_f32) { setSampleRate_Hz(AUDIO_SAMPLE_RATE_EXACT); }
+    AudioFilterFreqWeightingZAC_F32(const AudioSettings_F32 &settings) : AudioStream_F32(1, inputQueueArray_f32) {
+      setSampleRate_Hz(settings.sample_rate_Hz);
+    }
+
+    //design the filters for the given sample rate (and clear their states)
+    void setSampleRate_Hz(float fs_Hz) {
+      sample_rate_Hz = fs_Hz;
+      const double f1 = 20.598997, f2 = 107.65265, f3 = 737.86223, f4 = 12194.217;  //IEC 61672 pole frequencies
+      const double w1 = 2.0 * M_PI * f1, w2 = 2.0 * M_PI * f2, w3 = 2.0 * M_PI * f3;
+      const double w4 = 2.0 * sample_rate_Hz * tan(M_PI * f4 / sample_rate_Hz);  //pre-warped so that this pole lands in the right place
+
+      //C-weighting: s^2 / (s + w1)^2, then w4^2 / (s + w4)^2
+      bilinear(1.0, 0.0, 0.0, 1.0, 2.0 * w1, w1 * w1, coeff_C + 0);
+      bilinear(0.0, 0.0, w4 * w4, 1.0, 2.0 * w4, w4 * w4, coeff_C + 5);
+      normalizeAt1kHz(coeff_C, FREQ_WEIGHT_ZAC_N_BIQUAD_C);
+
+      //A-weighting (after the C-weighting): s^2 / ((s + w2)(s + w3))
+      bilinear(1.0, 0.0, 0.0, 1.0, w2 + w3, w2 * w3, coeff_A);
+      normalizeAt1kHz(coeff_A, FREQ_WEIGHT_ZAC_N_BIQUAD_A);
+
+      arm_biquad_cascade_df1_init_f32(&biquad_C, FREQ_WEIGHT_ZAC_N_BIQUAD_C, coeff_C, state_C);
+      arm_biquad_cascade_df1_init_f32(&biquad_A, FREQ_WEIGHT_ZAC_N_BIQUAD_A, coeff_A, state_A);
+      for (int i = 0; i < 4 * FREQ_WEIGHT_ZAC_N_BIQUAD_C; i++) state_C[i] = 0.0f;
+      for (int i = 0; i < 4 * FREQ_WEIGHT_ZAC_N_BIQUAD_A; i++) state_A[i] = 0.0f;
+    }
+
+    //choose which weighting (OUT_Z, OUT_A, or OUT_C) is also sent out of OUT_SELECTED
+    int setSelectedOutput(int out) { return selected_output = ((out == OUT_Z) || (out == OUT_C)) ? out : OUT_A; }
+    int getSelectedOutput(void) { return selected_output; }
+
+    //here is the method called automatically by the audio library
+    virtual void update(void) {
+      audio_block_f32_t *in_block = AudioStream_F32::receiveReadOnly_f32();
+      if (!in_block) return;
+
+      //Z-weighting is the input itself
+      AudioStream_F32::transmit(in_block, OUT_Z);
+      if (selected_output == OUT_Z) AudioStream_F32::transmit(in_block, OUT_SELECTED);
+
+      //allocate memory for the A and C outputs
+      audio_block_f32_t *out_A = AudioStream_F32::allocate_f32();
+      audio_block_f32_t *out_C = AudioStream_F32::allocate_f32();
+      if ((!out_A) || (!out_C)) {
+        if (out_A) AudioStream_F32::release(out_A);
+        if (out_C) AudioStream_F32::release(out_C);
+        AudioStream_F32::release(in_block);
+        return;
+      }
+
+      //do the algorithm
+      processAudio(in_block->data, out_A->data, out_C->data, in_block->length);
+      out_A->length = in_block->length; out_A->id = in_block->id;
+      out_C->length = in_block->length; out_C->id = in_block->id;
+
+      //transmit the blocks and release memory
+      AudioStream_F32::transmit(out_A, OUT_A);
+      AudioStream_F32::transmit(out_C, OUT_C);
+      if (selected_output != OUT_Z) AudioStream_F32::transmit((selected_output == OUT_C) ? out_C : out_A, OUT_SELECTED);
+      AudioStream_F32::release(out_A);
+      AudioStream_F32::release(out_C);
+      AudioStream_F32::release(in_block);
+    }
+
+    //here is the method that does the work.  Also usable outside of the audio library (such as for benchmarking).
+    void processAudio(const float *x, float *y_A, float *y_C, const int n) {
+      arm_biquad_cascade_df1_f32(&biquad_C, (float *)x, y_C, n);  //C-weighting
+      arm_biquad_cascade_df1_f32(&biquad_A, y_C, y_A, n);          //A-weighting, starting from the C-weighting
+    }
+
+  protected:
+    audio_block_f32_t *inputQueueArray_f32[1];
+    float sample_rate_Hz = AUDIO_SAMPLE_RATE_EXACT;
+    int selected_output = OUT_A;
+    float coeff_C[5 * FREQ_WEIGHT_ZAC_N_BIQUAD_C], coeff_A[5 * FREQ_WEIGHT_ZAC_N_BIQUAD_A];  //CMSIS order [b0 b1 b2 -a1 -a2]
+    float state_C[4 * FREQ_WEIGHT_ZAC_N_BIQUAD_C], state_A[4 * FREQ_WEIGHT_ZAC_N_BIQUAD_A];
+    arm_biquad_casd_df1_inst_f32 biquad_C, biquad_A;
+
+    //bilinear transform of (b2 s^2 + b1 s + b0) / (a2 s^2 + a1 s + a0) into one biquad in CMSIS order
+    void bilinear(double b2, double b1, double b0, double a2, double a1, double a0, float *c) {
+      const double K = 2.0 * sample_rate_Hz, K2 = K * K;
+      double d0 = a2 * K2 + a1 * K + a0, d1 = 2.0 * (a0 - a2 * K2), d2 = a2 * K2 - a1 * K + a0;
+      c[0] = (float)((b2 * K2 + b1 * K + b0) / d0);
+      c[1] = (float)(2.0 * (b0 - b2 * K2) / d0);
+      c[2] = (float)((b2 * K2 - b1 * K + b0) / d0);
+      c[3] = (float)(-d1 / d0);
+      c[4] = (float)(-d2 / d0);
+    }
+
+    //scale the first biquad so that the cascade has a gain of 1.0 at 1 kHz
+    void normalizeAt1kHz(float *c, int n_biquad) {
+      double w = 2.0 * M_PI * 1000.0 / sample_rate_Hz, gain = 1.0;
+      for (int Ibq = 0; Ibq < n_biquad; Ibq++) {
+        const float *cc = c + 5 * Ibq;
+        double nr = cc[0] + cc[1] * cos(w) + cc[2] * cos(2.0 * w), ni = -(cc[1] * sin(w) + cc[2] * sin(2.0 * w));
+        double dr = 1.0 - cc[3] * cos(w) - cc[4] * cos(2.0 * w), di = cc[3] * sin(w) + cc[4] * sin(2.0 * w);
+        gain *= sqrt((nr * nr + ni * ni) / (dr * dr + di * di));
+      }
+      for (int i = 0; i < 3; i++) c[i] = (float)(c[i] / gain);
+    }
+};
+
+#endif
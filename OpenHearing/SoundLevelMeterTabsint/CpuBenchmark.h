@@ -0,0 +1,35 @@
+#ifndef _CpuBenchmark_h
+#define _CpuBenchmark_h
+
+#include <Arduino.h>
+
+//Purpose: Time the processing of one audio block by an object outside of the audio graph (on the Teensy's
+//   cycle counter), so that its CPU cost can be compared to the cycles that are available per block.
+//
+//   Give the benchmark its own instance of the class under test, not the one that is in the audio graph, so that
+//   the audio (and that object's state) is not disturbed.  Make that instance at file scope, next to the other audio
+//   objects (see AudioConnections.h), and leave it unconnected so that the audio library never runs it.  Do not make
+//   it on first use: constructing an AudioStream_F32 while the audio is running changes the library's update list.
+
+//the average number of CPU cycles for processBlock(obj), which should process one block of audio.  The first
+//n_warmup calls are not timed (such as to fill up a filter's delay line first).
+template <class T, class Func>
+uint32_t benchmarkCycles(T &obj, Func processBlock, int n_trials, int n_warmup = 0) {
+  for (int Itrial = 0; Itrial < n_warmup; Itrial++) processBlock(obj);
+  uint32_t start = ARM_DWT_CYCCNT;
+  for (int Itrial = 0; Itrial < n_trials; Itrial++) processBlock(obj);
+  return (ARM_DWT_CYCCNT - start) / max(1, n_trials);
+}
+
+//the CPU cycles as a percent of the cycles that are available per block
+float benchmarkPercentCPU(uint32_t cycles, int n_samp, float fs_Hz) {
+  float block_cycles = ((float)F_CPU_ACTUAL) * ((float)n_samp) / fs_Hz;
+  return 100.0f * ((float)cycles) / block_cycles;
+}
+
+//fill a block with white noise (-1 to +1) to use as the test signal
+void fillBenchmarkNoise(float *x, int n_samp) {
+  for (int i = 0; i < n_samp; i++) x[i] = ((float)random(-1000, 1000)) / 1000.0f;
+}
+
+#endif
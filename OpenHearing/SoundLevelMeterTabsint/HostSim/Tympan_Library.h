@@ -0,0 +1,196 @@
+#ifndef _HostSim_Tympan_Library_h
+#define _HostSim_Tympan_Library_h
+
+// Host (PC) stand-ins for the few Tympan_Library pieces that this sketch's level-measuring classes use, so that the
+// real classes (the headers one folder up) can be run on a PC.  Only what those classes need is here.
+//
+// Unlike a plain stand-in, the audio memory and connections are real enough to run update(): blocks come from a
+// pool with reference counts, and transmit() hands a block to every connected input.  There is no audio interrupt,
+// so call each node's update() by hand, in the order that the library would (sources first).
+//
+// AudioFilterFreqWeighting_F32 follows the library's class: one weighting per instance, run in place on a writable
+// block with a CMSIS biquad cascade (3 biquads for A, 2 for C).  Its filters are designed here with the same IEC 61672
+// poles (and 0 dB at 1 kHz) as ../AudioFilterFreqWeightingZAC_F32.h, not taken from the library's coefficient tables.
+// Z_WEIGHT here is no biquads at all, so a Z instance costs only the writable copy of its (shared) input block.
+
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+using std::min; using std::max;
+
+#define AUDIO_BLOCK_SAMPLES 128
+#define AUDIO_SAMPLE_RATE_EXACT 44117.64706f
+#ifndef PI
+#define PI 3.14159265358979f
+#endif
+typedef float float32_t;
+
+#define F(x) (x)
+
+//the serial monitor.  Set quiet to hide the classes' own printing.
+struct HostSerial {
+  bool quiet = false;
+  void print(const char *s) { if (!quiet) fputs(s, stdout); }
+  void print(int val) { if (!quiet) printf("%d", val); }
+  void print(double val, int n_dec = 2) { if (!quiet) printf("%.*f", n_dec, val); }
+  void println(const char *s) { if (!quiet) puts(s); }
+  void println(int val) { print(val); println(); }
+  void println(double val, int n_dec = 2) { print(val, n_dec); println(); }
+  void println(void) { if (!quiet) puts(""); }
+};
+static HostSerial Serial;
+
+inline void AudioNoInterrupts(void) {}
+inline void AudioInterrupts(void) {}
+
+//the host's clock, for timing the classes (not the simulated time)
+inline unsigned long micros(void) {
+  using namespace std::chrono;
+  static auto t0 = std::chrono::steady_clock::now();
+  return (unsigned long)duration_cast<microseconds>(steady_clock::now() - t0).count();
+}
+
+struct AudioSettings_F32 {
+  AudioSettings_F32(float fs, int n) : sample_rate_Hz(fs), audio_block_samples(n) {}
+  float sample_rate_Hz;
+  int audio_block_samples;
+};
+struct audio_block_f32_t { float data[AUDIO_BLOCK_SAMPLES]; int length = AUDIO_BLOCK_SAMPLES; unsigned long id = 0; int ref_count = 0; };
+
+//the audio memory: a fixed pool of blocks, with reference counts
+#define HOSTSIM_N_BLOCKS 64
+struct HostAudioMemory {
+  audio_block_f32_t blocks[HOSTSIM_N_BLOCKS];
+  int n_used = 0, max_used = 0;
+};
+static HostAudioMemory hostAudioMemory;
+inline int AudioMemoryUsage_F32(void) { return hostAudioMemory.n_used; }
+inline int AudioMemoryUsageMax_F32(void) { return hostAudioMemory.max_used; }
+inline void AudioMemoryUsageMaxReset_F32(void) { hostAudioMemory.max_used = hostAudioMemory.n_used; }
+
+class AudioStream_F32;
+struct HostConnection { AudioStream_F32 *src; int src_out; AudioStream_F32 *dst; int dst_in; };
+static std::vector<HostConnection> hostConnections;
+
+class AudioStream_F32 {
+  public:
+    AudioStream_F32(int _n_inputs, audio_block_f32_t **_inputs) : n_inputs(_n_inputs), inputs(_inputs) { for (int i = 0; i < n_inputs; i++) inputs[i] = NULL; }
+    virtual ~AudioStream_F32(void) {}
+    virtual void update(void) = 0;
+    int cpu_cycles = 0;
+
+    //the host's way to feed a node: put a block into one of its inputs (which takes a reference to it)
+    void setInput(int i, audio_block_f32_t *block) { if (inputs[i]) release(inputs[i]); inputs[i] = block; if (block) block->ref_count++; }
+
+    static audio_block_f32_t *allocate_f32(void) {
+      for (int i = 0; i < HOSTSIM_N_BLOCKS; i++) {
+        audio_block_f32_t *b = &hostAudioMemory.blocks[i];
+        if (b->ref_count == 0) {
+          b->ref_count = 1; b->length = AUDIO_BLOCK_SAMPLES;
+          hostAudioMemory.max_used = max(hostAudioMemory.max_used, ++hostAudioMemory.n_used);
+          return b;
+        }
+      }
+      return NULL;
+    }
+    static void release(audio_block_f32_t *b) { if ((b) && (--(b->ref_count) == 0)) hostAudioMemory.n_used--; }
+
+  protected:
+    int n_inputs;
+    audio_block_f32_t **inputs;
+    audio_block_f32_t *receiveReadOnly_f32(int i = 0) { audio_block_f32_t *b = inputs[i]; inputs[i] = NULL; return b; }
+    audio_block_f32_t *receiveWritable_f32(int i = 0) {
+      audio_block_f32_t *b = receiveReadOnly_f32(i);
+      if ((b) && (b->ref_count > 1)) {  //shared, so copy it
+        audio_block_f32_t *copy = allocate_f32();
+        if (copy) { memcpy(copy->data, b->data, sizeof(b->data)); copy->length = b->length; copy->id = b->id; }
+        release(b);
+        b = copy;
+      }
+      return b;
+    }
+    void transmit(audio_block_f32_t *block, int out = 0) {
+      for (const HostConnection &c : hostConnections) {
+        if ((c.src == this) && (c.src_out == out) && (c.dst->inputs[c.dst_in] == NULL)) { c.dst->inputs[c.dst_in] = block; block->ref_count++; }
+      }
+    }
+};
+
+struct AudioConnection_F32 {
+  AudioConnection_F32(AudioStream_F32 &src, int src_out, AudioStream_F32 &dst, int dst_in) { hostConnections.push_back({&src, src_out, &dst, dst_in}); }
+};
+
+//the end of a chain: takes whatever arrives on its inputs and keeps the last block of each (see getLast())
+template <int N_INPUTS>
+class HostSink_F32 : public AudioStream_F32 {
+  public:
+    HostSink_F32(void) : AudioStream_F32(N_INPUTS, inputQueueArray_f32) {}
+    virtual void update(void) {
+      for (int i = 0; i < N_INPUTS; i++) {
+        audio_block_f32_t *b = receiveReadOnly_f32(i);
+        if (b) { memcpy(last[i], b->data, b->length * sizeof(float)); release(b); }
+      }
+    }
+    const float *getLast(int i) { return last[i]; }
+  protected:
+    audio_block_f32_t *inputQueueArray_f32[N_INPUTS];
+    float last[N_INPUTS][AUDIO_BLOCK_SAMPLES] = {};
+};
+
+#include "arm_math.h"
+
+//after the library's AudioFilterFreqWeighting_F32 (see the note at the top)
+#define A_WEIGHT 0
+#define C_WEIGHT 1
+#define Z_WEIGHT 2
+class AudioFilterFreqWeighting_F32 : public AudioStream_F32 {
+  public:
+    AudioFilterFreqWeighting_F32(const AudioSettings_F32 &settings) : AudioStream_F32(1, inputQueueArray_f32), fs_Hz(settings.sample_rate_Hz) { setWeightingType(A_WEIGHT); }
+    void setWeightingType(int type) {
+      const double w1 = 2.0 * M_PI * 20.598997, w2 = 2.0 * M_PI * 107.65265, w3 = 2.0 * M_PI * 737.86223;
+      const double w4 = 2.0 * fs_Hz * tan(M_PI * 12194.217 / fs_Hz);
+      n_stages = (type == Z_WEIGHT) ? 0 : ((type == C_WEIGHT) ? 2 : 3);
+      bilinear(1.0, 0.0, 0.0, 1.0, 2.0 * w1, w1 * w1, coeff + 0);
+      bilinear(0.0, 0.0, w4 * w4, 1.0, 2.0 * w4, w4 * w4, coeff + 5);
+      bilinear(1.0, 0.0, 0.0, 1.0, w2 + w3, w2 * w3, coeff + 10);
+      normalizeAt1kHz();
+      arm_biquad_cascade_df1_init_f32(&biquad, n_stages, coeff, state);
+      for (int i = 0; i < 4 * 3; i++) state[i] = 0.0f;
+    }
+    virtual void update(void) {
+      audio_block_f32_t *block = receiveWritable_f32();
+      if (!block) return;
+      arm_biquad_cascade_df1_f32(&biquad, block->data, block->data, block->length);
+      transmit(block);
+      release(block);
+    }
+  protected:
+    audio_block_f32_t *inputQueueArray_f32[1];
+    float fs_Hz;
+    int n_stages = 3;
+    float coeff[5 * 3], state[4 * 3];
+    arm_biquad_casd_df1_inst_f32 biquad;
+    void bilinear(double b2, double b1, double b0, double a2, double a1, double a0, float *c) {
+      const double K = 2.0 * fs_Hz, K2 = K * K;
+      double d0 = a2 * K2 + a1 * K + a0, d1 = 2.0 * (a0 - a2 * K2), d2 = a2 * K2 - a1 * K + a0;
+      c[0] = (float)((b2 * K2 + b1 * K + b0) / d0); c[1] = (float)(2.0 * (b0 - b2 * K2) / d0); c[2] = (float)((b2 * K2 - b1 * K + b0) / d0);
+      c[3] = (float)(-d1 / d0); c[4] = (float)(-d2 / d0);
+    }
+    void normalizeAt1kHz(void) {
+      double w = 2.0 * M_PI * 1000.0 / fs_Hz, gain = 1.0;
+      for (int Ibq = 0; Ibq < n_stages; Ibq++) {
+        const float *cc = coeff + 5 * Ibq;
+        double nr = cc[0] + cc[1] * cos(w) + cc[2] * cos(2.0 * w), ni = -(cc[1] * sin(w) + cc[2] * sin(2.0 * w));
+        double dr = 1.0 - cc[3] * cos(w) - cc[4] * cos(2.0 * w), di = cc[3] * sin(w) + cc[4] * sin(2.0 * w);
+        gain *= sqrt((nr * nr + ni * ni) / (dr * dr + di * di));
+      }
+      for (int i = 0; i < 3; i++) coeff[i] = (float)(coeff[i] / gain);
+    }
+};
+
+#endif
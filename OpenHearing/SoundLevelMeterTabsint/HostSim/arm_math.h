@@ -0,0 +1,72 @@
+#ifndef _HostSim_arm_math_h
+#define _HostSim_arm_math_h
+
+// Host (PC) stand-ins for the CMSIS-DSP functions that this sketch's level-measuring classes call.  They compute
+// the same thing as CMSIS, written plainly (the biquads are the same direct form I loop as
+// arm_biquad_cascade_df1_f32()), so the host's times show the trend, not the Teensy's cycles.
+
+#include <cstdint>
+
+typedef struct { uint32_t numStages; float *pState; const float *pCoeffs; } arm_biquad_casd_df1_inst_f32;
+
+inline void arm_biquad_cascade_df1_init_f32(arm_biquad_casd_df1_inst_f32 *S, uint8_t numStages, const float *pCoeffs, float *pState) {
+  S->numStages = numStages; S->pCoeffs = pCoeffs; S->pState = pState;
+  for (int i = 0; i < 4 * numStages; i++) pState[i] = 0.0f;
+}
+
+//coefficients [b0 b1 b2 a1 a2] per stage (a1 and a2 already negated, as in CMSIS), state [x1 x2 y1 y2] per stage
+inline void arm_biquad_cascade_df1_f32(const arm_biquad_casd_df1_inst_f32 *S, const float *pSrc, float *pDst, uint32_t blockSize) {
+  const float *src = pSrc;
+  for (uint32_t Istage = 0; Istage < S->numStages; Istage++) {
+    const float *c = S->pCoeffs + 5 * Istage;
+    float *st = S->pState + 4 * Istage;
+    float x1 = st[0], x2 = st[1], y1 = st[2], y2 = st[3];
+    for (uint32_t i = 0; i < blockSize; i++) {
+      float xn = src[i], yn = c[0] * xn + c[1] * x1 + c[2] * x2 + c[3] * y1 + c[4] * y2;
+      x2 = x1;  x1 = xn;  y2 = y1;  y1 = yn;
+      pDst[i] = yn;
+    }
+    st[0] = x1;  st[1] = x2;  st[2] = y1;  st[3] = y2;
+    src = pDst;
+  }
+}
+
+//the polyphase interpolator, as CMSIS runs it: the state holds the last phaseLength-1 inputs plus the new block,
+//oldest first, and the coefficients are in time-reversed order
+typedef struct { uint8_t L; uint16_t phaseLength; const float *pCoeffs; float *pState; } arm_fir_interp_instance_f32;
+
+inline int arm_fir_interpolate_init_f32(arm_fir_interp_instance_f32 *S, uint8_t L, uint16_t numTaps, const float *pCoeffs, float *pState, uint32_t blockSize) {
+  if ((numTaps % L) != 0) return -1;
+  S->L = L; S->phaseLength = numTaps / L; S->pCoeffs = pCoeffs; S->pState = pState;
+  for (uint32_t i = 0; i < S->phaseLength + blockSize - 1; i++) pState[i] = 0.0f;
+  return 0;
+}
+
+inline void arm_fir_interpolate_f32(const arm_fir_interp_instance_f32 *S, const float *pSrc, float *pDst, uint32_t blockSize) {
+  const int L = S->L, P = S->phaseLength;
+  float *st = S->pState;
+  for (uint32_t i = 0; i < blockSize; i++) st[P - 1 + i] = pSrc[i];
+  for (uint32_t n = 0; n < blockSize; n++) {
+    for (int l = 0; l < L; l++) {
+      const float *c = S->pCoeffs + (L - 1 - l);
+      float acc = 0.0f;
+      for (int k = 0; k < P; k++) acc += st[n + k] * c[k * L];
+      pDst[n * L + l] = acc;
+    }
+  }
+  for (int i = 0; i < P - 1; i++) st[i] = st[blockSize + i];  //keep the newest P-1 inputs for the next block
+}
+
+inline void arm_max_f32(const float *pSrc, uint32_t blockSize, float *pResult, uint32_t *pIndex) {
+  *pResult = pSrc[0]; *pIndex = 0;
+  for (uint32_t i = 1; i < blockSize; i++) if (pSrc[i] > *pResult) { *pResult = pSrc[i]; *pIndex = i; }
+}
+inline void arm_min_f32(const float *pSrc, uint32_t blockSize, float *pResult, uint32_t *pIndex) {
+  *pResult = pSrc[0]; *pIndex = 0;
+  for (uint32_t i = 1; i < blockSize; i++) if (pSrc[i] < *pResult) { *pResult = pSrc[i]; *pIndex = i; }
+}
+inline void arm_mult_f32(const float *pSrcA, const float *pSrcB, float *pDst, uint32_t blockSize) {
+  for (uint32_t i = 0; i < blockSize; i++) pDst[i] = pSrcA[i] * pSrcB[i];
+}
+
+#endif
@@ -0,0 +1,105 @@
+// simFreqWeighting: the CPU cost of the shared Z/A/C weighting network (../AudioFilterFreqWeightingZAC_F32.h) versus
+// three separate AudioFilterFreqWeighting_F32 instances (Z, A, and C), each run through its update() with the audio
+// memory and connections of Tympan_Library.h in this folder, at the sketch's sample rate and block size (44.1 kHz,
+// 128 samples).  It reports:
+//   * the host's time per block for each version, including the block allocation, copies, and transmits
+//   * the peak number of audio blocks in use by each version
+//   * the largest difference between the two versions' A and C outputs (the shared A is computed from the C output)
+//   * that OUT_SELECTED carries the chosen weighting, for Z, A, and C
+// The host's times show the trend only; the Teensy's cycles come from the 'B' command.
+//
+// To build and run (from this folder):
+//     g++ -std=gnu++17 -O2 -I. simFreqWeighting.cpp -o simFreqWeighting && ./simFreqWeighting
+
+#include <Tympan_Library.h>
+#include <random>
+#include "../AudioFilterFreqWeightingZAC_F32.h"
+
+const float fs_Hz = 44100.0f;
+const int block_samples = 128;
+const int n_blocks = 4000;
+
+//a source node: sends the next block of the test signal on each update()
+class HostSource_F32 : public AudioStream_F32 {
+  public:
+    HostSource_F32(const std::vector<float> &_x) : AudioStream_F32(0, NULL), x(_x) {}
+    virtual void update(void) {
+      audio_block_f32_t *b = allocate_f32();
+      if (!b) return;
+      memcpy(b->data, &x[(ind % n_blocks) * block_samples], block_samples * sizeof(float));
+      b->length = block_samples; b->id = ind++;
+      transmit(b);
+      release(b);
+    }
+    int ind = 0;
+  protected:
+    const std::vector<float> &x;
+};
+
+int main(void) {
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> noise(-1.0f, 1.0f);
+  std::vector<float> x(n_blocks * block_samples);
+  for (float &v : x) v = noise(rng);
+  AudioSettings_F32 settings(fs_Hz, block_samples);
+
+  //the shared network: source -> ZAC -> Z, A, C, and the selected output into one sink
+  HostSource_F32 source_shared(x);
+  AudioFilterFreqWeightingZAC_F32 zac(settings);
+  HostSink_F32<4> sink_shared;
+  AudioConnection_F32 c1(source_shared, 0, zac, 0);
+  AudioConnection_F32 c2(zac, AudioFilterFreqWeightingZAC_F32::OUT_Z, sink_shared, 0);
+  AudioConnection_F32 c3(zac, AudioFilterFreqWeightingZAC_F32::OUT_A, sink_shared, 1);
+  AudioConnection_F32 c4(zac, AudioFilterFreqWeightingZAC_F32::OUT_C, sink_shared, 2);
+  AudioConnection_F32 c5(zac, AudioFilterFreqWeightingZAC_F32::OUT_SELECTED, sink_shared, 3);
+
+  //the separate filters: source -> three library-style instances -> one sink
+  HostSource_F32 source_sep(x);
+  AudioFilterFreqWeighting_F32 filtZ(settings), filtA(settings), filtC(settings);
+  filtZ.setWeightingType(Z_WEIGHT); filtA.setWeightingType(A_WEIGHT); filtC.setWeightingType(C_WEIGHT);
+  HostSink_F32<3> sink_sep;
+  AudioConnection_F32 d1(source_sep, 0, filtZ, 0), d2(source_sep, 0, filtA, 0), d3(source_sep, 0, filtC, 0);
+  AudioConnection_F32 d4(filtZ, 0, sink_sep, 0), d5(filtA, 0, sink_sep, 1), d6(filtC, 0, sink_sep, 2);
+
+  //run both, block by block, and compare their outputs
+  float max_diff_A = 0.0f, max_diff_C = 0.0f;
+  bool selected_ok = true;
+  const int outs[3] = {AudioFilterFreqWeightingZAC_F32::OUT_Z, AudioFilterFreqWeightingZAC_F32::OUT_A, AudioFilterFreqWeightingZAC_F32::OUT_C};
+  int max_blocks_shared = 0, max_blocks_sep = 0;
+  for (int Iblock = 0; Iblock < n_blocks; Iblock++) {
+    zac.setSelectedOutput(outs[(Iblock / 100) % 3]);
+    AudioMemoryUsageMaxReset_F32();
+    source_shared.update(); zac.update(); sink_shared.update();
+    max_blocks_shared = max(max_blocks_shared, AudioMemoryUsageMax_F32());
+    AudioMemoryUsageMaxReset_F32();
+    source_sep.update(); filtZ.update(); filtA.update(); filtC.update(); sink_sep.update();
+    max_blocks_sep = max(max_blocks_sep, AudioMemoryUsageMax_F32());
+    for (int i = 0; i < block_samples; i++) {
+      max_diff_A = max(max_diff_A, fabsf(sink_shared.getLast(1)[i] - sink_sep.getLast(1)[i]));
+      max_diff_C = max(max_diff_C, fabsf(sink_shared.getLast(2)[i] - sink_sep.getLast(2)[i]));
+      int Isel = (Iblock / 100) % 3;  //the sink's inputs are in Z, A, C order, like the outputs
+      if (sink_shared.getLast(3)[i] != sink_shared.getLast(Isel)[i]) selected_ok = false;
+    }
+  }
+
+  //time each version (the fastest of a few runs, to steady the host's times)
+  double best_shared = 1.0e30, best_sep = 1.0e30;
+  for (int Irep = 0; Irep < 15; Irep++) {
+    unsigned long t0 = micros();
+    for (int Iblock = 0; Iblock < n_blocks; Iblock++) { source_shared.update(); zac.update(); sink_shared.update(); }
+    unsigned long t1 = micros();
+    for (int Iblock = 0; Iblock < n_blocks; Iblock++) { source_sep.update(); filtZ.update(); filtA.update(); filtC.update(); sink_sep.update(); }
+    unsigned long t2 = micros();
+    best_shared = min(best_shared, 1000.0 * (double)(t1 - t0) / n_blocks);
+    best_sep = min(best_sep, 1000.0 * (double)(t2 - t1) / n_blocks);
+  }
+
+  printf("simFreqWeighting: %d blocks of %d samples of white noise at %.0f Hz\n", n_blocks, block_samples, fs_Hz);
+  printf("  Host time per block (with the source and sink):\n");
+  printf("    Shared Z/A/C network (3 biquads):                  %7.1f nsec, %d audio blocks\n", best_shared, max_blocks_shared);
+  printf("    3x AudioFilterFreqWeighting_F32 (5 biquads + copy): %7.1f nsec, %d audio blocks (%.2fx the shared)\n", best_sep, max_blocks_sep, best_sep / best_shared);
+  printf("  Largest difference, shared vs separate: A = %.2e, C = %.2e\n", max_diff_A, max_diff_C);
+  printf("  OUT_SELECTED matches the chosen weighting (Z, A, C): %s\n", selected_ok ? "PASS" : "FAIL");
+  bool pass = selected_ok && (max_diff_A < 1.0e-4f) && (max_diff_C < 1.0e-4f);
+  return pass ? 0 : 1;
+}
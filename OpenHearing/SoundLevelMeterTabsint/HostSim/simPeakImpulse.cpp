@@ -0,0 +1,63 @@
+// simPeakImpulse: checks the true-peak (LCpeak) and Impulse (LAI) detectors of ../AudioCalcPeakImpulse_F32.h on a PC,
+// with the same synthetic signals as checkPeakImpulse() in the sketch (the 'p' command), at 44.1 kHz, 128 samples:
+//   * sines with a 45 deg phase: the sample peak is below the true peak (by 3 dB at fs/4).  The true peak should
+//     still read 0 dBFS.
+//   * single 2 kHz tone bursts of 20, 5, and 2 msec, which should read 10*log10(1 - exp(-tb/35msec)) dB relative
+//     to the steady tone (IEC 61672 tone burst response: -3.6, -8.8, and -12.6 dB), within the class 1 tolerances
+//     of +/-1.0, +/-1.5, and +/-2.0 dB
+//
+// To build and run (from this folder):
+//     g++ -std=gnu++17 -O2 -I. simPeakImpulse.cpp -o simPeakImpulse && ./simPeakImpulse
+
+#include <Tympan_Library.h>
+#include "../AudioCalcPeakImpulse_F32.h"
+
+const float fs_Hz = 44100.0f;
+const int block_samples = 128;
+
+int main(void) {
+  AudioSettings_F32 settings(fs_Hz, block_samples);
+  AudioCalcPeakImpulse_F32 detector(settings);
+  detector.setup(fs_Hz);
+  static float x[AUDIO_BLOCK_SAMPLES];
+  bool pass = true;
+
+  printf("simPeakImpulse: true peak of sines with a 45 deg phase:\n");
+  for (float freq_Hz : {1000.0f, 5000.0f, 11025.0f, 15000.0f}) {
+    detector.reset();
+    float sample_peak = 0.0f;
+    for (int Iblock = 0; Iblock < 40; Iblock++) {
+      if (Iblock == 4) detector.resetMaxLevels();  //skip the interpolator's start-up
+      for (int i = 0; i < block_samples; i++) {
+        x[i] = sinf(2.0f * PI * freq_Hz * ((float)(Iblock * block_samples + i)) / fs_Hz + 0.25f * PI);
+        if (Iblock >= 4) sample_peak = max(sample_peak, fabsf(x[i]));
+      }
+      detector.processAudio(x, x, block_samples);
+    }
+    float true_peak_dB = detector.getMaxTruePeak_dB();
+    bool ok = fabsf(true_peak_dB) < 0.5f;
+    pass = pass && ok;
+    printf("  %5.0f Hz: sample peak = %6.2f dBFS, true peak = %6.2f dBFS (expected 0.0 +/- 0.5): %s\n", freq_Hz, 20.0f * log10f(sample_peak), true_peak_dB, ok ? "PASS" : "FAIL");
+  }
+
+  printf("Impulse: single 2 kHz tone bursts:\n");
+  const float burst_sec[3] = {0.020f, 0.005f, 0.002f}, tol_dB[3] = {1.0f, 1.5f, 2.0f};
+  for (int Iburst = 0; Iburst < 3; Iburst++) {
+    detector.reset();
+    int n_burst = (int)(burst_sec[Iburst] * fs_Hz + 0.5f);
+    for (int Iblock = 0; Iblock * block_samples < (int)fs_Hz; Iblock++) {  //one second
+      for (int i = 0; i < block_samples; i++) {
+        int k = Iblock * block_samples + i;
+        x[i] = (k < n_burst) ? sinf(2.0f * PI * 2000.0f * ((float)k) / fs_Hz) : 0.0f;
+      }
+      detector.processAudio(x, x, block_samples);
+    }
+    float steady_dB = 10.0f * log10f(0.5f);  //level of the steady tone
+    float expected_dB = 10.0f * log10f(1.0f - expf(-burst_sec[Iburst] / PEAK_IMPULSE_RISE_SEC));
+    float got_dB = detector.getMaxImpulseLevel_dB() - steady_dB;
+    bool ok = fabsf(got_dB - expected_dB) <= tol_dB[Iburst];
+    pass = pass && ok;
+    printf("  %4.0f msec: LImax - L = %6.2f dB (expected %6.2f +/- %.1f): %s\n", 1000.0f * burst_sec[Iburst], got_dB, expected_dB, tol_dB[Iburst], ok ? "PASS" : "FAIL");
+  }
+  return pass ? 0 : 1;
+}
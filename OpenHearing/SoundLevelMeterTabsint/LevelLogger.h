@@ -0,0 +1,169 @@
+
+#ifndef _LevelLogger_h
+#define _LevelLogger_h
+
+#include <Arduino.h>
+#include <SdFat.h>
+
+//Purpose: Continuously log timestamped levels (broadband plus each octave band) to an append-only binary file on
+//   the SD card.  Meant for multi-day logging at intervals of 125 msec to 1 sec, with as little CPU as possible.
+//
+//   The records are collected in RAM and written to the SD card as whole 512-byte blocks (the SD card's native
+//   write size).  Every block starts with an index header that holds the time of the block's first level record.
+//   So, a host program can find any time in the file with a binary search over the block headers, without
+//   reading the rest of the file.  See readLevelLog.m.
+//
+//   File format (little-endian).  The file is a sequence of 512-byte blocks.  Each block is:
+//     Index header (20 bytes):
+//       uint16 magic (LEVEL_LOG_MAGIC), uint8 'I', uint8 version, uint32 block number,
+//       uint32 time of the first level record (unix seconds, or 0 if the block has none), uint16 msec,
+//       uint8 n_levels, uint8 bands_per_octave, float top_center_Hz
+//     Records, each starting with uint8 type and uint8 length (bytes, including these two):
+//       'S' (session): uint32 unix seconds, uint16 msec, uint16 interval_msec, uint8 n_levels, uint8 bands_per_octave,
+//                      uint8 freq_weight, uint8 time_weight, float top_center_Hz
+//       'L' (levels):  uint32 unix seconds, uint16 msec, int16 level (0.1 dB SPL) for each of n_levels
+//                      (broadband first, then the bands from lowest to highest)
+//     A type of 0 means that the rest of the block is unused.
+//
+//   The time comes from the Teensy's real-time clock (which the Arduino IDE sets when the Tympan is programmed),
+//   refined to the millisecond using millis().
+
+#define LEVEL_LOG_BLOCK_BYTES   512
+#define LEVEL_LOG_HEADER_BYTES  20
+#define LEVEL_LOG_MAGIC         0x4C4C    //"LL"
+#define LEVEL_LOG_VERSION       1
+#define LEVEL_LOG_MAX_LEVELS    64
+#define LEVEL_LOG_MIN_INTERVAL_MSEC  125
+#define LEVEL_LOG_MAX_INTERVAL_MSEC  1000
+
+class LevelLogger {
+  public:
+    LevelLogger(SdFs *_sd) : sd(_sd) {}
+
+    int setInterval_msec(int msec) { return interval_msec = max(LEVEL_LOG_MIN_INTERVAL_MSEC, min(LEVEL_LOG_MAX_INTERVAL_MSEC, msec)); }
+    int getInterval_msec(void) { return interval_msec; }
+    bool isLogging(void) { return file.isOpen(); }
+    uint32_t getBlocksWritten(void) { return block_number; }
+
+    //open the file (appending to it, if it exists).  Call beginSession() before adding levels.
+    bool open(const char *fname) {
+      if (file.isOpen()) return true;
+      if (!file.open(sd, fname, O_RDWR | O_CREAT | O_APPEND)) return false;
+
+      //if the last block was only partly written (such as from a power failure), pad it out so that we start on a block boundary
+      uint64_t n_bytes = file.fileSize();
+      int n_extra = (int)(n_bytes % LEVEL_LOG_BLOCK_BYTES);
+      if (n_extra > 0) {
+        memset(block, 0, LEVEL_LOG_BLOCK_BYTES);
+        file.write(block, LEVEL_LOG_BLOCK_BYTES - n_extra);
+        n_bytes += LEVEL_LOG_BLOCK_BYTES - n_extra;
+      }
+      block_number = (uint32_t)(n_bytes / LEVEL_LOG_BLOCK_BYTES);
+      block_ind = 0;  //no block started yet
+      return true;
+    }
+
+    //write any partial block and close the file
+    void close(void) {
+      if (!file.isOpen()) return;
+      if (block_ind > LEVEL_LOG_HEADER_BYTES) writeBlock();
+      file.close();
+      block_ind = 0;
+    }
+
+    //start a new session (on a new block), such as when the settings change
+    bool beginSession(uint32_t cur_millis, int _n_levels, int _bands_per_octave, float _top_center_Hz, int freq_weight, int time_weight) {
+      if (!file.isOpen()) return false;
+      if (block_ind > LEVEL_LOG_HEADER_BYTES) writeBlock();
+      n_levels = max(1, min(LEVEL_LOG_MAX_LEVELS, _n_levels));
+      bands_per_octave = _bands_per_octave;
+      top_center_Hz = _top_center_Hz;
+      start_unix_sec = Teensy3Clock.get();
+      start_millis = cur_millis;
+      startBlock();
+
+      uint8_t rec[18];
+      rec[0] = 'S'; rec[1] = sizeof(rec);
+      putTime(rec + 2, cur_millis);
+      uint16_t interval = (uint16_t)interval_msec; memcpy(rec + 8, &interval, 2);
+      rec[10] = (uint8_t)n_levels; rec[11] = (uint8_t)bands_per_octave;
+      rec[12] = (uint8_t)freq_weight; rec[13] = (uint8_t)time_weight;
+      memcpy(rec + 14, &top_center_Hz, 4);
+      return addRecord(rec, sizeof(rec));
+    }
+    int getNLevels(void) { return n_levels; }
+    bool hasSession(void) { return file.isOpen() && (block_ind > 0); }
+
+    //add one set of levels (dB SPL).  Only the SD writes (one per full block) take any significant time.
+    bool addLevels(uint32_t cur_millis, const float *levels_dB, int n) {
+      if ((!file.isOpen()) || (block_ind == 0)) return false;
+      n = min(n, n_levels);
+      uint8_t rec[8 + 2 * LEVEL_LOG_MAX_LEVELS];
+      rec[0] = 'L'; rec[1] = (uint8_t)(8 + 2 * n);
+      putTime(rec + 2, cur_millis);
+      for (int i = 0; i < n; i++) {
+        int16_t val = (int16_t)max(-32768.0f, min(32767.0f, roundf(10.0f * levels_dB[i])));
+        memcpy(rec + 8 + 2 * i, &val, 2);
+      }
+      return addRecord(rec, rec[1]);
+    }
+
+  protected:
+    SdFs *sd;
+    FsFile file;
+    uint8_t block[LEVEL_LOG_BLOCK_BYTES];
+    int block_ind = 0;              //write position in the block (0 means that the block hasn't been started)
+    bool block_has_time = false;    //has the index header received the time of its first level record?
+    uint32_t block_number = 0;
+    int interval_msec = 1000;
+    int n_levels = 1, bands_per_octave = 1;
+    float top_center_Hz = 8000.0f;
+    uint32_t start_unix_sec = 0, start_millis = 0;
+
+    void startBlock(void) {
+      memset(block, 0, LEVEL_LOG_BLOCK_BYTES);
+      uint16_t magic = LEVEL_LOG_MAGIC;
+      memcpy(block + 0, &magic, 2);
+      block[2] = 'I'; block[3] = LEVEL_LOG_VERSION;
+      memcpy(block + 4, &block_number, 4);
+      //bytes 8-13 (time) are filled in by the first level record
+      block[14] = (uint8_t)n_levels; block[15] = (uint8_t)bands_per_octave;
+      memcpy(block + 16, &top_center_Hz, 4);
+      block_ind = LEVEL_LOG_HEADER_BYTES;
+      block_has_time = false;
+    }
+
+    bool writeBlock(void) {
+      bool ok = (file.write(block, LEVEL_LOG_BLOCK_BYTES) == LEVEL_LOG_BLOCK_BYTES);
+      file.flush();
+      block_number++;
+      block_ind = 0;
+      return ok;
+    }
+
+    bool addRecord(const uint8_t *rec, int n_bytes) {
+      bool ok = true;
+      if (block_ind + n_bytes > LEVEL_LOG_BLOCK_BYTES) {
+        ok = writeBlock();  //the rest of the block is already zero, which marks it as unused
+        startBlock();
+      }
+      if ((rec[0] == 'L') && (!block_has_time)) {
+        memcpy(block + 8, rec + 2, 6);  //the time of the first level record goes into the index header
+        block_has_time = true;
+      }
+      memcpy(block + block_ind, rec, n_bytes);
+      block_ind += n_bytes;
+      return ok;
+    }
+
+    //convert millis() to unix seconds (uint32) plus msec (uint16)
+    void putTime(uint8_t *buf, uint32_t cur_millis) {
+      uint32_t elapsed_millis = cur_millis - start_millis;
+      uint32_t sec = start_unix_sec + elapsed_millis / 1000;
+      uint16_t msec = (uint16_t)(elapsed_millis % 1000);
+      memcpy(buf, &sec, 4);
+      memcpy(buf + 4, &msec, 2);
+    }
+};
+
+#endif
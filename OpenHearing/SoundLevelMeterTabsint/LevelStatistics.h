@@ -0,0 +1,127 @@
+
+#ifndef _LevelStatistics_h
+#define _LevelStatistics_h
+
+#include <Arduino.h>
+
+//Purpose: Accumulate the statistics of a sound level (dB SPL) that is updated at a steady rate (such as once per
+//   audio block).  The memory is fixed, no matter how long the measurement runs.
+//
+//   Per interval (see resetInterval()):
+//     * Leq (energy average), Lmax, and Lmin
+//     * Percentile levels (such as L10, L50, L90...the level exceeded N% of the time) from a histogram
+//   Since reset() (ie, running for the whole measurement):
+//     * Leq
+//     * Noise dose (percent), using a criterion level, exchange rate, and threshold (such as NIOSH: 85 dB, 3 dB, 8 hrs)
+//
+//   Two things are added, usually once per audio block:
+//     * addSumOfSquares(): the sum of the squared audio samples (calibrated, and with no time weighting).  The Leq
+//       is the mean of these squares, which is what Leq is defined to be.  It would be biased if it were computed
+//       from the FAST or SLOW level instead, since the time weighting smears each level into the next blocks.
+//     * addLevel_dB(): the time-weighted level (such as FAST or SLOW), for Lmax, Lmin, the percentiles, and the dose.
+//
+//   Memory: the histogram is LEVEL_STATS_N_BINS counts of 2 bytes (560 bytes per instance).  An interval can be much
+//   longer than 65535 levels (an hour at 128-sample blocks is 1.2 million), so when a bin fills up, every bin is
+//   halved.  That doesn't change the percentiles, which only depend on the counts relative to each other.
+
+#define LEVEL_STATS_MIN_dB    0.0f   //lower edge of the histogram (levels below are put in the first bin)
+#define LEVEL_STATS_BIN_dB    0.5f   //width of each histogram bin
+#define LEVEL_STATS_N_BINS    280    //number of bins.  With the values above, the histogram spans 0-140 dB
+
+class LevelStatistics {
+  public:
+    LevelStatistics(void) { reset(); }
+
+    //clear everything, including the dose
+    void reset(void) {
+      resetInterval();
+      total_pow = 0.0; total_count = 0;
+      dose_frac = 0.0; total_sec = 0.0;
+    }
+
+    //start a new interval.  The dose and the running Leq keep going.
+    void resetInterval(void) {
+      for (int i = 0; i < LEVEL_STATS_N_BINS; i++) hist[i] = 0;
+      hist_total = 0;
+      interval_pow = 0.0; interval_count = 0; interval_sec = 0.0f;
+      max_dB = -1000.0f; min_dB = 1000.0f;
+    }
+
+    //set the dose parameters.  Levels below the threshold do not add to the dose.
+    void setDoseParameters(float _criterion_dB, float _exchange_dB, float _criterion_hours, float _threshold_dB) {
+      criterion_dB = _criterion_dB; exchange_dB = _exchange_dB;
+      criterion_hours = _criterion_hours; threshold_dB = _threshold_dB;
+    }
+
+    //add the sum of the squared samples (calibrated to Pa^2 re: 20 uPa, ie, 10^(dB SPL/10) for each sample) for the Leq
+    void addSumOfSquares(double sum_sq, uint32_t n_samples) {
+      interval_pow += sum_sq; interval_count += n_samples;
+      total_pow += sum_sq; total_count += n_samples;
+    }
+
+    //add a new time-weighted level (dB) that represents dt_sec of time
+    void addLevel_dB(float level_dB, float dt_sec) {
+      interval_sec += dt_sec; total_sec += dt_sec;
+      if (level_dB > max_dB) max_dB = level_dB;
+      if (level_dB < min_dB) min_dB = level_dB;
+
+      int bin = max(0, min(LEVEL_STATS_N_BINS - 1, (int)((level_dB - LEVEL_STATS_MIN_dB) / LEVEL_STATS_BIN_dB)));
+      hist_total++;
+      if (++hist[bin] == 0xFFFF) halveHistogram();
+
+      //dose: the allowed time at this level is criterion_hours / 2^((level - criterion)/exchange)
+      if (level_dB >= threshold_dB) {
+        dose_frac += (double)(dt_sec * exp2f((level_dB - criterion_dB) / exchange_dB) / (3600.0f * criterion_hours));
+      }
+    }
+
+    //get the interval statistics
+    float getLeq_dB(void) { return toLevel_dB(interval_pow, interval_count); }
+    float getLmax_dB(void) { return (hist_total > 0) ? max_dB : -1000.0f; }
+    float getLmin_dB(void) { return (hist_total > 0) ? min_dB : -1000.0f; }
+    float getInterval_sec(void) { return interval_sec; }
+
+    //get the level exceeded pct_exceeded percent of the time (such as 10.0 for L10), interpolated within a bin
+    float getPercentileLevel_dB(float pct_exceeded) {
+      if (hist_total == 0) return -1000.0f;
+      float target = 0.01f * pct_exceeded * ((float)hist_total);
+      uint32_t cum = 0;
+      for (int bin = LEVEL_STATS_N_BINS - 1; bin >= 0; bin--) {
+        if ((float)(cum + hist[bin]) >= target) {
+          float frac = (hist[bin] > 0) ? (target - (float)cum) / ((float)hist[bin]) : 0.0f;  //how far down into this bin
+          return LEVEL_STATS_MIN_dB + LEVEL_STATS_BIN_dB * (((float)(bin + 1)) - frac);
+        }
+        cum += hist[bin];
+      }
+      return LEVEL_STATS_MIN_dB;
+    }
+
+    //get the statistics since reset()
+    float getTotalLeq_dB(void) { return toLevel_dB(total_pow, total_count); }
+    float getTotal_sec(void) { return (float)total_sec; }
+    float getDose_percent(void) { return (float)(100.0 * dose_frac); }
+
+  protected:
+    uint16_t hist[LEVEL_STATS_N_BINS];     //see halveHistogram()
+    uint32_t hist_total;                   //sum of hist[]
+    double interval_pow, total_pow;        //sum of the squared samples (see addSumOfSquares())
+    uint32_t interval_count;               //number of samples in the sums
+    uint64_t total_count;                  //(a uint32_t would overflow after 27 hours at 44.1 kHz)
+    float interval_sec;
+    double total_sec, dose_frac;
+    float max_dB, min_dB;
+    float criterion_dB = 85.0f, exchange_dB = 3.0f, criterion_hours = 8.0f, threshold_dB = 80.0f;  //NIOSH REL (with an 80 dB threshold)
+
+    //keep the counts from overflowing.  Round up, so that a bin with any levels in it is not emptied.
+    void halveHistogram(void) {
+      hist_total = 0;
+      for (int i = 0; i < LEVEL_STATS_N_BINS; i++) { hist[i] = (hist[i] + 1) >> 1; hist_total += hist[i]; }
+    }
+
+    static float toLevel_dB(double pow_sum, uint64_t count) {
+      if (count == 0) return -1000.0f;
+      return 10.0f * log10f((float)max(pow_sum / ((double)count), 1.0e-20));
+    }
+};
+
+#endif
@@ -0,0 +1,102 @@
+
+#ifndef _LevelTelemetryFrame_h
+#define _LevelTelemetryFrame_h
+
+#include <Arduino.h>
+
+//Purpose: Pack the broadband and octave-band levels into a compact binary frame for sending over BLE, instead of
+//   building a "TL=... TO=..." text message out of many String objects.  Everything lives in fixed buffers inside
+//   this class, so building a frame does not allocate any memory.
+//
+//   Frame (little-endian):
+//     uint8  version (LEVEL_FRAME_VERSION)
+//     uint8  n_bands
+//     uint8  bands_per_octave (1 or 3)
+//     uint8  flags: bits 0-1 = frequency weighting (0 = A, 1 = C, 2 = Z), bit 2 = time weighting (0 = SLOW, 1 = FAST)
+//     uint16 sequence counter (increments every frame, wraps around...use it to detect dropped frames)
+//     int16  current broadband level (0.1 dB SPL)
+//     int16  max broadband level (0.1 dB SPL)
+//     int16  level of each band, lowest band first (0.1 dB SPL)
+//
+//   Over BLE, the frame goes out as raw bytes behind the prefix "TB=" (see getMessage()), written as one byte array
+//   with the length-framed BLE::sendMessage(const char *, int), so no String is built.  For printing to USB, encode()
+//   gives the same frame as "TB=" plus base64 text.  See decodeLevelFrame.m for a decoder of either form.
+
+#define LEVEL_FRAME_VERSION       1
+#define LEVEL_FRAME_HEADER_BYTES  6
+#define LEVEL_FRAME_MAX_BANDS     32
+#define LEVEL_FRAME_MAX_BYTES     (LEVEL_FRAME_HEADER_BYTES + 2 * (2 + LEVEL_FRAME_MAX_BANDS))
+#define LEVEL_FRAME_PREFIX        "TB="
+#define LEVEL_FRAME_PREFIX_BYTES  3
+#define LEVEL_FRAME_MAX_CHARS     (LEVEL_FRAME_PREFIX_BYTES + 4 * ((LEVEL_FRAME_MAX_BYTES + 2) / 3) + 1)  //prefix, base64, null terminator
+
+class LevelTelemetryFrame {
+  public:
+    LevelTelemetryFrame(void) { memcpy(msg, LEVEL_FRAME_PREFIX, LEVEL_FRAME_PREFIX_BYTES); }
+
+    //build the binary frame.  Returns the number of bytes.
+    int build(float cur_dB, float max_dB, const float *band_dB, int n_bands, int bands_per_octave, int freq_weight, int time_weight) {
+      n_bands = max(0, min(LEVEL_FRAME_MAX_BANDS, n_bands));
+      bytes[0] = LEVEL_FRAME_VERSION;
+      bytes[1] = (uint8_t)n_bands;
+      bytes[2] = (uint8_t)bands_per_octave;
+      bytes[3] = (uint8_t)((freq_weight & 0x03) | ((time_weight & 0x01) << 2));
+      bytes[4] = (uint8_t)(seq & 0xFF);
+      bytes[5] = (uint8_t)(seq >> 8);
+      seq++;
+
+      int ind = LEVEL_FRAME_HEADER_BYTES;
+      ind = putLevel(ind, cur_dB);
+      ind = putLevel(ind, max_dB);
+      for (int Iband = 0; Iband < n_bands; Iband++) ind = putLevel(ind, band_dB[Iband]);
+      return n_bytes = ind;
+    }
+    int getNBytes(void) { return n_bytes; }
+    const uint8_t* getBytes(void) { return bytes; }
+
+    //the frame with the "TB=" prefix in front, ready to be written to BLE as one byte array
+    const char* getMessage(void) { return (const char *)msg; }
+    int getNMessageBytes(void) { return LEVEL_FRAME_PREFIX_BYTES + n_bytes; }
+    uint16_t getSequence(void) { return seq; }
+
+    //convert the frame to "TB=" plus base64 text.  Returns a pointer to the (null-terminated) text.
+    const char* encode(void) {
+      static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+      memcpy(chars, LEVEL_FRAME_PREFIX, LEVEL_FRAME_PREFIX_BYTES);
+      int n_out = LEVEL_FRAME_PREFIX_BYTES;
+      for (int i = 0; i < n_bytes; i += 3) {
+        uint32_t v = ((uint32_t)bytes[i]) << 16;
+        if (i + 1 < n_bytes) v |= ((uint32_t)bytes[i + 1]) << 8;
+        if (i + 2 < n_bytes) v |= (uint32_t)bytes[i + 2];
+        chars[n_out++] = table[(v >> 18) & 0x3F];
+        chars[n_out++] = table[(v >> 12) & 0x3F];
+        chars[n_out++] = (i + 1 < n_bytes) ? table[(v >> 6) & 0x3F] : '=';
+        chars[n_out++] = (i + 2 < n_bytes) ? table[v & 0x3F] : '=';
+      }
+      chars[n_out] = '\0';
+      n_chars = n_out;
+      return chars;
+    }
+    int getNChars(void) { return n_chars; }
+
+    //size of a frame with the given number of bands, without building one (which would use up a sequence number)
+    static int calcNBytes(int n_bands) { return LEVEL_FRAME_HEADER_BYTES + 2 * (2 + max(0, min(LEVEL_FRAME_MAX_BANDS, n_bands))); }
+    static int calcNMessageBytes(int n_bands) { return LEVEL_FRAME_PREFIX_BYTES + calcNBytes(n_bands); }
+    static int calcNChars(int n_bands) { return LEVEL_FRAME_PREFIX_BYTES + 4 * ((calcNBytes(n_bands) + 2) / 3); }
+
+  protected:
+    uint8_t msg[LEVEL_FRAME_PREFIX_BYTES + LEVEL_FRAME_MAX_BYTES];  //the prefix, then the frame
+    uint8_t *bytes = msg + LEVEL_FRAME_PREFIX_BYTES;
+    char chars[LEVEL_FRAME_MAX_CHARS];
+    int n_bytes = 0, n_chars = 0;
+    uint16_t seq = 0;
+
+    int putLevel(int ind, float val_dB) {
+      int16_t val = (int16_t)max(-32768.0f, min(32767.0f, roundf(10.0f * val_dB)));
+      bytes[ind] = (uint8_t)(val & 0xFF);
+      bytes[ind + 1] = (uint8_t)((val >> 8) & 0xFF);
+      return ind + 2;
+    }
+};
+
+#endif
@@ -8,14 +8,25 @@
 //externally defined objects
 extern Tympan myTympan;
 extern State myState;
-extern AudioCalcLevel_F32 calcLevel1;
-extern AudioFilterFreqWeighting_F32    freqWeight1;
 
 //functions in the main sketch that I want to call from here
 extern bool enablePrintMemoryAndCPU(bool);
 extern bool enablePrintingToBLE(bool);
 extern int setFreqWeightType(int);
 extern int setTimeAveragingType(int);
+extern int setBandsPerOctave(int);
+extern void benchmarkOctaveAnalyzer(void);
+extern bool enableLogStatsToSD(bool);
+extern void printLevelStatistics(void);
+extern float incrementStatsInterval(void);
+extern void resetLevelStatistics(void);
+extern bool enableBinaryLevelFrames(bool);
+extern unsigned long incrementLevelUpdatePeriod(void);
+extern bool enableLevelLogger(bool);
+extern int incrementLevelLogInterval(void);
+extern void resetMaxLevels(void);
+extern void benchmarkFreqWeighting(void);
+extern void checkPeakImpulse(void);
 
 //Define a class to help manage the interactions with Serial comms (from SerialMonitor or from Bluetooth (BLE))
 //see SerialManagerBase.h in the Tympan Library for some helpful supporting functions (like {"sendButtonState")
@@ -39,8 +50,21 @@ void SerialManager::printHelp(void) {
   myTympan.println("   c,C: Enable/Disable printing of CPU and Memory usage");
   myTympan.println("   t,T: FAST time constant or SLOW time constant on all measurements");
   myTympan.println("   f,F: BROADBAND: A-weight or C-weight for loudness");  
+  myTympan.println("   z:   BROADBAND: Z-weight (unweighted) for loudness");
+  myTympan.println("   B:   BROADBAND: Benchmark the CPU of the shared Z/A/C weighting filters");
   myTympan.println("   v,V: BROADBAND AND OCTAVE BAND: Start/Stop sending level to TabSINT App.");
-  myTympan.println("   0:   BROADBAND: Reset max loudness value.");
+  myTympan.println("   0:   BROADBAND: Reset max loudness value (and LCpeak and LAImax).");
+  myTympan.println("   p:   BROADBAND: Check the true-peak and Impulse detectors with synthetic tones and tone bursts");
+  myTympan.println("   m,M: BROADBAND AND OCTAVE BAND: Send levels as binary frames or as text");
+  myTympan.println("   u:   BROADBAND AND OCTAVE BAND: Change how often the levels are sent (1000, 500, 250, 125 msec)");
+  myTympan.println("   o,O: OCTAVE BAND: Octave bands or third-octave bands");
+  myTympan.println("   b:   OCTAVE BAND: Benchmark the CPU of the octave-band analyzer");
+  myTympan.println("   i:   STATISTICS: Print Leq, Lmax, L10/L50/L90, and dose for the current interval");
+  myTympan.println("   I:   STATISTICS: Change the statistics interval (10, 60, 300, 900, 3600 sec)");
+  myTympan.println("   l,L: STATISTICS: Start/Stop logging the statistics to the SD card");
+  myTympan.println("   r:   STATISTICS: Reset all statistics (including the dose)");
+  myTympan.println("   g,G: LOGGER: Start/Stop continuously logging the levels to the SD card");
+  myTympan.println("   k:   LOGGER: Change the logging interval (125, 250, 500, 1000 msec)");
   myTympan.println();
 }
 
@@ -67,6 +91,18 @@ void SerialManager::respondToByte(char c) {
       myTympan.println("Command Received: setting to C-weight");
       setFreqWeightType(State::FREQ_C_WEIGHT);
       break;
+    case 'z':
+      myTympan.println("Command Received: setting to Z-weight");
+      setFreqWeightType(State::FREQ_Z_WEIGHT);
+      break;
+    case 'B':
+      myTympan.println("Command Received: benchmarking the frequency weighting");
+      benchmarkFreqWeighting();
+      break;
+    case 'p':
+      myTympan.println("Command Received: checking the true-peak and Impulse detectors");
+      checkPeakImpulse();
+      break;
     case 't':
       myTympan.println("Command Received: setting to FAST time constant");
       setTimeAveragingType(State::TIME_FAST);
@@ -85,8 +121,60 @@ void SerialManager::respondToByte(char c) {
       break;
     case '0':
       myTympan.println("Command Received: reseting max SPL.");
-      calcLevel1.resetMaxLevel();
+      resetMaxLevels();
       break;         
+    case 'm':
+      myTympan.println("Command Received: sending levels as binary frames.");
+      enableBinaryLevelFrames(true);
+      break;
+    case 'M':
+      myTympan.println("Command Received: sending levels as text.");
+      enableBinaryLevelFrames(false);
+      break;
+    case 'u':
+      myTympan.println("Command Received: sending levels every " + String(incrementLevelUpdatePeriod()) + " msec");
+      break;
+    case 'o':
+      myTympan.println("Command Received: setting to octave bands");
+      setBandsPerOctave(1);
+      break;
+    case 'O':
+      myTympan.println("Command Received: setting to third-octave bands");
+      setBandsPerOctave(3);
+      break;
+    case 'b':
+      myTympan.println("Command Received: benchmarking the octave-band analyzer");
+      benchmarkOctaveAnalyzer();
+      break;
+    case 'i':
+      printLevelStatistics();
+      break;
+    case 'I':
+      myTympan.println("Command Received: changing the statistics interval to " + String(incrementStatsInterval(),0) + " sec");
+      break;
+    case 'l':
+      myTympan.println("Command Received: start logging statistics to SD.");
+      enableLogStatsToSD(true);
+      break;
+    case 'L':
+      myTympan.println("Command Received: stop logging statistics to SD.");
+      enableLogStatsToSD(false);
+      break;
+    case 'g':
+      myTympan.println("Command Received: start logging levels to SD.");
+      enableLevelLogger(true);
+      break;
+    case 'G':
+      myTympan.println("Command Received: stop logging levels to SD.");
+      enableLevelLogger(false);
+      break;
+    case 'k':
+      myTympan.println("Command Received: logging levels every " + String(incrementLevelLogInterval()) + " msec");
+      break;
+    case 'r':
+      myTympan.println("Command Received: resetting all statistics (including the dose).");
+      resetLevelStatistics();
+      break;
   }
 };
 
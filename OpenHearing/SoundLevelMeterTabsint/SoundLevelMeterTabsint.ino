@@ -6,6 +6,12 @@
 *            Uses exponential time weighting.
 *
 *   March 2024: Extended to show loudness in octave bands
+*   Octave bands (and third-octave bands) are now measured with a multirate analyzer (AudioCalcOctaveLevels_F32.h)
+*   Leq, Lmax, L10/L50/L90, and noise dose are accumulated every block and can be logged to SD (AudioCalcLevelStatistics_F32.h)
+*   Levels can be sent as compact binary frames instead of text (LevelTelemetryFrame.h, decodeLevelFrame.m)
+*   Levels can be continuously logged to SD every 125-1000 msec (LevelLogger.h, readLevelLog.m)
+*   Z, A, and C-weighted levels are all measured at once (AudioFilterFreqWeightingZAC_F32.h)
+*   Impulsive sounds are measured as LCpeak (4x oversampled true peak) and LAImax (AudioCalcPeakImpulse_F32.h)
 *
 *   Uses Tympan RevC, RevD, or RevE.
 *   Uses BLE and TympanRemote App
@@ -15,14 +21,22 @@
 
 //here are the libraries that we need
 #include <Tympan_Library.h>  //include the Tympan Library
+#include "AudioFilterFreqWeightingZAC_F32.h"
+#include "AudioCalcPeakImpulse_F32.h"
+#include "AudioCalcOctaveLevels_F32.h"
+#include "AudioCalcLevelStatistics_F32.h"
+#include "LevelTelemetryFrame.h"
+#include "LevelLogger.h"
+#include <CalibrationTable.h>     //from Libraries/Tympan_CalibrationTable in this repo
+#include "CpuBenchmark.h"
 #include "SerialManager.h"
 //set the sample rate and block size
 const float sample_rate_Hz = 44100.0f ; //24000 or 44117 (or other frequencies in the table in AudioOutputI2S_F32)
 const int audio_block_samples = 128;     //do not make bigger than AUDIO_BLOCK_SAMPLES from AudioStream.h (which is 128)
 AudioSettings_F32 audio_settings(sample_rate_Hz, audio_block_samples);
 
-#define N_FILTER_BANDS 9   //throw-away the top and bottom (which are shelving filters), it leaves 7 proper octave-band filters in the middle
-#define FILTER_ORDER 6     //what filter order to use for each of the filters in the filterbank
+#define N_OCTAVES 7             //octave bands: 125 Hz to 8 kHz
+#define N_OCTAVES_THIRD_OCT 10  //third-octave bands: 20 Hz to 16 kHz (30 bands)
 
 //create audio library objects for handling the audio
 Tympan    myTympan(TympanRev::E);            //use TympanRev::E or TympanRev::D or TympanRev::C
@@ -35,6 +49,20 @@ State myState(&audio_settings, &myTympan);
 
 //calibraiton information for the microphone being used
 float32_t mic_cal_dBFS_at94dBSPL_at_0dB_gain = -47.4f + 9.2175;  //PCB Mic baseline with manually tested adjustment.   Baseline:  http://openaudio.blogspot.com/search/label/Microphone
+                                                                  //This is replaced by the 1 kHz value of the calibration table, if there is one on the SD card
+CalibrationTable micCalTable;          //the mic's sensitivity versus frequency, as measured by CalibraitonViaExternalMic
+#define CAL_TABLE_FNAME "CALTABLE.BIN"
+float32_t band_corr_dB[OCTAVE_LEVELS_MAX_BANDS] = {0.0f};  //added to each octave band to correct for the mic's frequency response
+
+//SD card for logging the level statistics and the levels themselves
+SdFs sd;                         //This is the SD card.  SdFs is part of the Teensy install
+FsFile statsFile;
+#define STATS_FNAME "LEVSTATS.BIN"
+LevelLogger levelLogger(&sd);
+#define LEVEL_LOG_FNAME "LEVELLOG.BIN"
+
+//binary level frames for BLE
+LevelTelemetryFrame levelFrame;
 
 //control display and serial interaction
 bool enable_printCPUandMemory = false;
@@ -43,14 +71,12 @@ bool enablePrintingToBLE(bool _enable = false) {return myState.enable_printTextT
 
 // define the setup() function, the function that is called once when the device is booting
 const float input_gain_dB = 15.0f; //gain on the microphone
+float getCalFactor_dB(void) { return -mic_cal_dBFS_at94dBSPL_at_0dB_gain + 94.0f - input_gain_dB; } //add this to dBFS to get dB SPL
 void setup() {
   //begin the serial comms (for debugging)
   myTympan.beginBothSerial(); delay(1000);
   myTympan.println("SoundLevelMeter: Starting setup()...");
 
-  //make the remaining audio connections
-  makePerBandAudioConnections();  //see AudioConnections.h
-
   //allocate the dynamic memory for audio processing blocks
   AudioMemory_F32(50,audio_settings); 
 
@@ -66,8 +92,11 @@ void setup() {
   myTympan.volume_dB(0);                   // headphone amplifier.  -63.6 to +24 dB in 0.5dB steps.
   myTympan.setInputGain_dB(input_gain_dB); // set input volume, 0-47.5dB in 0.5dB setps
 
+  //Load the mic's calibration versus frequency (if there is one on the SD card)
+  loadMicCalibration();
+
   // Configure the octave-band level monitoring, set the processing parametes
-  configOctaveBandProcessing(N_FILTER_BANDS,FILTER_ORDER,State::TIME_SLOW);  //see AudioConnections.h
+  setBandsPerOctave(myState.bands_per_octave);
 
   //Set frequency weighting for broadband processing.  See #define in: https://github.com/Tympan/Tympan_Library/blob/master/src/utility/FreqWeighting_IEC1672.h
   myTympan.println("Frequency Weighting: A_WEIGHT");
@@ -77,6 +106,11 @@ void setup() {
   myTympan.println("Time Weighting: SLOW");
   setTimeAveragingType(State::TIME_SLOW);
 
+  //Set up the level statistics
+  levelStats.setSources(calcLevelBB, &octaveLevels);
+  levelStats.setCalibration_dB(getCalFactor_dB());
+  resetLevelStatistics();
+
   // //////////// setup BLE
   myTympan.setupBLE();
 
@@ -103,9 +137,15 @@ void loop() {
   
   //printing of sound level
   if (myState.enable_printTextToBLE) {
-    printLoudnessLevels(millis(),1000);  //print a value every 1000 msec
+    printLoudnessLevels(millis(),myState.level_update_millis);  //print a value every 1000 msec (by default)
   }
 
+  //service the level statistics (and write them to SD)
+  serviceLevelStatistics(millis());
+
+  //service the continuous level logging
+  serviceLevelLogger(millis());
+
   //check to see whether to print the CPU and Memory Usage
   if (enable_printCPUandMemory) myTympan.printCPUandMemory(millis(),3000); //print every 3000 msec
 
@@ -127,59 +167,415 @@ void printLoudnessLevels(unsigned long curTime_millis, unsigned long updatePerio
       firstTime = false;
     }
     
-    float32_t cal_factor_dB = -mic_cal_dBFS_at94dBSPL_at_0dB_gain + 94.0f - input_gain_dB;
-    float32_t cur_SPL_dB = calcLevel1.getCurrentLevel_dB() + cal_factor_dB;
-    float32_t max_SPL_dB = calcLevel1.getMaxLevel_dB() + cal_factor_dB;
-    String msg = "TL=" + String(cur_SPL_dB,2) + " " + String(max_SPL_dB,2);
-    
-    msg.append(String("TO="));
-    for (int i=1; i < (N_FILTER_BANDS-1);i++) {  //skip the first and last filter because they're shelving and not octave-band
-      float32_t cur_SPL_dB = calcLevelPerOct[i].getCurrentLevel_dB() + cal_factor_dB;
-      msg.append(String(cur_SPL_dB,2));
-      if (i < (N_FILTER_BANDS-1-1)) msg.append(", ");
+    if (myState.enable_binaryLevelFrames) {
+      buildLevelFrame();
+      myTympan.println(levelFrame.encode()); // print to USB, as base64 text
+      ble.sendMessage(levelFrame.getMessage(), levelFrame.getNMessageBytes()); // the raw frame, as one byte array
+    } else {
+      String msg = buildLevelMessage();
+      myTympan.println(msg); // print to USB
+      ble.sendMessage(msg); // This is the line required for Tabsint
     }
-    
-    myTympan.println(msg); // print to USB
-    ble.sendMessage(msg); // This is the line required for Tabsint
 
     lastUpdate_millis = curTime_millis; //we will use this value the next time around.
   }
 }
 
 
-//Set the frequency weighting.  Options include State::FREQ_A_WEIGHT and State::FREQ_C_WEIGHT
+//Build the text message with the levels: "TL=cur max TO=band1, band2, ..."
+String buildLevelMessage(void) {
+  float32_t cal_factor_dB = getCalFactor_dB();
+  float32_t cur_SPL_dB = calcLevelBB->getCurrentLevel_dB() + cal_factor_dB;
+  float32_t max_SPL_dB = calcLevelBB->getMaxLevel_dB() + cal_factor_dB;
+  String msg = "TL=" + String(cur_SPL_dB,2) + " " + String(max_SPL_dB,2);
+
+  msg.append(String("TO="));
+  int n_bands = octaveLevels.getNBands();
+  for (int i=0; i < n_bands;i++) {
+    float32_t cur_SPL_dB = octaveLevels.getCurrentLevel_dB(i) + cal_factor_dB + band_corr_dB[i];
+    msg.append(String(cur_SPL_dB,2));
+    if (i < (n_bands-1)) msg.append(", ");
+  }
+  return msg;
+}
+
+//Build the binary frame with the same levels into levelFrame.  No memory is allocated.
+void buildLevelFrame(void) {
+  float32_t cal_factor_dB = getCalFactor_dB();
+  float32_t band_dB[LEVEL_FRAME_MAX_BANDS];
+  int n_bands = min(LEVEL_FRAME_MAX_BANDS, octaveLevels.getNBands());
+  for (int i=0; i < n_bands; i++) band_dB[i] = octaveLevels.getCurrentLevel_dB(i) + cal_factor_dB + band_corr_dB[i];
+  levelFrame.build(calcLevelBB->getCurrentLevel_dB() + cal_factor_dB, calcLevelBB->getMaxLevel_dB() + cal_factor_dB,
+                   band_dB, n_bands, octaveLevels.getBandsPerOctave(), myState.cur_freq_weight, myState.cur_time_averaging);
+}
+
+//Switch between binary frames and text messages.  Also, print how many bytes each one takes per update.
+bool enableBinaryLevelFrames(bool enable) {
+  int n_bands = octaveLevels.getNBands();
+  int n_text = buildLevelMessage().length();
+  myTympan.println("Level Messages: bytes per update (" + String(n_bands) + " bands, before BLE formatting):");
+  myTympan.print("    : Text = " + String(n_text) + ", Binary = " + String(LevelTelemetryFrame::calcNMessageBytes(n_bands)));
+  myTympan.println(" (" + String(LevelTelemetryFrame::calcNChars(n_bands)) + " as base64 on USB)");
+  return myState.enable_binaryLevelFrames = enable;
+}
+
+//step through the available update periods for sending the levels
+unsigned long incrementLevelUpdatePeriod(void) {
+  const int n_periods = 4;
+  const unsigned long periods_millis[n_periods] = {1000, 500, 250, 125};
+  int ind = 0;
+  while ((ind < n_periods) && (periods_millis[ind] >= myState.level_update_millis)) ind++;
+  return myState.level_update_millis = periods_millis[ind % n_periods];
+}
+
+//Set the frequency weighting.  Options include State::FREQ_A_WEIGHT, State::FREQ_C_WEIGHT, and State::FREQ_Z_WEIGHT
+//All three are always being measured (see the 'i' report), each by its own level detector.  This chooses which
+//detector is the broadband level (calcLevelBB) and goes to the right audio output.  As that detector has been
+//running all along, its smoothed level (and its max) are already right for the new weighting.  The level statistics
+//are started over, so that one interval never mixes two weightings.
 int setFreqWeightType(int type) {
+  int out = AudioFilterFreqWeightingZAC_F32::OUT_A;
+  AudioCalcLevel_F32 *detector = &calcLevelA;
   switch (type) {
     case State::FREQ_A_WEIGHT:
-      freqWeight1.setWeightingType(A_WEIGHT);
+      out = AudioFilterFreqWeightingZAC_F32::OUT_A; detector = &calcLevelA;
       break;
     case State::FREQ_C_WEIGHT:
-      freqWeight1.setWeightingType(C_WEIGHT);
+      out = AudioFilterFreqWeightingZAC_F32::OUT_C; detector = &calcLevelC;
+      break;
+    case State::FREQ_Z_WEIGHT:
+      out = AudioFilterFreqWeightingZAC_F32::OUT_Z; detector = &calcLevelZ;
       break;
     default:
       type = State::FREQ_A_WEIGHT;
-      freqWeight1.setWeightingType(A_WEIGHT);
       break;
   }
+  AudioNoInterrupts();
+  freqWeightZAC.setSelectedOutput(out);  //feeds the Leq of the level statistics
+  calcLevelBB = detector;
+  mixerLevelOut.gain(0, (detector == &calcLevelZ) ? 1.0f : 0.0f);
+  mixerLevelOut.gain(1, (detector == &calcLevelA) ? 1.0f : 0.0f);
+  mixerLevelOut.gain(2, (detector == &calcLevelC) ? 1.0f : 0.0f);
+  levelStats.setSources(calcLevelBB, &octaveLevels);
+  levelStats.reset();
+  AudioInterrupts();
   return myState.cur_freq_weight = type;
 }
 
+void resetMaxLevels(void) {
+  calcLevelZ.resetMaxLevel(); calcLevelA.resetMaxLevel(); calcLevelC.resetMaxLevel();
+  peakImpulse.resetMaxLevels();
+}
+
 //Set the time averaging.  Options include State::TIME_SLOW and State::TIME_FAST
 int setTimeAveragingType(int type) {
   switch (type) {
     case State::TIME_SLOW:
-      calcLevel1.setTimeConst_sec(TIME_CONST_SLOW);
-      for (int i=0; i < N_FILTER_BANDS; i++) calcLevelPerOct[i].setTimeConst_sec(TIME_CONST_SLOW);
+      calcLevelZ.setTimeConst_sec(TIME_CONST_SLOW); calcLevelA.setTimeConst_sec(TIME_CONST_SLOW); calcLevelC.setTimeConst_sec(TIME_CONST_SLOW);
+      octaveLevels.setTimeConst_sec(TIME_CONST_SLOW);
       break;
     case State::TIME_FAST:
-      calcLevel1.setTimeConst_sec(TIME_CONST_FAST);
-      for (int i=0; i < N_FILTER_BANDS; i++) calcLevelPerOct[i].setTimeConst_sec(TIME_CONST_FAST);
+      calcLevelZ.setTimeConst_sec(TIME_CONST_FAST); calcLevelA.setTimeConst_sec(TIME_CONST_FAST); calcLevelC.setTimeConst_sec(TIME_CONST_FAST);
+      octaveLevels.setTimeConst_sec(TIME_CONST_FAST);
       break;
     default:
       type = State::TIME_SLOW;
-      calcLevel1.setTimeConst_sec(TIME_CONST_SLOW);
-      for (int i=0; i < N_FILTER_BANDS; i++) calcLevelPerOct[i].setTimeConst_sec(TIME_CONST_SLOW);
+      calcLevelZ.setTimeConst_sec(TIME_CONST_SLOW); calcLevelA.setTimeConst_sec(TIME_CONST_SLOW); calcLevelC.setTimeConst_sec(TIME_CONST_SLOW);
+      octaveLevels.setTimeConst_sec(TIME_CONST_SLOW);
       break;
   }
   return myState.cur_time_averaging = type;
 }
+
+//Set octave bands (1) or third-octave bands (3)
+int setBandsPerOctave(int bands_per_octave) {
+  if (bands_per_octave != 3) bands_per_octave = 1;
+  int n_bands = configOctaveBandProcessing(bands_per_octave);  //see AudioConnections.h
+  if (n_bands > 0) {
+    myTympan.print("Octave Analyzer: " + String(n_bands) + " bands from " + String(octaveLevels.getCenterFreq_Hz(0),1));
+    myTympan.println(" Hz to " + String(octaveLevels.getCenterFreq_Hz(n_bands-1),1) + " Hz");
+  }
+  updateBandCorrections();
+  resetLevelStatistics();  //the bands have changed, so start over
+  return myState.bands_per_octave = bands_per_octave;
+}
+
+//Read the mic's calibration table from the SD card.  If there is one, its 1 kHz value becomes the overall
+//calibration and the rest of it gives the per-band corrections.  If not, the hardcoded calibration is used.
+bool loadMicCalibration(void) {
+  if ((!beginSD()) || (!micCalTable.load(&sd, CAL_TABLE_FNAME))) {
+    myTympan.println("loadMicCalibration: no valid " + String(CAL_TABLE_FNAME) + " on the SD card.  Using the default of " + String(mic_cal_dBFS_at94dBSPL_at_0dB_gain,2) + " dBFS at 94 dB SPL.");
+    return false;
+  }
+  mic_cal_dBFS_at94dBSPL_at_0dB_gain = micCalTable.getSensitivityFast_dB(1000.0f);
+  myTympan.println("loadMicCalibration: loaded " + String(micCalTable.getNPoints()) + " points from " + String(CAL_TABLE_FNAME) + ".  At 1 kHz: " + String(mic_cal_dBFS_at94dBSPL_at_0dB_gain,2) + " dBFS at 94 dB SPL.");
+  levelStats.setCalibration_dB(getCalFactor_dB());
+  updateBandCorrections();
+  return true;
+}
+
+//Compute the correction for each octave band from the calibration table.  Call whenever the bands change.
+void updateBandCorrections(void) {
+  int n_bands = octaveLevels.getNBands();
+  float32_t center_Hz[OCTAVE_LEVELS_MAX_BANDS];
+  for (int i=0; i < n_bands; i++) center_Hz[i] = octaveLevels.getCenterFreq_Hz(i);
+  micCalTable.fillBandCorrections_dB(center_Hz, n_bands, 1000.0f, band_corr_dB);  //all zeros if there is no table
+  AudioNoInterrupts();
+  levelStats.setBandCorrections_dB(band_corr_dB, n_bands);
+  AudioInterrupts();
+}
+
+//Measure the CPU cost of the octave analyzer for different numbers of octaves.  Because each octave
+//runs at half the rate of the one above, the cost should level off as octaves are added.
+void benchmarkOctaveAnalyzer(void) {
+  const int n_trials = 16, n_samp = audio_block_samples;
+  static float x[AUDIO_BLOCK_SAMPLES];
+  AudioCalcOctaveLevels_F32 &analyzer = benchOctaveLevels;  //not the one in the audio graph
+  fillBenchmarkNoise(x, n_samp);
+
+  myTympan.println("Octave Analyzer Benchmark: CPU cycles per block of " + String(n_samp) + " samples:");
+  for (int bands_per_octave = 1; bands_per_octave <= 3; bands_per_octave += 2) {
+    float top_center_Hz = (bands_per_octave == 1) ? 8000.0f : 16000.0f;
+    for (int n_octaves = 1; n_octaves <= OCTAVE_LEVELS_MAX_OCTAVES; n_octaves++) {
+      int n_bands = analyzer.setup(bands_per_octave, n_octaves, top_center_Hz);
+      if (n_bands < 0) continue;
+      uint32_t cycles = benchmarkCycles(analyzer, [&](AudioCalcOctaveLevels_F32 &a) { a.processAudio(x, n_samp); },
+                                        n_trials, n_trials);  //fill the decimators first
+
+      myTympan.print("  : 1/" + String(bands_per_octave) + " oct, " + String(n_bands) + " bands: " + String(cycles) + " cycles");
+      myTympan.println(" (" + String(benchmarkPercentCPU(cycles, n_samp, sample_rate_Hz), 2) + "% CPU, " + String(cycles / n_bands) + " per band)");
+    }
+  }
+}
+
+//the separate Z, A, and C weighting filters that the shared network replaces, emulated with the same CMSIS
+//biquads: 3 for A, 2 for C, and a copy for Z.  Only for benchmarkFreqWeighting().
+class SeparateFreqWeightingFilters {
+  public:
+    SeparateFreqWeightingFilters(const AudioSettings_F32 &settings) {
+      //some (stable) biquad coefficients in CMSIS order [b0 b1 b2 -a1 -a2].  The cost does not depend on their values.
+      for (int Istage = 0; Istage < 3; Istage++) {
+        coeff[5*Istage+0] = 0.1f; coeff[5*Istage+1] = 0.0f; coeff[5*Istage+2] = -0.1f;
+        coeff[5*Istage+3] = 1.5f; coeff[5*Istage+4] = -0.8f;
+      }
+      arm_biquad_cascade_df1_init_f32(&biquad_A, 3, coeff, state_A);
+      arm_biquad_cascade_df1_init_f32(&biquad_C, 2, coeff, state_C);
+    }
+    void processAudio(const float *x, float *y_Z, float *y_A, float *y_C, int n) {
+      memcpy(y_Z, x, n * sizeof(x[0]));
+      arm_biquad_cascade_df1_f32(&biquad_A, (float *)x, y_A, n);
+      arm_biquad_cascade_df1_f32(&biquad_C, (float *)x, y_C, n);
+    }
+  protected:
+    float coeff[5 * 3], state_A[4 * 3], state_C[4 * 2];
+    arm_biquad_casd_df1_inst_f32 biquad_A, biquad_C;
+};
+SeparateFreqWeightingFilters benchSeparateFreqWeighting(audio_settings);
+
+//Measure the CPU cost of the shared Z/A/C weighting network versus separate Z, A, and C weighting filters.
+void benchmarkFreqWeighting(void) {
+  const int n_trials = 64, n_samp = audio_block_samples;
+  static float x[AUDIO_BLOCK_SAMPLES], y_Z[AUDIO_BLOCK_SAMPLES], y_A[AUDIO_BLOCK_SAMPLES], y_C[AUDIO_BLOCK_SAMPLES];
+  fillBenchmarkNoise(x, n_samp);
+
+  uint32_t shared_cycles = benchmarkCycles(benchFreqWeightZAC,
+      [&](AudioFilterFreqWeightingZAC_F32 &network) { network.processAudio(x, y_A, y_C, n_samp); }, n_trials);  //Z is passed through for free
+  uint32_t separate_cycles = benchmarkCycles(benchSeparateFreqWeighting,
+      [&](SeparateFreqWeightingFilters &filters) { filters.processAudio(x, y_Z, y_A, y_C, n_samp); }, n_trials);
+
+  myTympan.println("Frequency Weighting Benchmark: CPU cycles per block of " + String(n_samp) + " samples for Z, A, and C:");
+  myTympan.println("  : Shared network (3 biquads) = " + String(shared_cycles) + ", Separate filters (5 biquads + copy) = " + String(separate_cycles));
+}
+
+//Check the true-peak and Impulse detectors against synthetic signals with known answers:
+//  * A sine at fs/4 with a 45 deg phase has samples at only 0.707 of its peak.  The true peak should still be 0 dBFS.
+//  * A single 2 kHz tone burst of length tb should read 10*log10(1 - exp(-tb/35msec)) dB relative to the steady
+//    tone (IEC 61672 tone burst response: -3.6 dB for 20 msec, -8.8 dB for 5 msec, -12.6 dB for 2 msec).
+void checkPeakImpulse(void) {
+  const int n_samp = audio_block_samples;
+  static float x[AUDIO_BLOCK_SAMPLES];
+  AudioCalcPeakImpulse_F32 &detector = benchPeakImpulse;  //not the one in the audio graph
+
+  detector.setup(sample_rate_Hz);
+  float sample_peak = 0.0f;
+  for (int Iblock = 0; Iblock < 32; Iblock++) {
+    if (Iblock == 4) detector.resetMaxLevels();  //skip the interpolator's start-up
+    for (int i = 0; i < n_samp; i++) {
+      x[i] = sinf(2.0f * PI * 0.25f * ((float)(Iblock * n_samp + i)) + 0.25f * PI);
+      if (Iblock >= 4) sample_peak = max(sample_peak, fabsf(x[i]));
+    }
+    detector.processAudio(x, x, n_samp);
+  }
+  myTympan.print("True Peak: sine at fs/4: sample peak = " + String(20.0f * log10f(sample_peak),2) + " dBFS");
+  myTympan.println(", true peak = " + String(detector.getMaxTruePeak_dB(),2) + " dBFS (expected 0.0)");
+
+  const int n_bursts = 3;
+  const float burst_sec[n_bursts] = {0.020f, 0.005f, 0.002f};
+  for (int Iburst = 0; Iburst < n_bursts; Iburst++) {
+    detector.reset();
+    int n_burst = (int)(burst_sec[Iburst] * sample_rate_Hz + 0.5f);
+    for (int Iblock = 0; Iblock * n_samp < (int)sample_rate_Hz; Iblock++) {  //one second
+      for (int i = 0; i < n_samp; i++) {
+        int k = Iblock * n_samp + i;
+        x[i] = (k < n_burst) ? sinf(2.0f * PI * 2000.0f * ((float)k) / sample_rate_Hz) : 0.0f;
+      }
+      detector.processAudio(x, x, n_samp);
+    }
+    float steady_dB = 10.0f * log10f(0.5f);  //level of the steady tone
+    float expected_dB = 10.0f * log10f(1.0f - expf(-burst_sec[Iburst] / PEAK_IMPULSE_RISE_SEC));
+    myTympan.print("Impulse: " + String(1000.0f * burst_sec[Iburst],0) + " msec tone burst: LImax - L = " + String(detector.getMaxImpulseLevel_dB() - steady_dB,2));
+    myTympan.println(" dB (expected " + String(expected_dB,2) + ")");
+  }
+}
+
+// ///////////////// Level statistics
+
+//start the SD card (only once...it is shared by the statistics and the level logger)
+bool beginSD(void) {
+  static bool is_begun = false;
+  if (!is_begun) is_begun = sd.begin(SdioConfig(FIFO_SDIO));
+  return is_begun;
+}
+
+//At the end of each interval, pack the statistics into a binary record, write it to SD (if enabled), and start the next interval
+void serviceLevelStatistics(unsigned long curTime_millis) {
+  static unsigned long lastUpdate_millis = 0;
+  if (curTime_millis < lastUpdate_millis) lastUpdate_millis = 0; //handle wrap-around of the clock
+  if ((curTime_millis - lastUpdate_millis) < (unsigned long)(1000.0f * myState.stats_interval_sec)) return;
+  lastUpdate_millis = curTime_millis;
+
+  static uint8_t record[LEVEL_STATS_MAX_RECORD_BYTES];
+  AudioNoInterrupts();  //don't let the audio update the statistics while we read and reset them
+  int n_bytes = levelStats.fillRecord(record, LEVEL_STATS_MAX_RECORD_BYTES, curTime_millis, myState.cur_freq_weight, myState.cur_time_averaging);
+  levelStats.resetInterval();
+  AudioInterrupts();
+
+  if (myState.enable_logStatsToSD && statsFile.isOpen() && (n_bytes > 0)) {
+    if (statsFile.write(record, n_bytes) != (size_t)n_bytes) {
+      myTympan.println("serviceLevelStatistics: *** ERROR ***: failed to write to " + String(STATS_FNAME) + ".  Stopping.");
+      enableLogStatsToSD(false);
+      return;
+    }
+    statsFile.flush();  //one small write per interval, so flush it so that nothing is lost if the power is cut
+  }
+}
+
+//open (or close) the statistics file on the SD card.  New records are appended to the end of the file.
+bool enableLogStatsToSD(bool enable) {
+  if (enable && !statsFile.isOpen()) {
+    if (!beginSD()) {
+      myTympan.println("enableLogStatsToSD: *** ERROR ***: cannot open the SD card.");
+      return myState.enable_logStatsToSD = false;
+    }
+    if (!statsFile.open(STATS_FNAME, O_RDWR | O_CREAT | O_APPEND)) {
+      myTympan.println("enableLogStatsToSD: *** ERROR ***: cannot open " + String(STATS_FNAME));
+      return myState.enable_logStatsToSD = false;
+    }
+    myTympan.println("enableLogStatsToSD: appending a record every " + String(myState.stats_interval_sec,0) + " sec to " + String(STATS_FNAME));
+  } else if (!enable && statsFile.isOpen()) {
+    statsFile.close();
+    myTympan.println("enableLogStatsToSD: closed " + String(STATS_FNAME));
+  }
+  return myState.enable_logStatsToSD = enable;
+}
+
+//step through the available statistics intervals
+float incrementStatsInterval(void) {
+  const int n_intervals = 5;
+  const float intervals_sec[n_intervals] = {10.0f, 60.0f, 300.0f, 900.0f, 3600.0f};
+  int ind = 0;
+  while ((ind < n_intervals) && (intervals_sec[ind] <= myState.stats_interval_sec)) ind++;
+  return myState.stats_interval_sec = intervals_sec[ind % n_intervals];
+}
+
+void resetLevelStatistics(void) {
+  AudioNoInterrupts();
+  levelStats.reset();
+  AudioInterrupts();
+}
+
+//print the statistics of the current interval (so far)
+void printLevelStatistics(void) {
+  int n_levels = levelStats.getNLevels();
+  myTympan.println("Level Statistics: " + String(levelStats.getStats(0).getInterval_sec(),1) + " sec into the " + String(myState.stats_interval_sec,0) + " sec interval (dB SPL):");
+  for (int Ilevel = 0; Ilevel < n_levels; Ilevel++) {
+    LevelStatistics &s = levelStats.getStats(Ilevel);
+    if (Ilevel == 0) {
+      myTympan.print("    : Broadband: ");
+    } else {
+      myTympan.print("    : " + String(octaveLevels.getCenterFreq_Hz(Ilevel-1),0) + " Hz: ");
+    }
+    myTympan.print("Leq = " + String(s.getLeq_dB(),1) + ", Lmax = " + String(s.getLmax_dB(),1));
+    myTympan.println(", L10/L50/L90 = " + String(s.getPercentileLevel_dB(10.0f),1) + "/" + String(s.getPercentileLevel_dB(50.0f),1) + "/" + String(s.getPercentileLevel_dB(90.0f),1));
+  }
+  float cal_factor_dB = getCalFactor_dB();
+  myTympan.print("    : Now: LZ = " + String(calcLevelZ.getCurrentLevel_dB() + cal_factor_dB,1) + ", LA = " + String(calcLevelA.getCurrentLevel_dB() + cal_factor_dB,1));
+  myTympan.println(", LC = " + String(calcLevelC.getCurrentLevel_dB() + cal_factor_dB,1));
+  myTympan.print("    : Impulsive: LCpeak = " + String(peakImpulse.getMaxTruePeak_dB() + cal_factor_dB,1));
+  myTympan.println(", LAI = " + String(peakImpulse.getImpulseLevel_dB() + cal_factor_dB,1) + ", LAImax = " + String(peakImpulse.getMaxImpulseLevel_dB() + cal_factor_dB,1) + " (since the max was reset)");
+  LevelStatistics &bb = levelStats.getStats(0);
+  myTympan.println("    : Broadband over " + String(bb.getTotal_sec()/60.0f,1) + " min: Leq = " + String(bb.getTotalLeq_dB(),1) + ", Dose = " + String(bb.getDose_percent(),2) + "%");
+}
+
+// ///////////////// Continuous level logging
+
+//Every logging interval, get the Leq of each level over the interval and add them to the log
+void serviceLevelLogger(unsigned long curTime_millis) {
+  static unsigned long nextLog_millis = 0;
+  static int session_config[4] = {-1, -1, -1, -1};
+  static float levels_dB[LEVEL_LOG_MAX_LEVELS];
+  if (!levelLogger.isLogging()) return;
+
+  //start a new session if the settings have changed (or if this is the first time)
+  int n_levels = min(LEVEL_LOG_MAX_LEVELS, levelStats.getNLevels());
+  int config[4] = {n_levels, octaveLevels.getBandsPerOctave(), myState.cur_freq_weight, myState.cur_time_averaging};
+  if ((!levelLogger.hasSession()) || (memcmp(config, session_config, sizeof(config)) != 0)) {
+    float top_center_Hz = octaveLevels.getCenterFreq_Hz(octaveLevels.getNBands()-1);
+    levelLogger.beginSession(curTime_millis, n_levels, config[1], top_center_Hz, config[2], config[3]);
+    memcpy(session_config, config, sizeof(config));
+    AudioNoInterrupts(); levelStats.resetLogInterval(); AudioInterrupts();
+    nextLog_millis = curTime_millis + levelLogger.getInterval_msec();
+    return;
+  }
+
+  //is it time to log?
+  if ((long)(curTime_millis - nextLog_millis) < 0) return;
+  nextLog_millis += levelLogger.getInterval_msec();
+  if ((long)(curTime_millis - nextLog_millis) > 0) nextLog_millis = curTime_millis + levelLogger.getInterval_msec();  //fell behind, so don't try to catch up
+
+  AudioNoInterrupts();  //don't let the audio update the accumulators while we read and reset them
+  for (int i=0; i < n_levels; i++) levels_dB[i] = levelStats.getLogLeq_dB(i);
+  levelStats.resetLogInterval();
+  AudioInterrupts();
+
+  if (!levelLogger.addLevels(curTime_millis, levels_dB, n_levels)) {
+    myTympan.println("serviceLevelLogger: *** ERROR ***: failed to write to " + String(LEVEL_LOG_FNAME) + ".  Stopping.");
+    enableLevelLogger(false);
+  }
+}
+
+bool enableLevelLogger(bool enable) {
+  if (enable && !levelLogger.isLogging()) {
+    levelLogger.setInterval_msec(myState.level_log_interval_msec);
+    if ((!beginSD()) || (!levelLogger.open(LEVEL_LOG_FNAME))) {
+      myTympan.println("enableLevelLogger: *** ERROR ***: cannot open " + String(LEVEL_LOG_FNAME) + " on the SD card.");
+      return myState.enable_levelLogger = false;
+    }
+    myTympan.println("enableLevelLogger: appending levels every " + String(levelLogger.getInterval_msec()) + " msec to " + String(LEVEL_LOG_FNAME));
+  } else if (!enable && levelLogger.isLogging()) {
+    levelLogger.close();
+    myTympan.println("enableLevelLogger: closed " + String(LEVEL_LOG_FNAME) + " (" + String(levelLogger.getBlocksWritten()) + " blocks in the file)");
+  }
+  return myState.enable_levelLogger = enable;
+}
+
+//step through the available logging intervals.  If logging, the new interval starts with a new session.
+int incrementLevelLogInterval(void) {
+  const int n_intervals = 4;
+  const int intervals_msec[n_intervals] = {125, 250, 500, 1000};
+  int ind = 0;
+  while ((ind < n_intervals) && (intervals_msec[ind] <= myState.level_log_interval_msec)) ind++;
+  myState.level_log_interval_msec = intervals_msec[ind % n_intervals];
+  if (levelLogger.isLogging()) { enableLevelLogger(false); enableLevelLogger(true); }
+  return myState.level_log_interval_msec;
+}
@@ -12,12 +12,23 @@ class State : public TympanStateBase_UI {  // look in TympanStateBase for more s
 
     bool enable_printOctaveToBLE=true;
 
-    enum FREQ_WEIGHT {FREQ_A_WEIGHT=0, FREQ_C_WEIGHT};
+    bool enable_binaryLevelFrames=false;    //send the levels as binary frames (see LevelTelemetryFrame.h) instead of text
+    unsigned long level_update_millis=1000; //how often to send the levels
+
+    enum FREQ_WEIGHT {FREQ_A_WEIGHT=0, FREQ_C_WEIGHT, FREQ_Z_WEIGHT};
     int cur_freq_weight = FREQ_A_WEIGHT; //default
     
     enum TIME_WEIGHT {TIME_SLOW=0, TIME_FAST};
     int cur_time_averaging = TIME_SLOW;  //default
 
+    int bands_per_octave = 1;  //1 = octave bands, 3 = third-octave bands
+
+    float stats_interval_sec = 60.0f;   //interval for the Leq, Lmax, and L10/L50/L90 statistics
+    bool enable_logStatsToSD = false;   //write the statistics to the SD card at the end of each interval
+
+    bool enable_levelLogger = false;    //continuously log the levels to the SD card (see LevelLogger.h)
+    int level_log_interval_msec = 1000; //125 to 1000 msec
+
 };
 
 #endif
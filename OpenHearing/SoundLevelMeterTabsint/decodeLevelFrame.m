@@ -0,0 +1,55 @@
+%% function frame = decodeLevelFrame(msg)
+% Decode a binary level frame sent by SoundLevelMeterTabsint (see LevelTelemetryFrame.h).
+%
+% msg can be the base64 text printed to USB (such as 'TB=AQcBAAUA...'), or the bytes received over BLE (uint8),
+% which are 'TB=' followed by the raw frame.
+%
+% The returned frame has the fields: version, seq, bands_per_octave, freq_weight ('A', 'C', or 'Z'),
+% time_weight ('SLOW' or 'FAST'), cur_dB, max_dB, and band_dB (lowest band first).  All levels are dB SPL.
+%
+% To check for dropped frames, compare the seq of consecutive frames: mod(seq - prev_seq, 65536) should be 1.
+
+function frame = decodeLevelFrame(msg)
+
+if ischar(msg) || isstring(msg)
+    msg = char(msg);
+    if strncmp(msg, 'TB=', 3)
+        msg = msg(4:end);
+    end
+    bytes = uint8(matlab.net.base64decode(strtrim(msg)));
+else
+    bytes = uint8(msg(:)');
+    if numel(bytes) >= 3 && isequal(bytes(1:3), uint8('TB='))
+        bytes = bytes(4:end);
+    end
+end
+
+header_bytes = 6;
+if numel(bytes) < header_bytes
+    error('decodeLevelFrame: frame is too short (%d bytes)', numel(bytes));
+end
+
+frame.version = double(bytes(1));
+if frame.version ~= 1
+    error('decodeLevelFrame: unknown frame version %d', frame.version);
+end
+n_bands = double(bytes(2));
+frame.bands_per_octave = double(bytes(3));
+flags = double(bytes(4));
+weights = 'ACZ';
+frame.freq_weight = weights(min(bitand(flags, 3), 2) + 1);
+if bitand(flags, 4)
+    frame.time_weight = 'FAST';
+else
+    frame.time_weight = 'SLOW';
+end
+frame.seq = double(typecast(bytes(5:6), 'uint16'));
+
+n_vals = 2 + n_bands;
+if numel(bytes) < header_bytes + 2*n_vals
+    error('decodeLevelFrame: expected %d bytes but got %d', header_bytes + 2*n_vals, numel(bytes));
+end
+vals = 0.1 * double(typecast(bytes(header_bytes + (1:2*n_vals)), 'int16'));
+frame.cur_dB = vals(1);
+frame.max_dB = vals(2);
+frame.band_dB = vals(3:end);
@@ -0,0 +1,152 @@
+%% function [t, levels, info] = readLevelLog(fname, start_time, duration_hours)
+% Read the levels logged by SoundLevelMeterTabsint (see LevelLogger.h) from a LEVELLOG.BIN file.
+%
+% The file is made of 512-byte blocks that each start with the time of their first record.  So, this finds
+% start_time with a binary search over the block headers and then reads only the blocks that are needed.
+% It does not matter how long (how many days) the file is.
+%
+% Inputs:
+%   fname: the log file (such as 'LEVELLOG.BIN')
+%   start_time: (optional) datetime at which to start reading.  Default is the start of the file.
+%   duration_hours: (optional) how much to read.  Default is 1 hour.
+%
+% Outputs:
+%   t: datetime of each set of levels
+%   levels: the levels (dB SPL).  One row per time.  Column 1 is broadband.  The rest are the bands, lowest first.
+%   info: settings at the start_time: interval_msec, bands_per_octave, center_Hz, freq_weight, time_weight
+%
+% Example: read 1 hour of levels, starting at 2pm on the second day of the log
+%   [t, levels, info] = readLevelLog('LEVELLOG.BIN', datetime(2024,6,11,14,0,0), 1.0);
+%   plot(t, levels(:,1)); ylabel('Broadband Level (dB SPL)');
+
+function [t, levels, info] = readLevelLog(fname, start_time, duration_hours)
+
+if nargin < 3
+    duration_hours = 1.0;
+end
+
+block_bytes = 512;
+header_bytes = 20;
+
+fid = fopen(fname, 'r', 'ieee-le');
+if fid < 0
+    error('readLevelLog: cannot open %s', fname);
+end
+cleanup = onCleanup(@() fclose(fid));
+fseek(fid, 0, 'eof');
+n_blocks = floor(ftell(fid) / block_bytes);
+if n_blocks == 0
+    error('readLevelLog: %s has no complete blocks', fname);
+end
+
+% find the first block that starts at (or before) the start time
+if (nargin < 2) || isempty(start_time)
+    first_block = 0;
+    start_sec = -Inf;
+else
+    start_sec = posixtime(start_time);
+    lo = 0; hi = n_blocks - 1;
+    first_block = 0;
+    while lo <= hi
+        mid = floor((lo + hi) / 2);
+        blk = nextBlockWithTime(fid, mid, n_blocks, block_bytes);
+        if isempty(blk) || (blk.time_sec > start_sec)
+            hi = mid - 1;
+        else
+            first_block = blk.block_ind;
+            lo = blk.block_ind + 1;
+        end
+    end
+end
+end_sec = start_sec + 3600 * duration_hours;
+if isinf(start_sec)
+    end_sec = Inf;
+end
+
+% read the blocks until we pass the end time
+t_sec = []; levels = [];
+info = struct('interval_msec', NaN, 'bands_per_octave', NaN, 'center_Hz', [], 'freq_weight', '', 'time_weight', '');
+for Iblock = first_block:(n_blocks - 1)
+    fseek(fid, Iblock * block_bytes, 'bof');
+    block = fread(fid, block_bytes, '*uint8')';
+    if typecast(block(1:2), 'uint16') ~= hex2dec('4C4C')
+        warning('readLevelLog: block %d has a bad header.  Skipping.', Iblock);
+        continue;
+    end
+    if isempty(info.center_Hz)
+        info = infoFromHeader(info, double(block(16)), typecast(block(17:20), 'single'), double(block(15)));
+    end
+
+    ind = header_bytes + 1;
+    sec = -Inf;
+    while ind + 1 <= block_bytes
+        rec_type = char(block(ind)); rec_len = double(block(ind + 1));
+        if (block(ind) == 0) || (rec_len < 2) || (ind + rec_len - 1 > block_bytes)
+            break;  % rest of the block is unused
+        end
+        rec = block(ind:(ind + rec_len - 1));
+        sec = double(typecast(rec(3:6), 'uint32')) + 0.001 * double(typecast(rec(7:8), 'uint16'));
+        switch rec_type
+            case 'S'
+                if (sec <= start_sec) || isnan(info.interval_msec)
+                    info.interval_msec = double(typecast(rec(9:10), 'uint16'));
+                    weights = 'ACZ'; time_weights = {'SLOW', 'FAST'};
+                    info.freq_weight = weights(min(double(rec(13)), 2) + 1);
+                    info.time_weight = time_weights{min(double(rec(14)), 1) + 1};
+                    info = infoFromHeader(info, double(rec(12)), typecast(rec(15:18), 'single'), double(rec(11)));
+                end
+            case 'L'
+                if sec > end_sec
+                    break;
+                end
+                if sec >= start_sec
+                    vals = 0.1 * double(typecast(rec(9:end), 'int16'));
+                    if ~isempty(levels) && (numel(vals) ~= size(levels, 2))
+                        warning('readLevelLog: the number of bands changed at %s.  Stopping there.', ...
+                            datestr(datetime(sec, 'ConvertFrom', 'posixtime')));
+                        end_sec = -Inf;
+                        break;
+                    end
+                    t_sec(end+1, 1) = sec;
+                    levels(end+1, :) = vals;
+                end
+        end
+        ind = ind + rec_len;
+    end
+    if sec > end_sec
+        break;
+    end
+end
+t = datetime(t_sec, 'ConvertFrom', 'posixtime');
+if isnan(info.interval_msec) && (numel(t_sec) > 1)
+    % the session record was before the blocks that we read, so estimate the interval from the times
+    info.interval_msec = round(1000 * median(diff(t_sec)));
+end
+
+end
+
+% ------------------------------------------------------------------
+% return the header of the first block at or after block_ind that has a time (or [] if none)
+function blk = nextBlockWithTime(fid, block_ind, n_blocks, block_bytes)
+blk = [];
+while block_ind < n_blocks
+    fseek(fid, block_ind * block_bytes + 8, 'bof');
+    sec = fread(fid, 1, 'uint32');
+    msec = fread(fid, 1, 'uint16');
+    if sec > 0
+        blk.block_ind = block_ind;
+        blk.time_sec = sec + 0.001 * msec;
+        return;
+    end
+    block_ind = block_ind + 1;
+end
+end
+
+% ------------------------------------------------------------------
+% band center frequencies (base-2, lowest first), matching AudioCalcOctaveLevels_F32
+function info = infoFromHeader(info, bands_per_octave, top_center_Hz, n_levels)
+info.bands_per_octave = bands_per_octave;
+n_bands = n_levels - 1;
+k = (n_bands - 1):-1:0;
+info.center_Hz = double(top_center_Hz) * 2.^(-k / bands_per_octave);
+end
@@ -0,0 +1,241 @@
+
+#ifndef AnalysisFFT_h
+#define AnalysisFFT_h
+
+#include <arm_math.h>
+#include <arm_const_structs.h>   //for the arm_cfft_sR_f32_lenXXX instances
+#include <utility/BTNRH_rfft.h>  //Tympan_Library FFT routine (generic C, not ARM-specific)
+
+// AnalysisFFT:
+//
+// FFT "backends" for the analysis paths (such as AudioPath_Sine_wFFT).  Each one does the whole analysis step in
+// one call: window the N real samples, FFT them, and divide by N.  The result is N/2+1 interleaved complex values
+// (N+2 floats), which is the same format as BTNRH_FFT::cha_fft_rc.
+//
+// The input can be read from a circular buffer of length N (such as a rolling window), starting at start_ind.  For
+// an ordinary buffer, use start_ind = 0.  In that case, the output can be the same memory as the input.
+//
+// The same work can also be split into steps, so that it can be spread across several calls to loop(): call begin()
+// and then call step() until it returns 0.  For the staged version, the input is a circular buffer of any length
+// (at least N) and it must not be the output.  The input must not change until the last step is done.
+//
+//   * AnalysisFFT_CMSIS: does the real FFT as a half-length complex FFT (CMSIS arm_cfft_f32, which is optimized for
+//     the Teensy's ARM processor), followed by one pass that splits out the real spectrum.  The window is applied as
+//     the data is packed for the complex FFT and the 1/N is folded into the split pass.  The split twiddles are
+//     computed once, in setup().  Works for N = 32 to 8192.  (This is what arm_rfft_fast_f32 does inside, but that
+//     only goes up to N = 4096 in the Teensy's version of CMSIS.)  When staged, the half-length complex FFT is itself
+//     split into four quarter-length FFTs and two radix-2 passes that join them, so no step does more than about
+//     a quarter of the FFT (8 steps in all).
+//   * AnalysisFFT_BTNRH: BTNRH_FFT::cha_fft_rc, with separate window and normalize loops.  Works for any power of 2.
+//     When staged, it does all of the work in one step.
+//
+// On a PC, HostSim/AnalysisFFT_SplitRadix.h adds a third backend with this same interface: a split-radix FFT that
+// uses the host's SIMD.  HostSim/simFftBackends.cpp benchmarks all three for N = 256 to 16384.
+//
+class AnalysisFFT_Base {
+  public:
+    virtual ~AnalysisFFT_Base() {}
+    virtual const char* getName(void) = 0;
+    virtual bool isSupported(int _N) = 0;
+    int getN(void) { return N; }
+
+    //window (can be NULL for none), FFT, and normalize.  Returns zero if OK.
+    virtual int execute(const float *input, int start_ind, const float *window, float *output) = 0;
+
+    //the staged version of execute().  The input is a circular buffer of input_len samples.  Returns zero if OK.
+    virtual int begin(const float *input, int input_len, int start_ind, const float *window, float *output) {
+      if ((N == 0) || (input_len < N) || (start_ind < 0) || (start_ind >= input_len) || (input == output)) return -1;
+      stage_input = input; stage_input_len = input_len; stage_start_ind = start_ind;
+      stage_window = window; stage_output = output; stage = 0;
+      return 0;
+    }
+    //do the next step.  Returns 1 if there are more steps, 0 if done, or -1 on error (or if begin() wasn't called)
+    virtual int step(void) {
+      if (stage_input == NULL) return -1;
+      copyWithWindow(stage_input, stage_start_ind, stage_window, stage_output, stage_input_len);
+      stage_input = NULL;
+      return execute(stage_output, 0, NULL, stage_output);  //by default, everything else is done in this one step
+    }
+    virtual int getNumSteps(void) { return 1; }
+    void abort(void) { stage_input = NULL; }  //forget the staged FFT (such as when the input is no longer valid)
+
+  protected:
+    int N = 0;
+
+    //the staged FFT
+    const float *stage_input = NULL, *stage_window = NULL;
+    float *stage_output = NULL;
+    int stage_input_len = 0, stage_start_ind = 0, stage = 0;
+
+    //copy N samples out of the circular buffer of input_len samples (N if zero), oldest first, applying the window
+    void copyWithWindow(const float *input, int start_ind, const float *window, float *output, int input_len = 0) {
+      if (input_len <= 0) input_len = N;
+      int n_first = min(N, input_len - start_ind);  //samples before the wrap-around
+      if (window != NULL) {
+        for (int I=0; I < n_first; I++) output[I] = input[start_ind + I] * window[I];
+        for (int I=n_first; I < N; I++) output[I] = input[I - n_first] * window[I];
+      } else if (output != input) {
+        for (int I=0; I < n_first; I++) output[I] = input[start_ind + I];
+        for (int I=n_first; I < N; I++) output[I] = input[I - n_first];
+      }
+    }
+};
+
+
+class AnalysisFFT_BTNRH : public AnalysisFFT_Base {
+  public:
+    virtual const char* getName(void) { return "BTNRH"; }
+    virtual bool isSupported(int _N) { return (_N >= 2) && ((_N & (_N-1)) == 0); }
+    bool setup(int _N) {
+      if (!isSupported(_N)) { N = 0; return false; }
+      N = _N;
+      return true;
+    }
+
+    virtual int execute(const float *input, int start_ind, const float *window, float *output) {
+      if ((N == 0) || ((input == output) && (start_ind != 0))) return -1;
+      copyWithWindow(input, start_ind, window, output);
+      BTNRH_FFT::cha_fft_rc(output, N);  //results are in-place
+      const float scale = 1.0f / (float)N;
+      for (int I=0; I < N+2; I++) output[I] *= scale;
+      return 0;
+    }
+};
+
+
+class AnalysisFFT_CMSIS : public AnalysisFFT_Base {
+  public:
+    virtual const char* getName(void) { return "CMSIS"; }
+    virtual bool isSupported(int _N) { return getCfftInstance(_N/2) != NULL; }
+    static int getTwiddleLength(int _N) { return 2*(_N/4 + 1); }  //number of floats that setup() needs for the twiddles
+
+    //set up for the given N, using the given memory (of length getTwiddleLength(N)) for the twiddles
+    bool setup(int _N, float *twiddle_memory) {
+      cfft = getCfftInstance(_N/2);
+      if ((cfft == NULL) || (twiddle_memory == NULL)) { N = 0; return false; }
+      N = _N;
+      twiddle = twiddle_memory;
+      sub_cfft = getCfftInstance(N/2 / N_SUB);  //for the staged FFT
+      for (int k=0; k <= N/4; k++) {
+        double w = 2.0 * M_PI * (double)k / (double)N;
+        twiddle[2*k] = (float)cos(w); twiddle[2*k+1] = (float)sin(w);
+      }
+      return true;
+    }
+
+    virtual int execute(const float *input, int start_ind, const float *window, float *output) {
+      if ((N == 0) || ((input == output) && (start_ind != 0))) return -1;
+
+      //window the data and pack it as N/2 complex values: z[n] = x[2n] + j x[2n+1].  This is the same layout in memory.
+      copyWithWindow(input, start_ind, window, output);
+      arm_cfft_f32(cfft, output, 0, 1);  //forward complex FFT, in-place
+      splitRealSpectrum(output);
+      return 0;
+    }
+
+    //Staged: 1) window and pack the data, in the order needed by the quarter-length FFTs, 2-5) one quarter-length
+    //complex FFT per step, 6-7) one radix-2 pass per step to join them into the half-length FFT, 8) the real split.
+    virtual int getNumSteps(void) { return (sub_cfft != NULL) ? (1 + N_SUB + N_JOIN_PASSES + 1) : 1; }
+    virtual int step(void) {
+      if (stage_input == NULL) return -1;
+      if (sub_cfft == NULL) return AnalysisFFT_Base::step();  //too short to split
+      const int Nc = N/2, M = Nc / N_SUB;  //complex lengths of the whole FFT and of each quarter
+      if (stage == 0) {
+        packForSubFFTs(M);
+      } else if (stage <= N_SUB) {
+        arm_cfft_f32(sub_cfft, stage_output + 2*M*(stage-1), 0, 1);  //forward complex FFT, in-place
+      } else if (stage <= N_SUB + N_JOIN_PASSES) {
+        joinSubFFTs(M << (stage - N_SUB));  //the first pass makes FFTs of length 2M, the second of length 4M = Nc
+      } else {
+        splitRealSpectrum(stage_output);
+        stage_input = NULL;
+        return 0;  //done
+      }
+      stage++;
+      return 1;
+    }
+
+  protected:
+    static const int N_SUB = 4, N_JOIN_PASSES = 2;  //quarter-length FFTs (and the radix-2 passes that join them) for the staged FFT
+    const arm_cfft_instance_f32 *cfft = NULL;
+    const arm_cfft_instance_f32 *sub_cfft = NULL;    //NULL if N is too short to split
+    float *twiddle = NULL;  //cos and sin of 2 pi k / N, for k = 0 to N/4
+
+    //cos and sin of 2 pi m / N for m = 0 to N/2, from the quarter-wave twiddles
+    void getTwiddle(int m, float *c, float *s) {
+      if (m <= N/4) { *c = twiddle[2*m]; *s = twiddle[2*m+1]; }
+      else { *c = -twiddle[2*(N/2-m)]; *s = twiddle[2*(N/2-m)+1]; }
+    }
+
+    //split the (normalized) half-length complex FFT into the real FFT, working from both ends so that it can be in-place:
+    //  X[k] = E - j W^k O,  where E = (Z[k] + conj(Z[N/2-k]))/2,  O = (Z[k] - conj(Z[N/2-k]))/2,  W = exp(-j 2 pi / N)
+    void splitRealSpectrum(float *output) {
+      const float scale = 1.0f / (float)N;
+      float zr = output[0], zi = output[1];
+      output[0] = (zr + zi) * scale;  output[1] = 0.0f;  //DC
+      output[N] = (zr - zi) * scale;  output[N+1] = 0.0f; //Nyquist
+      const float half_scale = 0.5f * scale;
+      for (int k=1; k <= N/4; k++) {
+        const int k2 = N/2 - k;
+        float a = output[2*k], b = output[2*k+1], c = output[2*k2], d = output[2*k2+1];
+        float Er = half_scale * (a + c), Ei = half_scale * (b - d);
+        float Or = half_scale * (a - c), Oi = half_scale * (b + d);
+        float cw = twiddle[2*k], sw = twiddle[2*k+1];
+        float Pr = cw * Or + sw * Oi, Pi = cw * Oi - sw * Or;  //P = W^k O
+        output[2*k]  = Er + Pi;  output[2*k+1]  = Ei - Pr;     //X[k]
+        output[2*k2] = Er - Pi;  output[2*k2+1] = -Ei - Pr;    //X[N/2-k] (the same as X[k] when k = N/4)
+      }
+    }
+
+    //window and pack the staged input as complex values z[n] = x[2n] + j x[2n+1], with quarter b holding z[r + 4m]
+    //(m = 0 to M-1), where r is b with its two bits reversed.  That is the order that joinSubFFTs() needs.
+    void packForSubFFTs(const int M) {
+      static const int bit_reversed[N_SUB] = {0, 2, 1, 3};
+      for (int b = 0; b < N_SUB; b++) {
+        float *out = stage_output + 2*M*b;
+        int I = 2*bit_reversed[b];                           //the sample (counting from the oldest) for z[r]
+        int Iring = stage_start_ind + I;                     //...and where it is in the circular buffer
+        if (Iring >= stage_input_len) Iring -= stage_input_len;
+        for (int m = 0; m < M; m++) {
+          int Iring2 = Iring + 1;  if (Iring2 >= stage_input_len) Iring2 = 0;
+          float w0 = 1.0f, w1 = 1.0f;
+          if (stage_window != NULL) { w0 = stage_window[I]; w1 = stage_window[I+1]; }
+          out[2*m] = w0 * stage_input[Iring];  out[2*m+1] = w1 * stage_input[Iring2];
+          I += 2*N_SUB;  Iring += 2*N_SUB;  if (Iring >= stage_input_len) Iring -= stage_input_len;
+        }
+      }
+    }
+
+    //one radix-2 decimation-in-time pass: join pairs of neighboring FFTs of length len/2 into FFTs of length len
+    void joinSubFFTs(const int len) {
+      const int half = len / 2, m_step = N / len;  //W_len^k = exp(-j 2 pi k m_step / N)
+      const int Nc = N/2;
+      for (int start = 0; start < Nc; start += len) {
+        float *A = stage_output + 2*start, *B = A + 2*half;
+        for (int k = 0; k < half; k++) {
+          float c, s;  getTwiddle(k * m_step, &c, &s);
+          float Tr = c * B[2*k] + s * B[2*k+1], Ti = c * B[2*k+1] - s * B[2*k];  //T = W^k B, with W^k = c - j s
+          float Ar = A[2*k], Ai = A[2*k+1];
+          A[2*k] = Ar + Tr;  A[2*k+1] = Ai + Ti;
+          B[2*k] = Ar - Tr;  B[2*k+1] = Ai - Ti;
+        }
+      }
+    }
+
+    static const arm_cfft_instance_f32* getCfftInstance(int N_cmplx) {
+      switch (N_cmplx) {
+        case 16:   return &arm_cfft_sR_f32_len16;
+        case 32:   return &arm_cfft_sR_f32_len32;
+        case 64:   return &arm_cfft_sR_f32_len64;
+        case 128:  return &arm_cfft_sR_f32_len128;
+        case 256:  return &arm_cfft_sR_f32_len256;
+        case 512:  return &arm_cfft_sR_f32_len512;
+        case 1024: return &arm_cfft_sR_f32_len1024;
+        case 2048: return &arm_cfft_sR_f32_len2048;
+        case 4096: return &arm_cfft_sR_f32_len4096;
+      }
+      return NULL;
+    }
+};
+
+#endif
@@ -0,0 +1,65 @@
+
+#ifndef AudioPathArena_h
+#define AudioPathArena_h
+
+#include <new>      //for placement new
+#include <utility>  //for std::forward
+
+// AudioPathArena:
+//
+// A fixed block of memory (such as a static array) from which the AudioPaths, their audio objects, their audio
+// connections, and their buffers are all created at boot.  Memory is handed out in order and is never given back.
+//
+// That matches how AudioStream works anyway.  AudioStream keeps a pointer to every instance that is ever created
+// (see the note in AudioPath_Base.h), so audio objects must never be destroyed.  Building them in an arena (rather
+// than with new) means that nothing is ever taken from the heap, and so the heap cannot grow or fragment no matter
+// how often the user switches between AudioPaths.
+//
+// Usage:
+//   DMAMEM uint8_t arenaMemory[64*1024] __attribute__ ((aligned (8)));       //on the Teensy 4, DMAMEM is in RAM2
+//   AudioPathArena arena(arenaMemory, sizeof(arenaMemory));
+//   AudioMixer8_F32 *mixer = arena.create<AudioMixer8_F32>(audio_settings);  //instead of "new AudioMixer8_F32(audio_settings)"
+//
+class AudioPathArena {
+  public:
+    AudioPathArena(uint8_t *_memory, size_t _n_bytes) : memory(_memory), n_bytes_total(_n_bytes) {}
+
+    //get the given number of bytes with the given alignment (returns NULL if the arena is full)
+    void* allocate(size_t n_bytes, size_t alignment = 8) {
+      size_t start = ((n_bytes_used + alignment - 1) / alignment) * alignment;
+      if (start + n_bytes > n_bytes_total) {
+        Serial.println("AudioPathArena: allocate: *** ERROR ***: Out of memory (need " + String((int)n_bytes) + " bytes, have " + String((int)getBytesFree()) + ").  Make the arena bigger.");
+        return NULL;
+      }
+      n_bytes_used = start + n_bytes;
+      return (void *)(memory + start);
+    }
+
+    //construct an object in the arena (returns NULL if the arena is full)
+    template <class T, typename... Args>
+    T* create(Args&&... args) {
+      void *ptr = allocate(sizeof(T), alignof(T));
+      if (ptr == NULL) return NULL;
+      return new (ptr) T(std::forward<Args>(args)...);
+    }
+
+    //get an array of n values, set to zero (returns NULL if the arena is full)
+    template <class T>
+    T* createArray(int n) {
+      T *ptr = (T *)allocate(n * sizeof(T), alignof(T));
+      if (ptr == NULL) return NULL;
+      for (int i=0; i < n; i++) new (ptr + i) T();
+      return ptr;
+    }
+
+    size_t getBytesUsed(void) { return n_bytes_used; }
+    size_t getBytesTotal(void) { return n_bytes_total; }
+    size_t getBytesFree(void) { return n_bytes_total - n_bytes_used; }
+
+  protected:
+    uint8_t *memory = NULL;
+    size_t n_bytes_total = 0;
+    size_t n_bytes_used = 0;
+};
+
+#endif
@@ -0,0 +1,65 @@
+
+#ifndef AudioPathRegistry_h
+#define AudioPathRegistry_h
+
+#include "AudioPathArena.h"
+#include "AudioPath_Base.h"
+
+// AudioPathRegistry:
+//
+// Holds all of the AudioPaths, which are all built in an AudioPathArena when the system boots, and switches
+// between them.  Only one AudioPath is active at a time, so switching only has to de-activate the one that
+// is active and then activate the new one.  The cost is set by the number of audio objects in those two
+// AudioPaths, not by the number of AudioPaths (or objects) in the whole system.  Switching never uses the heap.
+//
+#define AUDIO_PATH_MAX_PATHS  8    //each output mixer (AudioMixer8_F32) has one input per AudioPath
+
+class AudioPathRegistry {
+  public:
+    AudioPathRegistry(AudioPathArena *_arena) : arena(_arena) {}
+
+    //build an AudioPath of the given type in the arena and add it to the registry.  Returns NULL if it failed.
+    template <class T>
+    T* add(AudioSettings_F32 &_audio_settings, Tympan *_tympan_ptr, EarpieceShield *_shield_ptr) {
+      if (n_paths >= AUDIO_PATH_MAX_PATHS) {
+        Serial.println("AudioPathRegistry: add: *** ERROR ***: too many AudioPaths.  Max is " + String(AUDIO_PATH_MAX_PATHS));
+        return NULL;
+      }
+      T *path = arena->create<T>(_audio_settings, _tympan_ptr, _shield_ptr, arena);
+      if (path != NULL) allPaths[n_paths++] = path;
+      return path;
+    }
+
+    int getNumPaths(void) { return n_paths; }
+    AudioPath_Base* getPath(int index) { return ((index >= 0) && (index < n_paths)) ? allPaths[index] : NULL; }
+    int getActiveIndex(void) { return active_index; }
+    AudioPath_Base* getActivePath(void) { return getPath(active_index); }
+
+    //de-activate every AudioPath, whether or not we think that it is active (such as at startup)
+    void deactivateAll(void) {
+      for (int i=0; i < n_paths; i++) allPaths[i]->setActive(false);
+      active_index = -1;  //none are active
+    }
+
+    //de-activate the active AudioPath (if any) and then activate the given one.  Returns the active index.
+    int activate(int index) {
+      if (active_index >= 0) allPaths[active_index]->setActive(false);
+      active_index = -1;
+      if ((index >= 0) && (index < n_paths)) {
+        allPaths[index]->setActive(true);
+        active_index = index;
+      }
+      return active_index;
+    }
+
+    //false to activate the AudioPaths without calling their setupHardware() (see AudioPath_Base::enableSetupHardware())
+    void enableSetupHardware(bool enable) { for (int i=0; i < n_paths; i++) allPaths[i]->enableSetupHardware(enable); }
+
+  protected:
+    AudioPathArena *arena = NULL;
+    AudioPath_Base *allPaths[AUDIO_PATH_MAX_PATHS];
+    int n_paths = 0;
+    int active_index = -1;
+};
+
+#endif
@@ -2,7 +2,7 @@
 #ifndef AudioPath_Base_h
 #define AudioPath_Base_h
 
-#include <vector>
+#include "AudioPathArena.h"
 
 // AudioPath_Base:
 //
@@ -16,26 +16,35 @@
 // Note that the final output is treated separately because the final output AudioStream_F32 object should be instantiated
 // last, after *all* of the AudioPath instances are created.  This ensures that the output is serviced (behind the scenes,
 // by AudioStrea::update_all()) after all of the AudioPath continuents.  This minimizes audio latency through the system.
-// 
+//
 // So, in your overall program, you should instantiate your audio source (AudioInputI2S_F32, for example), then you
 // should instantiate all of the your AudioPath objects, then you should instantiate your output desitnation (AudioMixer8_F32
 // and AudioOutputI2S_f32, for example)
 //
+// In your derived class, create the audio objects with addAudioObject() and the connections with addConnection().  If the
+// AudioPath was given an AudioPathArena (see AudioPathRegistry.h), they are built in the arena instead of on the heap.
+//
+#define AUDIO_PATH_MAX_OBJECTS      16   //max audio objects per AudioPath
+#define AUDIO_PATH_MAX_CONNECTIONS  32   //max audio connections per AudioPath
+
 class AudioPath_Base {
   public:
     AudioPath_Base(void) {}
-    AudioPath_Base(AudioSettings_F32 &_audio_settings, Tympan *_tympan_ptr, EarpieceShield *_shield_ptr) : tympan_ptr(_tympan_ptr), shield_ptr(_shield_ptr) {}
-    
+    AudioPath_Base(AudioSettings_F32 &_audio_settings, Tympan *_tympan_ptr, EarpieceShield *_shield_ptr, AudioPathArena *_arena = NULL)
+      : tympan_ptr(_tympan_ptr), shield_ptr(_shield_ptr), arena(_arena) {}
+
     //Destructor: note that destroying Audio Objects is not a good idea because AudioStream (from Teensy)
     //does not currently support (as of Sept 9, 2024) having instances of AudioStream be destroyed.  The
     //problem is that AudioStream keeps pointers to all AudioStream instances ever created.  If an AudioStream
     //instance is deleted, AudioStream does not remove the instance from its lists.  So, it has stale pointers
     //that eventually take down the system.
-    //So, it is *not* recommended that you destroy AudioStream objects or, therefore, AudioPath objects
+    //So, it is *not* recommended that you destroy AudioStream objects or, therefore, AudioPath objects.
+    //Objects that were built in an AudioPathArena are never destroyed.
     virtual ~AudioPath_Base() {
-      for (int i=(int)patchCords.size()-1; i>=0; i--) delete patchCords[i]; //destroy all the Audio Connections (in reverse order...maybe less memroy fragmentation?)
+      if (arena != NULL) return;  //the arena owns the memory and never gives it back
+      for (int i=n_patchCords-1; i>=0; i--) delete patchCords[i]; //destroy all the Audio Connections (in reverse order...maybe less memroy fragmentation?)
       Serial.println("AudioPath_Base: Destructor: *** WARNING ***: destroying AudioStream instances, which is not supported by Teensy's AudioStream.");
-      for (int i=(int)audioObjects.size()-1; i>=0; i--) delete audioObjects[i];       //destroy all the audio class instances (in reverse order...maybe less memroy fragmentation?)
+      for (int i=n_audioObjects-1; i>=0; i--) delete audioObjects[i];       //destroy all the audio class instances (in reverse order...maybe less memroy fragmentation?)
     }
 
     //expose the starting and ending nodes to enable audio connections between this AudioPath and the rest of the world
@@ -46,16 +55,17 @@ class AudioPath_Base {
     //Per the rules of AudioStream::update_all(), active = false should mean that the audio object
     //is not invoked, thereby saving CPU.
     virtual bool setActive(bool _active) {
-      if (_active == true) setupHardware();  //calling this instance's setupHardware()
-      
-      for (auto & audioObject : audioObjects) { //iterate over each audio object in the audioObjects vector
-        //Serial.println("AudioPath_Base: setActive(" + String(_active) + "): calling setActive() for object " + audioObject->instanceName);
-        audioObject->setActive(_active);   // set whether it is active. (setting to False disables the algorithms and reduces CPU)
-      } 
+      if ((_active == true) && enable_setupHardware) setupHardware();  //calling this instance's setupHardware()
+
+      for (int i=0; i < n_audioObjects; i++) { //iterate over each audio object
+        //Serial.println("AudioPath_Base: setActive(" + String(_active) + "): calling setActive() for object " + audioObjects[i]->instanceName);
+        audioObjects[i]->setActive(_active);   // set whether it is active. (setting to False disables the algorithms and reduces CPU)
+      }
       return _active;
     }
     virtual void setupHardware(void) {}  //override this as desired in your derived class
-  
+    bool enableSetupHardware(bool enable) { return enable_setupHardware = enable; }  //false to skip setupHardware() in setActive() (such as for timing the switch itself)
+
     //Interface to allow for any slower main-loop updates
     virtual int serviceMainLoop(void) { return 0; }  //Do nothing.  You can override in your derived class, if you want to do something in the main loop.
 
@@ -63,17 +73,53 @@ class AudioPath_Base {
     virtual void printHelp(void) { Serial.println("    : (none)"); };  //print default message
     virtual void respondToByte(char c) { };                           //default do nothing
 
+    int getNumAudioObjects(void) { return n_audioObjects; }
+
     String name = "(unnamed)";   //human-readable name for your audio path.  You should override this in the constructor (or wherever) of your derived class.
 
   protected:
+    bool enable_setupHardware = true;
     AudioSwitchMatrix4_F32 *startNode = NULL; //instantiate as the first audio class in your AudioPath (even if you have no inputs)
     AudioSwitchMatrix4_F32 *endNode = NULL;   //instantiate as the last audio class in your AudioPath (even if you have no outputs)
     Tympan *tympan_ptr = NULL;
     EarpieceShield *shield_ptr = NULL;
-    std::vector<AudioConnection_F32 *> patchCords;
-    std::vector<AudioStream_F32 *> audioObjects;
+    AudioPathArena *arena = NULL;             //if NULL, the audio objects are created with new
+    AudioConnection_F32 *patchCords[AUDIO_PATH_MAX_CONNECTIONS];
+    int n_patchCords = 0;
+    AudioStream_F32 *audioObjects[AUDIO_PATH_MAX_OBJECTS];
+    int n_audioObjects = 0;
+
+    //create an audio object (in the arena, if we have one) and keep track of it
+    template <class T>
+    T* addAudioObject(AudioSettings_F32 &_audio_settings, const String &instanceName) {
+      if (n_audioObjects >= AUDIO_PATH_MAX_OBJECTS) {
+        Serial.println("AudioPath_Base (" + name + "): addAudioObject: *** ERROR ***: too many audio objects.  Increase AUDIO_PATH_MAX_OBJECTS.");
+        return NULL;
+      }
+      T *obj = (arena != NULL) ? arena->create<T>(_audio_settings) : new T(_audio_settings);
+      if (obj == NULL) return NULL;
+      obj->instanceName = instanceName;  //give a human readable name to help Chip's debugging of startup issues
+      audioObjects[n_audioObjects++] = obj;
+      return obj;
+    }
+
+    //create an audio connection (in the arena, if we have one) and keep track of it
+    AudioConnection_F32* addConnection(AudioStream_F32 &source, int source_chan, AudioStream_F32 &dest, int dest_chan) {
+      if (n_patchCords >= AUDIO_PATH_MAX_CONNECTIONS) {
+        Serial.println("AudioPath_Base (" + name + "): addConnection: *** ERROR ***: too many connections.  Increase AUDIO_PATH_MAX_CONNECTIONS.");
+        return NULL;
+      }
+      AudioConnection_F32 *cord = (arena != NULL) ? arena->create<AudioConnection_F32>(source, source_chan, dest, dest_chan) : new AudioConnection_F32(source, source_chan, dest, dest_chan);
+      if (cord != NULL) patchCords[n_patchCords++] = cord;
+      return cord;
+    }
+
+    //get an array of n values, set to zero (in the arena, if we have one).  If there is no arena, free it with delete[].
+    template <class T>
+    T* allocateArray(int n) {
+      return (arena != NULL) ? arena->createArray<T>(n) : new T[n]();
+    }
 };
 
 
 #endif
-
@@ -1,7 +1,6 @@
 #ifndef AudioPath_PassThruGain_Analog_h
 #define AudioPath_PassThruGain_Analog_h
 
-#include <vector>
 #include "AudioPath_Base.h"
 
 
@@ -16,20 +15,16 @@
 class AudioPath_PassThruGain_Analog : public AudioPath_Base {
   public:
     //Constructor
-    AudioPath_PassThruGain_Analog(AudioSettings_F32 &_audio_settings, Tympan *_tympan_ptr, EarpieceShield *_shield_ptr)  : AudioPath_Base(_audio_settings, _tympan_ptr, _shield_ptr) 
+    AudioPath_PassThruGain_Analog(AudioSettings_F32 &_audio_settings, Tympan *_tympan_ptr, EarpieceShield *_shield_ptr, AudioPathArena *_arena = NULL)  : AudioPath_Base(_audio_settings, _tympan_ptr, _shield_ptr, _arena) 
     {
-      //instantiate audio classes...we're only storing them in a vector so that it's easier to destroy them later (whenver destruction is allowed by AudioStream)
-      audioObjects.push_back( startNode = new AudioSwitchMatrix4_F32( _audio_settings ) ); startNode->instanceName = String("Input Matrix"); //per AudioPath_Base, always have this first
-      for (int i=0; i  <4; i++) {
-        allGains.push_back( new AudioEffectGain_F32( _audio_settings ) ); 
-        allGains[i]->instanceName = String("Gain" + String(i)); //give a human readable name to help Chip's debugging of startup issues
-        audioObjects.push_back( allGains[i] );
-      }
-      audioObjects.push_back( endNode = new AudioSwitchMatrix4_F32( _audio_settings ) ); endNode->instanceName = String("Output Matrix"); //per AudioPath_Base, always have this last
+      //instantiate audio classes...AudioPath_Base keeps track of them (and builds them in the arena, if we were given one)
+      startNode = addAudioObject<AudioSwitchMatrix4_F32>(_audio_settings, String("Input Matrix")); //per AudioPath_Base, always have this first
+      for (int i=0; i < N_GAINS; i++) allGains[i] = addAudioObject<AudioEffectGain_F32>(_audio_settings, String("Gain" + String(i)));
+      endNode = addAudioObject<AudioSwitchMatrix4_F32>(_audio_settings, String("Output Matrix")); //per AudioPath_Base, always have this last
 
       //connect the audio classes
-      for (int I=0; I < (int)allGains.size(); I++)  patchCords.push_back( new AudioConnection_F32(*startNode,   I, *allGains[I], 0)); //connect inputs to the gain objects
-      for (int I=0; I < (int)allGains.size(); I++)  patchCords.push_back( new AudioConnection_F32(*allGains[I], 0, *endNode,     I)); //connect gain objects to the outputs
+      for (int I=0; I < N_GAINS; I++)  addConnection(*startNode,   I, *allGains[I], 0); //connect inputs to the gain objects
+      for (int I=0; I < N_GAINS; I++)  addConnection(*allGains[I], 0, *endNode,     I); //connect gain objects to the outputs
      
       //setup the parameters of the audio processing
       setupAudioProcessing();
@@ -41,12 +36,12 @@ class AudioPath_PassThruGain_Analog : public AudioPath_Base {
       name = "Audio Pass-Thru Analog";  //"name" is defined as a String in AudioPath_Base
     }
 
-    //~AudioPath_PassThruGain();  //using destructor from AudioPath_Base, which destorys everything in audioObjects and in patchCords
+    //~AudioPath_PassThruGain();  //using destructor from AudioPath_Base, which destorys everything in audioObjects and in patchCords (unless they're in an arena)
 
      //setupAudioProcess: initialize all gain blocks to a certain gain value
     virtual void setupAudioProcessing(void) {
       //Serial.println("AudioPath_PassThruGain_Analog: setupAudioProcessing...");
-      for (int i=0; i < (int)allGains.size(); i++) allGains[i]->setGain_dB(10.0);
+      for (int i=0; i < N_GAINS; i++) allGains[i]->setGain_dB(10.0);
     }
 
     //setup the hardware.  This is called automatically by AudioPath_Base::setActive(flag_active) whenever flag_active = true
@@ -77,7 +72,7 @@ class AudioPath_PassThruGain_Analog : public AudioPath_Base {
       if ((cur_millis < lastChange_millis) || (cur_millis > targ_time_millis)) { //also catches wrap-around of millis()
         Serial.print(name);
         Serial.print(": serviceMainLoop: Gains (dB) = ");
-        for (int i=0; i < (int)allGains.size(); i++) { Serial.print(allGains[i]->getGain_dB(),1);  Serial.print(", ");  }
+        for (int i=0; i < N_GAINS; i++) { Serial.print(allGains[i]->getGain_dB(),1);  Serial.print(", ");  }
         Serial.println();
         lastChange_millis = cur_millis;
       }
@@ -85,7 +80,8 @@ class AudioPath_PassThruGain_Analog : public AudioPath_Base {
     }
 
   protected:
-    std::vector<AudioEffectGain_F32 *> allGains;  //if you use the audioObjects vector from AudioPathBase, any allocation to this pointer will get automatically deleted  
+    static const int N_GAINS = 4;                 //one per channel
+    AudioEffectGain_F32 *allGains[N_GAINS];       //created by addAudioObject(), so AudioPath_Base owns them
     unsigned long int       lastChange_millis = 0UL;
     const unsigned long int update_period_millis = 1000UL; //here's how often (milliseconds) we allow our main-loop update to execute
 
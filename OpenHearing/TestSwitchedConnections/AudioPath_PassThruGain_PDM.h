@@ -15,8 +15,8 @@
 class AudioPath_PassThruGain_PDM : public AudioPath_PassThruGain_Analog {
   public:
       //Constructor
-      AudioPath_PassThruGain_PDM(AudioSettings_F32 &_audio_settings, Tympan *_tympan_ptr, EarpieceShield *_shield_ptr)  
-        : AudioPath_PassThruGain_Analog(_audio_settings, _tympan_ptr, _shield_ptr) 
+      AudioPath_PassThruGain_PDM(AudioSettings_F32 &_audio_settings, Tympan *_tympan_ptr, EarpieceShield *_shield_ptr, AudioPathArena *_arena = NULL)  
+        : AudioPath_PassThruGain_Analog(_audio_settings, _tympan_ptr, _shield_ptr, _arena) 
       {
         setupAudioProcessing();
         name = "Audio Pass-Thru PDM";  //"name" is defined as a String in AudioPath_Base
@@ -25,8 +25,8 @@ class AudioPath_PassThruGain_PDM : public AudioPath_PassThruGain_Analog {
     virtual void setupAudioProcessing(void) {
       //Serial.println("AudioPath_PassThruGain_PDM: setupAudioProcessing...");
       AudioPath_PassThruGain_Analog::setupAudioProcessing(); //I don't think that it does anything other than setGain_dB, but let's call it just to be sure
-      //Serial.println("AudioPath_PassThruGain_PDM: setting allGains again..." + String((int)allGains.size()));
-      for (int i=0; i < (int)allGains.size(); i++) allGains[i]->setGain_dB(25.0);  //increase the gain to handle the low-output of the PDM mics
+      //Serial.println("AudioPath_PassThruGain_PDM: setting allGains again..." + String(N_GAINS));
+      for (int i=0; i < N_GAINS; i++) allGains[i]->setGain_dB(25.0);  //increase the gain to handle the low-output of the PDM mics
     }
 
     virtual void setupHardware(void) {
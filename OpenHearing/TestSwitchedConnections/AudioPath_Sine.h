@@ -1,7 +1,6 @@
 #ifndef AudioPath_Sine_h
 #define AudioPath_Sine_h
 
-#include <vector>
 #include "AudioPath_Base.h"
 
 
@@ -16,15 +15,15 @@
 class AudioPath_Sine : public AudioPath_Base {
   public:
     //Constructor
-    AudioPath_Sine(AudioSettings_F32 &_audio_settings, Tympan *_tympan_ptr, EarpieceShield *_shield_ptr)  : AudioPath_Base(_audio_settings, _tympan_ptr, _shield_ptr) 
+    AudioPath_Sine(AudioSettings_F32 &_audio_settings, Tympan *_tympan_ptr, EarpieceShield *_shield_ptr, AudioPathArena *_arena = NULL)  : AudioPath_Base(_audio_settings, _tympan_ptr, _shield_ptr, _arena) 
     {
-      //instantiate audio classes...we're only storing them in a vector so that it's easier to destroy them later (whenver destruction is allowed by AudioStream)
-      audioObjects.push_back( startNode = new AudioSwitchMatrix4_F32( _audio_settings ) ); startNode->instanceName = String("Input Matrix");  //per AudioPath_Base, always have this first
-      audioObjects.push_back( sineWave  = new AudioSynthWaveform_F32( _audio_settings ) ); sineWave->instanceName  = String("Sine Wave");     //give a human readable name to help Chip's debugging of startup issues
-      audioObjects.push_back( endNode   = new AudioSwitchMatrix4_F32( _audio_settings ) ); endNode->instanceName   = String("Output Matrix"); //per AudioPath_Base, always have this last
+      //instantiate audio classes...AudioPath_Base keeps track of them (and builds them in the arena, if we were given one)
+      startNode = addAudioObject<AudioSwitchMatrix4_F32>(_audio_settings, String("Input Matrix"));  //per AudioPath_Base, always have this first
+      sineWave  = addAudioObject<AudioSynthWaveform_F32>(_audio_settings, String("Sine Wave"));
+      endNode   = addAudioObject<AudioSwitchMatrix4_F32>(_audio_settings, String("Output Matrix")); //per AudioPath_Base, always have this last
       
-      // Make all audio connections, except the final one to the destiation...we're only storing them in a vector so that it's easier to destroy them later
-      for (int Ioutput=0; Ioutput < 4; Ioutput++)  patchCords.push_back( new AudioConnection_F32(*sineWave, 0, *endNode, Ioutput)); //same sine to all outputs
+      // Make all audio connections, except the final one to the destiation
+      for (int Ioutput=0; Ioutput < 4; Ioutput++)  addConnection(*sineWave, 0, *endNode, Ioutput); //same sine to all outputs
 
       //setup the parameters of the audio processing
       setupAudioProcessing(); 
@@ -36,7 +35,7 @@ class AudioPath_Sine : public AudioPath_Base {
       name = "Sine Generator";  //"name" is defined as a String in AudioPath_Base
     }
 
-    //~AudioPath_Sine();  //using destructor from AudioPath_Base, which destorys everything in audioObjects and in patchCords
+    //~AudioPath_Sine();  //using destructor from AudioPath_Base, which destorys everything in audioObjects and in patchCords (unless they're in an arena)
 
     //setupAudioProcess: initialize the sine wave to the desired frequency and amplitude
     virtual void setupAudioProcessing(void) {
@@ -133,7 +132,7 @@ class AudioPath_Sine : public AudioPath_Base {
 
   protected:
     //data members for generating the sine wave
-    AudioSynthWaveform_F32  *sineWave;  //if you use the audioObjects vector from AudioPathBase, any allocation to this pointer will get automatically deleted
+    AudioSynthWaveform_F32  *sineWave;  //created by addAudioObject(), so AudioPath_Base owns it
     float                   freq_Hz = 1000.0f;
     float                   sine_amplitude = sqrtf(pow10f(0.1*-50.0));
     const unsigned long int tone_dur_millis = 1000UL;
@@ -1,9 +1,8 @@
 #ifndef AudioPath_Sine_wFFT_h
 #define AudioPath_Sine_wFFT_h
 
-#include <vector>
 #include "AudioPath_Base.h"
-#include <utility/BTNRH_rfft.h>  //Tympan_Library FFT routine (generic C, not ARM-specific)
+#include "AnalysisFFT.h"         //the FFT backends (CMSIS and BTNRH)
 #include <math.h>
 
 
@@ -14,31 +13,66 @@
 // ////////////////////////////////////////////////////////////////////////////
 
 
-// This AudioPath takes the audio input (all four channels) and applies gain.  This uses the analog inputs.
+// This AudioPath plays a sine wave and analyzes the audio input (all four channels) with an FFT.  This uses the analog inputs.
+//
+// There are three analysis modes:
+//   * ANALYSIS_BLOCK_FFT: the spectrum of each Nfft samples in turn (no overlap and no averaging).
+//   * ANALYSIS_STREAMING_FFT (the default): every "hop" samples, the last Nfft samples are FFT'd and the power spectrum
+//     is added to a running (Welch) average, so the spectrum updates continuously.
+//   * ANALYSIS_GOERTZEL: for tone tests, only the FFT bin nearest the generated tone is needed.  The Goertzel filter
+//     computes just that one bin, sample by sample as the audio arrives, over the same Hanning-windowed Nfft-sample
+//     frames as ANALYSIS_BLOCK_FFT.  So, it gives the same complex value (magnitude and phase) as that bin of the FFT,
+//     for about 3 (double precision) multiplies per sample and no buffers.
+//
+// In both FFT modes, each channel's queued audio blocks are moved right away into a rolling buffer of Nfft + Nfft/8
+// samples, so only a few audio blocks are ever queued (no mode waits for Nfft/block_size = 32 blocks per channel).
+// The FFTs are staged (see AnalysisFFT.h): each call to serviceMainLoop() does one step of one FFT, which is at most
+// about a quarter of it.  While a frame is being FFT'd, the new audio goes into the extra Nfft/8 samples of the
+// buffer (and then waits in the queue), so the frame isn't overwritten.  If loop() isn't called often enough and a
+// queue still backs up past max_queued_blocks, the channel's pending frame is dropped (and counted, see
+// getNumDroppedFrames()) rather than finishing the FFT in one long call or running out of audio memory.
+//
+// In ANALYSIS_STREAMING_FFT, the generated sine is also recorded and analyzed as a reference, in step with the inputs.
+// Each input's FFT frame is then used once more, for its cross-spectrum with the reference frame.  That gives the
+// transfer function H1(f) = Sxy/Sxx and the coherence |Sxy|^2/(Sxx Syy) from the output to each input, for one complex
+// multiply-accumulate per bin per channel.  These are kept for the H1_N_BINS bins around the tone.  H1 only means
+// something where the sine has energy, which is just the few bins under the tone's window mainlobe, so only the bins
+// whose Sxx is within H1_STIMULUS_RANGE_DB of the tone's are reported (see hasStimulus()).  Those bins can be sent
+// out in a compact binary format (see exportTransferFunction()).
+//
+// The FFTs are done by one of the backends in AnalysisFFT.h (CMSIS by default), which window, FFT, and normalize.
+//
+#define H1_N_BINS          256    //number of FFT bins (centered on the tone) for the transfer function
+#define H1_EXPORT_VERSION  2
+#define H1_STIMULUS_RANGE_DB  60.0f  //bins where the reference (Sxx) is further than this below its peak have no stimulus
+
 class AudioPath_Sine_wFFT : public AudioPath_Base {
   public:
+    enum ANALYSIS_MODE { ANALYSIS_BLOCK_FFT = 0, ANALYSIS_STREAMING_FFT, ANALYSIS_GOERTZEL };
+    enum FFT_BACKEND { BACKEND_CMSIS = 0, BACKEND_BTNRH };
+
     //Constructor
-    AudioPath_Sine_wFFT(AudioSettings_F32 &_audio_settings, Tympan *_tympan_ptr, EarpieceShield *_shield_ptr)  : AudioPath_Base(_audio_settings, _tympan_ptr, _shield_ptr) 
+    AudioPath_Sine_wFFT(AudioSettings_F32 &_audio_settings, Tympan *_tympan_ptr, EarpieceShield *_shield_ptr, AudioPathArena *_arena = NULL)  : AudioPath_Base(_audio_settings, _tympan_ptr, _shield_ptr, _arena) 
     {
-      //instantiate audio classes...
-      audioObjects.push_back( startNode = new AudioSwitchMatrix4_F32( _audio_settings ) ); startNode->instanceName = String("Input Matrix"); //per AudioPath_Base, always have this first
+      //instantiate audio classes...AudioPath_Base keeps track of them (and builds them in the arena, if we were given one)
+      startNode = addAudioObject<AudioSwitchMatrix4_F32>(_audio_settings, String("Input Matrix")); //per AudioPath_Base, always have this first
 
       //Create the audio queues necessary for doing the FFT on the inputs
-      for (int i=0; i<4; i++) {  //create a queue of audio blocks for each possible input (up to 4 inputs!)
-        allQueues.push_back( new AudioRecordQueue_F32( _audio_settings ) );   //create the queue and keep it in a local vector (with an easy-to-read name)
-        allQueues[i]->instanceName = String("Record Queue " + String(i));   //give a human readable name to help Chip's debugging of startup issues
-        audioObjects.push_back( allQueues[i] );  //save the queue in the vector maintained by AudioPath_Base, which is intended to hold *all* audio objects that are instantiated (not just queues)
+      for (int i=0; i < N_CHAN; i++) {  //create a queue of audio blocks for each possible input (up to 4 inputs!)
+        allQueues[i] = addAudioObject<AudioRecordQueue_F32>(_audio_settings, String("Record Queue " + String(i)));
       }
 
       //Create the sound-generation objects for creating the sine output
-      audioObjects.push_back( sineWave1 = new AudioSynthWaveform_F32( _audio_settings ) ); sineWave1->instanceName = String("Sine Wave");  //give a human readable name to help Chip's debugging of startup issues
+      sineWave1 = addAudioObject<AudioSynthWaveform_F32>(_audio_settings, String("Sine Wave"));
+      refQueue = addAudioObject<AudioRecordQueue_F32>(_audio_settings, String("Record Queue Reference"));  //the sine, as the reference for the transfer function
       
       //Create the output end-node
-      audioObjects.push_back( endNode = new AudioSwitchMatrix4_F32( _audio_settings ) ); endNode->instanceName = String("Output Matrix"); //per AudioPath_Base, always have this last
+      endNode = addAudioObject<AudioSwitchMatrix4_F32>(_audio_settings, String("Output Matrix")); //per AudioPath_Base, always have this last
 
       //connect the audio classes
-      for (int I=0; I < (int)allQueues.size(); I++)  patchCords.push_back( new AudioConnection_F32(*startNode, I, *allQueues[I], 0)); //connect inputs to the queue objects
-      for (int I=0; I < 4; I++)                      patchCords.push_back( new AudioConnection_F32(*sineWave1, 0, *endNode,      I)); //connect sine to all outputs
+      for (int I=0; I < N_CHAN; I++)  addConnection(*startNode, I, *allQueues[I], 0); //connect inputs to the queue objects
+      for (int I=0; I < 4; I++)       addConnection(*sineWave1, 0, *endNode,      I); //connect sine to all outputs
+      addConnection(*sineWave1, 0, *refQueue, 0);                                     //connect sine to the reference queue
 
       //setup the parameters of the audio processing
       setupAudioProcessing();
@@ -51,23 +85,38 @@ class AudioPath_Sine_wFFT : public AudioPath_Base {
 
       //set some other parameters and allocate the required memory for buffers
       sample_rate_Hz = _audio_settings.sample_rate_Hz;
-      n_audio_blocks_required = (int)((Nfft-1) / _audio_settings.audio_block_samples) + 1;  //make sure that we round up
-      for (int Ichan=0; Ichan < (int)allQueues.size(); Ichan++) {
-        float *fftMemory_cmplx = new float[Nfft + 1];  //allocate memory for (complex) FFT results (docs say N+2 samples, so it'll hold positive frequency values as interleaved complex values up to Nyquist)
-        if (fftMemory_cmplx == NULL) Serial.println("AudioPath_Sine_wFFT: Constructor: *** ERROR ***: Could not allocate FFT memory for chan " + String(Ichan));
-        allFftMemory_cmplx.push_back(fftMemory_cmplx);
+      audio_block_samples = _audio_settings.audio_block_samples;
+      ring_len = Nfft + ring_slack_samples;
+      for (int Ichan=0; Ichan < N_STREAM; Ichan++) {  //the inputs and the reference
+        allRings[Ichan] = allocateArray<float>(ring_len);  //the rolling buffer: the frame being FFT'd, plus room for new audio
+        if (allRings[Ichan] == NULL) Serial.println("AudioPath_Sine_wFFT: Constructor: *** ERROR ***: Could not allocate FFT memory for chan " + String(Ichan));
       }
-      fftWindow = new float[Nfft];  computeFftWindow(Nfft, fftWindow);
+      for (int Ichan=0; Ichan < N_CHAN; Ichan++) allPowerSpectra[Ichan] = allocateArray<float>(Nfft/2 + 1);  //the (Welch-averaged) power spectra
+      fftWindow = allocateArray<float>(Nfft);  computeFftWindow(Nfft, fftWindow);
+      fftWork = allocateArray<float>(Nfft + 2);   //the FFT in progress (shared by all channels)
+      refSpectrum_cmplx = allocateArray<float>(2*H1_N_BINS);
+      refPowerSpectrum = allocateArray<float>(H1_N_BINS);
+      for (int Ichan=0; Ichan < N_CHAN; Ichan++) allCrossSpectra_cmplx[Ichan] = allocateArray<float>(2*H1_N_BINS);
+      setHop(Nfft / 4);                            //75% overlap, which is good for the Hanning window
+      setFrequency_Hz(freq1_Hz);                   //now that we know the sample rate, point the Goertzel filter at the tone
+
+      //set up the FFT backends (the CMSIS twiddles are computed once, here)
+      fft_btnrh.setup(Nfft);
+      fft_cmsis_twiddle = allocateArray<float>(AnalysisFFT_CMSIS::getTwiddleLength(Nfft));
+      fft_cmsis.setup(Nfft, fft_cmsis_twiddle);
+      setFftBackend(BACKEND_CMSIS);
     }
 
     // The base destructor will destroy the audio objects (in "audioObjects") and connections (in "patchCords"), but 
     // need to destroy everything else that I might have instantiated in addition to those two types of objects
     virtual ~AudioPath_Sine_wFFT() //will automatically call the destructor for AudioPath_Base  
     {
-      delete[] fftWindow;
-      for (auto & fftMemory : allFftMemory_cmplx) { //iterate over each item in the vector
-        delete[] fftMemory;
-      }
+      if (arena != NULL) return;  //the arena owns the memory
+      delete[] fftWindow; delete[] fftWork; delete[] fft_cmsis_twiddle;
+      delete[] refSpectrum_cmplx; delete[] refPowerSpectrum;
+      for (int Ichan=0; Ichan < N_CHAN; Ichan++) delete[] allCrossSpectra_cmplx[Ichan];
+      for (int Ichan=0; Ichan < N_CHAN; Ichan++) delete[] allPowerSpectra[Ichan];
+      for (int Ichan=0; Ichan < N_STREAM; Ichan++) delete[] allRings[Ichan];
     }
 
     //setupAudioProcess: initialize the sine wave to the desired frequency and amplitude
@@ -114,36 +163,113 @@ class AudioPath_Sine_wFFT : public AudioPath_Base {
       }
     }
 
+    //The queues are started, stopped, and cleared with the audio interrupts off, so that all of them (the inputs and the
+    //reference) start from the same audio block.  Otherwise, the audio interrupt could land in the middle of the loop.
     virtual void beginRecording(void) {
-      for (auto & queue : allQueues) queue->begin(); //loop over all queues in vector and begin the audio buffering process}
+      AudioNoInterrupts();
+      for (int Ichan=0; Ichan < N_CHAN; Ichan++) allQueues[Ichan]->begin(); //loop over all queues and begin the audio buffering process
+      refQueue->begin();
+      AudioInterrupts();
     }
     virtual void stopRecording(void) {
-      for (auto & queue : allQueues) queue->end(); //loop over all queues in vector and end the audio buffering process}
+      AudioNoInterrupts();
+      for (int Ichan=0; Ichan < N_CHAN; Ichan++) allQueues[Ichan]->end(); //loop over all queues and end the audio buffering process
+      refQueue->end();
+      AudioInterrupts();
     }
     virtual void clearRecording(void) {
-      for (auto & queue : allQueues) queue->clear(); //loop over all queues in vector and clear any audio buffers that are held
+      resetStreamingAnalysis();  //this clears the queues, too
+      resetGoertzel();
+    }
+
+    //choose the analysis mode (see the top of this file)
+    int setAnalysisMode(int _mode) {
+      if ((_mode < ANALYSIS_BLOCK_FFT) || (_mode > ANALYSIS_GOERTZEL)) return analysis_mode;
+      analysis_mode = _mode;
+      clearRecording();  //the queued blocks and buffers mean different things in each mode, so start over
+      return analysis_mode;
+    }
+    int getAnalysisMode(void) { return analysis_mode; }
+
+    //set how many samples the rolling window moves between FFTs (ANALYSIS_STREAMING_FFT).  Rounded to whole audio blocks,
+    //up to max_hop_samples.
+    int setHop(int _hop_samples) {
+      int n_blocks = max(1, min(max_hop_samples / audio_block_samples, (_hop_samples + audio_block_samples/2) / audio_block_samples));
+      hop_samples = n_blocks * audio_block_samples;
+      return hop_samples;
+    }
+    int getHop(void) { return hop_samples; }
+
+    //set how many FFT frames are averaged into the power spectrum (ANALYSIS_STREAMING_FFT).  Once that many frames have been
+    //averaged, older frames are forgotten exponentially, with the same time constant.
+    int setNumAverages(int _n_avg) { n_welch_avg = max(1, _n_avg); return n_welch_avg; }
+    int getNumAverages(void) { return n_welch_avg; }
+
+    //start the rolling windows and the averages over again (in both FFT modes).  The queued audio is thrown away, too,
+    //so that the inputs and the reference start over on the same audio block.
+    void resetStreamingAnalysis(void) {
+      clearQueues();
+      fft->abort();  fft_chan = -1;  //forget any FFT in progress
+      for (int Ichan=0; Ichan < N_STREAM; Ichan++) {
+        ring_write_ind[Ichan] = 0; n_samples_in_ring[Ichan] = 0; samples_since_frame[Ichan] = 0;
+        frame_pending[Ichan] = false; frame_start_ind[Ichan] = 0; n_frames[Ichan] = 0; n_dropped_frames[Ichan] = 0;
+      }
+      ref_frame_dropped = false;
+      for (int Ichan=0; Ichan < N_CHAN; Ichan++) {
+        if (allPowerSpectra[Ichan] != NULL) for (int I=0; I < Nfft/2+1; I++) allPowerSpectra[Ichan][I] = 0.0f;
+      }
+      next_fft_chan = 0;
+      resetTransferFunction();
+    }
+
+    //start the cross-spectra over again
+    void resetTransferFunction(void) {
+      for (int Ichan=0; Ichan < N_CHAN; Ichan++) {
+        n_cross_frames[Ichan] = 0;
+        if (allCrossSpectra_cmplx[Ichan] != NULL) for (int I=0; I < 2*H1_N_BINS; I++) allCrossSpectra_cmplx[Ichan][I] = 0.0f;
+      }
+      n_ref_frames = 0;  ref_power_max = 0.0f;
+      if (refPowerSpectrum != NULL) for (int I=0; I < H1_N_BINS; I++) refPowerSpectrum[I] = 0.0f;
+    }
+
+    //choose the first FFT bin of the transfer function (and start the cross-spectra over)
+    int setTransferFunctionFirstBin(int _bin) {
+      h1_first_bin = max(0, min(Nfft/2+1 - H1_N_BINS, _bin));
+      resetTransferFunction();
+      return h1_first_bin;
     }
+    int getTransferFunctionFirstBin(void) { return h1_first_bin; }
 
     virtual int serviceMainLoop(void) {
       int return_val = 0;
 
-      //loop over each channel and see if enough data is present to do an FFT
-      for (int Ichan = 0; Ichan < (int)allQueues.size(); Ichan++) { //loop over all channels}
-        AudioRecordQueue_F32 *queue = allQueues[Ichan];
-        if (queue->available() >= n_audio_blocks_required) {
-          //gather the queued data and compute the FFT!
-          return_val = processFFT(Ichan,queue);  //returns zero if OK.  Automatically releases queued blocks once they are used
-        }
-      }    
+      if (analysis_mode == ANALYSIS_GOERTZEL) {
+        refQueue->clear();  //the reference is only used by ANALYSIS_STREAMING_FFT
+        return_val = serviceGoertzel();
+      } else {
+        if (analysis_mode != ANALYSIS_STREAMING_FFT) refQueue->clear();  //the reference is only used by ANALYSIS_STREAMING_FFT
+        return_val = serviceStreamingFFT();  //both FFT modes
+      }
 
       //periodically print FFT results to the serial monitor
       if ((millis() < lastUpdate_millis) || (millis() > lastUpdate_millis + update_period_millis)) {
-        float targ_freq_Hz = 1000.0;
+        float targ_freq_Hz = freq1_Hz;  //look at the tone that we are generating
         float Hz_per_bin = sample_rate_Hz / (float)Nfft;
         int targ_bin = (int)(targ_freq_Hz / Hz_per_bin + 0.5); //round to closest bin
         float act_freq_Hz = targ_bin*Hz_per_bin;
         int Ichan = 0;
-        Serial.println("AudiPath_Sine_wFFT: FFT magnitude at " + String((int)act_freq_Hz) + " Hz for Chan " + String(Ichan) + " = " + String(20.0f*log10f(getFftMag(Ichan,targ_bin))) + " dBFS");
+        Serial.print("AudiPath_Sine_wFFT: FFT magnitude at " + String((int)act_freq_Hz) + " Hz for Chan " + String(Ichan) + " = " + String(20.0f*log10f(getFftMag(Ichan,targ_bin))) + " dBFS");
+        if (analysis_mode == ANALYSIS_STREAMING_FFT) {
+          float H_re, H_im;
+          Serial.print(" (" + String(n_frames[Ichan]) + " frames");
+          if (n_dropped_frames[Ichan] > 0) Serial.print(", " + String(n_dropped_frames[Ichan]) + " dropped");
+          Serial.print(")");
+          if (getTransferFunction(Ichan, targ_bin, &H_re, &H_im) == 0) {
+            Serial.print(", H1 = " + String(10.0f*log10f(H_re*H_re + H_im*H_im),2) + " dB, " + String((180.0f/(float)M_PI)*atan2f(H_im, H_re),1) + " deg, coherence = " + String(getCoherence(Ichan, targ_bin),3));
+          }
+        }
+        if (analysis_mode == ANALYSIS_GOERTZEL) Serial.print(", phase = " + String(getGoertzelPhase_deg(Ichan),1) + " deg (Goertzel)");
+        Serial.println();
         lastUpdate_millis = millis();
       }
 
@@ -154,6 +280,12 @@ class AudioPath_Sine_wFFT : public AudioPath_Base {
       Serial.println("   m/M: Mute/Unute the tone (cur = " + String(tone1_active ? "enabled" : "muted")  + ")");
       Serial.println("   f/F: Increment/Decrement tone1 frequency (cur = " + String(freq1_Hz) + "Hz)");
       Serial.println("   a/A: Increment/Decrement tone1 amplitude (cur = " + String(20.f*log10f(sine1_amplitude),1) + " dBFS");
+      Serial.println("   b/w/g: Analyze with block FFTs, streaming (Welch) FFTs, or Goertzel (cur = " + String(analysisModeName(analysis_mode)) + ")");
+      Serial.println("   k: Check that the Goertzel result matches the FFT");
+      Serial.println("   x: Switch the FFT backend (cur = " + String(fft->getName()) + ")");
+      Serial.println("   X: Benchmark the FFT backends");
+      Serial.println("   e: Export the transfer functions from the sine to each input (binary, streaming mode only)");
+      Serial.println("   o/O: Increment/Decrement the streaming FFT hop (cur = " + String(hop_samples) + " samples)");
 
     }
     virtual void respondToByte(char c) {
@@ -182,12 +314,48 @@ class AudioPath_Sine_wFFT : public AudioPath_Base {
           setAmplitude(sine1_amplitude/sqrt(2.0));
           Serial.println(name + ": decreased tone1 amplitude to " + String(20.f*log10f(sine1_amplitude),1) + " dBFS");
           break;
+        case 'b':
+          setAnalysisMode(ANALYSIS_BLOCK_FFT);
+          Serial.println(name + ": analyzing with block FFTs of " + String(Nfft) + " points");
+          break;
+        case 'w':
+          setAnalysisMode(ANALYSIS_STREAMING_FFT);
+          Serial.println(name + ": analyzing with streaming FFTs of " + String(Nfft) + " points, hop = " + String(hop_samples) + ", averages = " + String(n_welch_avg));
+          break;
+        case 'g':
+          setAnalysisMode(ANALYSIS_GOERTZEL);
+          Serial.println(name + ": analyzing with a Goertzel filter at " + String(goertzel_bin * sample_rate_Hz / (float)Nfft) + " Hz (bin " + String(goertzel_bin) + ")");
+          break;
+        case 'k':
+          checkGoertzel();
+          break;
+        case 'x':
+          setFftBackend((fft_backend == BACKEND_CMSIS) ? BACKEND_BTNRH : BACKEND_CMSIS);
+          Serial.println(name + ": using the " + String(fft->getName()) + " FFT");
+          break;
+        case 'X':
+          benchmarkFftBackends();
+          break;
+        case 'e':
+          exportTransferFunction();
+          break;
+        case 'o':
+          setHop(2*hop_samples); resetStreamingAnalysis();
+          Serial.println(name + ": increased streaming FFT hop to " + String(hop_samples) + " samples");
+          break;
+        case 'O':
+          setHop(hop_samples/2); resetStreamingAnalysis();
+          Serial.println(name + ": decreased streaming FFT hop to " + String(hop_samples) + " samples");
+          break;
       }
     }
 
     float setFrequency_Hz(float _freq_Hz) {
       freq1_Hz = _freq_Hz;
       sineWave1->frequency(freq1_Hz);
+      int tone_bin = (int)(freq1_Hz / (sample_rate_Hz / (float)Nfft) + 0.5f);
+      setGoertzelBin(tone_bin);                          //follow the tone
+      setTransferFunctionFirstBin(tone_bin - H1_N_BINS/2);  //keep the tone in the middle
       return freq1_Hz;
     }
 
@@ -207,17 +375,6 @@ class AudioPath_Sine_wFFT : public AudioPath_Base {
       return tone1_active;
     }
 
-    //Gather the queued data and compute the FFT.  Return zero if OK
-    int processFFT(int Ichan, AudioRecordQueue_F32 *queue) {
-      //Serial.println("AudioPath_Sine_wFFT: processFFT...");
-      float *fftMemory = allFftMemory_cmplx[Ichan];  //get pointer to FFT buffer that we're going to use
-      if (copyQueuesIntoFftBuffer(queue, fftMemory) != 0) return -1;  //copies from queue to fftMemory.  Releases all queues that are used
-      applyFftWindow(fftWindow, fftMemory, Nfft);    //apply window to data prior to computing the FFT
-      BTNRH_FFT::cha_fft_rc(fftMemory, Nfft);  //execute the FFT.  From Tympan_Library.  Results are in-place in fftMemory
-      for (int I=0; I < 2*(Nfft/2+1); I++) fftMemory[I] /= Nfft;  //normalize values by length of FFT (to get power instad of energy)
-      return 0;
-    }
-
     //Create a Hanning window function for use during FFT analysis
     static void computeFftWindow(int N, float *window) {
       if (window == NULL) return;
@@ -227,23 +384,295 @@ class AudioPath_Sine_wFFT : public AudioPath_Base {
       for (int I=0; I < N; I++) data[I] *= window[I];
     }
 
-    //access the FFT results
-    virtual int getNfft(void) { return Nfft; }
-    virtual float* getFftOutput_cmplx(int Ichan) { 
-      if ((Ichan>=0) && (Ichan <= (int)allFftMemory_cmplx.size())) {
-        return allFftMemory_cmplx[Ichan];
+    //Streaming analysis (both FFT modes): move the newly-queued audio into each channel's rolling buffer and, when a
+    //channel has moved by one hop, mark its frame as pending.  Then do one step of the FFT that is in progress, or start
+    //the next one.  To spread out the CPU load, each call does only one step.  If a queue is backing up anyway (loop() isn't
+    //being called often enough), that channel's pending frame is dropped so that the audio memory doesn't run out.
+    //Return zero if OK.
+    //The reference (the sine) is analyzed as one more channel (REF_CHAN).  To keep its frames in step with the inputs, it
+    //doesn't move on to its next frame until every input has caught up with its current frame, and it gets its FFT first.
+    int serviceStreamingFFT(void) {
+      const int n_stream = (analysis_mode == ANALYSIS_STREAMING_FFT) ? N_STREAM : N_CHAN;  //the reference is only for H1
+      const int hop = getFrameHop();
+      for (int Ichan = 0; Ichan < n_stream; Ichan++) {
+        AudioRecordQueue_F32 *queue = getStreamQueue(Ichan);
+        if ((Ichan == REF_CHAN) && (isReferenceAhead())) {
+          if (queue->available() > max_queued_blocks) {  //the inputs are holding back the reference, so drop their frames instead
+            for (int Iin = 0; Iin < N_CHAN; Iin++) if ((n_samples_in_ring[Iin] > 0) && (n_frames[Iin] < n_frames[REF_CHAN])) dropFrame(Iin);
+          }
+          if (isReferenceAhead()) continue;
+        }
+        while (queue->available() > 0) {
+          if (!canTakeBlock(Ichan, hop)) {  //don't overwrite a frame that is waiting for its FFT...
+            if (queue->available() <= max_queued_blocks) break;  //...the audio can wait in the queue
+            dropFrame(Ichan);  //...unless the queue is backing up
+          }
+          audio_block_f32_t *block = queue->getAudioBlock();
+          copyBlockIntoRing(Ichan, block->data, block->length);
+          queue->freeBuffer();
+          checkForNewFrame(Ichan, hop);
+        }
+      }
+
+      //start the next FFT (the reference first, then taking turns between the channels)
+      if (fft_chan < 0) {
+        int Ichan = -1;
+        if (frame_pending[REF_CHAN] && !isReferenceAhead()) {
+          Ichan = REF_CHAN;
+        } else {
+          for (int i = 0; i < N_CHAN; i++) {
+            int Itry = (next_fft_chan + i) % N_CHAN;
+            if (frame_pending[Itry]) { Ichan = Itry; next_fft_chan = (Itry + 1) % N_CHAN; break; }
+          }
+        }
+        if (Ichan < 0) return 0;  //nothing to do
+        if (fft->begin(getStreamRing(Ichan), ring_len, frame_start_ind[Ichan], fftWindow, fftWork) != 0) { frame_pending[Ichan] = false; return -1; }
+        fft_chan = Ichan;
+      }
+
+      //do the next step of the FFT.  When it's done, add it to the averages.
+      int ret_val = fft->step();
+      if (ret_val > 0) return 0;  //more steps to go
+      int Ichan = fft_chan;
+      fft_chan = -1;
+      frame_pending[Ichan] = false;
+      if (ret_val < 0) return -1;
+      ret_val = accumulateFrame(Ichan);
+      checkForNewFrame(Ichan, hop);  //the next frame might have come in while this one was being FFT'd
+      return ret_val;
+    }
+
+    //Add the channel's FFT (in fftWork) to its power spectrum (and its cross-spectrum with the reference).  Return zero if OK
+    int accumulateFrame(int Ichan) {
+      if (Ichan == REF_CHAN) {
+        accumulateReference(fftWork);
       } else {
-        return NULL;
+        //Welch: average the power spectra.  ANALYSIS_BLOCK_FFT doesn't average.
+        float *psd = allPowerSpectra[Ichan];
+        if (psd == NULL) return -1;
+        const int n_avg = (analysis_mode == ANALYSIS_STREAMING_FFT) ? n_welch_avg : 1;
+        const float new_weight = 1.0f / ((float)min(n_frames[Ichan] + 1, n_avg));
+        for (int Ibin=0; Ibin < Nfft/2+1; Ibin++) {
+          float real = fftWork[2*Ibin], imag = fftWork[2*Ibin+1];
+          psd[Ibin] += new_weight * ((real*real + imag*imag) - psd[Ibin]);
+        }
+
+        //cross-spectrum with the reference, if the reference's latest frame is this same frame
+        if ((analysis_mode == ANALYSIS_STREAMING_FFT) && (n_frames[Ichan] + 1 == n_frames[REF_CHAN]) && !ref_frame_dropped) accumulateCrossSpectrum(Ichan, fftWork);
+      }
+      n_frames[Ichan]++;
+      return 0;
+    }
+
+    //Is there stimulus (the sine) in this bin?  That is, is its Sxx within H1_STIMULUS_RANGE_DB of the biggest Sxx?
+    //Everywhere else, Sxx is just leakage and round-off, so H1 = Sxy/Sxx and the coherence there are meaningless.
+    bool hasStimulus(int Ibin) {
+      int I = Ibin - h1_first_bin;
+      if ((refPowerSpectrum == NULL) || (I < 0) || (I >= H1_N_BINS) || (refPowerSpectrum[I] <= 0.0f)) return false;
+      return refPowerSpectrum[I] >= ref_power_max * powf(10.0f, -0.1f*H1_STIMULUS_RANGE_DB);
+    }
+
+    //Get the transfer function H1 = Sxy/Sxx from the output (the sine) to the given input.  Returns zero if OK, or
+    //-1 if the bin has no stimulus (see hasStimulus()), including if it is outside of the H1_N_BINS that are kept.
+    int getTransferFunction(int Ichan, int Ibin, float *H_re, float *H_im) {
+      if ((Ichan < 0) || (Ichan >= N_CHAN) || (allCrossSpectra_cmplx[Ichan] == NULL)) return -1;
+      if (!hasStimulus(Ibin)) return -1;
+      int I = Ibin - h1_first_bin;
+      *H_re = allCrossSpectra_cmplx[Ichan][2*I] / refPowerSpectrum[I];
+      *H_im = allCrossSpectra_cmplx[Ichan][2*I+1] / refPowerSpectrum[I];
+      return 0;
+    }
+
+    //Get the coherence |Sxy|^2 / (Sxx Syy) between the output (the sine) and the given input (0.0 to 1.0).  Zero if
+    //the bin has no stimulus (see hasStimulus()).
+    float getCoherence(int Ichan, int Ibin) {
+      if ((Ichan < 0) || (Ichan >= N_CHAN) || (allCrossSpectra_cmplx[Ichan] == NULL)) return 0.0f;
+      if (!hasStimulus(Ibin)) return 0.0f;
+      int I = Ibin - h1_first_bin;
+      float Sxy_re = allCrossSpectra_cmplx[Ichan][2*I], Sxy_im = allCrossSpectra_cmplx[Ichan][2*I+1];
+      float denom = refPowerSpectrum[I] * allPowerSpectra[Ichan][Ibin];
+      if (denom <= 0.0f) return 0.0f;
+      return min(1.0f, (Sxy_re*Sxy_re + Sxy_im*Sxy_im) / denom);
+    }
+
+    //Send the transfer functions and coherences out the serial link in a compact binary format.  First, a text line
+    //"H1TF=<n_bytes>" and then the bytes themselves (little-endian):
+    //     uint8   version (H1_EXPORT_VERSION)
+    //     uint8   number of channels
+    //     uint16  number of bins (only the bins with stimulus...see hasStimulus())
+    //     uint16  first bin of the H1_N_BINS that are kept
+    //     uint16  Nfft
+    //     float32 sample rate (Hz)
+    //     uint16  number of reference frames averaged (saturates at 65535)
+    //     uint16  FFT bin number of each bin
+    //     then, for each channel and then each bin:
+    //       int16   |H1| (0.01 dB)
+    //       int16   phase of H1 (0.01 deg)
+    //       uint16  coherence (0 to 65535 for 0.0 to 1.0)
+    //See readTransferFunction.m for a decoder.  Returns the number of bytes.
+    int exportTransferFunction(void) {
+      int n_bins = 0;
+      for (int I = 0; I < H1_N_BINS; I++) if (hasStimulus(h1_first_bin + I)) n_bins++;
+      const int n_header_bytes = 14, n_bytes = n_header_bytes + n_bins * 2 + N_CHAN * n_bins * 6;
+      Serial.println("H1TF=" + String(n_bytes));
+
+      uint8_t header[n_header_bytes];
+      float fs = sample_rate_Hz;
+      uint16_t n_ref = (uint16_t)min(65535, n_ref_frames);
+      header[0] = H1_EXPORT_VERSION;
+      header[1] = (uint8_t)N_CHAN;
+      putUint16(header + 2, (uint16_t)n_bins);
+      putUint16(header + 4, (uint16_t)h1_first_bin);
+      putUint16(header + 6, (uint16_t)Nfft);
+      memcpy(header + 8, &fs, 4);
+      putUint16(header + 12, n_ref);
+      Serial.write(header, n_header_bytes);
+
+      uint8_t vals[6];
+      for (int I = 0; I < H1_N_BINS; I++) {
+        if (!hasStimulus(h1_first_bin + I)) continue;
+        putUint16(vals, (uint16_t)(h1_first_bin + I));
+        Serial.write(vals, 2);
+      }
+      for (int Ichan = 0; Ichan < N_CHAN; Ichan++) {
+        for (int I = 0; I < H1_N_BINS; I++) {
+          float H_re = 0.0f, H_im = 0.0f;
+          if (getTransferFunction(Ichan, h1_first_bin + I, &H_re, &H_im) != 0) continue;  //no stimulus, so not sent
+          float mag_dB = 10.0f*log10f(max(H_re*H_re + H_im*H_im, 1.0e-30f));
+          float phase_deg = (180.0f/(float)M_PI)*atan2f(H_im, H_re);
+          putUint16(vals + 0, (uint16_t)(int16_t)max(-32768.0f, min(32767.0f, roundf(100.0f * mag_dB))));
+          putUint16(vals + 2, (uint16_t)(int16_t)roundf(100.0f * phase_deg));
+          putUint16(vals + 4, (uint16_t)roundf(65535.0f * getCoherence(Ichan, h1_first_bin + I)));
+          Serial.write(vals, 6);
+        }
+      }
+      Serial.println();
+      return n_bytes;
+    }
+
+    //Goertzel analysis: run each channel's newly-queued audio through the Goertzel filter.  Return zero if OK
+    int serviceGoertzel(void) {
+      for (int Ichan = 0; Ichan < N_CHAN; Ichan++) {
+        AudioRecordQueue_F32 *queue = allQueues[Ichan];
+        while (queue->available() > 0) {
+          audio_block_f32_t *block = queue->getAudioBlock();
+          int n_done = 0;
+          while (n_done < block->length) n_done += updateGoertzel(Ichan, block->data + n_done, block->length - n_done);
+          queue->freeBuffer();
+        }
+      }
+      return 0;
+    }
+
+    //choose the FFT bin for the Goertzel filter (and start over)
+    int setGoertzelBin(int _bin) {
+      goertzel_bin = max(0, min(Nfft/2, _bin));
+      double w = 2.0 * M_PI * (double)goertzel_bin / (double)Nfft;
+      goertzel_cos = cos(w); goertzel_sin = sin(w);
+      resetGoertzel();
+      return goertzel_bin;
+    }
+    int getGoertzelBin(void) { return goertzel_bin; }
+    void resetGoertzel(void) {
+      for (int Ichan=0; Ichan < N_CHAN; Ichan++) {
+        goertzel_s1[Ichan] = 0.0; goertzel_s2[Ichan] = 0.0; goertzel_n[Ichan] = 0;
+        goertzel_result_cmplx[Ichan][0] = 0.0f; goertzel_result_cmplx[Ichan][1] = 0.0f;
+      }
+    }
+    float getGoertzelPhase_deg(int Ichan) {
+      if ((Ichan < 0) || (Ichan >= N_CHAN)) return 0.0f;
+      return (180.0f / (float)M_PI) * atan2f(goertzel_result_cmplx[Ichan][1], goertzel_result_cmplx[Ichan][0]);
+    }
+
+    //Check the Goertzel filter against the FFT (BTNRH_FFT::cha_fft_rc) on the same test signal: a sine at the Goertzel bin
+    //plus a sine between two other bins.  Prints both and returns the largest difference, relative to the tone's magnitude.
+    //Uses fftWork and one channel's Goertzel state, so the FFT analysis and the Goertzel analysis start over afterwards.
+    float checkGoertzel(void) {
+      if ((fftWork == NULL) || (fftWindow == NULL)) return -1.0f;
+      const int Ichan = N_CHAN-1;
+      resetStreamingAnalysis();  //fftWork is about to be used for the test
+      resetGoertzel();
+      for (int I=0; I < Nfft; I++) {
+        fftWork[I] = 0.1f*cosf(2.0f*(float)M_PI*goertzel_bin*I/(float)Nfft + 0.5f) + 0.05f*sinf(2.0f*(float)M_PI*(goertzel_bin*0.37f + 100.5f)*I/(float)Nfft);
+      }
+      int n_done = 0;
+      while (n_done < Nfft) n_done += updateGoertzel(Ichan, fftWork + n_done, min(audio_block_samples, Nfft - n_done));  //same blocking as the audio
+      applyFftWindow(fftWindow, fftWork, Nfft);
+      BTNRH_FFT::cha_fft_rc(fftWork, Nfft);
+      float fft_re = fftWork[2*goertzel_bin] / Nfft, fft_im = fftWork[2*goertzel_bin+1] / Nfft;
+      float g_re = goertzel_result_cmplx[Ichan][0], g_im = goertzel_result_cmplx[Ichan][1];
+      float fft_mag = sqrtf(fft_re*fft_re + fft_im*fft_im);
+      float rel_err = sqrtf((g_re-fft_re)*(g_re-fft_re) + (g_im-fft_im)*(g_im-fft_im)) / max(fft_mag, 1.0e-20f);
+      Serial.println("checkGoertzel: bin " + String(goertzel_bin) + ": FFT = " + String(fft_re,6) + " + " + String(fft_im,6) + "j, Goertzel = "
+        + String(g_re,6) + " + " + String(g_im,6) + "j, relative error = " + String(rel_err*1.0e6f,2) + " ppm" + String(rel_err < 1.0e-4f ? ".  OK." : ".  *** ERROR ***"));
+      resetGoertzel();
+      return rel_err;
+    }
+
+    //choose the FFT backend (see AnalysisFFT.h)
+    int setFftBackend(int _backend) {
+      AnalysisFFT_Base *new_fft = (_backend == BACKEND_BTNRH) ? (AnalysisFFT_Base *)&fft_btnrh : (AnalysisFFT_Base *)&fft_cmsis;
+      if (new_fft->getN() != Nfft) {
+        Serial.println("AudioPath_Sine_wFFT: setFftBackend: *** WARNING ***: " + String(new_fft->getName()) + " does not support Nfft = " + String(Nfft) + ".  Using BTNRH.");
+        new_fft = &fft_btnrh; _backend = BACKEND_BTNRH;
       }
+      if (fft_chan >= 0) { fft->abort(); fft_chan = -1; }  //the frame is still pending, so it will be FFT'd again by the new backend
+      fft = new_fft;  fft_backend = _backend;
+      return fft_backend;
     }
+    int getFftBackend(void) { return fft_backend; }
+
+    //Time each FFT backend (window, FFT, and normalize) for N = 256 to Nfft and check that they agree.  This takes
+    //nothing from the heap: it borrows three of the rolling buffers (ring_len floats each, which is more than the
+    //Nfft+2 outputs or the CMSIS twiddles need), so the analysis is stopped while it runs and then started over.
+    //Bigger N would not fit in the borrowed buffers, so they are not tested.
+    void benchmarkFftBackends(void) {
+      const int n_trials = 10;
+      float *out_btnrh = allRings[0], *out_cmsis = allRings[1], *twiddle = allRings[2];
+      if ((out_btnrh == NULL) || (out_cmsis == NULL) || (twiddle == NULL)) {
+        Serial.println("benchmarkFftBackends: *** ERROR ***: the rolling buffers were not allocated");
+        return;
+      }
+      stopRecording();   //this path is the active one (its commands only reach it then), so start it again at the end
+      clearRecording();  //forget any FFT in progress, as its buffers are about to be overwritten
+
+      Serial.println("benchmarkFftBackends: usec per FFT (including normalization), " + String(n_trials) + " trials each:");
+      for (int N = 256; N <= Nfft; N *= 2) {
+        AnalysisFFT_BTNRH btnrh;  btnrh.setup(N);
+        AnalysisFFT_CMSIS cmsis;
+        bool has_cmsis = cmsis.setup(N, twiddle);  //getTwiddleLength(N) <= ring_len
+
+        float usec_btnrh = timeFft(&btnrh, N, out_btnrh, n_trials), usec_cmsis = -1.0f, max_diff = 0.0f;
+        if (has_cmsis) {
+          usec_cmsis = timeFft(&cmsis, N, out_cmsis, n_trials);
+          for (int I=0; I < N+2; I++) max_diff = max(max_diff, fabsf(out_cmsis[I] - out_btnrh[I]));
+        }
+        Serial.print("  N = " + String(N) + ": BTNRH = " + String(usec_btnrh,1));
+        if (has_cmsis) {
+          Serial.println(", CMSIS = " + String(usec_cmsis,1) + " (" + String(usec_btnrh / usec_cmsis,1) + "x faster), max difference = " + String(max_diff*1.0e6f,3) + "e-6");
+        } else {
+          Serial.println(", CMSIS = (not supported)");
+        }
+      }
+
+      clearRecording();  //the rolling buffers now hold the benchmark's data
+      beginRecording();
+    }
+
+    //access the FFT results
+    virtual int getNfft(void) { return Nfft; }
+    virtual float* getPowerSpectrum(int Ichan) { return ((Ichan>=0) && (Ichan < N_CHAN)) ? allPowerSpectra[Ichan] : NULL; } //both FFT modes
+    virtual int getNumFrames(int Ichan) { return ((Ichan>=0) && (Ichan < N_CHAN)) ? n_frames[Ichan] : 0; }                  //both FFT modes
+    virtual int getNumDroppedFrames(int Ichan) { return ((Ichan>=0) && (Ichan < N_STREAM)) ? n_dropped_frames[Ichan] : 0; }  //both FFT modes (N_CHAN is the reference)
     virtual float getFftMag(int Ichan, int Ibin) {
-      if ((Ichan>=0) && (Ichan <= (int)allFftMemory_cmplx.size())) {
-        if ((Ibin >= 0) && (Ibin <= (Nfft/2+1))) {
-          float *buff_cmplx = allFftMemory_cmplx[Ichan];
-          float real = buff_cmplx[Ibin*2];
-          float imag = buff_cmplx[Ibin*2+1];
-          float mag = sqrtf( real*real + imag*imag );
-          return mag;          
+      if ((Ichan>=0) && (Ichan < N_CHAN)) {
+        if ((Ibin >= 0) && (Ibin <= (Nfft/2))) {
+          if (analysis_mode == ANALYSIS_GOERTZEL) {
+            if (Ibin != goertzel_bin) return 0.0;  //we only computed the one bin
+            float *g = goertzel_result_cmplx[Ichan];
+            return sqrtf(g[0]*g[0] + g[1]*g[1]);
+          }
+          if (allPowerSpectra[Ichan] != NULL) return sqrtf(allPowerSpectra[Ichan][Ibin]);
         }
       }
       return 0.0;
@@ -256,14 +685,62 @@ class AudioPath_Sine_wFFT : public AudioPath_Base {
 
     //data members for the audio queue and FFT analysis
     float                   sample_rate_Hz = 44100.0; //overwritten by constructor
-    std::vector<AudioRecordQueue_F32 *> allQueues;    //if you use the audioObjects vector from AudioPathBase, any allocation to this pointer will get automatically deleted
-    const int               Nfft = 2*4096;            //requires it to be poewr of 2 and requires it to be an integer multiple of the length of the samples in an audio block
-    int                     n_audio_blocks_required = -9999;  //will compute later, when we know the length of the data blocks
-    std::vector<float *>    allFftMemory_cmplx;
+    int                     audio_block_samples = AUDIO_BLOCK_SAMPLES;  //overwritten by constructor
+    int                     analysis_mode = ANALYSIS_STREAMING_FFT;
+    static const int        N_CHAN = 4;               //one queue (and FFT) per input channel
+    AudioRecordQueue_F32    *allQueues[N_CHAN] = {NULL};  //created by addAudioObject(), so AudioPath_Base owns them
+    const int               Nfft = 4096;              //requires it to be poewr of 2 and requires it to be an integer multiple of the length of the samples in an audio block
     float                   *fftWindow = NULL;
+
+    //data members for the FFT backends (see AnalysisFFT.h)
+    AnalysisFFT_CMSIS       fft_cmsis;
+    AnalysisFFT_BTNRH       fft_btnrh;
+    float                   *fft_cmsis_twiddle = NULL;
+    AnalysisFFT_Base        *fft = &fft_btnrh;       //overwritten by constructor
+    int                     fft_backend = BACKEND_BTNRH;
+
+    //data members for the streaming (Welch) analysis, which ANALYSIS_BLOCK_FFT also uses
+    float                   *allPowerSpectra[N_CHAN] = {NULL};
+    float                   *fftWork = NULL;
+    const int               max_hop_samples = Nfft;  //no overlap (but no gaps between the frames, either)
+    const int               ring_slack_samples = Nfft / 8;  //the rolling buffers have room for this many samples after the frame
+    const int               max_queued_blocks = 8;   //if a queue holds more than this, drop the channel's pending frame (see serviceStreamingFFT())
+    int                     hop_samples = 1024;      //overwritten by constructor
+    int                     n_welch_avg = 8;
+    static const int        REF_CHAN = N_CHAN;        //the reference (the sine) is analyzed after the inputs...
+    static const int        N_STREAM = N_CHAN + 1;    //...so the streaming analysis has one more channel
+    float                   *allRings[N_STREAM] = {NULL};  //the rolling buffers (ring_len samples each)
+    int                     ring_len = 0;            //Nfft + ring_slack_samples (set by the constructor)
+    int                     ring_write_ind[N_STREAM] = {0};
+    int                     n_samples_in_ring[N_STREAM] = {0};
+    int                     samples_since_frame[N_STREAM] = {0};  //since the end of the last frame
+    bool                    frame_pending[N_STREAM] = {false};    //waiting for (or in the middle of) its FFT
+    int                     frame_start_ind[N_STREAM] = {0};      //where the pending frame starts in the rolling buffer
+    int                     n_frames[N_STREAM] = {0};             //including the dropped ones, so that the inputs stay in step with the reference
+    int                     n_dropped_frames[N_STREAM] = {0};     //skipped because the queue backed up
+    bool                    ref_frame_dropped = false;           //the reference's latest frame was dropped, so there is no cross-spectrum for it
+    int                     next_fft_chan = 0;
+    int                     fft_chan = -1;           //the channel whose FFT is in progress (-1 for none)
+
+    //data members for the transfer function (ANALYSIS_STREAMING_FFT)
+    AudioRecordQueue_F32    *refQueue = NULL;         //created by addAudioObject(), so AudioPath_Base owns it
+    float                   *refSpectrum_cmplx = NULL;            //latest FFT of the reference (H1_N_BINS bins)
+    float                   *refPowerSpectrum = NULL;             //Sxx (H1_N_BINS bins)
+    float                   *allCrossSpectra_cmplx[N_CHAN] = {NULL};  //Sxy (H1_N_BINS bins)
+    int                     h1_first_bin = 0;        //overwritten by setFrequency_Hz()
+    int                     n_ref_frames = 0;
+    float                   ref_power_max = 0.0f;    //the biggest value in refPowerSpectrum (for hasStimulus())
+    int                     n_cross_frames[N_CHAN] = {0};
+
+    //data members for the Goertzel analysis
+    int                     goertzel_bin = 186;      //overwritten by setFrequency_Hz()
+    double                  goertzel_cos = 1.0, goertzel_sin = 0.0;
+    double                  goertzel_s1[N_CHAN] = {0.0}, goertzel_s2[N_CHAN] = {0.0};
+    int                     goertzel_n[N_CHAN] = {0};
+    float                   goertzel_result_cmplx[N_CHAN][2] = {{0.0f}};  //normalized like the FFT output (divided by Nfft)
         
     //data memebers for the sine wave generation
-    AudioSynthWaveform_F32  *sineWave1;  //if you use the audioObjects vector from AudioPathBase, any allocation to this pointer will get automatically deleted
+    AudioSynthWaveform_F32  *sineWave1;  //created by addAudioObject(), so AudioPath_Base owns it
     float                   freq1_Hz = 1000.0f;
     float                   sine1_amplitude = sqrtf(pow10f(0.1*-50.0));
     bool                    tone1_active = false;
@@ -274,17 +751,138 @@ class AudioPath_Sine_wFFT : public AudioPath_Base {
     float headphone_amp_gain_dB = 0.0;  //set the headphone gain: -6 to +14 dB (I think)
 
     //define private methods
-    int copyQueuesIntoFftBuffer(AudioRecordQueue_F32 *queue, float *fftBuffer) {
-      if (queue->available() < n_audio_blocks_required) return -1;
-      int Isamp_buffer = 0;
-      for (int Iblock=0; Iblock < n_audio_blocks_required; Iblock++) {
-        audio_block_f32_t *block = queue->getAudioBlock();  //gets pointer to audio block
-        for (int Isamp_block = 0; Isamp_block < block->length; Isamp_block++) {
-          if (Isamp_buffer < Nfft) fftBuffer[Isamp_buffer++] = block->data[Isamp_block];
-        }
-        queue->freeBuffer();
+    AudioRecordQueue_F32* getStreamQueue(int Ichan) { return (Ichan == REF_CHAN) ? refQueue : allQueues[Ichan]; }
+    float* getStreamRing(int Ichan) { return allRings[Ichan]; }
+    int getFrameHop(void) { return (analysis_mode == ANALYSIS_STREAMING_FFT) ? hop_samples : Nfft; }  //ANALYSIS_BLOCK_FFT doesn't overlap
+
+    //can another audio block go into the channel's rolling buffer?  Not if it would overwrite a frame that is waiting for
+    //its FFT, or (so that the frames stay exactly one hop apart) if it would go past the end of the next frame.
+    bool canTakeBlock(int Ichan, int hop) {
+      if (!frame_pending[Ichan]) return true;
+      return (samples_since_frame[Ichan] + audio_block_samples <= min(hop, ring_len - Nfft));
+    }
+
+    //skip the channel's pending frame (the queue is backing up).  It still counts in n_frames, so that the frames of
+    //the inputs and the reference keep matching up.
+    void dropFrame(int Ichan) {
+      if (!frame_pending[Ichan]) return;
+      if (fft_chan == Ichan) { fft->abort(); fft_chan = -1; }
+      frame_pending[Ichan] = false;
+      n_frames[Ichan]++;
+      n_dropped_frames[Ichan]++;
+      if (Ichan == REF_CHAN) ref_frame_dropped = true;
+    }
+
+    //if the channel has moved by one hop (and its last frame is done), its newest Nfft samples are the next frame
+    void checkForNewFrame(int Ichan, int hop) {
+      if (frame_pending[Ichan] || (n_samples_in_ring[Ichan] < Nfft) || (samples_since_frame[Ichan] < hop)) return;
+      if (samples_since_frame[Ichan] - hop + Nfft > n_samples_in_ring[Ichan]) samples_since_frame[Ichan] = hop;  //the first frame ends at the newest sample
+      int I = ring_write_ind[Ichan] - samples_since_frame[Ichan] + hop - Nfft;  //the frame ends exactly one hop after the last one
+      while (I < 0) I += ring_len;
+      frame_start_ind[Ichan] = I;
+      samples_since_frame[Ichan] -= hop;
+      frame_pending[Ichan] = true;
+    }
+
+    //is the reference a frame ahead of any input that is receiving audio?
+    bool isReferenceAhead(void) {
+      for (int Ichan = 0; Ichan < N_CHAN; Ichan++) {
+        if ((n_samples_in_ring[Ichan] > 0) && (n_frames[Ichan] < n_frames[REF_CHAN])) return true;
       }
-      return 0;
+      return false;
+    }
+
+    //keep the reference's FFT (for the cross-spectra) and average its power spectrum
+    void accumulateReference(const float *X) {
+      if ((refSpectrum_cmplx == NULL) || (refPowerSpectrum == NULL)) return;
+      const float new_weight = 1.0f / ((float)min(n_ref_frames + 1, n_welch_avg));
+      const float *Xb = X + 2*h1_first_bin;
+      ref_power_max = 0.0f;
+      for (int I = 0; I < H1_N_BINS; I++) {
+        float real = Xb[2*I], imag = Xb[2*I+1];
+        refSpectrum_cmplx[2*I] = real; refSpectrum_cmplx[2*I+1] = imag;
+        refPowerSpectrum[I] += new_weight * ((real*real + imag*imag) - refPowerSpectrum[I]);
+        ref_power_max = max(ref_power_max, refPowerSpectrum[I]);
+      }
+      n_ref_frames++;
+      ref_frame_dropped = false;
+    }
+
+    //average the cross-spectrum conj(X) Y between the reference and the given input: one complex multiply-accumulate per bin
+    void accumulateCrossSpectrum(int Ichan, const float *Y) {
+      float *Sxy = allCrossSpectra_cmplx[Ichan];
+      if ((Sxy == NULL) || (refSpectrum_cmplx == NULL)) return;
+      const float new_weight = 1.0f / ((float)min(n_cross_frames[Ichan] + 1, n_welch_avg));
+      const float *Yb = Y + 2*h1_first_bin;
+      for (int I = 0; I < H1_N_BINS; I++) {
+        float x_re = refSpectrum_cmplx[2*I], x_im = refSpectrum_cmplx[2*I+1], y_re = Yb[2*I], y_im = Yb[2*I+1];
+        Sxy[2*I]   += new_weight * ((x_re*y_re + x_im*y_im) - Sxy[2*I]);
+        Sxy[2*I+1] += new_weight * ((x_re*y_im - x_im*y_re) - Sxy[2*I+1]);
+      }
+      n_cross_frames[Ichan]++;
+    }
+
+    //empty all of the queues (inputs and reference) at once
+    void clearQueues(void) {
+      AudioNoInterrupts();
+      for (int Ichan=0; Ichan < N_CHAN; Ichan++) if (allQueues[Ichan] != NULL) allQueues[Ichan]->clear();
+      if (refQueue != NULL) refQueue->clear();
+      AudioInterrupts();
+    }
+
+    static void putUint16(uint8_t *bytes, uint16_t val) { bytes[0] = (uint8_t)(val & 0xFF); bytes[1] = (uint8_t)(val >> 8); }
+
+    //time one FFT backend on a test signal (two tones and a Hanning window).  Returns usec per FFT.
+    float timeFft(AnalysisFFT_Base *fft_backend, int N, float *output, int n_trials) {
+      uint32_t total_cycles = 0;
+      for (int Itrial=0; Itrial < n_trials; Itrial++) {
+        for (int I=0; I < N; I++) output[I] = 0.5f*(1.0f - cosf(2.0f*M_PI*(float)I/((float)N))) * (0.1f*sinf(0.1f*I) + 0.05f*cosf(0.731f*I));  //windowed test signal
+        uint32_t start = ARM_DWT_CYCCNT;
+        fft_backend->execute(output, 0, NULL, output);  //the window was already applied above, so that both backends see the same data
+        total_cycles += (ARM_DWT_CYCCNT - start);
+      }
+      return 1.0e6f * ((float)total_cycles) / ((float)n_trials) / ((float)F_CPU_ACTUAL);
+    }
+
+    static const char* analysisModeName(int mode) {
+      if (mode == ANALYSIS_STREAMING_FFT) return "streaming";
+      if (mode == ANALYSIS_GOERTZEL) return "Goertzel";
+      return "block";
+    }
+
+    //Run up to n samples through the channel's Goertzel filter, stopping at the end of an Nfft-sample frame.  Returns
+    //the number of samples used.  At the end of each frame, the result is exactly the FFT's value for goertzel_bin.
+    int updateGoertzel(int Ichan, const float *data, int n) {
+      int Isamp = goertzel_n[Ichan];
+      n = min(n, Nfft - Isamp);
+      const double coeff = 2.0 * goertzel_cos;
+      double s1 = goertzel_s1[Ichan], s2 = goertzel_s2[Ichan];  //double, because float loses about 4 digits over Nfft samples
+      for (int I=0; I < n; I++) {
+        double s0 = (double)(data[I] * fftWindow[Isamp + I]) + coeff * s1 - s2;
+        s2 = s1; s1 = s0;
+      }
+      Isamp += n;
+      if (Isamp >= Nfft) {
+        //one more step with zero input, so that the result has the same phase reference as the FFT
+        double s0 = coeff * s1 - s2;
+        goertzel_result_cmplx[Ichan][0] = (float)((s0 - goertzel_cos * s1) / (double)Nfft);
+        goertzel_result_cmplx[Ichan][1] = (float)((goertzel_sin * s1) / (double)Nfft);
+        s1 = 0.0; s2 = 0.0; Isamp = 0;
+      }
+      goertzel_s1[Ichan] = s1; goertzel_s2[Ichan] = s2; goertzel_n[Ichan] = Isamp;
+      return n;
+    }
+
+    void copyBlockIntoRing(int Ichan, const float *data, int n) {
+      float *ring = getStreamRing(Ichan);
+      int Iring = ring_write_ind[Ichan];
+      for (int I=0; I < n; I++) {
+        ring[Iring] = data[I];
+        if (++Iring >= ring_len) Iring = 0;
+      }
+      ring_write_ind[Ichan] = Iring;
+      n_samples_in_ring[Ichan] = min(ring_len, n_samples_in_ring[Ichan] + n);
+      samples_since_frame[Ichan] += n;
     }
 };
 
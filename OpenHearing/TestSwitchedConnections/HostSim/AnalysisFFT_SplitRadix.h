@@ -0,0 +1,140 @@
+#ifndef _HostSim_AnalysisFFT_SplitRadix_h
+#define _HostSim_AnalysisFFT_SplitRadix_h
+
+// AnalysisFFT_SplitRadix: an FFT backend for the host (PC), with the same interface as the ones in ../AnalysisFFT.h.
+// Like AnalysisFFT_CMSIS, it does the real FFT as a half-length complex FFT plus a split, with the window applied as
+// the data is packed and the 1/N folded into the split.  The complex FFT is a split-radix FFT (decimation in time,
+// recursive) on separate real and imaginary arrays, so that its butterflies work on 4 neighboring bins at once with
+// GCC's portable vector extensions (SSE on x86, NEON on ARM, or plain code anywhere else).  All of the twiddles are
+// computed once, in setup().  Works for any power of 2 from N = 8 up.
+//
+// This is for the host only (it uses the host's heap).  The Teensy's backends are in ../AnalysisFFT.h.
+
+#include "../AnalysisFFT.h"
+#include <vector>
+
+class AnalysisFFT_SplitRadix : public AnalysisFFT_Base {
+  public:
+    virtual const char* getName(void) { return "split-radix"; }
+    virtual bool isSupported(int _N) { return (_N >= 8) && ((_N & (_N-1)) == 0); }
+    bool setup(int _N) {
+      if (!isSupported(_N)) { N = 0; return false; }
+      N = _N;
+      const int M = N/2;  //the length of the complex FFT
+      in_re.assign(M, 0.0f); in_im.assign(M, 0.0f); out_re.assign(M, 0.0f); out_im.assign(M, 0.0f);
+
+      //the butterflies' twiddles for each length n = 4 to M: cos and sin of 2 pi k / n and of 2 pi 3k / n, for k < n/4
+      twiddle_offset.assign(32, 0);
+      tw_c1.clear(); tw_s1.clear(); tw_c3.clear(); tw_s3.clear();
+      for (int n = 4, Ilog2 = 2; n <= M; n *= 2, Ilog2++) {
+        twiddle_offset[Ilog2] = (int)tw_c1.size();
+        for (int k = 0; k < n/4; k++) {
+          double w = 2.0 * M_PI * (double)k / (double)n;
+          tw_c1.push_back((float)cos(w));     tw_s1.push_back((float)sin(w));
+          tw_c3.push_back((float)cos(3.0*w)); tw_s3.push_back((float)sin(3.0*w));
+        }
+      }
+
+      //the split's twiddles: cos and sin of 2 pi k / N, for k = 0 to N/4
+      split_twiddle.resize(2*(N/4 + 1));
+      for (int k = 0; k <= N/4; k++) {
+        double w = 2.0 * M_PI * (double)k / (double)N;
+        split_twiddle[2*k] = (float)cos(w); split_twiddle[2*k+1] = (float)sin(w);
+      }
+      return true;
+    }
+
+    virtual int execute(const float *input, int start_ind, const float *window, float *output) {
+      if (N == 0) return -1;
+      const int M = N/2;
+
+      //window the data and pack it as M complex values z[m] = x[2m] + j x[2m+1] (the input may be the output)
+      int I = start_ind;
+      for (int m = 0; m < M; m++) {
+        int I2 = I + 1;  if (I2 >= N) I2 = 0;
+        float w0 = 1.0f, w1 = 1.0f;
+        if (window != NULL) { w0 = window[2*m]; w1 = window[2*m+1]; }
+        in_re[m] = w0 * input[I];  in_im[m] = w1 * input[I2];
+        I += 2;  if (I >= N) I -= N;
+      }
+
+      fftSplitRadix(in_re.data(), in_im.data(), 1, out_re.data(), out_im.data(), M);
+      splitRealSpectrum(output);
+      return 0;
+    }
+
+  protected:
+    typedef float v4sf __attribute__ ((vector_size (16)));  //4 floats
+    std::vector<float> in_re, in_im, out_re, out_im;
+    std::vector<float> tw_c1, tw_s1, tw_c3, tw_s3, split_twiddle;
+    std::vector<int> twiddle_offset;  //where each length's butterfly twiddles start (by log2 of the length)
+
+    static v4sf load4(const float *p) { v4sf v; memcpy(&v, p, sizeof(v)); return v; }
+    static void store4(float *p, v4sf v) { memcpy(p, &v, sizeof(v)); }
+
+    //the complex FFT of the n values in[0], in[stride], in[2*stride], ... into out[0] to out[n-1]:
+    //  X[k] = E[k] + W^k O1[k] + W^3k O3[k],  where E is the FFT of the even values (length n/2), O1 and O3 are the
+    //  FFTs (length n/4) of the values at 4m+1 and 4m+3, and W = exp(-j 2 pi / n)
+    void fftSplitRadix(const float *xr, const float *xi, int stride, float *yr, float *yi, int n) {
+      if (n == 1) { yr[0] = xr[0]; yi[0] = xi[0]; return; }
+      if (n == 2) {
+        float ar = xr[0], ai = xi[0], br = xr[stride], bi = xi[stride];
+        yr[0] = ar + br; yi[0] = ai + bi; yr[1] = ar - br; yi[1] = ai - bi;
+        return;
+      }
+      const int n2 = n/2, n4 = n/4;
+      fftSplitRadix(xr, xi, 2*stride, yr, yi, n2);                                     //E into y[0 to n/2-1]
+      fftSplitRadix(xr + stride, xi + stride, 4*stride, yr + n2, yi + n2, n4);         //O1 into y[n/2 to 3n/4-1]
+      fftSplitRadix(xr + 3*stride, xi + 3*stride, 4*stride, yr + n2 + n4, yi + n2 + n4, n4);  //O3 into y[3n/4 to n-1]
+
+      int Ilog2 = 0;  while ((1 << Ilog2) < n) Ilog2++;
+      const float *c1 = tw_c1.data() + twiddle_offset[Ilog2], *s1 = tw_s1.data() + twiddle_offset[Ilog2];
+      const float *c3 = tw_c3.data() + twiddle_offset[Ilog2], *s3 = tw_s3.data() + twiddle_offset[Ilog2];
+      int k = 0;
+      for (; k + 4 <= n4; k += 4) {  //4 bins at a time
+        v4sf Zr = load4(yr + n2 + k), Zi = load4(yi + n2 + k), Z3r = load4(yr + n2 + n4 + k), Z3i = load4(yi + n2 + n4 + k);
+        v4sf C1 = load4(c1 + k), S1 = load4(s1 + k), C3 = load4(c3 + k), S3 = load4(s3 + k);
+        v4sf ar = C1*Zr + S1*Zi, ai = C1*Zi - S1*Zr;      //a = W^k O1[k], with W^k = c - j s
+        v4sf br = C3*Z3r + S3*Z3i, bi = C3*Z3i - S3*Z3r;  //b = W^3k O3[k]
+        v4sf sr = ar + br, si = ai + bi, dr = ar - br, di = ai - bi;
+        v4sf U0r = load4(yr + k), U0i = load4(yi + k), U1r = load4(yr + n4 + k), U1i = load4(yi + n4 + k);
+        store4(yr + k, U0r + sr);            store4(yi + k, U0i + si);             //X[k]
+        store4(yr + n2 + k, U0r - sr);       store4(yi + n2 + k, U0i - si);        //X[k + n/2]
+        store4(yr + n4 + k, U1r + di);       store4(yi + n4 + k, U1i - dr);        //X[k + n/4] = U1 - j (a - b)
+        store4(yr + n2 + n4 + k, U1r - di);  store4(yi + n2 + n4 + k, U1i + dr);   //X[k + 3n/4] = U1 + j (a - b)
+      }
+      for (; k < n4; k++) {  //the same, one bin at a time (for n < 16)
+        float Zr = yr[n2+k], Zi = yi[n2+k], Z3r = yr[n2+n4+k], Z3i = yi[n2+n4+k];
+        float ar = c1[k]*Zr + s1[k]*Zi, ai = c1[k]*Zi - s1[k]*Zr;
+        float br = c3[k]*Z3r + s3[k]*Z3i, bi = c3[k]*Z3i - s3[k]*Z3r;
+        float sr = ar + br, si = ai + bi, dr = ar - br, di = ai - bi;
+        float U0r = yr[k], U0i = yi[k], U1r = yr[n4+k], U1i = yi[n4+k];
+        yr[k] = U0r + sr;          yi[k] = U0i + si;
+        yr[n2+k] = U0r - sr;       yi[n2+k] = U0i - si;
+        yr[n4+k] = U1r + di;       yi[n4+k] = U1i - dr;
+        yr[n2+n4+k] = U1r - di;    yi[n2+n4+k] = U1i + dr;
+      }
+    }
+
+    //split the half-length complex FFT (in out_re and out_im) into the real FFT, normalized, as N/2+1 interleaved
+    //complex values.  The same as AnalysisFFT_CMSIS::splitRealSpectrum(), but reading from the separate arrays.
+    void splitRealSpectrum(float *output) {
+      const int M = N/2;
+      const float scale = 1.0f / (float)N, half_scale = 0.5f * scale;
+      float zr = out_re[0], zi = out_im[0];
+      output[0] = (zr + zi) * scale;  output[1] = 0.0f;  //DC
+      output[N] = (zr - zi) * scale;  output[N+1] = 0.0f; //Nyquist
+      for (int k = 1; k <= N/4; k++) {
+        const int k2 = M - k;
+        float a = out_re[k], b = out_im[k], c = out_re[k2], d = out_im[k2];
+        float Er = half_scale * (a + c), Ei = half_scale * (b - d);
+        float Or = half_scale * (a - c), Oi = half_scale * (b + d);
+        float cw = split_twiddle[2*k], sw = split_twiddle[2*k+1];
+        float Pr = cw * Or + sw * Oi, Pi = cw * Oi - sw * Or;  //P = W^k O
+        output[2*k]  = Er + Pi;  output[2*k+1]  = Ei - Pr;     //X[k]
+        output[2*k2] = Er - Pi;  output[2*k2+1] = -Ei - Pr;    //X[N/2-k]
+      }
+    }
+};
+
+#endif
@@ -0,0 +1 @@
+#include "Tympan_Library.h"
@@ -0,0 +1,253 @@
+#ifndef _HostSim_Tympan_Library_h
+#define _HostSim_Tympan_Library_h
+
+// Host (PC) stand-ins for the Tympan_Library pieces that this sketch uses, so that the sketch itself (its AudioPaths,
+// arena, and registry, and even TestSwitchedConnections.ino) can be compiled and run on a PC.  Only what the sketch
+// needs is here.  There is no audio interrupt: a test feeds the record queues by hand (see AudioRecordQueue_F32::push()).
+//
+// The audio objects keep about the same members as the library's (such as the record queue's 80 block pointers), so
+// that what they take from the arena is close to the Teensy's.  The host's pointers are twice as wide, so the host
+// needs a bit more arena than the Teensy for the same objects.
+
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <malloc.h>
+using std::min; using std::max;
+
+#define AUDIO_BLOCK_SAMPLES 128
+#define AUDIO_SAMPLE_RATE_EXACT 44117.64706f
+#define DMAMEM
+#define F(x) (x)
+inline float pow10f(float x) { return powf(10.0f, x); }
+
+//Arduino's String, as far as the sketch uses it
+struct String : std::string {
+  String(void) {}
+  String(const char *s) : std::string(s) {}
+  String(const std::string &s) : std::string(s) {}
+  String(char c) : std::string(1, c) {}
+  String(int v) : std::string(std::to_string(v)) {}
+  String(unsigned int v) : std::string(std::to_string(v)) {}
+  String(long v) : std::string(std::to_string(v)) {}
+  String(unsigned long v) : std::string(std::to_string(v)) {}
+  String(float v, int n_dec = 2) { char b[64]; snprintf(b, sizeof(b), "%.*f", n_dec, v); assign(b); }
+  String(double v, int n_dec = 2) { char b[64]; snprintf(b, sizeof(b), "%.*f", n_dec, v); assign(b); }
+};
+inline String operator+(const String &a, const String &b) { return String(std::string(a) + std::string(b)); }
+inline String operator+(const char *a, const String &b) { return String(std::string(a) + std::string(b)); }
+inline String operator+(const String &a, const char *b) { return String(std::string(a) + std::string(b)); }
+
+//the serial monitor.  Set quiet to hide the sketch's own printing.  Bytes from write() are only counted.
+struct HostSerial {
+  bool quiet = false;
+  size_t n_written = 0;
+  operator bool() const { return true; }
+  int available(void) { return 0; }
+  int read(void) { return -1; }
+  void print(const String &s) { if (!quiet) fputs(s.c_str(), stdout); }
+  void print(int v) { if (!quiet) printf("%d", v); }
+  void print(char c) { if (!quiet) putchar(c); }
+  void print(float v, int n_dec = 2) { if (!quiet) printf("%.*f", n_dec, v); }
+  void println(const String &s) { if (!quiet) puts(s.c_str()); }
+  void println(void) { if (!quiet) puts(""); }
+  size_t write(const uint8_t *, size_t n) { n_written += n; return n; }
+};
+static HostSerial Serial;
+
+//the host's clock
+inline unsigned long micros(void) {
+  using namespace std::chrono;
+  static auto t0 = steady_clock::now();
+  return (unsigned long)duration_cast<microseconds>(steady_clock::now() - t0).count();
+}
+inline unsigned long millis(void) { return micros() / 1000UL; }
+#define F_CPU_ACTUAL 600000000UL  //the host's "cycles" are its nanoseconds scaled to the Teensy 4's 600 MHz
+inline uint32_t hostCycleCount(void) {
+  using namespace std::chrono;
+  static auto t0 = steady_clock::now();
+  return (uint32_t)(0.6 * (double)duration_cast<nanoseconds>(steady_clock::now() - t0).count());
+}
+#define ARM_DWT_CYCCNT (hostCycleCount())
+inline void delay(unsigned long msec) { std::this_thread::sleep_for(std::chrono::milliseconds(msec)); }
+
+inline void AudioNoInterrupts(void) {}
+inline void AudioInterrupts(void) {}
+
+struct AudioSettings_F32 {
+  AudioSettings_F32(float fs, int n) : sample_rate_Hz(fs), audio_block_samples(n) {}
+  float sample_rate_Hz;
+  int audio_block_samples;
+};
+struct audio_block_f32_t { float data[AUDIO_BLOCK_SAMPLES]; int length = AUDIO_BLOCK_SAMPLES; unsigned long id = 0; int ref_count = 0; };
+
+//the audio memory, with the library's usage counters
+#define HOSTSIM_MAX_AUDIO_BLOCKS 256
+struct HostAudioMemory {
+  audio_block_f32_t blocks[HOSTSIM_MAX_AUDIO_BLOCKS];
+  int n_blocks = 60, n_used = 0, max_used = 0;
+};
+static HostAudioMemory hostAudioMemory;
+inline void AudioMemory_F32(int n, const AudioSettings_F32 &) { hostAudioMemory.n_blocks = min(n, HOSTSIM_MAX_AUDIO_BLOCKS); }
+inline int AudioMemoryUsage_F32(void) { return hostAudioMemory.n_used; }
+inline int AudioMemoryUsageMax_F32(void) { return hostAudioMemory.max_used; }
+inline void AudioMemoryUsageMaxReset_F32(void) { hostAudioMemory.max_used = hostAudioMemory.n_used; }
+
+class AudioStream_F32 {
+  public:
+    AudioStream_F32(int _n_inputs) : n_inputs(_n_inputs) {}
+    virtual ~AudioStream_F32(void) {}
+    virtual void update(void) {}
+    bool setActive(bool _active) { return active = _active; }
+    bool isActive(void) { return active; }
+    String instanceName;
+    static audio_block_f32_t *allocate_f32(void) {
+      for (int i = 0; i < hostAudioMemory.n_blocks; i++) {
+        audio_block_f32_t *b = &hostAudioMemory.blocks[i];
+        if (b->ref_count == 0) {
+          b->ref_count = 1; b->length = AUDIO_BLOCK_SAMPLES;
+          hostAudioMemory.max_used = max(hostAudioMemory.max_used, ++hostAudioMemory.n_used);
+          return b;
+        }
+      }
+      return NULL;
+    }
+    static void release(audio_block_f32_t *b) { if ((b) && (--(b->ref_count) == 0)) hostAudioMemory.n_used--; }
+  protected:
+    bool active = false;
+    unsigned char n_inputs = 0;
+    int cpu_cycles = 0, cpu_cycles_max = 0;
+    AudioStream_F32 *next_update = NULL;
+};
+
+class AudioConnection_F32 {
+  public:
+    AudioConnection_F32(AudioStream_F32 &_src, unsigned char _src_index, AudioStream_F32 &_dst, unsigned char _dst_index)
+      : src(&_src), dst(&_dst), src_index(_src_index), dest_index(_dst_index) {}
+  protected:
+    AudioStream_F32 *src, *dst;
+    unsigned char src_index, dest_index;
+    AudioConnection_F32 *next_dest = NULL;
+    bool isConnected = true;
+};
+
+class AudioSwitchMatrix4_F32 : public AudioStream_F32 {
+  public:
+    AudioSwitchMatrix4_F32(const AudioSettings_F32 &) : AudioStream_F32(4) {}
+  protected:
+    audio_block_f32_t *inputQueueArray[4];
+    int output_chan[4] = {0, 1, 2, 3};
+};
+
+class AudioSynthWaveform_F32 : public AudioStream_F32 {
+  public:
+    AudioSynthWaveform_F32(const AudioSettings_F32 &settings) : AudioStream_F32(0), sample_rate_Hz(settings.sample_rate_Hz) {}
+    void frequency(float f) { freq_Hz = f; }
+    void amplitude(float a) { amp = a; }
+  protected:
+    float sample_rate_Hz, freq_Hz = 0.0f, amp = 0.0f, phase = 0.0f, phase_inc = 0.0f, offset = 0.0f;
+    int waveform_type = 0;
+};
+
+class AudioEffectGain_F32 : public AudioStream_F32 {
+  public:
+    AudioEffectGain_F32(const AudioSettings_F32 &) : AudioStream_F32(1) {}
+    float setGain_dB(float g_dB) { gain = powf(10.0f, g_dB / 20.0f); return g_dB; }
+    float getGain_dB(void) { return 20.0f * log10f(gain); }
+  protected:
+    audio_block_f32_t *inputQueueArray[1];
+    float gain = 1.0f;
+};
+
+class AudioMixer8_F32 : public AudioStream_F32 {
+  public:
+    AudioMixer8_F32(const AudioSettings_F32 &) : AudioStream_F32(8) {}
+    void gain(unsigned int chan, float g) { if (chan < 8) multiplier[chan] = g; }
+  protected:
+    audio_block_f32_t *inputQueueArray[8];
+    float multiplier[8] = {1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f};
+};
+
+//the library's record queue: up to 80 blocks.  The host's push() stands in for the audio interrupt's update().
+class AudioRecordQueue_F32 : public AudioStream_F32 {
+  public:
+    AudioRecordQueue_F32(const AudioSettings_F32 &) : AudioStream_F32(1) {}
+    void begin(void) { clear(); enabled = true; }
+    void end(void) { enabled = false; }
+    int available(void) { int n = (int)head - (int)tail; return (n < 0) ? n + max_buffers : n; }
+    void clear(void) {
+      if (userblock) { release(userblock); userblock = NULL; }
+      while (tail != head) { if (++tail >= max_buffers) tail = 0; release(queue[tail]); }
+    }
+    float *readBuffer(void) { audio_block_f32_t *b = getAudioBlock(); return (b) ? b->data : NULL; }
+    audio_block_f32_t *getAudioBlock(void) {
+      if ((userblock) || (tail == head)) return NULL;
+      if (++tail >= max_buffers) tail = 0;
+      return userblock = queue[tail];
+    }
+    void freeBuffer(void) { if (userblock) { release(userblock); userblock = NULL; } }
+
+    //host only: queue a copy of n samples, as the audio interrupt would.  Returns false if dropped.
+    bool push(const float *x, int n = AUDIO_BLOCK_SAMPLES) {
+      if (!enabled) return false;
+      int h = head + 1;  if (h >= max_buffers) h = 0;
+      if (h == tail) return false;  //full
+      audio_block_f32_t *b = allocate_f32();
+      if (b == NULL) return false;  //out of audio memory
+      memcpy(b->data, x, n * sizeof(float)); b->length = n;
+      queue[h] = b; head = h;
+      return true;
+    }
+  protected:
+    static const int max_buffers = 80;
+    audio_block_f32_t *inputQueueArray[1];
+    audio_block_f32_t *queue[max_buffers];
+    audio_block_f32_t *userblock = NULL;
+    int head = 0, tail = 0;
+    bool enabled = false;
+};
+
+class AudioInputI2S_F32 : public AudioStream_F32 {
+  public:
+    AudioInputI2S_F32(const AudioSettings_F32 &) : AudioStream_F32(0) {}
+};
+class AudioOutputI2S_F32 : public AudioStream_F32 {
+  public:
+    AudioOutputI2S_F32(const AudioSettings_F32 &) : AudioStream_F32(2) {}
+  protected:
+    audio_block_f32_t *inputQueueArray[2];
+};
+
+//the codec controls only count how often they are called
+#define TYMPAN_INPUT_ON_BOARD_MIC    0
+#define TYMPAN_INPUT_JACK_AS_LINEIN  1
+enum class TympanRev { C, D, E, F };
+class Tympan {
+  public:
+    Tympan(void) {}
+    Tympan(TympanRev, const AudioSettings_F32 &) {}
+    void enable(void) {}
+    void muteHeadphone(void) { n_codec_calls++; }
+    void unmuteHeadphone(void) { n_codec_calls++; }
+    void muteDAC(void) { n_codec_calls++; }
+    void unmuteDAC(void) { n_codec_calls++; }
+    void enableDigitalMicInputs(bool) { n_codec_calls++; }
+    void inputSelect(int) { n_codec_calls++; }
+    void setInputGain_dB(float) { n_codec_calls++; }
+    void setDacGain_dB(float, float) { n_codec_calls++; }
+    void setHeadphoneGain_dB(float, float) { n_codec_calls++; }
+    void volume_dB(float) { n_codec_calls++; }
+    void printCPUandMemory(unsigned long, unsigned long) {}
+    long n_codec_calls = 0;
+};
+typedef Tympan EarpieceShield;
+
+#include "arm_math.h"
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef _HostSim_arm_const_structs_h
+#define _HostSim_arm_const_structs_h
+
+// Host (PC) stand-in for the CMSIS complex FFT instances (see arm_math.h in this folder)
+
+#include "arm_math.h"
+
+static const arm_cfft_instance_f32 arm_cfft_sR_f32_len16 = {16}, arm_cfft_sR_f32_len32 = {32}, arm_cfft_sR_f32_len64 = {64};
+static const arm_cfft_instance_f32 arm_cfft_sR_f32_len128 = {128}, arm_cfft_sR_f32_len256 = {256}, arm_cfft_sR_f32_len512 = {512};
+static const arm_cfft_instance_f32 arm_cfft_sR_f32_len1024 = {1024}, arm_cfft_sR_f32_len2048 = {2048}, arm_cfft_sR_f32_len4096 = {4096};
+
+#endif
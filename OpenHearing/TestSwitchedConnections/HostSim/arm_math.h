@@ -0,0 +1,39 @@
+#ifndef _HostSim_arm_math_h
+#define _HostSim_arm_math_h
+
+// Host (PC) stand-in for the CMSIS complex FFT that AnalysisFFT_CMSIS calls: arm_cfft_f32() for lengths 16 to 4096
+// (the same lengths as the Teensy's CMSIS tables), in place, with the same interleaved layout.  It is a plain radix-2
+// FFT in double precision, so it is for checking results, not for timing CMSIS.
+
+#include <cmath>
+#include <cstdint>
+#include <complex>
+#include <utility>
+
+typedef struct { uint16_t fftLen; } arm_cfft_instance_f32;
+
+inline void arm_cfft_f32(const arm_cfft_instance_f32 *S, float *p, uint8_t ifftFlag, uint8_t bitReverseFlag) {
+  const int n = S->fftLen;
+  static std::complex<double> a[4096];
+  for (int k = 0; k < n; k++) a[k] = std::complex<double>(p[2*k], p[2*k+1]);
+  for (int i = 1, j = 0; i < n; i++) {  //bit reversal
+    int bit = n >> 1;
+    for (; j & bit; bit >>= 1) j ^= bit;
+    j ^= bit;
+    if (i < j) std::swap(a[i], a[j]);
+  }
+  const double sign = (ifftFlag) ? 1.0 : -1.0;
+  for (int len = 2; len <= n; len <<= 1) {
+    for (int i = 0; i < n; i += len) {
+      for (int k = 0; k < len/2; k++) {
+        std::complex<double> w = std::polar(1.0, sign * 2.0 * M_PI * k / len);
+        std::complex<double> u = a[i+k], v = a[i+k+len/2] * w;
+        a[i+k] = u + v;  a[i+k+len/2] = u - v;
+      }
+    }
+  }
+  const double scale = (ifftFlag) ? 1.0 / n : 1.0;
+  for (int k = 0; k < n; k++) { p[2*k] = (float)(scale * a[k].real()); p[2*k+1] = (float)(scale * a[k].imag()); }
+}
+
+#endif
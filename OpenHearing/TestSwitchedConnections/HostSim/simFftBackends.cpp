@@ -0,0 +1,108 @@
+// simFftBackends: benchmarks the FFT backends (window, real FFT, and 1/N) on a PC for N = 256 to 16384, and checks each
+// one against a double-precision FFT.  The backends are:
+//   * split-radix: AnalysisFFT_SplitRadix (AnalysisFFT_SplitRadix.h in this folder), the host's SIMD backend
+//   * CMSIS: AnalysisFFT_CMSIS from ../AnalysisFFT.h, running on this folder's stand-in arm_cfft_f32() (a plain radix-2
+//     FFT in double, not ARM's code).  Like the Teensy's CMSIS, it stops at 4096 complex points, so N = 8192 at most.
+//   * BTNRH: AnalysisFFT_BTNRH from ../AnalysisFFT.h, running on this folder's stand-in cha_fft_rc() (the same plain
+//     radix-2 FFT in double, not the library's code)
+// So only the split-radix times mean anything for the host.  The CMSIS and BTNRH times here are for the stand-ins;
+// the Teensy's own times for those two come from the FFT path's 'X' command (N = 256 to Nfft).  It also checks that
+// the split-radix backend's staged FFT (begin() and step(), from a circular buffer that wraps) gives the same result.
+//
+// To build and run (from this folder):
+//     g++ -std=gnu++17 -O2 -Wno-deprecated-declarations -I. simFftBackends.cpp -o simFftBackends && ./simFftBackends
+
+#include <Tympan_Library.h>
+#include <complex>
+#include <vector>
+#include "AnalysisFFT_SplitRadix.h"
+
+//the reference: window and FFT in double, then divide by N (N/2+1 bins)
+void referenceFft(const std::vector<float> &x, const std::vector<float> &window, std::vector<std::complex<double>> &X) {
+  const int N = (int)x.size();
+  std::vector<std::complex<double>> a(N);
+  for (int i = 0; i < N; i++) a[i] = (double)x[i] * (double)window[i];
+  for (int i = 1, j = 0; i < N; i++) {  //bit reversal
+    int bit = N >> 1;
+    for (; j & bit; bit >>= 1) j ^= bit;
+    j ^= bit;
+    if (i < j) std::swap(a[i], a[j]);
+  }
+  for (int len = 2; len <= N; len <<= 1) {
+    for (int i = 0; i < N; i += len) {
+      for (int k = 0; k < len/2; k++) {
+        std::complex<double> u = a[i+k], v = a[i+k+len/2] * std::polar(1.0, -2.0 * M_PI * k / len);
+        a[i+k] = u + v;  a[i+k+len/2] = u - v;
+      }
+    }
+  }
+  X.resize(N/2 + 1);
+  for (int k = 0; k <= N/2; k++) X[k] = a[k] / (double)N;
+}
+
+//the largest error re: the largest bin
+double maxError(const float *out, const std::vector<std::complex<double>> &X) {
+  double max_err = 0.0, max_mag = 0.0;
+  for (int k = 0; k < (int)X.size(); k++) {
+    max_err = std::max(max_err, std::abs(std::complex<double>(out[2*k], out[2*k+1]) - X[k]));
+    max_mag = std::max(max_mag, std::abs(X[k]));
+  }
+  return max_err / max_mag;
+}
+
+//usec per FFT (the fastest of a few runs, to steady the host's times), and the error of the last one
+double timeFft(AnalysisFFT_Base *fft, const std::vector<float> &x, const std::vector<float> &window, std::vector<float> &out,
+               const std::vector<std::complex<double>> &X, double &err) {
+  const int N = (int)x.size(), n_trials = std::max(5, 400000 / N);
+  double best_usec = 1.0e30;
+  for (int Irep = 0; Irep < 7; Irep++) {
+    auto t0 = std::chrono::steady_clock::now();
+    for (int t = 0; t < n_trials; t++) fft->execute(x.data(), 0, window.data(), out.data());
+    auto t1 = std::chrono::steady_clock::now();
+    best_usec = std::min(best_usec, std::chrono::duration<double, std::micro>(t1 - t0).count() / n_trials);
+  }
+  err = maxError(out.data(), X);
+  return best_usec;
+}
+
+int main(void) {
+  printf("simFftBackends: host usec per FFT (window, FFT, and 1/N), and the largest error re: the largest bin\n");
+  printf("      N     split-radix            CMSIS (stand-in)          BTNRH (stand-in)\n");
+  bool pass = true;
+  for (int N = 256; N <= 16384; N *= 2) {
+    std::vector<float> x(N), window(N), out(N + 2);
+    for (int i = 0; i < N; i++) {
+      window[i] = 0.5f*(1.0f - cosf(2.0f*(float)M_PI*(float)i/((float)N)));  //the same Hanning window as AudioPath_Sine_wFFT
+      x[i] = 0.1f*sinf(0.1f*i) + 0.05f*cosf(0.731f*i) + 0.001f*(float)((i*7919) % 1000 - 500) / 500.0f;
+    }
+    std::vector<std::complex<double>> X;
+    referenceFft(x, window, X);
+
+    AnalysisFFT_SplitRadix split;  split.setup(N);
+    AnalysisFFT_BTNRH btnrh;       btnrh.setup(N);
+    AnalysisFFT_CMSIS cmsis;
+    std::vector<float> twiddle(AnalysisFFT_CMSIS::getTwiddleLength(N));
+    bool has_cmsis = cmsis.setup(N, twiddle.data());
+
+    double err_split, err_cmsis = 0.0, err_btnrh;
+    double usec_split = timeFft(&split, x, window, out, X, err_split);
+    double usec_cmsis = has_cmsis ? timeFft(&cmsis, x, window, out, X, err_cmsis) : 0.0;
+    double usec_btnrh = timeFft(&btnrh, x, window, out, X, err_btnrh);
+
+    //the staged split-radix FFT, from a circular buffer of N + N/8 samples whose frame wraps around its end
+    const int ring_len = N + N/8, start_ind = N/2;
+    std::vector<float> ring(ring_len), staged(N + 2);
+    for (int i = 0; i < N; i++) ring[(start_ind + i) % ring_len] = x[i];
+    int ret = split.begin(ring.data(), ring_len, start_ind, window.data(), staged.data());
+    if (ret == 0) do { ret = split.step(); } while (ret > 0);
+    bool staged_ok = (ret == 0) && (maxError(staged.data(), X) == err_split);
+
+    bool ok = (err_split < 1.0e-5) && (err_btnrh < 1.0e-5) && (!has_cmsis || (err_cmsis < 1.0e-5)) && staged_ok;
+    printf("  %5d   %8.2f (%.1e)    ", N, usec_split, err_split);
+    if (has_cmsis) printf("%8.2f (%.1e)      ", usec_cmsis, err_cmsis); else printf("(not supported)         ");
+    printf("%8.2f (%.1e)    staged %s  %s\n", usec_btnrh, err_btnrh, staged_ok ? "same" : "DIFFERENT", ok ? "PASS" : "FAIL");
+    pass = pass && ok;
+  }
+  printf("simFftBackends: %s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+// simGoertzel: checks that the FFT path's Goertzel filter (ANALYSIS_GOERTZEL) gives the same complex value as
+// BTNRH_FFT::cha_fft_rc() for the same Hanning-windowed Nfft-sample frame, by running the sketch itself
+// (../TestSwitchedConnections.ino) on a PC.  For several bins, from 1 to Nfft/2-1, it:
+//   * runs the path's own 'k' check (checkGoertzel()), which feeds a test signal straight to the Goertzel filter
+//   * feeds a tone plus noise through the path's record queues in audio blocks, with serviceMainLoop() called after
+//     each block as loop() would, and compares the Goertzel result with cha_fft_rc() of the same frame
+// Both must agree to within 1e-4 of the tone's magnitude (float round-off in the FFT; the Goertzel runs in double).
+//
+// To build and run (from this folder), with this folder's stand-in cha_fft_rc() (utility/BTNRH_rfft.h):
+//     g++ -std=gnu++17 -O2 -Wno-deprecated-declarations -I. simGoertzel.cpp -o simGoertzel && ./simGoertzel
+//
+// To build it with the Tympan_Library's own cha_fft_rc() (TYMPAN_LIBRARY is where the library is installed, such as
+// ~/Arduino/libraries/Tympan_Library).  This folder must stay first on the include path, so that the sketch still
+// gets the stand-ins for everything else:
+//     g++ -std=gnu++17 -O2 -Wno-deprecated-declarations -DHOSTSIM_LIBRARY_BTNRH_FFT -I. -I$TYMPAN_LIBRARY/src \
+//         simGoertzel.cpp $TYMPAN_LIBRARY/src/utility/BTNRH_rfft.cpp -o simGoertzel && ./simGoertzel
+
+#include <Tympan_Library.h>
+#include <complex>
+#include <random>
+#include <vector>
+#include "../TestSwitchedConnections.ino"
+
+//find the FFT path
+AudioPath_Sine_wFFT *findFftPath(int &index) {
+  for (index = 0; index < audioPaths.getNumPaths(); index++) {
+    AudioPath_Sine_wFFT *path = dynamic_cast<AudioPath_Sine_wFFT *>(audioPaths.getPath(index));
+    if (path != NULL) return path;
+  }
+  return NULL;
+}
+
+//push a block into each of the FFT path's input queues, as the audio interrupt would (the queues are protected members)
+struct FftPathAccess : AudioPath_Sine_wFFT {
+  static void pushInputs(AudioPath_Sine_wFFT *path, const float *x, int n) {
+    FftPathAccess *p = (FftPathAccess *)path;
+    for (int Ichan = 0; Ichan < N_CHAN; Ichan++) p->allQueues[Ichan]->push(x, n);
+  }
+};
+
+//the Goertzel result through the queues, against cha_fft_rc() of the same frame.  Returns the error relative to the FFT's magnitude.
+float checkThroughQueues(AudioPath_Sine_wFFT *path, int bin) {
+  const int N = path->getNfft(), Ichan = 0;
+  std::mt19937 rng(bin);
+  std::normal_distribution<float> noise(0.0f, 0.01f);
+  std::vector<float> x(N + 2), fft(N + 2);
+  for (int i = 0; i < N; i++) x[i] = 0.1f * cosf(2.0f * (float)M_PI * ((float)bin + 0.23f) * (float)i / (float)N + 0.7f) + noise(rng);  //off-bin, so its leakage matters
+
+  path->setGoertzelBin(bin);
+  for (int i = 0; i < N; i += AUDIO_BLOCK_SAMPLES) {
+    FftPathAccess::pushInputs(path, &x[i], AUDIO_BLOCK_SAMPLES);
+    path->serviceMainLoop();
+  }
+  float mag = path->getFftMag(Ichan, bin), phase_rad = path->getGoertzelPhase_deg(Ichan) * (float)M_PI / 180.0f;
+  std::complex<float> g = std::polar(mag, phase_rad);
+
+  for (int i = 0; i < N; i++) fft[i] = x[i] * 0.5f * (1.0f - cosf(2.0f * (float)M_PI * (float)i / (float)N));  //the path's Hanning window
+  BTNRH_FFT::cha_fft_rc(fft.data(), N);
+  std::complex<float> X(fft[2 * bin] / N, fft[2 * bin + 1] / N);
+  return std::abs(g - X) / std::max(std::abs(X), 1.0e-20f);
+}
+
+int main(void) {
+  Serial.quiet = true;
+  setup();
+  int fft_index = 0;
+  AudioPath_Sine_wFFT *path = findFftPath(fft_index);
+  activateOneAudioPath(fft_index);
+  path->respondToByte('g');  //ANALYSIS_GOERTZEL
+  Serial.quiet = false;
+
+  const int N = path->getNfft();
+#ifdef HOSTSIM_LIBRARY_BTNRH_FFT
+  printf("simGoertzel: Nfft = %d, against the Tympan_Library's cha_fft_rc()\n", N);
+#else
+  printf("simGoertzel: Nfft = %d, against the stand-in cha_fft_rc() in utility/BTNRH_rfft.h (not the library's)\n", N);
+#endif
+  printf("     bin    'k' check (ppm)    through the queues (ppm)\n");
+  bool pass = true;
+  for (int bin : {1, 7, 43, 100, 512, 1000, 1500, N / 2 - 1}) {
+    Serial.quiet = true;
+    path->setGoertzelBin(bin);
+    float err_k = path->checkGoertzel();
+    float err_q = checkThroughQueues(path, bin);
+    Serial.quiet = false;
+    bool ok = (err_k >= 0.0f) && (err_k < 1.0e-4f) && (err_q < 1.0e-4f);
+    printf("    %4d    %10.2f         %10.2f           %s\n", bin, err_k * 1.0e6f, err_q * 1.0e6f, ok ? "PASS" : "FAIL");
+    pass = pass && ok;
+  }
+
+  printf("simGoertzel: %s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
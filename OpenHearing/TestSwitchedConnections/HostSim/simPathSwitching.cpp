@@ -0,0 +1,142 @@
+// simPathSwitching: runs the sketch itself (../TestSwitchedConnections.ino, with all of its AudioPaths) on a PC to check
+// that switching between the AudioPaths never touches the heap, and to measure how much of the arena is used.  It:
+//   * builds and connects everything as setup() does, and reports the arena's high-water mark (getBytesUsed()) against
+//     AUDIO_PATH_ARENA_BYTES
+//   * runs the sketch's own testSwitchingAudioPaths() for 100000 switches (its heap check is printed as "OK" or "ERROR")
+//   * checks the heap again around 100000 more switches with audio pushed into the FFT path's queues and its
+//     serviceMainLoop() called, as loop() would, and checks that the arena did not grow
+//   * feeds the FFT path a continuous tone, first with enough serviceMainLoop() calls per block and then with too few,
+//     and checks that the second case drops (and counts) frames instead of letting the queues back up, and that H1 from
+//     the tone to the inputs (which are the tone, too) is still 0 dB and 0 deg afterwards
+//   * runs the FFT path's benchmark ('X'), which must not take anything from the heap either
+// The host's objects are a little bigger than the Teensy's (8-byte pointers, and a 32-byte String), so the arena
+// that the host needs is an upper bound on what the Teensy needs.  The Teensy prints its own figure at boot.
+//
+// To build and run (from this folder):
+//     g++ -std=gnu++17 -O2 -Wno-deprecated-declarations -I. simPathSwitching.cpp -o simPathSwitching && ./simPathSwitching
+
+#include <Tympan_Library.h>
+#include "../TestSwitchedConnections.ino"
+
+//find the FFT path, so that we can feed its queues
+AudioPath_Sine_wFFT *findFftPath(int &index) {
+  for (index = 0; index < audioPaths.getNumPaths(); index++) {
+    AudioPath_Sine_wFFT *path = dynamic_cast<AudioPath_Sine_wFFT *>(audioPaths.getPath(index));
+    if (path != NULL) return path;
+  }
+  return NULL;
+}
+
+//push a block into each of the FFT path's queues, as the audio interrupt would (the queues are protected members of the path)
+struct FftPathAccess : AudioPath_Sine_wFFT {
+  static void pushAll(AudioPath_Sine_wFFT *path, const float *x) {
+    FftPathAccess *p = (FftPathAccess *)path;
+    for (int Ichan = 0; Ichan < N_CHAN; Ichan++) p->allQueues[Ichan]->push(x);
+    p->refQueue->push(x);
+  }
+  static int maxQueued(AudioPath_Sine_wFFT *path) {
+    FftPathAccess *p = (FftPathAccess *)path;
+    int n = p->refQueue->available();
+    for (int Ichan = 0; Ichan < N_CHAN; Ichan++) n = max(n, p->allQueues[Ichan]->available());
+    return n;
+  }
+  static int getMaxQueuedBlocks(AudioPath_Sine_wFFT *path) { return ((FftPathAccess *)path)->max_queued_blocks; }
+  static float getToneFreq_Hz(AudioPath_Sine_wFFT *path) { return ((FftPathAccess *)path)->freq1_Hz; }
+};
+
+//feed the FFT path n_blocks of a continuous tone (at its own frequency), calling serviceMainLoop() n_service times per
+//block.  Returns the most blocks left in any queue after the service calls.
+int feedTone(AudioPath_Sine_wFFT *fft_path, int n_blocks, int n_service, long &Isamp) {
+  static float x[AUDIO_BLOCK_SAMPLES];
+  const float w = 2.0f * (float)M_PI * FftPathAccess::getToneFreq_Hz(fft_path) / sample_rate_Hz;
+  int max_queued = 0;
+  for (int Iblock = 0; Iblock < n_blocks; Iblock++) {
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++, Isamp++) x[i] = 0.1f * sinf(w * (float)(Isamp % 96000L));  //1000 Hz is periodic in 96000 samples
+    FftPathAccess::pushAll(fft_path, x);
+    for (int Iservice = 0; Iservice < n_service; Iservice++) fft_path->serviceMainLoop();
+    max_queued = max(max_queued, FftPathAccess::maxQueued(fft_path));
+  }
+  return max_queued;
+}
+
+//H1 from the tone to input 0, at the tone's bin
+bool checkH1(AudioPath_Sine_wFFT *fft_path, const char *label) {
+  int bin = (int)(FftPathAccess::getToneFreq_Hz(fft_path) / (sample_rate_Hz / (float)fft_path->getNfft()) + 0.5f);
+  float H_re = 0.0f, H_im = 0.0f;
+  bool has_H1 = (fft_path->getTransferFunction(0, bin, &H_re, &H_im) == 0);
+  float mag_dB = 10.0f * log10f(H_re * H_re + H_im * H_im), phase_deg = (180.0f / (float)M_PI) * atan2f(H_im, H_re);
+  bool ok = has_H1 && (fabsf(mag_dB) < 0.01f) && (fabsf(phase_deg) < 0.1f);
+  printf("  %s: %d frames, %d dropped (reference: %d dropped), H1 = %.3f dB, %.2f deg, coherence = %.4f (%s)\n", label,
+         fft_path->getNumFrames(0), fft_path->getNumDroppedFrames(0), fft_path->getNumDroppedFrames(4), mag_dB, phase_deg,
+         fft_path->getCoherence(0, bin), ok ? "PASS" : "FAIL");
+  return ok;
+}
+
+int main(void) {
+  printf("simPathSwitching: the sketch's setup():\n");
+  setup();
+  size_t arena_used = audioPathArena.getBytesUsed();
+  printf("Arena: %d of %d bytes used (%.1f kB of %.1f kB)\n", (int)arena_used, (int)AUDIO_PATH_ARENA_BYTES, arena_used / 1024.0, AUDIO_PATH_ARENA_BYTES / 1024.0);
+  bool pass = (arena_used <= AUDIO_PATH_ARENA_BYTES);
+
+  printf("\nThe sketch's testSwitchingAudioPaths(100000) ('S' runs it with 2000):\n");
+  testSwitchingAudioPaths(100000);
+
+  //switch with audio flowing into the FFT path, and with its main-loop service running
+  int fft_index = 0;
+  AudioPath_Sine_wFFT *fft_path = findFftPath(fft_index);
+  static float x[AUDIO_BLOCK_SAMPLES];
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) x[i] = 0.1f * sinf(0.05f * i);
+  const int n_switches = 100000;
+  Serial.quiet = true;
+  struct mallinfo before = mallinfo();
+  for (int i = 0; i < n_switches; i++) {
+    int index = i % audioPaths.getNumPaths();
+    activateOneAudioPath(index);
+    if (index == fft_index) {
+      for (int Iblock = 0; Iblock < 4; Iblock++) {
+        FftPathAccess::pushAll(fft_path, x);
+        for (int Iservice = 0; Iservice < 8; Iservice++) fft_path->serviceMainLoop();
+      }
+    }
+  }
+  struct mallinfo after = mallinfo();
+  Serial.quiet = false;
+  bool heap_ok = (after.uordblks == before.uordblks), arena_ok = (audioPathArena.getBytesUsed() == arena_used);
+  printf("\n%d more switches, with audio into the FFT path: heap before = %d, after = %d bytes (%s); arena %s\n", n_switches,
+         (int)before.uordblks, (int)after.uordblks, heap_ok ? "PASS" : "FAIL", arena_ok ? "unchanged (PASS)" : "GREW (FAIL)");
+  pass = pass && heap_ok && arena_ok;
+
+  //too few calls to serviceMainLoop(): frames are dropped (and counted), but the queues don't back up and H1 is still right
+  printf("\nThe FFT path, fed a tone with 8 and then 1 serviceMainLoop() per block (the FFTs need about 5):\n");
+  activateOneAudioPath(fft_index);
+  Serial.quiet = true;
+  fft_path->resetStreamingAnalysis();
+  long Isamp = 0;
+  int max_queued_fast = feedTone(fft_path, 400, 8, Isamp);
+  bool fast_ok = (fft_path->getNumDroppedFrames(0) == 0);
+  Serial.quiet = false;
+  fast_ok = checkH1(fft_path, "8 per block") && fast_ok;
+  Serial.quiet = true;
+  int max_queued_slow = feedTone(fft_path, 400, 1, Isamp);
+  bool slow_ok = (fft_path->getNumDroppedFrames(0) > 0) && (max_queued_slow <= FftPathAccess::getMaxQueuedBlocks(fft_path));
+  Serial.quiet = false;
+  slow_ok = checkH1(fft_path, "1 per block") && slow_ok;
+  printf("  most blocks left in a queue: %d and %d (max_queued_blocks = %d)\n", max_queued_fast, max_queued_slow, FftPathAccess::getMaxQueuedBlocks(fft_path));
+  pass = pass && fast_ok && slow_ok;
+
+  //the FFT benchmark must not use the heap either
+  printf("\nThe FFT path's 'X' command (host times, not the Teensy's):\n");
+  activateOneAudioPath(fft_index);
+  //run it once first: glibc keeps some of the freed blocks (such as the printed Strings) in a cache, which mallinfo() counts as in use
+  Serial.quiet = true;  fft_path->respondToByte('X');  Serial.quiet = false;
+  before = mallinfo();
+  fft_path->respondToByte('X');
+  after = mallinfo();
+  heap_ok = (after.uordblks == before.uordblks);
+  printf("FFT benchmark: heap before = %d, after = %d bytes (%s)\n", (int)before.uordblks, (int)after.uordblks, heap_ok ? "PASS" : "FAIL");
+  pass = pass && heap_ok;
+
+  printf("\nsimPathSwitching: %s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
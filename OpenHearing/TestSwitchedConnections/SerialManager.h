@@ -14,13 +14,14 @@
 
 //variables in the main sketch that I want to call from here
 extern Tympan myTympan;
-extern std::vector<AudioPath_Base *> allAudioPaths;
+extern AudioPathRegistry audioPaths;
 
 //functions in the main sketch that I want to call from here
 extern void togglePrintMemoryAndCPU(void);
 extern void deactivateAllAudioPaths(void);
 extern int activateOneAudioPath(int index);
 AudioPath_Base *getActiveAudioPath(void);
+extern void testSwitchingAudioPaths(int n_switches);
 
 //now, define the Serial Manager class
 class SerialManager {
@@ -39,12 +40,13 @@ void SerialManager::printHelp(void) {
   Serial.println("   h: Print this help");
   Serial.println("   C: Toggle printing of CPU and Memory usage");
   Serial.println("   0: De-activate all audio paths");
+  Serial.println("   S: Switch between the audio paths 2000 times and check that the heap doesn't change");
 
   //auto-populate entries for the audio paths that have already been created
-  for (int i=0; i < (int)allAudioPaths.size(); i++) {
+  for (int i=0; i < audioPaths.getNumPaths(); i++) {
     Serial.print("   ");  Serial.print(i+1); 
     Serial.print(": Activate only Audio Path "); Serial.print(i+1);
-    Serial.print(" (" + allAudioPaths[i]->name + ")");
+    Serial.print(" (" + audioPaths.getPath(i)->name + ")");
     Serial.println();
   }
 
@@ -61,9 +63,9 @@ void SerialManager::printHelp(void) {
 bool SerialManager::interpretAsSwitchAudioPath(char c) {
   bool was_switch_command = false;
   int possible_audio_path_index = (int)(c - '1');
-  if ((possible_audio_path_index >= 0) && (possible_audio_path_index < (int)allAudioPaths.size())) {
+  if ((possible_audio_path_index >= 0) && (possible_audio_path_index < audioPaths.getNumPaths())) {
     Serial.print("SerialManager: Received "); Serial.print(c);
-    Serial.println(": switching to " + allAudioPaths[possible_audio_path_index]->name + "...");
+    Serial.println(": switching to " + audioPaths.getPath(possible_audio_path_index)->name + "...");
     activateOneAudioPath(possible_audio_path_index);  //de-activate all and then activate just the second audio path
     was_switch_command = true;  
   }
@@ -86,6 +88,10 @@ void SerialManager::respondToByte(char c) {
       Serial.println("SerialManager: Received 0: de-activating all audio paths...");
       deactivateAllAudioPaths(); //de-activate them all
       break;
+    case 'S':
+      Serial.println("SerialManager: Received S: testing the switching of audio paths...");
+      testSwitchingAudioPaths(2000);
+      break;
     default:
       {
         bool was_switch_command = interpretAsSwitchAudioPath(c);
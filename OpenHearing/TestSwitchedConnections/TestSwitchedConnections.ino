@@ -7,13 +7,17 @@
 *
 *   Use the serial monitor to command the switching.
 *
+*   All of the audio objects, connections, and AudioPaths are built in a fixed memory arena at
+*   startup (see AudioPathArena.h and AudioPathRegistry.h), so switching never touches the heap.
+*
 *   MIT License.  use at your own risk.
 */
 
 //here are the libraries that we need
 #include <Tympan_Library.h>  //include the Tympan Library
-#include <vector>
+#include <malloc.h>   //for mallinfo(), to check that switching doesn't use the heap
 #include "AudioPath_Base.h"
+#include "AudioPathRegistry.h"
 #include "SerialManager.h"
 
 //set the sample rate and block size
@@ -34,11 +38,15 @@ Tympan                     myTympan(TympanRev::E, audio_settings);   //do Tympan
   AudioOutputI2S_F32       *audioOutput;           //create it later
 #endif
 
+//create the memory arena that will hold all of the audio objects, connections, and AudioPaths
+#define AUDIO_PATH_ARENA_BYTES  (185*1024)   //the high-water mark after setup(), measured with HostSim/simPathSwitching.cpp (less than the 192 kB before the FFT was reworked).  Check the boot print if you add an AudioPath.
+DMAMEM uint8_t audioPathArenaMemory[AUDIO_PATH_ARENA_BYTES] __attribute__ ((aligned (8)));  //DMAMEM puts it in RAM2 on the Teensy 4
+AudioPathArena audioPathArena(audioPathArenaMemory, AUDIO_PATH_ARENA_BYTES);
+
 //create other audio-related items
-std::vector<AudioMixer8_F32 *> allOutputMixers;         //fill it later
-std::vector<AudioPath_Base *> allAudioPaths;            //fill it later
-std::vector<AudioConnection_F32 *> patchCords;     //fill it later
-int activeAudioPathIndex = -1;  //which audio path is active (counting from zero)
+const int N_OUTPUT_MIXERS = 4;                     //one for Left0, Right0, Left1, Right1
+AudioMixer8_F32 *allOutputMixers[N_OUTPUT_MIXERS]; //fill it later
+AudioPathRegistry audioPaths(&audioPathArena);     //fill it later
 
 //create items to help AudioPaths control the hardware
 Tympan *tympan_ptr = &myTympan;
@@ -65,19 +73,19 @@ Tympan *tympan_ptr = &myTympan;
 void createMyAudioPathObjects(AudioSettings_F32 &_audio_settings) {
   
   //Add Audio Path: Sine wave generator
-  allAudioPaths.push_back( new AudioPath_Sine(audio_settings, tympan_ptr, shield_ptr) );  
+  audioPaths.add<AudioPath_Sine>(audio_settings, tympan_ptr, shield_ptr);
 
   //Add Audio Path: Audio pass-thru with gain (analog)
-  allAudioPaths.push_back( new AudioPath_PassThruGain_Analog(audio_settings, tympan_ptr, shield_ptr) );
+  audioPaths.add<AudioPath_PassThruGain_Analog>(audio_settings, tympan_ptr, shield_ptr);
 
   //Add Audio Path: Audio pass-thru with gain (PDM mics)
-  allAudioPaths.push_back( new AudioPath_PassThruGain_PDM(audio_settings, tympan_ptr, shield_ptr) );
+  audioPaths.add<AudioPath_PassThruGain_PDM>(audio_settings, tympan_ptr, shield_ptr);
 
   //Add Audio Path: Sine wave generator with FFT analysis of the input
-  allAudioPaths.push_back( new AudioPath_Sine_wFFT(audio_settings, tympan_ptr, shield_ptr) );
+  audioPaths.add<AudioPath_Sine_wFFT>(audio_settings, tympan_ptr, shield_ptr);
 
-  //Add Audio Path: Add yours here!
-  //allAudioPaths.push_back( new myAudioPathClassName(audio_settings, tympan_ptr, shield_ptr) ); 
+  //Add Audio Path: Add yours here!  Its constructor must accept an AudioPathArena* as the last argument.
+  //audioPaths.add<myAudioPathClassName>(audio_settings, tympan_ptr, shield_ptr);
 }
 
 
@@ -88,83 +96,114 @@ void createMyAudioPathObjects(AudioSettings_F32 &_audio_settings) {
 //
 // ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-//Instantiate all of the Audio and AudioPath objects
+//Instantiate all of the Audio and AudioPath objects (all in the arena)
 void createAllAudioObjects(AudioSettings_F32 &_audio_settings) {
   //Start with instatiating the input
   #if USE_FOUR_CHANNELS
-    audioInput = new AudioInputI2SQuad_F32(audio_settings);
+    audioInput = audioPathArena.create<AudioInputI2SQuad_F32>(audio_settings);
   #else
-    audioInput = new AudioInputI2S_F32(audio_settings);
+    audioInput = audioPathArena.create<AudioInputI2S_F32>(audio_settings);
   #endif
 
   //Next, let the user instantiate all of the AudioPaths that they might ever decide to use
   createMyAudioPathObjects(_audio_settings);
 
   //Next, create the audio output mixers...one for Left0, Right0, Left1, Right1
-  for (int i = 0; i < 4; i++) allOutputMixers.push_back(new AudioMixer8_F32(audio_settings) );  //...only mixes up to 8 outputs! (defaults to all gains = 1.0)
+  for (int i = 0; i < N_OUTPUT_MIXERS; i++) allOutputMixers[i] = audioPathArena.create<AudioMixer8_F32>(audio_settings);  //...only mixes up to 8 outputs! (defaults to all gains = 1.0)
   
   //Finally, create the audio outputs
   #if USE_FOUR_CHANNELS
-    audioOutput = new AudioOutputI2SQuad_F32(audio_settings);
+    audioOutput = audioPathArena.create<AudioOutputI2SQuad_F32>(audio_settings);
   #else
-    audioOutput = new AudioOutputI2S_F32(audio_settings);
+    audioOutput = audioPathArena.create<AudioOutputI2S_F32>(audio_settings);
   #endif
+  Serial.println("createAllAudioObjects: used " + String((int)audioPathArena.getBytesUsed()) + " of " + String((int)audioPathArena.getBytesTotal()) + " bytes of the arena");
+}
+
+//make an audio connection in the arena.  Connections are never destroyed, so we don't need to keep track of them.
+AudioConnection_F32 *makeConnection(AudioStream_F32 &source, int source_chan, AudioStream_F32 &dest, int dest_chan) {
+  return audioPathArena.create<AudioConnection_F32>(source, source_chan, dest, dest_chan);
 }
 
 void connectAllAudioObjects(void) {
   //Connect each AudioPath to the inputs
-  for (int Ipath=0; Ipath < (int)allAudioPaths.size(); Ipath++) {  //loop over each AudioPath
+  for (int Ipath=0; Ipath < audioPaths.getNumPaths(); Ipath++) {  //loop over each AudioPath
     #if USE_FOUR_CHANNELS
-      patchCords.push_back( new AudioConnection_F32(*audioInput, EarpieceShield::PDM_LEFT_FRONT,  *allAudioPaths[Ipath]->getStartNode(), 0) );
-      patchCords.push_back( new AudioConnection_F32(*audioInput, EarpieceShield::PDM_LEFT_REAR,   *allAudioPaths[Ipath]->getStartNode(), 1) );
-      patchCords.push_back( new AudioConnection_F32(*audioInput, EarpieceShield::PDM_RIGHT_FRONT, *allAudioPaths[Ipath]->getStartNode(), 2) );
-      patchCords.push_back( new AudioConnection_F32(*audioInput, EarpieceShield::PDM_RIGHT_REAR,  *allAudioPaths[Ipath]->getStartNode(), 3) );
+      makeConnection(*audioInput, EarpieceShield::PDM_LEFT_FRONT,  *audioPaths.getPath(Ipath)->getStartNode(), 0);
+      makeConnection(*audioInput, EarpieceShield::PDM_LEFT_REAR,   *audioPaths.getPath(Ipath)->getStartNode(), 1);
+      makeConnection(*audioInput, EarpieceShield::PDM_RIGHT_FRONT, *audioPaths.getPath(Ipath)->getStartNode(), 2);
+      makeConnection(*audioInput, EarpieceShield::PDM_RIGHT_REAR,  *audioPaths.getPath(Ipath)->getStartNode(), 3);
     #else
-      patchCords.push_back( new AudioConnection_F32(*audioInput, 0,  *allAudioPaths[Ipath]->getStartNode(), 0) );
-      patchCords.push_back( new AudioConnection_F32(*audioInput, 1,  *allAudioPaths[Ipath]->getStartNode(), 1) );
+      makeConnection(*audioInput, 0,  *audioPaths.getPath(Ipath)->getStartNode(), 0);
+      makeConnection(*audioInput, 1,  *audioPaths.getPath(Ipath)->getStartNode(), 1);
     #endif
   }
 
   //Connect each AudioPath to each of the output mixers
-  for (int Imixer=0; Imixer < (int)allOutputMixers.size(); Imixer++) {  //loop over each output mixer
-    for (int Ipath=0; Ipath < (int)allAudioPaths.size(); Ipath++) {  //loop over each AudioPath
+  for (int Imixer=0; Imixer < N_OUTPUT_MIXERS; Imixer++) {  //loop over each output mixer
+    for (int Ipath=0; Ipath < audioPaths.getNumPaths(); Ipath++) {  //loop over each AudioPath
       int path_output_channel = Imixer;  //make it clearer what we're doing
       int mixer_input_chanenl = Ipath;   //make it clearer what we're doing
-      patchCords.push_back( new AudioConnection_F32(*allAudioPaths[Ipath]->getEndNode(), path_output_channel, *allOutputMixers[Imixer], mixer_input_chanenl) );
+      makeConnection(*audioPaths.getPath(Ipath)->getEndNode(), path_output_channel, *allOutputMixers[Imixer], mixer_input_chanenl);
     }
   }
   
   //Connect the output mixers to the outputs
   #if USE_FOUR_CHANNELS
-    patchCords.push_back( new AudioConnection_F32(*allOutputMixers[0], 0, *audioOutput, EarpieceShield::OUTPUT_LEFT_TYMPAN) );    //connect left0 mixer to output (needs actual references, not pointers)
-    patchCords.push_back( new AudioConnection_F32(*allOutputMixers[1], 0, *audioOutput, EarpieceShield::OUTPUT_RIGHT_TYMPAN) );   //connect right0 mixer to output (needs actual references, not pointers)
-    patchCords.push_back( new AudioConnection_F32(*allOutputMixers[2], 0, *audioOutput, EarpieceShield::OUTPUT_LEFT_EARPIECE) );  //connect left1 mixer to output (needs actual references, not pointers)
-    patchCords.push_back( new AudioConnection_F32(*allOutputMixers[3], 0, *audioOutput, EarpieceShield::OUTPUT_RIGHT_EARPIECE) ); //connect right1 mixer to output (needs actual references, not pointers)
+    makeConnection(*allOutputMixers[0], 0, *audioOutput, EarpieceShield::OUTPUT_LEFT_TYMPAN);    //connect left0 mixer to output (needs actual references, not pointers)
+    makeConnection(*allOutputMixers[1], 0, *audioOutput, EarpieceShield::OUTPUT_RIGHT_TYMPAN);   //connect right0 mixer to output (needs actual references, not pointers)
+    makeConnection(*allOutputMixers[2], 0, *audioOutput, EarpieceShield::OUTPUT_LEFT_EARPIECE);  //connect left1 mixer to output (needs actual references, not pointers)
+    makeConnection(*allOutputMixers[3], 0, *audioOutput, EarpieceShield::OUTPUT_RIGHT_EARPIECE); //connect right1 mixer to output (needs actual references, not pointers)
   #else
-    patchCords.push_back( new AudioConnection_F32(*allOutputMixers[0], 0, *audioOutput, 0) ); //connect left0 mixer to output (needs actual references, not pointers)
-    patchCords.push_back( new AudioConnection_F32(*allOutputMixers[1], 0, *audioOutput, 1) ); //connect right0 mixer to output (needs actual references, not pointers)
+    makeConnection(*allOutputMixers[0], 0, *audioOutput, 0); //connect left0 mixer to output (needs actual references, not pointers)
+    makeConnection(*allOutputMixers[1], 0, *audioOutput, 1); //connect right0 mixer to output (needs actual references, not pointers)
   #endif
 }
 
 void deactivateAllAudioPaths(void) {
-  for (auto & audioPath : allAudioPaths) { audioPath->setActive(false); } //iterate over each audio path object and set whether it is active.
-  activeAudioPathIndex = -1;  //none are active
+  audioPaths.deactivateAll();  //iterate over each audio path object and de-activate it
 }
 
+//de-activate the active audio path and activate the new one.  Only touches the objects of those two audio paths.
 int activateOneAudioPath(int index) {
-  deactivateAllAudioPaths(); //de-activate them all
-  if (index < (int)allAudioPaths.size()) {
-    activeAudioPathIndex = index;
-    allAudioPaths[activeAudioPathIndex]->setActive(true);  //activate just the one
-  }
-  return activeAudioPathIndex;
+  return audioPaths.activate(index);
 }
 
 AudioPath_Base *getActiveAudioPath(void) {
-  if (activeAudioPathIndex >= 0) {
-    return allAudioPaths[activeAudioPathIndex];
+  return audioPaths.getActivePath();
+}
+
+//Switch between the audio paths many times and check that the heap didn't change.  The switching is timed
+//without each path's setupHardware() (which talks to the codecs over I2C), which is then timed on its own.
+void testSwitchingAudioPaths(int n_switches) {
+  int n_paths = audioPaths.getNumPaths();
+  if (n_paths < 1) return;
+  int orig_index = audioPaths.getActiveIndex();
+  Serial.println("testSwitchingAudioPaths: switching " + String(n_switches) + " times.  This takes a few seconds...");
+  
+  struct mallinfo before = mallinfo();
+  audioPaths.enableSetupHardware(false);
+  unsigned long start_micros = micros();
+  for (int i=0; i < n_switches; i++) audioPaths.activate(i % n_paths);
+  unsigned long dt_micros = micros() - start_micros;
+  audioPaths.enableSetupHardware(true);
+  struct mallinfo after = mallinfo();
+
+  //time each path's hardware setup on its own
+  unsigned long hw_micros[AUDIO_PATH_MAX_PATHS];
+  for (int Ipath=0; Ipath < n_paths; Ipath++) {
+    start_micros = micros();
+    audioPaths.getPath(Ipath)->setupHardware();
+    hw_micros[Ipath] = micros() - start_micros;
+  }
+
+  audioPaths.activate(orig_index);  //go back to what was active before (and to its hardware setup)
+  Serial.println("testSwitchingAudioPaths: " + String(((float)dt_micros) / ((float)n_switches), 1) + " usec per switch (not including setupHardware())");
+  for (int Ipath=0; Ipath < n_paths; Ipath++) {
+    Serial.println("testSwitchingAudioPaths: setupHardware() for " + audioPaths.getPath(Ipath)->name + " = " + String(hw_micros[Ipath]) + " usec");
   }
-  return NULL;
+  Serial.print("testSwitchingAudioPaths: heap in use before = " + String((int)before.uordblks) + " bytes, after = " + String((int)after.uordblks) + " bytes");
+  Serial.println((after.uordblks == before.uordblks) ? ".  OK." : ".  *** ERROR ***: the heap changed!");
 }
 
 //Define other control, display and serial interactions
@@ -193,7 +232,7 @@ void setup() {
   deactivateAllAudioPaths();             //de-activate all the audiopaths (they're probably already de-activated from their own constructors, but this makes sure)
 
   //allocate the audio memory
-  AudioMemory_F32(180,audio_settings); //allocate memory
+  AudioMemory_F32(60,audio_settings); //allocate memory.  The FFT no longer waits for whole frames to pile up in the queues
 
   //configure the Tympan
   myTympan.enable();                               //Enable the Tympan to start the audio flowing!
@@ -227,7 +266,8 @@ void loop() {
   if (enable_printCPUandMemory) myTympan.printCPUandMemory(millis(),500); //update every 3000 msec
 
   //service any main-loop needs of the active AudioPath object
-  if ((activeAudioPathIndex >=0) && (activeAudioPathIndex < (int)allAudioPaths.size())) allAudioPaths[activeAudioPathIndex]->serviceMainLoop();
+  AudioPath_Base *activeAudioPath = getActiveAudioPath();
+  if (activeAudioPath != NULL) activeAudioPath->serviceMainLoop();
 
 } //end loop();
 
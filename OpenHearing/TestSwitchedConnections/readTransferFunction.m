@@ -0,0 +1,44 @@
+%% function tf = readTransferFunction(bytes)
+% Decode the binary transfer functions sent by AudioPath_Sine_wFFT (see exportTransferFunction() in
+% AudioPath_Sine_wFFT.h).  On the serial monitor, send 'e'.  The Tympan replies with a text line "H1TF=<n_bytes>"
+% and then the bytes themselves.  Pass those bytes (uint8) to this function.
+%
+% For example, with a serialport object s:
+%     writeline(s, 'e');  line = readline(s);  n_bytes = sscanf(line, 'H1TF=%d');
+%     tf = readTransferFunction(read(s, n_bytes, 'uint8'));
+%
+% Only the bins where the sine has energy are sent (see hasStimulus() in AudioPath_Sine_wFFT.h), so there are usually
+% just a few of them, and they are not spaced every bin.
+%
+% The returned tf has the fields: version, Nfft, fs_Hz, n_ref_frames, bin and freq_Hz (one per bin), and H (complex),
+% H_dB, phase_deg, and coherence (each is [n_bins x n_chan]).
+
+function tf = readTransferFunction(bytes)
+
+bytes = uint8(bytes(:)');
+header_bytes = 14;
+if numel(bytes) < header_bytes
+    error('readTransferFunction: data is too short (%d bytes)', numel(bytes));
+end
+
+tf.version = double(bytes(1));
+if tf.version ~= 2
+    error('readTransferFunction: unknown version %d', tf.version);
+end
+n_chan = double(bytes(2));
+n_bins = double(typecast(bytes(3:4), 'uint16'));
+tf.Nfft = double(typecast(bytes(7:8), 'uint16'));
+tf.fs_Hz = double(typecast(bytes(9:12), 'single'));
+tf.n_ref_frames = double(typecast(bytes(13:14), 'uint16'));
+
+n_vals = 3 * n_bins * n_chan;
+if numel(bytes) < header_bytes + 2*n_bins + 2*n_vals
+    error('readTransferFunction: expected %d bytes but got %d', header_bytes + 2*n_bins + 2*n_vals, numel(bytes));
+end
+tf.bin = double(typecast(bytes(header_bytes + (1:2*n_bins)), 'uint16'))';
+tf.freq_Hz = tf.bin * tf.fs_Hz / tf.Nfft;
+vals = reshape(bytes(header_bytes + 2*n_bins + (1:2*n_vals)), 6, n_bins, n_chan);
+tf.H_dB = 0.01 * double(reshape(typecast(reshape(vals(1:2,:,:), 1, []), 'int16'), n_bins, n_chan));
+tf.phase_deg = 0.01 * double(reshape(typecast(reshape(vals(3:4,:,:), 1, []), 'int16'), n_bins, n_chan));
+tf.coherence = double(reshape(typecast(reshape(vals(5:6,:,:), 1, []), 'uint16'), n_bins, n_chan)) / 65535;
+tf.H = 10.^(tf.H_dB/20) .* exp(1i * pi/180 * tf.phase_deg);
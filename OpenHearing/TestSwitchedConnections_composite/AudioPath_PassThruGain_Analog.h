@@ -28,8 +28,8 @@ class AudioPath_PassThruGain_Analog : public AudioStreamComposite_F32 {
       audioObjects.push_back( endNode = new AudioForwarder4_F32( _audio_settings, this ) ); endNode->instanceName = String("Output Forwarder"); //per AudioStreamComposite_F32, always have this last
 
       //connect the audio classes
-      for (int I=0; I < (int)allGains.size(); I++)  patchCords.push_back( new AudioConnection_F32(*startNode,   I, *allGains[I], 0)); //connect inputs to the gain objects
-      for (int I=0; I < (int)allGains.size(); I++)  patchCords.push_back( new AudioConnection_F32(*allGains[I], 0, *endNode,     I)); //connect gain objects to the outputs
+      for (int I=0; I < (int)allGains.size(); I++)  addConnection(*startNode,   I, *allGains[I], 0); //connect inputs to the gain objects
+      for (int I=0; I < (int)allGains.size(); I++)  addConnection(*allGains[I], 0, *endNode,     I); //connect gain objects to the outputs
      
       //setup the parameters of the audio processing
       setupAudioProcessing();
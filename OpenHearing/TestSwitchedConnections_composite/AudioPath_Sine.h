@@ -23,7 +23,7 @@ class AudioPath_Sine : public AudioStreamComposite_F32 {
       audioObjects.push_back( endNode   = new AudioForwarder4_F32( _audio_settings, this ) ); endNode->instanceName = String("Output Forwarder"); //per AudioStreamComposite_F32, always have this last
       
       // Make all audio connections, except the final one to the destiation...we're only storing them in a vector so that it's easier to destroy them later
-      for (int Ioutput=0; Ioutput < 4; Ioutput++)  patchCords.push_back( new AudioConnection_F32(*sineWave, 0, *endNode, Ioutput)); //same sine to all outputs
+      for (int Ioutput=0; Ioutput < 4; Ioutput++)  addConnection(*sineWave, 0, *endNode, Ioutput); //same sine to all outputs
 
       //setup the parameters of the audio processing
       setupAudioProcessing(); 
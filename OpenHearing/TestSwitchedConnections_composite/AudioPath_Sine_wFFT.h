@@ -37,8 +37,8 @@ class AudioPath_Sine_wFFT : public AudioStreamComposite_F32 {
       audioObjects.push_back( endNode   = new AudioForwarder4_F32( _audio_settings, this ) ); endNode->instanceName   = String("Output Forwarder"); //per AudioStreamComposite_F32, always have this last
 
       //connect the audio classes
-      for (int I=0; I < (int)allQueues.size(); I++)  patchCords.push_back( new AudioConnection_F32(*startNode, I, *allQueues[I], 0)); //connect inputs to the queue objects
-      for (int I=0; I < 4; I++)                      patchCords.push_back( new AudioConnection_F32(*sineWave1, 0, *endNode,      I)); //connect sine to all outputs
+      for (int I=0; I < (int)allQueues.size(); I++)  addConnection(*startNode, I, *allQueues[I], 0); //connect inputs to the queue objects
+      for (int I=0; I < 4; I++)                      addConnection(*sineWave1, 0, *endNode,      I); //connect sine to all outputs
 
       //setup the parameters of the audio processing
       setupAudioProcessing();
@@ -121,7 +121,7 @@ class AudioPath_Sine_wFFT : public AudioStreamComposite_F32 {
     }
 
     virtual void beginRecording(void) {
-      Serial.println("AudioPath_Sine_wFFT: beginRecording...");
+      //Serial.println("AudioPath_Sine_wFFT: beginRecording...");  //called with the audio paused, so don't make a String here
       for (auto & queue : allQueues) queue->begin(); //loop over all queues in vector and begin the audio buffering process}
     }
     virtual void stopRecording(void) {
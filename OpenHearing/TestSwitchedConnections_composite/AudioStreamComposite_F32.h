@@ -13,6 +13,28 @@
 // AudioStream_F32 audio-processing objects.  One can simply instantiate an AudioStreamComposite_F32 and all of the constituant
 // objects and connections are created.  The only thing left to do is connect the final output.
 //
+// Execution list: when the composite is active, only the constituant objects that can actually receive audio are
+// made active (and, so, only they are run by AudioStream's update_all()).  An object is left out if all of its inputs
+// come from objects that are left out or from inputs of this composite that are not connected to anything (see
+// setConnectedInputs()).  Objects with no inputs (such as signal generators) are always included.  For this to work,
+// derived classes must make their connections with addConnection().  The list is only compiled when the graph or the
+// inputs change, and it is compiled into a spare list (whose memory is kept) before the audio is paused.  With the audio
+// paused, the objects of the old list are de-activated, the spare list is swapped in (a pointer swap), and its objects
+// are activated.  So, switching never allocates memory and only pauses the audio for the setActive() calls.
+// Note: the start node is assumed to pass input N to output N (the default for AudioSwitchMatrix4_F32).
+//
+// Inputs: the upstream audio can be connected with connectInput() rather than to this composite object itself.
+// connectInput() connects the upstream object straight to our start node, so the upstream transmit() puts each audio
+// block directly into the start node's input queue.  Otherwise, our update() has to receive each block and hand it on
+// to the start node, which costs a receive, a hand-off, and a release (a reference-count round trip) per channel per
+// block.  That is a CPU saving only.  It does not shorten the latency: this composite is made before its start node,
+// so our update() runs before the start node's update() in the same audio cycle and the block is not delayed.  Nor
+// does it lower the peak number of audio blocks in use, because the hand-off passes on the same block.  Measured with
+// HostSim/simInputConnection.cpp (the sketch's four AudioPaths, with and without connectInput()): the same latency
+// (0 samples) and the same peak blocks for the AudioPaths that use their inputs.  If the start node is pruned (nothing
+// in the composite uses the inputs), connectInput() costs a block per input: nothing receives the blocks that wait at
+// the start node, whereas our own update() would have received and released them.
+//
 class AudioStreamComposite_F32: public AudioStream_F32 {
   public:
     AudioStreamComposite_F32(void) : 
@@ -34,6 +56,7 @@ class AudioStreamComposite_F32: public AudioStream_F32 {
 
     //Define the required update() method.
     //Goal: move the received audo blocks from this AudioStreamComposite's inputs to the inputs of our start node.
+    //This is only needed for inputs that were connected to this composite object instead of with connectInput().
     //Note 1: The update methods for the constituant classes should be called automatically by AudioStream.
     //Note 2: The update method defined here for the AudioStreamComposite_F32 should NOT have to be overriden by
     //derived classes of AudioStreamComposite, unless something new is specifically desired by your derived class.
@@ -44,8 +67,8 @@ class AudioStreamComposite_F32: public AudioStream_F32 {
         audio_block_f32_t *block = receiveReadOnly_f32(Iinput);
         //see if the block is valid
         if (block) {
-          //see if we have a valid startNode
-          if (startNode) { //make sure it's not NULL
+          //see if we have a valid startNode and if anything downstream of this input is active
+          if (startNode && (executionList->forward_inputs_mask & (1 << Iinput))) { //make sure it's not NULL
             //transmit the block to the startNode, which following along with the behavior from AudioStream_F32::transmit(),
             //is to just set the destinations inputQueue.  The desitation is the first node (startNode) so go ahead and move
             //the audio block to the start node's ipnut queue
@@ -71,23 +94,56 @@ class AudioStreamComposite_F32: public AudioStream_F32 {
     //is not invoked, thereby saving CPU.
     virtual bool setActive(bool _active) { return setActive(_active, false); }
     virtual bool setActive(bool _active, bool flag_moreSetup) {
+      if (isExecutionListStale()) compileExecutionList();  //into the spare list, before the audio is paused
+
       AudioNoInterrupts();  //stop the audio processing in order to change all the active states (from Audio library)
     
       //call the default AudioStream_F32::setActive, which will activate this AudioStreamComposite too
       AudioStream_F32::setActive(_active, flag_moreSetup); //do the default actions (which, I think, ignores flag_setupHardware) and sets active = _active
       
-      //iterate over each constituant Audio object and call its setActive method.
-      for (auto & audioObject : audioObjects) { //iterate over each audio object in the audioObjects vector
-        audioObject->setActive(_active, false);   // do not forward the flag_setupHardware as only the top-most composite should have control over the hardware...override this setActive method, if you disagree.
-      }
-
-      //call any additional setup
-      if (_active && flag_moreSetup) setup_fromSetActive();
+      //swap in the new execution list (if any) and set the active state of each constituant Audio object
+      applyExecutionList();
 
       AudioInterrupts();  //restart the audio processing in order to change all the active states
+
+      //call any additional setup (such as the codec, over I2C), which doesn't need the audio to be paused
+      if (_active && flag_moreSetup) setup_fromSetActive();
       return active;
     }
     virtual void setup_fromSetActive(void) {}  //override this as desired in your derived class
+
+    //Connect an upstream audio object straight to the given input of our start node (see the note at the top)
+    AudioConnection_F32* connectInput(AudioStream_F32 &source, int source_chan, int input_chan) {
+      if ((startNode == NULL) || (input_chan < 0) || (input_chan >= max_n_IO_chan)) {
+        Serial.println("AudioStreamComposite_F32 (" + instanceName + "): connectInput: *** ERROR ***: no start node or bad input " + String(input_chan));
+        return NULL;
+      }
+      AudioConnection_F32 *cord = new AudioConnection_F32(source, source_chan, *startNode, input_chan);
+      patchCords.push_back(cord);
+      direct_inputs_mask |= (1 << input_chan);      //the start node gets this input straight from upstream...
+      connected_inputs_mask &= ~(1 << input_chan);  //...so our own input N no longer needs to be forwarded by update()
+      execution_list_dirty = true;
+      rebuildExecutionList();
+      return cord;
+    }
+
+    //Tell us which of our own inputs (not those made with connectInput()) are connected to something (bit N is input N).
+    //Default is all of them.
+    void setConnectedInputs(uint8_t mask) { connected_inputs_mask = mask; execution_list_dirty = true; rebuildExecutionList(); }
+
+    //Enable or disable leaving out the objects that can't receive audio.  If disabled, every object is run.
+    void setEnablePruning(bool _enable) { enable_pruning = _enable; execution_list_dirty = true; rebuildExecutionList(); }
+    bool getEnablePruning(void) { return enable_pruning; }
+
+    //rebuild the execution list (such as after changing the connected inputs).  Don't call this from within AudioNoInterrupts().
+    void rebuildExecutionList(void) {
+      if (isExecutionListStale()) compileExecutionList();  //into the spare list, while the audio is still running
+      AudioNoInterrupts();
+      applyExecutionList();
+      AudioInterrupts();
+    }
+    int getNumObjectsInExecutionList(void) { return executionList->n_objects; }
+    int getNumObjects(void) { return (int)audioObjects.size(); }
   
     // ///////////////////////////////////////////////// Convenince methods for easing interaction with main program
 
@@ -106,6 +162,113 @@ class AudioStreamComposite_F32: public AudioStream_F32 {
     EarpieceShield *shield_ptr = NULL;
     std::vector<AudioConnection_F32 *> patchCords;
     std::vector<AudioStream_F32 *> audioObjects;
+
+    //Make an audio connection between two of our constituant objects.  Use this instead of creating the AudioConnection_F32
+    //yourself so that we know the shape of the audio graph (which is needed for the execution list).
+    AudioConnection_F32* addConnection(AudioStream_F32 &source, int source_chan, AudioStream_F32 &dest, int dest_chan) {
+      AudioConnection_F32 *cord = new AudioConnection_F32(source, source_chan, dest, dest_chan);
+      patchCords.push_back(cord);
+      graphEdges.push_back( GraphEdge{&source, source_chan, &dest} );
+      execution_list_dirty = true;
+      return cord;
+    }
+
+    //data members for the execution list.  There are two lists: the one in use, and the spare one that is compiled
+    //while the audio is running.  Their memory is kept, so that swapping them never allocates.
+    struct GraphEdge { AudioStream_F32 *source; int source_chan; AudioStream_F32 *dest; };
+    struct ExecutionList {
+      std::vector<AudioStream_F32 *> objects;         //the constituant objects that are active when this composite is active...
+      int n_objects = 0;                              //...which are the first n_objects of "objects"
+      uint8_t forward_inputs_mask = 0x0F;             //which of our own inputs are sent to the start node (see update())
+    };
+    std::vector<GraphEdge> graphEdges;                //every connection made with addConnection()
+    ExecutionList executionLists[2];
+    ExecutionList *executionList = &executionLists[0];        //the list in use (read by update())
+    ExecutionList *spareExecutionList = &executionLists[1];   //compiled by compileExecutionList(), swapped in by applyExecutionList()
+    std::vector<uint8_t> isLive;                      //for each object in audioObjects, can it receive audio?
+    bool execution_list_built = false;                //has a list ever been swapped in?
+    bool spare_list_ready = false;                    //has the spare list been compiled (and not yet swapped in)?
+    bool execution_list_dirty = true;                 //has the graph or the inputs changed since the last compile?
+    int n_objects_compiled = 0;                       //the number of audio objects when the list was compiled
+    bool enable_pruning = true;
+    uint8_t connected_inputs_mask = 0x0F;             //which of our own inputs are connected to something
+    uint8_t direct_inputs_mask = 0x00;                //which inputs of the start node were connected with connectInput()
+
+    //does the execution list need to be compiled again?  (derived classes add their objects to audioObjects directly)
+    bool isExecutionListStale(void) { return execution_list_dirty || (n_objects_compiled != (int)audioObjects.size()); }
+
+    //de-activate the objects of the old execution list, swap in the spare list (if it has been compiled), and then (if
+    //we're active) activate the list.  Call with the audio interrupts paused.  Nothing is allocated here.
+    void applyExecutionList(void) {
+      if (execution_list_built) {
+        for (int i=0; i < executionList->n_objects; i++) executionList->objects[i]->setActive(false, false);  // do not forward the flag_setupHardware as only the top-most composite should have control over the hardware
+      } else {
+        for (auto & audioObject : audioObjects) audioObject->setActive(false, false);  //the first time, we don't know what's active
+      }
+      if (spare_list_ready) {
+        ExecutionList *old_list = executionList;  executionList = spareExecutionList;  spareExecutionList = old_list;
+        spare_list_ready = false;  execution_list_built = true;
+      }
+      if (active) {
+        for (int i=0; i < executionList->n_objects; i++) executionList->objects[i]->setActive(true, false);
+      }
+    }
+
+    //decide which objects can receive audio, and write them into the spare list.  Repeat until nothing changes, so that
+    //the order of the objects doesn't matter.  This runs with the audio running: it only touches the spare list.
+    void compileExecutionList(void) {
+      int n_objects = (int)audioObjects.size();
+      ExecutionList *list = spareExecutionList;
+      if ((int)list->objects.size() < n_objects) list->objects.resize(n_objects);  //only grows when objects are added (at startup)
+      if ((int)isLive.size() < n_objects) isLive.resize(n_objects);
+      for (int Iobj=0; Iobj < n_objects; Iobj++) isLive[Iobj] = enable_pruning ? 0 : 1;
+      uint8_t live_inputs_mask = enable_pruning ? 0 : 0x0F;  //which inputs of the start node get audio and lead somewhere
+      list->forward_inputs_mask = enable_pruning ? 0 : connected_inputs_mask;
+
+      if (enable_pruning) {
+        //which inputs of the start node get audio (from us or straight from upstream) and lead anywhere?
+        for (auto & edge : graphEdges) {
+          if ((edge.source == startNode) && ((connected_inputs_mask | direct_inputs_mask) & (1 << edge.source_chan))) live_inputs_mask |= (1 << edge.source_chan);
+        }
+        list->forward_inputs_mask = live_inputs_mask & connected_inputs_mask;  //only these need to be handed on by update()
+
+        //spread "liveness" down through the graph
+        bool any_change = true;
+        while (any_change) {
+          any_change = false;
+          for (int Iobj=0; Iobj < n_objects; Iobj++) {
+            if (isLive[Iobj]) continue;
+            AudioStream_F32 *obj = audioObjects[Iobj];
+            bool has_inputs = false, live = false;
+            if (obj == startNode) {
+              live = (live_inputs_mask != 0);
+            } else {
+              for (auto & edge : graphEdges) {
+                if (edge.dest != obj) continue;
+                has_inputs = true;
+                if (isEdgeLive(edge, live_inputs_mask)) { live = true; break; }
+              }
+              if (!has_inputs) live = true;  //a source, such as a signal generator
+            }
+            if (live) { isLive[Iobj] = 1; any_change = true; }
+          }
+        }
+      }
+
+      list->n_objects = 0;
+      for (int Iobj=0; Iobj < n_objects; Iobj++) if (isLive[Iobj]) list->objects[list->n_objects++] = audioObjects[Iobj];
+      n_objects_compiled = n_objects;
+      execution_list_dirty = false;
+      spare_list_ready = true;
+    }
+
+    bool isEdgeLive(const GraphEdge &edge, uint8_t live_inputs_mask) {
+      if (edge.source == startNode) return (live_inputs_mask & (1 << edge.source_chan));
+      for (int Iobj=0; Iobj < (int)audioObjects.size(); Iobj++) {
+        if (audioObjects[Iobj] == edge.source) return isLive[Iobj];
+      }
+      return false;
+    }
 };
 
 
@@ -0,0 +1,355 @@
+#ifndef _HostSim_Tympan_Library_h
+#define _HostSim_Tympan_Library_h
+
+// Host (PC) stand-ins for the Tympan_Library pieces that this sketch uses, so that the sketch itself (its composite
+// AudioPaths, and even TestSwitchedConnections_composite.ino) can be compiled and run on a PC.  Only what the sketch
+// needs is here.
+//
+// The audio engine works like the library's: every AudioStream_F32 is put on the update list when it is made, and
+// update_all() (the audio interrupt, here called by hand) runs the update() of each active one, in that order.
+// Blocks come from a fixed pool with reference counts, transmit() hands a block to every input that is connected to
+// that output (if that input is empty), and a block sits in an input until its object's update() receives it.  So,
+// the audio memory in use (AudioMemoryUsage_F32() and AudioMemoryUsageMax_F32()) and the delay through the graph
+// behave as on the Tympan.  The I2S input plays the samples given to hostSetInput(), and the I2S output keeps the
+// samples that reach it (see hostGetOutput()).
+//
+// AudioNoInterrupts() and AudioInterrupts() count how deep the audio is paused (see hostIsAudioPaused()) and add up
+// how long it was paused (hostAudioPausedNanos), so that a test can check what is done while it is paused.
+
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+using std::min; using std::max;
+
+#define AUDIO_BLOCK_SAMPLES 128
+#define AUDIO_SAMPLE_RATE_EXACT 44117.64706f
+#define F(x) (x)
+inline float pow10f(float x) { return powf(10.0f, x); }
+
+//Arduino's String, as far as the sketch uses it
+struct String : std::string {
+  String(void) {}
+  String(const char *s) : std::string(s) {}
+  String(const std::string &s) : std::string(s) {}
+  String(int v) : std::string(std::to_string(v)) {}
+  String(unsigned int v) : std::string(std::to_string(v)) {}
+  String(long v) : std::string(std::to_string(v)) {}
+  String(unsigned long v) : std::string(std::to_string(v)) {}
+  String(float v, int n_dec = 2) { char b[64]; snprintf(b, sizeof(b), "%.*f", n_dec, v); assign(b); }
+  String(double v, int n_dec = 2) { char b[64]; snprintf(b, sizeof(b), "%.*f", n_dec, v); assign(b); }
+};
+inline String operator+(const String &a, const String &b) { return String(std::string(a) + std::string(b)); }
+inline String operator+(const char *a, const String &b) { return String(std::string(a) + std::string(b)); }
+inline String operator+(const String &a, const char *b) { return String(std::string(a) + std::string(b)); }
+
+//the serial monitor.  Set quiet to hide the sketch's own printing.
+struct HostSerial {
+  bool quiet = false;
+  operator bool() const { return true; }
+  int available(void) { return 0; }
+  int read(void) { return -1; }
+  void print(const String &s) { if (!quiet) fputs(s.c_str(), stdout); }
+  void print(int v) { if (!quiet) printf("%d", v); }
+  void print(float v, int n_dec = 2) { if (!quiet) printf("%.*f", n_dec, v); }
+  void println(const String &s) { if (!quiet) puts(s.c_str()); }
+  void println(void) { if (!quiet) puts(""); }
+};
+static HostSerial Serial;
+
+//the host's clock
+inline unsigned long micros(void) {
+  using namespace std::chrono;
+  static auto t0 = steady_clock::now();
+  return (unsigned long)duration_cast<microseconds>(steady_clock::now() - t0).count();
+}
+inline unsigned long millis(void) { return micros() / 1000UL; }
+inline void delay(unsigned long msec) { std::this_thread::sleep_for(std::chrono::milliseconds(msec)); }
+
+//the audio "interrupt" is only ever run by hand, so these just count how deep it is paused, and for how long in all
+static int hostAudioPausedDepth = 0;
+static double hostAudioPausedNanos = 0.0;
+static std::chrono::steady_clock::time_point hostAudioPausedStart;
+inline void AudioNoInterrupts(void) { if (hostAudioPausedDepth++ == 0) hostAudioPausedStart = std::chrono::steady_clock::now(); }
+inline void AudioInterrupts(void) {
+  if ((hostAudioPausedDepth > 0) && (--hostAudioPausedDepth == 0)) {
+    hostAudioPausedNanos += (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - hostAudioPausedStart).count();
+  }
+}
+inline bool hostIsAudioPaused(void) { return (hostAudioPausedDepth > 0); }
+
+struct AudioSettings_F32 {
+  AudioSettings_F32(float fs, int n) : sample_rate_Hz(fs), audio_block_samples(n) {}
+  float sample_rate_Hz;
+  int audio_block_samples;
+  float processorUsage(void) { return 0.0f; }
+};
+struct audio_block_f32_t { float data[AUDIO_BLOCK_SAMPLES]; int length = AUDIO_BLOCK_SAMPLES; unsigned long id = 0; int ref_count = 0; };
+
+//the audio memory, with the library's usage counters
+#define HOSTSIM_MAX_AUDIO_BLOCKS 256
+struct HostAudioMemory {
+  audio_block_f32_t blocks[HOSTSIM_MAX_AUDIO_BLOCKS];
+  int n_blocks = 0, n_used = 0, max_used = 0;
+};
+static HostAudioMemory hostAudioMemory;
+inline void AudioMemory_F32(int n, const AudioSettings_F32 &) { hostAudioMemory.n_blocks = min(n, HOSTSIM_MAX_AUDIO_BLOCKS); }
+inline int AudioMemoryUsage_F32(void) { return hostAudioMemory.n_used; }
+inline int AudioMemoryUsageMax_F32(void) { return hostAudioMemory.max_used; }
+inline void AudioMemoryUsageMaxReset_F32(void) { hostAudioMemory.max_used = hostAudioMemory.n_used; }
+
+class AudioStream_F32;
+class AudioConnection_F32 {
+  public:
+    AudioConnection_F32(AudioStream_F32 &_src, unsigned char _src_index, AudioStream_F32 &_dst, unsigned char _dst_index);
+  protected:
+    friend class AudioStream_F32;
+    AudioStream_F32 *src, *dst;
+    unsigned char src_index, dest_index;
+    AudioConnection_F32 *next_dest = NULL;
+};
+
+class AudioStream_F32 {
+  public:
+    AudioStream_F32(int _n_inputs, audio_block_f32_t **_inputQueue) : num_inputs_f32(_n_inputs), inputQueue_f32(_inputQueue) {
+      for (int i = 0; i < num_inputs_f32; i++) inputQueue_f32[i] = NULL;
+      if (first_update == NULL) { first_update = this; } else { AudioStream_F32 *p = first_update; while (p->next_update) p = p->next_update; p->next_update = this; }
+    }
+    virtual ~AudioStream_F32(void) {}
+    virtual void update(void) = 0;
+    virtual bool setActive(bool _active) { return active = _active; }
+    virtual bool setActive(bool _active, bool flag_moreSetup) { return active = _active; }
+    bool isActive(void) { return active; }
+    String instanceName;
+
+    //the same job as the library's: take a reference to the block and put it in one of our inputs
+    void putBlockInInputQueue(audio_block_f32_t *block, int Iinput) {
+      if ((block == NULL) || (Iinput < 0) || (Iinput >= num_inputs_f32) || (inputQueue_f32[Iinput] != NULL)) return;
+      inputQueue_f32[Iinput] = block;  block->ref_count++;
+    }
+    void transmit(audio_block_f32_t *block, unsigned char index = 0) {
+      for (AudioConnection_F32 *c = destination_list; c != NULL; c = c->next_dest) {
+        if ((c->src_index == index) && (c->dst->inputQueue_f32[c->dest_index] == NULL)) {
+          c->dst->inputQueue_f32[c->dest_index] = block;  block->ref_count++;
+        }
+      }
+    }
+
+    static audio_block_f32_t *allocate_f32(void) {
+      for (int i = 0; i < hostAudioMemory.n_blocks; i++) {
+        audio_block_f32_t *b = &hostAudioMemory.blocks[i];
+        if (b->ref_count == 0) {
+          b->ref_count = 1; b->length = AUDIO_BLOCK_SAMPLES;
+          hostAudioMemory.max_used = max(hostAudioMemory.max_used, ++hostAudioMemory.n_used);
+          return b;
+        }
+      }
+      return NULL;
+    }
+    static void release(audio_block_f32_t *b) { if ((b) && (--(b->ref_count) == 0)) hostAudioMemory.n_used--; }
+
+    //the audio interrupt: run every active object, in the order in which they were made
+    static void update_all(void) { for (AudioStream_F32 *p = first_update; p != NULL; p = p->next_update) if (p->active) p->update(); }
+
+  protected:
+    friend class AudioConnection_F32;
+    bool active = true;
+    int num_inputs_f32 = 0;
+    audio_block_f32_t **inputQueue_f32;
+    AudioConnection_F32 *destination_list = NULL;
+    AudioStream_F32 *next_update = NULL;
+    static inline AudioStream_F32 *first_update = NULL;
+    audio_block_f32_t *receiveReadOnly_f32(unsigned int i = 0) {
+      if ((int)i >= num_inputs_f32) return NULL;
+      audio_block_f32_t *b = inputQueue_f32[i];  inputQueue_f32[i] = NULL;  return b;
+    }
+    audio_block_f32_t *receiveWritable_f32(unsigned int i = 0) {
+      audio_block_f32_t *b = receiveReadOnly_f32(i);
+      if ((b) && (b->ref_count > 1)) {  //shared, so copy it
+        audio_block_f32_t *copy = allocate_f32();
+        if (copy) { memcpy(copy->data, b->data, sizeof(b->data)); copy->length = b->length; copy->id = b->id; }
+        release(b);
+        b = copy;
+      }
+      return b;
+    }
+};
+
+inline AudioConnection_F32::AudioConnection_F32(AudioStream_F32 &_src, unsigned char _src_index, AudioStream_F32 &_dst, unsigned char _dst_index)
+  : src(&_src), dst(&_dst), src_index(_src_index), dest_index(_dst_index) {
+  if (src->destination_list == NULL) { src->destination_list = this; } else { AudioConnection_F32 *c = src->destination_list; while (c->next_dest) c = c->next_dest; c->next_dest = this; }
+}
+
+//passes input N to output N
+class AudioSwitchMatrix4_F32 : public AudioStream_F32 {
+  public:
+    AudioSwitchMatrix4_F32(const AudioSettings_F32 &) : AudioStream_F32(4, inputQueueArray) {}
+    virtual void update(void) {
+      for (int i = 0; i < 4; i++) { audio_block_f32_t *b = receiveReadOnly_f32(i); if (b) { transmit(b, i); release(b); } }
+    }
+  protected:
+    audio_block_f32_t *inputQueueArray[4];
+};
+
+//sends each of its inputs out of the same output of the given (parent) object
+class AudioForwarder4_F32 : public AudioStream_F32 {
+  public:
+    AudioForwarder4_F32(const AudioSettings_F32 &, AudioStream_F32 *_parent) : AudioStream_F32(4, inputQueueArray), parent(_parent) {}
+    virtual void update(void) {
+      for (int i = 0; i < 4; i++) { audio_block_f32_t *b = receiveReadOnly_f32(i); if (b) { if (parent) parent->transmit(b, i); release(b); } }
+    }
+  protected:
+    audio_block_f32_t *inputQueueArray[4];
+    AudioStream_F32 *parent = NULL;
+};
+
+class AudioSynthWaveform_F32 : public AudioStream_F32 {
+  public:
+    AudioSynthWaveform_F32(const AudioSettings_F32 &settings) : AudioStream_F32(0, NULL), sample_rate_Hz(settings.sample_rate_Hz) {}
+    void frequency(float f) { freq_Hz = f; }
+    void amplitude(float a) { amp = a; }
+    virtual void update(void) {
+      audio_block_f32_t *b = allocate_f32();
+      if (!b) return;
+      for (int i = 0; i < b->length; i++) { b->data[i] = amp * sinf(phase); phase += 2.0f * (float)M_PI * freq_Hz / sample_rate_Hz; }
+      phase = fmodf(phase, 2.0f * (float)M_PI);
+      transmit(b);  release(b);
+    }
+  protected:
+    float sample_rate_Hz, freq_Hz = 0.0f, amp = 0.0f, phase = 0.0f;
+};
+
+class AudioEffectGain_F32 : public AudioStream_F32 {
+  public:
+    AudioEffectGain_F32(const AudioSettings_F32 &) : AudioStream_F32(1, inputQueueArray) {}
+    float setGain_dB(float g_dB) { gain = powf(10.0f, g_dB / 20.0f); return g_dB; }
+    float getGain_dB(void) { return 20.0f * log10f(gain); }
+    virtual void update(void) {
+      audio_block_f32_t *b = receiveWritable_f32();
+      if (!b) return;
+      for (int i = 0; i < b->length; i++) b->data[i] *= gain;
+      transmit(b);  release(b);
+    }
+  protected:
+    audio_block_f32_t *inputQueueArray[1];
+    float gain = 1.0f;
+};
+
+class AudioMixer8_F32 : public AudioStream_F32 {
+  public:
+    AudioMixer8_F32(const AudioSettings_F32 &) : AudioStream_F32(8, inputQueueArray) {}
+    void gain(unsigned int chan, float g) { if (chan < 8) multiplier[chan] = g; }
+    virtual void update(void) {
+      audio_block_f32_t *out = NULL;
+      for (int i = 0; i < 8; i++) {
+        audio_block_f32_t *in = receiveReadOnly_f32(i);
+        if (!in) continue;
+        if (!out) { out = allocate_f32(); if (out) for (int k = 0; k < AUDIO_BLOCK_SAMPLES; k++) out->data[k] = 0.0f; }
+        if (out) for (int k = 0; k < in->length; k++) out->data[k] += multiplier[i] * in->data[k];
+        release(in);
+      }
+      if (out) { transmit(out);  release(out); }
+    }
+  protected:
+    audio_block_f32_t *inputQueueArray[8];
+    float multiplier[8] = {1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f};
+};
+
+//the library's record queue: up to 80 blocks
+class AudioRecordQueue_F32 : public AudioStream_F32 {
+  public:
+    AudioRecordQueue_F32(const AudioSettings_F32 &) : AudioStream_F32(1, inputQueueArray) {}
+    void begin(void) { clear(); enabled = true; }
+    void end(void) { enabled = false; }
+    int available(void) { int n = (int)head - (int)tail; return (n < 0) ? n + max_buffers : n; }
+    void clear(void) {
+      if (userblock) { release(userblock); userblock = NULL; }
+      while (tail != head) { if (++tail >= max_buffers) tail = 0; release(queue[tail]); }
+    }
+    audio_block_f32_t *getAudioBlock(void) {
+      if ((userblock) || (tail == head)) return NULL;
+      if (++tail >= max_buffers) tail = 0;
+      return userblock = queue[tail];
+    }
+    void freeBuffer(void) { if (userblock) { release(userblock); userblock = NULL; } }
+    virtual void update(void) {
+      audio_block_f32_t *b = receiveReadOnly_f32();
+      if (!b) return;
+      if (!enabled) { release(b); return; }
+      int h = head + 1;  if (h >= max_buffers) h = 0;
+      if (h == tail) { release(b); return; }  //full
+      queue[h] = b;  head = h;
+    }
+  protected:
+    static const int max_buffers = 80;
+    audio_block_f32_t *inputQueueArray[1];
+    audio_block_f32_t *queue[max_buffers];
+    audio_block_f32_t *userblock = NULL;
+    int head = 0, tail = 0;
+    bool enabled = false;
+};
+
+//the I2S input plays these samples (one block per channel per update), or silence
+static float hostInputSamples[2][AUDIO_BLOCK_SAMPLES];
+inline void hostSetInput(int chan, const float *x) { memcpy(hostInputSamples[chan], x, sizeof(hostInputSamples[chan])); }
+class AudioInputI2S_F32 : public AudioStream_F32 {
+  public:
+    AudioInputI2S_F32(const AudioSettings_F32 &) : AudioStream_F32(0, NULL) {}
+    virtual void update(void) {
+      for (int chan = 0; chan < 2; chan++) {
+        audio_block_f32_t *b = allocate_f32();
+        if (!b) continue;
+        memcpy(b->data, hostInputSamples[chan], sizeof(b->data));
+        transmit(b, chan);  release(b);
+      }
+    }
+};
+
+//the I2S output keeps the last block of each channel (zeros if none arrived)
+static float hostOutputSamples[2][AUDIO_BLOCK_SAMPLES];
+inline const float *hostGetOutput(int chan) { return hostOutputSamples[chan]; }
+class AudioOutputI2S_F32 : public AudioStream_F32 {
+  public:
+    AudioOutputI2S_F32(const AudioSettings_F32 &) : AudioStream_F32(2, inputQueueArray) {}
+    virtual void update(void) {
+      for (int chan = 0; chan < 2; chan++) {
+        audio_block_f32_t *b = receiveReadOnly_f32(chan);
+        if (b) { memcpy(hostOutputSamples[chan], b->data, sizeof(b->data)); release(b); }
+        else { memset(hostOutputSamples[chan], 0, sizeof(hostOutputSamples[chan])); }
+      }
+    }
+  protected:
+    audio_block_f32_t *inputQueueArray[2];
+};
+
+//the codec controls only count how often they are called
+#define TYMPAN_INPUT_ON_BOARD_MIC    0
+#define TYMPAN_INPUT_JACK_AS_LINEIN  1
+enum class TympanRev { C, D, E, F };
+class Tympan {
+  public:
+    Tympan(void) {}
+    Tympan(TympanRev, const AudioSettings_F32 &) {}
+    void enable(void) {}
+    void muteHeadphone(void) { n_codec_calls++; }
+    void unmuteHeadphone(void) { n_codec_calls++; }
+    void muteDAC(void) { n_codec_calls++; }
+    void unmuteDAC(void) { n_codec_calls++; }
+    void enableDigitalMicInputs(bool) { n_codec_calls++; }
+    void inputSelect(int) { n_codec_calls++; }
+    void setInputGain_dB(float) { n_codec_calls++; }
+    void setDacGain_dB(float, float) { n_codec_calls++; }
+    void setHeadphoneGain_dB(float, float) { n_codec_calls++; }
+    void volume_dB(float) { n_codec_calls++; }
+    void printCPUandMemory(unsigned long, unsigned long) {}
+    long n_codec_calls = 0;
+};
+typedef Tympan EarpieceShield;
+
+#endif
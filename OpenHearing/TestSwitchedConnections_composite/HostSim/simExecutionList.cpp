@@ -0,0 +1,109 @@
+// simExecutionList: runs the sketch itself (../TestSwitchedConnections_composite.ino, with its four composite AudioPaths)
+// on a PC to check the execution lists of AudioStreamComposite_F32 and how they are swapped in.  It:
+//   * builds and connects everything as setup() does, and checks the number of objects in each AudioPath's execution
+//     list, with pruning on and off, against what the graph says (see expected_n_live below)
+//   * switches between the four AudioPaths 100000 times, running the audio (update_all()) after each switch, and checks
+//     that nothing is allocated while the audio is paused (counted by the operator new below), that the heap does not
+//     change, that no audio blocks are lost, and that the active AudioPath is the one that reaches the output.  It
+//     also reports how long the audio was paused per switch (host time).
+//
+// To build and run (from this folder).  -fpermissive is for the sketch's "(int)tympan_ptr", which the Teensy's 32-bit
+// pointers allow:
+//     g++ -std=gnu++17 -O2 -fpermissive -w -I. simExecutionList.cpp -o simExecutionList && ./simExecutionList
+
+#include <Tympan_Library.h>
+#include <malloc.h>
+#include <new>
+
+//count every allocation, and those made while the audio is paused
+static long n_new_calls = 0, n_new_calls_while_paused = 0;
+void *operator new(size_t n) {
+  n_new_calls++;
+  if (hostIsAudioPaused()) n_new_calls_while_paused++;
+  void *p = malloc(n ? n : 1);
+  if (p == NULL) throw std::bad_alloc();
+  return p;
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+#include "../TestSwitchedConnections_composite.ino"
+
+//what each AudioPath should run when pruned, given that only inputs 0 and 1 are connected (with connectInput())
+//  Sine:           the sine and the output forwarder (nothing reaches its start node)
+//  Pass-thru (x2): the start node, gains 0 and 1, and the output forwarder
+//  Sine with FFT:  the start node, queues 0 and 1, the sine, and the output forwarder
+const int expected_n_live[] = {2, 4, 4, 5};
+
+//the level (rms) of an output channel
+float rms(const float *x) { double s = 0.0; for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) s += x[i] * x[i]; return (float)sqrt(s / AUDIO_BLOCK_SAMPLES); }
+
+int main(void) {
+  Serial.quiet = true;
+  setup();
+  Serial.quiet = false;
+  bool pass = true;
+
+  printf("simExecutionList: objects run by each AudioPath (pruned / not pruned / all):\n");
+  for (int Ipath = 0; Ipath < (int)allAudioPaths.size(); Ipath++) {
+    AudioStreamComposite_F32 *path = allAudioPaths[Ipath];
+    path->setEnablePruning(false);  int n_all_run = path->getNumObjectsInExecutionList();
+    path->setEnablePruning(true);   int n_pruned = path->getNumObjectsInExecutionList();
+    bool ok = (n_pruned == expected_n_live[Ipath]) && (n_all_run == path->getNumObjects());
+    printf("  %-26s %d / %d / %d  %s\n", path->instanceName.c_str(), n_pruned, n_all_run, path->getNumObjects(), ok ? "PASS" : "FAIL");
+    pass = pass && ok;
+  }
+
+  //a tone at the Tympan's inputs, for the pass-thru AudioPaths
+  float x[AUDIO_BLOCK_SAMPLES];
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) x[i] = 0.1f * sinf(2.0f * (float)M_PI * 16.0f * i / AUDIO_BLOCK_SAMPLES);
+  hostSetInput(0, x);  hostSetInput(1, x);
+
+  //warm up (the first switches and updates settle the queues and the held blocks)
+  Serial.quiet = true;
+  for (int i = 0; i < 4 * 8; i++) { activateOneAudioPath(i % 4); for (int k = 0; k < 4; k++) AudioStream_F32::update_all(); }
+  activateOneAudioPath(0);  for (int k = 0; k < 4; k++) AudioStream_F32::update_all();
+  Serial.quiet = false;
+
+  //switch many times, with audio running, and check what reaches the output
+  const int n_switches = 100000;
+  const float sine_rms = sqrtf(pow10f(0.1f * -50.0f)) / sqrtf(2.0f);  //the sines are at -50 dBFS
+  const float expected_rms[] = {
+    sine_rms,                                           //the sine (or silence, as it turns itself on and off each second)
+    0.1f / sqrtf(2.0f) * powf(10.0f, 10.0f / 20.0f),    //the input, +10 dB
+    0.1f / sqrtf(2.0f) * powf(10.0f, 25.0f / 20.0f),    //the input, +25 dB
+    sine_rms };                                         //the sine
+  const float tolerance[] = {0.1f, 0.01f, 0.01f, 0.1f}; //the sines aren't a whole number of cycles per block
+  long n_wrong_output = 0;
+  int min_blocks_in_use = 1 << 30, max_blocks_in_use = 0;
+  Serial.quiet = true;
+  long n_new_before = n_new_calls, n_paused_before = n_new_calls_while_paused;
+  double paused_nanos_before = hostAudioPausedNanos;
+  struct mallinfo2 before = mallinfo2();
+  for (int i = 0; i < n_switches; i++) {
+    int index = (i + 1) % 4;
+    activateOneAudioPath(index);
+    for (int k = 0; k < 3; k++) AudioStream_F32::update_all();  //the output takes a couple of updates to be all from the new AudioPath
+    float level = rms(hostGetOutput(0));
+    bool is_silent_sine = (index == 0) && (level == 0.0f);
+    if (!is_silent_sine && (fabsf(level - expected_rms[index]) > tolerance[index] * expected_rms[index])) n_wrong_output++;
+    if (index == 0) allAudioPaths[index]->serviceMainLoop();  //turns the sine on and off
+    min_blocks_in_use = min(min_blocks_in_use, AudioMemoryUsage_F32());  max_blocks_in_use = max(max_blocks_in_use, AudioMemoryUsage_F32());
+  }
+  struct mallinfo2 after = mallinfo2();
+  long n_new = n_new_calls - n_new_before, n_paused = n_new_calls_while_paused - n_paused_before;
+  double paused_nanos = (hostAudioPausedNanos - paused_nanos_before) / n_switches;
+  Serial.quiet = false;
+
+  bool heap_ok = (after.uordblks == before.uordblks), paused_ok = (n_paused == 0), output_ok = (n_wrong_output == 0);
+  printf("%d switches (with 3 audio updates each):\n", n_switches);
+  printf("  allocations while the audio was paused: %ld (%s); allocations in all: %ld\n", n_paused, paused_ok ? "PASS" : "FAIL", n_new);
+  printf("  host time with the audio paused: %.0f nsec per switch (all four AudioPaths are set, as activateOneAudioPath() does)\n", paused_nanos);
+  printf("  heap in use: before = %d, after = %d bytes (%s)\n", (int)before.uordblks, (int)after.uordblks, heap_ok ? "PASS" : "FAIL");
+  printf("  audio blocks in use after each switch: %d to %d (of %d)\n", min_blocks_in_use, max_blocks_in_use, hostAudioMemory.n_blocks);
+  printf("  switches where the output was not from the active AudioPath: %ld (%s)\n", n_wrong_output, output_ok ? "PASS" : "FAIL");
+  pass = pass && heap_ok && paused_ok && output_ok;
+
+  printf("simExecutionList: %s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+// simInputConnection: measures what connectInput() changes, by running the sketch itself
+// (../TestSwitchedConnections_composite.ino) on a PC, once with CONNECT_INPUTS_TO_START_NODES = true (the upstream audio
+// goes straight to each AudioPath's start node) and once with false (it goes through each AudioPath's update()).  For
+// each AudioPath, it reports:
+//   * AudioMemoryUsageMax_F32(): the most audio blocks in use at once, over 1000 audio updates (as the 'w' command
+//     does), with the AudioPath's serviceMainLoop() run after each update, as loop() would.  Also, the blocks that
+//     are still in use between updates (mostly those held at the inputs of the AudioPaths that are switched off).
+//   * the latency from the Tympan's input to its output, found with an impulse (for the AudioPaths that pass the input)
+//   * the host time per audio update (all of update_all(), so the whole graph, plus serviceMainLoop())
+// The audio engine is the host's (see Tympan_Library.h in this folder), so the block counts and the latency follow the
+// library's rules, but the times are the host's, not the Teensy's.
+//
+// To build and run both (from this folder).  -fpermissive is for the sketch's "(int)tympan_ptr", which the Teensy's
+// 32-bit pointers allow:
+//     for m in true false; do g++ -std=gnu++17 -O2 -fpermissive -w -DCONNECT_INPUTS_TO_START_NODES=$m -I. simInputConnection.cpp -o simInputConnection && ./simInputConnection; done
+
+#include <Tympan_Library.h>
+#include "../TestSwitchedConnections_composite.ino"
+
+const int n_updates = 1000, n_timed_updates = 20000;
+
+//run the audio with an impulse at the input, and return where it lands at the output (in samples), or -1
+int measureLatency(void) {
+  const int Isamp_impulse = 17;
+  float x[AUDIO_BLOCK_SAMPLES] = {0.0f};
+  hostSetInput(0, x);  hostSetInput(1, x);
+  for (int k = 0; k < 8; k++) AudioStream_F32::update_all();  //flush
+  x[Isamp_impulse] = 1.0f;
+  hostSetInput(0, x);  hostSetInput(1, x);
+  AudioStream_F32::update_all();  //the impulse goes in during this update...
+  x[Isamp_impulse] = 0.0f;
+  hostSetInput(0, x);  hostSetInput(1, x);
+  for (int Iupdate = 0; Iupdate < 8; Iupdate++) {
+    if (Iupdate > 0) AudioStream_F32::update_all();
+    const float *y = hostGetOutput(0);
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) if (fabsf(y[i]) > 0.5f) return Iupdate * AUDIO_BLOCK_SAMPLES + i - Isamp_impulse;  //...so Iupdate = 0 is the same update
+  }
+  return -1;
+}
+
+int main(void) {
+  Serial.quiet = true;
+  setup();
+  Serial.quiet = false;
+  printf("simInputConnection: CONNECT_INPUTS_TO_START_NODES = %s (inputs %s)\n", CONNECT_INPUTS_TO_START_NODES ? "true" : "false",
+         CONNECT_INPUTS_TO_START_NODES ? "connected to the start nodes with connectInput()" : "connected to the AudioPaths");
+
+  float x[AUDIO_BLOCK_SAMPLES];
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) x[i] = 0.1f * sinf(2.0f * (float)M_PI * 16.0f * i / AUDIO_BLOCK_SAMPLES);
+  //visit every AudioPath once first.  An object that is not active never receives the block that is waiting at its
+  //input, so each AudioPath that has been switched off holds on to a block per input.  Visiting them all first puts
+  //both builds in the same state.
+  Serial.quiet = true;
+  hostSetInput(0, x);  hostSetInput(1, x);
+  for (int Ipath = 0; Ipath < (int)allAudioPaths.size(); Ipath++) {
+    activateOneAudioPath(Ipath);
+    for (int k = 0; k < 100; k++) { AudioStream_F32::update_all(); allAudioPaths[Ipath]->serviceMainLoop(); }
+  }
+  Serial.quiet = false;
+
+  for (int Ipath = 0; Ipath < (int)allAudioPaths.size(); Ipath++) {
+    Serial.quiet = true;
+    activateOneAudioPath(Ipath);
+    hostSetInput(0, x);  hostSetInput(1, x);
+    for (int k = 0; k < 100; k++) { AudioStream_F32::update_all(); allAudioPaths[Ipath]->serviceMainLoop(); }  //settle
+    int held_blocks = AudioMemoryUsage_F32();  //in use between updates
+    AudioMemoryUsageMaxReset_F32();
+    for (int k = 0; k < n_updates; k++) { AudioStream_F32::update_all(); allAudioPaths[Ipath]->serviceMainLoop(); }
+    int max_blocks = AudioMemoryUsageMax_F32();
+    double best_nsec = 1.0e30;
+    for (int Irep = 0; Irep < 5; Irep++) {  //the fastest of a few runs, to steady the host's times
+      unsigned long start_usec = micros();
+      for (int k = 0; k < n_timed_updates; k++) { AudioStream_F32::update_all(); allAudioPaths[Ipath]->serviceMainLoop(); }
+      best_nsec = min(best_nsec, 1000.0 * (double)(micros() - start_usec) / n_timed_updates);
+    }
+    bool passes_input = (Ipath == 1) || (Ipath == 2);
+    int latency = passes_input ? measureLatency() : -1;
+    Serial.quiet = false;
+    printf("  %-26s blocks in use: max = %3d, between updates = %3d", allAudioPaths[Ipath]->instanceName.c_str(), max_blocks, held_blocks);
+    if (passes_input) { printf(", latency = %4d samples", latency); } else { printf(",                       "); }
+    printf(", %6.0f nsec per update (host)\n", best_nsec);
+  }
+  return 0;
+}
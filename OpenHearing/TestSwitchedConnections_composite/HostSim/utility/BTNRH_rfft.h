@@ -0,0 +1,36 @@
+#ifndef _HostSim_BTNRH_rfft_h
+#define _HostSim_BTNRH_rfft_h
+
+// Host (PC) stand-in for the Tympan_Library's BTNRH_FFT::cha_fft_rc(): the real FFT of n samples (n a power of 2), in
+// place, as n/2+1 interleaved complex values (so x must hold n+2 floats).  It is a plain radix-2 FFT in double
+// precision, not the library's code.  It is only here so that the sketch compiles.
+
+#include <cmath>
+#include <complex>
+#include <vector>
+#include <utility>
+
+namespace BTNRH_FFT {
+  inline void cha_fft_rc(float *x, int n) {
+    std::vector<std::complex<double>> a(n);
+    for (int i = 0; i < n; i++) a[i] = x[i];
+    for (int i = 1, j = 0; i < n; i++) {  //bit reversal
+      int bit = n >> 1;
+      for (; j & bit; bit >>= 1) j ^= bit;
+      j ^= bit;
+      if (i < j) std::swap(a[i], a[j]);
+    }
+    for (int len = 2; len <= n; len <<= 1) {
+      for (int i = 0; i < n; i += len) {
+        for (int k = 0; k < len/2; k++) {
+          std::complex<double> w = std::polar(1.0, -2.0 * M_PI * k / len);
+          std::complex<double> u = a[i+k], v = a[i+k+len/2] * w;
+          a[i+k] = u + v;  a[i+k+len/2] = u - v;
+        }
+      }
+    }
+    for (int k = 0; k <= n/2; k++) { x[2*k] = (float)a[k].real(); x[2*k+1] = (float)a[k].imag(); }
+  }
+}
+
+#endif
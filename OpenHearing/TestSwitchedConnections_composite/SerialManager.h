@@ -21,6 +21,9 @@ extern void togglePrintMemoryAndCPU(void);
 extern void deactivateAllAudioPaths(void);
 extern int activateOneAudioPath(int index);
 AudioStreamComposite_F32 *getActiveAudioPath(void);
+extern bool setEnablePruning(bool enable);
+extern void measurePruningCPU(void);
+extern void printAudioMemoryHighWater(void);
 
 //now, define the Serial Manager class
 class SerialManager {
@@ -39,6 +42,9 @@ void SerialManager::printHelp(void) {
   Serial.println("   h: Print this help");
   Serial.println("   C: Toggle printing of CPU and Memory usage");
   Serial.println("   0: De-activate all audio paths");
+  Serial.println("   p/P: Enable/Disable pruning of the audio objects that can't receive audio");
+  Serial.println("   u: Measure the audio CPU with and without pruning");
+  Serial.println("   w: Print (and reset) the max number of audio blocks in use");
 
   //auto-populate entries for the audio paths that have already been created
   for (int i=0; i < (int)allAudioPaths.size(); i++) {
@@ -86,6 +92,18 @@ void SerialManager::respondToByte(char c) {
       Serial.println("SerialManager: Received 0: de-activating all audio paths...");
       deactivateAllAudioPaths(); //de-activate them all
       break;
+    case 'p':
+      setEnablePruning(true);
+      break;
+    case 'P':
+      setEnablePruning(false);
+      break;
+    case 'u':
+      measurePruningCPU();
+      break;
+    case 'w':
+      printAudioMemoryHighWater();
+      break;
     default:
       {
         bool was_switch_command = interpretAsSwitchAudioPath(c);
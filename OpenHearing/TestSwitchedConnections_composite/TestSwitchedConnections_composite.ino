@@ -22,6 +22,9 @@ const int audio_block_samples = 128;        //do not make bigger than AUDIO_BLOC
 AudioSettings_F32 audio_settings(sample_rate_Hz, audio_block_samples);
 
 #define USE_FOUR_CHANNELS (false)
+#ifndef CONNECT_INPUTS_TO_START_NODES
+  #define CONNECT_INPUTS_TO_START_NODES (true)  //true: upstream audio goes straight into each AudioPath's start node.  false: it goes through the AudioPath's update()
+#endif
 
 //create audio library objects for handling the audio
 Tympan                     myTympan(TympanRev::E, audio_settings);   //do TympanRev::D or E or F
@@ -117,14 +120,28 @@ void createAllAudioObjects(AudioSettings_F32 &_audio_settings) {
 void connectAllAudioObjects(void) {
   //Connect each AudioPath to the Tympan's inputs
   for (int Ipath=0; Ipath < (int)allAudioPaths.size(); Ipath++) {  //loop over each AudioPath
-    #if USE_FOUR_CHANNELS
+    #if CONNECT_INPUTS_TO_START_NODES
+      #if USE_FOUR_CHANNELS
+        allAudioPaths[Ipath]->connectInput(*audioInput, EarpieceShield::PDM_LEFT_FRONT,  0);
+        allAudioPaths[Ipath]->connectInput(*audioInput, EarpieceShield::PDM_LEFT_REAR,   1);
+        allAudioPaths[Ipath]->connectInput(*audioInput, EarpieceShield::PDM_RIGHT_FRONT, 2);
+        allAudioPaths[Ipath]->connectInput(*audioInput, EarpieceShield::PDM_RIGHT_REAR,  3);
+        allAudioPaths[Ipath]->setConnectedInputs(0x00);  //nothing is connected to the AudioPath itself (connectInput() marked inputs 0-3 as connected)
+      #else
+        allAudioPaths[Ipath]->connectInput(*audioInput, 0, 0);
+        allAudioPaths[Ipath]->connectInput(*audioInput, 1, 1);
+        allAudioPaths[Ipath]->setConnectedInputs(0x00);  //nothing is connected to the AudioPath itself (connectInput() marked inputs 0 and 1), so it can skip inputs 2 and 3
+      #endif
+    #elif USE_FOUR_CHANNELS
       patchCords.push_back( new AudioConnection_F32(*audioInput, EarpieceShield::PDM_LEFT_FRONT,  *allAudioPaths[Ipath], 0) );
       patchCords.push_back( new AudioConnection_F32(*audioInput, EarpieceShield::PDM_LEFT_REAR,   *allAudioPaths[Ipath], 1) );
       patchCords.push_back( new AudioConnection_F32(*audioInput, EarpieceShield::PDM_RIGHT_FRONT, *allAudioPaths[Ipath], 2) );
       patchCords.push_back( new AudioConnection_F32(*audioInput, EarpieceShield::PDM_RIGHT_REAR,  *allAudioPaths[Ipath], 3) );
+      allAudioPaths[Ipath]->setConnectedInputs(0x0F);  //tell the AudioPath that all four inputs are connected
     #else
       patchCords.push_back( new AudioConnection_F32(*audioInput, 0,  *allAudioPaths[Ipath], 0) );
       patchCords.push_back( new AudioConnection_F32(*audioInput, 1,  *allAudioPaths[Ipath], 1) );
+      allAudioPaths[Ipath]->setConnectedInputs(0x03);  //tell the AudioPath that only inputs 0 and 1 are connected, so it can skip the rest
     #endif
   }
 
@@ -175,6 +192,42 @@ AudioStreamComposite_F32 *getActiveAudioPath(void) {
   return NULL;
 }
 
+//Enable or disable the pruning of unused audio objects in all of the AudioPaths
+bool setEnablePruning(bool enable) {
+  for (auto & audioPath : allAudioPaths) audioPath->setEnablePruning(enable);
+  AudioStreamComposite_F32 *audioPath = getActiveAudioPath();
+  if (audioPath != NULL) {
+    Serial.println("setEnablePruning: " + String(enable ? "enabled" : "disabled") + ": " + audioPath->instanceName + " is running " 
+      + String(audioPath->getNumObjectsInExecutionList()) + " of its " + String(audioPath->getNumObjects()) + " audio objects");
+  }
+  return enable;
+}
+
+//Measure the audio CPU (averaged over one second) with and without pruning.  Everything in the audio
+//graph (all of the AudioPaths, the mixers, etc) is included, so this is the real per-block cost.
+void measurePruningCPU(void) {
+  if (getActiveAudioPath() == NULL) { Serial.println("measurePruningCPU: activate an audio path first."); return; }
+  bool orig_pruning = getActiveAudioPath()->getEnablePruning();
+  float cpu_percent[2] = {0.0f, 0.0f};
+  for (int Itest = 0; Itest < 2; Itest++) {
+    setEnablePruning(Itest == 0);
+    delay(100);  //let it settle
+    const int n_samples = 100;
+    for (int i=0; i < n_samples; i++) { delay(10); cpu_percent[Itest] += audio_settings.processorUsage() / ((float)n_samples); }
+  }
+  setEnablePruning(orig_pruning);
+  Serial.println("measurePruningCPU: " + String(allAudioPaths.size()) + " AudioPaths: audio CPU with pruning = " + String(cpu_percent[0], 2) 
+    + "%, without pruning = " + String(cpu_percent[1], 2) + "%");
+}
+
+//Print the most audio blocks that have been in use at once (since the last reset) and then reset it.
+//Compare CONNECT_INPUTS_TO_START_NODES = true versus false.
+void printAudioMemoryHighWater(void) {
+  Serial.println("printAudioMemoryHighWater: max audio blocks in use = " + String(AudioMemoryUsageMax_F32()) + " (inputs connected " 
+    + String(CONNECT_INPUTS_TO_START_NODES ? "to the start nodes" : "through the AudioPaths") + ").  Resetting.");
+  AudioMemoryUsageMaxReset_F32();
+}
+
 //Define other control, display and serial interactions
 bool enable_printCPUandMemory = false;
 void togglePrintMemoryAndCPU(void) { enable_printCPUandMemory = !enable_printCPUandMemory; };
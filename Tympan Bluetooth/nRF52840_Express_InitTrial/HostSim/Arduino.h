@@ -0,0 +1,102 @@
+#ifndef _HostSim_Arduino_h
+#define _HostSim_Arduino_h
+
+// Host (PC) stand-ins for the few Arduino pieces that the wired-link code (Serial_Frame.h, nRF52_AT_API.h,
+// Tympan_BLE_nRF52.h, and the test in Serial_Link_FrameTest.h) uses, so that it can be run on a PC.  See
+// simFrameLink.cpp.  millis(), micros(), and delay() are the PC's own clock, so the gap timeouts are real time.
+
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+using std::min; using std::max;
+
+#define HEX 16
+
+inline unsigned long micros(void) {
+  static const auto t0 = std::chrono::steady_clock::now();
+  return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count();
+}
+inline unsigned long millis(void) { return micros() / 1000UL; }
+inline void delay(unsigned long msec) { std::this_thread::sleep_for(std::chrono::milliseconds(msec)); }
+#define highByte(w) ((uint8_t)((w) >> 8))
+#define lowByte(w) ((uint8_t)((w) & 0xFF))
+
+//Arduino's String, enough for the messages that get built up and printed
+class String : public std::string {
+  public:
+    String(void) {}
+    String(const char *s) : std::string(s) {}
+    String(const std::string &s) : std::string(s) {}
+    String(char c) : std::string(1, c) {}
+    String(int val) : std::string(std::to_string(val)) {}
+    String(unsigned int val) : std::string(std::to_string(val)) {}
+    String(long val) : std::string(std::to_string(val)) {}
+    String(unsigned long val) : std::string(std::to_string(val)) {}
+    String(double val, int n_dec = 2) { char buff[64]; snprintf(buff, sizeof(buff), "%.*f", n_dec, val); assign(buff); }
+    void concat(char c) { push_back(c); }
+    void concat(const String &s) { append(s); }
+    String substring(int start, int end) const { return String(substr(start, end - start)); }
+    bool equals(const char *s) const { return compare(s) == 0; }
+    void remove(int ind, int n) { erase(ind, n); }
+    void trim(void) {
+      size_t first = find_first_not_of(" \t\r\n"), last = find_last_not_of(" \t\r\n");
+      if (first == std::string::npos) { clear(); return; }
+      assign(substr(first, last - first + 1));
+    }
+    void toCharArray(char *buff, int n) const { strncpy(buff, c_str(), n); }
+    char charAt(int ind) const { return (*this)[ind]; }
+};
+inline String operator+(const char *a, const String &b) { return String(std::string(a) + std::string(b)); }
+inline String operator+(const String &a, const String &b) { return String(std::string(a) + std::string(b)); }
+inline String operator+(const String &a, const char *b) { return String(std::string(a) + std::string(b)); }
+
+class Print {
+  public:
+    virtual ~Print(void) {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buff, size_t n) { for (size_t i = 0; i < n; i++) write(buff[i]); return n; }
+    size_t write(const char *buff, size_t n) { return write((const uint8_t *)buff, n); }
+    size_t print(const String &s) { return write((const uint8_t *)s.c_str(), s.size()); }
+    size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned long val) { return print(String(val)); }
+    size_t print(int val, int base = 10) { char buff[32]; snprintf(buff, sizeof(buff), (base == HEX) ? "%X" : "%d", val); return print(buff); }
+    size_t println(void) { return write((uint8_t)'\n'); }
+    template <class T> size_t println(T val) { size_t n = print(val); return n + println(); }
+    size_t println(int val, int base) { size_t n = print(val, base); return n + println(); }
+};
+class HardwareSerial : public Print {
+  public:
+    virtual int available(void) = 0;
+    virtual int read(void) = 0;
+    virtual int peek(void) = 0;
+};
+
+//the USB serial monitor is stdout.  Set quiet to hide the sketch's own printing.
+class HostSerial : public Print {
+  public:
+    size_t write(uint8_t c) { if (!quiet) putchar(c); return 1; }
+    using Print::write;
+    operator bool(void) { return true; }
+    bool quiet = false;
+};
+static HostSerial Serial;
+
+//nothing is wired to Serial1 on the host
+class HostNullSerial : public HardwareSerial {
+  public:
+    size_t write(uint8_t) { return 1; }
+    using Print::write;
+    int available(void) { return 0; }
+    int read(void) { return -1; }
+    int peek(void) { return -1; }
+    void begin(unsigned long) {}
+};
+static HostNullSerial Serial1;
+
+#endif
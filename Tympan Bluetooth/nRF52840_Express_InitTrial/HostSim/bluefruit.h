@@ -0,0 +1,29 @@
+#ifndef _HostSim_bluefruit_h
+#define _HostSim_bluefruit_h
+
+// Host (PC) stand-ins for the few pieces of Adafruit's Bluefruit library that nRF52_AT_API.h uses.  There is no BLE
+// on the host: the UART's writes go nowhere (a test checks them in nRF52_AT_API::writeToBle() instead), and the name
+// is just kept.  See simFrameLink.cpp.
+
+#include "Arduino.h"
+
+class BLECharacteristic {};
+
+class BLEUart {
+  public:
+    size_t write(const uint8_t *, int n) { return n; }
+    size_t write(const char *, int n) { return n; }
+  protected:
+    BLECharacteristic _txd, _rxd;
+};
+
+class HostBluefruit {
+  public:
+    void setName(const char *new_name) { strncpy(name, new_name, sizeof(name) - 1); }
+    uint32_t getName(char *buff, uint16_t n) { uint32_t len = min((uint32_t)strlen(name), (uint32_t)n); memcpy(buff, name, len); return len; }
+  protected:
+    char name[64] = "Tympan-HOST";
+};
+static HostBluefruit Bluefruit;
+
+#endif
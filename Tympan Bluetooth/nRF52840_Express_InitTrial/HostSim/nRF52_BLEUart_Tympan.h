@@ -0,0 +1,3 @@
+// Serial_Link_Simulator.h includes "nRF52_BLEUart_Tympan.h", but the file is ../nRF52_BLEuart_Tympan.h.  That only
+// matters on a file system that cares about case (such as the host's), so this passes it along.
+#include "../nRF52_BLEuart_Tympan.h"
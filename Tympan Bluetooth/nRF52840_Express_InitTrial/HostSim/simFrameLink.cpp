@@ -0,0 +1,203 @@
+// simFrameLink: runs the binary frames of the wired Tympan-to-nRF52 link (../Serial_Frame.h) on a PC, with the real
+// nRF52 side (../nRF52_AT_API.h) and the real Tympan side (../Tympan_BLE_nRF52.h) talking to each other.  It checks:
+//   * the table-driven CRC against the check value of CRC-16/CCITT-FALSE and against the CRC done bit by bit
+//   * the name and version commands, as text and as binary frames, and switching between the two
+//   * that send() in binary mode splits a string longer than SERIAL_FRAME_MAX_PAYLOAD into frames, and that the
+//     bytes reach BLE unchanged and in order
+//   * the error code in the NAK for a bad CRC, a bad length, and a frame that stops part way through (a gap)
+//   * the fuzz test of Serial_Link_FrameTest.h ('z' in the sketch): 2000 frames with trouble for 1 in 10, 1 in 2, and
+//     none.  No good frame may be lost and no damaged frame may reach BLE.
+// and then it runs the throughput test of Serial_Link_FrameTest.h ('x' in the sketch), which only reports times.
+//
+// There is no BLE here (see bluefruit.h in this folder), so the payloads are checked where the nRF52 would write
+// them to BLE (nRF52_AT_API::writeToBle()).  The host's times say little about the nRF52's.
+//
+// To build and run (from this folder):
+//     g++ -std=gnu++17 -O2 -funsigned-char -I. simFrameLink.cpp -o simFrameLink && ./simFrameLink
+// (-funsigned-char because the nRF52 and the Teensy both have an unsigned char)
+
+#include <Arduino.h>
+#include <bluefruit.h>
+#include <vector>
+
+//what nRF52_BLE_Stuff.h would give the AT interpreter (that file also sets up the real BLE, so it is not used here)
+#define MESSAGE_LENGTH 256
+const char versionString[] = "TympanBLE v0.1.0";
+char BLEmessage[MESSAGE_LENGTH];
+bool bleConnected = true;
+void startAdv(void) {}
+#include "../nRF52_BLEuart_Tympan.h"
+BLEUart_Tympan bleService_tympanUART;
+
+#include "../nRF52_AT_API.h"
+#include "../Serial_Link_Simulator.h"
+
+//an nRF52_AT_API that keeps everything that it would have written to BLE
+class HostLink_AT_API : public nRF52_AT_API {
+  public:
+    HostLink_AT_API(BLEUart_Tympan *_bleuart, HardwareSerial *_ser_ptr) : nRF52_AT_API(_bleuart, _ser_ptr) {}
+    virtual int writeToBle(const uint8_t *buff, int len) { ble_bytes.insert(ble_bytes.end(), buff, buff + len); return len; }
+    SerialFrameParser& getParser(void) { return frame_parser; }
+    std::vector<uint8_t> ble_bytes;
+};
+
+//the link from the Tympan to the nRF52: each byte goes straight to the nRF52's interpreter, so that the Tympan can
+//send more than fits in a Serial_Simulator
+class HostLink_ToNRF : public HardwareSerial {
+  public:
+    HostLink_ToNRF(nRF52_AT_API *_api) : api(_api) {}
+    size_t write(uint8_t c) { api->processSerialCharacter((char)c); return 1; }
+    using Print::write;
+    int available(void) { return 0; }
+    int read(void) { return -1; }
+    int peek(void) { return -1; }
+  protected:
+    nRF52_AT_API *api;
+};
+
+Serial_Simulator serial_from_nRF;  //the nRF52's replies to the Tympan
+HostLink_AT_API AT_interpreter(&bleService_tympanUART, &serial_from_nRF);
+HostLink_ToNRF serial_to_nRF(&AT_interpreter);
+void bleUnitServiceSerial(void) { AT_interpreter.serviceFrames(); }  //the bytes are already in (see HostLink_ToNRF)
+
+#include "../Tympan_BLE_nRF52.h"
+BLE_nRF52 tympanBle(&serial_to_nRF, &serial_from_nRF);
+#include "../Serial_Link_FrameTest.h"
+
+bool pass = true;
+void report(const char *name, bool ok, const String &details = String("")) {
+  printf("    %-58s %s  %s\n", name, ok ? "PASS" : "FAIL", details.c_str());
+  pass = pass && ok;
+}
+
+//CRC-16/CCITT-FALSE one bit at a time, to check the table
+uint16_t crcBitwise(uint16_t crc, uint8_t c) {
+  crc ^= (uint16_t)c << 8;
+  for (int i = 0; i < 8; i++) crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+  return crc;
+}
+
+void checkCRC(void) {
+  uint16_t crc = 0xFFFF;
+  for (const char *p = "123456789"; *p; p++) crc = SerialFrameParser::updateCRC16(crc, (uint8_t)*p);
+  char details[64]; snprintf(details, sizeof(details), "0x%04X (should be 0x29B1)", crc);
+  report("CRC of \"123456789\"", crc == 0x29B1, details);
+
+  uint16_t crc_table = 0xFFFF, crc_bits = 0xFFFF;
+  uint32_t x = 1;
+  bool same = true;
+  for (int i = 0; i < 100000; i++) {
+    x = FrameTest_Payload::xorshift32(x);
+    crc_table = SerialFrameParser::updateCRC16(crc_table, (uint8_t)x);
+    crc_bits = crcBitwise(crc_bits, (uint8_t)x);
+    same = same && (crc_table == crc_bits);
+  }
+  report("CRC from the table vs. bit by bit (100000 bytes)", same);
+}
+
+//the name and version commands.  Binary frames also set the name.  The text commands only get it, because the text
+//"SET NAME=" is answered "OK" without setting the name (setBleNameFromSerialBuff() looks for the '\r', which
+//processSerialCharacter() does not keep).  That is in the text commands, not in the binary frames.
+void checkCommands(const char *mode, const String &expected_name) {
+  char name[64];
+  String new_name = expected_name, reply;
+  bool ok = true;
+  if (tympanBle.isBinaryFraming()) {
+    new_name = String("Tympan-") + String(mode);
+    ok = (tympanBle.setBleName(new_name) == 0);
+  }
+  ok = ok && (tympanBle.getBleName(reply) == 0);
+  reply.trim();  //the text reply keeps the '\n' after the '\r'
+  ok = ok && (reply == new_name);
+  snprintf(name, sizeof(name), "%s: %s the name", mode, tympanBle.isBinaryFraming() ? "set and get" : "get");
+  report(name, ok, "'" + reply + "'");
+  snprintf(name, sizeof(name), "%s: version", mode);
+  report(name, tympanBle.version(false) == 0);
+}
+
+//send() a string of len bytes in binary mode.  All of it must reach BLE, in as few frames as fit.
+void checkLongSend(int len) {
+  String s;
+  uint32_t x = (uint32_t)len;
+  for (int i = 0; i < len; i++) { x = FrameTest_Payload::xorshift32(x); s.concat((char)(x & 0xFF)); }
+  AT_interpreter.ble_bytes.clear();
+  unsigned long n_good_before = AT_interpreter.getParser().n_frames_good;
+  size_t ret_val = tympanBle.send(s);
+  int n_frames = (int)(AT_interpreter.getParser().n_frames_good - n_good_before);
+  int n_frames_needed = max(1, (len + SERIAL_FRAME_MAX_PAYLOAD - 1) / SERIAL_FRAME_MAX_PAYLOAD);
+  bool same = (AT_interpreter.ble_bytes.size() == (size_t)len) && (memcmp(AT_interpreter.ble_bytes.data(), s.data(), len) == 0);
+  char name[64]; snprintf(name, sizeof(name), "binary: send() of %d bytes", len);
+  report(name, (ret_val == (size_t)len) && same && (n_frames == n_frames_needed),
+    "returned " + String((unsigned long)ret_val) + ", " + String(n_frames) + " frame(s), " + (same ? "same bytes" : "DIFFERENT bytes"));
+}
+
+//write raw bytes to the nRF52 and return the error code of the NAK that comes back (or -1 if none)
+int nakErrorFor(const uint8_t *bytes, int n, bool wait_for_gap) {
+  while (serial_from_nRF.available()) serial_from_nRF.read();
+  serial_to_nRF.write(bytes, n);
+  AT_interpreter.serviceFrames();
+  if (wait_for_gap) { delay(SERIAL_FRAME_GAP_MILLIS + 1);  AT_interpreter.serviceFrames(); }
+  SerialFrameParser parser;
+  while (serial_from_nRF.available()) {
+    if ((parser.processByte((uint8_t)serial_from_nRF.read()) > 0) && (parser.getOpcode() == SERIAL_FRAME_OP_NAK) && (parser.getPayloadLength() == 2)) {
+      return parser.getPayload()[1];
+    }
+  }
+  return -1;
+}
+
+void checkNaks(void) {
+  uint8_t frame[SERIAL_FRAME_HEADER_BYTES + 2] = { SERIAL_FRAME_SYNC, SERIAL_FRAME_OP_GET_NAME, 0, 0, 0, 0 };
+  uint16_t crc = 0xFFFF;
+  for (int i = 1; i < SERIAL_FRAME_HEADER_BYTES; i++) crc = SerialFrameParser::updateCRC16(crc, frame[i]);
+  frame[4] = (uint8_t)((crc & 0xFF) ^ 0x01);  frame[5] = (uint8_t)(crc >> 8);  //a bad CRC
+  int err = nakErrorFor(frame, 6, false);
+  report("NAK for a bad CRC", err == SERIAL_FRAME_ERR_CRC, "error " + String(err));
+
+  const uint8_t too_long[SERIAL_FRAME_HEADER_BYTES] = { SERIAL_FRAME_SYNC, SERIAL_FRAME_OP_SEND, 0xFF, 0xFF };
+  err = nakErrorFor(too_long, SERIAL_FRAME_HEADER_BYTES, false);
+  report("NAK for a length over SERIAL_FRAME_MAX_PAYLOAD", err == SERIAL_FRAME_ERR_LENGTH, "error " + String(err));
+
+  const uint8_t cut_short[SERIAL_FRAME_HEADER_BYTES + 3] = { SERIAL_FRAME_SYNC, SERIAL_FRAME_OP_SEND, 10, 0, 'a', 'b', 'c' };
+  err = nakErrorFor(cut_short, SERIAL_FRAME_HEADER_BYTES + 3, true);
+  report("NAK for a frame that stops part way (gap)", err == SERIAL_FRAME_ERR_GAP, "error " + String(err));
+}
+
+//run the sketch's fuzz test, then judge it from the test's own counts
+void checkFuzz(int corrupt_every) {
+  Serial.quiet = true;
+  runFrameFuzzTest(2000, corrupt_every);
+  Serial.quiet = false;
+  int n_lost = 0, n_damaged = 0;
+  for (int seq = 0; seq < 2000; seq++) {
+    if (frameTest_interpreter.corrupted[seq]) n_damaged++;
+    else if (!frameTest_interpreter.delivered[seq]) n_lost++;
+  }
+  char name[64]; snprintf(name, sizeof(name), "fuzz: 2000 frames, trouble for 1 in %d", corrupt_every);
+  if (corrupt_every == 0) snprintf(name, sizeof(name), "fuzz: 2000 frames, no trouble");
+  report(name, (n_lost == 0) && (frameTest_interpreter.n_corrupt_accepted == 0),
+    String(n_damaged) + " damaged, " + String(n_lost) + " good lost, " + String(frameTest_interpreter.n_corrupt_accepted) + " damaged reached BLE");
+}
+
+int main(void) {
+  printf("simFrameLink: the wired link's binary frames, with SERIAL_FRAME_MAX_PAYLOAD = %d\n", SERIAL_FRAME_MAX_PAYLOAD);
+  Serial.quiet = true;  //the sketch's own printing
+
+  checkCRC();
+  checkCommands("text", String("Tympan-HOST"));
+  report("switch to binary frames", tympanBle.setBinaryFraming(true) == 0);
+  checkCommands("binary", String(""));
+  for (int len : {1, SERIAL_FRAME_MAX_PAYLOAD, SERIAL_FRAME_MAX_PAYLOAD + 1, 1300, 4 * SERIAL_FRAME_MAX_PAYLOAD}) checkLongSend(len);
+  checkNaks();
+  report("switch back to text commands", tympanBle.setBinaryFraming(false) == 0);
+  checkCommands("text", String("Tympan-binary"));  //the name that the binary frame set
+
+  for (int corrupt_every : {10, 2, 0}) checkFuzz(corrupt_every);
+
+  Serial.quiet = false;
+  printf("\nThroughput (the host's CPU time to parse, not the baud rate):\n");
+  runFrameThroughputTest(2000, 244);
+
+  printf("simFrameLink: %s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
@@ -0,0 +1,230 @@
+// ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// This code is used on **both** the Tympan and the nRF52 for the binary framing of messages on the wired serial link.
+// The AT-style text commands (see nRF52_AT_API.h) are the default.  The Tympan can switch the link to binary
+// frames with "SET FRAMING=BINARY" (and back again with the SERIAL_FRAME_OP_TEXT_MODE frame).
+//
+// /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef Serial_Frame_h
+#define Serial_Frame_h
+
+/*
+  Frame format:
+    uint8 sync (SERIAL_FRAME_SYNC), uint8 opcode, uint16 payload length (little-endian), the payload,
+    then the uint16 CRC-16/CCITT-FALSE (little-endian) of the opcode, the length, and the payload.
+
+  Unlike the text "SEND " command, the payload can hold any byte (including '\r'), and it does not need to be
+  searched for the end-of-command character.  The nRF52 replies to a command frame with a frame having the same
+  opcode plus SERIAL_FRAME_REPLY.  SEND frames get no reply, to keep the link free for the telemetry.  A frame that
+  fails (or that has an unknown opcode) gets a SERIAL_FRAME_OP_NAK frame with the payload [opcode, error code], where
+  the error code says why it failed (SERIAL_FRAME_ERR_*).  A payload longer than SERIAL_FRAME_MAX_PAYLOAD has to be
+  sent as several frames.
+*/
+
+#define SERIAL_FRAME_SYNC          0xA5
+#define SERIAL_FRAME_MAX_PAYLOAD   512
+#define SERIAL_FRAME_HEADER_BYTES  4   //sync, opcode, and length
+#define SERIAL_FRAME_OVERHEAD      (SERIAL_FRAME_HEADER_BYTES + 2)
+#define SERIAL_FRAME_BUFF_BYTES    (SERIAL_FRAME_MAX_PAYLOAD + SERIAL_FRAME_OVERHEAD)  //the longest frame
+#define SERIAL_FRAME_GAP_MILLIS    20    //a frame's bytes are sent back-to-back, so a gap this long means it lost its end
+#define SERIAL_FRAME_REPLY         0x80
+
+#define SERIAL_FRAME_OP_SEND       0x01  //payload goes straight out over BLE
+#define SERIAL_FRAME_OP_SET_NAME   0x02  //payload is the new BLE name
+#define SERIAL_FRAME_OP_GET_NAME   0x03  //reply's payload is the BLE name
+#define SERIAL_FRAME_OP_VERSION    0x04  //reply's payload is the firmware version string
+#define SERIAL_FRAME_OP_TEXT_MODE  0x05  //go back to the AT-style text commands (after the reply)
+#define SERIAL_FRAME_N_OPCODES     6
+#define SERIAL_FRAME_OP_NAK        0x7F
+
+#define SERIAL_FRAME_ERR_CRC       1  //the CRC did not match
+#define SERIAL_FRAME_ERR_OPCODE    2  //no such opcode
+#define SERIAL_FRAME_ERR_FAILED    3  //the command itself failed
+#define SERIAL_FRAME_ERR_LENGTH    4  //the length was longer than SERIAL_FRAME_MAX_PAYLOAD
+#define SERIAL_FRAME_ERR_GAP       5  //the link went quiet in the middle of the frame (see checkGap())
+
+class SerialFrameParser {
+  public:
+    SerialFrameParser(void) { reset(); }
+
+    enum { WAIT_SYNC = 0, GET_OPCODE, GET_LEN_LO, GET_LEN_HI, GET_PAYLOAD, GET_CRC_LO, GET_CRC_HI };
+    void reset(void) { state = WAIT_SYNC;  n_buff = 0;  read_ind = 0;  waiting_since_millis = 0; }
+
+    //Feed one received byte.  Returns 1 when a good frame is complete (see getOpcode() and getPayload()), -1 when a
+    //frame failed (its CRC, or a length that can't be right), and 0 otherwise.  Bytes outside of a frame are skipped.
+    //
+    //When a frame fails, its sync byte might have been garbage, or a byte might have been lost, so the frame's bytes
+    //can hold the start of the next (good) frame.  So, the parser keeps the bytes of the frame that it is working on
+    //and, after a failure, it goes back and looks for a sync in them starting from the byte after the failed sync.
+    //That can find more than one result from the bytes that it already has, so after any non-zero result, call
+    //update() (with no new byte) until it returns 0 before giving it the next byte:
+    //    int ret_val = parser.processByte(c);
+    //    while (ret_val != 0) { ...handle ret_val...;  ret_val = parser.update(); }
+    //A garbage sync (or a lost length byte) can also claim a frame that is longer than what was sent, which would hold
+    //the good frames after it until more bytes come in.  So, call checkGap() whenever no bytes have come in.
+    int processByte(uint8_t c) {
+      waiting_since_millis = 0;  //not waiting
+      if (n_buff >= SERIAL_FRAME_BUFF_BYTES) { n_bytes_skipped++;  return update(); }  //update() wasn't called until 0
+      buff[n_buff++] = c;
+      return update();
+    }
+
+    //go through the bytes that have not been looked at yet (see processByte()).  Returns the same as processByte().
+    int update(void) {
+      while (read_ind < n_buff) {
+        int ret_val = processNextByte(buff[read_ind++]);
+        if (ret_val > 0) {
+          discardBytes(read_ind);  //the good frame is done.  Keep anything after it.
+          return ret_val;
+        } else if (ret_val < 0) {
+          restartAfterBadFrame();
+          return ret_val;
+        }
+      }
+      return 0;
+    }
+
+    //call this when no new bytes have come in.  If the link has been quiet for SERIAL_FRAME_GAP_MILLIS in the middle of
+    //a frame, that frame fails (it returns -1), and the parser looks again through its bytes, like for a bad CRC.
+    int checkGap(void) {
+      if ((state == WAIT_SYNC) || (read_ind < n_buff)) return update();
+      unsigned long cur_millis = max(1UL, millis());  //zero means not waiting
+      if (waiting_since_millis == 0) { waiting_since_millis = cur_millis;  return 0; }
+      if ((cur_millis - waiting_since_millis) < SERIAL_FRAME_GAP_MILLIS) return 0;
+      waiting_since_millis = 0;
+      n_frames_bad++;  last_error = SERIAL_FRAME_ERR_GAP;
+      restartAfterBadFrame();
+      return -1;
+    }
+
+    //the most recent frame.  The payload stays valid until the next call to processByte(), update(), or checkGap().
+    uint8_t getOpcode(void) { return opcode; }
+    const uint8_t* getPayload(void) { return payload; }
+    int getPayloadLength(void) { return payload_len; }
+    uint8_t getError(void) { return last_error; }  //why the most recent failed frame failed (SERIAL_FRAME_ERR_CRC, _LENGTH, or _GAP)
+
+    unsigned long n_frames_good = 0, n_frames_bad = 0, n_bytes_skipped = 0;
+
+    //write a whole frame.  The payload is written straight from the caller's buffer (no copy).  Returns the bytes written.
+    static size_t writeFrame(HardwareSerial *ser_ptr, uint8_t opcode, const uint8_t *payload, int len) {
+      if ((len < 0) || (len > SERIAL_FRAME_MAX_PAYLOAD)) return 0;
+      uint8_t header[SERIAL_FRAME_HEADER_BYTES] = { SERIAL_FRAME_SYNC, opcode, (uint8_t)(len & 0xFF), (uint8_t)((len >> 8) & 0xFF) };
+      uint16_t frame_crc = 0xFFFF;
+      for (int i = 1; i < SERIAL_FRAME_HEADER_BYTES; i++) frame_crc = updateCRC16(frame_crc, header[i]);
+      for (int i = 0; i < len; i++) frame_crc = updateCRC16(frame_crc, payload[i]);
+      uint8_t footer[2] = { (uint8_t)(frame_crc & 0xFF), (uint8_t)(frame_crc >> 8) };
+
+      size_t n = ser_ptr->write(header, SERIAL_FRAME_HEADER_BYTES);
+      if (len > 0) n += ser_ptr->write(payload, len);
+      n += ser_ptr->write(footer, 2);
+      return n;
+    }
+
+    //CRC-16/CCITT-FALSE (polynomial 0x1021, start at 0xFFFF), one byte at a time from a 256-entry table (512 bytes
+    //of flash).  crc_table[i] is the CRC of the byte i with a starting value of 0.
+    static uint16_t updateCRC16(uint16_t crc, uint8_t c) {
+      static const uint16_t crc_table[256] = {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+        0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+        0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+        0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+        0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+        0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+        0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+        0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+        0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+        0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+        0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+        0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+        0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+        0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+        0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+        0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+        0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+        0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+        0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+        0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+        0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+        0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+        0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+        0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+        0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+        0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+        0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+        0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+        0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+        0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+        0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+        0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
+      };
+      return (uint16_t)((crc << 8) ^ crc_table[((crc >> 8) ^ c) & 0xFF]);
+    }
+
+  protected:
+    //the state machine for one byte.  The sync of the frame being parsed is always buff[0].
+    int processNextByte(uint8_t c) {
+      switch (state) {
+        case WAIT_SYNC:
+          if (c == SERIAL_FRAME_SYNC) {
+            discardBytes(read_ind - 1);  //the sync is now buff[0]
+            opcode = 0;  //until it comes in (a NAK for a frame that stops right after its sync says opcode 0)
+            state = GET_OPCODE;
+          } else {
+            n_bytes_skipped++;
+            if (read_ind == n_buff) discardBytes(read_ind);  //nothing is left to look at, so forget the skipped bytes
+          }
+          return 0;
+        case GET_OPCODE:
+          opcode = c;  crc = updateCRC16(0xFFFF, c);  state = GET_LEN_LO;
+          return 0;
+        case GET_LEN_LO:
+          payload_len = c;  crc = updateCRC16(crc, c);  state = GET_LEN_HI;
+          return 0;
+        case GET_LEN_HI:
+          payload_len |= ((uint16_t)c) << 8;  crc = updateCRC16(crc, c);
+          if (payload_len > SERIAL_FRAME_MAX_PAYLOAD) { n_frames_bad++;  last_error = SERIAL_FRAME_ERR_LENGTH;  return -1; }  //can't be a real frame
+          n_received = 0;
+          state = (payload_len > 0) ? GET_PAYLOAD : GET_CRC_LO;
+          return 0;
+        case GET_PAYLOAD:
+          payload[n_received++] = c;  crc = updateCRC16(crc, c);
+          if (n_received >= payload_len) state = GET_CRC_LO;
+          return 0;
+        case GET_CRC_LO:
+          received_crc = c;  state = GET_CRC_HI;
+          return 0;
+        case GET_CRC_HI:
+          received_crc |= ((uint16_t)c) << 8;  state = WAIT_SYNC;
+          if (received_crc == crc) { n_frames_good++; return 1; }
+          n_frames_bad++;  last_error = SERIAL_FRAME_ERR_CRC;
+          return -1;
+      }
+      state = WAIT_SYNC;
+      return 0;
+    }
+
+    //start again from the byte after the sync of the frame that failed
+    void restartAfterBadFrame(void) {
+      state = WAIT_SYNC;
+      read_ind = 1;  discardBytes(1);  n_bytes_skipped++;
+    }
+
+    //forget the first n bytes in buff
+    void discardBytes(int n) {
+      if (n <= 0) return;
+      if (n < n_buff) memmove(buff, buff + n, n_buff - n);
+      n_buff = max(0, n_buff - n);  read_ind = max(0, read_ind - n);
+    }
+
+    int state = WAIT_SYNC;
+    uint8_t opcode = 0, last_error = 0;
+    uint16_t payload_len = 0, n_received = 0;
+    uint16_t crc = 0xFFFF, received_crc = 0;
+    uint8_t payload[SERIAL_FRAME_MAX_PAYLOAD];
+    uint8_t buff[SERIAL_FRAME_BUFF_BYTES];  //the bytes of the frame being parsed (from its sync), and any after it
+    int n_buff = 0, read_ind = 0;
+    unsigned long waiting_since_millis = 0;  //when checkGap() first saw no new bytes in the middle of a frame
+};
+
+#endif
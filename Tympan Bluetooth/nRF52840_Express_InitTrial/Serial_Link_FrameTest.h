@@ -0,0 +1,210 @@
+// /////////////////////////////////////////////////////////////////////////////////////////
+//
+// This code is only needed for testing the binary frames (Serial_Frame.h) of the nRF52_AT_API.
+// It drives a second nRF52_AT_API through its own Serial_Simulator, so it doesn't need a BLE
+// connection (or a Tympan) and it doesn't disturb the simulated link used by the rest of the demo.
+//
+// ////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef Serial_Link_FrameTest_h
+#define Serial_Link_FrameTest_h
+
+#include "Serial_Frame.h"
+#include "nRF52_AT_API.h"
+#include "Serial_Link_Simulator.h"
+
+#define FRAME_TEST_MAX_FRAMES 2000
+
+//Each test payload is fully defined by its sequence number (its first two bytes), so that the
+//receiver can check every byte of every payload that reaches the BLE side
+class FrameTest_Payload {
+  public:
+    static int getLength(uint16_t seq) { return 2 + (int)(hash(seq) % (SERIAL_FRAME_MAX_PAYLOAD - 1)); }
+    static void fill(uint16_t seq, uint8_t *buff) {
+      int len = getLength(seq);
+      buff[0] = (uint8_t)(seq & 0xFF); buff[1] = (uint8_t)(seq >> 8);
+      uint32_t x = hash(seq + 0x10000);
+      for (int i=2; i < len; i++) { x = xorshift32(x); buff[i] = (uint8_t)x; }
+    }
+    static bool check(const uint8_t *buff, int len) {
+      if (len < 2) return false;
+      uint16_t seq = (uint16_t)buff[0] | ((uint16_t)buff[1] << 8);
+      if (len != getLength(seq)) return false;
+      uint32_t x = hash(seq + 0x10000);
+      for (int i=2; i < len; i++) { x = xorshift32(x); if (buff[i] != (uint8_t)x) return false; }
+      return true;
+    }
+    static uint32_t xorshift32(uint32_t x) { x ^= x << 13; x ^= x >> 17; x ^= x << 5; return x; }
+    static uint32_t hash(uint32_t x) { return xorshift32(xorshift32(x * 2654435761UL + 1)); }
+};
+
+//an nRF52_AT_API that checks the payloads instead of writing them to BLE
+class FrameTest_AT_API : public nRF52_AT_API {
+  public:
+    FrameTest_AT_API(BLEUart_Tympan *_bleuart, HardwareSerial *_ser_ptr) : nRF52_AT_API(_bleuart, _ser_ptr) {}
+    virtual int writeToBle(const uint8_t *buff, int len) {
+      n_writes++;  n_bytes += len;
+      if (check_payloads) {
+        if (FrameTest_Payload::check(buff, len)) {
+          uint16_t seq = (uint16_t)buff[0] | ((uint16_t)buff[1] << 8);
+          if ((seq < FRAME_TEST_MAX_FRAMES) && corrupted[seq]) n_corrupt_accepted++;
+          if (seq < FRAME_TEST_MAX_FRAMES) delivered[seq] = true;
+        } else {
+          n_corrupt_accepted++;  //a payload that was not sent
+        }
+      }
+      return len;
+    }
+    void resetCounts(void) {
+      n_writes = 0; n_bytes = 0; n_corrupt_accepted = 0;
+      for (int i=0; i < FRAME_TEST_MAX_FRAMES; i++) { corrupted[i] = false; delivered[i] = false; }
+    }
+    SerialFrameParser& getParser(void) { return frame_parser; }
+
+    bool check_payloads = true;
+    unsigned long n_writes = 0, n_bytes = 0, n_corrupt_accepted = 0;
+    bool corrupted[FRAME_TEST_MAX_FRAMES], delivered[FRAME_TEST_MAX_FRAMES];
+};
+
+//the test objects are big, so make them once (not on the stack)
+Serial_Simulator frameTest_serialToNRF;
+Serial_Simulator frameTest_serialFromNRF;
+FrameTest_AT_API frameTest_interpreter(&bleService_tympanUART, &frameTest_serialFromNRF);
+uint8_t frameTest_buff[SERIAL_FRAME_MAX_PAYLOAD + SERIAL_FRAME_OVERHEAD];
+
+//give everything that has been written to the simulated link to the interpreter (and drain its replies)
+void frameTest_service(void) {
+  while (frameTest_serialToNRF.available()) frameTest_interpreter.processSerialCharacter((char)frameTest_serialToNRF.read());
+  while (frameTest_serialFromNRF.available()) frameTest_serialFromNRF.read();
+}
+
+bool frameTest_setBinaryMode(bool enable) {
+  if (enable != frameTest_interpreter.isBinaryMode()) {
+    if (enable) {
+      frameTest_serialToNRF.write((const uint8_t *)"SET FRAMING=BINARY\r", 19);
+    } else {
+      SerialFrameParser::writeFrame(&frameTest_serialToNRF, SERIAL_FRAME_OP_TEXT_MODE, NULL, 0);
+    }
+    frameTest_service();
+  }
+  return (frameTest_interpreter.isBinaryMode() == enable);
+}
+
+//Send n_frames of test payloads as binary frames.  About one in corrupt_every frames has trouble on the way: a flipped
+//bit, a lost byte, or some garbage bytes before it (the frame itself is still good).  Every good frame should reach BLE
+//(the parser looks again after each bad frame, so the trouble before a good frame can't swallow it), and no damaged
+//frame should ever reach BLE.
+void runFrameFuzzTest(int n_frames, int corrupt_every) {
+  n_frames = min(n_frames, FRAME_TEST_MAX_FRAMES);
+  Serial.println("runFrameFuzzTest: " + String(n_frames) + " frames, with trouble for about 1 in " + String(corrupt_every) + "...");
+  if (!frameTest_setBinaryMode(true)) { Serial.println("runFrameFuzzTest: *** ERROR ***: could not switch to binary frames"); return; }
+  frameTest_interpreter.resetCounts();
+  SerialFrameParser &parser = frameTest_interpreter.getParser();
+  unsigned long start_good = parser.n_frames_good, start_bad = parser.n_frames_bad;
+
+  uint32_t rand_state = 12345;
+  int n_damaged = 0, n_garbage = 0;
+  for (int seq=0; seq < n_frames; seq++) {
+    //build the frame (in its own buffer, so that it can be damaged)
+    static uint8_t payload[SERIAL_FRAME_MAX_PAYLOAD];
+    FrameTest_Payload::fill(seq, payload);
+    int len = FrameTest_Payload::getLength(seq);
+    uint16_t crc = 0xFFFF;
+    frameTest_buff[0] = SERIAL_FRAME_SYNC; frameTest_buff[1] = SERIAL_FRAME_OP_SEND;
+    frameTest_buff[2] = (uint8_t)(len & 0xFF); frameTest_buff[3] = (uint8_t)(len >> 8);
+    for (int i=1; i < SERIAL_FRAME_HEADER_BYTES; i++) crc = SerialFrameParser::updateCRC16(crc, frameTest_buff[i]);
+    for (int i=0; i < len; i++) { frameTest_buff[SERIAL_FRAME_HEADER_BYTES + i] = payload[i]; crc = SerialFrameParser::updateCRC16(crc, payload[i]); }
+    int n = SERIAL_FRAME_HEADER_BYTES + len;
+    frameTest_buff[n++] = (uint8_t)(crc & 0xFF); frameTest_buff[n++] = (uint8_t)(crc >> 8);
+
+    //damage it?
+    rand_state = FrameTest_Payload::xorshift32(rand_state);
+    if ((corrupt_every > 0) && ((rand_state % corrupt_every) == 0)) {
+      rand_state = FrameTest_Payload::xorshift32(rand_state);
+      int pos = (int)((rand_state >> 8) % n);
+      switch (rand_state % 3) {
+        case 0:  //flip one bit
+          frameTest_interpreter.corrupted[seq] = true;  n_damaged++;
+          frameTest_buff[pos] ^= (uint8_t)(1 << ((rand_state >> 4) % 8));
+          break;
+        case 1:  //lose one byte
+          frameTest_interpreter.corrupted[seq] = true;  n_damaged++;
+          for (int i=pos; i < n-1; i++) frameTest_buff[i] = frameTest_buff[i+1];
+          n--;
+          break;
+        case 2:  //garbage bytes before the frame
+          n_garbage++;
+          for (int i=0; i < 1 + (int)(pos % 8); i++) { rand_state = FrameTest_Payload::xorshift32(rand_state); frameTest_serialToNRF.write((uint8_t)rand_state); }
+          break;
+      }
+    }
+
+    frameTest_serialToNRF.write(frameTest_buff, n);
+    frameTest_service();  //each frame fits in the simulated link, so service it every frame
+  }
+
+  //A damaged frame near the end can leave the parser waiting for the rest of a frame that it thinks that it found,
+  //while holding the good frames after it.  Let the link go quiet so that the parser gives up on it (see checkGap()).
+  frameTest_interpreter.serviceFrames();
+  delay(SERIAL_FRAME_GAP_MILLIS + 1);
+  frameTest_interpreter.serviceFrames();
+  frameTest_service();
+
+  int n_good_lost = 0;
+  for (int seq=0; seq < n_frames; seq++) if (!frameTest_interpreter.corrupted[seq] && !frameTest_interpreter.delivered[seq]) n_good_lost++;
+  Serial.println("runFrameFuzzTest: damaged " + String(n_damaged) + ", garbage before " + String(n_garbage) + ", good frames that were lost " + String(n_good_lost)
+      + ", damaged frames that reached BLE " + String(frameTest_interpreter.n_corrupt_accepted));
+  Serial.println("runFrameFuzzTest: parser: good " + String(parser.n_frames_good - start_good) + ", bad " + String(parser.n_frames_bad - start_bad));
+  if ((frameTest_interpreter.n_corrupt_accepted == 0) && (n_good_lost == 0)) {
+    Serial.println("runFrameFuzzTest: PASS");
+  } else {
+    Serial.println("runFrameFuzzTest: *** FAIL ***");
+  }
+  frameTest_interpreter.getParser().reset();  //the last damaged frame could have left the parser waiting for more bytes
+  frameTest_setBinaryMode(false);
+}
+
+//Time how long the nRF52 takes to parse the same payloads as binary frames and as text "SEND " commands.  The text
+//payloads avoid '\r' (which the text commands can't carry).  This is the CPU time per byte, not the serial baud rate.
+void runFrameThroughputTest(int n_frames, int payload_len) {
+  payload_len = max(1, min(payload_len, min(SERIAL_FRAME_MAX_PAYLOAD, MESSAGE_LENGTH - 1)));
+  n_frames = max(1, n_frames);
+  static uint8_t payload[SERIAL_FRAME_MAX_PAYLOAD];
+  for (int i=0; i < payload_len; i++) payload[i] = (uint8_t)('A' + (i % 26));
+  frameTest_interpreter.check_payloads = false;
+  Serial.println("runFrameThroughputTest: " + String(n_frames) + " messages of " + String(payload_len) + " bytes...");
+
+  //binary frames
+  frameTest_setBinaryMode(true);
+  frameTest_interpreter.resetCounts();
+  unsigned long parse_usec = 0;
+  for (int i=0; i < n_frames; i++) {
+    SerialFrameParser::writeFrame(&frameTest_serialToNRF, SERIAL_FRAME_OP_SEND, payload, payload_len);
+    unsigned long start_usec = micros();
+    frameTest_service();
+    parse_usec += micros() - start_usec;
+  }
+  unsigned long binary_usec = parse_usec, binary_bytes = frameTest_interpreter.n_bytes;
+
+  //text commands
+  frameTest_setBinaryMode(false);
+  frameTest_interpreter.resetCounts();
+  parse_usec = 0;
+  for (int i=0; i < n_frames; i++) {
+    frameTest_serialToNRF.write((const uint8_t *)"SEND ", 5);
+    frameTest_serialToNRF.write(payload, payload_len);
+    frameTest_serialToNRF.write((uint8_t)'\r');
+    unsigned long start_usec = micros();
+    frameTest_service();
+    parse_usec += micros() - start_usec;
+  }
+  unsigned long text_usec = parse_usec, text_bytes = frameTest_interpreter.n_bytes;
+  frameTest_interpreter.check_payloads = true;
+
+  Serial.println("runFrameThroughputTest: binary: " + String(binary_bytes) + " bytes to BLE in " + String(binary_usec) + " usec ("
+      + String(((float)binary_usec) / ((float)max(1UL, binary_bytes)), 3) + " usec/byte)");
+  Serial.println("runFrameThroughputTest: text:   " + String(text_bytes) + " bytes to BLE in " + String(text_usec) + " usec ("
+      + String(((float)text_usec) / ((float)max(1UL, text_bytes)), 3) + " usec/byte)");
+}
+
+#endif
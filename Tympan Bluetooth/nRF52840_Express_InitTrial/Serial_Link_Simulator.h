@@ -60,7 +60,7 @@ class Serial_Simulator : public HardwareSerial {
     int available(void) {
       int n_avail = 0;
       if (read_ind > write_ind) {
-        n_avail = ((SERIAL_N_BUFFER-1) - read_ind) + write_ind;
+        n_avail = (SERIAL_N_BUFFER - read_ind) + write_ind;
       } else {
         n_avail = write_ind - read_ind;
       }
@@ -17,6 +17,8 @@ extern BLE_nRF52 tympanBle;
 extern void updateLEDs(void);
 extern void printBleName(void);
 extern void setBleName(const String &s);
+extern void runFrameFuzzTest(int n_frames, int corrupt_every);
+extern void runFrameThroughputTest(int n_frames, int payload_len);
 
 // /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // functions that would normally run on the Tympan to respond to commands coming from the phone (via BLE through this SerialManager)
@@ -70,6 +72,9 @@ void TympanSerialManager::printHelp(void) {
   Serial.println("   n:   Set the BLE name to Tympan-NEW");
   Serial.println("   v:   Get the BLE unit's firmware version");
   Serial.println("   j:   Send JOSN string for TympanRemote GUI");
+  Serial.println("   b/B: Use binary frames (b) or text commands (B) to the BLE unit (currently: " + String(tympanBle.isBinaryFraming() ? "binary" : "text") + ")");
+  Serial.println("   z:   Test the binary frames with damaged frames (fuzz test)");
+  Serial.println("   x:   Time the binary frames versus the text commands");
   Serial.println();
 }
 
@@ -108,6 +113,20 @@ void TympanSerialManager::respondToByte(char c) {
       Serial.println("TympanSerialManager: getting nRF's firmware version...");
       getBleFirmwareVersion();
       break;
+    case 'b':
+      Serial.println("TympanSerialManager: switching to binary frames to the BLE unit...");
+      Serial.println("TympanSerialManager: setBinaryFraming: ret_val = " + String(tympanBle.setBinaryFraming(true)));
+      break;
+    case 'B':
+      Serial.println("TympanSerialManager: switching to text commands to the BLE unit...");
+      Serial.println("TympanSerialManager: setBinaryFraming: ret_val = " + String(tympanBle.setBinaryFraming(false)));
+      break;
+    case 'z':
+      runFrameFuzzTest(2000, 10);
+      break;
+    case 'x':
+      runFrameThroughputTest(1000, 244);
+      break;
     case 'j': case 'J':
       Serial.println("TympanSerialManager: sending JSON string for TympanApp GUI...");
       printTympanRemoteLayout();
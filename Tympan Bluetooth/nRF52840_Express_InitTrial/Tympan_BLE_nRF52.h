@@ -8,6 +8,8 @@
 #ifndef Tympan_BLE_nRF52_h
 #define Tympan_BLE_nRF52_h
 
+#include "Serial_Frame.h"
+
 extern void bleUnitServiceSerial(void);
 
 char foo_digit2ascii(uint8_t digit) {
@@ -69,12 +71,22 @@ class BLE_nRF52 {
 
     int version(bool printResult);
 
+    //binary frames (see Serial_Frame.h), instead of the text commands
+    int setBinaryFraming(bool enable);
+    bool isBinaryFraming(void) { return use_binary_frames; }
+    size_t sendFrame(uint8_t opcode, const uint8_t *payload, int len) { return SerialFrameParser::writeFrame(serialToBLE, opcode, payload, len); }
+    size_t sendBinary(const uint8_t *payload, int len);  //straight out over BLE.  Returns the bytes of the payload that were sent.
+    int recvFrameReply(uint8_t opcode, unsigned long timeout_millis);  //returns the length of the reply's payload (or -1)
+    int recvFrameReply(uint8_t opcode) { return recvFrameReply(opcode, rx_timeout_millis); }
+
     unsigned long rx_timeout_millis = 2000UL;
     bool simulated_Serial_to_nRF = true;
   protected:
     const String EOC = String('\r');
     HardwareSerial *serialToBLE = &Serial1;    //Tympan design uses Teensy's Serial1 to connect to BLE
     HardwareSerial *serialFromBLE = &Serial1;  //Tympan design uses Teensy's Serial1 to connect from BLE
+    bool use_binary_frames = false;
+    SerialFrameParser reply_parser;
 
     static bool doesStartWithOK(const String &s);
 };
@@ -88,6 +100,7 @@ size_t BLE_nRF52::send(const String &str) {
   //BLE_TX_ptr->print(ble_char_id);
   //BLE_TX_ptr->print(",");
   //BLE_TX_ptr->println(str);
+  if (use_binary_frames) return sendBinary((const uint8_t *)str.c_str(), str.length());
   serialToBLE->write("SEND ",5);  //out AT command set assumes that each transmission starts with "SEND "
   int success = serialToBLE->write(str.c_str(), str.length() );
   serialToBLE->write(EOC.c_str(),EOC.length());  // our AT command set on the nRF52 assumes that each command ends in a '\r'
@@ -100,6 +113,20 @@ size_t BLE_nRF52::send(const String &str) {
   return str.length();
 }
 
+//a frame holds at most SERIAL_FRAME_MAX_PAYLOAD bytes, so a longer payload goes as several SEND frames, back-to-back.
+//The nRF52 writes each one to BLE as it arrives, so the phone gets the same bytes in the same order.  Returns 0 if any
+//frame could not be written.
+size_t BLE_nRF52::sendBinary(const uint8_t *payload, int len) {
+  if (len < 0) return 0;
+  int n_sent = 0;
+  do {
+    int n = min(len - n_sent, SERIAL_FRAME_MAX_PAYLOAD);
+    if (sendFrame(SERIAL_FRAME_OP_SEND, payload + n_sent, n) == 0) return 0;
+    n_sent += n;
+  } while (n_sent < len);
+  return n_sent;
+}
+
 size_t BLE_nRF52::sendString(const String &s, bool print_debug) {
   int ret_val = send(s);
   if (ret_val == s.length() ) {
@@ -224,6 +251,14 @@ bool BLE_nRF52::doesStartWithOK(const String &s) {
 }
 
 int BLE_nRF52::setBleName(const String &s) {
+  if (use_binary_frames) {
+    sendFrame(SERIAL_FRAME_OP_SET_NAME, (const uint8_t *)s.c_str(), s.length());
+    if (simulated_Serial_to_nRF) bleUnitServiceSerial();  //for the nRF firmware, service any messages coming in the serial port from the Tympan
+    if (recvFrameReply(SERIAL_FRAME_OP_SET_NAME) >= 0) return 0;
+    Serial.println("BLE_nRF52: setBleName: failed to set the BLE name (binary frame).");
+    return -1;
+  }
+
   sendCommand("SET NAME=", s);
   if (simulated_Serial_to_nRF) bleUnitServiceSerial();  //for the nRF firmware, service any messages coming in the serial port from the Tympan
   
@@ -238,6 +273,16 @@ int BLE_nRF52::setBleName(const String &s) {
 }
 
 int BLE_nRF52::getBleName(String &reply) {
+  if (use_binary_frames) {
+    sendFrame(SERIAL_FRAME_OP_GET_NAME, NULL, 0);
+    if (simulated_Serial_to_nRF) bleUnitServiceSerial();  //for the nRF firmware, service any messages coming in the serial port from the Tympan
+    int len = recvFrameReply(SERIAL_FRAME_OP_GET_NAME);
+    if (len < 0) { Serial.println("BLE_nRF52: getBleName: failed to get the BLE name (binary frame)."); return -1; }
+    const uint8_t *name = reply_parser.getPayload();
+    for (int i=0; i < len; i++) reply.concat((char)name[i]);
+    return 0;
+  }
+
   sendCommand(String("GET NAME"), String(""));
   if (simulated_Serial_to_nRF) bleUnitServiceSerial();  //for the nRF firmware, service any messages coming in the serial port from the Tympan
   
@@ -255,6 +300,18 @@ int BLE_nRF52::getBleName(String &reply) {
 }
 
 int BLE_nRF52::version(bool printResult) {
+  if (use_binary_frames) {
+    sendFrame(SERIAL_FRAME_OP_VERSION, NULL, 0);
+    if (simulated_Serial_to_nRF) bleUnitServiceSerial();  //for the nRF firmware, service any messages coming in the serial port from the Tympan
+    int len = recvFrameReply(SERIAL_FRAME_OP_VERSION);
+    if (len < 0) { Serial.println("BLE_nRF52: version: failed to get the BLE firmware version (binary frame)."); return -1; }
+    String reply;
+    const uint8_t *ver = reply_parser.getPayload();
+    for (int i=0; i < len; i++) reply.concat((char)ver[i]);
+    if (printResult) Serial.println("BLE_nR52: version: nRF52 module replied as '" + reply + "'");
+    return 0;
+  }
+
   sendCommand("VERSION", String(""));
   if (simulated_Serial_to_nRF) bleUnitServiceSerial();  //for the nRF firmware, service any messages coming in the serial port from the Tympan
   
@@ -275,6 +332,55 @@ int BLE_nRF52::version(bool printResult) {
   return -1;
 }
 
-#endif
+//switch the link to the nRF52 between binary frames (enable = true) and the text commands
+int BLE_nRF52::setBinaryFraming(bool enable) {
+  if (enable == use_binary_frames) return 0;
+  if (enable) {
+    sendCommand("SET FRAMING=", "BINARY");
+    if (simulated_Serial_to_nRF) bleUnitServiceSerial();  //for the nRF firmware, service any messages coming in the serial port from the Tympan
+    String reply;
+    recvReply(reply);
+    if (!doesStartWithOK(reply)) {
+      Serial.println("BLE_nRF52: setBinaryFraming: failed to switch to binary frames.  Reply = " + reply);
+      return -1;
+    }
+    reply_parser.reset();
+    use_binary_frames = true;
+  } else {
+    sendFrame(SERIAL_FRAME_OP_TEXT_MODE, NULL, 0);
+    if (simulated_Serial_to_nRF) bleUnitServiceSerial();  //for the nRF firmware, service any messages coming in the serial port from the Tympan
+    if (recvFrameReply(SERIAL_FRAME_OP_TEXT_MODE) < 0) {
+      Serial.println("BLE_nRF52: setBinaryFraming: failed to switch back to text commands.");
+      return -1;
+    }
+    use_binary_frames = false;
+  }
+  return 0;
+}
 
+//wait for the reply frame to the given command.  Other frames (such as a NAK for an earlier frame) are skipped.
+int BLE_nRF52::recvFrameReply(uint8_t opcode, unsigned long timeout_millis) {
+  unsigned long max_millis = millis() + timeout_millis;
+  while (millis() < max_millis) {
+    //first, anything that the parser still has from looking again after a bad frame (see Serial_Frame.h)
+    int ret_val = reply_parser.update();
+    if (ret_val == 0) ret_val = serialFromBLE->available() ? reply_parser.processByte((uint8_t)serialFromBLE->read()) : reply_parser.checkGap();
+    if (ret_val > 0) {
+      uint8_t reply_opcode = reply_parser.getOpcode();
+      if (reply_opcode == (opcode | SERIAL_FRAME_REPLY)) return reply_parser.getPayloadLength();
+      if (reply_opcode == SERIAL_FRAME_OP_NAK) {
+        if (reply_parser.getPayloadLength() != 2) {
+          Serial.println("BLE_nRF52: recvFrameReply: NAK with " + String(reply_parser.getPayloadLength()) + " bytes instead of 2.  Ignoring.");
+          continue;
+        }
+        const uint8_t *nak = reply_parser.getPayload();
+        Serial.print("BLE_nRF52: recvFrameReply: NAK for opcode 0x"); Serial.print(nak[0],HEX);
+        Serial.print(", error "); Serial.println(nak[1]);
+        if (nak[0] == opcode) return -1;
+      }
+    }
+  }
+  return -1;
+}
 
+#endif
@@ -33,6 +33,7 @@
 #include "Tympan_BLE_nRF52.h"              //only needed because we're faking that there is a Tympan
 #include "TympanState.h"            //only needed because we're faking that there is a Tympan
 #include "TympanSerialManager.h"    //only needed because we're faking that there is a Tympan
+#include "Serial_Link_FrameTest.h"  //only needed for testing the binary frames
 
 //#define SERIAL_TO_TYMPAN Serial1                 //use this when physically wired to a Tympan. Assumes that the nRF is connected via Serial1 pins
 //#define SERIAL_FROM_TYMPAN Serial1               //use this when physically wired to a Tympan. Assumes that the nRF is connected via Serial1 pins
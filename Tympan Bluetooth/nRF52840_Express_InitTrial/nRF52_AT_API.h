@@ -9,6 +9,7 @@
 #define nRF52_AT_API_H
 
 #include <bluefruit.h>  //gives us the global "Bluefruit" class instance
+#include "Serial_Frame.h"   //for the binary framing mode
 
 //declared in BLE_Stuff.h or TympanBLE.h.  Should we move them inside here?  
 extern bool bleConnected;
@@ -23,8 +24,13 @@ class nRF52_AT_API {
     nRF52_AT_API(BLEUart_Tympan *_bleuart, HardwareSerial *_ser_ptr) : ble_ptr(_bleuart) , serial_ptr(_ser_ptr) {}
     
     virtual int processSerialCharacter(char c);  //here's the main entry point to the AT message parsing
+    void serviceFrames(void);                    //call every loop(), even with no new characters (see Serial_Frame.h)
     virtual int lengthSerialMessage(void);
     virtual int processSerialMessage(void);
+    virtual int processSerialFrame(void);        //dispatch a binary frame that was just received (by its opcode)
+    virtual int writeToBle(const uint8_t *buff, int len);  //returns -1 if not connected
+    bool isBinaryMode(void) { return binary_mode; }
+    void printFrameStats(void);
 
   protected:
     BLEUart_Tympan *ble_ptr = NULL;
@@ -36,6 +42,21 @@ class nRF52_AT_API {
     int serial_read_ind = 0;
     int serial_write_ind = 0;
 
+    //binary framing mode (see Serial_Frame.h).  The payloads are used in place, right from the parser.
+    bool binary_mode = false;
+    SerialFrameParser frame_parser;
+    typedef int (nRF52_AT_API::*FrameHandler)(const uint8_t *payload, int len);
+    static const FrameHandler frame_handlers[SERIAL_FRAME_N_OPCODES];  //indexed by the opcode
+    int frameSend(const uint8_t *payload, int len);
+    int frameSetName(const uint8_t *payload, int len);
+    int frameGetName(const uint8_t *payload, int len);
+    int frameVersion(const uint8_t *payload, int len);
+    int frameTextMode(const uint8_t *payload, int len);
+    void sendFrameReply(uint8_t opcode, const uint8_t *payload, int len);
+    void sendFrameNak(uint8_t opcode, uint8_t err_code);
+    int setBleName(const char *name, int len);
+    void handleFrameResults(int ret_val);
+
     bool compareStringInSerialBuff(const char* test_str, int n);  
     int processSetMessageInSerialBuff(void);  
     int processGetMessageInSerialBuff(void);
@@ -50,6 +71,11 @@ class nRF52_AT_API {
 
 //here's the main entry point to the AT message parsing
 int nRF52_AT_API::processSerialCharacter(char c) {
+  if (binary_mode) {
+    handleFrameResults(frame_parser.processByte((uint8_t)c));
+    return 0;
+  }
+
   //look for carriage return
   if (c == EOC) {  //look for the end-of-command character
     processSerialMessage();
@@ -61,10 +87,28 @@ int nRF52_AT_API::processSerialCharacter(char c) {
   return 0;
 }
 
+//a frame that stops part way through only fails once the link has been quiet for a while, so keep checking
+void nRF52_AT_API::serviceFrames(void) {
+  if (binary_mode) handleFrameResults(frame_parser.checkGap());
+}
+
+//after a bad frame, the parser looks again through the bytes that it has, which can give more results (see Serial_Frame.h)
+void nRF52_AT_API::handleFrameResults(int ret_val) {
+  while (ret_val != 0) {
+    if (ret_val > 0) {
+      processSerialFrame();
+    } else {
+      sendFrameNak(frame_parser.getOpcode(), frame_parser.getError());  //a bad CRC, a bad length, or a gap
+    }
+    if (!binary_mode) { frame_parser.reset();  return; }  //that frame switched back to the text commands
+    ret_val = frame_parser.update();
+  }
+}
+
 int nRF52_AT_API::lengthSerialMessage(void) {
   int len = 0;
   if (serial_read_ind > serial_write_ind) {
-    len = ((nRF52_AT_API_N_BUFFER-1) - serial_read_ind) + serial_write_ind;
+    len = (nRF52_AT_API_N_BUFFER - serial_read_ind) + serial_write_ind;
   } else {
     len = serial_write_ind - serial_read_ind;
   }
@@ -87,45 +131,50 @@ int nRF52_AT_API::processSerialMessage(void) {
 
   //Serial.println("nRF52_AT_API::processSerialMessage: starting...");
 
-  //test for the command "SEND "
-  int test_n_char = 5;   //how long is "SEND "
-  if (len >= test_n_char) {  //is the current message long enough for this test?
-    if (compareStringInSerialBuff("SEND ",test_n_char)) {  //does the current message start this way
-      serial_read_ind += test_n_char; //increment the reader index for the serial buffer
-      //Serial.println("nRF52_AT_API::processSerialMessage: SEND detected!");
-      bleWriteFromSerialBuff();
-      ret_val = 0; 
-    }
-  }
-
-  test_n_char = 4; //how long is "SET "
-  if (len >= test_n_char) {
-    if (compareStringInSerialBuff("SET ",test_n_char)) {  //does the current message start this way
-      serial_read_ind += test_n_char; //increment the reader index for the serial buffer
-      processSetMessageInSerialBuff();
-      ret_val = 0;
+  //only test the commands that start with the same character as the message, and stop at the first match
+  int test_n_char = 0;
+  if (len > 0) {
+    switch (serial_buff[serial_read_ind]) {
+      case 'S':
+        test_n_char = 5;   //how long is "SEND "
+        if ((len >= test_n_char) && compareStringInSerialBuff("SEND ",test_n_char)) {  //does the current message start this way
+          serial_read_ind += test_n_char; //increment the reader index for the serial buffer
+          if (serial_read_ind >= nRF52_AT_API_N_BUFFER) serial_read_ind -= nRF52_AT_API_N_BUFFER;
+          //Serial.println("nRF52_AT_API::processSerialMessage: SEND detected!");
+          bleWriteFromSerialBuff();
+          ret_val = 0;
+          break;
+        }
+        test_n_char = 4; //how long is "SET "
+        if ((len >= test_n_char) && compareStringInSerialBuff("SET ",test_n_char)) {  //does the current message start this way
+          serial_read_ind += test_n_char; //increment the reader index for the serial buffer
+          if (serial_read_ind >= nRF52_AT_API_N_BUFFER) serial_read_ind -= nRF52_AT_API_N_BUFFER;
+          processSetMessageInSerialBuff();
+          ret_val = 0;
+        }
+        break;
+      case 'G':
+        test_n_char = 4; //how long is "GET "
+        if ((len >= test_n_char) && compareStringInSerialBuff("GET ",test_n_char)) {  //does the current message start this way
+          serial_read_ind += test_n_char; //increment the reader index for the serial buffer
+          if (serial_read_ind >= nRF52_AT_API_N_BUFFER) serial_read_ind -= nRF52_AT_API_N_BUFFER;
+          ret_val = processGetMessageInSerialBuff();
+        }
+        break;
+      case 'V':
+        test_n_char = 7; //how long is "VERSION"
+        if ((len >= test_n_char) && compareStringInSerialBuff("VERSION",test_n_char)) {  //does the current message start this way
+          serial_read_ind += test_n_char; //increment the reader index for the serial buffer
+          if (serial_read_ind >= nRF52_AT_API_N_BUFFER) serial_read_ind -= nRF52_AT_API_N_BUFFER;
+          sendSerialOkMessage(versionString);
+          ret_val = 0;
+        }
+        break;
+      // serach for another command
+      //   anything?
     }
   }
 
-  test_n_char = 4; //how long is "GET "
-  if (len >= test_n_char) {
-    if (compareStringInSerialBuff("GET ",test_n_char)) {  //does the current message start this way
-      serial_read_ind += test_n_char; //increment the reader index for the serial buffer
-      ret_val = processGetMessageInSerialBuff();
-    }
-  } 
-
-  test_n_char = 7; //how long is "VERSION"
-  if (len >= test_n_char) {
-    if (compareStringInSerialBuff("VERSION",test_n_char)) {  //does the current message start this way
-      serial_read_ind += test_n_char; //increment the reader index for the serial buffer
-      sendSerialOkMessage(versionString);
-      ret_val = 0;
-    }
-  } 
-  // serach for another command
-  //   anything?
-
   // give error message if message isn't known
   if (ret_val != 0) {
     Serial.print("nRF52_AT_API: *** WARNING ***: msg not understood: ");
@@ -151,6 +200,16 @@ int nRF52_AT_API::processSetMessageInSerialBuff(void) {
     sendSerialOkMessage();
   }
 
+  test_n_char = 14; //length of "FRAMING=BINARY"
+  if ((ret_val != 0) && compareStringInSerialBuff("FRAMING=BINARY",test_n_char)) {
+    Serial.println("nRF52_AT_API: processSetMessageInSerialBuff: switching to binary frames");
+    serial_read_ind = serial_write_ind;  //remove the message
+    sendSerialOkMessage();  //the reply is still text.  Everything after this is binary frames.
+    frame_parser.reset();
+    binary_mode = true;
+    ret_val = 0;
+  }
+
   // serach for another command
   //   anything?
 
@@ -228,17 +287,7 @@ int nRF52_AT_API::setBleNameFromSerialBuff(void) {
       for (int i=0;i < new_len; i++) new_name[i] = serial_buff[serial_read_ind + i]; //copy from the serial buffer
       new_name[new_len] = '\0'; //add the null termination
       Serial.println("nRF52_AT_API: setBleNameFromSerialBuff: new_name = " + String(new_name));
-
-      //stop any advertising
-      //Bluefruit.Advertising.stop();
-
-      //send the new name to the module
-      Bluefruit.setName(new_name);
-
-      //restart advertising
-      //startAdv();
-
-      return 0;
+      return setBleName(new_name, new_len);
     } else {
       //length of new name was zero.  So assume this was a fail?
     }
@@ -259,13 +308,105 @@ int nRF52_AT_API::bleWriteFromSerialBuff(void) {
   }
 
   //if BLE is connected, fire off the message
+  return writeToBle((const uint8_t *)BLEmessage, counter);
+}
+
+int nRF52_AT_API::writeToBle(const uint8_t *buff, int len) {
   if (bleConnected) {
-    ble_ptr->write( BLEmessage, counter );
-    return counter;
+    ble_ptr->write( buff, len );
+    return len;
   }
   return -1;
 }
 
+//returns -1 if failed
+int nRF52_AT_API::setBleName(const char *name, int len) {
+  static const int max_len_name = 16;  //16 character max??
+  char new_name[max_len_name+1];
+  int new_len = min(max_len_name, len);  //choose the smaller of the given length or the max length
+  if (new_len <= 0) return -1;
+  for (int i=0; i < new_len; i++) new_name[i] = name[i];
+  new_name[new_len] = '\0'; //add the null termination
+
+  //stop any advertising
+  //Bluefruit.Advertising.stop();
+
+  //send the new name to the module
+  Bluefruit.setName(new_name);
+
+  //restart advertising
+  //startAdv();
+
+  return 0;
+}
+
+// ///////////////////////////////////////// Binary frames
+
+//the handler for each opcode (NULL if the opcode isn't used)
+const nRF52_AT_API::FrameHandler nRF52_AT_API::frame_handlers[SERIAL_FRAME_N_OPCODES] = {
+  NULL,                          //0x00: not used
+  &nRF52_AT_API::frameSend,      //SERIAL_FRAME_OP_SEND
+  &nRF52_AT_API::frameSetName,   //SERIAL_FRAME_OP_SET_NAME
+  &nRF52_AT_API::frameGetName,   //SERIAL_FRAME_OP_GET_NAME
+  &nRF52_AT_API::frameVersion,   //SERIAL_FRAME_OP_VERSION
+  &nRF52_AT_API::frameTextMode   //SERIAL_FRAME_OP_TEXT_MODE
+};
+
+int nRF52_AT_API::processSerialFrame(void) {
+  uint8_t opcode = frame_parser.getOpcode();
+  if ((opcode >= SERIAL_FRAME_N_OPCODES) || (frame_handlers[opcode] == NULL)) {
+    sendFrameNak(opcode, SERIAL_FRAME_ERR_OPCODE);
+    return -1;
+  }
+  return (this->*frame_handlers[opcode])(frame_parser.getPayload(), frame_parser.getPayloadLength());
+}
+
+int nRF52_AT_API::frameSend(const uint8_t *payload, int len) {
+  return writeToBle(payload, len);  //straight from the parser's buffer.  No reply, to keep the link free.
+}
+
+int nRF52_AT_API::frameSetName(const uint8_t *payload, int len) {
+  if (setBleName((const char *)payload, len) != 0) { sendFrameNak(SERIAL_FRAME_OP_SET_NAME, SERIAL_FRAME_ERR_FAILED); return -1; }
+  sendFrameReply(SERIAL_FRAME_OP_SET_NAME, NULL, 0);
+  return 0;
+}
+
+int nRF52_AT_API::frameGetName(const uint8_t *payload, int len) {
+  static const uint16_t n_len = 64;
+  char name[n_len];
+  uint32_t act_len = Bluefruit.getName(name, n_len);
+  sendFrameReply(SERIAL_FRAME_OP_GET_NAME, (const uint8_t *)name, (int)min(act_len, (uint32_t)n_len));  //no null termination needed
+  return 0;
+}
+
+int nRF52_AT_API::frameVersion(const uint8_t *payload, int len) {
+  sendFrameReply(SERIAL_FRAME_OP_VERSION, (const uint8_t *)versionString, strlen(versionString));
+  return 0;
+}
+
+int nRF52_AT_API::frameTextMode(const uint8_t *payload, int len) {
+  sendFrameReply(SERIAL_FRAME_OP_TEXT_MODE, NULL, 0);  //the reply is still a frame.  Everything after this is text.
+  binary_mode = false;
+  serial_read_ind = serial_write_ind;  //start with an empty text message
+  Serial.println("nRF52_AT_API: frameTextMode: switching to text commands");
+  return 0;
+}
+
+void nRF52_AT_API::sendFrameReply(uint8_t opcode, const uint8_t *payload, int len) {
+  SerialFrameParser::writeFrame(serial_ptr, opcode | SERIAL_FRAME_REPLY, payload, len);
+}
+
+void nRF52_AT_API::sendFrameNak(uint8_t opcode, uint8_t err_code) {
+  uint8_t payload[2] = { opcode, err_code };
+  SerialFrameParser::writeFrame(serial_ptr, SERIAL_FRAME_OP_NAK, payload, 2);
+}
+
+void nRF52_AT_API::printFrameStats(void) {
+  Serial.print("nRF52_AT_API: frames: good = "); Serial.print(frame_parser.n_frames_good);
+  Serial.print(", bad = "); Serial.print(frame_parser.n_frames_bad);
+  Serial.print(", bytes skipped = "); Serial.println(frame_parser.n_bytes_skipped);
+}
+
 void nRF52_AT_API::sendSerialOkMessage(const char* reply_str) {
   serial_ptr->print("OK ");
   serial_ptr->print(reply_str);
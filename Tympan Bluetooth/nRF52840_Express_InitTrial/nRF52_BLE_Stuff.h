@@ -146,6 +146,7 @@ void serialEvent(HardwareSerial *serial_ptr) { //for the nRF firmware, service a
       Serial.print("BLEevent: serial_ptr->available()) = "); Serial.println(serial_ptr->available());
       while (serial_ptr->available()) AT_interpreter.processSerialCharacter(serial_ptr->read());
     }
+    AT_interpreter.serviceFrames();  //drops a binary frame that stopped part way through
  }
 
 void setupBLE(){